@@ -0,0 +1,186 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "action.h"
+#include "background_dialog.h"
+#include "launcher.h"
+#include "server.h"
+#include "tab.h"
+#include "tab_switcher.h"
+#if WAYMUX_HAS_STATS
+#include "stats_hud.h"
+#endif
+
+/* Actions named without an argument */
+static const struct {
+	const char *name;
+	struct action action;
+} actions[] = {
+	{"next_tab", {ACTION_NEXT_TAB, 0}},
+	{"prev_tab", {ACTION_PREV_TAB, 0}},
+	{"close_tab", {ACTION_CLOSE_TAB, 0}},
+	{"open_launcher", {ACTION_OPEN_LAUNCHER, 0}},
+	{"toggle_background", {ACTION_TOGGLE_BACKGROUND, 0}},
+	{"show_background_dialog", {ACTION_SHOW_BACKGROUND_DIALOG, 0}},
+	{"last_used_tab", {ACTION_LAST_USED_TAB, 0}},
+	{"move_tab_left", {ACTION_MOVE_TAB, -1}},
+	{"move_tab_right", {ACTION_MOVE_TAB, 1}},
+	{"switch_tab", {ACTION_SWITCH_TAB, 1}},
+	{"switch_tab_back", {ACTION_SWITCH_TAB, -1}},
+	{"toggle_stats_hud", {ACTION_TOGGLE_STATS_HUD, 0}},
+};
+
+#define FOCUS_TAB_PREFIX "focus_tab_"
+
+bool
+action_parse(const char *name, struct action *action)
+{
+	if (!name || !action) {
+		return false;
+	}
+
+	for (size_t i = 0; i < sizeof(actions) / sizeof(actions[0]); i++) {
+		if (strcmp(name, actions[i].name) == 0) {
+			*action = actions[i].action;
+			return true;
+		}
+	}
+
+	size_t prefix_len = strlen(FOCUS_TAB_PREFIX);
+	if (strncmp(name, FOCUS_TAB_PREFIX, prefix_len) == 0) {
+		const char *number = name + prefix_len;
+		char *end;
+		errno = 0;
+		long value = strtol(number, &end, 10);
+		if (*number >= '1' && *number <= '9' && *end == '\0' && errno == 0 && value <= ACTION_MAX_TAB_NUMBER) {
+			*action = (struct action){ACTION_FOCUS_TAB, (int)value};
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+action_format(const struct action *action, char *buf, size_t size)
+{
+	if (action->type == ACTION_FOCUS_TAB) {
+		snprintf(buf, size, FOCUS_TAB_PREFIX "%d", action->arg);
+		return;
+	}
+
+	for (size_t i = 0; i < sizeof(actions) / sizeof(actions[0]); i++) {
+		if (actions[i].action.type == action->type && actions[i].action.arg == action->arg) {
+			snprintf(buf, size, "%s", actions[i].name);
+			return;
+		}
+	}
+	snprintf(buf, size, "none");
+}
+
+static bool
+activate(struct cg_tab *tab)
+{
+	if (!tab) {
+		return false;
+	}
+	tab_activate(tab);
+	return true;
+}
+
+bool
+action_run(struct cg_server *server, const struct action *action)
+{
+	struct cg_tab *current = server->active_tab;
+
+	switch (action->type) {
+	case ACTION_NONE:
+		return false;
+
+	case ACTION_SHOW_BACKGROUND_DIALOG:
+		background_dialog_toggle(server->background_dialog);
+		return true;
+
+	case ACTION_TOGGLE_BACKGROUND:
+		if (current) {
+			bool new_background = !current->is_background;
+			tab_set_background(current, new_background);
+
+			/* If tab became background, switch to next non-background tab */
+			if (new_background) {
+				struct cg_tab *next_tab = tab_next(current);
+				if (next_tab && next_tab != current) {
+					tab_activate(next_tab);
+				}
+			} else {
+				/* Tab became foreground, activate it */
+				tab_activate(current);
+			}
+			return true;
+		}
+		return false;
+
+	case ACTION_PREV_TAB:
+		return current && activate(tab_prev(current));
+
+	case ACTION_NEXT_TAB:
+		return current && activate(tab_next(current));
+
+	case ACTION_CLOSE_TAB:
+		if (current) {
+			struct cg_tab *next_tab = tab_next(current);
+
+			/* Destroy current tab */
+			tab_destroy(current);
+
+			/* Activate next tab if exists */
+			if (next_tab && next_tab != current) {
+				tab_activate(next_tab);
+			} else {
+				/* If next_tab was the same as current (only one tab),
+				 * get the first available tab */
+				activate(tab_at(server, 0));
+			}
+			return true;
+		}
+		return false;
+
+	case ACTION_OPEN_LAUNCHER:
+		launcher_toggle(server->launcher);
+		return true;
+
+	case ACTION_FOCUS_TAB:
+		/* Positions are those of the focused output's tab bar */
+		return activate(tab_output_foreground_at(server, current ? current->output : NULL, action->arg - 1));
+
+	case ACTION_LAST_USED_TAB:
+		return activate(tab_last_used(server));
+
+	case ACTION_MOVE_TAB:
+		return current && tab_move(current, action->arg);
+
+	case ACTION_SWITCH_TAB:
+		return tab_switcher_step(server->tab_switcher, action->arg);
+
+	case ACTION_TOGGLE_STATS_HUD:
+#if WAYMUX_HAS_STATS
+		stats_hud_toggle(server->stats_hud);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	return false;
+}
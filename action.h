@@ -0,0 +1,55 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_ACTION_H
+#define CG_ACTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cg_server;
+
+/* Largest N of focus_tab_N */
+#define ACTION_MAX_TAB_NUMBER 999
+
+/* WayMux actions, which can be bound to keys and run through the control
+ * socket */
+enum action_type {
+	ACTION_NONE = 0,
+	ACTION_NEXT_TAB,
+	ACTION_PREV_TAB,
+	ACTION_CLOSE_TAB,
+	ACTION_OPEN_LAUNCHER,
+	ACTION_TOGGLE_BACKGROUND,
+	ACTION_SHOW_BACKGROUND_DIALOG,
+	ACTION_FOCUS_TAB, /* arg: number of the tab in the tab bar, from 1 */
+	ACTION_LAST_USED_TAB,
+	ACTION_MOVE_TAB,   /* arg: -1 to move the active tab left, 1 right */
+	ACTION_SWITCH_TAB, /* arg: 1 for less recently used, -1 back */
+	ACTION_TOGGLE_STATS_HUD,
+};
+
+struct action {
+	enum action_type type;
+	int arg;
+};
+
+/* Parse an action name: next_tab, prev_tab, close_tab, open_launcher,
+ * toggle_background, show_background_dialog, focus_tab_N, last_used_tab,
+ * move_tab_left, move_tab_right, switch_tab, switch_tab_back
+ * or toggle_stats_hud. Returns false if it isn't one. */
+bool action_parse(const char *name, struct action *action);
+
+/* Write an action's name to buf, as accepted by action_parse() */
+void action_format(const struct action *action, char *buf, size_t size);
+
+/* Run an action. Returns false if it had nothing to act on, e.g. there is
+ * no active tab or no tab with that number. */
+bool action_run(struct cg_server *server, const struct action *action);
+
+#endif
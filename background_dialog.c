@@ -1,11 +1,18 @@
 #include "background_dialog.h"
+#include "font.h"
+#include "memory_policy.h"
 #include "output.h"
+#include "overlay.h"
+#include "pixel_buffer.h"
+#include "resources.h"
+#include "search.h"
 #include "server.h"
 #include "tab.h"
+#include "thumbnail.h"
+#include "trace.h"
 #include "view.h"
 #include <wlr/util/log.h>
 #include <xkbcommon/xkbcommon.h>
-#include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 #include <cairo/cairo.h>
@@ -25,182 +32,144 @@ static const float dialog_bg_color[4] = {
 static const float dialog_box_bg[4] = {0.12f, 0.12f, 0.12f, 1.0f};  /* Dark box background */
 static const float dialog_selected_bg[4] = {0.22f, 0.33f, 0.44f, 1.0f};  /* Selected item */
 static const float dialog_text[4] = {1.0f, 1.0f, 1.0f, 1.0f};  /* White text */
+static const float dialog_usage_text[4] = {0.65f, 0.65f, 0.65f, 1.0f};  /* Resource usage */
 static const float dialog_query_bg[4] = {0.08f, 0.08f, 0.08f, 1.0f};  /* Search box */
 
-/* Custom buffer that wraps pixel data */
-struct pixel_buffer {
-	struct wlr_buffer base;
-	uint32_t *data;
-	int width;
-	int height;
-	size_t size;
-};
-
-static void
-pixel_buffer_destroy(struct pixel_buffer *buffer)
+/* Thumbnails, left of each row's title */
+#define DIALOG_THUMBNAIL_X 20
+#define DIALOG_THUMBNAIL_WIDTH 56
+#define DIALOG_THUMBNAIL_HEIGHT (OVERLAY_ITEM_HEIGHT - 9)
+#define DIALOG_TITLE_X (DIALOG_THUMBNAIL_X + DIALOG_THUMBNAIL_WIDTH + 10)
+
+/* Score a tab against the lowercased query, or -1 if it doesn't match.
+ * Views keep their search text up to date; only placeholders, whose title
+ * is all there is to search, are lowercased here. */
+static int
+tab_query_score(struct cg_tab *tab, const char *query, uint64_t query_mask)
 {
-	if (!buffer) return;
-	if (buffer->data) {
-		free(buffer->data);
+	if (tab->view) {
+		if (!tab->view->search_text || (tab->view->search_mask & query_mask) != query_mask) {
+			return -1;
+		}
+		return search_score(tab->view->search_text, query);
 	}
-	wlr_buffer_finish(&buffer->base);
-	free(buffer);
-}
 
-static bool
-pixel_buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buffer,
-				    uint32_t flags, void **data_out,
-				    uint32_t *format, size_t *stride)
-{
-	struct pixel_buffer *buffer = wl_container_of(wlr_buffer, buffer, base);
-	*data_out = buffer->data;
-	*format = DRM_FORMAT_ARGB8888;
-	*stride = buffer->width * 4;
-	return true;
-}
-
-static void
-pixel_buffer_end_data_ptr_access(struct wlr_buffer *wlr_buffer)
-{
-	/* Nothing to do */
+	char *title = tab->title ? search_lowercase(tab->title) : NULL;
+	int score = title ? search_score(title, query) : -1;
+	free(title);
+	return score;
 }
 
-static const struct wlr_buffer_impl pixel_buffer_impl = {
-	.destroy = (void*)pixel_buffer_destroy,
-	.begin_data_ptr_access = pixel_buffer_begin_data_ptr_access,
-	.end_data_ptr_access = pixel_buffer_end_data_ptr_access,
+struct scored_tab {
+	struct cg_tab *tab;
+	int score;
+	size_t order;
 };
 
-/* Check if a tab matches the search query */
-static bool
-tab_matches_query(struct cg_tab *tab, const char *query)
+/* Best matches first; ties keep the tab order */
+static int
+compare_scored(const void *a, const void *b)
 {
-	if (query[0] == '\0') {
-		return true;
+	const struct scored_tab *sa = a;
+	const struct scored_tab *sb = b;
+	if (sa->score != sb->score) {
+		return sb->score - sa->score;
 	}
-
-	if (!tab->view) {
-		return false;
-	}
-
-	char *title = view_get_title(tab->view);
-	if (!title) {
-		return false;
-	}
-
-	/* Case-insensitive substring search */
-	char query_lower[BACKGROUND_DIALOG_MAX_QUERY];
-	snprintf(query_lower, sizeof(query_lower), "%s", query);
-	for (size_t i = 0; query_lower[i]; i++) {
-		query_lower[i] = tolower(query_lower[i]);
-	}
-
-	char title_lower[256];
-	snprintf(title_lower, sizeof(title_lower), "%s", title);
-	for (size_t i = 0; title_lower[i]; i++) {
-		title_lower[i] = tolower(title_lower[i]);
-	}
-
-	bool matches = strstr(title_lower, query_lower) != NULL;
-	free(title);
-	return matches;
+	return sa->order < sb->order ? -1 : 1;
 }
 
 /* Update the filtered results list based on current query */
 static void
 background_dialog_update_results(struct cg_background_dialog *dialog)
 {
-	dialog->result_count = 0;
+	char *query = search_lowercase(dialog->query);
+	uint64_t query_mask = query ? search_mask(query) : 0;
+	struct scored_tab scored[BACKGROUND_DIALOG_MAX_RESULTS];
+	size_t count = 0;
 
 	/* Iterate over all tabs and filter background tabs that match query */
 	struct cg_tab *tab;
 	wl_list_for_each(tab, &dialog->server->tabs, link) {
-		if (!tab->is_background) {
+		if (!tab->is_background || count == BACKGROUND_DIALOG_MAX_RESULTS) {
 			continue;
 		}
 
-		if (!tab_matches_query(tab, dialog->query)) {
-			continue;
+		/* Without a query, every background tab is listed in order */
+		int score = 0;
+		if (query && query[0] != '\0') {
+			score = tab_query_score(tab, query, query_mask);
+			if (score < 0) {
+				continue;
+			}
 		}
+		scored[count] = (struct scored_tab){.tab = tab, .score = score, .order = count};
+		count++;
 
-		if (dialog->result_count < 256) {
-			dialog->results[dialog->result_count++] = tab;
-		}
+		/* Background tabs' clients are the ones worth closing */
+		resources_sample(dialog->server->resources, tab->view ? view_get_pid(tab->view) : 0, &tab->usage);
 	}
+	free(query);
+
+	if (count > 1) {
+		qsort(scored, count, sizeof(*scored), compare_scored);
+	}
+	for (size_t i = 0; i < count; i++) {
+		dialog->results[i] = scored[i].tab;
+	}
+	dialog->result_count = count;
 
 	/* Reset selection if out of bounds */
 	if (dialog->selected_index >= dialog->result_count) {
 		dialog->selected_index = dialog->result_count > 0 ? dialog->result_count - 1 : 0;
 	}
 
+	/* The query line and the whole result list change */
+	overlay_damage_query(&dialog->overlay);
+	overlay_damage_results(&dialog->overlay);
 	dialog->dirty = true;
 }
 
-/* Render background dialog UI to a buffer */
-static struct wlr_buffer *
-render_dialog_ui(struct cg_background_dialog *dialog, int screen_width, int screen_height)
+/* Repaint the damaged parts of the dialog box */
+static void
+render_dialog_ui(struct cg_background_dialog *dialog)
 {
-	/* Dialog box dimensions - only render the box, not the whole screen */
-	(void)screen_width;
-	(void)screen_height;
-	int box_width = 600;
-	int box_height = 400;
-
-	/* Only allocate buffer for the dialog box area */
-	size_t stride = box_width * 4;
-	size_t size = box_height * stride;
-	uint32_t *data = calloc(1, size);
-	if (!data) {
-		return NULL;
-	}
-
-	/* Create cairo surface */
-	cairo_surface_t *surface = cairo_image_surface_create_for_data(
-		(unsigned char *)data, CAIRO_FORMAT_ARGB32, box_width, box_height, stride);
-	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
-		free(data);
-		return NULL;
-	}
+	TRACE_SCOPE("render_dialog_ui");
 
-	cairo_t *cr = cairo_create(surface);
+	struct cg_overlay *overlay = &dialog->overlay;
+	cairo_t *cr = overlay_begin_paint(overlay, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT);
 	if (!cr) {
-		cairo_surface_destroy(surface);
-		free(data);
-		return NULL;
+		return;
 	}
 
 	/* Draw dialog box background */
 	cairo_set_source_rgba(cr, dialog_box_bg[0], dialog_box_bg[1],
 			    dialog_box_bg[2], dialog_box_bg[3]);
-	cairo_rectangle(cr, 0, 0, box_width, box_height);
-	cairo_fill(cr);
-
-	/* Draw search box at top */
-	int search_height = 50;
-	cairo_set_source_rgba(cr, dialog_query_bg[0], dialog_query_bg[1],
-			    dialog_query_bg[2], dialog_query_bg[3]);
-	cairo_rectangle(cr, 0, 0, box_width, search_height);
+	cairo_rectangle(cr, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT);
 	cairo_fill(cr);
 
-	/* Draw search query text */
-	cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL,
-			      CAIRO_FONT_WEIGHT_NORMAL);
-	cairo_set_font_size(cr, 14);
-	cairo_set_source_rgb(cr, dialog_text[0], dialog_text[1], dialog_text[2]);
+	font_apply(dialog->font, cr);
 
-	/* Draw query text with cursor */
-	char query_display[BACKGROUND_DIALOG_MAX_QUERY + 2];
-	snprintf(query_display, sizeof(query_display), "%s|", dialog->query);
-	cairo_move_to(cr, 15, 30);
-	cairo_show_text(cr, query_display);
+	/* Draw search box at top */
+	if (overlay_needs_paint(overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT)) {
+		cairo_set_source_rgba(cr, dialog_query_bg[0], dialog_query_bg[1],
+				    dialog_query_bg[2], dialog_query_bg[3]);
+		cairo_rectangle(cr, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT);
+		cairo_fill(cr);
 
-	/* Draw results list */
-	int results_y = search_height + 10;
-	int item_height = 40;
-	int max_items = (box_height - search_height - 20) / item_height;
+		/* Draw query text with cursor */
+		cairo_set_source_rgb(cr, dialog_text[0], dialog_text[1], dialog_text[2]);
+		char query_display[BACKGROUND_DIALOG_MAX_QUERY + 2];
+		snprintf(query_display, sizeof(query_display), "%s|", dialog->query);
+		cairo_move_to(cr, 15, 30);
+		cairo_show_text(cr, query_display);
+	}
 
-	for (size_t i = 0; i < dialog->result_count && i < (size_t)max_items; i++) {
-		int item_y = results_y + i * item_height;
+	/* Draw results list, skipping rows that are not damaged */
+	for (size_t i = 0; i < dialog->result_count && i < OVERLAY_MAX_ITEMS; i++) {
+		int item_y = OVERLAY_RESULTS_Y + i * OVERLAY_ITEM_HEIGHT;
+		if (!overlay_needs_paint(overlay, 0, item_y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT)) {
+			continue;
+		}
 
 		/* Highlight selected item */
 		if (i == dialog->selected_index) {
@@ -208,84 +177,110 @@ render_dialog_ui(struct cg_background_dialog *dialog, int screen_width, int scre
 					    dialog_selected_bg[1],
 					    dialog_selected_bg[2],
 					    dialog_selected_bg[3]);
-			cairo_rectangle(cr, 10, item_y, box_width - 20, item_height - 5);
+			cairo_rectangle(cr, 10, item_y, OVERLAY_BOX_WIDTH - 20, OVERLAY_ITEM_HEIGHT - 5);
 			cairo_fill(cr);
 		}
 
-		/* Draw tab title */
+		/* Draw the client's usage, right-aligned */
 		struct cg_tab *tab = dialog->results[i];
+		double usage_width = 0;
+		if (tab->usage.pid > 0) {
+			char memory[32], usage[64];
+			resources_format_memory(tab->usage.memory, memory, sizeof(memory));
+			snprintf(usage, sizeof(usage), "%s \u00b7 %.0f%%%s", memory, tab->usage.cpu,
+				 tab->usage.gpu ? " \u00b7 GPU" : "");
+			usage_width = font_text_width(dialog->font, usage) + 10;
+			cairo_set_source_rgb(cr, dialog_usage_text[0], dialog_usage_text[1], dialog_usage_text[2]);
+			cairo_move_to(cr, OVERLAY_BOX_WIDTH - 20 - (usage_width - 10), item_y + 25);
+			cairo_show_text(cr, usage);
+		}
+
+		/* Draw tab title, right of the thumbnail */
 		cairo_set_source_rgb(cr, dialog_text[0], dialog_text[1], dialog_text[2]);
-		cairo_move_to(cr, 20, item_y + 25);
+		cairo_move_to(cr, DIALOG_TITLE_X, item_y + 25);
 
 		/* Get title and truncate if too long */
-		char *title = tab->view ? view_get_title(tab->view) : NULL;
-		char title_display[100];
-		snprintf(title_display, sizeof(title_display), "%s",
-			 title ? title : "<Untitled>");
+		const char *title = tab->view ? view_get_title(tab->view) : tab->title;
+		char title_display[256];
+		font_truncate_to_width(dialog->font, title ? title : "<Untitled>",
+				       OVERLAY_BOX_WIDTH - 20 - DIALOG_TITLE_X - usage_width, title_display,
+				       sizeof(title_display));
 		cairo_show_text(cr, title_display);
-		free(title);
 	}
 
-	cairo_destroy(cr);
-	cairo_surface_finish(surface);
-	cairo_surface_destroy(surface);
-
-	/* Create wlr_buffer wrapper */
-	struct pixel_buffer *buffer = calloc(1, sizeof(*buffer));
-	if (!buffer) {
-		free(data);
-		return NULL;
-	}
+	overlay_end_paint(overlay, cr, dialog->content_buffer);
+}
 
-	wlr_buffer_init(&buffer->base, &pixel_buffer_impl, box_width, box_height);
-	buffer->data = data;
-	buffer->width = box_width;
-	buffer->height = box_height;
-	buffer->size = size;
+/* Show the visible rows' thumbnails over the dialog box at x, y. They are
+ * scene buffers of their own, so a new capture doesn't repaint the row. */
+static void
+update_thumbnails(struct cg_background_dialog *dialog, int x, int y, float scale)
+{
+	for (size_t i = 0; i < OVERLAY_MAX_ITEMS; i++) {
+		struct wlr_scene_buffer *node = dialog->thumbnails[i];
+		struct cg_tab *tab = i < dialog->result_count ? dialog->results[i] : NULL;
+		int width = 0, height = 0;
+		struct wlr_buffer *buffer = tab && tab->view ? thumbnail_get(tab->view, DIALOG_THUMBNAIL_WIDTH,
+									DIALOG_THUMBNAIL_HEIGHT, scale,
+									&width, &height)
+							     : NULL;
+		if (!buffer) {
+			wlr_scene_node_set_enabled(&node->node, false);
+			continue;
+		}
 
-	return &buffer->base;
+		/* Centered in its slot */
+		int item_y = OVERLAY_RESULTS_Y + i * OVERLAY_ITEM_HEIGHT;
+		wlr_scene_buffer_set_buffer(node, buffer);
+		wlr_scene_buffer_set_dest_size(node, width, height);
+		wlr_scene_node_set_position(&node->node, x + DIALOG_THUMBNAIL_X + (DIALOG_THUMBNAIL_WIDTH - width) / 2,
+					    y + item_y + 2 + (DIALOG_THUMBNAIL_HEIGHT - height) / 2);
+		wlr_scene_node_set_enabled(&node->node, true);
+	}
 }
 
 /* Update the rendered dialog UI */
-static void
-background_dialog_update_render(struct cg_background_dialog *dialog)
+void
+background_dialog_flush(struct cg_background_dialog *dialog)
 {
-	if (!dialog->content_buffer || !dialog->is_visible || !dialog->dirty) {
+	if (!dialog || !dialog->content_buffer || !dialog->is_visible || !dialog->dirty) {
 		return;
 	}
 
-	/* Get output dimensions and position */
-	struct cg_output *output;
-	wl_list_for_each(output, &dialog->server->outputs, link) {
-		int screen_width = output->wlr_output->width;
-		int screen_height = output->wlr_output->height;
-
-		/* Calculate position for centered dialog box */
-		int box_width = 600;
-		int box_height = 400;
-		int x = (screen_width - box_width) / 2;
-		int y = (screen_height - box_height) / 2;
-
-		/* Render dialog UI */
-		struct wlr_buffer *buffer = render_dialog_ui(dialog, screen_width, screen_height);
-		if (!buffer) {
-			wlr_log(WLR_ERROR, "Failed to render background dialog UI");
-			return;
-		}
-
-		/* Update scene buffer */
-		wlr_scene_buffer_set_buffer(dialog->content_buffer, buffer);
+	/* Center the dialog box on the focused output, at its scale */
+	int x, y;
+	struct cg_output *output = output_center_box(dialog->server, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT, &x, &y);
+	if (output) {
+		/* Repaint what changed */
+		overlay_set_scale(&dialog->overlay, output->wlr_output->scale);
+		render_dialog_ui(dialog);
 		wlr_scene_node_set_position(&dialog->content_buffer->node, x, y);
-
-		/* Release old buffer reference */
-		wlr_buffer_drop(buffer);
-
-		break;  /* Only render on first output */
+		update_thumbnails(dialog, x, y, output->wlr_output->scale);
 	}
 
 	dialog->dirty = false;
 }
 
+/* Coalesce changes into one repaint on the next output frame */
+static void
+background_dialog_schedule_render(struct cg_background_dialog *dialog)
+{
+	dialog->dirty = true;
+	output_schedule_frames(dialog->server);
+}
+
+/* Pick up new thumbnails of clients that keep drawing while listed */
+static int
+handle_thumbnail_timer(void *data)
+{
+	struct cg_background_dialog *dialog = data;
+	if (dialog->is_visible) {
+		background_dialog_schedule_render(dialog);
+		wl_event_source_timer_update(dialog->thumbnail_timer, THUMBNAIL_INTERVAL_MS);
+	}
+	return 0;
+}
+
 struct cg_background_dialog *
 background_dialog_create(struct cg_server *server)
 {
@@ -302,11 +297,19 @@ background_dialog_create(struct cg_server *server)
 	dialog->query_len = 0;
 	dialog->result_count = 0;
 	dialog->selected_index = 0;
+	overlay_init(&dialog->overlay);
+
+	dialog->font = font_create("sans-serif", 14);
+	if (!dialog->font) {
+		free(dialog);
+		return NULL;
+	}
 
 	/* Create scene tree for dialog */
 	dialog->scene_tree = wlr_scene_tree_create(&server->scene->tree);
 	if (!dialog->scene_tree) {
 		wlr_log(WLR_ERROR, "Failed to create dialog scene tree");
+		font_destroy(dialog->font);
 		free(dialog);
 		return NULL;
 	}
@@ -316,6 +319,7 @@ background_dialog_create(struct cg_server *server)
 	if (!dialog->background) {
 		wlr_log(WLR_ERROR, "Failed to create dialog background");
 		wlr_scene_node_destroy(&dialog->scene_tree->node);
+		font_destroy(dialog->font);
 		free(dialog);
 		return NULL;
 	}
@@ -326,6 +330,29 @@ background_dialog_create(struct cg_server *server)
 		wlr_log(WLR_ERROR, "Failed to create dialog content buffer");
 		wlr_scene_node_destroy(&dialog->background->node);
 		wlr_scene_node_destroy(&dialog->scene_tree->node);
+		font_destroy(dialog->font);
+		free(dialog);
+		return NULL;
+	}
+
+	/* Thumbnail slots, above the rows they belong to */
+	for (size_t i = 0; i < OVERLAY_MAX_ITEMS; i++) {
+		dialog->thumbnails[i] = wlr_scene_buffer_create(dialog->scene_tree, NULL);
+		if (!dialog->thumbnails[i]) {
+			wlr_log(WLR_ERROR, "Failed to create dialog thumbnail");
+			wlr_scene_node_destroy(&dialog->scene_tree->node);
+			font_destroy(dialog->font);
+			free(dialog);
+			return NULL;
+		}
+	}
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(server->wl_display);
+	dialog->thumbnail_timer = wl_event_loop_add_timer(loop, handle_thumbnail_timer, dialog);
+	if (!dialog->thumbnail_timer) {
+		wlr_log(WLR_ERROR, "Failed to create dialog thumbnail timer");
+		wlr_scene_node_destroy(&dialog->scene_tree->node);
+		font_destroy(dialog->font);
 		free(dialog);
 		return NULL;
 	}
@@ -345,6 +372,9 @@ background_dialog_destroy(struct cg_background_dialog *dialog)
 	}
 
 	/* Scene tree and its children are destroyed automatically */
+	wl_event_source_remove(dialog->thumbnail_timer);
+	overlay_finish(&dialog->overlay);
+	font_destroy(dialog->font);
 	free(dialog);
 	wlr_log(WLR_DEBUG, "Background dialog destroyed");
 }
@@ -356,16 +386,11 @@ background_dialog_show(struct cg_background_dialog *dialog)
 		return;
 	}
 
-	/* Get output dimensions */
-	struct cg_output *output;
-	wl_list_for_each(output, &dialog->server->outputs, link) {
-		int width = output->wlr_output->width;
-		int height = output->wlr_output->height;
-
-		/* Resize fullscreen background to cover output */
-		wlr_scene_rect_set_size(dialog->background, width, height);
-
-		break;  /* Only use first output */
+	/* Resize fullscreen background to cover the focused output */
+	struct wlr_box box;
+	if (output_focused_box(dialog->server, &box)) {
+		wlr_scene_rect_set_size(dialog->background, box.width, box.height);
+		wlr_scene_node_set_position(&dialog->background->node, box.x, box.y);
 	}
 
 	/* Update results to show all background tabs */
@@ -377,8 +402,8 @@ background_dialog_show(struct cg_background_dialog *dialog)
 	wlr_scene_node_set_enabled(&dialog->scene_tree->node, true);
 	wlr_scene_node_raise_to_top(&dialog->scene_tree->node);
 	dialog->is_visible = true;
-	dialog->dirty = true;
-	background_dialog_update_render(dialog);
+	background_dialog_schedule_render(dialog);
+	wl_event_source_timer_update(dialog->thumbnail_timer, THUMBNAIL_INTERVAL_MS);
 
 	wlr_log(WLR_DEBUG, "Background dialog shown");
 }
@@ -393,10 +418,26 @@ background_dialog_hide(struct cg_background_dialog *dialog)
 	/* Hide dialog */
 	wlr_scene_node_set_enabled(&dialog->scene_tree->node, false);
 	dialog->is_visible = false;
+	wl_event_source_timer_update(dialog->thumbnail_timer, 0);
+	memory_policy_schedule_trim(dialog->server->memory);
 
 	wlr_log(WLR_DEBUG, "Background dialog hidden");
 }
 
+size_t
+background_dialog_release(struct cg_background_dialog *dialog)
+{
+	if (!dialog || dialog->is_visible) {
+		return 0;
+	}
+
+	/* The thumbnails are the views'; only our locks go */
+	for (size_t i = 0; i < OVERLAY_MAX_ITEMS; i++) {
+		wlr_scene_buffer_set_buffer(dialog->thumbnails[i], NULL);
+	}
+	return overlay_release(&dialog->overlay, dialog->content_buffer);
+}
+
 void
 background_dialog_toggle(struct cg_background_dialog *dialog)
 {
@@ -439,18 +480,20 @@ background_dialog_handle_key(struct cg_background_dialog *dialog, xkb_keysym_t s
 	case XKB_KEY_Up:
 		/* Navigate up */
 		if (dialog->selected_index > 0) {
+			overlay_damage_row(&dialog->overlay, dialog->selected_index);
 			dialog->selected_index--;
-			dialog->dirty = true;
-			background_dialog_update_render(dialog);
+			overlay_damage_row(&dialog->overlay, dialog->selected_index);
+			background_dialog_schedule_render(dialog);
 		}
 		break;
 
 	case XKB_KEY_Down:
 		/* Navigate down */
 		if (dialog->selected_index + 1 < dialog->result_count) {
+			overlay_damage_row(&dialog->overlay, dialog->selected_index);
 			dialog->selected_index++;
-			dialog->dirty = true;
-			background_dialog_update_render(dialog);
+			overlay_damage_row(&dialog->overlay, dialog->selected_index);
+			background_dialog_schedule_render(dialog);
 		}
 		break;
 
@@ -460,7 +503,7 @@ background_dialog_handle_key(struct cg_background_dialog *dialog, xkb_keysym_t s
 			dialog->query_len--;
 			dialog->query[dialog->query_len] = '\0';
 			background_dialog_update_results(dialog);
-			background_dialog_update_render(dialog);
+			background_dialog_schedule_render(dialog);
 		} else {
 			handled = false;
 		}
@@ -475,7 +518,7 @@ background_dialog_handle_key(struct cg_background_dialog *dialog, xkb_keysym_t s
 				dialog->query[dialog->query_len++] = ch;
 				dialog->query[dialog->query_len] = '\0';
 				background_dialog_update_results(dialog);
-				background_dialog_update_render(dialog);
+				background_dialog_schedule_render(dialog);
 			} else {
 				handled = false;
 			}
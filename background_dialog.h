@@ -6,16 +6,24 @@
 #include <wlr/util/box.h>
 #include <xkbcommon/xkbcommon.h>
 
+#include "overlay.h"
+
 #define BACKGROUND_DIALOG_MAX_QUERY 256
+#define BACKGROUND_DIALOG_MAX_RESULTS 256
 
 struct cg_server;
+struct cg_font;
 struct cg_tab;
 
 struct cg_background_dialog {
 	struct cg_server *server;
 	struct wlr_scene_tree *scene_tree;
 	struct wlr_scene_rect *background;
+	struct cg_font *font;
 	struct wlr_scene_buffer *content_buffer;  /* Rendered dialog UI */
+	struct cg_overlay overlay;                /* Retained pixels and damage */
+	struct wlr_scene_buffer *thumbnails[OVERLAY_MAX_ITEMS];  /* One per row */
+	struct wl_event_source *thumbnail_timer;  /* Refreshes them while shown */
 	bool is_visible;
 	bool dirty;  /* UI needs re-rendering */
 
@@ -23,8 +31,8 @@ struct cg_background_dialog {
 	char query[BACKGROUND_DIALOG_MAX_QUERY];
 	size_t query_len;
 
-	/* Filtered results */
-	struct cg_tab *results[256];  /* Simplified: fixed array */
+	/* Filtered results, best matches first */
+	struct cg_tab *results[BACKGROUND_DIALOG_MAX_RESULTS];
 	size_t result_count;
 	size_t selected_index;
 };
@@ -35,6 +43,12 @@ void background_dialog_show(struct cg_background_dialog *dialog);
 void background_dialog_hide(struct cg_background_dialog *dialog);
 void background_dialog_toggle(struct cg_background_dialog *dialog);
 
+/* Drop the pixels of a hidden dialog; returns the bytes freed */
+size_t background_dialog_release(struct cg_background_dialog *dialog);
+
+/* Repaint pending changes; called once per output frame */
+void background_dialog_flush(struct cg_background_dialog *dialog);
+
 /* Keyboard input handling */
 bool background_dialog_handle_key(struct cg_background_dialog *dialog, xkb_keysym_t sym, uint32_t keycode);
 
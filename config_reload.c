@@ -0,0 +1,166 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "config_reload.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+#include "output.h"
+#include "server.h"
+#include "tab_bar.h"
+#include "visibility.h"
+#include "waymux_config.h"
+
+bool
+config_reload(struct cg_server *server)
+{
+	struct waymux_config *config = waymux_config_load(server->config_path);
+	if (!config) {
+		wlr_log(WLR_ERROR, "Failed to reload the configuration, keeping the current one");
+		return false;
+	}
+
+	struct waymux_config *old_config = server->config;
+	uint32_t changes = waymux_config_diff(old_config, config);
+	server->config = config;
+
+	/* Keybindings are looked up in server->config on every key press,
+	 * so swapping it is all they need */
+	if (changes & WAYMUX_CONFIG_CHANGED_HIDDEN_TABS && server->visibility) {
+		visibility_configure(server->visibility, config->suspend_hidden_tabs,
+				     config->stop_background_tabs_after);
+	}
+	if (changes & WAYMUX_CONFIG_CHANGED_TAB_BAR) {
+		bool scene = config->tab_bar_renderer == WAYMUX_TAB_BAR_RENDERER_SCENE;
+		if (server->tab_bar) {
+			tab_bar_set_renderer(server->tab_bar, scene);
+		}
+		struct cg_output *output;
+		wl_list_for_each(output, &server->outputs, link) {
+			if (output->tab_bar) {
+				tab_bar_set_renderer(output->tab_bar, scene);
+			}
+		}
+	}
+	if (changes & WAYMUX_CONFIG_CHANGED_OUTPUT) {
+		output_update_passthrough(server);
+	}
+
+	wlr_log(WLR_INFO, "Reloaded configuration from %s (%s)",
+		config->config_path ? config->config_path : "defaults", changes ? "changed" : "unchanged");
+	waymux_config_free(old_config);
+	return true;
+}
+
+struct cg_config_watch {
+	struct cg_server *server;
+	int fd;
+	struct wl_event_source *event_source;
+	char *file_name;  /* Of the configuration file, in the watched directory */
+};
+
+static int
+handle_watch_event(int fd, uint32_t mask, void *data)
+{
+	struct cg_config_watch *watch = data;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	bool changed = false;
+
+	for (;;) {
+		ssize_t len = read(fd, buf, sizeof(buf));
+		if (len <= 0) {
+			break;
+		}
+
+		for (char *ptr = buf; ptr < buf + len;) {
+			const struct inotify_event *event = (const struct inotify_event *)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				changed = true;
+			} else if (event->len > 0 && strcmp(event->name, watch->file_name) == 0) {
+				changed = true;
+			}
+		}
+	}
+
+	/* A burst of events, e.g. a write and a rename, is one reload */
+	if (changed) {
+		config_reload(watch->server);
+	}
+	return 0;
+}
+
+struct cg_config_watch *
+config_watch_create(struct cg_server *server, struct wl_event_loop *event_loop)
+{
+	const char *path = server->config->config_path;
+	const char *slash = path ? strrchr(path, '/') : NULL;
+	if (!slash || slash[1] == '\0') {
+		return NULL;
+	}
+
+	struct cg_config_watch *watch = calloc(1, sizeof(*watch));
+	if (!watch) {
+		return NULL;
+	}
+	watch->server = server;
+	watch->file_name = strdup(slash + 1);
+	char *dir = slash == path ? strdup("/") : strndup(path, slash - path);
+
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to create inotify instance");
+		free(dir);
+		free(watch->file_name);
+		free(watch);
+		return NULL;
+	}
+
+	/* Not IN_CREATE: the file is empty until written and closed */
+	if (!watch->file_name || !dir ||
+	    inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to watch configuration directory %s", dir ? dir : path);
+		free(dir);
+		config_watch_destroy(watch);
+		return NULL;
+	}
+
+	watch->event_source = wl_event_loop_add_fd(event_loop, watch->fd, WL_EVENT_READABLE, handle_watch_event, watch);
+	if (!watch->event_source) {
+		wlr_log(WLR_ERROR, "Failed to watch the configuration file");
+		free(dir);
+		config_watch_destroy(watch);
+		return NULL;
+	}
+
+	wlr_log(WLR_DEBUG, "Watching %s/%s for changes", dir, watch->file_name);
+	free(dir);
+	return watch;
+}
+
+void
+config_watch_destroy(struct cg_config_watch *watch)
+{
+	if (!watch) {
+		return;
+	}
+
+	if (watch->event_source) {
+		wl_event_source_remove(watch->event_source);
+	}
+	close(watch->fd);
+	free(watch->file_name);
+	free(watch);
+}
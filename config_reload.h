@@ -0,0 +1,43 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_CONFIG_RELOAD_H
+#define CG_CONFIG_RELOAD_H
+
+#include <stdbool.h>
+#include <wayland-server-core.h>
+
+struct cg_server;
+
+/**
+ * Load the configuration file again and apply it. The new configuration
+ * is parsed in full before it replaces the current one, so a file with
+ * errors leaves the current configuration in place; only the parts that
+ * changed are applied. Returns false if the file failed to load.
+ */
+bool config_reload(struct cg_server *server);
+
+/*
+ * Reloads the configuration whenever its file is written. The file's
+ * directory is watched rather than the file, since editors commonly save
+ * by renaming a new file over the old one.
+ */
+struct cg_config_watch;
+
+/**
+ * Watch the loaded configuration file. Returns NULL without a
+ * configuration file, or if it can't be watched.
+ */
+struct cg_config_watch *config_watch_create(struct cg_server *server, struct wl_event_loop *event_loop);
+
+/**
+ * Stop watching. NULL-safe.
+ */
+void config_watch_destroy(struct cg_config_watch *watch);
+
+#endif
@@ -8,8 +8,10 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <limits.h>
-#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,13 +20,39 @@
 #include <sys/un.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
+#include <wlr/types/wlr_output_layout.h>
 #include <wlr/util/log.h>
 
+#include "action.h"
+#include "config_reload.h"
+#include "exec_line.h"
 #include "launcher.h"
+#include "output.h"
+#include "resources.h"
+#include "session.h"
+#include "spawner.h"
+#include "stats.h"
 #include "tab.h"
+#include "trace.h"
 #include "view.h"
+#if WAYMUX_HAS_STATS
+#include "pixel_buffer.h"
+#include "stats_hud.h"
+#endif
 
 #define CONTROL_BUFFER_SIZE 4096
+#define CONTROL_REQUEST_ID_MAX 32
+/* Events are dropped for a client whose unsent output exceeds this */
+#define CONTROL_MAX_PENDING (1024 * 1024)
+
+/* A growable byte buffer; once an allocation fails, further appends are
+ * ignored and failed is set */
+struct cg_control_buffer {
+	char *data;
+	size_t len;
+	size_t capacity;
+	bool failed;
+};
 
 struct cg_control_client {
 	struct cg_control_server *control;
@@ -33,6 +61,33 @@ struct cg_control_client {
 	struct wl_list link; // control_server::clients
 	char buffer[CONTROL_BUFFER_SIZE];
 	size_t buffer_len;
+
+	/* Response being built for the current command */
+	struct cg_control_buffer reply;
+	/* Framed data not yet accepted by the socket; output_sent bytes of it
+	 * have been written. While it is non-empty, the client also waits
+	 * for WL_EVENT_WRITABLE. */
+	struct cg_control_buffer output;
+	size_t output_sent;
+	bool waiting_writable;
+	/* Shut down the write side once the output is drained */
+	bool shutdown_pending;
+
+	/* Session mode: the connection stays open for any number of commands,
+	 * and each response is terminated by an empty line */
+	bool session;
+	/* Receives tab events (see handle_subscribe) */
+	bool subscribed;
+	/* Events are sent as JSON (subscribed with --json) */
+	bool json_events;
+	/* Events were dropped because the client stopped reading; set until
+	 * the output is drained */
+	bool events_overflowed;
+	/* The current command was prefixed with --json */
+	bool json;
+	/* ID of the command being processed ("@ID command"), echoed at the
+	 * start of its response; empty if the command carried none */
+	char request_id[CONTROL_REQUEST_ID_MAX];
 };
 
 /* Forward declarations */
@@ -52,192 +107,492 @@ set_nonblock(int fd)
 	}
 }
 
+static bool
+buffer_reserve(struct cg_control_buffer *buf, size_t extra)
+{
+	if (buf->failed) {
+		return false;
+	}
+	if (buf->len + extra <= buf->capacity) {
+		return true;
+	}
+
+	size_t capacity = buf->capacity ? buf->capacity : 256;
+	while (capacity < buf->len + extra) {
+		capacity *= 2;
+	}
+	char *data = realloc(buf->data, capacity);
+	if (!data) {
+		wlr_log(WLR_ERROR, "Failed to grow control buffer");
+		buf->failed = true;
+		return false;
+	}
+	buf->data = data;
+	buf->capacity = capacity;
+	return true;
+}
+
 static void
-control_client_send(struct cg_control_client *client, const char *message)
+buffer_append(struct cg_control_buffer *buf, const char *data, size_t len)
 {
-	size_t len = strlen(message);
-	ssize_t sent = send(client->fd, message, len, MSG_NOSIGNAL);
-	if (sent < 0) {
-		wlr_log_errno(WLR_ERROR, "Failed to send response to client");
+	if (buffer_reserve(buf, len)) {
+		memcpy(buf->data + buf->len, data, len);
+		buf->len += len;
+	}
+}
+
+static void
+buffer_appendf(struct cg_control_buffer *buf, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	if (n < 0 || !buffer_reserve(buf, (size_t)n + 1)) {
 		return;
 	}
 
-	/* Shutdown write side to signal response is complete */
-	shutdown(client->fd, SHUT_WR);
+	va_start(args, fmt);
+	vsnprintf(buf->data + buf->len, (size_t)n + 1, fmt, args);
+	va_end(args);
+	buf->len += n;
 }
 
+/* Append a string as a JSON string literal, or null */
 static void
-handle_list_tabs(struct cg_control_client *client)
+buffer_append_json_string(struct cg_control_buffer *buf, const char *str)
 {
-	struct cg_server *server = client->control->server;
-	int index = 0;
-	struct cg_tab *tab;
+	if (!str) {
+		buffer_append(buf, "null", 4);
+		return;
+	}
 
-	char response[CONTROL_BUFFER_SIZE];
-	size_t offset = 0;
+	buffer_append(buf, "\"", 1);
+	for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+		if (*p == '"' || *p == '\\') {
+			char escaped[2] = {'\\', (char)*p};
+			buffer_append(buf, escaped, 2);
+		} else if (*p < 0x20) {
+			buffer_appendf(buf, "\\u%04x", *p);
+		} else {
+			buffer_append(buf, (const char *)p, 1);
+		}
+	}
+	buffer_append(buf, "\"", 1);
+}
+
+static void
+buffer_finish(struct cg_control_buffer *buf)
+{
+	free(buf->data);
+	memset(buf, 0, sizeof(*buf));
+}
 
-	offset += snprintf(response + offset, CONTROL_BUFFER_SIZE - offset, "OK %d\n", tab_count(server));
+/* Write as much queued output as the socket takes. The rest is written
+ * from handle_client_data once the socket is writable again. */
+static void
+control_client_flush(struct cg_control_client *client)
+{
+	struct cg_control_buffer *out = &client->output;
 
-	wl_list_for_each(tab, &server->tabs, link) {
-		const char *title = "(unnamed)";
-		const char *app_id = "(unknown)";
-		char *view_title = NULL;
-		char *view_app_id = NULL;
-
-		if (tab->view) {
-			view_title = view_get_title(tab->view);
-			view_app_id = view_get_app_id(tab->view);
-			if (view_title) {
-				title = view_title;
-			}
-			if (view_app_id) {
-				app_id = view_app_id;
+	while (client->output_sent < out->len) {
+		ssize_t n = send(client->fd, out->data + client->output_sent, out->len - client->output_sent,
+				 MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (!client->waiting_writable) {
+				wl_event_source_fd_update(client->event_source,
+							  WL_EVENT_READABLE | WL_EVENT_WRITABLE);
+				client->waiting_writable = true;
 			}
+			return;
+		}
+		if (n < 0) {
+			wlr_log_errno(WLR_ERROR, "Failed to send response to client");
+			break;
 		}
+		client->output_sent += n;
+	}
 
-		/* Add [H] marker for hidden (background) tabs */
-		const char *hidden_marker = tab->is_background ? " [H]" : "";
-		offset += snprintf(response + offset, CONTROL_BUFFER_SIZE - offset,
-				  "%d: [%s]%s %s\n", index, app_id, hidden_marker, title);
-		index++;
-		free(view_title);
-		free(view_app_id);
+	/* Drained; don't hold on to the memory of a large response */
+	out->len = 0;
+	client->output_sent = 0;
+	client->events_overflowed = false;
+	if (out->capacity > CONTROL_BUFFER_SIZE) {
+		buffer_finish(out);
+	}
+	if (client->waiting_writable) {
+		wl_event_source_fd_update(client->event_source, WL_EVENT_READABLE);
+		client->waiting_writable = false;
 	}
 
-	control_client_send(client, response);
+	/* Shutdown write side to signal response is complete */
+	if (client->shutdown_pending) {
+		shutdown(client->fd, SHUT_WR);
+		client->shutdown_pending = false;
+	}
 }
 
+/* Start the response to the current command. Text responses begin with
+ * the echoed "@ID "; JSON responses carry it as an "id" member instead. */
+static struct cg_control_buffer *
+reply_start(struct cg_control_client *client, bool ok)
+{
+	struct cg_control_buffer *reply = &client->reply;
+	reply->len = 0;
+	reply->failed = false;
+
+	if (client->json) {
+		buffer_append(reply, "{", 1);
+		if (client->request_id[0] != '\0') {
+			buffer_append(reply, "\"id\":", 5);
+			buffer_append_json_string(reply, client->request_id);
+			buffer_append(reply, ",", 1);
+		}
+		buffer_appendf(reply, "\"ok\":%s", ok ? "true" : "false");
+	} else if (client->request_id[0] != '\0') {
+		buffer_appendf(reply, "@%s ", client->request_id);
+	}
+	return reply;
+}
+
+/* Queue the finished response; in session mode, add the terminator */
 static void
-handle_focus_tab(struct cg_control_client *client, const char *arg)
+reply_finish(struct cg_control_client *client)
 {
-	if (!arg || strlen(arg) == 0) {
-		control_client_send(client, "ERROR Missing tab index\n");
-		return;
+	struct cg_control_buffer *reply = &client->reply;
+
+	if (client->json) {
+		buffer_append(reply, "}\n", 2);
+	}
+	if (client->session) {
+		buffer_append(reply, "\n", 1);
 	}
 
-	char *endptr;
-	long tab_num = strtol(arg, &endptr, 10);
-	if (*endptr != '\0' || tab_num < 0) {
-		control_client_send(client, "ERROR Invalid tab index\n");
+	if (reply->failed) {
+		wlr_log(WLR_ERROR, "Out of memory building control response");
+	} else {
+		buffer_append(&client->output, reply->data, reply->len);
+	}
+	if (reply->capacity > CONTROL_BUFFER_SIZE) {
+		buffer_finish(reply);
+	}
+
+	if (!client->session && !client->subscribed) {
+		client->shutdown_pending = true;
+	}
+	control_client_flush(client);
+}
+
+static void
+reply_ok(struct cg_control_client *client, const char *detail)
+{
+	struct cg_control_buffer *reply = reply_start(client, true);
+	if (!client->json) {
+		if (detail) {
+			buffer_appendf(reply, "OK %s\n", detail);
+		} else {
+			buffer_append(reply, "OK\n", 3);
+		}
+	}
+	reply_finish(client);
+}
+
+static void
+reply_error(struct cg_control_client *client, const char *message)
+{
+	struct cg_control_buffer *reply = reply_start(client, false);
+	if (client->json) {
+		buffer_append(reply, ",\"error\":", 9);
+		buffer_append_json_string(reply, message);
+	} else {
+		buffer_appendf(reply, "ERROR %s\n", message);
+	}
+	reply_finish(client);
+}
+
+/* Describe a tab as a list-tabs line: "INDEX: id:ID [APP_ID] TITLE", with
+ * [H] after the app_id for background tabs; or as a JSON object */
+static void
+append_tab(struct cg_control_buffer *buf, struct cg_server *server, struct cg_tab *tab, int index, bool json,
+	   bool usage)
+{
+	const char *title = tab->view ? view_get_title(tab->view) : tab->title;
+	const char *app_id = tab->view ? view_get_app_id(tab->view) : NULL;
+
+	if (json) {
+		buffer_appendf(buf, "{\"index\":%d,\"id\":%u,\"app_id\":", index, tab->id);
+		buffer_append_json_string(buf, app_id);
+		buffer_append(buf, ",\"title\":", 9);
+		buffer_append_json_string(buf, title);
+		buffer_appendf(buf, ",\"background\":%s,\"active\":%s", tab->is_background ? "true" : "false",
+			       tab == server->active_tab ? "true" : "false");
+		buffer_append(buf, ",\"output\":", 10);
+		buffer_append_json_string(buf, tab->output ? tab->output->wlr_output->name : NULL);
+		if (!usage) {
+			buffer_append(buf, "}", 1);
+			return;
+		}
+
+		resources_sample(server->resources, tab->view ? view_get_pid(tab->view) : 0, &tab->usage);
+		if (tab->usage.pid <= 0) {
+			buffer_appendf(buf, ",\"pid\":null,\"memory\":null,\"cpu\":null,\"gpu\":false,\"cgroup\":false}");
+			return;
+		}
+		buffer_appendf(buf, ",\"pid\":%d,\"memory\":%" PRIu64 ",\"cpu\":%.1f,\"gpu\":%s,\"cgroup\":%s}",
+			       (int)tab->usage.pid, tab->usage.memory, tab->usage.cpu, tab->usage.gpu ? "true" : "false",
+			       tab->usage.own_cgroup ? "true" : "false");
 		return;
 	}
 
+	/* Add [H] marker for hidden (background) tabs */
+	const char *hidden_marker = tab->is_background ? " [H]" : "";
+	buffer_appendf(buf, "%d: id:%u [%s]%s %s\n", index, tab->id, app_id ? app_id : "(unknown)",
+		       hidden_marker, title ? title : "(unnamed)");
+}
+
+static void
+handle_list_tabs(struct cg_control_client *client)
+{
 	struct cg_server *server = client->control->server;
+	struct cg_control_buffer *reply = reply_start(client, true);
 	int index = 0;
 	struct cg_tab *tab;
 
+	if (client->json) {
+		buffer_append(reply, ",\"tabs\":[", 9);
+	} else {
+		buffer_appendf(reply, "OK %d\n", tab_count(server));
+	}
+
 	wl_list_for_each(tab, &server->tabs, link) {
-		if (index == tab_num) {
-			tab_activate(tab);
-			control_client_send(client, "OK\n");
-			return;
+		if (client->json && index > 0) {
+			buffer_append(reply, ",", 1);
 		}
+		append_tab(reply, server, tab, index, client->json, true);
 		index++;
 	}
 
-	control_client_send(client, "ERROR Tab index out of range\n");
+	if (client->json) {
+		buffer_append(reply, "]", 1);
+	}
+	reply_finish(client);
 }
 
+/* List outputs, in layout order, as "INDEX: NAME WxH+X+Y" lines with [F]
+ * for the focused output and the ID of the tab shown on it, if any */
 static void
-handle_close_tab(struct cg_control_client *client, const char *arg, bool force)
+handle_list_outputs(struct cg_control_client *client)
 {
-	if (!arg || strlen(arg) == 0) {
-		control_client_send(client, "ERROR Missing tab index\n");
-		return;
-	}
+	struct cg_server *server = client->control->server;
+	struct cg_output *focused = output_focused(server);
+	struct cg_control_buffer *reply = reply_start(client, true);
+	int index = 0;
+	struct cg_output *output;
 
-	char *endptr;
-	long tab_num = strtol(arg, &endptr, 10);
-	if (*endptr != '\0' || tab_num < 0) {
-		control_client_send(client, "ERROR Invalid tab index\n");
-		return;
+	if (client->json) {
+		buffer_append(reply, ",\"outputs\":[", 12);
+	} else {
+		buffer_appendf(reply, "OK %d\n", wl_list_length(&server->outputs));
 	}
 
-	struct cg_server *server = client->control->server;
-	int index = 0;
-	struct cg_tab *tab;
+	wl_list_for_each (output, &server->outputs, link) {
+		struct wlr_box box;
+		wlr_output_layout_get_box(server->output_layout, output->wlr_output, &box);
+		struct cg_tab *shown = server->output_mode == WAYMUX_MULTI_OUTPUT_MODE_SEPARATE ? output->active_tab
+											 : server->active_tab;
+		int tabs = 0;
+		struct cg_tab *tab;
+		wl_list_for_each (tab, &server->tabs, link) {
+			if (!tab->output || tab->output == output) {
+				tabs++;
+			}
+		}
 
-	wl_list_for_each(tab, &server->tabs, link) {
-		if (index == tab_num) {
-			if (force) {
-				/* Kill the view */
-				if (tab->view && tab->view->impl && tab->view->impl->close) {
-					tab->view->impl->close(tab->view);
-				}
+		if (client->json) {
+			buffer_appendf(reply, "%s{\"index\":%d,\"name\":", index > 0 ? "," : "", index);
+			buffer_append_json_string(reply, output->wlr_output->name);
+			buffer_appendf(reply, ",\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d,\"focused\":%s", box.x,
+				       box.y, box.width, box.height, output == focused ? "true" : "false");
+			if (shown) {
+				buffer_appendf(reply, ",\"active_tab\":%u", shown->id);
 			} else {
-				/* Graceful close */
-				tab_destroy(tab);
+				buffer_append(reply, ",\"active_tab\":null", 18);
 			}
-			control_client_send(client, "OK\n");
-			return;
+			buffer_appendf(reply, ",\"tabs\":%d}", tabs);
+		} else {
+			buffer_appendf(reply, "%d: %s %dx%d+%d+%d%s", index, output->wlr_output->name, box.width,
+				       box.height, box.x, box.y, output == focused ? " [F]" : "");
+			if (shown) {
+				buffer_appendf(reply, " id:%u", shown->id);
+			}
+			buffer_append(reply, "\n", 1);
 		}
 		index++;
 	}
 
-	control_client_send(client, "ERROR Tab index out of range\n");
+	if (client->json) {
+		buffer_append(reply, "]", 1);
+	}
+	reply_finish(client);
 }
 
-static void
-handle_background_tab(struct cg_control_client *client, const char *arg)
+/* Resolve an output argument, by name or by position in list-outputs.
+ * Replies with an error and returns NULL if there is no such output, or
+ * if outputs don't have tabs of their own. */
+static struct cg_output *
+resolve_output(struct cg_control_client *client, const char *arg)
 {
+	struct cg_server *server = client->control->server;
+	if (server->output_mode != WAYMUX_MULTI_OUTPUT_MODE_SEPARATE) {
+		reply_error(client, "Outputs aren't separate");
+		return NULL;
+	}
 	if (!arg || strlen(arg) == 0) {
-		control_client_send(client, "ERROR Missing tab index\n");
-		return;
+		reply_error(client, "Missing output");
+		return NULL;
 	}
 
-	char *endptr;
-	long tab_num = strtol(arg, &endptr, 10);
-	if (*endptr != '\0' || tab_num < 0) {
-		control_client_send(client, "ERROR Invalid tab index\n");
+	struct cg_output *output = output_from_name(server, arg);
+	if (!output) {
+		reply_error(client, "No such output");
+	}
+	return output;
+}
+
+static void
+handle_focus_output(struct cg_control_client *client, const char *arg)
+{
+	struct cg_output *output = resolve_output(client, arg);
+	if (!output) {
+		return;
+	}
+	if (!output->active_tab) {
+		reply_error(client, "No tab on that output");
 		return;
 	}
+	tab_activate(output->active_tab);
+	reply_ok(client, NULL);
+}
+
+/* Resolve a tab argument: a position as shown by list-tabs, or
+ * "id:ID" for the tab's stable ID. Replies with an error and returns
+ * NULL if there is no such tab. */
+static struct cg_tab *
+resolve_tab(struct cg_control_client *client, const char *arg)
+{
+	if (!arg || strlen(arg) == 0) {
+		reply_error(client, "Missing tab index");
+		return NULL;
+	}
 
 	struct cg_server *server = client->control->server;
-	int index = 0;
-	struct cg_tab *tab;
+	bool by_id = strncmp(arg, "id:", 3) == 0;
+	const char *number = by_id ? arg + 3 : arg;
 
-	wl_list_for_each(tab, &server->tabs, link) {
-		if (index == tab_num) {
-			tab_set_background(tab, true);
-			control_client_send(client, "OK\n");
-			return;
+	char *endptr;
+	errno = 0;
+	long long value = strtoll(number, &endptr, 10);
+	if (*number == '\0' || *endptr != '\0' || value < 0 || errno == ERANGE || (by_id && value > UINT32_MAX)) {
+		reply_error(client, by_id ? "Invalid tab ID" : "Invalid tab index");
+		return NULL;
+	}
+
+	if (by_id) {
+		struct cg_tab *tab = tab_from_id(server, (uint32_t)value);
+		if (!tab) {
+			reply_error(client, "No tab with that ID");
 		}
-		index++;
+		return tab;
 	}
 
-	control_client_send(client, "ERROR Tab index out of range\n");
+	struct cg_tab *tab = value < tab_count(server) ? tab_at(server, (int)value) : NULL;
+	if (!tab) {
+		reply_error(client, "Tab index out of range");
+	}
+	return tab;
 }
 
 static void
-handle_foreground_tab(struct cg_control_client *client, const char *arg)
+handle_focus_tab(struct cg_control_client *client, const char *arg)
 {
-	if (!arg || strlen(arg) == 0) {
-		control_client_send(client, "ERROR Missing tab index\n");
-		return;
+	struct cg_tab *tab = resolve_tab(client, arg);
+	if (tab) {
+		tab_activate(tab);
+		reply_ok(client, NULL);
 	}
+}
 
-	char *endptr;
-	long tab_num = strtol(arg, &endptr, 10);
-	if (*endptr != '\0' || tab_num < 0) {
-		control_client_send(client, "ERROR Invalid tab index\n");
+static void
+handle_close_tab(struct cg_control_client *client, const char *arg, bool force)
+{
+	struct cg_tab *tab = resolve_tab(client, arg);
+	if (!tab) {
 		return;
 	}
 
-	struct cg_server *server = client->control->server;
-	int index = 0;
-	struct cg_tab *tab;
-
-	wl_list_for_each(tab, &server->tabs, link) {
-		if (index == tab_num) {
-			tab_set_background(tab, false);
-			tab_activate(tab);
-			control_client_send(client, "OK\n");
-			return;
+	if (force) {
+		/* Kill the view */
+		if (tab->view && tab->view->impl && tab->view->impl->close) {
+			tab->view->impl->close(tab->view);
 		}
-		index++;
+	} else {
+		/* Graceful close */
+		tab_destroy(tab);
 	}
+	reply_ok(client, NULL);
+}
 
-	control_client_send(client, "ERROR Tab index out of range\n");
+static void
+handle_background_tab(struct cg_control_client *client, const char *arg)
+{
+	struct cg_tab *tab = resolve_tab(client, arg);
+	if (tab) {
+		tab_set_background(tab, true);
+		reply_ok(client, NULL);
+	}
+}
+
+static void
+handle_foreground_tab(struct cg_control_client *client, const char *arg)
+{
+	struct cg_tab *tab = resolve_tab(client, arg);
+	if (tab) {
+		tab_set_background(tab, false);
+		tab_activate(tab);
+		reply_ok(client, NULL);
+	}
+}
+
+/* "TAB OUTPUT": the output is the last word, as output names have no spaces */
+static void
+handle_send_to_output(struct cg_control_client *client, const char *arg)
+{
+	const char *space = strrchr(arg, ' ');
+	if (!space) {
+		reply_error(client, "Missing output");
+		return;
+	}
+	struct cg_output *output = resolve_output(client, space + 1);
+	if (!output) {
+		return;
+	}
+
+	char tab_arg[32];
+	size_t len = space - arg;
+	if (len >= sizeof(tab_arg)) {
+		reply_error(client, "Invalid tab index");
+		return;
+	}
+	memcpy(tab_arg, arg, len);
+	tab_arg[len] = '\0';
+	struct cg_tab *tab = resolve_tab(client, tab_arg);
+	if (tab) {
+		tab_set_output(tab, output);
+		reply_ok(client, NULL);
+	}
 }
 
 static void
@@ -245,155 +600,394 @@ handle_show_launcher(struct cg_control_client *client)
 {
 	struct cg_server *server = client->control->server;
 	launcher_show(server->launcher);
-	control_client_send(client, "OK\n");
+	reply_ok(client, NULL);
 }
 
 static void
-handle_new_tab(struct cg_control_client *client, const char *cmd)
+handle_reload_config(struct cg_control_client *client)
 {
-	if (!cmd || strlen(cmd) == 0) {
-		control_client_send(client, "ERROR Missing command\n");
+	if (!config_reload(client->control->server)) {
+		reply_error(client, "Failed to load configuration");
+		return;
+	}
+	reply_ok(client, NULL);
+}
+
+static void
+handle_save_session(struct cg_control_client *client, const char *name)
+{
+	char *path = session_path(name);
+	if (!path) {
+		reply_error(client, "No profiles directory");
 		return;
 	}
 
-	/* Parse command into argv */
-	char *cmd_copy = strdup(cmd);
-	if (!cmd_copy) {
-		control_client_send(client, "ERROR Out of memory\n");
+	int saved = session_save(client->control->server, path);
+	if (saved < 0) {
+		free(path);
+		reply_error(client, "Failed to save the session");
 		return;
 	}
 
-	/* Count arguments */
-	int argc = 0;
-	char *saveptr = NULL;
-	char *token = strtok_r(cmd_copy, " ", &saveptr);
-	while (token) {
-		argc++;
-		token = strtok_r(NULL, " ", &saveptr);
+	if (client->json) {
+		struct cg_control_buffer *reply = reply_start(client, true);
+		buffer_append(reply, ",\"path\":", 8);
+		buffer_append_json_string(reply, path);
+		buffer_appendf(reply, ",\"tabs\":%d", saved);
+		reply_finish(client);
+	} else {
+		reply_ok(client, path);
 	}
+	free(path);
+}
 
-	if (argc == 0) {
-		free(cmd_copy);
-		control_client_send(client, "ERROR Empty command\n");
+static void
+handle_action(struct cg_control_client *client, const char *name)
+{
+	struct action action;
+	if (!action_parse(name, &action)) {
+		reply_error(client, "Unknown action");
 		return;
 	}
+	if (!action_run(client->control->server, &action)) {
+		reply_error(client, "Nothing to do");
+		return;
+	}
+	reply_ok(client, NULL);
+}
+
+#if WAYMUX_HAS_STATS
+static void
+append_stats_json(struct cg_control_buffer *reply)
+{
+	const struct cg_stats *stats = stats_get();
+
+	buffer_append(reply, ",\"stats\":{", 10);
+	for (int i = 0; i < STATS_TIMER_COUNT; i++) {
+		const struct stats_timing *timing = &stats->timings[i];
+		buffer_appendf(reply, "\"%s\":{\"count\":%llu,\"last_ns\":%llu,\"total_ns\":%llu,\"max_ns\":%llu},",
+			       stats_timer_name(i), (unsigned long long)timing->count, (unsigned long long)timing->last_ns,
+			       (unsigned long long)timing->total_ns, (unsigned long long)timing->max_ns);
+	}
+
+	struct pixel_buffer_pool_stats pool;
+	pixel_buffer_pool_get_stats(&pool);
+	buffer_appendf(reply,
+		       "\"tab_bar_buttons\":%llu,\"pixel_buffers\":{\"allocated\":%llu,\"reused\":%llu,"
+		       "\"pooled_bytes\":%zu},\"control_commands\":%llu,\"control_per_second\":%.1f,"
+		       "\"memory\":{\"trims\":%llu,\"pressure_trims\":%llu,\"reclaimed_bytes\":%llu},\"first_frames\":[",
+		       (unsigned long long)stats->counters[STATS_TAB_BAR_BUTTONS], (unsigned long long)pool.misses,
+		       (unsigned long long)pool.hits, pool.pooled_bytes,
+		       (unsigned long long)stats->counters[STATS_CONTROL_COMMANDS], stats->control_per_second,
+		       (unsigned long long)stats->counters[STATS_MEMORY_TRIMS],
+		       (unsigned long long)stats->counters[STATS_MEMORY_PRESSURE],
+		       (unsigned long long)stats->counters[STATS_MEMORY_RECLAIMED]);
+
+	/* Most recent first, like the text report */
+	for (size_t age = 0; age < stats->first_frame_count; age++) {
+		size_t index = (stats->first_frame_next + STATS_FIRST_FRAMES - 1 - age) % STATS_FIRST_FRAMES;
+		buffer_appendf(reply, "%s{\"tab_id\":%u,\"ns\":%llu}", age > 0 ? "," : "",
+			       stats->first_frames[index].tab_id, (unsigned long long)stats->first_frames[index].ns);
+	}
+	buffer_append(reply, "]}", 2);
+}
+#endif
 
-	/* Allocate argv array */
-	char **argv = calloc(argc + 1, sizeof(char *));
+/* "stats" reports the counters, "stats hud" toggles the HUD */
+static void
+handle_stats(struct cg_control_client *client, const char *arg)
+{
+#if WAYMUX_HAS_STATS
+	if (strcmp(arg, "hud") == 0) {
+		stats_hud_toggle(client->control->server->stats_hud);
+		reply_ok(client, NULL);
+		return;
+	}
+	if (arg[0] != '\0') {
+		reply_error(client, "Unknown stats command");
+		return;
+	}
+
+	struct cg_control_buffer *reply = reply_start(client, true);
+	if (client->json) {
+		append_stats_json(reply);
+	} else {
+		size_t lines = stats_line_count();
+		buffer_appendf(reply, "OK %zu\n", lines);
+		for (size_t i = 0; i < lines; i++) {
+			char line[128];
+			stats_format_line(i, line, sizeof(line));
+			buffer_appendf(reply, "%s\n", line);
+		}
+	}
+	reply_finish(client);
+#else
+	(void)arg;
+	reply_error(client, "Not built with stats");
+#endif
+}
+
+static void
+handle_new_tab(struct cg_control_client *client, const char *cmd)
+{
+	if (!cmd || strlen(cmd) == 0) {
+		reply_error(client, "Missing command");
+		return;
+	}
+
+	char **argv = exec_line_argv(cmd, NULL);
 	if (!argv) {
-		free(cmd_copy);
-		control_client_send(client, "ERROR Out of memory\n");
+		reply_error(client, "Invalid command");
 		return;
 	}
 
-	/* Parse arguments again */
-	strcpy(cmd_copy, cmd);
-	token = strtok_r(cmd_copy, " ", &saveptr);
-	int i = 0;
-	while (token && i < argc) {
-		argv[i++] = token;
-		token = strtok_r(NULL, " ", &saveptr);
+	/* Point the client at this WayMux instance only: no inherited
+	 * WAYLAND_SOCKET connection and no direct X11 connection */
+	struct cg_spawn_env env;
+	if (!spawn_env_init(&env)) {
+		free(argv);
+		reply_error(client, "Out of memory");
+		return;
+	}
+	spawn_env_unset(&env, "WAYLAND_SOCKET");
+	spawn_env_unset(&env, "DISPLAY");
+
+	const char *socket = client->control->server->wl_display_socket;
+	if (!socket) {
+		wlr_log(WLR_ERROR, "WayMux socket name is NULL! Using parent display.");
+	} else if (!spawn_env_set(&env, "WAYLAND_DISPLAY", socket)) {
+		spawn_env_finish(&env);
+		free(argv);
+		reply_error(client, "Out of memory");
+		return;
 	}
-	argv[argc] = NULL;
 
-	/* Fork and exec the command */
-	pid_t pid = fork();
-	if (pid == 0) {
-		/* Child process */
-		sigset_t set;
-		sigemptyset(&set);
-		sigprocmask(SIG_SETMASK, &set, NULL);
+	wlr_log(WLR_DEBUG, "Executing: %s", argv[0]);
+	pid_t pid = resources_spawn(client->control->server->resources, NULL, argv, &env, NULL, NULL);
 
-		/* Clear WAYLAND_SOCKET to prevent inheriting parent's connection */
-		unsetenv("WAYLAND_SOCKET");
+	spawn_env_finish(&env);
+	free(argv);
 
-		/* Clear DISPLAY to prevent direct X11 connection */
-		unsetenv("DISPLAY");
+	if (pid < 0) {
+		reply_error(client, "Failed to start command");
+		return;
+	}
 
-		/* Set WAYLAND_DISPLAY to point to this WayMux instance */
-		const char *socket = client->control->server->wl_display_socket;
-		if (socket) {
-			wlr_log(WLR_DEBUG, "Setting WAYLAND_DISPLAY=%s for new tab", socket);
-			setenv("WAYLAND_DISPLAY", socket, 1);
+	wlr_log(WLR_DEBUG, "Started new tab process with pid %d", pid);
+	if (client->json) {
+		buffer_appendf(reply_start(client, true), ",\"pid\":%d", (int)pid);
+		reply_finish(client);
+	} else {
+		reply_ok(client, NULL);
+	}
+}
 
-			/* Verify it was set */
-			const char *verify = getenv("WAYLAND_DISPLAY");
-			wlr_log(WLR_DEBUG, "WAYLAND_DISPLAY is now: %s", verify ? verify : "(NULL)");
-		} else {
-			wlr_log(WLR_ERROR, "WayMux socket name is NULL! Using parent display.");
+/* Push a tab event to every subscribed client. Events never carry a
+ * request ID; in session mode they are terminated like responses. */
+static void
+broadcast_tab_event(struct cg_control_server *control, const char *type, struct cg_tab *tab)
+{
+	int index = tab_index(tab);
+	struct cg_control_buffer text = {0};
+	struct cg_control_buffer json = {0};
+
+	struct cg_control_client *client, *tmp;
+	wl_list_for_each_safe(client, tmp, &control->clients, link) {
+		if (!client->subscribed || client->events_overflowed) {
+			continue;
 		}
 
-		wlr_log(WLR_DEBUG, "Executing: %s", argv[0]);
-
-		/* Special handling for Firefox to prevent single-instance behavior */
-		if (strcmp(argv[0], "firefox") == 0 || strcmp(argv[0], "firefox-bin") == 0) {
-			/* Check if --new-instance is already in args */
-			bool has_new_instance = false;
-			for (int i = 1; argv[i] != NULL; i++) {
-				if (strcmp(argv[i], "--new-instance") == 0) {
-					has_new_instance = true;
-					break;
-				}
+		/* A subscriber that stopped reading is told once that it missed
+		 * events, and gets no more until it caught up and can resync */
+		if (client->output.len - client->output_sent > CONTROL_MAX_PENDING) {
+			wlr_log(WLR_ERROR, "Control client is not reading, dropping tab events until it catches up");
+			client->events_overflowed = true;
+			if (client->json_events) {
+				buffer_append(&client->output, "{\"event\":\"overflow\"}\n", 21);
+			} else {
+				buffer_append(&client->output, "EVENT overflow\n", 15);
 			}
+			if (client->session) {
+				buffer_append(&client->output, "\n", 1);
+			}
+			continue;
+		}
 
-			if (!has_new_instance) {
-				wlr_log(WLR_DEBUG, "Adding --new-instance flag for Firefox");
-				/* Create new argv with --new-instance inserted */
-				char **new_argv = calloc(argc + 2, sizeof(char *));
-				if (new_argv) {
-					new_argv[0] = argv[0];
-					new_argv[1] = "--new-instance";
-					for (int i = 1; argv[i] != NULL; i++) {
-						new_argv[i + 1] = argv[i];
-					}
-					execvp(argv[0], new_argv);
-					free(new_argv);
-				}
+		/* Each format is only built if someone wants it */
+		struct cg_control_buffer *event = client->json_events ? &json : &text;
+		if (event->len == 0 && !event->failed) {
+			if (client->json_events) {
+				buffer_appendf(event, "{\"event\":\"%s\",\"tab\":", type);
+				append_tab(event, control->server, tab, index, true, false);
+				buffer_append(event, "}\n", 2);
+			} else {
+				buffer_appendf(event, "EVENT %s ", type);
+				append_tab(event, control->server, tab, index, false, false);
 			}
 		}
+		if (event->failed) {
+			continue;
+		}
 
-		execvp(argv[0], argv);
-		/* execvp only returns on failure */
-		wlr_log_errno(WLR_ERROR, "execvp failed");
-		_exit(1);
-	} else if (pid < 0) {
-		free(cmd_copy);
-		free(argv);
-		control_client_send(client, "ERROR Failed to fork\n");
-		return;
+		buffer_append(&client->output, event->data, event->len);
+		if (client->session) {
+			buffer_append(&client->output, "\n", 1);
+		}
+		control_client_flush(client);
 	}
 
-	free(cmd_copy);
-	free(argv);
+	buffer_finish(&text);
+	buffer_finish(&json);
+}
 
-	wlr_log(WLR_DEBUG, "Started new tab process with pid %d", pid);
-	control_client_send(client, "OK\n");
+static void
+handle_tab_map(struct wl_listener *listener, void *data)
+{
+	struct cg_control_server *control = wl_container_of(listener, control, tab_map);
+	broadcast_tab_event(control, "map", data);
+}
+
+static void
+handle_tab_unmap(struct wl_listener *listener, void *data)
+{
+	struct cg_control_server *control = wl_container_of(listener, control, tab_unmap);
+	broadcast_tab_event(control, "unmap", data);
+}
+
+static void
+handle_tab_activate(struct wl_listener *listener, void *data)
+{
+	struct cg_control_server *control = wl_container_of(listener, control, tab_activate);
+	broadcast_tab_event(control, "activate", data);
+}
+
+static void
+handle_tab_title(struct wl_listener *listener, void *data)
+{
+	struct cg_control_server *control = wl_container_of(listener, control, tab_title);
+	broadcast_tab_event(control, "title", data);
+}
+
+static void
+handle_tab_background(struct wl_listener *listener, void *data)
+{
+	struct cg_control_server *control = wl_container_of(listener, control, tab_background);
+	struct cg_tab *tab = data;
+	broadcast_tab_event(control, tab->is_background ? "background" : "foreground", tab);
+}
+
+static void
+handle_tab_move(struct wl_listener *listener, void *data)
+{
+	struct cg_control_server *control = wl_container_of(listener, control, tab_move);
+	broadcast_tab_event(control, "move", data);
+}
+
+static void
+handle_subscribe(struct cg_control_client *client)
+{
+	struct cg_control_server *control = client->control;
+	struct cg_server *server = control->server;
+
+	if (!control->listening) {
+		control->tab_map.notify = handle_tab_map;
+		wl_signal_add(&server->events.tab_map, &control->tab_map);
+		control->tab_unmap.notify = handle_tab_unmap;
+		wl_signal_add(&server->events.tab_unmap, &control->tab_unmap);
+		control->tab_activate.notify = handle_tab_activate;
+		wl_signal_add(&server->events.tab_activate, &control->tab_activate);
+		control->tab_title.notify = handle_tab_title;
+		wl_signal_add(&server->events.tab_title, &control->tab_title);
+		control->tab_background.notify = handle_tab_background;
+		wl_signal_add(&server->events.tab_background, &control->tab_background);
+		control->tab_move.notify = handle_tab_move;
+		wl_signal_add(&server->events.tab_move, &control->tab_move);
+		control->listening = true;
+	}
+
+	/* The connection now stays open for events */
+	client->subscribed = true;
+	client->json_events = client->json;
+	reply_ok(client, "subscribed");
+}
+
+static void
+handle_session(struct cg_control_client *client)
+{
+	client->session = true;
+	reply_ok(client, "session");
 }
 
 static void
 process_command(struct cg_control_client *client, const char *command)
 {
+	/* An optional "@ID " prefix is echoed back with the response, so that
+	 * clients pipelining commands can match responses to requests */
+	client->request_id[0] = '\0';
+	client->json = false;
+	if (command[0] == '@') {
+		const char *space = strchr(command, ' ');
+		size_t id_len = space ? (size_t)(space - command - 1) : 0;
+		if (!space || id_len == 0 || id_len >= CONTROL_REQUEST_ID_MAX) {
+			reply_error(client, "Invalid request ID");
+			return;
+		}
+		memcpy(client->request_id, command + 1, id_len);
+		client->request_id[id_len] = '\0';
+		command = space + 1;
+	}
+
+	/* "--json" asks for the response as a single-line JSON object */
+	if (strncmp(command, "--json ", 7) == 0) {
+		client->json = true;
+		command += 7;
+	}
+
+	stats_control_command();
+
 	/* Parse command */
-	if (strcmp(command, "list-tabs") == 0) {
+	if (strcmp(command, "session") == 0) {
+		handle_session(client);
+	} else if (strcmp(command, "subscribe") == 0) {
+		handle_subscribe(client);
+	} else if (strcmp(command, "list-tabs") == 0) {
 		handle_list_tabs(client);
 	} else if (strncmp(command, "focus-tab ", 10) == 0) {
 		handle_focus_tab(client, command + 10);
+	} else if (strcmp(command, "list-outputs") == 0) {
+		handle_list_outputs(client);
+	} else if (strncmp(command, "focus-output ", 13) == 0) {
+		handle_focus_output(client, command + 13);
+	} else if (strncmp(command, "send-to-output ", 15) == 0) {
+		handle_send_to_output(client, command + 15);
 	} else if (strncmp(command, "close-tab ", 10) == 0) {
 		if (strncmp(command + 10, "--force ", 8) == 0) {
 			handle_close_tab(client, command + 18, true);
 		} else {
 			handle_close_tab(client, command + 10, false);
 		}
-	} else if (strncmp(command, "background ", 10) == 0) {
-		handle_background_tab(client, command + 10);
-	} else if (strncmp(command, "foreground ", 10) == 0) {
-		handle_foreground_tab(client, command + 10);
+	} else if (strncmp(command, "background ", 11) == 0) {
+		handle_background_tab(client, command + 11);
+	} else if (strncmp(command, "foreground ", 11) == 0) {
+		handle_foreground_tab(client, command + 11);
 	} else if (strncmp(command, "new-tab -- ", 10) == 0) {
 		handle_new_tab(client, command + 10);
 	} else if (strcmp(command, "show-launcher") == 0) {
 		handle_show_launcher(client);
+	} else if (strcmp(command, "reload-config") == 0) {
+		handle_reload_config(client);
+	} else if (strcmp(command, "save-session") == 0) {
+		handle_save_session(client, NULL);
+	} else if (strncmp(command, "save-session ", 13) == 0) {
+		handle_save_session(client, command + 13);
+	} else if (strncmp(command, "action ", 7) == 0) {
+		handle_action(client, command + 7);
+	} else if (strcmp(command, "stats") == 0) {
+		handle_stats(client, "");
+	} else if (strncmp(command, "stats ", 6) == 0) {
+		handle_stats(client, command + 6);
 	} else {
-		control_client_send(client, "ERROR Unknown command\n");
+		reply_error(client, "Unknown command");
 	}
 }
 
@@ -407,12 +1001,16 @@ control_client_destroy(struct cg_control_client *client)
 		close(client->fd);
 	}
 	wl_list_remove(&client->link);
+	buffer_finish(&client->reply);
+	buffer_finish(&client->output);
 	free(client);
 }
 
 static int
 handle_client_data(int fd, uint32_t mask, void *data)
 {
+	TRACE_SCOPE("handle_client_data");
+
 	struct cg_control_client *client = data;
 
 	if (mask & (WL_EVENT_ERROR | WL_EVENT_HANGUP)) {
@@ -420,6 +1018,13 @@ handle_client_data(int fd, uint32_t mask, void *data)
 		return 0;
 	}
 
+	if (mask & WL_EVENT_WRITABLE) {
+		control_client_flush(client);
+	}
+	if (!(mask & WL_EVENT_READABLE)) {
+		return 0;
+	}
+
 	/* Read data into buffer */
 	ssize_t n = read(fd, client->buffer + client->buffer_len,
 			CONTROL_BUFFER_SIZE - client->buffer_len);
@@ -626,6 +1231,15 @@ control_server_destroy(struct cg_control_server *control)
 		control_client_destroy(client);
 	}
 
+	if (control->listening) {
+		wl_list_remove(&control->tab_map.link);
+		wl_list_remove(&control->tab_unmap.link);
+		wl_list_remove(&control->tab_activate.link);
+		wl_list_remove(&control->tab_title.link);
+		wl_list_remove(&control->tab_background.link);
+		wl_list_remove(&control->tab_move.link);
+	}
+
 	if (control->event_source) {
 		wl_event_source_remove(control->event_source);
 	}
@@ -14,6 +14,15 @@ struct cg_control_server {
 	int socket_fd;
 	char *socket_path;
 	struct wl_list clients; // cg_control_client::link
+
+	/* Tab event listeners, added when the first client subscribes */
+	bool listening;
+	struct wl_listener tab_map;
+	struct wl_listener tab_unmap;
+	struct wl_listener tab_activate;
+	struct wl_listener tab_title;
+	struct wl_listener tab_background;
+	struct wl_listener tab_move;
 };
 
 /* Create control server and listen on Unix domain socket */
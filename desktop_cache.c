@@ -0,0 +1,454 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "desktop_cache.h"
+
+#include "desktop_entry.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+struct cg_desktop_cache *
+desktop_cache_open(const char *path)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct cg_desktop_cache_header)) {
+		close(fd);
+		return NULL;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		wlr_log_errno(WLR_ERROR, "Failed to map desktop entry cache %s", path);
+		return NULL;
+	}
+
+	const struct cg_desktop_cache_header *header = data;
+	size_t size = st.st_size;
+	size_t dirs_size = (size_t)header->dir_count * sizeof(struct cg_desktop_cache_dir);
+	size_t files_size = (size_t)header->file_count * sizeof(struct cg_desktop_cache_file);
+	size_t expected = sizeof(*header) + dirs_size + files_size + header->strings_size;
+
+	if (memcmp(header->magic, DESKTOP_CACHE_MAGIC, sizeof(DESKTOP_CACHE_MAGIC)) != 0 ||
+	    header->version != DESKTOP_CACHE_VERSION || expected != size || header->strings_size == 0 ||
+	    ((const char *)data)[size - 1] != '\0') {
+		wlr_log(WLR_INFO, "Ignoring stale or corrupt desktop entry cache %s", path);
+		munmap(data, size);
+		return NULL;
+	}
+
+	struct cg_desktop_cache *cache = calloc(1, sizeof(*cache));
+	if (!cache) {
+		munmap(data, size);
+		return NULL;
+	}
+
+	cache->data = data;
+	cache->size = size;
+	cache->header = header;
+	cache->dirs = (const struct cg_desktop_cache_dir *)(header + 1);
+	cache->files = (const struct cg_desktop_cache_file *)(cache->dirs + header->dir_count);
+	cache->strings = (const char *)(cache->files + header->file_count);
+	return cache;
+}
+
+void
+desktop_cache_close(struct cg_desktop_cache *cache)
+{
+	if (!cache) {
+		return;
+	}
+
+	munmap(cache->data, cache->size);
+	free(cache);
+}
+
+const char *
+desktop_cache_string(const struct cg_desktop_cache *cache, uint32_t offset)
+{
+	/* The string table is NUL-terminated (checked at open), so any
+	 * in-range offset yields a valid string */
+	if (offset == DESKTOP_CACHE_NO_STRING || offset >= cache->header->strings_size) {
+		return NULL;
+	}
+	return cache->strings + offset;
+}
+
+int
+desktop_cache_find_dir(const struct cg_desktop_cache *cache, const char *dir_path)
+{
+	for (uint32_t i = 0; i < cache->header->dir_count; i++) {
+		const char *path = desktop_cache_string(cache, cache->dirs[i].path);
+		if (path && strcmp(path, dir_path) == 0) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+void
+desktop_cache_dir_files(const struct cg_desktop_cache *cache, int dir, size_t *first, size_t *count)
+{
+	/* Files are sorted by directory: find the first record of dir */
+	size_t left = 0;
+	size_t right = cache->header->file_count;
+	while (left < right) {
+		size_t mid = left + (right - left) / 2;
+		if (cache->files[mid].dir < (uint32_t)dir) {
+			left = mid + 1;
+		} else {
+			right = mid;
+		}
+	}
+
+	size_t end = left;
+	while (end < cache->header->file_count && cache->files[end].dir == (uint32_t)dir) {
+		end++;
+	}
+
+	*first = left;
+	*count = end - left;
+}
+
+const struct cg_desktop_cache_file *
+desktop_cache_find_file(const struct cg_desktop_cache *cache, int dir, const char *file_name)
+{
+	size_t first, count;
+	desktop_cache_dir_files(cache, dir, &first, &count);
+
+	size_t left = first;
+	size_t right = first + count;
+	while (left < right) {
+		size_t mid = left + (right - left) / 2;
+		const char *name = desktop_cache_string(cache, cache->files[mid].file_name);
+		int cmp = strcmp(name ? name : "", file_name);
+		if (cmp == 0) {
+			return &cache->files[mid];
+		} else if (cmp < 0) {
+			left = mid + 1;
+		} else {
+			right = mid;
+		}
+	}
+	return NULL;
+}
+
+bool
+desktop_cache_dir_matches(const struct cg_desktop_cache *cache, int dir, const struct stat *st)
+{
+	const struct cg_desktop_cache_dir *record = &cache->dirs[dir];
+	return record->mtime_sec == (int64_t)st->st_mtim.tv_sec && record->mtime_nsec == (int64_t)st->st_mtim.tv_nsec;
+}
+
+bool
+desktop_cache_file_matches(const struct cg_desktop_cache_file *file, const struct stat *st)
+{
+	return file->mtime_sec == (int64_t)st->st_mtim.tv_sec && file->mtime_nsec == (int64_t)st->st_mtim.tv_nsec &&
+	       file->size == (int64_t)st->st_size;
+}
+
+bool
+desktop_cache_entry_fields(const struct cg_desktop_cache *cache, const struct cg_desktop_cache_file *file,
+			   struct cg_desktop_entry_fields *fields)
+{
+	if (!(file->flags & DESKTOP_CACHE_FILE_VALID)) {
+		return false;
+	}
+
+	memset(fields, 0, sizeof(*fields));
+	fields->name = desktop_cache_string(cache, file->name);
+	fields->exec = desktop_cache_string(cache, file->exec);
+	fields->icon = desktop_cache_string(cache, file->icon);
+	fields->categories = desktop_cache_string(cache, file->categories);
+	fields->generic_name = desktop_cache_string(cache, file->generic_name);
+	fields->keywords = desktop_cache_string(cache, file->keywords);
+	fields->nodisplay = file->flags & DESKTOP_CACHE_FILE_NODISPLAY;
+	return fields->name && fields->exec;
+}
+
+void
+desktop_cache_writer_init(struct cg_desktop_cache_writer *writer)
+{
+	memset(writer, 0, sizeof(*writer));
+}
+
+void
+desktop_cache_writer_finish(struct cg_desktop_cache_writer *writer)
+{
+	free(writer->dirs);
+	free(writer->files);
+	free(writer->strings);
+	free(writer->string_slots);
+	memset(writer, 0, sizeof(*writer));
+}
+
+/* Grow an array to hold at least needed more elements */
+static bool
+reserve(void **array, size_t *capacity, size_t count, size_t needed, size_t element_size)
+{
+	if (count + needed <= *capacity) {
+		return true;
+	}
+
+	size_t new_capacity = *capacity ? *capacity * 2 : 64;
+	while (new_capacity < count + needed) {
+		new_capacity *= 2;
+	}
+
+	void *new_array = realloc(*array, new_capacity * element_size);
+	if (!new_array) {
+		return false;
+	}
+	*array = new_array;
+	*capacity = new_capacity;
+	return true;
+}
+
+/* FNV-1a */
+static uint32_t
+hash_string(const char *str)
+{
+	uint32_t hash = 2166136261u;
+	for (; *str; str++) {
+		hash ^= (unsigned char)*str;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool
+grow_string_slots(struct cg_desktop_cache_writer *writer)
+{
+	size_t capacity = writer->slot_capacity ? writer->slot_capacity * 2 : 256;
+	uint32_t *slots = calloc(capacity, sizeof(*slots));
+	if (!slots) {
+		return false;
+	}
+
+	for (size_t i = 0; i < writer->slot_capacity; i++) {
+		if (writer->string_slots[i] == 0) {
+			continue;
+		}
+		size_t slot = hash_string(writer->strings + writer->string_slots[i] - 1) & (capacity - 1);
+		while (slots[slot]) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		slots[slot] = writer->string_slots[i];
+	}
+
+	free(writer->string_slots);
+	writer->string_slots = slots;
+	writer->slot_capacity = capacity;
+	return true;
+}
+
+static uint32_t
+add_string(struct cg_desktop_cache_writer *writer, const char *str)
+{
+	if (!str) {
+		return DESKTOP_CACHE_NO_STRING;
+	}
+
+	/* Directories, categories and the like are shared by many entries */
+	if ((writer->string_count + 1) * 2 > writer->slot_capacity && !grow_string_slots(writer)) {
+		writer->failed = true;
+		return DESKTOP_CACHE_NO_STRING;
+	}
+	size_t mask = writer->slot_capacity - 1;
+	size_t slot = hash_string(str) & mask;
+	while (writer->string_slots[slot]) {
+		uint32_t offset = writer->string_slots[slot] - 1;
+		if (strcmp(writer->strings + offset, str) == 0) {
+			return offset;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	size_t len = strlen(str) + 1;
+	if (!reserve((void **)&writer->strings, &writer->strings_capacity, writer->strings_size, len, 1) ||
+	    writer->strings_size + len >= DESKTOP_CACHE_NO_STRING) {
+		writer->failed = true;
+		return DESKTOP_CACHE_NO_STRING;
+	}
+
+	uint32_t offset = writer->strings_size;
+	memcpy(writer->strings + offset, str, len);
+	writer->strings_size += len;
+	writer->string_slots[slot] = offset + 1;
+	writer->string_count++;
+	return offset;
+}
+
+int
+desktop_cache_writer_add_dir(struct cg_desktop_cache_writer *writer, const char *dir_path, const struct stat *st)
+{
+	if (!reserve((void **)&writer->dirs, &writer->dir_capacity, writer->dir_count, 1, sizeof(*writer->dirs))) {
+		writer->failed = true;
+		return -1;
+	}
+
+	struct cg_desktop_cache_dir *dir = &writer->dirs[writer->dir_count];
+	memset(dir, 0, sizeof(*dir));
+	dir->path = add_string(writer, dir_path);
+	dir->mtime_sec = st->st_mtim.tv_sec;
+	dir->mtime_nsec = st->st_mtim.tv_nsec;
+	return (int)writer->dir_count++;
+}
+
+void
+desktop_cache_writer_add_file(struct cg_desktop_cache_writer *writer, int dir, const char *file_name,
+			      const struct stat *st, const struct cg_desktop_entry *entry)
+{
+	if (dir < 0) {
+		return;
+	}
+	if (!reserve((void **)&writer->files, &writer->file_capacity, writer->file_count, 1, sizeof(*writer->files))) {
+		writer->failed = true;
+		return;
+	}
+
+	struct cg_desktop_cache_file *file = &writer->files[writer->file_count++];
+	memset(file, 0, sizeof(*file));
+	file->dir = dir;
+	file->mtime_sec = st->st_mtim.tv_sec;
+	file->mtime_nsec = st->st_mtim.tv_nsec;
+	file->size = st->st_size;
+	file->file_name = add_string(writer, file_name);
+	file->name = file->exec = file->icon = DESKTOP_CACHE_NO_STRING;
+	file->categories = file->generic_name = file->keywords = DESKTOP_CACHE_NO_STRING;
+
+	if (entry) {
+		file->flags = DESKTOP_CACHE_FILE_VALID;
+		if (entry->nodisplay) {
+			file->flags |= DESKTOP_CACHE_FILE_NODISPLAY;
+		}
+		file->name = add_string(writer, entry->name);
+		file->exec = add_string(writer, entry->exec);
+		file->icon = add_string(writer, entry->icon);
+		file->categories = add_string(writer, entry->categories);
+		file->generic_name = add_string(writer, entry->generic_name);
+		file->keywords = add_string(writer, entry->keywords);
+	}
+}
+
+struct sort_key {
+	uint32_t dir;
+	const char *name;
+	size_t index;
+};
+
+static int
+compare_sort_keys(const void *a, const void *b)
+{
+	const struct sort_key *ka = a;
+	const struct sort_key *kb = b;
+	if (ka->dir != kb->dir) {
+		return ka->dir < kb->dir ? -1 : 1;
+	}
+	return strcmp(ka->name, kb->name);
+}
+
+/* Create any missing parent directories of path */
+static void
+create_parent_dirs(const char *path)
+{
+	char dir[4096];
+	snprintf(dir, sizeof(dir), "%s", path);
+	for (char *p = dir + 1; *p; p++) {
+		if (*p == '/') {
+			*p = '\0';
+			mkdir(dir, 0700);
+			*p = '/';
+		}
+	}
+}
+
+int
+desktop_cache_writer_write(struct cg_desktop_cache_writer *writer, const char *path)
+{
+	if (writer->failed) {
+		return -1;
+	}
+
+	/* The string table must be non-empty and end with a NUL */
+	if (writer->strings_size == 0) {
+		add_string(writer, "");
+	}
+
+	struct sort_key *keys = NULL;
+	if (writer->file_count > 0) {
+		keys = malloc(sizeof(*keys) * writer->file_count);
+		if (!keys) {
+			return -1;
+		}
+	}
+	for (size_t i = 0; i < writer->file_count; i++) {
+		keys[i].dir = writer->files[i].dir;
+		keys[i].name = writer->strings + writer->files[i].file_name;
+		keys[i].index = i;
+	}
+	if (keys) {
+		qsort(keys, writer->file_count, sizeof(*keys), compare_sort_keys);
+	}
+
+	create_parent_dirs(path);
+
+	char tmp_path[4096];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid());
+	FILE *f = fopen(tmp_path, "wb");
+	if (!f) {
+		wlr_log_errno(WLR_ERROR, "Failed to create desktop entry cache %s", tmp_path);
+		free(keys);
+		return -1;
+	}
+
+	struct cg_desktop_cache_header header = {0};
+	memcpy(header.magic, DESKTOP_CACHE_MAGIC, sizeof(DESKTOP_CACHE_MAGIC));
+	header.version = DESKTOP_CACHE_VERSION;
+	header.dir_count = writer->dir_count;
+	header.file_count = writer->file_count;
+	header.strings_size = writer->strings_size;
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	if (ok && writer->dir_count > 0) {
+		ok = fwrite(writer->dirs, sizeof(*writer->dirs), writer->dir_count, f) == writer->dir_count;
+	}
+	for (size_t i = 0; ok && i < writer->file_count; i++) {
+		ok = fwrite(&writer->files[keys[i].index], sizeof(*writer->files), 1, f) == 1;
+	}
+	if (ok) {
+		ok = fwrite(writer->strings, 1, writer->strings_size, f) == writer->strings_size;
+	}
+	free(keys);
+
+	if (fclose(f) != 0) {
+		ok = false;
+	}
+	if (!ok || rename(tmp_path, path) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to write desktop entry cache %s", path);
+		unlink(tmp_path);
+		return -1;
+	}
+
+	wlr_log(WLR_DEBUG, "Wrote desktop entry cache %s (%zu files)", path, writer->file_count);
+	return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_DESKTOP_CACHE_H
+#define CG_DESKTOP_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define DESKTOP_CACHE_MAGIC "WMXDESK"
+#define DESKTOP_CACHE_VERSION 1
+#define DESKTOP_CACHE_NO_STRING UINT32_MAX
+
+struct cg_desktop_entry;
+struct cg_desktop_entry_fields;
+
+/*
+ * On-disk layout. The file is a header, followed by the directory records,
+ * the file records and a string table; all strings are stored as offsets
+ * into the string table, and equal strings are stored once, like in the
+ * arena the entries are loaded into. File records are sorted by (dir,
+ * name) so a directory's files are contiguous and can be binary searched.
+ */
+struct cg_desktop_cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t dir_count;
+	uint32_t file_count;
+	uint32_t strings_size;
+};
+
+struct cg_desktop_cache_dir {
+	uint32_t path;
+	uint32_t pad;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+};
+
+/* A .desktop file; files that failed to parse are recorded too, so that
+ * they are not re-read on every start */
+#define DESKTOP_CACHE_FILE_VALID (1u << 0)
+#define DESKTOP_CACHE_FILE_NODISPLAY (1u << 1)
+
+struct cg_desktop_cache_file {
+	uint32_t dir;
+	uint32_t flags;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	int64_t size;
+	uint32_t file_name;
+	uint32_t name;
+	uint32_t exec;
+	uint32_t icon;
+	uint32_t categories;
+	uint32_t generic_name;
+	uint32_t keywords;
+	uint32_t pad;
+};
+
+/* A read-only, memory-mapped cache file */
+struct cg_desktop_cache {
+	void *data;
+	size_t size;
+	const struct cg_desktop_cache_header *header;
+	const struct cg_desktop_cache_dir *dirs;
+	const struct cg_desktop_cache_file *files;
+	const char *strings;
+};
+
+/* Accumulates the records for a new cache file */
+struct cg_desktop_cache_writer {
+	struct cg_desktop_cache_dir *dirs;
+	size_t dir_count, dir_capacity;
+	struct cg_desktop_cache_file *files;
+	size_t file_count, file_capacity;
+	char *strings;
+	size_t strings_size, strings_capacity;
+	uint32_t *string_slots;  /* Offsets + 1 of the strings, open addressing */
+	size_t string_count, slot_capacity;
+	bool failed;
+};
+
+/**
+ * Map and validate a cache file. Returns NULL if the file is missing,
+ * truncated or from another version.
+ */
+struct cg_desktop_cache *desktop_cache_open(const char *path);
+
+/**
+ * Unmap a cache file. NULL-safe.
+ */
+void desktop_cache_close(struct cg_desktop_cache *cache);
+
+/**
+ * Find the record of a directory, or -1 if it isn't in the cache.
+ */
+int desktop_cache_find_dir(const struct cg_desktop_cache *cache, const char *dir_path);
+
+/**
+ * Find the record of a file within a cached directory, or NULL.
+ */
+const struct cg_desktop_cache_file *desktop_cache_find_file(const struct cg_desktop_cache *cache, int dir,
+							    const char *file_name);
+
+/**
+ * Get the range of file records belonging to a cached directory.
+ */
+void desktop_cache_dir_files(const struct cg_desktop_cache *cache, int dir, size_t *first, size_t *count);
+
+/**
+ * Check whether a cached directory or file record still matches the
+ * mtime (and for files, the size) reported by stat().
+ */
+bool desktop_cache_dir_matches(const struct cg_desktop_cache *cache, int dir, const struct stat *st);
+bool desktop_cache_file_matches(const struct cg_desktop_cache_file *file, const struct stat *st);
+
+/**
+ * Get a string from the cache's string table, or NULL for absent strings.
+ */
+const char *desktop_cache_string(const struct cg_desktop_cache *cache, uint32_t offset);
+
+/**
+ * Fill in the fields of the entry of a valid cached file record, except
+ * desktop_file. The strings point into the cache, so they are only valid
+ * until it is closed. Returns false for files that failed to parse.
+ */
+bool desktop_cache_entry_fields(const struct cg_desktop_cache *cache, const struct cg_desktop_cache_file *file,
+				struct cg_desktop_entry_fields *fields);
+
+void desktop_cache_writer_init(struct cg_desktop_cache_writer *writer);
+void desktop_cache_writer_finish(struct cg_desktop_cache_writer *writer);
+
+/**
+ * Add a directory; returns its index for desktop_cache_writer_add_file().
+ */
+int desktop_cache_writer_add_dir(struct cg_desktop_cache_writer *writer, const char *dir_path,
+				 const struct stat *st);
+
+/**
+ * Add a file of a directory. entry is NULL if the file failed to parse.
+ */
+void desktop_cache_writer_add_file(struct cg_desktop_cache_writer *writer, int dir, const char *file_name,
+				   const struct stat *st, const struct cg_desktop_entry *entry);
+
+/**
+ * Write the cache atomically (through a temporary file and rename),
+ * creating the parent directory if needed. Returns 0 on success.
+ */
+int desktop_cache_writer_write(struct cg_desktop_cache_writer *writer, const char *path);
+
+#endif
@@ -1,16 +1,37 @@
 #include "config.h"
 #include "desktop_entry.h"
+#include "desktop_cache.h"
+#include "exec_line.h"
+#include "search.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <ctype.h>
 #include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <linux/limits.h>
 #include <unistd.h>
 #include <wlr/util/log.h>
 
+/* Larger files are not desktop entries anyone wrote */
+#define DESKTOP_FILE_MAX_SIZE (1024 * 1024)
+
+/* Wait after inotify events are lost, so that the rest of a burst of
+ * changes is rescanned once */
+#define WATCH_RESCAN_DELAY_MS 200
+
+#define WATCH_DIR_MASK (IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+/* Added to the nearest existing ancestor of a missing directory, which
+ * may be watched for its own sake already */
+#define WATCH_PARENT_MASK (IN_CREATE | IN_MOVED_TO | IN_ONLYDIR | IN_MASK_ADD)
+
 /* XDG data directories to search */
 static const char *xdg_data_dirs[] = {
 	"/usr/share/applications",
@@ -53,58 +74,280 @@ get_xdg_data_home(void)
 	return NULL;
 }
 
-/* Trim whitespace from string (in-place) */
-static void
+/* Trim whitespace from a string in place, returning its new start */
+static char *
 trim_whitespace(char *str)
 {
-	if (!str || str[0] == '\0') {
-		return;
+	while (*str == ' ' || *str == '\t' || *str == '\r') {
+		str++;
+	}
+
+	char *end = str + strlen(str);
+	while (end > str && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+		end--;
 	}
+	*end = '\0';
+	return str;
+}
 
-	/* Trim leading whitespace */
-	char *start = str;
-	while (*start == ' ' || *start == '\t' || *start == '\n' || *start == '\r') {
-		start++;
+/* Grow an array of entries to hold at least needed more */
+static bool
+entry_array_reserve(struct cg_desktop_entry_array *array, size_t needed)
+{
+	if (array->count + needed <= array->capacity) {
+		return true;
 	}
 
-	if (start != str) {
-		memmove(str, start, strlen(start) + 1);
+	size_t capacity = array->capacity ? array->capacity * 2 : 64;
+	while (capacity < array->count + needed) {
+		capacity *= 2;
 	}
 
-	/* Trim trailing whitespace */
-	char *end = str + strlen(str) - 1;
-	while (end >= str && (*end == ' ' || *end == '\t' || *end == '\n' || *end == '\r')) {
-		end--;
+	struct cg_desktop_entry *entries = realloc(array->entries, sizeof(*entries) * capacity);
+	if (!entries) {
+		return false;
+	}
+	array->entries = entries;
+	array->capacity = capacity;
+	return true;
+}
+
+/* Copy an optional string into an entry's block of strings */
+static const char *
+block_copy(char **pos, const char *str, size_t len)
+{
+	if (!str) {
+		return NULL;
 	}
-	*(end + 1) = '\0';
+	char *copy = *pos;
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	*pos += len + 1;
+	return copy;
 }
 
-/* Parse a single .desktop file */
+#define OPTIONAL_LEN(str) ((str) ? strlen(str) : 0)
+
+/* Add an entry to an array. Its own strings are allocated as one block,
+ * the lowercased search fields first, so that a search only touches the
+ * start of each block, and the argv to launch it last; the directory and
+ * the categories are interned. Entries whose Exec can't be parsed are
+ * not added. */
 static struct cg_desktop_entry *
-parse_desktop_file(const char *path)
+entry_array_add(struct cg_desktop_entry_array *array, const struct cg_desktop_entry_fields *fields)
+{
+	if (!fields->name || !fields->exec || !entry_array_reserve(array, 1)) {
+		return NULL;
+	}
+
+	const char *file_name = NULL;
+	size_t dir_len = 0;
+	if (fields->desktop_file) {
+		const char *slash = strrchr(fields->desktop_file, '/');
+		file_name = slash ? slash + 1 : fields->desktop_file;
+		dir_len = slash ? (size_t)(slash - fields->desktop_file) : 0;
+	}
+
+	size_t name_len = strlen(fields->name);
+	size_t exec_len = strlen(fields->exec);
+	size_t icon_len = OPTIONAL_LEN(fields->icon);
+	size_t generic_len = OPTIONAL_LEN(fields->generic_name);
+	size_t keywords_len = OPTIONAL_LEN(fields->keywords);
+	size_t file_len = OPTIONAL_LEN(file_name);
+
+	/* Generic name and keywords are searched as one string, with a
+	 * separator that no query character matches across */
+	size_t extra_len = generic_len + 1 + keywords_len;
+
+	struct cg_exec_line_fields exec_fields = {
+		.name = fields->name,
+		.icon = fields->icon,
+		.desktop_file = fields->desktop_file,
+	};
+	size_t argv_size = exec_line_parse(fields->exec, &exec_fields, NULL, 0);
+	if (argv_size == 0) {
+		wlr_log(WLR_DEBUG, "Invalid Exec for %s: %s", fields->name, fields->exec);
+		return NULL;
+	}
+
+	size_t strings_size = (name_len + 1) + (extra_len + 1) + (name_len + 1) + (exec_len + 1) +
+			      (fields->icon ? icon_len + 1 : 0) + (fields->generic_name ? generic_len + 1 : 0) +
+			      (fields->keywords ? keywords_len + 1 : 0) + (file_name ? file_len + 1 : 0);
+	size_t argv_offset = (strings_size + sizeof(char *) - 1) & ~(sizeof(char *) - 1);
+	size_t size = argv_offset + argv_size;
+	char *block = string_arena_alloc_aligned(&array->strings, size, sizeof(char *));
+	if (!block) {
+		return NULL;
+	}
+
+	struct cg_desktop_entry *entry = &array->entries[array->count];
+	memset(entry, 0, sizeof(*entry));
+	entry->strings_size = size;
+	entry->nodisplay = fields->nodisplay;
+
+	char *pos = block;
+	char *search_name = pos;
+	entry->search_name = block_copy(&pos, fields->name, name_len);
+	char *search_extra = pos;
+	pos += snprintf(pos, extra_len + 1, "%s;%s", fields->generic_name ? fields->generic_name : "",
+			fields->keywords ? fields->keywords : "") + 1;
+	entry->search_extra = search_extra;
+	for (char *c = search_name; c < pos; c++) {
+		*c = tolower((unsigned char)*c);
+	}
+	entry->char_mask = search_mask(entry->search_name) | search_mask(entry->search_extra);
+
+	entry->name = block_copy(&pos, fields->name, name_len);
+	entry->exec = block_copy(&pos, fields->exec, exec_len);
+	entry->icon = block_copy(&pos, fields->icon, icon_len);
+	entry->generic_name = block_copy(&pos, fields->generic_name, generic_len);
+	entry->keywords = block_copy(&pos, fields->keywords, keywords_len);
+	entry->file_name = block_copy(&pos, file_name, file_len);
+
+	exec_line_parse(fields->exec, &exec_fields, block + argv_offset, argv_size);
+	entry->argv = (char *const *)(block + argv_offset);
+
+	if (file_name) {
+		entry->dir = string_arena_intern(&array->strings, fields->desktop_file, dir_len);
+	}
+	if (fields->categories) {
+		entry->categories =
+			string_arena_intern(&array->strings, fields->categories, strlen(fields->categories));
+	}
+
+	array->count++;
+	return entry;
+}
+
+/* Remove an entry, moving the last one into its place */
+static void
+entry_array_remove(struct cg_desktop_entry_array *array, size_t i)
+{
+	array->dead_bytes += array->entries[i].strings_size;
+	array->count--;
+	if (i != array->count) {
+		array->entries[i] = array->entries[array->count];
+	}
+}
+
+/* Move every entry of src to the end of dest, leaving src empty */
+static bool
+entry_array_append(struct cg_desktop_entry_array *dest, struct cg_desktop_entry_array *src)
+{
+	if (src->count > 0) {
+		if (!entry_array_reserve(dest, src->count)) {
+			return false;
+		}
+		memcpy(dest->entries + dest->count, src->entries, sizeof(*src->entries) * src->count);
+		dest->count += src->count;
+	}
+
+	string_arena_adopt(&dest->strings, &src->strings);
+	dest->dead_bytes += src->dead_bytes;
+	free(src->entries);
+	memset(src, 0, sizeof(*src));
+	return true;
+}
+
+static void
+entry_array_finish(struct cg_desktop_entry_array *array)
+{
+	free(array->entries);
+	string_arena_finish(&array->strings);
+	memset(array, 0, sizeof(*array));
+}
+
+static void
+entry_fields(const struct cg_desktop_entry *entry, struct cg_desktop_entry_fields *fields, char *path,
+	     size_t path_size)
+{
+	fields->name = entry->name;
+	fields->exec = entry->exec;
+	fields->icon = entry->icon;
+	fields->generic_name = entry->generic_name;
+	fields->keywords = entry->keywords;
+	fields->categories = entry->categories;
+	fields->desktop_file = desktop_entry_path(entry, path, path_size) ? path : NULL;
+	fields->nodisplay = entry->nodisplay;
+}
+
+/* Copy the entries into a fresh arena once removed entries' strings make
+ * up most of it. Entries keep their positions. */
+static void
+entry_array_compact(struct cg_desktop_entry_array *array)
+{
+	if (array->dead_bytes < STRING_ARENA_CHUNK_SIZE || array->dead_bytes * 2 < array->strings.size) {
+		return;
+	}
+
+	struct cg_desktop_entry_array compacted = {0};
+	string_arena_init(&compacted.strings);
+	if (!entry_array_reserve(&compacted, array->count)) {
+		return;
+	}
+
+	char path[PATH_MAX];
+	for (size_t i = 0; i < array->count; i++) {
+		struct cg_desktop_entry_fields fields;
+		entry_fields(&array->entries[i], &fields, path, sizeof(path));
+		if (!entry_array_add(&compacted, &fields)) {
+			entry_array_finish(&compacted);
+			return;
+		}
+	}
+
+	wlr_log(WLR_DEBUG, "Compacted desktop entry strings from %zu to %zu bytes", array->strings.size,
+		compacted.strings.size);
+	entry_array_finish(array);
+	*array = compacted;
+}
+
+/* Read a whole file into a NUL-terminated buffer */
+static char *
+read_file(const char *path)
 {
 	FILE *f = fopen(path, "r");
 	if (!f) {
 		return NULL;
 	}
 
-	struct cg_desktop_entry *entry = calloc(1, sizeof(struct cg_desktop_entry));
-	if (!entry) {
+	struct stat st;
+	if (fstat(fileno(f), &st) != 0 || st.st_size > DESKTOP_FILE_MAX_SIZE) {
+		fclose(f);
+		return NULL;
+	}
+
+	char *data = malloc(st.st_size + 1);
+	if (!data) {
 		fclose(f);
 		return NULL;
 	}
+	size_t len = fread(data, 1, st.st_size, f);
+	data[len] = '\0';
+	fclose(f);
+	return data;
+}
 
-	entry->desktop_file = strdup(path);
-	entry->nodisplay = false;
+/* Parse a single .desktop file into an array */
+static struct cg_desktop_entry *
+parse_desktop_file(struct cg_desktop_entry_array *array, const char *path)
+{
+	/* Parsed in place: values point into the file's contents until
+	 * they are copied into the array */
+	char *data = read_file(path);
+	if (!data) {
+		return NULL;
+	}
 
-	char line[1024];
+	struct cg_desktop_entry_fields fields = {0};
+	fields.desktop_file = path;
 	bool in_desktop_entry = false;
 
-	while (fgets(line, sizeof(line), f)) {
-		/* Remove newline */
-		size_t len = strlen(line);
-		if (len > 0 && line[len - 1] == '\n') {
-			line[len - 1] = '\0';
+	char *next;
+	for (char *line = data; line; line = next) {
+		next = strchr(line, '\n');
+		if (next) {
+			*next++ = '\0';
 		}
 
 		/* Skip empty lines and comments */
@@ -135,52 +378,148 @@ parse_desktop_file(const char *path)
 		}
 
 		*equals = '\0';
-		char *key = line;
-		char *value = equals + 1;
-
-		trim_whitespace(key);
-		trim_whitespace(value);
+		char *key = trim_whitespace(line);
+		char *value = trim_whitespace(equals + 1);
 
 		/* Extract relevant fields */
-		if (strcmp(key, "Name") == 0 && !entry->name) {
-			entry->name = strdup(value);
-		} else if (strcmp(key, "Exec") == 0 && !entry->exec) {
-			entry->exec = strdup(value);
-		} else if (strcmp(key, "Icon") == 0 && !entry->icon) {
-			entry->icon = strdup(value);
-		} else if (strcmp(key, "Categories") == 0 && !entry->categories) {
-			entry->categories = strdup(value);
+		if (strcmp(key, "Name") == 0 && !fields.name) {
+			fields.name = value;
+		} else if (strcmp(key, "Exec") == 0 && !fields.exec) {
+			fields.exec = value;
+		} else if (strcmp(key, "Icon") == 0 && !fields.icon) {
+			fields.icon = value;
+		} else if (strcmp(key, "Categories") == 0 && !fields.categories) {
+			fields.categories = value;
+		} else if (strcmp(key, "GenericName") == 0 && !fields.generic_name) {
+			fields.generic_name = value;
+		} else if (strcmp(key, "Keywords") == 0 && !fields.keywords) {
+			fields.keywords = value;
 		} else if (strcmp(key, "NoDisplay") == 0) {
 			if (strcmp(value, "true") == 0) {
-				entry->nodisplay = true;
+				fields.nodisplay = true;
 			}
 		}
 	}
 
-	fclose(f);
-
 	/* Validate: must have at least Name and Exec */
-	if (!entry->name || !entry->exec) {
-		desktop_entry_destroy(entry);
-		return NULL;
+	struct cg_desktop_entry *entry = NULL;
+	if (fields.name && fields.exec) {
+		entry = entry_array_add(array, &fields);
 	}
+	free(data);
 
-	wlr_log(WLR_DEBUG, "Parsed desktop entry: %s from %s", entry->name, path);
+	if (entry) {
+		wlr_log(WLR_DEBUG, "Parsed desktop entry: %s from %s", entry->name, path);
+	}
 	return entry;
 }
 
+/* Loads desktop entries on a worker thread, handing each directory's
+ * entries to the event loop through an eventfd */
+struct cg_desktop_entry_loader {
+	pthread_t thread;
+	int event_fd;
+	struct wl_event_source *event_source;
+	char **dirs;
+	char *cache_path;
+	atomic_bool cancel;
+
+	/* Protected by lock */
+	pthread_mutex_t lock;
+	struct cg_desktop_entry_array pending;  /* Entries not yet handed over */
+	bool done;
+	size_t files_parsed;
+	size_t files_from_cache;
+};
+
+/* State shared by the directory scans of one load */
+struct load_state {
+	struct cg_desktop_cache *cache;
+	struct cg_desktop_cache_writer writer;
+	bool changed;           /* Cache needs rewriting */
+	struct cg_desktop_entry_array *target;  /* Where loaded entries go */
+	struct cg_desktop_entry_loader *loader;  /* NULL for a synchronous load */
+	size_t files_parsed;
+	size_t files_from_cache;
+};
+
+/* Load one .desktop file, from the cache if it is unchanged since */
+static void
+load_desktop_file(struct load_state *state, const char *dir_path,
+		  const char *file_name, const struct cg_desktop_cache_file *record, int writer_dir)
+{
+	/* Construct full path */
+	char full_path[PATH_MAX];
+	snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, file_name);
+
+	struct stat st;
+	if (stat(full_path, &st) != 0 || !S_ISREG(st.st_mode)) {
+		state->changed = true;
+		return;
+	}
+
+	/* Added to the target, and valid until the next entry is */
+	struct cg_desktop_entry *desktop_entry = NULL;
+	struct cg_desktop_entry_fields fields;
+	if (record && desktop_cache_file_matches(record, &st)) {
+		if (desktop_cache_entry_fields(state->cache, record, &fields)) {
+			fields.desktop_file = full_path;
+			desktop_entry = entry_array_add(state->target, &fields);
+		}
+		state->files_from_cache++;
+	} else {
+		/* Parse the desktop file */
+		desktop_entry = parse_desktop_file(state->target, full_path);
+		state->files_parsed++;
+		state->changed = true;
+	}
+
+	desktop_cache_writer_add_file(&state->writer, writer_dir, file_name, &st, desktop_entry);
+}
+
+static bool
+load_cancelled(struct load_state *state)
+{
+	return state->loader && atomic_load(&state->loader->cancel);
+}
+
 /* Scan a directory for .desktop files */
 static void
-scan_applications_directory(struct cg_desktop_entry_manager *manager, const char *dir_path)
+scan_applications_directory(struct load_state *state, const char *dir_path)
 {
+	struct stat dir_st;
+	if (stat(dir_path, &dir_st) != 0 || !S_ISDIR(dir_st.st_mode)) {
+		/* Not an error - directory might not exist */
+		return;
+	}
+
+	int cached_dir = state->cache ? desktop_cache_find_dir(state->cache, dir_path) : -1;
+	int writer_dir = desktop_cache_writer_add_dir(&state->writer, dir_path, &dir_st);
+
+	/* An unchanged directory mtime means no file was added, removed or
+	 * renamed, so the cached file list can be used without a readdir */
+	if (cached_dir >= 0 && desktop_cache_dir_matches(state->cache, cached_dir, &dir_st)) {
+		size_t first, count;
+		desktop_cache_dir_files(state->cache, cached_dir, &first, &count);
+		for (size_t i = first; i < first + count && !load_cancelled(state); i++) {
+			const struct cg_desktop_cache_file *record = &state->cache->files[i];
+			const char *file_name = desktop_cache_string(state->cache, record->file_name);
+			if (file_name) {
+				load_desktop_file(state, dir_path, file_name, record, writer_dir);
+			}
+		}
+		return;
+	}
+
+	state->changed = true;
+
 	DIR *dir = opendir(dir_path);
 	if (!dir) {
-		/* Not an error - directory might not exist */
 		return;
 	}
 
 	struct dirent *entry;
-	while ((entry = readdir(dir)) != NULL) {
+	while (!load_cancelled(state) && (entry = readdir(dir)) != NULL) {
 		/* Skip hidden files and non-.desktop files */
 		if (entry->d_name[0] == '.') {
 			continue;
@@ -191,19 +530,38 @@ scan_applications_directory(struct cg_desktop_entry_manager *manager, const char
 			continue;
 		}
 
-		/* Construct full path */
-		char full_path[PATH_MAX];
-		snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+		const struct cg_desktop_cache_file *record =
+			cached_dir >= 0 ? desktop_cache_find_file(state->cache, cached_dir, entry->d_name) : NULL;
+		load_desktop_file(state, dir_path, entry->d_name, record, writer_dir);
+	}
+
+	closedir(dir);
+}
 
-		/* Parse the desktop file */
-		struct cg_desktop_entry *desktop_entry = parse_desktop_file(full_path);
-		if (desktop_entry) {
-			/* Add to entries list */
-			wl_list_insert(&manager->entries, &desktop_entry->link);
+/* Get the cache file path ($XDG_CACHE_HOME/waymux/desktop-entries.cache) */
+static char *
+get_cache_path(void)
+{
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	char *path = NULL;
+	size_t len;
+
+	if (cache_home && cache_home[0] == '/') {
+		len = strlen(cache_home) + strlen("/waymux/desktop-entries.cache") + 1;
+		path = malloc(len);
+		if (path) {
+			snprintf(path, len, "%s/waymux/desktop-entries.cache", cache_home);
+		}
+	} else if (home && home[0] != '\0') {
+		len = strlen(home) + strlen("/.cache/waymux/desktop-entries.cache") + 1;
+		path = malloc(len);
+		if (path) {
+			snprintf(path, len, "%s/.cache/waymux/desktop-entries.cache", home);
 		}
 	}
 
-	closedir(dir);
+	return path;
 }
 
 struct cg_desktop_entry_manager *
@@ -215,11 +573,16 @@ desktop_entry_manager_create(void)
 		return NULL;
 	}
 
-	wl_list_init(&manager->entries);
+	string_arena_init(&manager->entries.strings);
+	wl_signal_init(&manager->events.changed);
 	wlr_log(WLR_DEBUG, "Desktop entry manager created");
 	return manager;
 }
 
+static void loader_destroy(struct cg_desktop_entry_loader *loader);
+static void watch_destroy(struct cg_desktop_entry_watch *watch);
+static void watch_process_deferred(struct cg_desktop_entry_manager *manager);
+
 void
 desktop_entry_manager_destroy(struct cg_desktop_entry_manager *manager)
 {
@@ -227,116 +590,1103 @@ desktop_entry_manager_destroy(struct cg_desktop_entry_manager *manager)
 		return;
 	}
 
-	/* Free all entries */
-	struct cg_desktop_entry *entry, *tmp;
-	wl_list_for_each_safe(entry, tmp, &manager->entries, link) {
-		desktop_entry_destroy(entry);
+	if (manager->loader) {
+		atomic_store(&manager->loader->cancel, true);
+		loader_destroy(manager->loader);
+		manager->loader = NULL;
+	}
+	if (manager->watch) {
+		watch_destroy(manager->watch);
+		manager->watch = NULL;
 	}
 
+	desktop_entry_manager_invalidate_index(manager);
+
+	entry_array_finish(&manager->entries);
 	free(manager);
 	wlr_log(WLR_DEBUG, "Desktop entry manager destroyed");
 }
 
+/* Hand the entries loaded so far over to the event loop */
+static void
+loader_hand_over(struct load_state *state, bool done)
+{
+	struct cg_desktop_entry_loader *loader = state->loader;
+
+	/* The strings go along, so the next directory's are interned anew */
+	pthread_mutex_lock(&loader->lock);
+	if (!entry_array_append(&loader->pending, state->target)) {
+		entry_array_finish(state->target);
+	}
+	if (done) {
+		loader->done = true;
+		loader->files_parsed = state->files_parsed;
+		loader->files_from_cache = state->files_from_cache;
+	}
+	pthread_mutex_unlock(&loader->lock);
+
+	eventfd_write(loader->event_fd, 1);
+}
+
+/* Load entries from the given directories into state->target */
+static void
+load_directories(struct load_state *state, const char *const *dirs, const char *cache_path)
+{
+	TRACE_SCOPE("load_directories");
+
+	state->cache = cache_path ? desktop_cache_open(cache_path) : NULL;
+	desktop_cache_writer_init(&state->writer);
+
+	for (size_t i = 0; dirs[i] != NULL && !load_cancelled(state); i++) {
+		scan_applications_directory(state, dirs[i]);
+		if (state->loader && dirs[i + 1] != NULL) {
+			loader_hand_over(state, false);
+		}
+	}
+
+	/* A directory that has disappeared also invalidates the cache */
+	if (!state->cache || state->cache->header->dir_count != state->writer.dir_count) {
+		state->changed = true;
+	}
+
+	if (cache_path && state->changed && !load_cancelled(state)) {
+		desktop_cache_writer_write(&state->writer, cache_path);
+	}
+
+	desktop_cache_writer_finish(&state->writer);
+	desktop_cache_close(state->cache);
+	state->cache = NULL;
+}
+
+/* Collect the applications directories to scan: XDG DATA HOME first,
+ * then the system directories. Returns a NULL-terminated, owned array. */
+static char **
+get_default_dirs(void)
+{
+	size_t max = sizeof(xdg_data_dirs) / sizeof(xdg_data_dirs[0]) + 1;
+	char **dirs = calloc(max, sizeof(*dirs));
+	if (!dirs) {
+		return NULL;
+	}
+
+	size_t dir_count = 0;
+	char *data_home = get_xdg_data_home();
+	if (data_home) {
+		dirs[dir_count++] = data_home;
+	}
+	for (int i = 0; xdg_data_dirs[i] != NULL; i++) {
+		dirs[dir_count] = strdup(xdg_data_dirs[i]);
+		if (dirs[dir_count]) {
+			dir_count++;
+		}
+	}
+	return dirs;
+}
+
+static void
+free_dirs(char **dirs)
+{
+	for (size_t i = 0; dirs && dirs[i]; i++) {
+		free(dirs[i]);
+	}
+	free(dirs);
+}
+
 int
 desktop_entry_manager_load(struct cg_desktop_entry_manager *manager)
 {
+	TRACE_SCOPE("desktop_entry_manager_load");
+
 	if (!manager) {
 		return -1;
 	}
 
-	/* First, scan XDG DATA HOME */
-	char *data_home = get_xdg_data_home();
-	if (data_home) {
-		scan_applications_directory(manager, data_home);
-		free(data_home);
+	char **dirs = get_default_dirs();
+	if (!dirs) {
+		return -1;
 	}
 
-	/* Then scan system directories */
-	for (int i = 0; xdg_data_dirs[i] != NULL; i++) {
-		scan_applications_directory(manager, xdg_data_dirs[i]);
+	char *cache_path = get_cache_path();
+	int count = desktop_entry_manager_load_dirs(manager, (const char *const *)dirs, cache_path);
+
+	free(cache_path);
+	free_dirs(dirs);
+	return count;
+}
+
+int
+desktop_entry_manager_load_dirs(struct cg_desktop_entry_manager *manager, const char *const *dirs,
+				const char *cache_path)
+{
+	if (!manager || !dirs) {
+		return -1;
 	}
 
+	struct load_state state = {0};
+	state.target = &manager->entries;
+	load_directories(&state, dirs, cache_path);
+	manager->files_parsed += state.files_parsed;
+	manager->files_from_cache += state.files_from_cache;
+
 	/* Count entries */
-	int count = 0;
-	struct cg_desktop_entry *entry;
-	wl_list_for_each(entry, &manager->entries, link) {
-		count++;
-	}
+	int count = (int)manager->entries.count;
 
-	wlr_log(WLR_INFO, "Loaded %d desktop entries", count);
+	wlr_log(WLR_INFO, "Loaded %d desktop entries (%zu parsed, %zu from cache)", count, manager->files_parsed,
+		manager->files_from_cache);
+	desktop_entry_manager_build_index(manager);
 	return count;
 }
 
-/* Search for desktop entries matching query.
- * Populates results array with pointers to matching entries.
- * Returns the number of results found (up to max_results).
- */
-size_t
-desktop_entry_manager_search(struct cg_desktop_entry_manager *manager,
-	const char *query, struct cg_desktop_entry **results, size_t max_results)
+static void *
+loader_thread(void *data)
 {
-	if (!manager || !results || max_results == 0) {
-		return 0;
+	struct cg_desktop_entry_loader *loader = data;
+
+	struct cg_desktop_entry_array loaded = {0};
+	string_arena_init(&loaded.strings);
+
+	struct load_state state = {0};
+	state.target = &loaded;
+	state.loader = loader;
+	load_directories(&state, (const char *const *)loader->dirs, loader->cache_path);
+
+	loader_hand_over(&state, true);
+	return NULL;
+}
+
+static void
+loader_destroy(struct cg_desktop_entry_loader *loader)
+{
+	pthread_join(loader->thread, NULL);
+
+	if (loader->event_source) {
+		wl_event_source_remove(loader->event_source);
 	}
+	close(loader->event_fd);
 
-	size_t count = 0;
+	/* Entries that were never handed over */
+	entry_array_finish(&loader->pending);
 
-	/* If query is empty, return all entries */
-	if (!query || query[0] == '\0') {
-		struct cg_desktop_entry *entry;
-		wl_list_for_each(entry, &manager->entries, link) {
-			/* Filter out NoDisplay entries */
-			if (!entry->nodisplay && count < max_results) {
-				results[count++] = entry;
-			}
-		}
-		return count;
+	pthread_mutex_destroy(&loader->lock);
+	free_dirs(loader->dirs);
+	free(loader->cache_path);
+	free(loader);
+}
+
+static int
+handle_loader_event(int fd, uint32_t mask, void *data)
+{
+	struct cg_desktop_entry_manager *manager = data;
+	struct cg_desktop_entry_loader *loader = manager->loader;
+
+	eventfd_t value;
+	eventfd_read(fd, &value);
+
+	pthread_mutex_lock(&loader->lock);
+	bool done = loader->done;
+	bool got_entries = loader->pending.count > 0;
+	if (!entry_array_append(&manager->entries, &loader->pending)) {
+		wlr_log(WLR_ERROR, "Failed to add %zu desktop entries", loader->pending.count);
+		entry_array_finish(&loader->pending);
+		got_entries = false;
 	}
+	if (done) {
+		manager->files_parsed += loader->files_parsed;
+		manager->files_from_cache += loader->files_from_cache;
+	}
+	pthread_mutex_unlock(&loader->lock);
 
-	/* Case-insensitive substring search */
-	char query_lower[256];
-	snprintf(query_lower, sizeof(query_lower), "%s", query);
-	for (size_t i = 0; query_lower[i]; i++) {
-		query_lower[i] = tolower(query_lower[i]);
+	if (got_entries) {
+		desktop_entry_manager_invalidate_index(manager);
 	}
 
-	struct cg_desktop_entry *entry;
-	wl_list_for_each(entry, &manager->entries, link) {
-		if (count >= max_results) {
-			break;
-		}
+	if (done) {
+		loader_destroy(loader);
+		manager->loader = NULL;
+		manager->loading = false;
+		desktop_entry_manager_build_index(manager);
+		watch_process_deferred(manager);
+		wlr_log(WLR_INFO, "Loaded %d desktop entries (%zu parsed, %zu from cache)",
+			(int)manager->entries.count, manager->files_parsed, manager->files_from_cache);
+	}
 
-		/* Skip NoDisplay entries */
-		if (entry->nodisplay) {
-			continue;
-		}
+	if (got_entries || done) {
+		wl_signal_emit_mutable(&manager->events.changed, manager);
+	}
+	return 0;
+}
 
-		/* Search in name */
-		char name_lower[256];
-		snprintf(name_lower, sizeof(name_lower), "%s", entry->name);
-		for (size_t i = 0; name_lower[i]; i++) {
-			name_lower[i] = tolower(name_lower[i]);
-		}
+int
+desktop_entry_manager_load_async(struct cg_desktop_entry_manager *manager, struct wl_event_loop *event_loop)
+{
+	if (!manager || manager->loader) {
+		return -1;
+	}
 
-		if (strstr(name_lower, query_lower) != NULL) {
-			results[count++] = entry;
-		}
+	struct cg_desktop_entry_loader *loader = calloc(1, sizeof(*loader));
+	if (!loader) {
+		return -1;
 	}
 
-	return count;
+	loader->dirs = get_default_dirs();
+	loader->cache_path = get_cache_path();
+	loader->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	string_arena_init(&loader->pending.strings);
+	atomic_init(&loader->cancel, false);
+	pthread_mutex_init(&loader->lock, NULL);
+
+	if (!loader->dirs || loader->event_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to set up desktop entry loader");
+		goto error;
+	}
+
+	loader->event_source =
+		wl_event_loop_add_fd(event_loop, loader->event_fd, WL_EVENT_READABLE, handle_loader_event, manager);
+	if (!loader->event_source) {
+		wlr_log(WLR_ERROR, "Failed to watch desktop entry loader");
+		goto error;
+	}
+
+	int err = pthread_create(&loader->thread, NULL, loader_thread, loader);
+	if (err != 0) {
+		wlr_log(WLR_ERROR, "Failed to start desktop entry loader: %s", strerror(err));
+		wl_event_source_remove(loader->event_source);
+		goto error;
+	}
+
+	manager->loader = loader;
+	manager->loading = true;
+	wlr_log(WLR_DEBUG, "Loading desktop entries in the background");
+	return 0;
+
+error:
+	if (loader->event_fd >= 0) {
+		close(loader->event_fd);
+	}
+	pthread_mutex_destroy(&loader->lock);
+	free_dirs(loader->dirs);
+	free(loader->cache_path);
+	free(loader);
+	return -1;
+}
+
+static int
+compare_entries_by_name(const void *a, const void *b)
+{
+	const struct cg_desktop_entry *ea = *(const struct cg_desktop_entry *const *)a;
+	const struct cg_desktop_entry *eb = *(const struct cg_desktop_entry *const *)b;
+	return strcmp(ea->search_name, eb->search_name);
+}
+
+static void
+reset_matches(struct cg_desktop_entry_manager *manager)
+{
+	free(manager->last_query);
+	free(manager->matches);
+	manager->last_query = NULL;
+	manager->matches = NULL;
+	manager->match_count = 0;
 }
 
 void
-desktop_entry_destroy(struct cg_desktop_entry *entry)
+desktop_entry_manager_invalidate_index(struct cg_desktop_entry_manager *manager)
 {
-	if (!entry) {
+	if (!manager) {
 		return;
 	}
 
-	free(entry->name);
-	free(entry->exec);
-	free(entry->icon);
-	free(entry->categories);
-	free(entry->desktop_file);
-	free(entry);
+	reset_matches(manager);
+	free(manager->index);
+	manager->index = NULL;
+	manager->index_count = 0;
+	manager->index_valid = false;
+}
+
+int
+desktop_entry_manager_build_index(struct cg_desktop_entry_manager *manager)
+{
+	if (!manager) {
+		return -1;
+	}
+
+	desktop_entry_manager_invalidate_index(manager);
+
+	struct cg_desktop_entry_array *array = &manager->entries;
+	struct cg_desktop_entry **sorted = NULL;
+	if (array->count > 0) {
+		sorted = malloc(sizeof(*sorted) * array->count);
+		manager->index = malloc(sizeof(*manager->index) * array->count);
+		if (!sorted || !manager->index) {
+			wlr_log(WLR_ERROR, "Failed to allocate desktop entry index");
+			free(sorted);
+			free(manager->index);
+			manager->index = NULL;
+			return -1;
+		}
+	}
+
+	/* The search data was filled in when the entries were added */
+	size_t count = 0;
+	for (size_t i = 0; i < array->count; i++) {
+		if (!array->entries[i].nodisplay) {
+			sorted[count++] = &array->entries[i];
+		}
+	}
+
+	qsort(sorted, count, sizeof(*sorted), compare_entries_by_name);
+	for (size_t i = 0; i < count; i++) {
+		manager->index[i] = sorted[i] - array->entries;
+	}
+	free(sorted);
+	manager->index_count = count;
+	manager->index_valid = true;
+
+	wlr_log(WLR_DEBUG, "Indexed %zu desktop entries", manager->index_count);
+	return (int)manager->index_count;
+}
+
+/* Insert the entry at position i into a valid index, keeping it sorted
+ * by name */
+static void
+index_insert(struct cg_desktop_entry_manager *manager, size_t i)
+{
+	struct cg_desktop_entry *entries = manager->entries.entries;
+	struct cg_desktop_entry *entry = &entries[i];
+	if (!manager->index_valid || entry->nodisplay) {
+		return;
+	}
+
+	uint32_t *index = realloc(manager->index, sizeof(*manager->index) * (manager->index_count + 1));
+	if (!index) {
+		/* Fall back to a rebuild on the next search */
+		desktop_entry_manager_invalidate_index(manager);
+		return;
+	}
+	manager->index = index;
+
+	size_t left = 0;
+	size_t right = manager->index_count;
+	while (left < right) {
+		size_t mid = left + (right - left) / 2;
+		if (strcmp(entries[index[mid]].search_name, entry->search_name) < 0) {
+			left = mid + 1;
+		} else {
+			right = mid;
+		}
+	}
+
+	memmove(&index[left + 1], &index[left], sizeof(*index) * (manager->index_count - left));
+	index[left] = i;
+	manager->index_count++;
+	reset_matches(manager);
+}
+
+/* Remove the entry at position i from the index, if it is in there, and
+ * point the index at the entry that takes its place in the array */
+static void
+index_remove(struct cg_desktop_entry_manager *manager, size_t i, size_t moved_from)
+{
+	for (size_t j = 0; j < manager->index_count; j++) {
+		if (manager->index[j] == i) {
+			memmove(&manager->index[j], &manager->index[j + 1],
+				sizeof(*manager->index) * (manager->index_count - j - 1));
+			manager->index_count--;
+			break;
+		}
+	}
+	for (size_t j = 0; j < manager->index_count && moved_from != i; j++) {
+		if (manager->index[j] == moved_from) {
+			manager->index[j] = i;
+			break;
+		}
+	}
+	reset_matches(manager);
+}
+
+/* Best score over all search fields; the name weighs more than keywords */
+static int
+score_entry(const struct cg_desktop_entry *entry, const char *query)
+{
+	int name_score = search_score(entry->search_name, query);
+	int extra_score = search_score(entry->search_extra, query);
+
+	if (name_score >= 0) {
+		name_score *= 2;
+	}
+	return name_score > extra_score ? name_score : extra_score;
+}
+
+struct scored_entry {
+	const struct cg_desktop_entry *entry;
+	int score;
+};
+
+static int
+compare_scored(const void *a, const void *b)
+{
+	const struct scored_entry *sa = a;
+	const struct scored_entry *sb = b;
+
+	if (sa->score != sb->score) {
+		return sb->score - sa->score;
+	}
+
+	/* Ties go to the shorter, then alphabetically first, name */
+	size_t la = strlen(sa->entry->search_name);
+	size_t lb = strlen(sb->entry->search_name);
+	if (la != lb) {
+		return la < lb ? -1 : 1;
+	}
+	return strcmp(sa->entry->search_name, sb->entry->search_name);
+}
+
+size_t
+desktop_entry_manager_query(struct cg_desktop_entry_manager *manager, const char *query)
+{
+	if (!manager) {
+		return 0;
+	}
+
+	if (!manager->index_valid && desktop_entry_manager_build_index(manager) < 0) {
+		return 0;
+	}
+
+	/* If query is empty, the results are the whole index */
+	if (!query || query[0] == '\0') {
+		reset_matches(manager);
+		return manager->index_count;
+	}
+
+	char *query_lower = search_lowercase(query);
+	if (!query_lower) {
+		return 0;
+	}
+	uint64_t query_mask = search_mask(query_lower);
+
+	/* A query that extends the previous one can only match a subset of
+	 * its matches */
+	const uint32_t *candidates = manager->index;
+	size_t candidate_count = manager->index_count;
+	if (manager->last_query &&
+	    strncmp(query_lower, manager->last_query, strlen(manager->last_query)) == 0) {
+		candidates = manager->matches;
+		candidate_count = manager->match_count;
+	}
+
+	struct scored_entry *scored = NULL;
+	uint32_t *matches = NULL;
+	if (candidate_count > 0) {
+		scored = malloc(sizeof(*scored) * candidate_count);
+		matches = malloc(sizeof(*matches) * candidate_count);
+		if (!scored || !matches) {
+			free(scored);
+			free(matches);
+			free(query_lower);
+			reset_matches(manager);
+			return 0;
+		}
+	}
+
+	const struct cg_desktop_entry *entries = manager->entries.entries;
+	size_t match_count = 0;
+	for (size_t i = 0; i < candidate_count; i++) {
+		const struct cg_desktop_entry *entry = &entries[candidates[i]];
+
+		/* Cheap rejection: every query character must occur somewhere */
+		if ((entry->char_mask & query_mask) != query_mask) {
+			continue;
+		}
+
+		int score = score_entry(entry, query_lower);
+		if (score < 0) {
+			continue;
+		}
+
+		scored[match_count].entry = entry;
+		scored[match_count].score = score;
+		match_count++;
+	}
+
+	if (match_count > 0) {
+		qsort(scored, match_count, sizeof(*scored), compare_scored);
+	}
+	for (size_t i = 0; i < match_count; i++) {
+		matches[i] = scored[i].entry - entries;
+	}
+	free(scored);
+
+	/* Keep the ranked matches for paging and for the next keystroke */
+	reset_matches(manager);
+	manager->last_query = query_lower;
+	manager->matches = matches;
+	manager->match_count = match_count;
+
+	return match_count;
+}
+
+size_t
+desktop_entry_manager_get_results(struct cg_desktop_entry_manager *manager, size_t offset,
+				  struct cg_desktop_entry **results, size_t max_results)
+{
+	if (!manager || !results) {
+		return 0;
+	}
+
+	const uint32_t *ranked = manager->last_query ? manager->matches : manager->index;
+	size_t total = manager->last_query ? manager->match_count : manager->index_count;
+	if (offset >= total) {
+		return 0;
+	}
+
+	size_t count = total - offset < max_results ? total - offset : max_results;
+	for (size_t i = 0; i < count; i++) {
+		results[i] = &manager->entries.entries[ranked[offset + i]];
+	}
+	return count;
+}
+
+/* Search for desktop entries matching query.
+ * Populates results array with pointers to matching entries, best first.
+ * Returns the number of results found (up to max_results).
+ */
+size_t
+desktop_entry_manager_search(struct cg_desktop_entry_manager *manager,
+	const char *query, struct cg_desktop_entry **results, size_t max_results)
+{
+	if (!manager || !results || max_results == 0) {
+		return 0;
+	}
+
+	desktop_entry_manager_query(manager, query);
+	return desktop_entry_manager_get_results(manager, 0, results, max_results);
+}
+
+struct cg_desktop_entry *
+desktop_entry_manager_add(struct cg_desktop_entry_manager *manager, const struct cg_desktop_entry_fields *fields)
+{
+	if (!manager || !fields) {
+		return NULL;
+	}
+	return entry_array_add(&manager->entries, fields);
+}
+
+bool
+desktop_entry_path(const struct cg_desktop_entry *entry, char *buf, size_t size)
+{
+	if (!entry->dir || !entry->file_name) {
+		return false;
+	}
+	int len = snprintf(buf, size, "%s/%s", entry->dir, entry->file_name);
+	return len >= 0 && (size_t)len < size;
+}
+
+/* The position of the entry loaded from a .desktop file, or -1 */
+static long
+find_entry_by_file(struct cg_desktop_entry_manager *manager, const char *path)
+{
+	const char *slash = strrchr(path, '/');
+	if (!slash) {
+		return -1;
+	}
+	size_t dir_len = slash - path;
+
+	for (size_t i = 0; i < manager->entries.count; i++) {
+		const struct cg_desktop_entry *entry = &manager->entries.entries[i];
+		if (entry->file_name && strcmp(entry->file_name, slash + 1) == 0 &&
+		    strncmp(entry->dir, path, dir_len) == 0 && entry->dir[dir_len] == '\0') {
+			return (long)i;
+		}
+	}
+	return -1;
+}
+
+bool
+desktop_entry_manager_remove_file(struct cg_desktop_entry_manager *manager, const char *path)
+{
+	if (!manager || !path) {
+		return false;
+	}
+
+	long i = find_entry_by_file(manager, path);
+	if (i < 0) {
+		return false;
+	}
+
+	wlr_log(WLR_DEBUG, "Removed desktop entry %s (%s)", manager->entries.entries[i].name, path);
+	index_remove(manager, i, manager->entries.count - 1);
+	entry_array_remove(&manager->entries, i);
+	entry_array_compact(&manager->entries);
+	return true;
+}
+
+bool
+desktop_entry_manager_update_file(struct cg_desktop_entry_manager *manager, const char *path)
+{
+	if (!manager || !path) {
+		return false;
+	}
+
+	bool changed = desktop_entry_manager_remove_file(manager, path);
+
+	if (parse_desktop_file(&manager->entries, path)) {
+		index_insert(manager, manager->entries.count - 1);
+		changed = true;
+	}
+
+	return changed;
+}
+
+/* Watches the applications directories with inotify */
+struct cg_desktop_entry_watch {
+	int fd;
+	struct wl_event_source *event_source;
+
+	struct cg_desktop_entry_watch_dir {
+		int wd;        /* -1 while the directory doesn't exist */
+		int parent_wd; /* Watches for it to appear, see watch_dir_start() */
+		char *path;
+	} *dirs;
+	size_t dir_count;
+
+	/* Files that changed while the initial load was running */
+	char **deferred;
+	size_t deferred_count;
+
+	/* Rescans after the kernel dropped events, see
+	 * desktop_entry_manager_rescan() */
+	struct wl_event_source *rescan_timer;
+	struct timespec synced;  /* Files changed before are loaded */
+	bool rescan_deferred;    /* Until the initial load is done */
+};
+
+static void
+watch_defer(struct cg_desktop_entry_watch *watch, const char *path)
+{
+	char **deferred = realloc(watch->deferred, sizeof(*deferred) * (watch->deferred_count + 1));
+	if (!deferred) {
+		return;
+	}
+	watch->deferred = deferred;
+	deferred[watch->deferred_count] = strdup(path);
+	if (deferred[watch->deferred_count]) {
+		watch->deferred_count++;
+	}
+}
+
+static void
+watch_process_deferred(struct cg_desktop_entry_manager *manager)
+{
+	struct cg_desktop_entry_watch *watch = manager->watch;
+	if (!watch) {
+		return;
+	}
+	if (watch->rescan_deferred) {
+		watch->rescan_deferred = false;
+		desktop_entry_manager_rescan(manager);
+	}
+	if (watch->deferred_count == 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < watch->deferred_count; i++) {
+		desktop_entry_manager_update_file(manager, watch->deferred[i]);
+		free(watch->deferred[i]);
+	}
+	free(watch->deferred);
+	watch->deferred = NULL;
+	watch->deferred_count = 0;
+}
+
+static const char *
+watch_dir_path(struct cg_desktop_entry_watch *watch, int wd)
+{
+	for (size_t i = 0; i < watch->dir_count; i++) {
+		if (watch->dirs[i].wd == wd) {
+			return watch->dirs[i].path;
+		}
+	}
+	return NULL;
+}
+
+static bool watch_missing_dirs(struct cg_desktop_entry_manager *manager);
+
+static int
+handle_watch_event(int fd, uint32_t mask, void *data)
+{
+	struct cg_desktop_entry_manager *manager = data;
+	struct cg_desktop_entry_watch *watch = manager->watch;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	bool changed = false;
+	bool dirs_appeared = false;
+
+	for (;;) {
+		ssize_t len = read(fd, buf, sizeof(buf));
+		if (len <= 0) {
+			break;
+		}
+
+		for (char *ptr = buf; ptr < buf + len;) {
+			const struct inotify_event *event = (const struct inotify_event *)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				wlr_log(WLR_ERROR, "Application directory events overflowed, rescanning");
+				wl_event_source_timer_update(watch->rescan_timer, WATCH_RESCAN_DELAY_MS);
+				continue;
+			}
+
+			/* A directory was created, maybe one of the missing ones or
+			 * an ancestor of them */
+			if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+				dirs_appeared = true;
+			}
+
+			/* A watched directory was removed; wait for it to come back */
+			if (event->mask & IN_IGNORED) {
+				for (size_t i = 0; i < watch->dir_count; i++) {
+					if (watch->dirs[i].wd == event->wd) {
+						watch->dirs[i].wd = -1;
+						dirs_appeared = true;
+					}
+				}
+				continue;
+			}
+
+			const char *dir_path = watch_dir_path(watch, event->wd);
+			if (!dir_path || event->len == 0 || event->name[0] == '.') {
+				continue;
+			}
+
+			size_t name_len = strlen(event->name);
+			if (name_len < 8 || strcmp(event->name + name_len - 8, ".desktop") != 0) {
+				continue;
+			}
+
+			char path[PATH_MAX];
+			snprintf(path, sizeof(path), "%s/%s", dir_path, event->name);
+
+			if (manager->loading) {
+				watch_defer(watch, path);
+			} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				changed |= desktop_entry_manager_remove_file(manager, path);
+			} else {
+				changed |= desktop_entry_manager_update_file(manager, path);
+			}
+		}
+	}
+
+	if (dirs_appeared) {
+		changed |= watch_missing_dirs(manager);
+	}
+	if (changed) {
+		wl_signal_emit_mutable(&manager->events.changed, manager);
+	}
+	return 0;
+}
+
+static void
+watch_mark_synced(struct cg_desktop_entry_watch *watch)
+{
+	/* Files are stamped with a coarse clock that lags behind this one,
+	 * so leave some slack rather than miss a change */
+	clock_gettime(CLOCK_REALTIME, &watch->synced);
+	watch->synced.tv_sec -= 1;
+}
+
+static int
+compare_strings(const void *a, const void *b)
+{
+	return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static bool
+changed_since(const struct stat *st, const struct timespec *since)
+{
+	/* The change time also moves when a file is renamed or linked in */
+	return st->st_ctim.tv_sec > since->tv_sec ||
+	       (st->st_ctim.tv_sec == since->tv_sec && st->st_ctim.tv_nsec >= since->tv_nsec);
+}
+
+/* Bring the entries of one watched directory in line with its files:
+ * drop those whose file is gone, and parse the files that changed since
+ * the last time the entries were known to be current, or that have no
+ * entry. Returns true if the entries changed. */
+static bool
+watch_rescan_dir(struct cg_desktop_entry_manager *manager, const char *dir_path, const struct timespec *since)
+{
+	struct cg_desktop_entry_array *entries = &manager->entries;
+	bool changed = false;
+
+	/* The last entry moves into a removed one's place, so walk backwards */
+	char path[PATH_MAX];
+	for (size_t i = entries->count; i-- > 0;) {
+		const struct cg_desktop_entry *entry = &entries->entries[i];
+		if (!entry->dir || strcmp(entry->dir, dir_path) != 0 ||
+		    !desktop_entry_path(entry, path, sizeof(path)) || access(path, F_OK) == 0) {
+			continue;
+		}
+		wlr_log(WLR_DEBUG, "Removed desktop entry %s (%s)", entry->name, path);
+		index_remove(manager, i, entries->count - 1);
+		entry_array_remove(entries, i);
+		changed = true;
+	}
+	if (changed) {
+		entry_array_compact(entries);
+	}
+
+	DIR *dir = opendir(dir_path);
+	if (!dir) {
+		return changed;
+	}
+
+	/* The files with entries, to tell new ones apart; the names stay put
+	 * until the entries change below */
+	const char **loaded = malloc((entries->count + 1) * sizeof(*loaded));
+	size_t loaded_count = 0;
+	for (size_t i = 0; loaded && i < entries->count; i++) {
+		const struct cg_desktop_entry *entry = &entries->entries[i];
+		if (entry->dir && entry->file_name && strcmp(entry->dir, dir_path) == 0) {
+			loaded[loaded_count++] = entry->file_name;
+		}
+	}
+	if (loaded) {
+		qsort(loaded, loaded_count, sizeof(*loaded), compare_strings);
+	}
+
+	char **stale = NULL;
+	size_t stale_count = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir)) != NULL) {
+		const char *name = dirent->d_name;
+		size_t name_len = strlen(name);
+		if (name[0] == '.' || name_len < 8 || strcmp(name + name_len - 8, ".desktop") != 0) {
+			continue;
+		}
+
+		struct stat st;
+		if (fstatat(dirfd(dir), name, &st, 0) != 0) {
+			continue;
+		}
+		bool known = loaded && bsearch(&name, loaded, loaded_count, sizeof(*loaded), compare_strings);
+		if (known && !changed_since(&st, since)) {
+			continue;
+		}
+
+		char **grown = realloc(stale, (stale_count + 1) * sizeof(*stale));
+		if (!grown) {
+			break;
+		}
+		stale = grown;
+		int len = snprintf(path, sizeof(path), "%s/%s", dir_path, name);
+		if (len > 0 && (size_t)len < sizeof(path) && (stale[stale_count] = strdup(path))) {
+			stale_count++;
+		}
+	}
+	closedir(dir);
+	free(loaded);
+
+	for (size_t i = 0; i < stale_count; i++) {
+		changed |= desktop_entry_manager_update_file(manager, stale[i]);
+		free(stale[i]);
+	}
+	free(stale);
+	return changed;
+}
+
+static bool
+watch_is_used(const struct cg_desktop_entry_watch *watch, int wd)
+{
+	for (size_t i = 0; i < watch->dir_count; i++) {
+		if (watch->dirs[i].wd == wd || watch->dirs[i].parent_wd == wd) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Watch a directory, or if it doesn't exist, its nearest existing
+ * ancestor, to notice when the directory is created. Returns true if
+ * the directory itself is watched. */
+static bool
+watch_dir_start(struct cg_desktop_entry_watch *watch, struct cg_desktop_entry_watch_dir *dir)
+{
+	int old_parent_wd = dir->parent_wd;
+	dir->parent_wd = -1;
+	dir->wd = inotify_add_watch(watch->fd, dir->path, WATCH_DIR_MASK);
+
+	char parent[PATH_MAX];
+	snprintf(parent, sizeof(parent), "%s", dir->path);
+	char *slash;
+	while (dir->wd < 0 && dir->parent_wd < 0 && (slash = strrchr(parent, '/')) != NULL) {
+		bool root = slash == parent;
+		slash[root ? 1 : 0] = '\0';
+		dir->parent_wd = inotify_add_watch(watch->fd, parent, WATCH_PARENT_MASK);
+		if (root) {
+			break;
+		}
+	}
+
+	/* The ancestor watch may be shared with other directories */
+	if (old_parent_wd >= 0 && old_parent_wd != dir->parent_wd && !watch_is_used(watch, old_parent_wd)) {
+		inotify_rm_watch(watch->fd, old_parent_wd);
+	}
+	return dir->wd >= 0;
+}
+
+/* Start watching the missing directories that were created since, and
+ * load what was written to them before the watch was in place. Returns
+ * true if the entries changed. */
+static bool
+watch_missing_dirs(struct cg_desktop_entry_manager *manager)
+{
+	struct cg_desktop_entry_watch *watch = manager->watch;
+	bool changed = false;
+
+	for (size_t i = 0; i < watch->dir_count; i++) {
+		struct cg_desktop_entry_watch_dir *dir = &watch->dirs[i];
+		if (dir->wd >= 0 || !watch_dir_start(watch, dir)) {
+			continue;
+		}
+		wlr_log(WLR_INFO, "Application directory %s appeared, watching it", dir->path);
+		if (manager->loading) {
+			watch->rescan_deferred = true;
+		} else {
+			changed |= watch_rescan_dir(manager, dir->path, &watch->synced);
+		}
+	}
+	return changed;
+}
+
+bool
+desktop_entry_manager_rescan(struct cg_desktop_entry_manager *manager)
+{
+	struct cg_desktop_entry_watch *watch = manager ? manager->watch : NULL;
+	if (!watch) {
+		return false;
+	}
+	if (manager->loading) {
+		watch->rescan_deferred = true;
+		return false;
+	}
+
+	/* Changes from now on are seen again, or caught by the next rescan */
+	struct timespec since = watch->synced;
+	watch_mark_synced(watch);
+
+	/* Creating a missing directory may have been among the lost events */
+	bool changed = false;
+	for (size_t i = 0; i < watch->dir_count; i++) {
+		if (watch->dirs[i].wd < 0) {
+			watch_dir_start(watch, &watch->dirs[i]);
+		}
+		changed |= watch_rescan_dir(manager, watch->dirs[i].path, &since);
+	}
+
+	wlr_log(WLR_INFO, "Rescanned %zu application directories, %s", watch->dir_count,
+		changed ? "entries changed" : "no changes");
+	if (changed) {
+		wl_signal_emit_mutable(&manager->events.changed, manager);
+	}
+	return changed;
+}
+
+static int
+handle_rescan_timer(void *data)
+{
+	desktop_entry_manager_rescan(data);
+	return 0;
+}
+
+static void
+watch_destroy(struct cg_desktop_entry_watch *watch)
+{
+	if (watch->event_source) {
+		wl_event_source_remove(watch->event_source);
+	}
+	if (watch->rescan_timer) {
+		wl_event_source_remove(watch->rescan_timer);
+	}
+	close(watch->fd);
+
+	for (size_t i = 0; i < watch->dir_count; i++) {
+		free(watch->dirs[i].path);
+	}
+	free(watch->dirs);
+	for (size_t i = 0; i < watch->deferred_count; i++) {
+		free(watch->deferred[i]);
+	}
+	free(watch->deferred);
+	free(watch);
+}
+
+int
+desktop_entry_manager_watch_dirs(struct cg_desktop_entry_manager *manager, const char *const *dirs,
+				 struct wl_event_loop *event_loop)
+{
+	if (!manager || !dirs || manager->watch) {
+		return -1;
+	}
+
+	struct cg_desktop_entry_watch *watch = calloc(1, sizeof(*watch));
+	if (!watch) {
+		return -1;
+	}
+
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to create inotify instance");
+		free(watch);
+		return -1;
+	}
+
+	size_t count = 0;
+	while (dirs[count]) {
+		count++;
+	}
+	watch->dirs = calloc(count > 0 ? count : 1, sizeof(*watch->dirs));
+	if (!watch->dirs) {
+		watch_destroy(watch);
+		return -1;
+	}
+
+	/* Directories that don't exist yet are watched for once they do */
+	for (size_t i = 0; i < count; i++) {
+		struct cg_desktop_entry_watch_dir *dir = &watch->dirs[watch->dir_count];
+		dir->wd = -1;
+		dir->parent_wd = -1;
+		dir->path = strdup(dirs[i]);
+		if (dir->path) {
+			watch->dir_count++;
+			watch_dir_start(watch, dir);
+		}
+	}
+
+	/* Files changed from now on are seen, even before the watch is */
+	watch_mark_synced(watch);
+
+	watch->event_source =
+		wl_event_loop_add_fd(event_loop, watch->fd, WL_EVENT_READABLE, handle_watch_event, manager);
+	watch->rescan_timer = wl_event_loop_add_timer(event_loop, handle_rescan_timer, manager);
+	if (!watch->event_source || !watch->rescan_timer) {
+		wlr_log(WLR_ERROR, "Failed to watch application directories");
+		watch_destroy(watch);
+		return -1;
+	}
+
+	manager->watch = watch;
+	wlr_log(WLR_DEBUG, "Watching %zu application directories", watch->dir_count);
+	return 0;
+}
+
+int
+desktop_entry_manager_watch(struct cg_desktop_entry_manager *manager, struct wl_event_loop *event_loop)
+{
+	char **dirs = get_default_dirs();
+	if (!dirs) {
+		return -1;
+	}
+
+	int ret = desktop_entry_manager_watch_dirs(manager, (const char *const *)dirs, event_loop);
+	free_dirs(dirs);
+	return ret;
 }
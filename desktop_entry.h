@@ -1,32 +1,154 @@
 #ifndef CG_DESKTOP_ENTRY_H
 #define CG_DESKTOP_ENTRY_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <wayland-server-core.h>
 
-/* Represents a single application desktop entry */
+#include "string_arena.h"
+
+/*
+ * A single application desktop entry. Entries are elements of the
+ * manager's entries array, and their strings live in its string arena:
+ * each entry's own strings are one block, searched fields first, and the
+ * directory and categories, which many entries share, are interned.
+ * Pointers to entries are only valid until the entries change.
+ */
 struct cg_desktop_entry {
-	char *name;           /* Application name (localized) */
-	char *exec;           /* Command line to launch */
-	char *icon;           /* Icon name (optional) */
-	char *desktop_file;   /* Path to .desktop file */
-	char *categories;     /* Categories (optional) */
-	bool nodisplay;       /* If true, don't show in launcher */
-	struct wl_list link;  /* For linking into entries list */
+	/* Search data, read on every keystroke */
+	uint64_t char_mask;        /* Characters present in search_name and search_extra */
+	const char *search_name;   /* Lowercased name */
+	const char *search_extra;  /* Lowercased generic name and keywords */
+
+	const char *name;          /* Application name (localized) */
+	const char *exec;          /* Command line to launch */
+	char *const *argv;         /* exec split, field codes expanded */
+	const char *icon;          /* Icon name (optional) */
+	const char *generic_name;  /* Generic name, e.g. "Web Browser" (optional) */
+	const char *keywords;      /* Semicolon-separated search keywords (optional) */
+	const char *categories;    /* Categories (optional) */
+	const char *dir;           /* Directory of the .desktop file (optional) */
+	const char *file_name;     /* Name of the .desktop file within dir */
+	uint32_t strings_size;     /* Size of the entry's own block of strings */
+	bool nodisplay;            /* If true, don't show in launcher */
+};
+
+/* The fields of a new entry; the strings are copied */
+struct cg_desktop_entry_fields {
+	const char *name;
+	const char *exec;
+	const char *icon;
+	const char *generic_name;
+	const char *keywords;
+	const char *categories;
+	const char *desktop_file;  /* Path to the .desktop file (optional) */
+	bool nodisplay;
 };
 
+/* Entries stored contiguously, with their strings */
+struct cg_desktop_entry_array {
+	struct cg_desktop_entry *entries;
+	size_t count;
+	size_t capacity;
+	struct cg_string_arena strings;
+	size_t dead_bytes;  /* Strings of removed entries, until compacted */
+};
+
+struct cg_desktop_entry_loader;
+struct cg_desktop_entry_watch;
+
 /* Manager for all desktop entries */
 struct cg_desktop_entry_manager {
-	struct wl_list entries;  /* List of cg_desktop_entry */
+	struct cg_desktop_entry_array entries;
+
+	/* Background loading, see desktop_entry_manager_load_async() */
+	struct cg_desktop_entry_loader *loader;
+	bool loading;
+
+	/* inotify watch, see desktop_entry_manager_watch() */
+	struct cg_desktop_entry_watch *watch;
+
+	struct {
+		struct wl_signal changed;  /* Entries were added, removed or replaced */
+	} events;
+
+	/* Search index: positions of the visible entries, sorted by name */
+	uint32_t *index;
+	size_t index_count;
+	bool index_valid;
+
+	/* Every match of the previous query, so a query that extends it
+	 * only has to rescan these */
+	char *last_query;
+	uint32_t *matches;
+	size_t match_count;
+
+	/* Load statistics */
+	size_t files_parsed;
+	size_t files_from_cache;
 };
 
 /* Create/destroy manager */
 struct cg_desktop_entry_manager *desktop_entry_manager_create(void);
 void desktop_entry_manager_destroy(struct cg_desktop_entry_manager *manager);
 
-/* Load all desktop entries from XDG data directories */
+/* Load all desktop entries from XDG data directories, through the cache
+ * in $XDG_CACHE_HOME/waymux */
 int desktop_entry_manager_load(struct cg_desktop_entry_manager *manager);
 
-/* Search/filter entries by query (case-insensitive substring match) */
+/* Load all desktop entries like desktop_entry_manager_load(), but on a
+ * worker thread. Entries are added from the event loop one directory at a
+ * time, each batch emitting events.changed; loading is true until the
+ * last batch is in. Returns -1 if the thread could not be started. */
+int desktop_entry_manager_load_async(struct cg_desktop_entry_manager *manager,
+				     struct wl_event_loop *event_loop);
+
+/* Load desktop entries from a NULL-terminated list of applications
+ * directories. Unchanged files are taken from the cache at cache_path
+ * (if not NULL), which is rewritten when anything changed. */
+int desktop_entry_manager_load_dirs(struct cg_desktop_entry_manager *manager, const char *const *dirs,
+				    const char *cache_path);
+
+/* Watch the XDG applications directories with inotify and keep the
+ * entries and search index current, emitting events.changed. Directories
+ * that don't exist are picked up once they are created. Changes seen
+ * during a background load are applied once it finishes. */
+int desktop_entry_manager_watch(struct cg_desktop_entry_manager *manager, struct wl_event_loop *event_loop);
+
+/* Like desktop_entry_manager_watch(), for a NULL-terminated list of
+ * applications directories */
+int desktop_entry_manager_watch_dirs(struct cg_desktop_entry_manager *manager, const char *const *dirs,
+				     struct wl_event_loop *event_loop);
+
+/* Bring the entries in line with the watched directories, as is done
+ * when the kernel drops inotify events: entries whose file is gone are
+ * removed, and files changed since the watch was last current, or without
+ * an entry, are parsed again. Deferred until a background load finishes.
+ * Returns true if the entries changed, emitting events.changed. */
+bool desktop_entry_manager_rescan(struct cg_desktop_entry_manager *manager);
+
+/* Add an entry, copying its fields. Returns the entry, or NULL on
+ * allocation failure. The search index has to be invalidated after. */
+struct cg_desktop_entry *desktop_entry_manager_add(struct cg_desktop_entry_manager *manager,
+						   const struct cg_desktop_entry_fields *fields);
+
+/* Re-parse a single .desktop file, replacing its entry (if any) in place.
+ * Returns true if the entries changed. */
+bool desktop_entry_manager_update_file(struct cg_desktop_entry_manager *manager, const char *path);
+
+/* Remove the entry loaded from a .desktop file. Returns true if found. */
+bool desktop_entry_manager_remove_file(struct cg_desktop_entry_manager *manager, const char *path);
+
+/* Build the search index from the entries array. Called lazily by search. */
+int desktop_entry_manager_build_index(struct cg_desktop_entry_manager *manager);
+
+/* Mark the search index stale after the entries array changed */
+void desktop_entry_manager_invalidate_index(struct cg_desktop_entry_manager *manager);
+
+/* Search/filter entries by query (case-insensitive fuzzy match over the
+ * name, generic name and keywords). Results are ranked best first; an
+ * empty query returns all visible entries sorted by name. */
 /* Returns the number of matching entries (up to max_results) */
 size_t desktop_entry_manager_search(
 	struct cg_desktop_entry_manager *manager,
@@ -35,7 +157,18 @@ size_t desktop_entry_manager_search(
 	size_t max_results
 );
 
-/* Free a single entry (internal use) */
-void desktop_entry_destroy(struct cg_desktop_entry *entry);
+/* Run a search like desktop_entry_manager_search(), keeping the ranked
+ * matches in the manager. Returns the total number of matches. */
+size_t desktop_entry_manager_query(struct cg_desktop_entry_manager *manager, const char *query);
+
+/* Copy up to max_results of the last query's ranked matches, starting at
+ * offset, so that callers only fetch the rows they show. The window is
+ * only valid until the entries change (see events.changed). */
+size_t desktop_entry_manager_get_results(struct cg_desktop_entry_manager *manager, size_t offset,
+					 struct cg_desktop_entry **results, size_t max_results);
+
+/* Write the path of the entry's .desktop file into buf. Returns false if
+ * it has none or it doesn't fit. */
+bool desktop_entry_path(const struct cg_desktop_entry *entry, char *buf, size_t size);
 
 #endif
@@ -0,0 +1,248 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "exec_line.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEW_INSTANCE "--new-instance"
+
+/*
+ * Arguments are produced twice with the same code: once only counting,
+ * to size the argv, and once writing it.
+ */
+struct exec_writer {
+	char **argv;    /* NULL while counting */
+	char *strings;
+	size_t argc;
+	size_t bytes;
+	size_t arg_start;
+	bool in_arg;
+	bool quoted;    /* The argument had quotes, so is kept even if empty */
+};
+
+static void
+writer_char(struct exec_writer *w, char c)
+{
+	if (w->argv) {
+		w->strings[w->bytes] = c;
+	}
+	w->bytes++;
+}
+
+static void
+writer_str(struct exec_writer *w, const char *str)
+{
+	for (; str && *str; str++) {
+		writer_char(w, *str);
+	}
+}
+
+static void
+writer_begin(struct exec_writer *w)
+{
+	if (!w->in_arg) {
+		w->in_arg = true;
+		w->quoted = false;
+		w->arg_start = w->bytes;
+	}
+}
+
+/* End the current argument. One left empty by field codes is dropped. */
+static void
+writer_end(struct exec_writer *w)
+{
+	if (!w->in_arg) {
+		return;
+	}
+	w->in_arg = false;
+	if (w->bytes == w->arg_start && !w->quoted) {
+		return;
+	}
+	writer_char(w, '\0');
+	if (w->argv) {
+		w->argv[w->argc] = w->strings + w->arg_start;
+	}
+	w->argc++;
+}
+
+/* Expand the field code at p, returning the last character consumed */
+static const char *
+expand_field(struct exec_writer *w, const struct cg_exec_line_fields *fields, const char *p, bool quoted)
+{
+	switch (p[1]) {
+	case '\0':
+		writer_char(w, '%');
+		return p;
+	case '%':
+		writer_char(w, '%');
+		break;
+	case 'c':
+		writer_str(w, fields->name);
+		break;
+	case 'k':
+		writer_str(w, fields->desktop_file);
+		break;
+	case 'i':
+		if (!fields->icon || !*fields->icon) {
+			break;
+		}
+		if (!quoted) {
+			writer_end(w);
+			writer_begin(w);
+			writer_str(w, "--icon");
+			writer_end(w);
+			writer_begin(w);
+		}
+		writer_str(w, fields->icon);
+		break;
+	case 'f':
+	case 'F':
+	case 'u':
+	case 'U':
+	/* Deprecated */
+	case 'd':
+	case 'D':
+	case 'n':
+	case 'N':
+	case 'v':
+	case 'm':
+		break;
+	default:
+		/* Not a field code */
+		writer_char(w, '%');
+		writer_char(w, p[1]);
+		break;
+	}
+	return p + 1;
+}
+
+static bool
+split(const char *line, const struct cg_exec_line_fields *fields, struct exec_writer *w)
+{
+	char quote = '\0';
+	for (const char *p = line; *p; p++) {
+		char c = *p;
+		if (quote == '\'') {
+			if (c == '\'') {
+				quote = '\0';
+			} else {
+				writer_char(w, c);
+			}
+			continue;
+		}
+
+		if (quote == '"') {
+			if (c == '"') {
+				quote = '\0';
+			} else if (c == '\\' && p[1] && strchr("\"`$\\", p[1])) {
+				writer_char(w, *++p);
+			} else if (c == '%' && fields) {
+				p = expand_field(w, fields, p, true);
+			} else {
+				writer_char(w, c);
+			}
+			continue;
+		}
+
+		if (isspace((unsigned char)c)) {
+			writer_end(w);
+			continue;
+		}
+
+		writer_begin(w);
+		if (c == '\'' || c == '"') {
+			quote = c;
+			w->quoted = true;
+		} else if (c == '\\' && p[1]) {
+			writer_char(w, *++p);
+		} else if (c == '%' && fields) {
+			p = expand_field(w, fields, p, false);
+		} else {
+			writer_char(w, c);
+		}
+	}
+
+	if (quote) {
+		return false;
+	}
+	writer_end(w);
+	return w->argc > 0;
+}
+
+/* Firefox hands new windows to a running instance, which would open them
+ * in another tab's process */
+static bool
+needs_new_instance(char **argv, size_t argc)
+{
+	const char *slash = strrchr(argv[0], '/');
+	const char *program = slash ? slash + 1 : argv[0];
+	if (strcmp(program, "firefox") != 0 && strcmp(program, "firefox-bin") != 0) {
+		return false;
+	}
+	for (size_t i = 1; i < argc; i++) {
+		if (strcmp(argv[i], NEW_INSTANCE) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t
+exec_line_parse(const char *line, const struct cg_exec_line_fields *fields, void *buf, size_t size)
+{
+	if (!line) {
+		return 0;
+	}
+
+	struct exec_writer w = {0};
+	if (!split(line, fields, &w)) {
+		return 0;
+	}
+
+	/* Room for --new-instance, and the terminating NULL */
+	size_t pointers_size = (w.argc + 2) * sizeof(char *);
+	size_t needed = pointers_size + w.bytes + sizeof(NEW_INSTANCE);
+	if (!buf || size < needed) {
+		return needed;
+	}
+
+	char **argv = buf;
+	char *strings = (char *)buf + pointers_size;
+	w = (struct exec_writer){.argv = argv, .strings = strings};
+	split(line, fields, &w);
+
+	if (needs_new_instance(argv, w.argc)) {
+		char *new_instance = strings + w.bytes;
+		memcpy(new_instance, NEW_INSTANCE, sizeof(NEW_INSTANCE));
+		memmove(&argv[2], &argv[1], (w.argc - 1) * sizeof(*argv));
+		argv[1] = new_instance;
+		w.argc++;
+	}
+	argv[w.argc] = NULL;
+	return needed;
+}
+
+char **
+exec_line_argv(const char *line, const struct cg_exec_line_fields *fields)
+{
+	size_t size = exec_line_parse(line, fields, NULL, 0);
+	if (size == 0) {
+		return NULL;
+	}
+	char **argv = malloc(size);
+	if (argv) {
+		exec_line_parse(line, fields, argv, size);
+	}
+	return argv;
+}
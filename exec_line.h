@@ -0,0 +1,47 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_EXEC_LINE_H
+#define CG_EXEC_LINE_H
+
+#include <stddef.h>
+
+/*
+ * Command lines split into a ready-to-exec argv, shared by the launcher's
+ * desktop entries and the control socket's new-tab command. Arguments are
+ * separated by whitespace and may be quoted: single quotes take everything
+ * literally, double quotes allow backslash escapes of ", `, $ and \, and
+ * outside quotes a backslash escapes any character. Firefox gets
+ * --new-instance, so every tab is a process of its own.
+ */
+
+/* What the field codes of a desktop entry's Exec key expand to */
+struct cg_exec_line_fields {
+	const char *name;          /* %c */
+	const char *icon;          /* %i, as --icon <icon> (optional) */
+	const char *desktop_file;  /* %k (optional) */
+};
+
+/**
+ * Split line into an argv written to buf: the NULL-terminated pointer
+ * array first, then its strings. With fields, desktop entry field codes
+ * are expanded, and those for files and URLs dropped; without, % is
+ * taken literally. Returns the size the argv needs, which is only written
+ * if it fits in size, or 0 if line has no arguments or an unterminated
+ * quote. buf has to be aligned for pointers.
+ */
+size_t exec_line_parse(const char *line, const struct cg_exec_line_fields *fields, void *buf,
+		       size_t size);
+
+/**
+ * Like exec_line_parse(), into a new allocation to be released with a
+ * single free(). Returns NULL on failure.
+ */
+char **exec_line_argv(const char *line, const struct cg_exec_line_fields *fields);
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "font.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/util/log.h>
+
+struct cg_font_extents_entry {
+	struct cg_font_extents_entry *next;
+	uint32_t hash;
+	cairo_text_extents_t extents;
+	char text[];
+};
+
+/* FNV-1a */
+static uint32_t
+hash_string(const char *text)
+{
+	uint32_t hash = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+		hash ^= *p;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void
+font_cache_clear(struct cg_font *font)
+{
+	for (size_t i = 0; i < FONT_WIDTH_CACHE_BUCKETS; i++) {
+		struct cg_font_extents_entry *entry = font->buckets[i];
+		while (entry) {
+			struct cg_font_extents_entry *next = entry->next;
+			free(entry);
+			entry = next;
+		}
+		font->buckets[i] = NULL;
+	}
+	font->entry_count = 0;
+}
+
+struct cg_font *
+font_create(const char *family, double size)
+{
+	struct cg_font *font = calloc(1, sizeof(*font));
+	if (!font) {
+		wlr_log(WLR_ERROR, "Failed to allocate font");
+		return NULL;
+	}
+
+	cairo_font_face_t *face =
+		cairo_toy_font_face_create(family, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+	cairo_matrix_t font_matrix, ctm;
+	cairo_matrix_init_scale(&font_matrix, size, size);
+	cairo_matrix_init_identity(&ctm);
+	cairo_font_options_t *options = cairo_font_options_create();
+
+	font->scaled_font = cairo_scaled_font_create(face, &font_matrix, &ctm, options);
+
+	cairo_font_options_destroy(options);
+	cairo_font_face_destroy(face);
+
+	if (cairo_scaled_font_status(font->scaled_font) != CAIRO_STATUS_SUCCESS) {
+		wlr_log(WLR_ERROR, "Failed to create %s font at size %.1f", family, size);
+		cairo_scaled_font_destroy(font->scaled_font);
+		free(font);
+		return NULL;
+	}
+
+	cairo_font_extents_t font_extents;
+	cairo_scaled_font_extents(font->scaled_font, &font_extents);
+	font->size = size;
+	font->ascent = font_extents.ascent;
+	font->height = font_extents.height;
+
+	return font;
+}
+
+void
+font_destroy(struct cg_font *font)
+{
+	if (!font) {
+		return;
+	}
+
+	font_cache_clear(font);
+	cairo_scaled_font_destroy(font->scaled_font);
+	free(font);
+}
+
+void
+font_apply(struct cg_font *font, cairo_t *cr)
+{
+	cairo_set_scaled_font(cr, font->scaled_font);
+}
+
+void
+font_text_extents(struct cg_font *font, const char *text, cairo_text_extents_t *extents)
+{
+	uint32_t hash = hash_string(text);
+	struct cg_font_extents_entry **bucket = &font->buckets[hash % FONT_WIDTH_CACHE_BUCKETS];
+
+	for (struct cg_font_extents_entry *entry = *bucket; entry; entry = entry->next) {
+		if (entry->hash == hash && strcmp(entry->text, text) == 0) {
+			*extents = entry->extents;
+			return;
+		}
+	}
+
+	cairo_scaled_font_text_extents(font->scaled_font, text, extents);
+
+	/* The cache only ever grows with new strings; start over once it is full */
+	if (font->entry_count >= FONT_WIDTH_CACHE_MAX_ENTRIES) {
+		font_cache_clear(font);
+	}
+
+	size_t len = strlen(text);
+	struct cg_font_extents_entry *entry = malloc(sizeof(*entry) + len + 1);
+	if (!entry) {
+		return;
+	}
+	entry->hash = hash;
+	entry->extents = *extents;
+	memcpy(entry->text, text, len + 1);
+	entry->next = *bucket;
+	*bucket = entry;
+	font->entry_count++;
+}
+
+double
+font_text_width(struct cg_font *font, const char *text)
+{
+	cairo_text_extents_t extents;
+	font_text_extents(font, text, &extents);
+	return extents.width;
+}
+
+void
+font_truncate_to_width(struct cg_font *font, const char *text, double max_width, char *dest,
+		       size_t dest_size)
+{
+	if (font_text_width(font, text) <= max_width) {
+		snprintf(dest, dest_size, "%s", text);
+		return;
+	}
+
+	/* Collect the offsets where a character starts, so that the
+	 * search below never cuts a multi-byte character in half. */
+	size_t len = strlen(text);
+	size_t *starts = malloc(sizeof(*starts) * (len + 1));
+	char *buf = malloc(len + sizeof(FONT_ELLIPSIS));
+	if (!starts || !buf) {
+		free(starts);
+		free(buf);
+		snprintf(dest, dest_size, "%s", text);
+		return;
+	}
+
+	size_t count = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (((unsigned char)text[i] & 0xC0) != 0x80) {
+			starts[count++] = i;
+		}
+	}
+	starts[count] = len;
+
+	/* Binary search for the longest prefix (in characters) that fits */
+	size_t left = 0;
+	size_t right = count;
+	while (left < right) {
+		size_t mid = (left + right + 1) / 2;
+		size_t bytes = starts[mid];
+		memcpy(buf, text, bytes);
+		memcpy(buf + bytes, FONT_ELLIPSIS, sizeof(FONT_ELLIPSIS));
+
+		if (font_text_width(font, buf) <= max_width) {
+			left = mid;
+		} else {
+			right = mid - 1;
+		}
+	}
+
+	if (left > 0) {
+		snprintf(dest, dest_size, "%.*s%s", (int)starts[left], text, FONT_ELLIPSIS);
+	} else {
+		/* Even with ellipsis only, it's too long - truncate ellipsis itself */
+		snprintf(dest, dest_size, "..");
+	}
+
+	free(starts);
+	free(buf);
+}
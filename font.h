@@ -0,0 +1,71 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_FONT_H
+#define CG_FONT_H
+
+#include <cairo/cairo.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FONT_WIDTH_CACHE_BUCKETS 256
+#define FONT_WIDTH_CACHE_MAX_ENTRIES 4096
+#define FONT_ELLIPSIS "..."
+
+struct cg_font_extents_entry;
+
+/*
+ * A long-lived scaled font shared by every cairo-rendered UI, with a cache
+ * of measured string extents so that re-measuring unchanged titles and
+ * labels does not go back to cairo.
+ */
+struct cg_font {
+	cairo_scaled_font_t *scaled_font;
+	double size;
+	double ascent;
+	double height;
+
+	struct cg_font_extents_entry *buckets[FONT_WIDTH_CACHE_BUCKETS];
+	size_t entry_count;
+};
+
+/**
+ * Create a font for the given cairo toy family (e.g. "sans-serif") and size.
+ */
+struct cg_font *font_create(const char *family, double size);
+
+/**
+ * Destroy a font and its extents cache.
+ */
+void font_destroy(struct cg_font *font);
+
+/**
+ * Select the font into a cairo context, replacing
+ * cairo_select_font_face() + cairo_set_font_size().
+ */
+void font_apply(struct cg_font *font, cairo_t *cr);
+
+/**
+ * Get the extents of a string. Results are cached per string.
+ */
+void font_text_extents(struct cg_font *font, const char *text, cairo_text_extents_t *extents);
+
+/**
+ * Get the ink width of a string. Results are cached per string.
+ */
+double font_text_width(struct cg_font *font, const char *text);
+
+/**
+ * Copy text into dest, truncated with an ellipsis so that it fits in
+ * max_width. Truncation points are found by binary search and never split
+ * a UTF-8 sequence.
+ */
+void font_truncate_to_width(struct cg_font *font, const char *text, double max_width, char *dest,
+			    size_t dest_size);
+
+#endif
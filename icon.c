@@ -0,0 +1,457 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "icon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+#include "trace.h"
+
+/* Sizes applications install into the hicolor theme, ascending */
+static const int theme_sizes[] = {16, 22, 24, 32, 48, 64, 96, 128, 256, 512};
+#define THEME_SIZE_COUNT (sizeof(theme_sizes) / sizeof(theme_sizes[0]))
+
+static bool
+file_exists(const char *path)
+{
+	return access(path, R_OK) == 0;
+}
+
+char *
+icon_find_path(const char *const *dirs, const char *name, int size)
+{
+	if (!dirs || !name || name[0] == '\0') {
+		return NULL;
+	}
+
+	if (name[0] == '/') {
+		return file_exists(name) ? strdup(name) : NULL;
+	}
+
+	/* Some entries name the file rather than the icon */
+	char base[256];
+	snprintf(base, sizeof(base), "%s", name);
+	char *dot = strrchr(base, '.');
+	if (dot && (strcmp(dot, ".png") == 0 || strcmp(dot, ".svg") == 0 || strcmp(dot, ".xpm") == 0)) {
+		*dot = '\0';
+	}
+
+	/* The smallest size at least as large as asked for, then the
+	 * others: downscaling looks better than upscaling */
+	size_t order[THEME_SIZE_COUNT];
+	size_t count = 0;
+	for (size_t i = 0; i < THEME_SIZE_COUNT; i++) {
+		if (theme_sizes[i] >= size) {
+			order[count++] = i;
+		}
+	}
+	for (size_t i = THEME_SIZE_COUNT; i-- > 0;) {
+		if (theme_sizes[i] < size) {
+			order[count++] = i;
+		}
+	}
+
+	char path[4096];
+	for (size_t i = 0; i < count; i++) {
+		int s = theme_sizes[order[i]];
+		for (size_t d = 0; dirs[d]; d++) {
+			snprintf(path, sizeof(path), "%s/hicolor/%dx%d/apps/%s.png", dirs[d], s, s, base);
+			if (file_exists(path)) {
+				return strdup(path);
+			}
+		}
+	}
+
+	/* Unthemed icons, as in /usr/share/pixmaps */
+	for (size_t d = 0; dirs[d]; d++) {
+		snprintf(path, sizeof(path), "%s/%s.png", dirs[d], base);
+		if (file_exists(path)) {
+			return strdup(path);
+		}
+	}
+
+	return NULL;
+}
+
+/* Decode the icon's file into a size x size surface, keeping its aspect
+ * ratio. Runs on the worker thread. */
+static cairo_surface_t *
+icon_decode(const char *const *dirs, const char *name, int size)
+{
+	TRACE_SCOPE("icon_decode");
+
+	char *path = icon_find_path(dirs, name, size);
+	if (!path) {
+		return NULL;
+	}
+
+	cairo_surface_t *image = cairo_image_surface_create_from_png(path);
+	free(path);
+	if (cairo_surface_status(image) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(image);
+		return NULL;
+	}
+
+	int width = cairo_image_surface_get_width(image);
+	int height = cairo_image_surface_get_height(image);
+	if (width <= 0 || height <= 0) {
+		cairo_surface_destroy(image);
+		return NULL;
+	}
+
+	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(surface);
+		cairo_surface_destroy(image);
+		return NULL;
+	}
+
+	double scale = (double)size / (width > height ? width : height);
+	cairo_t *cr = cairo_create(surface);
+	cairo_translate(cr, (size - width * scale) / 2, (size - height * scale) / 2);
+	cairo_scale(cr, scale, scale);
+	cairo_set_source_surface(cr, image, 0, 0);
+	cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+	cairo_paint(cr);
+	cairo_destroy(cr);
+	cairo_surface_destroy(image);
+
+	cairo_surface_flush(surface);
+	return surface;
+}
+
+static void *
+icon_worker(void *data)
+{
+	struct cg_icon_cache *cache = data;
+
+	pthread_mutex_lock(&cache->lock);
+	while (!cache->stop) {
+		if (wl_list_empty(&cache->queue)) {
+			pthread_cond_wait(&cache->wake, &cache->lock);
+			continue;
+		}
+
+		/* The name and size of a pending icon don't change, and its
+		 * surface is only read once it is handed back */
+		struct cg_icon *icon = wl_container_of(cache->queue.prev, icon, queue_link);
+		wl_list_remove(&icon->queue_link);
+		pthread_mutex_unlock(&cache->lock);
+
+		icon->surface = icon_decode((const char *const *)cache->dirs, icon->name, icon->size);
+
+		pthread_mutex_lock(&cache->lock);
+		wl_list_insert(&cache->results, &icon->queue_link);
+		eventfd_write(cache->event_fd, 1);
+	}
+	pthread_mutex_unlock(&cache->lock);
+	return NULL;
+}
+
+/* FNV-1a */
+static uint32_t
+hash_string(const char *text)
+{
+	uint32_t hash = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+		hash ^= *p;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void
+icon_destroy(struct cg_icon_cache *cache, struct cg_icon *icon)
+{
+	cache->bytes -= icon->bytes;
+	wl_list_remove(&icon->link);
+	wl_list_remove(&icon->hash_link);
+	if (icon->surface) {
+		cairo_surface_destroy(icon->surface);
+	}
+	free(icon->name);
+	free(icon);
+}
+
+/* Drop the least recently used icons that are done until the cache fits */
+static void
+icon_cache_evict(struct cg_icon_cache *cache)
+{
+	struct cg_icon *icon, *tmp;
+	wl_list_for_each_reverse_safe(icon, tmp, &cache->icons, link) {
+		if (cache->bytes <= cache->max_bytes) {
+			break;
+		}
+		if (icon->state != CG_ICON_PENDING) {
+			icon_destroy(cache, icon);
+		}
+	}
+}
+
+size_t
+icon_cache_trim(struct cg_icon_cache *cache)
+{
+	size_t bytes = cache->bytes;
+	struct cg_icon *icon, *tmp;
+	wl_list_for_each_safe(icon, tmp, &cache->icons, link) {
+		if (icon->state != CG_ICON_PENDING) {
+			icon_destroy(cache, icon);
+		}
+	}
+	return bytes - cache->bytes;
+}
+
+static int
+handle_icon_event(int fd, uint32_t mask, void *data)
+{
+	struct cg_icon_cache *cache = data;
+
+	eventfd_t value;
+	eventfd_read(fd, &value);
+
+	struct wl_list done;
+	wl_list_init(&done);
+	pthread_mutex_lock(&cache->lock);
+	wl_list_insert_list(&done, &cache->results);
+	wl_list_init(&cache->results);
+	pthread_mutex_unlock(&cache->lock);
+
+	struct cg_icon *icon, *tmp;
+	wl_list_for_each_safe(icon, tmp, &done, queue_link) {
+		wl_list_remove(&icon->queue_link);
+		wl_list_init(&icon->queue_link);
+		if (icon->surface) {
+			icon->state = CG_ICON_READY;
+			size_t bytes = (size_t)cairo_image_surface_get_stride(icon->surface) *
+				       cairo_image_surface_get_height(icon->surface);
+			icon->bytes += bytes;
+			cache->bytes += bytes;
+		} else {
+			icon->state = CG_ICON_MISSING;
+			wlr_log(WLR_DEBUG, "No icon %s at %dpx", icon->name, icon->size);
+		}
+		wl_signal_emit_mutable(&cache->events.ready, icon->name);
+	}
+
+	/* Listeners only schedule repaints, so nothing drawn is evicted */
+	icon_cache_evict(cache);
+	return 0;
+}
+
+static char **
+get_default_dirs(void)
+{
+	char **dirs = calloc(6, sizeof(*dirs));
+	if (!dirs) {
+		return NULL;
+	}
+
+	size_t count = 0;
+	char path[4096];
+	const char *data_home = getenv("XDG_DATA_HOME");
+	const char *home = getenv("HOME");
+	if (data_home && data_home[0] == '/') {
+		snprintf(path, sizeof(path), "%s/icons", data_home);
+		dirs[count++] = strdup(path);
+	} else if (home && home[0] != '\0') {
+		snprintf(path, sizeof(path), "%s/.local/share/icons", home);
+		dirs[count++] = strdup(path);
+	}
+	if (home && home[0] != '\0') {
+		snprintf(path, sizeof(path), "%s/.icons", home);
+		dirs[count++] = strdup(path);
+	}
+	dirs[count++] = strdup("/usr/local/share/icons");
+	dirs[count++] = strdup("/usr/share/icons");
+	dirs[count++] = strdup("/usr/share/pixmaps");
+
+	for (size_t i = 0; i < count; i++) {
+		if (!dirs[i]) {
+			for (size_t j = 0; j < count; j++) {
+				free(dirs[j]);
+			}
+			free(dirs);
+			return NULL;
+		}
+	}
+	return dirs;
+}
+
+static void
+free_dirs(char **dirs)
+{
+	for (size_t i = 0; dirs && dirs[i]; i++) {
+		free(dirs[i]);
+	}
+	free(dirs);
+}
+
+static struct cg_icon_cache *
+icon_cache_create_owned(struct wl_event_loop *event_loop, char **dirs, size_t max_bytes)
+{
+	if (!dirs) {
+		return NULL;
+	}
+
+	struct cg_icon_cache *cache = calloc(1, sizeof(*cache));
+	if (!cache) {
+		wlr_log(WLR_ERROR, "Failed to allocate icon cache");
+		free_dirs(dirs);
+		return NULL;
+	}
+
+	cache->dirs = dirs;
+	cache->max_bytes = max_bytes;
+	wl_list_init(&cache->icons);
+	for (size_t i = 0; i < ICON_CACHE_BUCKETS; i++) {
+		wl_list_init(&cache->buckets[i]);
+	}
+	wl_list_init(&cache->queue);
+	wl_list_init(&cache->results);
+	wl_signal_init(&cache->events.ready);
+	pthread_mutex_init(&cache->lock, NULL);
+	pthread_cond_init(&cache->wake, NULL);
+
+	cache->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (cache->event_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to set up icon loader");
+		goto error;
+	}
+
+	cache->event_source =
+		wl_event_loop_add_fd(event_loop, cache->event_fd, WL_EVENT_READABLE, handle_icon_event, cache);
+	if (!cache->event_source) {
+		wlr_log(WLR_ERROR, "Failed to watch icon loader");
+		goto error;
+	}
+
+	int err = pthread_create(&cache->thread, NULL, icon_worker, cache);
+	if (err != 0) {
+		wlr_log(WLR_ERROR, "Failed to start icon loader: %s", strerror(err));
+		wl_event_source_remove(cache->event_source);
+		goto error;
+	}
+
+	return cache;
+
+error:
+	if (cache->event_fd >= 0) {
+		close(cache->event_fd);
+	}
+	pthread_cond_destroy(&cache->wake);
+	pthread_mutex_destroy(&cache->lock);
+	free_dirs(cache->dirs);
+	free(cache);
+	return NULL;
+}
+
+struct cg_icon_cache *
+icon_cache_create(struct wl_event_loop *event_loop)
+{
+	return icon_cache_create_owned(event_loop, get_default_dirs(), ICON_CACHE_MAX_BYTES);
+}
+
+struct cg_icon_cache *
+icon_cache_create_dirs(struct wl_event_loop *event_loop, const char *const *dirs, size_t max_bytes)
+{
+	size_t count = 0;
+	while (dirs && dirs[count]) {
+		count++;
+	}
+
+	char **copy = calloc(count + 1, sizeof(*copy));
+	if (!copy) {
+		return NULL;
+	}
+	for (size_t i = 0; i < count; i++) {
+		copy[i] = strdup(dirs[i]);
+		if (!copy[i]) {
+			free_dirs(copy);
+			return NULL;
+		}
+	}
+	return icon_cache_create_owned(event_loop, copy, max_bytes);
+}
+
+void
+icon_cache_destroy(struct cg_icon_cache *cache)
+{
+	if (!cache) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	cache->stop = true;
+	pthread_cond_signal(&cache->wake);
+	pthread_mutex_unlock(&cache->lock);
+	pthread_join(cache->thread, NULL);
+
+	wl_event_source_remove(cache->event_source);
+	close(cache->event_fd);
+
+	/* Icons still queued or handed back are on the icons list too */
+	struct cg_icon *icon, *tmp;
+	wl_list_for_each_safe(icon, tmp, &cache->icons, link) {
+		icon_destroy(cache, icon);
+	}
+
+	pthread_cond_destroy(&cache->wake);
+	pthread_mutex_destroy(&cache->lock);
+	free_dirs(cache->dirs);
+	free(cache);
+}
+
+cairo_surface_t *
+icon_cache_get(struct cg_icon_cache *cache, const char *name, int size)
+{
+	if (!cache || !name || name[0] == '\0' || size <= 0) {
+		return NULL;
+	}
+
+	uint32_t hash = hash_string(name);
+	struct wl_list *bucket = &cache->buckets[hash % ICON_CACHE_BUCKETS];
+	struct cg_icon *icon;
+	wl_list_for_each(icon, bucket, hash_link) {
+		if (icon->hash == hash && icon->size == size && strcmp(icon->name, name) == 0) {
+			wl_list_remove(&icon->link);
+			wl_list_insert(&cache->icons, &icon->link);
+			return icon->state == CG_ICON_READY ? icon->surface : NULL;
+		}
+	}
+
+	icon = calloc(1, sizeof(*icon));
+	if (!icon) {
+		return NULL;
+	}
+	icon->name = strdup(name);
+	if (!icon->name) {
+		free(icon);
+		return NULL;
+	}
+	icon->hash = hash;
+	icon->size = size;
+	icon->state = CG_ICON_PENDING;
+	icon->bytes = ICON_ENTRY_BYTES;
+	cache->bytes += icon->bytes;
+	wl_list_insert(&cache->icons, &icon->link);
+	wl_list_insert(bucket, &icon->hash_link);
+
+	/* Queued at the front and taken from the back, in request order */
+	pthread_mutex_lock(&cache->lock);
+	wl_list_insert(&cache->queue, &icon->queue_link);
+	pthread_cond_signal(&cache->wake);
+	pthread_mutex_unlock(&cache->lock);
+	return NULL;
+}
@@ -0,0 +1,115 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_ICON_H
+#define CG_ICON_H
+
+#include <cairo/cairo.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+/* Decoded icons kept at most, in bytes of pixels and entries */
+#define ICON_CACHE_MAX_BYTES (4 * 1024 * 1024)
+/* What an entry costs besides its pixels, so that missing icons count */
+#define ICON_ENTRY_BYTES 256
+#define ICON_CACHE_BUCKETS 256
+
+/*
+ * Application icons, looked up by the Icon key of desktop entries. Icons
+ * are found in the hicolor theme (the one every application installs
+ * into) and in the pixmaps directories, and decoded from PNG, on a worker
+ * thread: a lookup that misses the cache only queues the icon, and
+ * events.ready fires on the event loop once it is there. Decoded icons,
+ * and those known to be missing, are kept most recently used first, up to
+ * ICON_CACHE_MAX_BYTES, and found by a hash of their name.
+ */
+
+enum cg_icon_state {
+	CG_ICON_PENDING,  /* Queued for, or being decoded by, the worker */
+	CG_ICON_READY,
+	CG_ICON_MISSING,  /* Not found or not decodable */
+};
+
+struct cg_icon {
+	char *name;
+	uint32_t hash;             /* Of name */
+	int size;                  /* In pixels, square */
+	enum cg_icon_state state;
+	cairo_surface_t *surface;  /* READY only */
+	size_t bytes;              /* Pixels and ICON_ENTRY_BYTES */
+	struct wl_list link;       /* cg_icon_cache::icons, most recent first */
+	struct wl_list hash_link;  /* cg_icon_cache::buckets, by hash */
+	struct wl_list queue_link; /* Worker queue or results, while PENDING */
+};
+
+struct cg_icon_cache {
+	struct wl_list icons;  /* cg_icon::link */
+	struct wl_list buckets[ICON_CACHE_BUCKETS];  /* cg_icon::hash_link, by hash % ICON_CACHE_BUCKETS */
+	size_t bytes;
+	size_t max_bytes;
+
+	/* Base directories searched, NULL-terminated */
+	char **dirs;
+
+	/* Shared with the worker, under lock */
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	struct wl_list queue;    /* cg_icon::queue_link, to decode */
+	struct wl_list results;  /* cg_icon::queue_link, decoded */
+	bool stop;
+
+	int event_fd;
+	struct wl_event_source *event_source;
+
+	struct {
+		struct wl_signal ready;  /* An icon is decoded or missing; data is its name */
+	} events;
+};
+
+/**
+ * Create an icon cache searching the XDG icon directories, with its
+ * worker thread. Returns NULL on failure.
+ */
+struct cg_icon_cache *icon_cache_create(struct wl_event_loop *event_loop);
+
+/**
+ * Like icon_cache_create(), searching a NULL-terminated list of base
+ * directories (such as /usr/share/icons) instead, and keeping up to
+ * max_bytes of icons.
+ */
+struct cg_icon_cache *icon_cache_create_dirs(struct wl_event_loop *event_loop, const char *const *dirs,
+					     size_t max_bytes);
+
+void icon_cache_destroy(struct cg_icon_cache *cache);
+
+/**
+ * Drop every decoded icon, and what is known to be missing. Icons being
+ * decoded are kept. Returns the bytes freed.
+ */
+size_t icon_cache_trim(struct cg_icon_cache *cache);
+
+/**
+ * The icon called name, at size pixels square. Returns NULL until it is
+ * decoded, queuing it if it wasn't, and if it can't be found. The surface
+ * belongs to the cache, and is valid until control returns to the event
+ * loop.
+ */
+cairo_surface_t *icon_cache_get(struct cg_icon_cache *cache, const char *name, int size);
+
+/**
+ * Find the file of the icon named name, closest to size pixels, under a
+ * NULL-terminated list of base directories. Names that are absolute paths
+ * are taken as they are. Returns an allocated path, or NULL.
+ */
+char *icon_find_path(const char *const *dirs, const char *name, int size);
+
+#endif
@@ -110,3 +110,61 @@ keybinding_match(const struct keybinding *binding, uint32_t modifiers, xkb_keysy
 	}
 	return binding->modifiers == modifiers && binding->keysym == keysym;
 }
+
+static uint32_t
+keybinding_hash(uint32_t modifiers, uint32_t keysym)
+{
+	uint32_t hash = keysym * 0x9e3779b1u;
+	hash ^= modifiers * 0x85ebca6bu;
+	return hash ^ (hash >> 16);
+}
+
+void
+keybinding_table_init(struct keybinding_table *table)
+{
+	memset(table, 0, sizeof(*table));
+}
+
+bool
+keybinding_table_add(struct keybinding_table *table, const struct keybinding *binding,
+		     const struct action *action)
+{
+	/* Keep a free slot, so lookups of unbound keys always end */
+	if (!binding || !action || action->type == ACTION_NONE || table->count >= KEYBINDING_TABLE_SIZE - 1) {
+		return false;
+	}
+
+	uint32_t slot = keybinding_hash(binding->modifiers, binding->keysym) & (KEYBINDING_TABLE_SIZE - 1);
+	while (table->entries[slot].action.type != ACTION_NONE) {
+		if (keybinding_match(&table->entries[slot].binding, binding->modifiers, binding->keysym)) {
+			return false;
+		}
+		slot = (slot + 1) & (KEYBINDING_TABLE_SIZE - 1);
+	}
+
+	table->entries[slot].binding = *binding;
+	table->entries[slot].action = *action;
+	table->count++;
+	table->modifiers |= binding->modifiers;
+	if (binding->modifiers == 0) {
+		table->has_unmodified = true;
+	}
+	return true;
+}
+
+const struct action *
+keybinding_table_lookup(const struct keybinding_table *table, uint32_t modifiers, uint32_t keysym)
+{
+	if (modifiers == 0 ? !table->has_unmodified : (modifiers & ~table->modifiers) != 0) {
+		return NULL;
+	}
+
+	uint32_t slot = keybinding_hash(modifiers, keysym) & (KEYBINDING_TABLE_SIZE - 1);
+	while (table->entries[slot].action.type != ACTION_NONE) {
+		if (keybinding_match(&table->entries[slot].binding, modifiers, keysym)) {
+			return &table->entries[slot].action;
+		}
+		slot = (slot + 1) & (KEYBINDING_TABLE_SIZE - 1);
+	}
+	return NULL;
+}
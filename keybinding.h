@@ -13,6 +13,8 @@
 #include <stdbool.h>
 #include <xkbcommon/xkbcommon.h>
 
+#include "action.h"
+
 /* Keybinding structure: holds a modifier mask and keysym */
 struct keybinding {
 	uint32_t modifiers; /* WLR_MODIFIER_* flags */
@@ -34,6 +36,37 @@ bool keybinding_parse(const char *str, struct keybinding *binding);
  */
 bool keybinding_match(const struct keybinding *binding, uint32_t modifiers, uint32_t keysym);
 
+/* Must be a power of two, and well above the number of actions */
+#define KEYBINDING_TABLE_SIZE 64
+
+/* Bindings compiled into an open-addressing hash table keyed by
+ * (modifiers, keysym), so a key press costs one lookup however many
+ * actions are bound */
+struct keybinding_table {
+	struct keybinding_table_entry {
+		struct keybinding binding;
+		struct action action; /* Of type ACTION_NONE for free slots */
+	} entries[KEYBINDING_TABLE_SIZE];
+	int count;
+
+	/* Every modifier used by some binding, and whether any binding has
+	 * no modifiers, to skip lookups for plain typing */
+	uint32_t modifiers;
+	bool has_unmodified;
+};
+
+void keybinding_table_init(struct keybinding_table *table);
+
+/* Bind a key to an action. If the key is already bound, the earlier
+ * binding is kept. Returns false if the table is full or the key was
+ * already bound. */
+bool keybinding_table_add(struct keybinding_table *table, const struct keybinding *binding,
+			  const struct action *action);
+
+/* Find the action bound to a key, or NULL */
+const struct action *keybinding_table_lookup(const struct keybinding_table *table, uint32_t modifiers,
+					     uint32_t keysym);
+
 /* Default keybindings */
 #define KEYBINDING_DEFAULT_NEXT_TAB     &(struct keybinding){WLR_MODIFIER_LOGO, XKB_KEY_k}
 #define KEYBINDING_DEFAULT_PREV_TAB     &(struct keybinding){WLR_MODIFIER_LOGO, XKB_KEY_j}
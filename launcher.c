@@ -1,15 +1,21 @@
 #include "launcher.h"
+#include "font.h"
 #include "desktop_entry.h"
+#include "icon.h"
+#include "memory_policy.h"
 #include "output.h"
+#include "overlay.h"
 #include "pixel_buffer.h"
+#include "resources.h"
 #include "server.h"
+#include "spawner.h"
+#include "stats.h"
+#include "trace.h"
 #include <wlr/util/log.h>
 #include <xkbcommon/xkbcommon.h>
 #include <unistd.h>
 #include <sys/wait.h>
-#include <signal.h>
 #include <fcntl.h>
-#include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 #include <cairo/cairo.h>
@@ -30,361 +36,191 @@ static const float launcher_box_bg[4] = {0.12f, 0.12f, 0.12f, 1.0f};  /* Dark bo
 static const float launcher_selected_bg[4] = {0.22f, 0.33f, 0.44f, 1.0f};  /* Selected item */
 static const float launcher_text[4] = {1.0f, 1.0f, 1.0f, 1.0f};  /* White text */
 static const float launcher_query_bg[4] = {0.08f, 0.08f, 0.08f, 1.0f};  /* Search box */
+static const float launcher_scrollbar[4] = {1.0f, 1.0f, 1.0f, 0.3f};  /* Scroll position */
+static const float launcher_icon_placeholder[4] = {1.0f, 1.0f, 1.0f, 0.12f};  /* Icon not loaded yet */
 
-/* Render launcher UI to a buffer */
-static struct wlr_buffer *
-render_launcher_ui(struct cg_launcher *launcher, int screen_width, int screen_height)
+/* Application icons, in logical pixels, left of the names */
+#define LAUNCHER_ICON_SIZE 24
+#define LAUNCHER_ICON_X 20
+#define LAUNCHER_TEXT_X (LAUNCHER_ICON_X + LAUNCHER_ICON_SIZE + 10)
+
+/* Draw the entry's icon, or a placeholder while it is decoded or if it
+ * has none. Never waits for the icon. */
+static void
+render_entry_icon(struct cg_launcher *launcher, cairo_t *cr, struct cg_desktop_entry *entry, int item_y)
 {
-	/* Launcher box dimensions - only render the box, not the whole screen */
-	(void)screen_width;
-	(void)screen_height;
-	int box_width = 600;
-	int box_height = 400;
-
-	/* Only allocate buffer for the launcher box area */
-	size_t stride = box_width * 4;
-	size_t size = box_height * stride;
-	uint32_t *data = calloc(1, size);
-	if (!data) {
-		return NULL;
+	double x = LAUNCHER_ICON_X;
+	double y = item_y + (OVERLAY_ITEM_HEIGHT - 5 - LAUNCHER_ICON_SIZE) / 2.0;
+
+	/* Decoded at the pixel size of the output the launcher is on */
+	int pixels = (int)(LAUNCHER_ICON_SIZE * launcher->overlay.scale + 0.5);
+	cairo_surface_t *icon = icon_cache_get(launcher->icons, entry->icon, pixels);
+	if (!icon) {
+		cairo_set_source_rgba(cr, launcher_icon_placeholder[0], launcher_icon_placeholder[1],
+				    launcher_icon_placeholder[2], launcher_icon_placeholder[3]);
+		cairo_rectangle(cr, x, y, LAUNCHER_ICON_SIZE, LAUNCHER_ICON_SIZE);
+		cairo_fill(cr);
+		return;
 	}
 
-	/* Create cairo surface */
-	cairo_surface_t *surface = cairo_image_surface_create_for_data(
-		(unsigned char *)data, CAIRO_FORMAT_ARGB32, box_width, box_height, stride);
-	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
-		free(data);
-		return NULL;
-	}
+	cairo_save(cr);
+	cairo_translate(cr, x, y);
+	cairo_scale(cr, (double)LAUNCHER_ICON_SIZE / pixels, (double)LAUNCHER_ICON_SIZE / pixels);
+	cairo_set_source_surface(cr, icon, 0, 0);
+	cairo_paint(cr);
+	cairo_restore(cr);
+}
+
+/* Repaint the damaged parts of the launcher box */
+static void
+render_launcher_ui(struct cg_launcher *launcher)
+{
+	TRACE_SCOPE("render_launcher_ui");
 
-	cairo_t *cr = cairo_create(surface);
+	struct cg_overlay *overlay = &launcher->overlay;
+	cairo_t *cr = overlay_begin_paint(overlay, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT);
 	if (!cr) {
-		cairo_surface_destroy(surface);
-		free(data);
-		return NULL;
+		return;
 	}
 
 	/* Draw launcher box background */
 	cairo_set_source_rgba(cr, launcher_box_bg[0], launcher_box_bg[1],
 			    launcher_box_bg[2], launcher_box_bg[3]);
-	cairo_rectangle(cr, 0, 0, box_width, box_height);
-	cairo_fill(cr);
-
-	/* Draw search box at top */
-	int search_height = 50;
-	cairo_set_source_rgba(cr, launcher_query_bg[0], launcher_query_bg[1],
-			    launcher_query_bg[2], launcher_query_bg[3]);
-	cairo_rectangle(cr, 0, 0, box_width, search_height);
+	cairo_rectangle(cr, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT);
 	cairo_fill(cr);
 
-	/* Draw search query text */
-	cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL,
-			      CAIRO_FONT_WEIGHT_NORMAL);
-	cairo_set_font_size(cr, 14);
-	cairo_set_source_rgb(cr, launcher_text[0], launcher_text[1], launcher_text[2]);
+	font_apply(launcher->font, cr);
 
-	/* Draw query text with cursor */
-	char query_display[LAUNCHER_MAX_QUERY + 2];
-	snprintf(query_display, sizeof(query_display), "%s|", launcher->query);
-	cairo_move_to(cr, 15, 30);
-	cairo_show_text(cr, query_display);
+	/* Draw search box at top */
+	if (overlay_needs_paint(overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT)) {
+		cairo_set_source_rgba(cr, launcher_query_bg[0], launcher_query_bg[1],
+				    launcher_query_bg[2], launcher_query_bg[3]);
+		cairo_rectangle(cr, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT);
+		cairo_fill(cr);
 
-	/* Draw results list */
-	int results_y = search_height + 10;
-	int item_height = 40;
-	int max_items = (box_height - search_height - 20) / item_height;
+		/* Draw query text with cursor */
+		cairo_set_source_rgb(cr, launcher_text[0], launcher_text[1], launcher_text[2]);
+		char query_display[LAUNCHER_MAX_QUERY + 2];
+		snprintf(query_display, sizeof(query_display), "%s|", launcher->query);
+		cairo_move_to(cr, 15, 30);
+		cairo_show_text(cr, query_display);
+	}
 
-	for (size_t i = 0; i < launcher->result_count && i < (size_t)max_items; i++) {
-		int item_y = results_y + i * item_height;
+	/* Draw results list, skipping rows that are not damaged */
+	for (size_t i = 0; i < launcher->row_count; i++) {
+		int item_y = OVERLAY_RESULTS_Y + i * OVERLAY_ITEM_HEIGHT;
+		if (!overlay_needs_paint(overlay, 0, item_y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT)) {
+			continue;
+		}
 
 		/* Highlight selected item */
-		if (i == launcher->selected_index) {
+		if (launcher->view.first + i == launcher->view.selected) {
 			cairo_set_source_rgba(cr, launcher_selected_bg[0],
 					    launcher_selected_bg[1],
 					    launcher_selected_bg[2],
 					    launcher_selected_bg[3]);
-			cairo_rectangle(cr, 10, item_y, box_width - 20, item_height - 5);
+			cairo_rectangle(cr, 10, item_y, OVERLAY_BOX_WIDTH - 20, OVERLAY_ITEM_HEIGHT - 5);
 			cairo_fill(cr);
 		}
 
-		/* Draw application name */
-		struct cg_desktop_entry *entry = launcher->results[i];
+		/* Draw application icon and name */
+		struct cg_desktop_entry *entry = launcher->rows[i];
+		render_entry_icon(launcher, cr, entry, item_y);
 		cairo_set_source_rgb(cr, launcher_text[0], launcher_text[1], launcher_text[2]);
-		cairo_move_to(cr, 20, item_y + 25);
+		cairo_move_to(cr, LAUNCHER_TEXT_X, item_y + 25);
 
 		/* Truncate name if too long */
-		char name_display[100];
-		snprintf(name_display, sizeof(name_display), "%s", entry->name);
+		char name_display[256];
+		font_truncate_to_width(launcher->font, entry->name, OVERLAY_BOX_WIDTH - LAUNCHER_TEXT_X - 20,
+				       name_display, sizeof(name_display));
 		cairo_show_text(cr, name_display);
 	}
 
-	cairo_destroy(cr);
-	cairo_surface_finish(surface);
-	cairo_surface_destroy(surface);
-
-	/* Create wlr_buffer wrapper */
-	struct pixel_buffer *buffer = calloc(1, sizeof(*buffer));
-	if (!buffer) {
-		free(data);
-		return NULL;
+	/* Show where the window is within a longer list. Drawn whole every
+	 * time; the clip limits it to the damaged rows. */
+	struct cg_result_view *view = &launcher->view;
+	if (view->total > view->rows) {
+		double track = view->rows * OVERLAY_ITEM_HEIGHT;
+		double height = track * view->rows / view->total;
+		if (height < 10) {
+			height = 10;
+		}
+		double y = OVERLAY_RESULTS_Y + (track - height) * view->first / (view->total - view->rows);
+		cairo_set_source_rgba(cr, launcher_scrollbar[0], launcher_scrollbar[1],
+				    launcher_scrollbar[2], launcher_scrollbar[3]);
+		cairo_rectangle(cr, OVERLAY_BOX_WIDTH - 8, y, 4, height);
+		cairo_fill(cr);
 	}
 
-	wlr_buffer_init(&buffer->base, &pixel_buffer_impl, box_width, box_height);
-	buffer->data = data;
-	buffer->width = box_width;
-	buffer->height = box_height;
-	buffer->size = size;
+	/* Applications are still being scanned in the background */
+	bool loading = launcher->server->desktop_entries && launcher->server->desktop_entries->loading;
+	if (view->total == 0 && loading &&
+	    overlay_needs_paint(overlay, 0, OVERLAY_RESULTS_Y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT)) {
+		cairo_set_source_rgb(cr, launcher_text[0], launcher_text[1], launcher_text[2]);
+		cairo_move_to(cr, 20, OVERLAY_RESULTS_Y + 25);
+		cairo_show_text(cr, "Loading applications...");
+	}
 
-	return &buffer->base;
+	overlay_end_paint(overlay, cr, launcher->content_buffer);
 }
 
 /* Update the rendered launcher UI */
-static void
-launcher_update_render(struct cg_launcher *launcher)
+void
+launcher_flush(struct cg_launcher *launcher)
 {
-	if (!launcher->content_buffer || !launcher->is_visible || !launcher->dirty) {
+	if (!launcher || !launcher->content_buffer || !launcher->is_visible || !launcher->dirty) {
 		return;
 	}
 
-	/* Get output dimensions and position */
-	struct cg_output *output;
-	wl_list_for_each(output, &launcher->server->outputs, link) {
-		int screen_width = output->wlr_output->width;
-		int screen_height = output->wlr_output->height;
-
-		/* Calculate position for centered launcher box */
-		int box_width = 600;
-		int box_height = 400;
-		int box_x = (screen_width - box_width) / 2;
-		int box_y = (screen_height - box_height) / 2;
-
-		/* Position the content buffer at the correct location */
-		wlr_scene_node_set_position(&launcher->content_buffer->node,
-					    box_x, box_y);
-
-		/* Render new UI */
-		struct wlr_buffer *new_buffer = render_launcher_ui(launcher,
-								screen_width, screen_height);
-		if (new_buffer) {
-			wlr_scene_buffer_set_buffer(launcher->content_buffer, new_buffer);
-			wlr_buffer_drop(new_buffer);
-		}
-
-		launcher->dirty = false;
+	/* Center the launcher box on the focused output, at its scale */
+	int box_x, box_y;
+	struct cg_output *output =
+		output_center_box(launcher->server, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT, &box_x, &box_y);
+	if (output) {
+		wlr_scene_node_set_position(&launcher->content_buffer->node, box_x, box_y);
+		overlay_set_scale(&launcher->overlay, output->wlr_output->scale);
 
-		break; /* Use first output */
-	}
-}
+		/* Repaint what changed */
+		uint64_t start = stats_now();
+		render_launcher_ui(launcher);
+		stats_record(STATS_LAUNCHER_RENDER, start);
 
-/*
- * Parse Exec field from desktop entry.
- * Removes XDG format codes (%f, %u, %F, %U, %i, %c, etc.)
- * Returns a newly allocated string that must be freed by caller.
- */
-static char *
-parse_exec_command(const char *exec)
-{
-	if (!exec) {
-		return NULL;
-	}
-
-	char *result = malloc(strlen(exec) + 1);
-	if (!result) {
-		return NULL;
-	}
-
-	size_t j = 0;
-	for (size_t i = 0; exec[i] != '\0'; i++) {
-		/* Handle format codes: %f, %u, %F, %U, %i, %c, %k, %v */
-		if (exec[i] == '%' && exec[i + 1] != '\0') {
-			char code = exec[i + 1];
-			/* Skip known format codes */
-			if (code == 'f' || code == 'u' || code == 'F' || code == 'U' ||
-			    code == 'i' || code == 'c' || code == 'k' || code == 'v' ||
-			    code == 'd' || code == 'D' || code == 'n' || code == 'N' ||
-			    code == 'm' || code == '%') {
-				/* Skip the percent sign, and handle double %% */
-				if (code != '%') {
-					i++; /* Skip the code character too */
-					continue;
-				}
-				/* %% becomes a single % */
-			}
-		}
-		result[j++] = exec[i];
+		launcher->dirty = false;
 	}
-	result[j] = '\0';
-
-	return result;
 }
 
-/*
- * Split command string into argv array.
- * Handles simple quoted strings (single and double quotes).
- * Returns NULL on failure.
- */
-static char **
-parse_argv(const char *command, int *argc_out)
+/* Coalesce changes into one repaint on the next output frame */
+static void
+launcher_schedule_render(struct cg_launcher *launcher)
 {
-	if (!command || !argc_out) {
-		return NULL;
-	}
-
-	/* Count arguments to allocate array */
-	int argc = 0;
-	size_t len = strlen(command);
-	bool in_quotes = false;
-	bool in_single_quotes = false;
-
-	/* First pass: count arguments */
-	for (size_t i = 0; i < len; i++) {
-		if (command[i] == '\'' && !in_quotes) {
-			in_single_quotes = !in_single_quotes;
-		} else if (command[i] == '"' && !in_single_quotes) {
-			in_quotes = !in_quotes;
-		} else if (isspace(command[i]) && !in_quotes && !in_single_quotes) {
-			/* Space outside quotes separates arguments */
-			if (i > 0 && !isspace(command[i - 1])) {
-				argc++;
-			}
-		}
-	}
-	/* Count last argument if exists */
-	if (len > 0 && !isspace(command[len - 1])) {
-		argc++;
-	}
-
-	if (argc == 0) {
-		return NULL;
-	}
-
-	/* Allocate argv array (+1 for NULL terminator) */
-	char **argv = calloc(argc + 1, sizeof(char *));
-	if (!argv) {
-		return NULL;
-	}
-
-	/* Second pass: extract arguments */
-	int arg_idx = 0;
-	size_t arg_start = 0;
-	in_quotes = false;
-	in_single_quotes = false;
-
-	for (size_t i = 0; i <= len; i++) {
-		if (i < len) {
-			if (command[i] == '\'' && !in_quotes) {
-				in_single_quotes = !in_single_quotes;
-				if (arg_idx == 0 || (i > 0 && isspace(command[i - 1]))) {
-					arg_start = i + 1;
-				}
-				continue;
-			} else if (command[i] == '"' && !in_single_quotes) {
-				in_quotes = !in_quotes;
-				if (arg_idx == 0 || (i > 0 && isspace(command[i - 1]))) {
-					arg_start = i + 1;
-				}
-				continue;
-			}
-		}
-
-		/* End of argument: space outside quotes or end of string */
-		if ((i == len || (isspace(command[i]) && !in_quotes && !in_single_quotes)) &&
-		    (i > arg_start)) {
-			size_t arg_len = i - arg_start;
-			argv[arg_idx] = malloc(arg_len + 1);
-			if (!argv[arg_idx]) {
-				/* Cleanup on failure */
-				for (int k = 0; k < arg_idx; k++) {
-					free(argv[k]);
-				}
-				free(argv);
-				return NULL;
-			}
-			memcpy(argv[arg_idx], command + arg_start, arg_len);
-			argv[arg_idx][arg_len] = '\0';
-			arg_idx++;
-			arg_start = i + 1;
-		}
-	}
-
-	argv[arg_idx] = NULL;
-	*argc_out = argc;
-
-	return argv;
+	launcher->dirty = true;
+	output_schedule_frames(launcher->server);
 }
 
-/* Spawn an application from a desktop entry */
+/* Spawn an application from a desktop entry. Its argv was split when the
+ * entry was loaded. */
 static bool
-spawn_application(struct cg_server *server, const char *exec)
+spawn_application(struct cg_server *server, const struct cg_desktop_entry *entry)
 {
-	if (!exec) {
-		wlr_log(WLR_ERROR, "Cannot spawn application: exec is NULL");
-		return false;
-	}
-
-	/* Parse and clean the exec command */
-	char *command = parse_exec_command(exec);
-	if (!command) {
-		wlr_log(WLR_ERROR, "Failed to parse exec command: %s", exec);
-		return false;
-	}
-
-	/* Parse command into argv */
-	int argc;
-	char **argv = parse_argv(command, &argc);
-	free(command);
-
-	if (!argv || argc == 0) {
-		wlr_log(WLR_ERROR, "Failed to parse argv from command: %s", exec);
-		return false;
+	/* Spawn with the compositor's environment */
+	pid_t pid = -1;
+	struct cg_spawn_env env;
+	if (spawn_env_init(&env)) {
+		pid = resources_spawn(server->resources, NULL, entry->argv, &env, NULL, NULL);
+		spawn_env_finish(&env);
 	}
 
-	/* Log the command we're about to execute */
-	wlr_log(WLR_INFO, "Spawning application:");
-	for (int i = 0; i < argc; i++) {
-		wlr_log(WLR_INFO, "  argv[%d] = %s", i, argv[i]);
-	}
-
-	/* Fork and execute */
-	pid_t pid = fork();
-	if (pid == 0) {
-		/* Child process */
-		sigset_t set;
-		sigemptyset(&set);
-		sigprocmask(SIG_SETMASK, &set, NULL);
-
-		/* Reset signal handlers */
-		signal(SIGCHLD, SIG_DFL);
-		signal(SIGINT, SIG_DFL);
-		signal(SIGTERM, SIG_DFL);
-		signal(SIGHUP, SIG_DFL);
-
-		/* Execute the application */
-		execvp(argv[0], argv);
-
-		/* execvp only returns on failure */
-		wlr_log_errno(WLR_ERROR, "Failed to execute %s", argv[0]);
-		_exit(1);
-	} else if (pid < 0) {
-		/* Fork failed */
-		wlr_log_errno(WLR_ERROR, "Failed to fork for application launch");
-		for (int i = 0; i < argc; i++) {
-			free(argv[i]);
-		}
-		free(argv);
+	if (pid < 0) {
 		return false;
 	}
 
-	/* Parent process - cleanup argv */
-	for (int i = 0; i < argc; i++) {
-		free(argv[i]);
-	}
-	free(argv);
-
 	wlr_log(WLR_INFO, "Application spawned with pid %d", pid);
 	return true;
 }
 
+static void handle_entries_changed(struct wl_listener *listener, void *data);
+static void handle_icon_ready(struct wl_listener *listener, void *data);
+
 struct cg_launcher *
 launcher_create(struct cg_server *server)
 {
@@ -399,14 +235,22 @@ launcher_create(struct cg_server *server)
 	launcher->dirty = false;
 	launcher->query[0] = '\0';
 	launcher->query_len = 0;
-	launcher->result_count = 0;
-	launcher->selected_index = 0;
+	result_view_reset(&launcher->view, 0, OVERLAY_MAX_ITEMS);
+	launcher->row_count = 0;
 	launcher->content_buffer = NULL;
+	overlay_init(&launcher->overlay);
+
+	launcher->font = font_create("sans-serif", 14);
+	if (!launcher->font) {
+		free(launcher);
+		return NULL;
+	}
 
 	/* Create scene tree for launcher overlay */
 	launcher->scene_tree = wlr_scene_tree_create(&server->scene->tree);
 	if (!launcher->scene_tree) {
 		wlr_log(WLR_ERROR, "Failed to create launcher scene tree");
+		font_destroy(launcher->font);
 		free(launcher);
 		return NULL;
 	}
@@ -422,6 +266,7 @@ launcher_create(struct cg_server *server)
 	if (!launcher->background) {
 		wlr_log(WLR_ERROR, "Failed to create launcher background");
 		wlr_scene_node_destroy(&launcher->scene_tree->node);
+		font_destroy(launcher->font);
 		free(launcher);
 		return NULL;
 	}
@@ -430,6 +275,25 @@ launcher_create(struct cg_server *server)
 	wlr_scene_node_set_enabled(&launcher->scene_tree->node, false);
 	wlr_scene_node_raise_to_top(&launcher->scene_tree->node);
 
+	/* Refresh results as applications finish loading */
+	launcher->entries_changed.notify = handle_entries_changed;
+	if (server->desktop_entries) {
+		wl_signal_add(&server->desktop_entries->events.changed, &launcher->entries_changed);
+	} else {
+		wl_list_init(&launcher->entries_changed.link);
+	}
+
+	/* Icons are decoded in the background; rows show placeholders
+	 * until they are ready, or without the cache */
+	launcher->icons = icon_cache_create(wl_display_get_event_loop(server->wl_display));
+	launcher->icon_ready.notify = handle_icon_ready;
+	if (launcher->icons) {
+		wl_signal_add(&launcher->icons->events.ready, &launcher->icon_ready);
+	} else {
+		wlr_log(WLR_ERROR, "Launcher icons are unavailable");
+		wl_list_init(&launcher->icon_ready.link);
+	}
+
 	wlr_log(WLR_DEBUG, "Launcher created");
 	return launcher;
 }
@@ -441,43 +305,120 @@ launcher_destroy(struct cg_launcher *launcher)
 		return;
 	}
 
+	wl_list_remove(&launcher->entries_changed.link);
+	wl_list_remove(&launcher->icon_ready.link);
+	icon_cache_destroy(launcher->icons);
+
 	/* Scene tree cleanup is handled by wlroots when destroyed */
 	wlr_scene_node_destroy(&launcher->scene_tree->node);
+	overlay_finish(&launcher->overlay);
+	font_destroy(launcher->font);
 	free(launcher);
 
 	wlr_log(WLR_DEBUG, "Launcher destroyed");
 }
 
+/* Fetch the entries of the visible window */
+static void
+launcher_fetch_rows(struct cg_launcher *launcher)
+{
+	launcher->row_count = 0;
+	if (!launcher->server->desktop_entries) {
+		return;
+	}
+
+	launcher->row_count = desktop_entry_manager_get_results(launcher->server->desktop_entries,
+								 launcher->view.first, launcher->rows,
+								 OVERLAY_MAX_ITEMS);
+}
+
 /* Update filtered results based on current query */
 static void
 launcher_update_results(struct cg_launcher *launcher)
 {
 	/* Initialize results */
-	launcher->result_count = 0;
-	launcher->selected_index = 0;
+	result_view_reset(&launcher->view, 0, OVERLAY_MAX_ITEMS);
+	launcher->row_count = 0;
 
 	if (!launcher->server->desktop_entries) {
 		return;
 	}
 
-	/* Search desktop entries directly into launcher's results array */
-	launcher->result_count = desktop_entry_manager_search(
-		launcher->server->desktop_entries,
-		launcher->query,
-		launcher->results,
-		256  /* max_results */
-	);
+	/* Rank every match, but only fetch the rows that fit on screen */
+	size_t total = desktop_entry_manager_query(launcher->server->desktop_entries, launcher->query);
+	result_view_reset(&launcher->view, total, OVERLAY_MAX_ITEMS);
+	launcher_fetch_rows(launcher);
 
 	/* Log results for debugging */
 	wlr_log(WLR_DEBUG, "Launcher query: '%s', results: %zu",
-	        launcher->query, launcher->result_count);
-	for (size_t i = 0; i < launcher->result_count; i++) {
-		wlr_log(WLR_DEBUG, "  [%zu] %s", i, launcher->results[i]->name);
+	        launcher->query, total);
+	for (size_t i = 0; i < launcher->row_count; i++) {
+		wlr_log(WLR_DEBUG, "  [%zu] %s", i, launcher->rows[i]->name);
 	}
 
-	/* Mark as dirty for re-rendering */
-	launcher->dirty = true;
-	launcher_update_render(launcher);
+	/* The query line and the whole result list change */
+	overlay_damage_query(&launcher->overlay);
+	overlay_damage_results(&launcher->overlay);
+	launcher_schedule_render(launcher);
+}
+
+/* Move the selection, scrolling the window if it leaves it */
+static void
+launcher_move_selection(struct cg_launcher *launcher, long delta, bool wrap)
+{
+	struct cg_result_view *view = &launcher->view;
+	if (view->total == 0) {
+		return;
+	}
+
+	overlay_damage_row(&launcher->overlay, view->selected - view->first);
+	if (result_view_move(view, delta, wrap)) {
+		launcher_fetch_rows(launcher);
+		overlay_damage_results(&launcher->overlay);
+	} else {
+		overlay_damage_row(&launcher->overlay, view->selected - view->first);
+	}
+
+	wlr_log(WLR_DEBUG, "Selected: %zu/%zu", view->selected, view->total);
+	launcher_schedule_render(launcher);
+}
+
+static void
+handle_entries_changed(struct wl_listener *listener, void *data)
+{
+	struct cg_launcher *launcher = wl_container_of(listener, launcher, entries_changed);
+
+	/* Results may point at entries that were just removed or replaced */
+	if (launcher->is_visible) {
+		launcher_update_results(launcher);
+	} else {
+		result_view_reset(&launcher->view, 0, OVERLAY_MAX_ITEMS);
+		launcher->row_count = 0;
+	}
+}
+
+/* Repaint the rows showing an icon that just became ready */
+static void
+handle_icon_ready(struct wl_listener *listener, void *data)
+{
+	struct cg_launcher *launcher = wl_container_of(listener, launcher, icon_ready);
+	const char *name = data;
+
+	if (!launcher->is_visible) {
+		return;
+	}
+
+	bool damaged = false;
+	for (size_t i = 0; i < launcher->row_count; i++) {
+		const char *icon = launcher->rows[i]->icon;
+		if (icon && strcmp(icon, name) == 0) {
+			overlay_damage_row(&launcher->overlay, i);
+			damaged = true;
+		}
+	}
+	if (damaged) {
+		launcher_schedule_render(launcher);
+	}
 }
 
 void
@@ -490,25 +431,18 @@ launcher_show(struct cg_launcher *launcher)
 	/* Reset query and show all applications */
 	launcher->query[0] = '\0';
 	launcher->query_len = 0;
-	launcher->selected_index = 0;
 
-	/* Get the first output's dimensions */
-	struct cg_output *output;
-	wl_list_for_each(output, &launcher->server->outputs, link) {
-		struct wlr_output *wlr_output = output->wlr_output;
-		int width = wlr_output->width;
-		int height = wlr_output->height;
-
-		/* Resize background to match output */
-		wlr_scene_rect_set_size(launcher->background, width, height);
+	/* Cover the focused output with the background */
+	struct wlr_box box;
+	if (output_focused_box(launcher->server, &box)) {
+		wlr_scene_rect_set_size(launcher->background, box.width, box.height);
+		wlr_scene_node_set_position(&launcher->background->node, box.x, box.y);
 
 		/* Create content buffer for UI if not exists */
 		if (!launcher->content_buffer) {
 			launcher->content_buffer =
 				wlr_scene_buffer_create(launcher->scene_tree, NULL);
 		}
-
-		break; /* Use first output for now */
 	}
 
 	wlr_scene_node_set_enabled(&launcher->scene_tree->node, true);
@@ -530,10 +464,25 @@ launcher_hide(struct cg_launcher *launcher)
 
 	wlr_scene_node_set_enabled(&launcher->scene_tree->node, false);
 	launcher->is_visible = false;
+	memory_policy_schedule_trim(launcher->server->memory);
 
 	wlr_log(WLR_DEBUG, "Launcher hidden");
 }
 
+size_t
+launcher_release(struct cg_launcher *launcher)
+{
+	if (!launcher || launcher->is_visible) {
+		return 0;
+	}
+
+	size_t bytes = overlay_release(&launcher->overlay, launcher->content_buffer);
+	if (launcher->icons) {
+		bytes += icon_cache_trim(launcher->icons);
+	}
+	return bytes;
+}
+
 void
 launcher_toggle(struct cg_launcher *launcher)
 {
@@ -566,15 +515,15 @@ launcher_handle_key(struct cg_launcher *launcher, xkb_keysym_t sym, uint32_t key
 
 	case XKB_KEY_Return:
 		/* Launch selected application */
-		if (launcher->result_count > 0 &&
-		    launcher->selected_index < launcher->result_count) {
+		if (launcher->view.total > 0 &&
+		    launcher->view.selected - launcher->view.first < launcher->row_count) {
 			struct cg_desktop_entry *entry =
-				launcher->results[launcher->selected_index];
+				launcher->rows[launcher->view.selected - launcher->view.first];
 			wlr_log(WLR_INFO, "Launching: %s (%s)",
 			        entry->name, entry->exec);
 
 			/* Spawn the application */
-			if (spawn_application(launcher->server, entry->exec)) {
+			if (spawn_application(launcher->server, entry)) {
 				wlr_log(WLR_INFO, "Successfully launched: %s", entry->name);
 			} else {
 				wlr_log(WLR_ERROR, "Failed to launch: %s", entry->name);
@@ -597,33 +546,21 @@ launcher_handle_key(struct cg_launcher *launcher, xkb_keysym_t sym, uint32_t key
 		break;
 
 	case XKB_KEY_Up:
-		/* Navigate up in results */
-		if (launcher->result_count > 0) {
-			if (launcher->selected_index > 0) {
-				launcher->selected_index--;
-			} else {
-				/* Wrap to bottom */
-				launcher->selected_index = launcher->result_count - 1;
-			}
-			wlr_log(WLR_DEBUG, "Selected: %zu/%zu",
-			        launcher->selected_index, launcher->result_count);
-			launcher->dirty = true;
-			launcher_update_render(launcher);
-		}
+		/* Navigate up in results, wrapping to the bottom */
+		launcher_move_selection(launcher, -1, true);
 		break;
 
 	case XKB_KEY_Down:
-		/* Navigate down in results */
-		if (launcher->result_count > 0) {
-			launcher->selected_index++;
-			if (launcher->selected_index >= launcher->result_count) {
-				launcher->selected_index = 0;  /* Wrap to top */
-			}
-			wlr_log(WLR_DEBUG, "Selected: %zu/%zu",
-			        launcher->selected_index, launcher->result_count);
-			launcher->dirty = true;
-			launcher_update_render(launcher);
-		}
+		/* Navigate down in results, wrapping to the top */
+		launcher_move_selection(launcher, 1, true);
+		break;
+
+	case XKB_KEY_Page_Up:
+		launcher_move_selection(launcher, -OVERLAY_MAX_ITEMS, false);
+		break;
+
+	case XKB_KEY_Page_Down:
+		launcher_move_selection(launcher, OVERLAY_MAX_ITEMS, false);
 		break;
 
 	default:
@@ -6,16 +6,24 @@
 #include <wlr/util/box.h>
 #include <xkbcommon/xkbcommon.h>
 
+#include "overlay.h"
+#include "result_view.h"
+
 #define LAUNCHER_MAX_QUERY 256
 
 struct cg_server;
+struct cg_font;
 struct cg_desktop_entry;
+struct cg_icon_cache;
 
 struct cg_launcher {
 	struct cg_server *server;
 	struct wlr_scene_tree *scene_tree;
 	struct wlr_scene_rect *background;
+	struct cg_font *font;
+	struct cg_icon_cache *icons;              /* NULL if icons can't be loaded */
 	struct wlr_scene_buffer *content_buffer;  /* Rendered launcher UI */
+	struct cg_overlay overlay;                /* Retained pixels and damage */
 	bool is_visible;
 	bool dirty;  /* UI needs re-rendering */
 
@@ -23,10 +31,13 @@ struct cg_launcher {
 	char query[LAUNCHER_MAX_QUERY];
 	size_t query_len;
 
-	/* Filtered results */
-	struct cg_desktop_entry *results[256];  /* Simplified: fixed array */
-	size_t result_count;
-	size_t selected_index;
+	/* Filtered results; only the visible window is fetched */
+	struct cg_result_view view;
+	struct cg_desktop_entry *rows[OVERLAY_MAX_ITEMS];
+	size_t row_count;
+
+	struct wl_listener entries_changed;
+	struct wl_listener icon_ready;
 };
 
 struct cg_launcher *launcher_create(struct cg_server *server);
@@ -35,6 +46,12 @@ void launcher_show(struct cg_launcher *launcher);
 void launcher_hide(struct cg_launcher *launcher);
 void launcher_toggle(struct cg_launcher *launcher);
 
+/* Drop the pixels and icons of a hidden launcher; returns the bytes freed */
+size_t launcher_release(struct cg_launcher *launcher);
+
+/* Repaint pending changes; called once per output frame */
+void launcher_flush(struct cg_launcher *launcher);
+
 /* Keyboard input handling */
 bool launcher_handle_key(struct cg_launcher *launcher, xkb_keysym_t sym, uint32_t keycode);
 
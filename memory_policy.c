@@ -0,0 +1,224 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "background_dialog.h"
+#include "launcher.h"
+#include "memory_policy.h"
+#include "pixel_buffer.h"
+#include "profile_selector.h"
+#include "resources.h"
+#include "server.h"
+#include "stats.h"
+
+/* Some task stalled on memory for 150 ms within 2 s; the shortest window
+ * unprivileged triggers may use */
+#define PRESSURE_TRIGGER "some 150000 2000000"
+
+/* Resident set size of WayMux, 0 if unknown */
+static uint64_t
+resident_bytes(void)
+{
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (!f) {
+		return 0;
+	}
+	unsigned long long size, resident;
+	int n = fscanf(f, "%llu %llu", &size, &resident);
+	fclose(f);
+	return n == 2 ? resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+uint64_t
+memory_policy_trim(struct cg_memory_policy *policy, bool pressure)
+{
+	struct cg_server *server = policy->server;
+	uint64_t before = resident_bytes();
+
+	/* Overlays being shown keep theirs */
+	size_t released = launcher_release(server->launcher);
+	released += background_dialog_release(server->background_dialog);
+	released += profile_selector_release(server->profile_selector);
+
+	/* The overlays' pixels went back to the pool */
+	pixel_buffer_pool_trim();
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+
+	uint64_t after = resident_bytes();
+	uint64_t reclaimed = before > after ? before - after : 0;
+
+	policy->trims++;
+	policy->reclaimed += reclaimed;
+	stats_count(STATS_MEMORY_TRIMS, 1);
+	stats_count(STATS_MEMORY_RECLAIMED, reclaimed);
+	if (pressure) {
+		policy->pressure_trims++;
+		stats_count(STATS_MEMORY_PRESSURE, 1);
+	}
+
+	wlr_log(WLR_DEBUG, "Trimmed memory%s: released %zu bytes of pixels and icons, %llu bytes reclaimed",
+		pressure ? " under pressure" : "", released, (unsigned long long)reclaimed);
+	return reclaimed;
+}
+
+void
+memory_policy_schedule_trim(struct cg_memory_policy *policy)
+{
+	if (policy) {
+		wl_event_source_timer_update(policy->trim_timer, MEMORY_TRIM_DELAY_MS);
+	}
+}
+
+static int
+handle_trim_timer(void *data)
+{
+	memory_policy_trim(data, false);
+	return 0;
+}
+
+static int
+handle_pressure(int fd, uint32_t mask, void *data)
+{
+	struct cg_memory_policy *policy = data;
+
+	struct epoll_event events[1];
+	int n = epoll_wait(policy->epoll_fd, events, 1, 0);
+	if (n <= 0) {
+		return 0;
+	}
+	if (events[0].events & EPOLLERR) {
+		/* The cgroup went away */
+		wlr_log(WLR_INFO, "Memory pressure trigger lost");
+		wl_event_source_remove(policy->pressure_source);
+		policy->pressure_source = NULL;
+		epoll_ctl(policy->epoll_fd, EPOLL_CTL_DEL, policy->pressure_fd, NULL);
+		close(policy->pressure_fd);
+		policy->pressure_fd = -1;
+		return 0;
+	}
+
+	/* A trim now supersedes the idle one */
+	wl_event_source_timer_update(policy->trim_timer, 0);
+	memory_policy_trim(policy, true);
+	return 0;
+}
+
+/* Open a PSI trigger on the given pressure file, -1 if unavailable */
+static int
+open_trigger(const char *path)
+{
+	int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	if (write(fd, PRESSURE_TRIGGER, sizeof(PRESSURE_TRIGGER)) < 0) {
+		wlr_log(WLR_DEBUG, "Failed to set a memory pressure trigger on %s: %s", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static bool
+watch_pressure(struct cg_memory_policy *policy, struct wl_event_loop *event_loop)
+{
+	const char *path = NULL;
+	char cgroup_path[PATH_MAX];
+	struct cg_resources *resources = policy->server->resources;
+	if (resources && resources->root) {
+		snprintf(cgroup_path, sizeof(cgroup_path), "%s/memory.pressure", resources->root);
+		policy->pressure_fd = open_trigger(cgroup_path);
+		path = cgroup_path;
+	}
+	if (policy->pressure_fd < 0) {
+		path = "/proc/pressure/memory";
+		policy->pressure_fd = open_trigger(path);
+	}
+	if (policy->pressure_fd < 0) {
+		wlr_log(WLR_INFO, "Memory pressure is not available, trimming memory when idle only");
+		return true;
+	}
+
+	policy->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (policy->epoll_fd < 0) {
+		wlr_log(WLR_ERROR, "Failed to create an epoll instance: %s", strerror(errno));
+		return false;
+	}
+	struct epoll_event event = {.events = EPOLLPRI};
+	if (epoll_ctl(policy->epoll_fd, EPOLL_CTL_ADD, policy->pressure_fd, &event) < 0) {
+		wlr_log(WLR_ERROR, "Failed to watch memory pressure: %s", strerror(errno));
+		return false;
+	}
+	policy->pressure_source =
+		wl_event_loop_add_fd(event_loop, policy->epoll_fd, WL_EVENT_READABLE, handle_pressure, policy);
+	if (!policy->pressure_source) {
+		wlr_log(WLR_ERROR, "Failed to watch memory pressure");
+		return false;
+	}
+
+	wlr_log(WLR_DEBUG, "Trimming memory under pressure, from %s", path);
+	return true;
+}
+
+struct cg_memory_policy *
+memory_policy_create(struct cg_server *server, struct wl_event_loop *event_loop)
+{
+	struct cg_memory_policy *policy = calloc(1, sizeof(*policy));
+	if (!policy) {
+		wlr_log(WLR_ERROR, "Failed to allocate memory policy");
+		return NULL;
+	}
+	policy->server = server;
+	policy->pressure_fd = -1;
+	policy->epoll_fd = -1;
+
+	policy->trim_timer = wl_event_loop_add_timer(event_loop, handle_trim_timer, policy);
+	if (!policy->trim_timer || !watch_pressure(policy, event_loop)) {
+		memory_policy_destroy(policy);
+		return NULL;
+	}
+	return policy;
+}
+
+void
+memory_policy_destroy(struct cg_memory_policy *policy)
+{
+	if (!policy) {
+		return;
+	}
+
+	if (policy->pressure_source) {
+		wl_event_source_remove(policy->pressure_source);
+	}
+	if (policy->epoll_fd >= 0) {
+		close(policy->epoll_fd);
+	}
+	if (policy->pressure_fd >= 0) {
+		close(policy->pressure_fd);
+	}
+	if (policy->trim_timer) {
+		wl_event_source_remove(policy->trim_timer);
+	}
+	free(policy);
+}
@@ -0,0 +1,66 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_MEMORY_POLICY_H
+#define CG_MEMORY_POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+struct cg_server;
+
+/* How long an overlay stays hidden before its memory is given back */
+#define MEMORY_TRIM_DELAY_MS 10000
+
+/*
+ * Gives back memory WayMux holds for later while it isn't needed. Some
+ * seconds after the launcher, background dialog or profile selector is
+ * hidden, or whenever the system is short of memory, the hidden overlays
+ * drop their pixels, the icon cache and pixel buffer pool are emptied, and
+ * the allocator returns its free pages to the kernel.
+ *
+ * Memory pressure is watched with a PSI trigger on WayMux's cgroup if it
+ * has one, or on the whole system otherwise. The trigger is polled for
+ * EPOLLPRI, which the event loop doesn't wait for, so it sits in an epoll
+ * instance of its own whose readability the event loop watches.
+ */
+struct cg_memory_policy {
+	struct cg_server *server;
+	struct wl_event_source *trim_timer;
+	int pressure_fd;   /* The PSI trigger, -1 if unavailable */
+	int epoll_fd;
+	struct wl_event_source *pressure_source;
+
+	uint64_t trims;
+	uint64_t pressure_trims;
+	uint64_t reclaimed;  /* Bytes */
+};
+
+/**
+ * Start trimming the server's memory. Returns NULL on failure.
+ */
+struct cg_memory_policy *memory_policy_create(struct cg_server *server, struct wl_event_loop *event_loop);
+
+/**
+ * Stop trimming. NULL-safe.
+ */
+void memory_policy_destroy(struct cg_memory_policy *policy);
+
+/**
+ * Trim after MEMORY_TRIM_DELAY_MS, unless scheduled again meanwhile.
+ * NULL-safe, for when there is no policy.
+ */
+void memory_policy_schedule_trim(struct cg_memory_policy *policy);
+
+/**
+ * Trim now. Returns the bytes reclaimed.
+ */
+uint64_t memory_policy_trim(struct cg_memory_policy *policy, bool pressure);
+
+#endif
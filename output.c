@@ -11,7 +11,9 @@
 #include "config.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
 #include <wlr/backend.h>
@@ -25,6 +27,7 @@
 #include <wlr/types/wlr_compositor.h>
 #include <wlr/types/wlr_data_device.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_layer.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_output_management_v1.h>
 #include <wlr/types/wlr_output_swapchain_manager.h>
@@ -33,11 +36,22 @@
 #include <wlr/util/log.h>
 #include <wlr/util/region.h>
 
+#include "background_dialog.h"
+#include "launcher.h"
+#include "stats.h"
+#include "tab_switcher.h"
 #include "output.h"
 #include "seat.h"
+#include "tab.h"
 #include "server.h"
+#include "tab_bar.h"
+#include "trace.h"
 #include "view.h"
+#include "waymux_config.h"
 #include "profile_selector.h"
+#if WAYMUX_HAS_STATS
+#include "stats_hud.h"
+#endif
 #if WAYMUX_HAS_XWAYLAND
 #include "xwayland.h"
 #endif
@@ -132,20 +146,486 @@ output_disable(struct cg_output *output)
 	output_layout_remove(output);
 }
 
+static bool
+is_tab_bar_node(struct cg_server *server, struct wlr_scene_node *node)
+{
+	if (server->tab_bar && node == &server->tab_bar->scene_tree->node) {
+		return true;
+	}
+	struct cg_output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (output->tab_bar && node == &output->tab_bar->scene_tree->node) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool
+output_only_tabs_shown(struct cg_server *server)
+{
+	/* The launcher, dialogs, switcher, HUD and drag icons all live at the
+	 * top of the scene graph */
+	struct wlr_scene_node *node;
+	wl_list_for_each (node, &server->scene->tree.children, link) {
+		if (node->enabled && node != &server->tabs_tree->node && !is_tab_bar_node(server, node)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* The tab an output shows: its own with separate outputs */
+static struct cg_tab *
+output_shown_tab(struct cg_output *output)
+{
+	if (output->server->output_mode == WAYMUX_MULTI_OUTPUT_MODE_SEPARATE) {
+		return output->active_tab;
+	}
+	return output->server->active_tab;
+}
+
+/* The view to hand to the parent compositor instead of compositing it, if
+ * it's all there is to show: the active tab's view, alone, on the only
+ * output or on its own with separate outputs, opaque and without
+ * subsurfaces or popups, with nothing shown over it. The tab bar is fine,
+ * since it doesn't overlap the view. */
+static struct cg_view *
+passthrough_candidate(struct cg_output *output)
+{
+	struct cg_server *server = output->server;
+	bool alone = server->output_mode == WAYMUX_MULTI_OUTPUT_MODE_SEPARATE || wl_list_length(&server->outputs) == 1;
+	if (!server->config->output_passthrough || !output->passthrough_layer || !alone ||
+	    output->wlr_output->transform != WL_OUTPUT_TRANSFORM_NORMAL) {
+		return NULL;
+	}
+
+	struct cg_tab *tab = output_shown_tab(output);
+	struct cg_view *view = tab ? tab->view : NULL;
+	if (!view || !view->wlr_surface || !view->scene_tree) {
+		return NULL;
+	}
+
+	if (!output_only_tabs_shown(server)) {
+		return NULL;
+	}
+
+	struct wlr_surface *surface = view->wlr_surface;
+	if (!surface->buffer || surface->current.transform != WL_OUTPUT_TRANSFORM_NORMAL ||
+	    !wl_list_empty(&surface->current.subsurfaces_below) ||
+	    !wl_list_empty(&surface->current.subsurfaces_above) || wl_list_length(&view->scene_tree->children) != 1) {
+		return NULL;
+	}
+
+	pixman_box32_t box = {0, 0, surface->current.width, surface->current.height};
+	if (pixman_region32_contains_rectangle(&surface->opaque_region, &box) != PIXMAN_REGION_IN) {
+		return NULL;
+	}
+
+	return view;
+}
+
+static void
+passthrough_end(struct cg_output *output)
+{
+	if (!output->passthrough_view) {
+		return;
+	}
+
+	wl_list_remove(&output->passthrough_tree_destroy.link);
+	wl_list_remove(&output->passthrough_surface_commit.link);
+	wlr_scene_node_set_enabled(&output->passthrough_view->scene_tree->node, true);
+	output->passthrough_view = NULL;
+}
+
+static void
+handle_passthrough_tree_destroy(struct wl_listener *listener, void *data)
+{
+	struct cg_output *output = wl_container_of(listener, output, passthrough_tree_destroy);
+
+	wl_list_remove(&output->passthrough_tree_destroy.link);
+	wl_list_remove(&output->passthrough_surface_commit.link);
+	output->passthrough_view = NULL;
+
+	/* Take the buffer off the layer in the next frame */
+	wlr_output_schedule_frame(output->wlr_output);
+}
+
+/* The scene graph doesn't schedule frames for a hidden view */
+static void
+handle_passthrough_surface_commit(struct wl_listener *listener, void *data)
+{
+	struct cg_output *output = wl_container_of(listener, output, passthrough_surface_commit);
+
+	output->passthrough_dirty = true;
+	wlr_output_schedule_frame(output->wlr_output);
+}
+
+static void
+passthrough_begin(struct cg_output *output, struct cg_view *view)
+{
+	passthrough_end(output);
+
+	output->passthrough_view = view;
+	output->passthrough_dirty = true;
+	output->passthrough_rejected = false;
+	output->passthrough_tree_destroy.notify = handle_passthrough_tree_destroy;
+	wl_signal_add(&view->scene_tree->node.events.destroy, &output->passthrough_tree_destroy);
+	output->passthrough_surface_commit.notify = handle_passthrough_surface_commit;
+	wl_signal_add(&view->wlr_surface->events.commit, &output->passthrough_surface_commit);
+
+	wlr_scene_node_set_enabled(&view->scene_tree->node, false);
+}
+
+/* Commit a frame with the view's buffer on the passthrough layer and the
+ * rest of the scene composited below it. Returns false, with the view back
+ * in the scene, if the view can't be passed through and the frame has to be
+ * composited as usual. */
+static bool
+output_commit_passthrough(struct cg_output *output)
+{
+	struct cg_view *view = passthrough_candidate(output);
+	if (!view) {
+		passthrough_end(output);
+		return false;
+	}
+
+	if (view != output->passthrough_view) {
+		passthrough_begin(output, view);
+	} else if (output->passthrough_rejected) {
+		return false;
+	}
+
+	/* Hiding the view made the scene graph tell it that it left the output */
+	struct wlr_surface *surface = view->wlr_surface;
+	wlr_surface_send_enter(surface, output->wlr_output);
+
+	if (!output->passthrough_dirty && !wlr_scene_output_needs_frame(output->scene_output)) {
+		return true;
+	}
+
+	int lx, ly;
+	wlr_scene_node_coords(&view->scene_tree->node, &lx, &ly);
+	float scale = output->wlr_output->scale;
+	struct wlr_output_layer_state layer_state = {
+		.layer = output->passthrough_layer,
+		.buffer = &surface->buffer->base,
+		.dst_box =
+			{
+				.x = round((lx - output->scene_output->x) * scale),
+				.y = round((ly - output->scene_output->y) * scale),
+				.width = round(surface->current.width * scale),
+				.height = round(surface->current.height * scale),
+			},
+		.damage = &surface->buffer_damage,
+	};
+	wlr_surface_get_buffer_source_box(surface, &layer_state.src_box);
+
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	wlr_output_state_set_layers(&state, &layer_state, 1);
+
+	bool built = wlr_scene_output_build_state(output->scene_output, &state, NULL);
+	if (built && (!wlr_output_test_state(output->wlr_output, &state) || !layer_state.accepted)) {
+		/* Keep the view, so that it isn't tried again on every frame */
+		wlr_log(WLR_DEBUG, "Output %s can't pass through the active tab's buffer, compositing it",
+			output->wlr_output->name);
+		wlr_output_state_finish(&state);
+		output->passthrough_rejected = true;
+		wlr_scene_node_set_enabled(&view->scene_tree->node, true);
+		return false;
+	}
+
+	bool ok = built && wlr_output_commit_state(output->wlr_output, &state);
+	wlr_output_state_finish(&state);
+	if (!ok) {
+		passthrough_end(output);
+		return false;
+	}
+
+	output->passthrough_dirty = false;
+	output->passthrough_layer_shown = true;
+	return true;
+}
+
+/* Commit a composited frame, taking the buffer off the passthrough layer if
+ * one was passed through until now */
+static void
+output_commit_scene(struct cg_output *output)
+{
+	if (!output->passthrough_layer_shown) {
+		wlr_scene_output_commit(output->scene_output, NULL);
+		return;
+	}
+
+	struct wlr_output_layer_state layer_state = {.layer = output->passthrough_layer};
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	wlr_output_state_set_layers(&state, &layer_state, 1);
+	if (wlr_scene_output_build_state(output->scene_output, &state, NULL) &&
+	    wlr_output_commit_state(output->wlr_output, &state)) {
+		output->passthrough_layer_shown = false;
+	}
+	wlr_output_state_finish(&state);
+}
+
+static int64_t
+timespec_to_ns(const struct timespec *ts)
+{
+	return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static void
+handle_output_present(struct wl_listener *listener, void *data)
+{
+	struct cg_output *output = wl_container_of(listener, output, present);
+	struct wlr_output_event_present *event = data;
+
+	if (event->presented) {
+		output->last_presentation_ns = timespec_to_ns(&event->when);
+		output->refresh_ns = event->refresh;
+	}
+}
+
+/* The refresh period in ns, from presentation feedback or else the mode;
+ * 0 if unknown */
+static int64_t
+output_refresh_ns(struct cg_output *output)
+{
+	if (output->refresh_ns > 0) {
+		return output->refresh_ns;
+	}
+	if (output->wlr_output->refresh > 0) {
+		return 1000000000000LL / output->wlr_output->refresh;
+	}
+	return 0;
+}
+
+/* The first vblank after now, predicted from the last presentation; 0 if
+ * it can't be, such as with a variable refresh rate */
+static int64_t
+output_next_vblank(struct cg_output *output, int64_t now)
+{
+	int64_t refresh = output_refresh_ns(output);
+	if (refresh == 0 || output->last_presentation_ns == 0 || now < output->last_presentation_ns ||
+	    output->wlr_output->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED) {
+		return 0;
+	}
+	int64_t periods = (now - output->last_presentation_ns) / refresh + 1;
+	return output->last_presentation_ns + periods * refresh;
+}
+
+/* How long to put off rendering the frame, so that it is rendered
+ * max_render_time before the next vblank and shows the input received
+ * meanwhile; 0 to render now */
+static int
+output_render_delay_ms(struct cg_output *output, int64_t now)
+{
+	int max_render_time = output->server->config->max_render_time;
+	if (max_render_time == 0 || !output->render_timer) {
+		return 0;
+	}
+	int64_t vblank = output_next_vblank(output, now);
+	if (vblank == 0) {
+		return 0;
+	}
+	int64_t delay = (vblank - now) / 1000000 - max_render_time;
+	return delay >= 1 ? (int)delay : 0;
+}
+
+/* How long to hold back the active tab's frame callbacks after a frame,
+ * so that its client draws as late as it can and still makes the next
+ * frame; 0 to send them now */
+static int
+output_client_frame_delay_ms(struct cg_output *output, int64_t now)
+{
+	struct waymux_config *config = output->server->config;
+	if (config->active_tab_render_time == 0 || !output->client_frame_timer) {
+		return 0;
+	}
+	int64_t vblank = output_next_vblank(output, now);
+	if (vblank == 0) {
+		return 0;
+	}
+
+	/* The frame just committed is shown at that vblank, and the next one
+	 * rendered max_render_time before the one after, or else as soon as
+	 * this one is shown */
+	int64_t refresh = output_refresh_ns(output);
+	int64_t render_time = config->max_render_time > 0 ? config->max_render_time * 1000000LL : refresh;
+	int64_t deadline = vblank + refresh - render_time - config->active_tab_render_time * 1000000LL;
+	int64_t delay = (deadline - now) / 1000000;
+	return delay >= 1 ? (int)delay : 0;
+}
+
+struct frame_done_data {
+	struct wlr_scene_output *scene_output;
+	struct wlr_scene_tree *skip;  /* Held back, may be NULL */
+	const struct timespec *when;
+};
+
+static bool
+node_is_in(struct wlr_scene_node *node, struct wlr_scene_tree *tree)
+{
+	for (; node; node = node->parent ? &node->parent->node : NULL) {
+		if (node == &tree->node) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void
+send_frame_done_iterator(struct wlr_scene_buffer *buffer, int sx, int sy, void *user_data)
+{
+	struct frame_done_data *data = user_data;
+	if (buffer->primary_output != data->scene_output || (data->skip && node_is_in(&buffer->node, data->skip))) {
+		return;
+	}
+	struct wlr_scene_surface *scene_surface = wlr_scene_surface_try_from_buffer(buffer);
+	if (scene_surface) {
+		wlr_surface_send_frame_done(scene_surface->surface, data->when);
+	}
+}
+
+/* Send the frame callbacks of the view shown on the output */
+static void
+output_send_view_frame_done(struct cg_output *output, struct cg_view *view, const struct timespec *when)
+{
+	if (view == output->passthrough_view && !output->passthrough_rejected) {
+		wlr_surface_send_frame_done(view->wlr_surface, when);
+		return;
+	}
+	struct frame_done_data data = {.scene_output = output->scene_output, .when = when};
+	wlr_scene_node_for_each_buffer(&view->scene_tree->node, send_frame_done_iterator, &data);
+}
+
+static int
+handle_client_frame_timer(void *data)
+{
+	struct cg_output *output = data;
+	struct cg_tab *tab = output_shown_tab(output);
+	if (tab && tab->view && output->scene_output) {
+		struct timespec now = {0};
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		output_send_view_frame_done(output, tab->view, &now);
+	}
+	return 0;
+}
+
+/* Tell the clients shown on the output that they may draw their next
+ * frame; the active tab's client possibly later */
+static void
+output_send_frame_done(struct cg_output *output, const struct timespec *now)
+{
+	struct cg_tab *tab = output_shown_tab(output);
+	struct cg_view *view = tab ? tab->view : NULL;
+	int delay_ms = view ? output_client_frame_delay_ms(output, timespec_to_ns(now)) : 0;
+
+	if (delay_ms == 0) {
+		wlr_scene_output_send_frame_done(output->scene_output, now);
+		if (output->passthrough_view && !output->passthrough_rejected) {
+			wlr_surface_send_frame_done(output->passthrough_view->wlr_surface, now);
+		}
+		return;
+	}
+
+	struct frame_done_data data = {.scene_output = output->scene_output, .skip = view->scene_tree, .when = now};
+	wlr_scene_output_for_each_buffer(output->scene_output, send_frame_done_iterator, &data);
+	wl_event_source_timer_update(output->client_frame_timer, delay_ms);
+}
+
+static void
+output_render(struct cg_output *output)
+{
+	TRACE_SCOPE("output_render");
+
+	uint64_t frame_start = stats_now();
+
+	/* Apply the UI changes accumulated since the last frame. Only the
+	 * first output to reach its frame does any work. */
+	struct cg_server *server = output->server;
+	tab_bar_flush(server->tab_bar);
+	tab_bar_flush(output->tab_bar);
+	launcher_flush(server->launcher);
+	background_dialog_flush(server->background_dialog);
+	tab_switcher_flush(server->tab_switcher);
+	profile_selector_flush(server->profile_selector);
+#if WAYMUX_HAS_STATS
+	stats_hud_flush(server->stats_hud);
+#endif
+
+	uint64_t commit_start = stats_now();
+	if (!output_commit_passthrough(output)) {
+		output_commit_scene(output);
+	}
+	stats_record(STATS_SCENE_COMMIT, commit_start);
+
+	struct timespec now = {0};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	output_send_frame_done(output, &now);
+
+	/* Trace point: time from a tab switch to the frame showing it */
+	if (server->tab_switch_started.tv_sec || server->tab_switch_started.tv_nsec) {
+		long us = (now.tv_sec - server->tab_switch_started.tv_sec) * 1000000L +
+			  (now.tv_nsec - server->tab_switch_started.tv_nsec) / 1000L;
+		wlr_log(WLR_DEBUG, "Tab switch latency: %ld us", us);
+		server->tab_switch_started = (struct timespec){0};
+	}
+
+	/* A tab's first frame is the first one after it was mapped that
+	 * shows it */
+	struct cg_tab *active = output_shown_tab(output);
+	if (active && active->map_time_ns) {
+		stats_tab_first_frame(active->id, active->map_time_ns);
+		active->map_time_ns = 0;
+	}
+
+	stats_record(STATS_FRAME, frame_start);
+}
+
+static int
+handle_render_timer(void *data)
+{
+	struct cg_output *output = data;
+	output->render_pending = false;
+	if (output->wlr_output->enabled && output->scene_output) {
+		output_render(output);
+	}
+	return 0;
+}
+
 static void
 handle_output_frame(struct wl_listener *listener, void *data)
 {
+	TRACE_SCOPE("handle_output_frame");
+
 	struct cg_output *output = wl_container_of(listener, output, frame);
 
-	if (!output->wlr_output->enabled || !output->scene_output) {
+	if (!output->wlr_output->enabled || !output->scene_output || output->render_pending) {
 		return;
 	}
 
-	wlr_scene_output_commit(output->scene_output, NULL);
-
 	struct timespec now = {0};
 	clock_gettime(CLOCK_MONOTONIC, &now);
-	wlr_scene_output_send_frame_done(output->scene_output, &now);
+	int delay_ms = output_render_delay_ms(output, timespec_to_ns(&now));
+	if (delay_ms > 0) {
+		output->render_pending = true;
+		wl_event_source_timer_update(output->render_timer, delay_ms);
+		return;
+	}
+	output_render(output);
+}
+
+void
+output_schedule_frames(struct cg_server *server)
+{
+	struct cg_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->wlr_output->enabled) {
+			wlr_output_schedule_frame(output->wlr_output);
+		}
+	}
 }
 
 static void
@@ -195,6 +675,7 @@ handle_output_layout_change(struct wl_listener *listener, void *data)
 	struct cg_server *server = wl_container_of(listener, server, output_layout_change);
 
 	view_position_all(server);
+	tab_bar_schedule_update_all(server);
 	update_output_manager_config(server);
 }
 
@@ -220,11 +701,33 @@ output_destroy(struct cg_output *output)
 
 	output->wlr_output->data = NULL;
 
+	passthrough_end(output);
+	if (output->passthrough_layer) {
+		wlr_output_layer_destroy(output->passthrough_layer);
+	}
+
 	wl_list_remove(&output->destroy.link);
 	wl_list_remove(&output->commit.link);
 	wl_list_remove(&output->request_state.link);
 	wl_list_remove(&output->frame.link);
+	wl_list_remove(&output->present.link);
 	wl_list_remove(&output->link);
+	if (output->render_timer) {
+		wl_event_source_remove(output->render_timer);
+	}
+	if (output->client_frame_timer) {
+		wl_event_source_remove(output->client_frame_timer);
+	}
+
+	/* Separate outputs leave their tabs to the next one */
+	if (server->output_mode == WAYMUX_MULTI_OUTPUT_MODE_SEPARATE) {
+		struct cg_output *next = NULL;
+		if (!wl_list_empty(&server->outputs)) {
+			next = wl_container_of(server->outputs.next, next, link);
+		}
+		tab_move_output_tabs(server, output, next);
+		tab_bar_destroy(output->tab_bar);
+	}
 
 	output_layout_remove(output);
 
@@ -287,6 +790,15 @@ handle_new_output(struct wl_listener *listener, void *data)
 	wl_signal_add(&wlr_output->events.destroy, &output->destroy);
 	output->frame.notify = handle_output_frame;
 	wl_signal_add(&wlr_output->events.frame, &output->frame);
+	output->present.notify = handle_output_present;
+	wl_signal_add(&wlr_output->events.present, &output->present);
+
+	struct wl_event_loop *event_loop = wl_display_get_event_loop(server->wl_display);
+	output->render_timer = wl_event_loop_add_timer(event_loop, handle_render_timer, output);
+	output->client_frame_timer = wl_event_loop_add_timer(event_loop, handle_client_frame_timer, output);
+	if (!output->render_timer || !output->client_frame_timer) {
+		wlr_log(WLR_ERROR, "Failed to create the frame timers of output %s", wlr_output->name);
+	}
 
 	output->scene_output = wlr_scene_output_create(server->scene, wlr_output);
 	if (!output->scene_output) {
@@ -294,6 +806,29 @@ handle_new_output(struct wl_listener *listener, void *data)
 		return;
 	}
 
+	/* Only the Wayland backend shows layers, as subsurfaces of its window */
+	if (server->config->output_passthrough && wlr_output_is_wl(wlr_output)) {
+		output->passthrough_layer = wlr_output_layer_create(wlr_output);
+	}
+
+	/* Separate outputs have their own tab bar, below the overlays like
+	 * the server's; the first one takes the tabs opened without one */
+	if (server->output_mode == WAYMUX_MULTI_OUTPUT_MODE_SEPARATE) {
+		output->tab_bar = tab_bar_create(server, output);
+		if (!output->tab_bar) {
+			wlr_log(WLR_ERROR, "Failed to create the tab bar of output %s", wlr_output->name);
+		} else {
+			wlr_scene_node_place_above(&output->tab_bar->scene_tree->node, &server->tabs_tree->node);
+		}
+
+		struct cg_tab *tab;
+		wl_list_for_each (tab, &server->tabs, link) {
+			if (!tab->output) {
+				tab_set_output(tab, output);
+			}
+		}
+	}
+
 	struct wlr_output_state state = {0};
 	wlr_output_state_set_enabled(&state, true);
 	if (!wl_list_empty(&wlr_output->modes)) {
@@ -335,6 +870,45 @@ handle_new_output(struct wl_listener *listener, void *data)
 	update_output_manager_config(output->server);
 }
 
+struct wlr_surface *
+output_passthrough_surface_at(struct cg_server *server, double lx, double ly, double *sx, double *sy)
+{
+	struct cg_output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		struct cg_view *view = output->passthrough_view;
+		if (!view || output->passthrough_rejected) {
+			continue;
+		}
+
+		/* A passed through view has no subsurfaces or popups */
+		int vx, vy;
+		wlr_scene_node_coords(&view->scene_tree->node, &vx, &vy);
+		if (wlr_surface_point_accepts_input(view->wlr_surface, lx - vx, ly - vy)) {
+			*sx = lx - vx;
+			*sy = ly - vy;
+			return view->wlr_surface;
+		}
+	}
+
+	return NULL;
+}
+
+void
+output_update_passthrough(struct cg_server *server)
+{
+	/* Layers are kept once created; with passthrough turned off the
+	 * next frame ends it and the layer is no longer shown */
+	struct cg_output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (server->config->output_passthrough && !output->passthrough_layer &&
+		    wlr_output_is_wl(output->wlr_output)) {
+			output->passthrough_layer = wlr_output_layer_create(output->wlr_output);
+		}
+	}
+
+	output_schedule_frames(server);
+}
+
 void
 output_set_window_title(struct cg_output *output, const char *title)
 {
@@ -445,3 +1019,87 @@ handle_output_manager_test(struct wl_listener *listener, void *data)
 
 	wlr_output_configuration_v1_destroy(config);
 }
+
+struct cg_output *
+output_focused(struct cg_server *server)
+{
+	if (server->active_tab && server->active_tab->output) {
+		return server->active_tab->output;
+	}
+
+	struct cg_output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (output->wlr_output->enabled) {
+			return output;
+		}
+	}
+	return NULL;
+}
+
+struct cg_output *
+output_from_name(struct cg_server *server, const char *name)
+{
+	char *end;
+	long index = strtol(name, &end, 10);
+	bool by_index = *name != '\0' && *end == '\0';
+
+	struct cg_output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (by_index ? index-- == 0 : strcmp(output->wlr_output->name, name) == 0) {
+			return output;
+		}
+	}
+	return NULL;
+}
+
+struct cg_tab *
+output_tab_at(struct cg_server *server, double lx, double ly)
+{
+	if (server->output_mode != WAYMUX_MULTI_OUTPUT_MODE_SEPARATE) {
+		return server->active_tab;
+	}
+
+	struct wlr_output *wlr_output = wlr_output_layout_output_at(server->output_layout, lx, ly);
+	struct cg_output *output = wlr_output ? wlr_output->data : NULL;
+	return output ? output->active_tab : NULL;
+}
+
+struct cg_output *
+output_focused_box(struct cg_server *server, struct wlr_box *box)
+{
+	struct cg_output *output = output_focused(server);
+	if (output) {
+		wlr_output_layout_get_box(server->output_layout, output->wlr_output, box);
+	}
+	return output;
+}
+
+struct cg_output *
+output_center_box(struct cg_server *server, int width, int height, int *x, int *y)
+{
+	struct wlr_box box;
+	struct cg_output *output = output_focused_box(server, &box);
+	if (!output) {
+		return NULL;
+	}
+
+	*x = box.x + (box.width - width) / 2;
+	*y = box.y + (box.height - height) / 2;
+	return output;
+}
+
+float
+output_ui_scale(struct cg_server *server, struct cg_output *output)
+{
+	if (output) {
+		return output->wlr_output->scale;
+	}
+
+	float scale = 1;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (output->wlr_output->enabled && output->wlr_output->scale > scale) {
+			scale = output->wlr_output->scale;
+		}
+	}
+	return scale;
+}
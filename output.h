@@ -3,6 +3,7 @@
 
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/util/box.h>
 
 #include "server.h"
 #include "view.h"
@@ -16,6 +17,35 @@ struct cg_output {
 	struct wl_listener request_state;
 	struct wl_listener destroy;
 	struct wl_listener frame;
+	struct wl_listener present;
+
+	/* Frame scheduling: when the last frame was shown and the refresh
+	 * period, from presentation feedback, in ns on CLOCK_MONOTONIC; 0
+	 * if unknown. The frame is rendered from render_timer, just before
+	 * the next vblank, if the output has a max_render_time, and the
+	 * active tab's frame callbacks are sent from client_frame_timer if
+	 * it has an active_tab_render_time. */
+	int64_t last_presentation_ns;
+	int64_t refresh_ns;
+	struct wl_event_source *render_timer;
+	struct wl_event_source *client_frame_timer;
+	bool render_pending;
+
+	/* Passthrough: the layer the active tab's buffer is handed to the
+	 * parent compositor on, and the view hidden from the composited frame
+	 * while it is. NULL without passthrough. */
+	struct wlr_output_layer *passthrough_layer;
+	struct cg_view *passthrough_view;
+	bool passthrough_dirty;
+	bool passthrough_rejected;
+	bool passthrough_layer_shown;
+	struct wl_listener passthrough_tree_destroy;
+	struct wl_listener passthrough_surface_commit;
+
+	/* Separate outputs only: the tab shown on this output, and the tab
+	 * bar of the tabs on it; NULL otherwise */
+	struct cg_tab *active_tab;
+	struct cg_tab_bar *tab_bar;
 
 	struct wl_list link; // cg_server::outputs
 };
@@ -26,4 +56,47 @@ void handle_output_layout_change(struct wl_listener *listener, void *data);
 void handle_new_output(struct wl_listener *listener, void *data);
 void output_set_window_title(struct cg_output *output, const char *title);
 
+/* Request a frame on every enabled output, so that pending UI changes are
+ * applied once in the next frame rather than on every event. */
+void output_schedule_frames(struct cg_server *server);
+
+/* Whether nothing but the tabs and the tab bar is shown: no overlay, such
+ * as the launcher, and no drag icon */
+bool output_only_tabs_shown(struct cg_server *server);
+
+/* The surface of a view handed to the parent compositor under the given
+ * layout coordinates, which the scene graph can't find since the view is
+ * hidden from it; NULL if there is none. */
+struct wlr_surface *output_passthrough_surface_at(struct cg_server *server, double lx, double ly, double *sx,
+						  double *sy);
+
+/* Apply a change of the output_passthrough setting to every output */
+void output_update_passthrough(struct cg_server *server);
+
+/* The output with the focus, whose tabs new tabs go to: the active tab's,
+ * or else the first enabled one; NULL if there is none */
+struct cg_output *output_focused(struct cg_server *server);
+
+/* The output named name, or at that position of the outputs list; NULL
+ * if there is none */
+struct cg_output *output_from_name(struct cg_server *server, const char *name);
+
+/* The tab shown under the given layout coordinates: with separate
+ * outputs, that of the output there, otherwise the active tab */
+struct cg_tab *output_tab_at(struct cg_server *server, double lx, double ly);
+
+/* The focused output and its box in layout coordinates; NULL if there is
+ * none */
+struct cg_output *output_focused_box(struct cg_server *server, struct wlr_box *box);
+
+/* Center a box of the given logical size on the focused output, setting
+ * its top left corner in layout coordinates. Returns the output, or NULL
+ * if there is none. */
+struct cg_output *output_center_box(struct cg_server *server, int width, int height, int *x, int *y);
+
+/* The scale to render UI shown on output at; with output NULL, for UI
+ * spanning the layout, the highest of the enabled outputs', so that it is
+ * sharp on each */
+float output_ui_scale(struct cg_server *server, struct cg_output *output);
+
 #endif
@@ -0,0 +1,260 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "overlay.h"
+
+#include "pixel_buffer.h"
+
+#include <stdlib.h>
+#include <wlr/util/log.h>
+
+void
+overlay_init(struct cg_overlay *overlay)
+{
+	for (int i = 0; i < OVERLAY_SCALES; i++) {
+		struct cg_overlay_pixels *pixels = &overlay->pixels[i];
+		pixels->scale = 0;
+		pixels->buffer = NULL;
+		pixels->last_used = 0;
+		pixman_region32_init(&pixels->damage);
+	}
+	overlay->scale = 1;
+	overlay->paints = 0;
+	overlay->shown = NULL;
+	overlay->painting = NULL;
+	overlay->surface = NULL;
+	pixman_region32_init(&overlay->damage);
+}
+
+static void
+pixels_drop(struct cg_overlay *overlay, struct cg_overlay_pixels *pixels)
+{
+	if (pixels->buffer) {
+		wlr_buffer_drop(&pixels->buffer->base);
+		pixels->buffer = NULL;
+	}
+	pixman_region32_clear(&pixels->damage);
+	if (overlay->shown == pixels) {
+		overlay->shown = NULL;
+	}
+}
+
+void
+overlay_finish(struct cg_overlay *overlay)
+{
+	for (int i = 0; i < OVERLAY_SCALES; i++) {
+		pixels_drop(overlay, &overlay->pixels[i]);
+		pixman_region32_fini(&overlay->pixels[i].damage);
+	}
+	pixman_region32_fini(&overlay->damage);
+}
+
+size_t
+overlay_release(struct cg_overlay *overlay, struct wlr_scene_buffer *scene_buffer)
+{
+	size_t bytes = 0;
+	for (int i = 0; i < OVERLAY_SCALES; i++) {
+		struct cg_overlay_pixels *pixels = &overlay->pixels[i];
+		if (pixels->buffer) {
+			bytes += pixels->buffer->capacity;
+		}
+		pixels_drop(overlay, pixels);
+		pixels->scale = 0;
+		pixels->last_used = 0;
+	}
+
+	/* The scene buffer's lock is the last one */
+	if (scene_buffer) {
+		wlr_scene_buffer_set_buffer(scene_buffer, NULL);
+	}
+	return bytes;
+}
+
+void
+overlay_set_scale(struct cg_overlay *overlay, float scale)
+{
+	overlay->scale = scale > 0 ? scale : 1;
+}
+
+void
+overlay_damage_box(struct cg_overlay *overlay, int x, int y, int width, int height)
+{
+	pixman_region32_union_rect(&overlay->damage, &overlay->damage, x, y, width, height);
+}
+
+void
+overlay_damage_whole(struct cg_overlay *overlay)
+{
+	overlay_damage_box(overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT);
+}
+
+void
+overlay_damage_query(struct cg_overlay *overlay)
+{
+	overlay_damage_box(overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT);
+}
+
+void
+overlay_damage_results(struct cg_overlay *overlay)
+{
+	overlay_damage_box(overlay, 0, OVERLAY_SEARCH_HEIGHT, OVERLAY_BOX_WIDTH,
+			   OVERLAY_BOX_HEIGHT - OVERLAY_SEARCH_HEIGHT);
+}
+
+void
+overlay_damage_row(struct cg_overlay *overlay, size_t row)
+{
+	if (row >= OVERLAY_MAX_ITEMS) {
+		return;
+	}
+	overlay_damage_box(overlay, 0, OVERLAY_RESULTS_Y + (int)row * OVERLAY_ITEM_HEIGHT,
+			   OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT);
+}
+
+bool
+overlay_needs_paint(struct cg_overlay *overlay, int x, int y, int width, int height)
+{
+	pixman_box32_t box = {x, y, x + width, y + height};
+	return pixman_region32_contains_rectangle(&overlay->damage, &box) != PIXMAN_REGION_OUT;
+}
+
+/* Logical coordinates to buffer pixels, rounding down or up so that a
+ * damaged rectangle covers every pixel it touches */
+static int
+to_pixels(int value, float scale, bool round_up)
+{
+	float scaled = value * scale;
+	int pixels = (int)scaled;
+	return round_up && pixels < scaled ? pixels + 1 : pixels;
+}
+
+/* The pixels to paint at the current scale, reusing the least recently
+ * painted scale's for a new one */
+static struct cg_overlay_pixels *
+select_pixels(struct cg_overlay *overlay)
+{
+	struct cg_overlay_pixels *oldest = &overlay->pixels[0];
+	for (int i = 0; i < OVERLAY_SCALES; i++) {
+		struct cg_overlay_pixels *pixels = &overlay->pixels[i];
+		if (pixels->scale == overlay->scale) {
+			return pixels;
+		}
+		if (pixels->last_used < oldest->last_used) {
+			oldest = pixels;
+		}
+	}
+
+	pixels_drop(overlay, oldest);
+	oldest->scale = overlay->scale;
+	return oldest;
+}
+
+cairo_t *
+overlay_begin_paint(struct cg_overlay *overlay, int width, int height)
+{
+	struct cg_overlay_pixels *pixels = select_pixels(overlay);
+	float scale = pixels->scale;
+
+	/* The retained pixels are only usable if the box size is unchanged */
+	if (pixels->buffer && (pixels->width != width || pixels->height != height)) {
+		pixels_drop(overlay, pixels);
+	}
+
+	/* The pixels of other scales miss what changed now */
+	for (int i = 0; i < OVERLAY_SCALES; i++) {
+		struct cg_overlay_pixels *other = &overlay->pixels[i];
+		if (other != pixels && other->buffer) {
+			pixman_region32_union(&other->damage, &other->damage, &overlay->damage);
+		}
+	}
+
+	if (!pixels->buffer) {
+		pixels->buffer = pixel_buffer_acquire(to_pixels(width, scale, true), to_pixels(height, scale, true));
+		if (!pixels->buffer) {
+			wlr_log(WLR_ERROR, "Failed to allocate overlay buffer");
+			return NULL;
+		}
+		pixels->width = width;
+		pixels->height = height;
+		pixman_region32_union_rect(&pixels->damage, &pixels->damage, 0, 0, width, height);
+	}
+
+	/* Repaint what changed since these pixels were last painted */
+	pixman_region32_union(&overlay->damage, &overlay->damage, &pixels->damage);
+	pixman_region32_clear(&pixels->damage);
+	pixman_region32_intersect_rect(&overlay->damage, &overlay->damage, 0, 0, width, height);
+
+	/* Pixels painted at another scale than those shown are handed to
+	 * the scene buffer even if nothing changed since */
+	if (!pixman_region32_not_empty(&overlay->damage) && pixels == overlay->shown) {
+		return NULL;
+	}
+	pixels->last_used = ++overlay->paints;
+
+	int buffer_width = pixels->buffer->width;
+	int buffer_height = pixels->buffer->height;
+	overlay->surface = cairo_image_surface_create_for_data(
+		(unsigned char *)pixels->buffer->data, CAIRO_FORMAT_ARGB32, buffer_width, buffer_height, buffer_width * 4);
+	if (cairo_surface_status(overlay->surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(overlay->surface);
+		overlay->surface = NULL;
+		return NULL;
+	}
+	cairo_surface_set_device_scale(overlay->surface, scale, scale);
+	overlay->painting = pixels;
+
+	cairo_t *cr = cairo_create(overlay->surface);
+
+	/* Restrict all drawing to the damaged rectangles, widened to whole
+	 * pixels at this scale */
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&overlay->damage, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		int x1 = to_pixels(rects[i].x1, scale, false);
+		int y1 = to_pixels(rects[i].y1, scale, false);
+		int x2 = to_pixels(rects[i].x2, scale, true);
+		int y2 = to_pixels(rects[i].y2, scale, true);
+		cairo_rectangle(cr, x1 / scale, y1 / scale, (x2 - x1) / scale, (y2 - y1) / scale);
+	}
+	cairo_clip(cr);
+
+	return cr;
+}
+
+void
+overlay_end_paint(struct cg_overlay *overlay, cairo_t *cr, struct wlr_scene_buffer *scene_buffer)
+{
+	struct cg_overlay_pixels *pixels = overlay->painting;
+	cairo_destroy(cr);
+	cairo_surface_flush(overlay->surface);
+	cairo_surface_destroy(overlay->surface);
+	overlay->surface = NULL;
+	overlay->painting = NULL;
+
+	/* The scene graph takes damage in buffer pixels */
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&overlay->damage, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		int x1 = to_pixels(rects[i].x1, pixels->scale, false);
+		int y1 = to_pixels(rects[i].y1, pixels->scale, false);
+		pixman_region32_union_rect(&damage, &damage, x1, y1, to_pixels(rects[i].x2, pixels->scale, true) - x1,
+					   to_pixels(rects[i].y2, pixels->scale, true) - y1);
+	}
+
+	/* The scene buffer takes its own lock; we keep ours so the pixels
+	 * are retained for the next partial repaint. */
+	wlr_scene_buffer_set_buffer_with_damage(scene_buffer, &pixels->buffer->base, &damage);
+	wlr_scene_buffer_set_dest_size(scene_buffer, pixels->width, pixels->height);
+	pixman_region32_fini(&damage);
+	pixman_region32_clear(&overlay->damage);
+	overlay->shown = pixels;
+}
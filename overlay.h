@@ -0,0 +1,103 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_OVERLAY_H
+#define CG_OVERLAY_H
+
+#include <cairo/cairo.h>
+#include <pixman.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wlr/types/wlr_scene.h>
+
+/* Layout shared by the launcher, background dialog and profile selector */
+#define OVERLAY_BOX_WIDTH 600
+#define OVERLAY_BOX_HEIGHT 400
+#define OVERLAY_SEARCH_HEIGHT 50
+#define OVERLAY_ITEM_HEIGHT 40
+#define OVERLAY_RESULTS_Y (OVERLAY_SEARCH_HEIGHT + 10)
+#define OVERLAY_MAX_ITEMS ((OVERLAY_BOX_HEIGHT - OVERLAY_SEARCH_HEIGHT - 20) / OVERLAY_ITEM_HEIGHT)
+
+/* Scales whose pixels an overlay retains at once */
+#define OVERLAY_SCALES 2
+
+struct pixel_buffer;
+
+/* The box rendered at one scale. damage holds what changed while another
+ * scale was painted, in logical coordinates. */
+struct cg_overlay_pixels {
+	float scale;  /* 0 if unused */
+	int width;    /* Logical size of the box */
+	int height;
+	struct pixel_buffer *buffer;
+	pixman_region32_t damage;
+	uint64_t last_used;
+};
+
+/*
+ * Retained content of an overlay box. The pixels survive between renders
+ * so that only damaged regions are repainted, and only those regions are
+ * reported to the scene graph. The box is drawn in logical pixels and
+ * rasterized at the scale of the output it is shown on; the pixels of the
+ * last OVERLAY_SCALES scales are kept, so that moving the box between
+ * outputs of different scales only repaints what changed meanwhile.
+ */
+struct cg_overlay {
+	struct cg_overlay_pixels pixels[OVERLAY_SCALES];
+	float scale;
+	uint64_t paints;
+
+	/* Damage since the last paint, in logical coordinates */
+	pixman_region32_t damage;
+
+	/* The pixels last handed to the scene buffer */
+	struct cg_overlay_pixels *shown;
+
+	/* Valid between overlay_begin_paint() and overlay_end_paint() */
+	struct cg_overlay_pixels *painting;
+	cairo_surface_t *surface;
+};
+
+void overlay_init(struct cg_overlay *overlay);
+void overlay_finish(struct cg_overlay *overlay);
+
+/**
+ * Drop the retained pixels of a hidden overlay, and the scene buffer's
+ * (if not NULL). The next paint repaints the whole box. Returns the bytes
+ * of pixels released.
+ */
+size_t overlay_release(struct cg_overlay *overlay, struct wlr_scene_buffer *scene_buffer);
+
+/* Set the scale the next paints rasterize at; 1 by default */
+void overlay_set_scale(struct cg_overlay *overlay, float scale);
+
+/* Mark regions of the box as needing a repaint */
+void overlay_damage_whole(struct cg_overlay *overlay);
+void overlay_damage_box(struct cg_overlay *overlay, int x, int y, int width, int height);
+void overlay_damage_query(struct cg_overlay *overlay);
+void overlay_damage_results(struct cg_overlay *overlay);
+void overlay_damage_row(struct cg_overlay *overlay, size_t row);
+
+/* Whether any part of the given rectangle is going to be repainted */
+bool overlay_needs_paint(struct cg_overlay *overlay, int x, int y, int width, int height);
+
+/**
+ * Start repainting the damaged regions of a box of the given logical size.
+ * Returns a cairo context in logical coordinates, clipped to the damage, or
+ * NULL if nothing is damaged.
+ */
+cairo_t *overlay_begin_paint(struct cg_overlay *overlay, int width, int height);
+
+/**
+ * Finish painting, hand the buffer to the scene buffer along with the
+ * damage, at the box's logical size, and clear the damage.
+ */
+void overlay_end_paint(struct cg_overlay *overlay, cairo_t *cr, struct wlr_scene_buffer *scene_buffer);
+
+#endif
@@ -1,6 +1,91 @@
 #include "pixel_buffer.h"
 #include <drm/drm_fourcc.h>
 #include <stdlib.h>
+#include <wlr/util/log.h>
+
+/* Buckets hold buffers of 2^MIN_SHIFT .. 2^MAX_SHIFT bytes; larger ones are never pooled */
+#define PIXEL_BUFFER_POOL_MIN_SHIFT 12
+#define PIXEL_BUFFER_POOL_MAX_SHIFT 25
+#define PIXEL_BUFFER_POOL_BUCKETS (PIXEL_BUFFER_POOL_MAX_SHIFT - PIXEL_BUFFER_POOL_MIN_SHIFT + 1)
+
+/* Upper bound on the pixel data kept around for reuse */
+#define PIXEL_BUFFER_POOL_MAX_BYTES (32 * 1024 * 1024)
+
+static struct {
+	bool initialized;
+	struct wl_list buckets[PIXEL_BUFFER_POOL_BUCKETS];
+	struct pixel_buffer_pool_stats stats;
+} pool;
+
+static void
+pool_init(void)
+{
+	if (pool.initialized) {
+		return;
+	}
+	for (int i = 0; i < PIXEL_BUFFER_POOL_BUCKETS; i++) {
+		wl_list_init(&pool.buckets[i]);
+	}
+	pool.initialized = true;
+}
+
+/* Bucket index for a size, or -1 if it is too large to pool */
+static int
+pool_bucket(size_t size, size_t *capacity)
+{
+	int shift = PIXEL_BUFFER_POOL_MIN_SHIFT;
+	while (((size_t)1 << shift) < size) {
+		shift++;
+		if (shift > PIXEL_BUFFER_POOL_MAX_SHIFT) {
+			*capacity = size;
+			return -1;
+		}
+	}
+	*capacity = (size_t)1 << shift;
+	return shift - PIXEL_BUFFER_POOL_MIN_SHIFT;
+}
+
+struct pixel_buffer *
+pixel_buffer_acquire(int width, int height)
+{
+	if (width <= 0 || height <= 0) {
+		return NULL;
+	}
+
+	pool_init();
+
+	size_t size = (size_t)width * height * 4;
+	size_t capacity;
+	int bucket = pool_bucket(size, &capacity);
+
+	struct pixel_buffer *buffer = NULL;
+	if (bucket >= 0 && !wl_list_empty(&pool.buckets[bucket])) {
+		buffer = wl_container_of(pool.buckets[bucket].next, buffer, link);
+		wl_list_remove(&buffer->link);
+		pool.stats.pooled_bytes -= buffer->capacity;
+		pool.stats.hits++;
+	} else {
+		buffer = calloc(1, sizeof(*buffer));
+		if (!buffer) {
+			return NULL;
+		}
+		buffer->data = malloc(capacity);
+		if (!buffer->data) {
+			free(buffer);
+			return NULL;
+		}
+		buffer->capacity = capacity;
+		pool.stats.misses++;
+	}
+
+	wlr_buffer_init(&buffer->base, &pixel_buffer_impl, width, height);
+	buffer->width = width;
+	buffer->height = height;
+	buffer->size = size;
+	wl_list_init(&buffer->link);
+
+	return buffer;
+}
 
 void
 pixel_buffer_destroy(struct pixel_buffer *buffer)
@@ -9,10 +94,64 @@ pixel_buffer_destroy(struct pixel_buffer *buffer)
 	if (buffer->data) {
 		free(buffer->data);
 	}
-	wlr_buffer_finish(&buffer->base);
 	free(buffer);
 }
 
+/* Called by wlroots once the buffer is dropped and unlocked */
+static void
+pixel_buffer_release(struct wlr_buffer *wlr_buffer)
+{
+	struct pixel_buffer *buffer = wl_container_of(wlr_buffer, buffer, base);
+	wlr_buffer_finish(&buffer->base);
+
+	size_t capacity;
+	int bucket = pool_bucket(buffer->capacity, &capacity);
+	if (bucket < 0 || capacity != buffer->capacity ||
+			pool.stats.pooled_bytes + buffer->capacity > PIXEL_BUFFER_POOL_MAX_BYTES) {
+		pixel_buffer_destroy(buffer);
+		return;
+	}
+
+	pool_init();
+	wl_list_insert(&pool.buckets[bucket], &buffer->link);
+	pool.stats.pooled_bytes += buffer->capacity;
+}
+
+void
+pixel_buffer_pool_trim(void)
+{
+	if (!pool.initialized) {
+		return;
+	}
+
+	for (int i = 0; i < PIXEL_BUFFER_POOL_BUCKETS; i++) {
+		struct pixel_buffer *buffer, *tmp;
+		wl_list_for_each_safe(buffer, tmp, &pool.buckets[i], link) {
+			wl_list_remove(&buffer->link);
+			pixel_buffer_destroy(buffer);
+		}
+	}
+	pool.stats.pooled_bytes = 0;
+}
+
+void
+pixel_buffer_pool_finish(void)
+{
+	if (!pool.initialized) {
+		return;
+	}
+
+	wlr_log(WLR_DEBUG, "Pixel buffer pool: %lu hits, %lu misses",
+		(unsigned long)pool.stats.hits, (unsigned long)pool.stats.misses);
+	pixel_buffer_pool_trim();
+}
+
+void
+pixel_buffer_pool_get_stats(struct pixel_buffer_pool_stats *stats)
+{
+	*stats = pool.stats;
+}
+
 bool
 pixel_buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buffer,
 				    uint32_t flags, void **data_out,
@@ -32,7 +171,7 @@ pixel_buffer_end_data_ptr_access(struct wlr_buffer *wlr_buffer)
 }
 
 const struct wlr_buffer_impl pixel_buffer_impl = {
-	.destroy = (void*)pixel_buffer_destroy,
+	.destroy = pixel_buffer_release,
 	.begin_data_ptr_access = pixel_buffer_begin_data_ptr_access,
 	.end_data_ptr_access = pixel_buffer_end_data_ptr_access,
 };
@@ -1,9 +1,11 @@
 #ifndef PIXEL_BUFFER_H
 #define PIXEL_BUFFER_H
 
+#include <wayland-server-core.h>
 #include <wlr/interfaces/wlr_buffer.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Custom buffer that wraps pixel data for wlroots scene graph */
 struct pixel_buffer {
@@ -12,8 +14,44 @@ struct pixel_buffer {
 	int width;
 	int height;
 	size_t size;
+
+	/* Allocated size of data, a power of two (the pool bucket) */
+	size_t capacity;
+	struct wl_list link; // pool bucket, while released
+};
+
+/* Pool counters */
+struct pixel_buffer_pool_stats {
+	uint64_t hits;       /* acquisitions served from the pool */
+	uint64_t misses;     /* acquisitions that had to allocate */
+	size_t pooled_bytes; /* pixel data currently held by the pool */
 };
 
+/**
+ * Get an ARGB8888 pixel buffer of the given size, reusing a released buffer
+ * from the same size bucket when possible. The pixel data is NOT cleared:
+ * callers must paint every pixel (e.g. with CAIRO_OPERATOR_SOURCE).
+ * Drop the buffer with wlr_buffer_drop(); once the scene graph releases it
+ * too, it returns to the pool.
+ */
+struct pixel_buffer *pixel_buffer_acquire(int width, int height);
+
+/**
+ * Free every buffer held by the pool. Buffers released later are pooled
+ * again.
+ */
+void pixel_buffer_pool_trim(void);
+
+/**
+ * Free every buffer held by the pool.
+ */
+void pixel_buffer_pool_finish(void);
+
+/**
+ * Get the pool counters.
+ */
+void pixel_buffer_pool_get_stats(struct pixel_buffer_pool_stats *stats);
+
 /**
  * Destroy a pixel buffer and release its resources.
  */
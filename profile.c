@@ -17,6 +17,39 @@
 #include <wlr/util/log.h>
 #include <tomlc17.h>
 
+/* Parse a memory size: a number of bytes, or a string with a K, M or G
+ * suffix such as "512M". Returns 0 if invalid. */
+static uint64_t
+parse_memory_size(toml_datum_t value)
+{
+	if (value.type == TOML_INT64) {
+		return value.u.int64 > 0 ? (uint64_t)value.u.int64 : 0;
+	}
+	if (value.type != TOML_STRING) {
+		return 0;
+	}
+
+	char *end;
+	errno = 0;
+	unsigned long long size = strtoull(value.u.s, &end, 10);
+	if (errno != 0 || end == value.u.s) {
+		return 0;
+	}
+	switch (*end) {
+	case 'G':
+		size *= 1024;
+		/* fall through */
+	case 'M':
+		size *= 1024;
+		/* fall through */
+	case 'K':
+		size *= 1024;
+		end++;
+		break;
+	}
+	return *end == '\0' ? size : 0;
+}
+
 static char *
 find_profile_file(const char *name)
 {
@@ -135,6 +168,7 @@ free_profile_tab(struct profile_tab *tab)
 	}
 	free(tab->command);
 	free(tab->title);
+	free(tab->working_dir);
 	if (tab->args) {
 		for (int i = 0; i < tab->argc; i++) {
 			free(tab->args[i]);
@@ -156,10 +190,17 @@ profile_load(const char *name)
 		return NULL;
 	}
 
+	struct profile *profile = profile_load_file(path, name);
+	free(path);
+	return profile;
+}
+
+struct profile *
+profile_load_file(const char *path, const char *name)
+{
 	wlr_log(WLR_DEBUG, "Loading profile from: %s", path);
 
 	toml_result_t result = toml_parse_file_ex(path);
-	free(path);
 
 	if (!result.ok) {
 		wlr_log(WLR_ERROR, "Failed to parse profile: %s", result.errmsg);
@@ -190,6 +231,40 @@ profile_load(const char *name)
 		profile->working_dir = dup_string(wd.u.s);
 	}
 
+	/* Parse xwayland (optional), overriding the configuration's mode */
+	toml_datum_t xwayland = toml_get(root, "xwayland");
+	if (xwayland.type == TOML_STRING) {
+		profile->has_xwayland_mode = true;
+		if (strcmp(xwayland.u.s, "lazy") == 0) {
+			profile->xwayland_mode = WAYMUX_XWAYLAND_LAZY;
+		} else if (strcmp(xwayland.u.s, "on_demand") == 0) {
+			profile->xwayland_mode = WAYMUX_XWAYLAND_ON_DEMAND;
+		} else if (strcmp(xwayland.u.s, "disabled") == 0) {
+			profile->xwayland_mode = WAYMUX_XWAYLAND_DISABLED;
+		} else {
+			wlr_log(WLR_ERROR, "Ignoring unknown xwayland mode '%s' in profile '%s'", xwayland.u.s, name);
+			profile->has_xwayland_mode = false;
+		}
+	}
+
+	/* Parse [limits] (optional), applied to each tab's cgroup */
+	toml_datum_t limits = toml_get(root, "limits");
+	if (limits.type == TOML_TABLE) {
+		toml_datum_t memory = toml_get(limits, "memory");
+		if (memory.type != TOML_UNKNOWN) {
+			profile->limits.memory_max = parse_memory_size(memory);
+			if (profile->limits.memory_max == 0) {
+				wlr_log(WLR_ERROR, "Ignoring invalid memory limit in profile '%s'", name);
+			}
+		}
+		toml_datum_t cpu = toml_get(limits, "cpu");
+		if (cpu.type == TOML_INT64 && cpu.u.int64 > 0 && cpu.u.int64 <= 100000) {
+			profile->limits.cpu_max = (int)cpu.u.int64;
+		} else if (cpu.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "Ignoring invalid CPU limit in profile '%s'", name);
+		}
+	}
+
 	/* Parse proxy_command (optional) - can be a string or an array */
 	toml_datum_t pc = toml_get(root, "proxy_command");
 	if (pc.type == TOML_STRING) {
@@ -273,6 +348,12 @@ profile_load(const char *name)
 				tab->title = dup_string(title.u.s);
 			}
 
+			/* working_dir is optional, overriding the profile's */
+			toml_datum_t tab_wd = toml_get(*tab_datum, "working_dir");
+			if (tab_wd.type == TOML_STRING) {
+				tab->working_dir = dup_string(tab_wd.u.s);
+			}
+
 			/* args is optional */
 			toml_datum_t args = toml_get(*tab_datum, "args");
 			if (args.type == TOML_ARRAY) {
@@ -286,6 +367,15 @@ profile_load(const char *name)
 			} else {
 				tab->background = false;
 			}
+
+			/* lazy is optional (defaults to false); lazy tabs are
+			 * started when first shown, and are background tabs
+			 * unless background is explicitly false */
+			toml_datum_t lazy = toml_get(*tab_datum, "lazy");
+			if (lazy.type == TOML_BOOLEAN && lazy.u.boolean) {
+				tab->lazy = true;
+				tab->background = background.type != TOML_BOOLEAN || background.u.boolean;
+			}
 		}
 	} else {
 		wlr_log(WLR_INFO, "Profile has no tabs defined");
@@ -335,3 +425,98 @@ profile_free(struct profile *profile)
 
 	free(profile);
 }
+
+/* FNV-1a over a string, with NULL distinct from the empty string */
+static uint64_t
+hash_string(uint64_t hash, const char *s)
+{
+	if (!s) {
+		return (hash ^ 0xff) * 0x100000001b3ULL;
+	}
+	for (; *s; s++) {
+		hash = (hash ^ (unsigned char)*s) * 0x100000001b3ULL;
+	}
+	/* Terminate, so that "ab" + "c" differs from "a" + "bc" */
+	return (hash ^ 0) * 0x100000001b3ULL;
+}
+
+static uint64_t
+hash_int(uint64_t hash, int value)
+{
+	unsigned int v = (unsigned int)value;
+	for (size_t i = 0; i < sizeof(v); i++) {
+		hash = (hash ^ ((v >> (i * 8)) & 0xff)) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+char *
+profile_dir(void)
+{
+	const char *config_home = getenv("XDG_CONFIG_HOME");
+	char *path = NULL;
+
+	if (!config_home || config_home[0] == '\0') {
+		const char *home = getenv("HOME");
+		if (!home) {
+			wlr_log(WLR_ERROR, "HOME environment variable not set");
+			return NULL;
+		}
+		size_t len = strlen(home) + 30;
+		path = malloc(len);
+		if (!path) {
+			wlr_log_errno(WLR_ERROR, "Failed to allocate path");
+			return NULL;
+		}
+		snprintf(path, len, "%s/.config/waymux/profiles.d", home);
+	} else {
+		size_t len = strlen(config_home) + 20;
+		path = malloc(len);
+		if (!path) {
+			wlr_log_errno(WLR_ERROR, "Failed to allocate path");
+			return NULL;
+		}
+		snprintf(path, len, "%s/waymux/profiles.d", config_home);
+	}
+
+	return path;
+}
+
+uint64_t
+profile_hash(const struct profile *profile)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	hash = hash_string(hash, profile->working_dir);
+	hash = hash_int(hash, profile->has_xwayland_mode ? (int)profile->xwayland_mode : -1);
+	hash = hash_int(hash, (int)(profile->limits.memory_max >> 32));
+	hash = hash_int(hash, (int)profile->limits.memory_max);
+	hash = hash_int(hash, profile->limits.cpu_max);
+
+	hash = hash_int(hash, profile->proxy_argc);
+	for (int i = 0; i < profile->proxy_argc; i++) {
+		hash = hash_string(hash, profile->proxy_command[i]);
+	}
+
+	hash = hash_int(hash, profile->env_count);
+	for (int i = 0; i < profile->env_count; i++) {
+		hash = hash_string(hash, profile->env_vars[i].key);
+		hash = hash_string(hash, profile->env_vars[i].value);
+	}
+
+	hash = hash_int(hash, profile->tab_count);
+	for (int i = 0; i < profile->tab_count; i++) {
+		const struct profile_tab *tab = &profile->tabs[i];
+		hash = hash_string(hash, tab->command);
+		hash = hash_string(hash, tab->title);
+		hash = hash_string(hash, tab->working_dir);
+		hash = hash_int(hash, tab->argc);
+		for (int j = 0; j < tab->argc; j++) {
+			hash = hash_string(hash, tab->args[j]);
+		}
+		hash = hash_int(hash, tab->background);
+		hash = hash_int(hash, tab->lazy);
+	}
+
+	return hash;
+}
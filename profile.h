@@ -10,6 +10,10 @@
 #define CG_PROFILE_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "resources.h"
+#include "waymux_config.h"
 
 /* Single tab in a profile */
 struct profile_tab {
@@ -17,7 +21,9 @@ struct profile_tab {
 	char *title;
 	char **args;  /* NULL-terminated array */
 	int argc;
+	char *working_dir;  /* Overrides the profile's working_dir */
 	bool background;  /* If true, tab starts as background (hidden from tab bar) */
+	bool lazy;  /* If true, tab is a background placeholder until first shown */
 };
 
 /* Environment variable in a profile */
@@ -36,6 +42,9 @@ struct profile {
 	int env_count;
 	struct profile_tab *tabs;
 	int tab_count;
+	bool has_xwayland_mode;  /* If false, the configuration's mode applies */
+	enum waymux_xwayland_mode xwayland_mode;
+	struct cg_resource_limits limits;  /* [limits] of each tab's cgroup */
 };
 
 /**
@@ -45,6 +54,24 @@ struct profile {
  */
 struct profile *profile_load(const char *name);
 
+/**
+ * Load a profile from the given file, naming it name
+ * Returns NULL on failure
+ */
+struct profile *profile_load_file(const char *path, const char *name);
+
+/**
+ * The directory of the user's profiles, $XDG_CONFIG_HOME/waymux/profiles.d
+ * Returns an allocated path, or NULL if HOME isn't set either
+ */
+char *profile_dir(void);
+
+/**
+ * Hash the parsed contents of a profile (not its name), so that equal
+ * profiles hash equally however their files are formatted
+ */
+uint64_t profile_hash(const struct profile *profile);
+
 /**
  * Free a profile structure
  */
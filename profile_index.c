@@ -0,0 +1,375 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "profile_index.h"
+
+#include "profile.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+/* For weighing launches by their age */
+#define DAY (24 * 60 * 60)
+
+char *
+profile_index_default_path(void)
+{
+	const char *state_home = getenv("XDG_STATE_HOME");
+	const char *home = getenv("HOME");
+	char *path = NULL;
+	size_t len;
+
+	if (state_home && state_home[0] == '/') {
+		len = strlen(state_home) + strlen("/waymux/profiles.index") + 1;
+		path = malloc(len);
+		if (path) {
+			snprintf(path, len, "%s/waymux/profiles.index", state_home);
+		}
+	} else if (home && home[0] != '\0') {
+		len = strlen(home) + strlen("/.local/state/waymux/profiles.index") + 1;
+		path = malloc(len);
+		if (path) {
+			snprintf(path, len, "%s/.local/state/waymux/profiles.index", home);
+		}
+	}
+
+	return path;
+}
+
+static int
+compare_infos(const void *a, const void *b)
+{
+	const struct cg_profile_info *ia = a;
+	const struct cg_profile_info *ib = b;
+	return strcmp(ia->name, ib->name);
+}
+
+/* Append a profile, leaving the index unsorted; name is taken over */
+static struct cg_profile_info *
+append_info(struct cg_profile_index *index, char *name)
+{
+	if (index->count == index->capacity) {
+		size_t new_capacity = index->capacity ? index->capacity * 2 : 32;
+		struct cg_profile_info *profiles = realloc(index->profiles, new_capacity * sizeof(*profiles));
+		if (!profiles) {
+			free(name);
+			return NULL;
+		}
+		index->profiles = profiles;
+		index->capacity = new_capacity;
+	}
+
+	struct cg_profile_info *info = &index->profiles[index->count++];
+	memset(info, 0, sizeof(*info));
+	info->name = name;
+	info->tab_count = -1;
+	return info;
+}
+
+/* Parse a "name\tmtime_sec\tmtime_nsec\tsize\ttab_count\thash\tlast_used\tlaunch_count" line */
+static bool
+parse_line(struct cg_profile_index *index, char *line)
+{
+	char *fields[8];
+	size_t count = 0;
+	char *saveptr = NULL;
+	for (char *field = strtok_r(line, "\t\n", &saveptr); field && count < 8;
+	     field = strtok_r(NULL, "\t\n", &saveptr)) {
+		fields[count++] = field;
+	}
+	if (count != 8) {
+		return false;
+	}
+
+	char *name = strdup(fields[0]);
+	struct cg_profile_info *info = name ? append_info(index, name) : NULL;
+	if (!info) {
+		return false;
+	}
+
+	info->mtime_sec = strtoll(fields[1], NULL, 10);
+	info->mtime_nsec = strtoll(fields[2], NULL, 10);
+	info->size = strtoll(fields[3], NULL, 10);
+	info->tab_count = (int)strtol(fields[4], NULL, 10);
+	info->hash = strtoull(fields[5], NULL, 16);
+	info->last_used = strtoll(fields[6], NULL, 10);
+	info->launch_count = (uint32_t)strtoul(fields[7], NULL, 10);
+	return true;
+}
+
+struct cg_profile_index *
+profile_index_load(const char *path)
+{
+	struct cg_profile_index *index = calloc(1, sizeof(*index));
+	if (!index) {
+		wlr_log(WLR_ERROR, "Failed to allocate profile index");
+		return NULL;
+	}
+
+	FILE *f = path ? fopen(path, "r") : NULL;
+	if (!f) {
+		return index;
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	char header[32];
+	snprintf(header, sizeof(header), "%s %d\n", PROFILE_INDEX_MAGIC, PROFILE_INDEX_VERSION);
+
+	bool ok = getline(&line, &line_size, f) > 0 && strcmp(line, header) == 0;
+	while (ok && getline(&line, &line_size, f) > 0) {
+		ok = parse_line(index, line);
+	}
+	free(line);
+	fclose(f);
+
+	if (!ok) {
+		wlr_log(WLR_INFO, "Ignoring stale or corrupt profile index %s", path);
+		for (size_t i = 0; i < index->count; i++) {
+			free(index->profiles[i].name);
+		}
+		index->count = 0;
+		return index;
+	}
+
+	/* Written sorted, but don't trust it for the binary search */
+	qsort(index->profiles, index->count, sizeof(*index->profiles), compare_infos);
+	return index;
+}
+
+void
+profile_index_destroy(struct cg_profile_index *index)
+{
+	if (!index) {
+		return;
+	}
+
+	for (size_t i = 0; i < index->count; i++) {
+		free(index->profiles[i].name);
+	}
+	free(index->profiles);
+	free(index);
+}
+
+struct cg_profile_info *
+profile_index_find(struct cg_profile_index *index, const char *name)
+{
+	size_t left = 0;
+	size_t right = index->count;
+	while (left < right) {
+		size_t mid = left + (right - left) / 2;
+		int cmp = strcmp(index->profiles[mid].name, name);
+		if (cmp == 0) {
+			return &index->profiles[mid];
+		} else if (cmp < 0) {
+			left = mid + 1;
+		} else {
+			right = mid;
+		}
+	}
+	return NULL;
+}
+
+/* Read a profile's metadata from its file */
+static void
+parse_profile(struct cg_profile_index *index, struct cg_profile_info *info, const char *path,
+	      const struct stat *st)
+{
+	struct profile *profile = profile_load_file(path, info->name);
+	info->tab_count = profile ? profile->tab_count : -1;
+	info->hash = profile ? profile_hash(profile) : 0;
+	info->mtime_sec = st->st_mtim.tv_sec;
+	info->mtime_nsec = st->st_mtim.tv_nsec;
+	info->size = st->st_size;
+	profile_free(profile);
+
+	index->parsed++;
+	index->dirty = true;
+}
+
+size_t
+profile_index_refresh(struct cg_profile_index *index, const char *profiles_dir)
+{
+	index->parsed = 0;
+	for (size_t i = 0; i < index->count; i++) {
+		index->profiles[i].seen = false;
+	}
+
+	/* Profiles found for the first time are appended, past the part of
+	 * the index that is sorted */
+	size_t sorted = index->count;
+
+	DIR *dir = profiles_dir ? opendir(profiles_dir) : NULL;
+	if (!dir && profiles_dir) {
+		wlr_log(WLR_DEBUG, "No profiles directory found: %s", profiles_dir);
+	}
+
+	struct dirent *entry;
+	while (dir && (entry = readdir(dir)) != NULL) {
+		/* Skip hidden files and non-TOML files */
+		if (entry->d_name[0] == '.') {
+			continue;
+		}
+
+		size_t len = strlen(entry->d_name);
+		if (len < 6 || strcmp(entry->d_name + len - 5, ".toml") != 0) {
+			continue;
+		}
+
+		/* Names end up in index lines */
+		if (strpbrk(entry->d_name, "\t\n")) {
+			continue;
+		}
+
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%s", profiles_dir, entry->d_name);
+		struct stat st;
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		char *name = strndup(entry->d_name, len - 5);
+		if (!name) {
+			continue;
+		}
+
+		struct cg_profile_index sorted_part = {.profiles = index->profiles, .count = sorted};
+		struct cg_profile_info *info = profile_index_find(&sorted_part, name);
+		if (info) {
+			free(name);
+		} else {
+			info = append_info(index, name);
+			if (!info) {
+				continue;
+			}
+		}
+		info->seen = true;
+
+		if (info->mtime_sec != (int64_t)st.st_mtim.tv_sec || info->mtime_nsec != (int64_t)st.st_mtim.tv_nsec ||
+		    info->size != (int64_t)st.st_size) {
+			parse_profile(index, info, path, &st);
+		}
+	}
+	if (dir) {
+		closedir(dir);
+	}
+
+	/* Drop profiles whose files are gone */
+	size_t kept = 0;
+	for (size_t i = 0; i < index->count; i++) {
+		if (!index->profiles[i].seen) {
+			free(index->profiles[i].name);
+			index->dirty = true;
+			continue;
+		}
+		index->profiles[kept++] = index->profiles[i];
+	}
+	index->count = kept;
+
+	qsort(index->profiles, index->count, sizeof(*index->profiles), compare_infos);
+
+	wlr_log(WLR_DEBUG, "Profile index has %zu profiles, %zu parsed", index->count, index->parsed);
+	return index->count;
+}
+
+bool
+profile_index_record_launch(struct cg_profile_index *index, const char *name, int64_t now)
+{
+	struct cg_profile_info *info = profile_index_find(index, name);
+	if (!info) {
+		return false;
+	}
+
+	info->last_used = now;
+	if (info->launch_count < UINT32_MAX) {
+		info->launch_count++;
+	}
+	index->dirty = true;
+	return true;
+}
+
+uint64_t
+profile_index_score(const struct cg_profile_info *info, int64_t now)
+{
+	if (info->launch_count == 0) {
+		return 0;
+	}
+
+	/* Weigh the launch count by how recently the profile was used, so
+	 * that a profile used daily this week beats one used a lot last year */
+	int64_t age = now - info->last_used;
+	uint64_t weight;
+	if (age < DAY) {
+		weight = 8;
+	} else if (age < 7 * DAY) {
+		weight = 4;
+	} else if (age < 30 * DAY) {
+		weight = 2;
+	} else {
+		weight = 1;
+	}
+	return (uint64_t)info->launch_count * weight;
+}
+
+/* Create any missing parent directories of path */
+static void
+create_parent_dirs(const char *path)
+{
+	char dir[4096];
+	snprintf(dir, sizeof(dir), "%s", path);
+	for (char *p = dir + 1; *p; p++) {
+		if (*p == '/') {
+			*p = '\0';
+			mkdir(dir, 0700);
+			*p = '/';
+		}
+	}
+}
+
+int
+profile_index_save(struct cg_profile_index *index, const char *path)
+{
+	create_parent_dirs(path);
+
+	char tmp_path[4096];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid());
+	FILE *f = fopen(tmp_path, "w");
+	if (!f) {
+		wlr_log_errno(WLR_ERROR, "Failed to create profile index %s", tmp_path);
+		return -1;
+	}
+
+	bool ok = fprintf(f, "%s %d\n", PROFILE_INDEX_MAGIC, PROFILE_INDEX_VERSION) > 0;
+	for (size_t i = 0; ok && i < index->count; i++) {
+		const struct cg_profile_info *info = &index->profiles[i];
+		ok = fprintf(f, "%s\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%d\t%016" PRIx64 "\t%" PRId64 "\t%" PRIu32 "\n",
+			     info->name, info->mtime_sec, info->mtime_nsec, info->size, info->tab_count, info->hash,
+			     info->last_used, info->launch_count) > 0;
+	}
+
+	if (fclose(f) != 0) {
+		ok = false;
+	}
+	if (!ok || rename(tmp_path, path) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to write profile index %s", path);
+		unlink(tmp_path);
+		return -1;
+	}
+
+	index->dirty = false;
+	wlr_log(WLR_DEBUG, "Wrote profile index %s (%zu profiles)", path, index->count);
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_PROFILE_INDEX_H
+#define CG_PROFILE_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PROFILE_INDEX_MAGIC "WMXPROF"
+#define PROFILE_INDEX_VERSION 1
+
+/*
+ * Metadata of a profile in profiles.d. A profile is only parsed again when
+ * the mtime or size of its file changes, so listing profiles costs a
+ * stat() per file rather than a TOML parse.
+ */
+struct cg_profile_info {
+	char *name;             /* File name without .toml */
+	int tab_count;          /* -1 if the profile failed to parse */
+	uint64_t hash;          /* Of the parsed profile, see profile_hash() */
+	int64_t last_used;      /* When last launched (seconds since the epoch), 0 if never */
+	uint32_t launch_count;
+
+	/* The file the metadata was read from */
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	int64_t size;
+
+	bool seen;  /* Found by the current refresh */
+};
+
+/*
+ * The index, stored as a text file with a header line followed by a
+ * tab-separated line per profile. Launch counts live in the same file, so
+ * it goes in $XDG_STATE_HOME rather than the cache directory.
+ */
+struct cg_profile_index {
+	struct cg_profile_info *profiles;  /* Sorted by name */
+	size_t count, capacity;
+	bool dirty;     /* Differs from the file it was loaded from */
+	size_t parsed;  /* Profiles parsed by the last refresh */
+};
+
+/**
+ * Get the index file path ($XDG_STATE_HOME/waymux/profiles.index).
+ * Returns NULL if neither XDG_STATE_HOME nor HOME is set.
+ */
+char *profile_index_default_path(void);
+
+/**
+ * Load an index file. A missing, stale or corrupt file yields an empty
+ * index. Returns NULL only on allocation failure.
+ */
+struct cg_profile_index *profile_index_load(const char *path);
+
+/**
+ * Free an index. NULL-safe.
+ */
+void profile_index_destroy(struct cg_profile_index *index);
+
+/**
+ * Bring the index up to date with a profiles directory, parsing only new
+ * and modified profiles and dropping removed ones. Pointers into the
+ * index are invalidated. Returns the number of profiles.
+ */
+size_t profile_index_refresh(struct cg_profile_index *index, const char *profiles_dir);
+
+/**
+ * Find a profile by name, or NULL.
+ */
+struct cg_profile_info *profile_index_find(struct cg_profile_index *index, const char *name);
+
+/**
+ * Record that a profile was launched at the given time. Returns false if
+ * the profile isn't in the index.
+ */
+bool profile_index_record_launch(struct cg_profile_index *index, const char *name, int64_t now);
+
+/**
+ * Rank a profile by how often and how recently it was launched; higher
+ * is better, 0 for profiles that were never launched.
+ */
+uint64_t profile_index_score(const struct cg_profile_info *info, int64_t now);
+
+/**
+ * Write the index atomically (through a temporary file and rename),
+ * creating the parent directory if needed. Returns 0 on success.
+ */
+int profile_index_save(struct cg_profile_index *index, const char *path);
+
+#endif
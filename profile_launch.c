@@ -0,0 +1,620 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/util/log.h>
+
+#include "profile.h"
+#include "profile_launch.h"
+#include "resources.h"
+#include "server.h"
+#include "spawn_helper.h"
+#include "spawner.h"
+#include "tab.h"
+
+/* How many parents to follow from a client to a spawned process */
+#define PROFILE_LAUNCH_MAX_DEPTH 16
+
+static uint32_t last_launch_id;
+
+static long
+elapsed_ms(const struct timespec *since)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static void
+launch_destroy(struct cg_profile_launch *launch)
+{
+	struct cg_profile_launch_tab *pending, *tmp;
+	wl_list_for_each_safe(pending, tmp, &launch->pending, link) {
+		wl_list_remove(&pending->link);
+		free(pending);
+	}
+	if (launch->timeout) {
+		wl_event_source_remove(launch->timeout);
+	}
+	wl_list_remove(&launch->link);
+	free(launch->name);
+	free(launch);
+}
+
+static int
+handle_launch_timeout(void *data)
+{
+	struct cg_profile_launch *launch = data;
+	wlr_log(WLR_ERROR, "Profile '%s': %d of %d tabs never mapped", launch->name,
+		wl_list_length(&launch->pending), launch->tab_count);
+	launch_destroy(launch);
+	return 0;
+}
+
+/* Build the argv of a profile tab: the proxy command, if any, then the tab's
+ * command and arguments. The strings belong to the profile. */
+static char **
+profile_tab_argv(struct profile *profile, struct profile_tab *tab)
+{
+	char **argv = calloc(profile->proxy_argc + 1 + tab->argc + 1, sizeof(char *));
+	if (!argv) {
+		return NULL;
+	}
+
+	int argc = 0;
+	for (int i = 0; i < profile->proxy_argc; i++) {
+		argv[argc++] = profile->proxy_command[i];
+	}
+	argv[argc++] = tab->command;
+	for (int i = 0; i < tab->argc; i++) {
+		argv[argc++] = tab->args[i];
+	}
+	argv[argc] = NULL;
+
+	return argv;
+}
+
+/* Prepare the environment shared by a profile's tabs */
+static bool
+profile_env_init(struct cg_spawn_env *env, struct profile *profile)
+{
+	if (!spawn_env_init(env)) {
+		return false;
+	}
+	for (int i = 0; i < profile->env_count; i++) {
+		if (!spawn_env_set(env, profile->env_vars[i].key, profile->env_vars[i].value)) {
+			wlr_log(WLR_ERROR, "Failed to set environment variable: %s", profile->env_vars[i].key);
+		}
+	}
+	return true;
+}
+
+static void
+launch_token(char *dest, size_t size, struct cg_profile_launch *launch, int position)
+{
+	/* The compositor's PID keeps tokens of different instances apart */
+	snprintf(dest, size, "%d-%u-%d", (int)getpid(), launch->id, position);
+}
+
+static void
+spawn_launch_tab(struct cg_profile_launch *launch, struct profile *profile, int position,
+		 struct cg_spawn_env *env)
+{
+	struct profile_tab *tab = &profile->tabs[position];
+	struct cg_profile_launch_tab *pending = calloc(1, sizeof(*pending));
+	char **argv = profile_tab_argv(profile, tab);
+	if (!pending || !argv) {
+		wlr_log(WLR_ERROR, "Failed to allocate profile tab %d", position);
+		free(pending);
+		free(argv);
+		return;
+	}
+
+	launch_token(pending->token, sizeof(pending->token), launch, position);
+	pending->position = position;
+	pending->background = tab->background;
+
+	wlr_log(WLR_INFO, "Spawning profile tab: %s", tab->command);
+	if (!spawn_env_set(env, PROFILE_LAUNCH_TOKEN_ENV, pending->token)) {
+		pending->pid = -1;
+	} else {
+		pending->pid = resources_spawn(launch->server->resources, &profile->limits, argv, env,
+					       tab->working_dir ? tab->working_dir : profile->working_dir,
+					       &pending->spawn_token);
+	}
+	free(argv);
+
+	if (pending->pid < 0) {
+		wlr_log(WLR_ERROR, "Failed to spawn tab %d (%s)", position, tab->command);
+		free(pending);
+		return;
+	}
+
+	wl_list_insert(launch->pending.prev, &pending->link);
+	launch->tab_count++;
+}
+
+static void
+lazy_tab_destroy(struct cg_profile_lazy_tab *lazy)
+{
+	wl_list_remove(&lazy->tab_activate.link);
+	wl_list_remove(&lazy->tab_background.link);
+	wl_list_remove(&lazy->tab_unmap.link);
+	wl_list_remove(&lazy->link);
+
+	if (lazy->argv) {
+		for (char **arg = lazy->argv; *arg; arg++) {
+			free(*arg);
+		}
+		free(lazy->argv);
+	}
+	spawn_env_finish(&lazy->env);
+	free(lazy->working_dir);
+	free(lazy);
+}
+
+static void
+lazy_tab_start(struct cg_profile_lazy_tab *lazy)
+{
+	if (lazy->pid > 0) {
+		return;
+	}
+
+	wlr_log(WLR_INFO, "Starting lazy profile tab: %s", lazy->argv[0]);
+	pid_t pid = resources_spawn(lazy->server->resources, &lazy->limits, lazy->argv, &lazy->env, lazy->working_dir,
+				    &lazy->spawn_token);
+	if (pid < 0) {
+		/* Stay a placeholder, to be tried again when next shown */
+		wlr_log(WLR_ERROR, "Failed to start lazy profile tab: %s", lazy->argv[0]);
+		return;
+	}
+	lazy->pid = pid;
+}
+
+static void
+handle_lazy_tab_activate(struct wl_listener *listener, void *data)
+{
+	struct cg_profile_lazy_tab *lazy = wl_container_of(listener, lazy, tab_activate);
+	if (data == lazy->tab) {
+		lazy_tab_start(lazy);
+	}
+}
+
+static void
+handle_lazy_tab_background(struct wl_listener *listener, void *data)
+{
+	struct cg_profile_lazy_tab *lazy = wl_container_of(listener, lazy, tab_background);
+	if (data == lazy->tab && !lazy->tab->is_background) {
+		lazy_tab_start(lazy);
+	}
+}
+
+static void
+handle_lazy_tab_unmap(struct wl_listener *listener, void *data)
+{
+	struct cg_profile_lazy_tab *lazy = wl_container_of(listener, lazy, tab_unmap);
+	if (data == lazy->tab) {
+		/* The placeholder was closed before its view came up */
+		lazy->tab = NULL;
+		lazy_tab_destroy(lazy);
+	}
+}
+
+static char **
+strv_dup(char **strv)
+{
+	size_t count = 0;
+	while (strv[count]) {
+		count++;
+	}
+
+	char **dup = calloc(count + 1, sizeof(char *));
+	if (!dup) {
+		return NULL;
+	}
+	for (size_t i = 0; i < count; i++) {
+		dup[i] = strdup(strv[i]);
+		if (!dup[i]) {
+			for (size_t j = 0; j < i; j++) {
+				free(dup[j]);
+			}
+			free(dup);
+			return NULL;
+		}
+	}
+	return dup;
+}
+
+/* Create the placeholder of a lazy tab; returns 1 on success, 0 otherwise */
+static int
+add_lazy_tab(struct cg_profile_launch *launch, struct profile *profile, int position)
+{
+	struct cg_server *server = launch->server;
+	struct profile_tab *profile_tab = &profile->tabs[position];
+
+	struct cg_profile_lazy_tab *lazy = calloc(1, sizeof(*lazy));
+	if (!lazy) {
+		wlr_log(WLR_ERROR, "Failed to allocate lazy profile tab %d", position);
+		return 0;
+	}
+	wl_list_init(&lazy->link);
+	wl_list_init(&lazy->tab_activate.link);
+	wl_list_init(&lazy->tab_background.link);
+	wl_list_init(&lazy->tab_unmap.link);
+	lazy->server = server;
+	lazy->limits = profile->limits;
+
+	char **argv = profile_tab_argv(profile, profile_tab);
+	if (argv) {
+		lazy->argv = strv_dup(argv);
+		free(argv);
+	}
+	const char *working_dir = profile_tab->working_dir ? profile_tab->working_dir : profile->working_dir;
+	lazy->working_dir = working_dir ? strdup(working_dir) : NULL;
+	launch_token(lazy->token, sizeof(lazy->token), launch, position);
+	if (!lazy->argv || (working_dir && !lazy->working_dir) ||
+	    !profile_env_init(&lazy->env, profile) ||
+	    !spawn_env_set(&lazy->env, PROFILE_LAUNCH_TOKEN_ENV, lazy->token)) {
+		wlr_log(WLR_ERROR, "Failed to allocate lazy profile tab %d", position);
+		lazy_tab_destroy(lazy);
+		return 0;
+	}
+
+	lazy->tab = tab_create(server, NULL);
+	if (!lazy->tab) {
+		lazy_tab_destroy(lazy);
+		return 0;
+	}
+	lazy->tab->title = strdup(profile_tab->title ? profile_tab->title : profile_tab->command);
+	if (!lazy->tab->title) {
+		wlr_log(WLR_ERROR, "Failed to allocate lazy profile tab %d", position);
+		tab_destroy(lazy->tab);
+		lazy_tab_destroy(lazy);
+		return 0;
+	}
+	lazy->tab->profile_launch = launch->id;
+	lazy->tab->profile_position = position;
+	tab_set_background(lazy->tab, profile_tab->background);
+
+	/* Listen only once the placeholder is set up; a foreground one is
+	 * started when activated */
+	lazy->tab_activate.notify = handle_lazy_tab_activate;
+	wl_signal_add(&server->events.tab_activate, &lazy->tab_activate);
+	lazy->tab_background.notify = handle_lazy_tab_background;
+	wl_signal_add(&server->events.tab_background, &lazy->tab_background);
+	lazy->tab_unmap.notify = handle_lazy_tab_unmap;
+	wl_signal_add(&server->events.tab_unmap, &lazy->tab_unmap);
+	wl_list_insert(server->profile_lazy_tabs.prev, &lazy->link);
+
+	wlr_log(WLR_DEBUG, "Profile tab %d (%s) is lazy, as tab %u", position, profile_tab->command, lazy->tab->id);
+	return 1;
+}
+
+bool
+profile_launch_start(struct cg_server *server, struct profile *profile)
+{
+	struct cg_profile_launch *launch = calloc(1, sizeof(*launch));
+	if (!launch) {
+		wlr_log(WLR_ERROR, "Failed to allocate profile launch");
+		return false;
+	}
+	launch->server = server;
+	launch->id = ++last_launch_id;
+	launch->name = strdup(profile->name ? profile->name : "");
+	wl_list_init(&launch->pending);
+	wl_list_insert(&server->profile_launches, &launch->link);
+	clock_gettime(CLOCK_MONOTONIC, &launch->started);
+
+	/* One environment for all tabs; only the token differs */
+	struct cg_spawn_env env;
+	if (!launch->name || !profile_env_init(&env, profile)) {
+		wlr_log(WLR_ERROR, "Failed to allocate environment for profile tabs");
+		launch_destroy(launch);
+		return false;
+	}
+
+	int lazy_count = 0;
+	for (int i = 0; i < profile->tab_count; i++) {
+		if (profile->tabs[i].lazy) {
+			lazy_count += add_lazy_tab(launch, profile, i);
+		} else {
+			spawn_launch_tab(launch, profile, i, &env);
+		}
+	}
+	spawn_env_finish(&env);
+
+	if (launch->tab_count == 0) {
+		launch_destroy(launch);
+		return lazy_count > 0 || profile->tab_count == 0;
+	}
+
+	wlr_log(WLR_DEBUG, "Profile '%s': spawned %d tabs in %ld ms", launch->name, launch->tab_count,
+		elapsed_ms(&launch->started));
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(server->wl_display);
+	launch->timeout = wl_event_loop_add_timer(loop, handle_launch_timeout, launch);
+	if (launch->timeout) {
+		wl_event_source_timer_update(launch->timeout, PROFILE_LAUNCH_TIMEOUT_MS);
+	}
+	return true;
+}
+
+/* Read a process' launch token from its environment into dest */
+static bool
+read_process_token(pid_t pid, char *dest, size_t size)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/environ", (int)pid);
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		return false;
+	}
+
+	const char *prefix = PROFILE_LAUNCH_TOKEN_ENV "=";
+	size_t prefix_len = strlen(prefix);
+	char *var = NULL;
+	size_t var_size = 0;
+	bool found = false;
+
+	while (getdelim(&var, &var_size, '\0', f) > 0) {
+		if (strncmp(var, prefix, prefix_len) == 0) {
+			snprintf(dest, size, "%s", var + prefix_len);
+			found = true;
+			break;
+		}
+	}
+
+	free(var);
+	fclose(f);
+	return found;
+}
+
+/* Get the parent of a process, or -1 */
+static pid_t
+process_parent(pid_t pid)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		return -1;
+	}
+
+	/* "PID (COMM) STATE PPID ...", where COMM may contain anything */
+	char buffer[512];
+	size_t n = fread(buffer, 1, sizeof(buffer) - 1, f);
+	fclose(f);
+	buffer[n] = '\0';
+
+	const char *comm_end = strrchr(buffer, ')');
+	int ppid;
+	if (!comm_end || sscanf(comm_end + 1, " %*c %d", &ppid) != 1) {
+		return -1;
+	}
+	return ppid;
+}
+
+/* What a client's process says about where it came from */
+struct client_process {
+	bool has_token;
+	char token[32];
+	pid_t ancestry[PROFILE_LAUNCH_MAX_DEPTH];
+	int depth;
+};
+
+static void
+client_process_init(struct client_process *proc, pid_t pid)
+{
+	proc->has_token = read_process_token(pid, proc->token, sizeof(proc->token));
+	proc->depth = 0;
+
+	/* The ancestry is only needed where the environment isn't readable
+	 * or was cleared on the way, e.g. by a proxy command */
+	if (!proc->has_token) {
+		while (pid > 1 && proc->depth < PROFILE_LAUNCH_MAX_DEPTH) {
+			proc->ancestry[proc->depth++] = pid;
+			pid = process_parent(pid);
+		}
+	}
+}
+
+/* Whether a client is, or descends from, the process spawned as pid with token */
+static bool
+client_process_is(const struct client_process *proc, pid_t pid, const char *token)
+{
+	if (proc->has_token) {
+		return strcmp(proc->token, token) == 0;
+	}
+	for (int i = 0; i < proc->depth; i++) {
+		if (proc->ancestry[i] == pid) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool
+tab_is_placeholder(struct cg_server *server, struct cg_tab *tab)
+{
+	struct cg_profile_lazy_tab *lazy;
+	wl_list_for_each(lazy, &server->profile_lazy_tabs, link) {
+		if (lazy->tab == tab) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static struct cg_profile_launch_tab *
+find_pending(struct cg_server *server, const struct client_process *proc, struct cg_profile_launch **launch_out)
+{
+	struct cg_profile_launch *launch;
+	struct cg_profile_launch_tab *pending;
+	wl_list_for_each(launch, &server->profile_launches, link) {
+		wl_list_for_each(pending, &launch->pending, link) {
+			if (client_process_is(proc, pending->pid, pending->token)) {
+				*launch_out = launch;
+				return pending;
+			}
+		}
+	}
+	return NULL;
+}
+
+bool
+profile_launch_claim(struct cg_tab *tab, pid_t pid, bool *background, bool *activate)
+{
+	struct cg_server *server = tab->server;
+	if (pid <= 0 || wl_list_empty(&server->profile_launches)) {
+		return false;
+	}
+
+	struct client_process proc;
+	client_process_init(&proc, pid);
+
+	struct cg_profile_launch *launch;
+	struct cg_profile_launch_tab *pending = find_pending(server, &proc, &launch);
+	if (!pending) {
+		return false;
+	}
+
+	tab->profile_launch = launch->id;
+	tab->profile_position = pending->position;
+	*background = pending->background;
+	*activate = !pending->background;
+
+	/* Move the tab before the first tab of the launch declared after it,
+	 * and see whether a foreground tab declared before it is already up */
+	struct cg_tab *other;
+	wl_list_for_each(other, &server->tabs, link) {
+		if (other == tab || other->profile_launch != launch->id) {
+			continue;
+		}
+		if (other->profile_position > pending->position) {
+			tab_move_before(tab, other);
+			break;
+		}
+		/* Placeholders of lazy tabs aren't up until activated */
+		if (!other->is_background && !tab_is_placeholder(server, other)) {
+			*activate = false;
+		}
+	}
+
+	wlr_log(WLR_DEBUG, "Tab %u is tab %d of profile '%s'", tab->id, pending->position, launch->name);
+	wl_list_remove(&pending->link);
+	free(pending);
+
+	if (wl_list_empty(&launch->pending)) {
+		wlr_log(WLR_INFO, "Profile '%s': all %d tabs mapped in %ld ms", launch->name, launch->tab_count,
+			elapsed_ms(&launch->started));
+		launch_destroy(launch);
+	}
+	return true;
+}
+
+struct cg_tab *
+profile_launch_claim_placeholder(struct cg_server *server, pid_t pid)
+{
+	if (pid <= 0 || wl_list_empty(&server->profile_lazy_tabs)) {
+		return NULL;
+	}
+
+	struct client_process proc;
+	client_process_init(&proc, pid);
+
+	struct cg_profile_lazy_tab *lazy;
+	wl_list_for_each(lazy, &server->profile_lazy_tabs, link) {
+		if (lazy->pid > 0 && client_process_is(&proc, lazy->pid, lazy->token)) {
+			struct cg_tab *tab = lazy->tab;
+			wlr_log(WLR_DEBUG, "Lazy tab %u started", tab->id);
+			/* The view's title takes over */
+			free(tab->title);
+			tab->title = NULL;
+			lazy_tab_destroy(lazy);
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+static void
+handle_spawn_exit(struct wl_listener *listener, void *data)
+{
+	struct cg_server *server = wl_container_of(listener, server, spawn_exit);
+	struct cg_spawn_exit *report = data;
+
+	/* A process that exits successfully may have left a child behind to
+	 * map the view, as some proxy commands do */
+	if (report->token == 0 || (WIFEXITED(report->status) && WEXITSTATUS(report->status) == 0)) {
+		return;
+	}
+
+	struct cg_profile_launch *launch;
+	struct cg_profile_launch_tab *pending;
+	wl_list_for_each(launch, &server->profile_launches, link) {
+		wl_list_for_each(pending, &launch->pending, link) {
+			if (pending->spawn_token != report->token) {
+				continue;
+			}
+			wlr_log(WLR_ERROR, "Profile '%s': tab %d exited before it mapped", launch->name,
+				pending->position);
+			wl_list_remove(&pending->link);
+			free(pending);
+			if (wl_list_empty(&launch->pending)) {
+				launch_destroy(launch);
+			}
+			return;
+		}
+	}
+
+	struct cg_profile_lazy_tab *lazy;
+	wl_list_for_each(lazy, &server->profile_lazy_tabs, link) {
+		if (lazy->spawn_token == report->token) {
+			/* Stay a placeholder, to be tried again when next shown */
+			wlr_log(WLR_ERROR, "Lazy profile tab exited before it mapped: %s", lazy->argv[0]);
+			lazy->pid = 0;
+			lazy->spawn_token = 0;
+			return;
+		}
+	}
+}
+
+void
+profile_launch_watch_exits(struct cg_server *server)
+{
+	if (server->spawn_helper) {
+		server->spawn_exit.notify = handle_spawn_exit;
+		wl_signal_add(&server->spawn_helper->events.exit, &server->spawn_exit);
+	}
+}
+
+void
+profile_launch_destroy_all(struct cg_server *server)
+{
+	if (server->spawn_exit.notify) {
+		wl_list_remove(&server->spawn_exit.link);
+		server->spawn_exit.notify = NULL;
+	}
+
+	struct cg_profile_launch *launch, *tmp;
+	wl_list_for_each_safe(launch, tmp, &server->profile_launches, link) {
+		launch_destroy(launch);
+	}
+
+	struct cg_profile_lazy_tab *lazy, *lazy_tmp;
+	wl_list_for_each_safe(lazy, lazy_tmp, &server->profile_lazy_tabs, link) {
+		lazy_tab_destroy(lazy);
+	}
+}
@@ -0,0 +1,120 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_PROFILE_LAUNCH_H
+#define CG_PROFILE_LAUNCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#include <wayland-server-core.h>
+
+#include "resources.h"
+#include "spawner.h"
+
+struct cg_server;
+struct cg_tab;
+struct profile;
+
+/* Environment variable carrying a profile tab's token to its process */
+#define PROFILE_LAUNCH_TOKEN_ENV "WAYMUX_LAUNCH_TOKEN"
+
+/* Give up on tabs that haven't mapped after this long */
+#define PROFILE_LAUNCH_TIMEOUT_MS 60000
+
+/*
+ * A profile's tabs are all spawned at once, and map in whatever order
+ * their clients come up. Each spawned process gets a token in its
+ * environment; when a view maps, its client is matched to the profile tab
+ * it was started for, through the token or through its ancestry (for
+ * proxy commands that start the client as a child). The tab then takes
+ * its declared position and background state.
+ */
+struct cg_profile_launch {
+	struct cg_server *server;
+	struct wl_list link; // cg_server::profile_launches
+	uint32_t id;
+	char *name;
+	struct timespec started;
+	int tab_count;
+	struct wl_list pending; // cg_profile_launch_tab::link
+	struct wl_event_source *timeout;
+};
+
+/* A spawned profile tab whose view hasn't mapped yet */
+struct cg_profile_launch_tab {
+	struct wl_list link; // cg_profile_launch::pending
+	pid_t pid;
+	char token[32];
+	uint64_t spawn_token; /* Of the spawn helper's exit report, 0 if none */
+	int position;
+	bool background;
+};
+
+/*
+ * A lazy profile tab, shown as a placeholder tab without a view until it
+ * is first brought to the foreground or activated. Placeholders are
+ * background tabs unless the profile tab is explicitly a foreground one.
+ * It keeps what it needs to start after the profile itself is gone.
+ */
+struct cg_profile_lazy_tab {
+	struct wl_list link; // cg_server::profile_lazy_tabs
+	struct cg_server *server;
+	struct cg_tab *tab;
+	char **argv;
+	char *working_dir;
+	struct cg_spawn_env env;
+	struct cg_resource_limits limits;
+	pid_t pid; /* 0 until started */
+	char token[32];
+	uint64_t spawn_token; /* Of the spawn helper's exit report, 0 if none */
+
+	struct wl_listener tab_activate;
+	struct wl_listener tab_background;
+	struct wl_listener tab_unmap;
+};
+
+/**
+ * Spawn every tab of a profile, and create placeholders for its lazy tabs.
+ * Returns false if none could be started.
+ */
+bool profile_launch_start(struct cg_server *server, struct profile *profile);
+
+/**
+ * Match a newly mapped tab, whose client has process ID pid, to a pending
+ * profile tab. On a match, the tab is moved to its declared position among
+ * the launch's tabs and true is returned, with *background set to its
+ * declared state and *activate to whether it should become the active tab:
+ * of a launch's foreground tabs, the first declared one wins, whichever
+ * order they map in.
+ */
+bool profile_launch_claim(struct cg_tab *tab, pid_t pid, bool *background, bool *activate);
+
+/**
+ * Find the placeholder tab of a started lazy profile tab whose client has
+ * process ID pid. The placeholder is handed over, for the view to take;
+ * returns NULL if pid isn't a lazy tab's.
+ */
+struct cg_tab *profile_launch_claim_placeholder(struct cg_server *server, pid_t pid);
+
+/**
+ * Watch the spawn helper's exit reports: a profile tab whose process
+ * fails before its view maps isn't waited for any longer, and a lazy one
+ * is started again when next shown. Without a helper, tabs are waited for
+ * until PROFILE_LAUNCH_TIMEOUT_MS.
+ */
+void profile_launch_watch_exits(struct cg_server *server);
+
+/**
+ * Forget all launches still in progress, and lazy tabs not yet started.
+ * Call before destroying the spawn helper.
+ */
+void profile_launch_destroy_all(struct cg_server *server);
+
+#endif
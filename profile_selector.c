@@ -7,16 +7,19 @@
  */
 
 #include "profile_selector.h"
+#include "font.h"
+#include "memory_policy.h"
 #include "output.h"
+#include "overlay.h"
 #include "pixel_buffer.h"
 #include "server.h"
 #include "profile.h"
 #include "registry.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <ctype.h>
@@ -40,260 +43,164 @@ static const float selector_box_bg[4] = {0.12f, 0.12f, 0.12f, 1.0f};
 static const float selector_selected_bg[4] = {0.22f, 0.33f, 0.44f, 1.0f};
 static const float selector_text[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 static const float selector_query_bg[4] = {0.08f, 0.08f, 0.08f, 1.0f};
+static const float selector_detail_text[4] = {0.6f, 0.6f, 0.6f, 1.0f};  /* Tab counts */
+static const float selector_scrollbar[4] = {1.0f, 1.0f, 1.0f, 0.3f};    /* Scroll position */
 
-/* Get profiles.d directory path */
-static char *
-get_profiles_dir(void)
-{
-	const char *config_home = getenv("XDG_CONFIG_HOME");
-	char *path = NULL;
-
-	if (!config_home || config_home[0] == '\0') {
-		const char *home = getenv("HOME");
-		if (!home) {
-			wlr_log(WLR_ERROR, "HOME environment variable not set");
-			return NULL;
-		}
-		size_t len = strlen(home) + 30;
-		path = malloc(len);
-		if (!path) {
-			wlr_log_errno(WLR_ERROR, "Failed to allocate path");
-			return NULL;
-		}
-		snprintf(path, len, "%s/.config/waymux/profiles.d", home);
-	} else {
-		size_t len = strlen(config_home) + 20;
-		path = malloc(len);
-		if (!path) {
-			wlr_log_errno(WLR_ERROR, "Failed to allocate path");
-			return NULL;
-		}
-		snprintf(path, len, "%s/waymux/profiles.d", config_home);
-	}
-
-	return path;
-}
-
-/* Scan profiles directory for .toml files */
-static int
-scan_profiles(struct cg_profile_selector *selector)
+/* Bring the profile index up to date, parsing only changed profiles */
+static void
+selector_refresh_profiles(struct cg_profile_selector *selector)
 {
-	char *profiles_dir = get_profiles_dir();
-	if (!profiles_dir) {
-		return -1;
-	}
+	TRACE_SCOPE("selector_refresh_profiles");
 
-	DIR *dir = opendir(profiles_dir);
-	if (!dir) {
-		wlr_log(WLR_DEBUG, "No profiles directory found: %s", profiles_dir);
-		free(profiles_dir);
-		return 0;
+	profile_index_refresh(selector->index, selector->profiles_dir);
+	if (selector->index->dirty && selector->index_path) {
+		profile_index_save(selector->index, selector->index_path);
 	}
 
-	struct dirent *entry;
-	while ((entry = readdir(dir)) != NULL) {
-		/* Skip hidden files and non-TOML files */
-		if (entry->d_name[0] == '.') {
-			continue;
-		}
-
-		size_t len = strlen(entry->d_name);
-		if (len < 6 || strcmp(entry->d_name + len - 5, ".toml") != 0) {
-			continue;
-		}
-
-		/* Check if we have space for more profiles */
-		if (selector->profile_count >= PROFILE_SELECTOR_MAX_PROFILES - 1) {
-			wlr_log(WLR_ERROR, "Too many profiles, max %d", PROFILE_SELECTOR_MAX_PROFILES);
-			break;
-		}
-
-		/* Create profile entry */
-		struct cg_profile_entry *profile_entry = calloc(1, sizeof(struct cg_profile_entry));
-		if (!profile_entry) {
-			wlr_log_errno(WLR_ERROR, "Failed to allocate profile entry");
-			continue;
-		}
-
-		/* Copy name without .toml extension */
-		profile_entry->name = strndup(entry->d_name, len - 5);
-		profile_entry->display_name = strdup(profile_entry->name);
-
-		if (!profile_entry->name || !profile_entry->display_name) {
-			wlr_log_errno(WLR_ERROR, "Failed to duplicate profile name");
-			free(profile_entry->name);
-			free(profile_entry->display_name);
-			free(profile_entry);
-			continue;
-		}
-
-		selector->profiles[selector->profile_count++] = profile_entry;
-		wlr_log(WLR_DEBUG, "Found profile: %s", profile_entry->name);
-	}
-
-	closedir(dir);
-	free(profiles_dir);
-
-	wlr_log(WLR_INFO, "Found %zu profiles", selector->profile_count);
-	return selector->profile_count;
+	wlr_log(WLR_DEBUG, "Found %zu profiles, parsed %zu", selector->index->count, selector->index->parsed);
 }
 
-/* Render selector UI to a buffer */
-static struct wlr_buffer *
-render_selector_ui(struct cg_profile_selector *selector, int screen_width, int screen_height)
+/* Repaint the damaged parts of the selector box */
+static void
+render_selector_ui(struct cg_profile_selector *selector)
 {
-	(void)screen_width;
-	(void)screen_height;
-	int box_width = 600;
-	int box_height = 400;
-
-	/* Only allocate buffer for the selector box area */
-	size_t stride = box_width * 4;
-	size_t size = box_height * stride;
-	uint32_t *data = calloc(1, size);
-	if (!data) {
-		return NULL;
-	}
+	TRACE_SCOPE("render_selector_ui");
 
-	/* Create cairo surface */
-	cairo_surface_t *surface = cairo_image_surface_create_for_data(
-		(unsigned char *)data, CAIRO_FORMAT_ARGB32, box_width, box_height, stride);
-	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
-		free(data);
-		return NULL;
-	}
-
-	cairo_t *cr = cairo_create(surface);
+	struct cg_overlay *overlay = &selector->overlay;
+	cairo_t *cr = overlay_begin_paint(overlay, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT);
 	if (!cr) {
-		cairo_surface_destroy(surface);
-		free(data);
-		return NULL;
+		return;
 	}
 
 	/* Draw selector box background */
 	cairo_set_source_rgba(cr, selector_box_bg[0], selector_box_bg[1],
 			    selector_box_bg[2], selector_box_bg[3]);
-	cairo_rectangle(cr, 0, 0, box_width, box_height);
+	cairo_rectangle(cr, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT);
 	cairo_fill(cr);
 
-	/* Draw search box at top */
-	int search_height = 50;
-	cairo_set_source_rgba(cr, selector_query_bg[0], selector_query_bg[1],
-			    selector_query_bg[2], selector_query_bg[3]);
-	cairo_rectangle(cr, 0, 0, box_width, search_height);
-	cairo_fill(cr);
-
-	/* Draw search query text */
-	cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL,
-			      CAIRO_FONT_WEIGHT_NORMAL);
-	cairo_set_font_size(cr, 14);
-	cairo_set_source_rgb(cr, selector_text[0], selector_text[1], selector_text[2]);
+	font_apply(selector->font, cr);
 
-	/* Draw query text with cursor */
-	char query_display[PROFILE_SELECTOR_MAX_QUERY + 2];
-	snprintf(query_display, sizeof(query_display), "%s|", selector->query);
-	cairo_move_to(cr, 15, 30);
-	cairo_show_text(cr, query_display);
-
-	/* Draw results list */
-	int results_y = search_height + 10;
-	int item_height = 40;
-	int max_items = (box_height - search_height - 20) / item_height;
+	/* Draw search box at top */
+	if (overlay_needs_paint(overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT)) {
+		cairo_set_source_rgba(cr, selector_query_bg[0], selector_query_bg[1],
+				    selector_query_bg[2], selector_query_bg[3]);
+		cairo_rectangle(cr, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT);
+		cairo_fill(cr);
 
-	for (size_t i = 0; i < selector->result_count && i < (size_t)max_items; i++) {
-		int item_y = results_y + i * item_height;
+		/* Draw query text with cursor */
+		cairo_set_source_rgb(cr, selector_text[0], selector_text[1], selector_text[2]);
+		char query_display[PROFILE_SELECTOR_MAX_QUERY + 2];
+		snprintf(query_display, sizeof(query_display), "%s|", selector->query);
+		cairo_move_to(cr, 15, 30);
+		cairo_show_text(cr, query_display);
+	}
+
+	/* Draw the visible window of results, skipping rows that are not damaged */
+	struct cg_result_view *view = &selector->view;
+	size_t visible = result_view_visible(view);
+	for (size_t i = 0; i < visible; i++) {
+		int item_y = OVERLAY_RESULTS_Y + i * OVERLAY_ITEM_HEIGHT;
+		if (!overlay_needs_paint(overlay, 0, item_y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT)) {
+			continue;
+		}
 
 		/* Highlight selected item */
-		if (i == selector->selected_index) {
+		if (view->first + i == view->selected) {
 			cairo_set_source_rgba(cr, selector_selected_bg[0],
 					    selector_selected_bg[1],
 					    selector_selected_bg[2],
 					    selector_selected_bg[3]);
-			cairo_rectangle(cr, 10, item_y, box_width - 20, item_height - 5);
+			cairo_rectangle(cr, 10, item_y, OVERLAY_BOX_WIDTH - 20, OVERLAY_ITEM_HEIGHT - 5);
 			cairo_fill(cr);
 		}
 
+		/* Draw the tab count on the right, from the index */
+		struct cg_profile_info *info = selector->results[view->first + i].info;
+		double detail_width = 0;
+		if (info != &selector->no_profile) {
+			char detail[32];
+			if (info->tab_count < 0) {
+				snprintf(detail, sizeof(detail), "invalid");
+			} else {
+				snprintf(detail, sizeof(detail), "%d tab%s", info->tab_count,
+					 info->tab_count == 1 ? "" : "s");
+			}
+			double text_width = font_text_width(selector->font, detail);
+			detail_width = text_width + 20;
+			cairo_set_source_rgb(cr, selector_detail_text[0], selector_detail_text[1],
+					     selector_detail_text[2]);
+			cairo_move_to(cr, OVERLAY_BOX_WIDTH - 20 - text_width, item_y + 25);
+			cairo_show_text(cr, detail);
+		}
+
 		/* Draw profile name */
-		struct cg_profile_entry *entry = selector->results[i];
 		cairo_set_source_rgb(cr, selector_text[0], selector_text[1], selector_text[2]);
 		cairo_move_to(cr, 20, item_y + 25);
 
 		/* Truncate name if too long */
-		char name_display[100];
-		snprintf(name_display, sizeof(name_display), "%s", entry->display_name);
+		char name_display[256];
+		font_truncate_to_width(selector->font, info->name, OVERLAY_BOX_WIDTH - 40 - detail_width,
+				       name_display, sizeof(name_display));
 		cairo_show_text(cr, name_display);
 	}
 
-	cairo_destroy(cr);
-	cairo_surface_finish(surface);
-	cairo_surface_destroy(surface);
-
-	/* Create wlr_buffer wrapper */
-	struct pixel_buffer *buffer = calloc(1, sizeof(*buffer));
-	if (!buffer) {
-		free(data);
-		return NULL;
+	/* Show where the window is within a longer list. Drawn whole every
+	 * time; the clip limits it to the damaged rows. */
+	if (view->total > view->rows) {
+		double track = view->rows * OVERLAY_ITEM_HEIGHT;
+		double height = track * view->rows / view->total;
+		if (height < 10) {
+			height = 10;
+		}
+		double y = OVERLAY_RESULTS_Y + (track - height) * view->first / (view->total - view->rows);
+		cairo_set_source_rgba(cr, selector_scrollbar[0], selector_scrollbar[1],
+				    selector_scrollbar[2], selector_scrollbar[3]);
+		cairo_rectangle(cr, OVERLAY_BOX_WIDTH - 8, y, 4, height);
+		cairo_fill(cr);
 	}
 
-	wlr_buffer_init(&buffer->base, &pixel_buffer_impl, box_width, box_height);
-	buffer->data = data;
-	buffer->width = box_width;
-	buffer->height = box_height;
-	buffer->size = size;
-
-	return &buffer->base;
+	overlay_end_paint(overlay, cr, selector->content_buffer);
 }
 
 /* Update the rendered selector UI */
-static void
-selector_update_render(struct cg_profile_selector *selector)
+void
+profile_selector_flush(struct cg_profile_selector *selector)
 {
-	if (!selector->is_visible || !selector->dirty) {
+	if (!selector || !selector->is_visible || !selector->dirty) {
 		return;
 	}
 	/* Don't return early if content_buffer is NULL - we need to create it on first render */
 
-	/* Get output dimensions and position */
-	struct cg_output *output;
-	wl_list_for_each(output, &selector->server->outputs, link) {
-		int screen_width = output->wlr_output->width;
-		int screen_height = output->wlr_output->height;
-
-		/* Calculate position for centered selector box */
-		int box_width = 600;
-		int box_height = 400;
-		int box_x = (screen_width - box_width) / 2;
-		int box_y = (screen_height - box_height) / 2;
-
+	/* Center the selector box on the focused output, at its scale */
+	int box_x, box_y;
+	struct cg_output *output =
+		output_center_box(selector->server, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT, &box_x, &box_y);
+	if (output) {
 		/* Create content buffer on-demand if it doesn't exist */
 		if (!selector->content_buffer) {
 			selector->content_buffer = wlr_scene_buffer_create(selector->scene_tree, NULL);
 		}
 
-		/* Position the content buffer at the correct location */
-		wlr_scene_node_set_position(&selector->content_buffer->node,
-					    box_x, box_y);
-
-		/* Render new UI */
-		struct wlr_buffer *new_buffer = render_selector_ui(selector,
-								screen_width, screen_height);
-		if (new_buffer) {
-			wlr_scene_buffer_set_buffer(selector->content_buffer, new_buffer);
-			wlr_buffer_drop(new_buffer);
-		}
-
-		/* Re-set position AFTER setting buffer content to ensure it's correct */
+		/* Repaint what changed */
+		overlay_set_scale(&selector->overlay, output->wlr_output->scale);
+		render_selector_ui(selector);
 		wlr_scene_node_set_position(&selector->content_buffer->node, box_x, box_y);
 
 		selector->dirty = false;
-
-		break; /* Use first output */
 	}
 }
 
+/* Coalesce changes into one repaint on the next output frame */
+static void
+selector_schedule_render(struct cg_profile_selector *selector)
+{
+	selector->dirty = true;
+	output_schedule_frames(selector->server);
+}
+
 /* Case-insensitive substring match */
 static bool
-profile_matches(const struct cg_profile_entry *profile, const char *query)
+profile_matches(const struct cg_profile_info *profile, const char *query)
 {
 	if (!query || query[0] == '\0') {
 		return true;
@@ -304,50 +211,97 @@ profile_matches(const struct cg_profile_entry *profile, const char *query)
 	char query_lower[PROFILE_SELECTOR_MAX_QUERY];
 
 	size_t i;
-	for (i = 0; i < strlen(profile->name) && i < sizeof(profile_lower) - 1; i++) {
-		profile_lower[i] = tolower(profile->name[i]);
+	for (i = 0; profile->name[i] && i < sizeof(profile_lower) - 1; i++) {
+		profile_lower[i] = tolower((unsigned char)profile->name[i]);
 	}
 	profile_lower[i] = '\0';
 
-	for (i = 0; i < strlen(query) && i < sizeof(query_lower) - 1; i++) {
-		query_lower[i] = tolower(query[i]);
+	for (i = 0; query[i] && i < sizeof(query_lower) - 1; i++) {
+		query_lower[i] = tolower((unsigned char)query[i]);
 	}
 	query_lower[i] = '\0';
 
 	return strstr(profile_lower, query_lower) != NULL;
 }
 
+/* Most launched (weighed by recency) first, then by name */
+static int
+compare_results(const void *a, const void *b)
+{
+	const struct cg_profile_result *ra = a;
+	const struct cg_profile_result *rb = b;
+	if (ra->score != rb->score) {
+		return ra->score > rb->score ? -1 : 1;
+	}
+	return strcmp(ra->info->name, rb->info->name);
+}
+
 /* Update filtered results based on current query */
 static void
 selector_update_results(struct cg_profile_selector *selector)
 {
-	selector->result_count = 0;
-	selector->selected_index = 0;
+	struct cg_profile_index *index = selector->index;
+	result_view_reset(&selector->view, 0, OVERLAY_MAX_ITEMS);
+
+	/* Room for every profile, and "(no profile)" */
+	if (selector->result_capacity < index->count + 1) {
+		struct cg_profile_result *results = realloc(selector->results, (index->count + 1) * sizeof(*results));
+		if (!results) {
+			wlr_log_errno(WLR_ERROR, "Failed to allocate profile selector results");
+			return;
+		}
+		selector->results = results;
+		selector->result_capacity = index->count + 1;
+	}
 
 	/* Add special "(no profile)" option at the top if query is empty */
+	size_t count = 0;
 	if (selector->query[0] == '\0') {
-		/* The first profile entry is always the "(no profile)" option */
-		if (selector->profile_count > 0 && selector->profiles[0]) {
-			selector->results[selector->result_count++] = selector->profiles[0];
+		selector->results[count++] = (struct cg_profile_result){.info = &selector->no_profile};
+	}
+
+	/* Filter profiles based on query, and rank the matches */
+	size_t first_profile = count;
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	for (size_t i = 0; i < index->count; i++) {
+		struct cg_profile_info *info = &index->profiles[i];
+		if (profile_matches(info, selector->query)) {
+			selector->results[count++] = (struct cg_profile_result){
+				.info = info,
+				.score = profile_index_score(info, now.tv_sec),
+			};
 		}
 	}
+	qsort(selector->results + first_profile, count - first_profile, sizeof(*selector->results),
+	      compare_results);
 
-	/* Filter profiles based on query */
-	for (size_t i = 0; i < selector->profile_count; i++) {
-		/* Skip the "(no profile)" entry when doing regular matching */
-		if (i == 0 && strcmp(selector->profiles[i]->name, "(no profile)") == 0) {
-			continue;
-		}
+	result_view_reset(&selector->view, count, OVERLAY_MAX_ITEMS);
 
-		if (profile_matches(selector->profiles[i], selector->query)) {
-			if (selector->result_count < PROFILE_SELECTOR_MAX_PROFILES) {
-				selector->results[selector->result_count++] = selector->profiles[i];
-			}
-		}
+	/* The query line and the whole result list change */
+	overlay_damage_query(&selector->overlay);
+	overlay_damage_results(&selector->overlay);
+	selector_schedule_render(selector);
+}
+
+/* Move the selection, scrolling the window if it leaves it */
+static void
+selector_move_selection(struct cg_profile_selector *selector, long delta)
+{
+	struct cg_result_view *view = &selector->view;
+	if (view->total == 0) {
+		return;
 	}
 
-	selector->dirty = true;
-	selector_update_render(selector);
+	overlay_damage_row(&selector->overlay, view->selected - view->first);
+	if (result_view_move(view, delta, true)) {
+		overlay_damage_results(&selector->overlay);
+	} else {
+		overlay_damage_row(&selector->overlay, view->selected - view->first);
+	}
+
+	wlr_log(WLR_DEBUG, "Selected: %zu/%zu", view->selected, view->total);
+	selector_schedule_render(selector);
 }
 
 struct cg_profile_selector *
@@ -364,14 +318,21 @@ profile_selector_create(struct cg_server *server)
 	selector->dirty = false;
 	selector->query[0] = '\0';
 	selector->query_len = 0;
-	selector->result_count = 0;
-	selector->selected_index = 0;
 	selector->content_buffer = NULL;
+	overlay_init(&selector->overlay);
+	result_view_reset(&selector->view, 0, OVERLAY_MAX_ITEMS);
+
+	selector->font = font_create("sans-serif", 14);
+	if (!selector->font) {
+		free(selector);
+		return NULL;
+	}
 
 	/* Create scene tree for selector overlay */
 	selector->scene_tree = wlr_scene_tree_create(&server->scene->tree);
 	if (!selector->scene_tree) {
 		wlr_log(WLR_ERROR, "Failed to create profile selector scene tree");
+		font_destroy(selector->font);
 		free(selector);
 		return NULL;
 	}
@@ -386,6 +347,7 @@ profile_selector_create(struct cg_server *server)
 	if (!selector->background) {
 		wlr_log(WLR_ERROR, "Failed to create profile selector background");
 		wlr_scene_node_destroy(&selector->scene_tree->node);
+		font_destroy(selector->font);
 		free(selector);
 		return NULL;
 	}
@@ -393,31 +355,29 @@ profile_selector_create(struct cg_server *server)
 	/* Position background at (0, 0) explicitly */
 	wlr_scene_node_set_position(&selector->background->node, 0, 0);
 
-	/* Create special "(no profile)" entry */
-	struct cg_profile_entry *no_profile = calloc(1, sizeof(struct cg_profile_entry));
-	if (no_profile) {
-		no_profile->name = strdup("(no profile)");
-		no_profile->display_name = strdup("(no profile)");
-		if (no_profile->name && no_profile->display_name) {
-			selector->profiles[selector->profile_count++] = no_profile;
-		} else {
-			free(no_profile->name);
-			free(no_profile->display_name);
-			free(no_profile);
-		}
-	}
-
-	/* Scan for available profiles */
-	if (scan_profiles(selector) < 0) {
-		wlr_log(WLR_ERROR, "Failed to scan profiles directory");
-		/* Continue anyway - we still have the "(no profile)" option */
+	/* Only read the index for now; the profiles themselves are looked
+	 * at when the selector is shown */
+	selector->profiles_dir = profile_dir();
+	selector->index_path = profile_index_default_path();
+	selector->index = profile_index_load(selector->index_path);
+	selector->no_profile.name = strdup("(no profile)");
+	if (!selector->index || !selector->no_profile.name) {
+		wlr_log(WLR_ERROR, "Failed to allocate profile index");
+		profile_index_destroy(selector->index);
+		free(selector->no_profile.name);
+		free(selector->profiles_dir);
+		free(selector->index_path);
+		wlr_scene_node_destroy(&selector->scene_tree->node);
+		font_destroy(selector->font);
+		free(selector);
+		return NULL;
 	}
 
 	/* Initially hidden */
 	wlr_scene_node_set_enabled(&selector->scene_tree->node, false);
 	wlr_scene_node_raise_to_top(&selector->scene_tree->node);
 
-	wlr_log(WLR_DEBUG, "Profile selector created with %zu profiles", selector->profile_count);
+	wlr_log(WLR_DEBUG, "Profile selector created with %zu indexed profiles", selector->index->count);
 	return selector;
 }
 
@@ -428,17 +388,16 @@ profile_selector_destroy(struct cg_profile_selector *selector)
 		return;
 	}
 
-	/* Free profile entries */
-	for (size_t i = 0; i < selector->profile_count; i++) {
-		if (selector->profiles[i]) {
-			free(selector->profiles[i]->name);
-			free(selector->profiles[i]->display_name);
-			free(selector->profiles[i]);
-		}
-	}
+	profile_index_destroy(selector->index);
+	free(selector->results);
+	free(selector->no_profile.name);
+	free(selector->profiles_dir);
+	free(selector->index_path);
 
 	/* Scene tree cleanup is handled by wlroots when destroyed */
 	wlr_scene_node_destroy(&selector->scene_tree->node);
+	overlay_finish(&selector->overlay);
+	font_destroy(selector->font);
 	free(selector);
 
 	wlr_log(WLR_DEBUG, "Profile selector destroyed");
@@ -454,32 +413,23 @@ profile_selector_show(struct cg_profile_selector *selector)
 	/* Reset query and show all profiles */
 	selector->query[0] = '\0';
 	selector->query_len = 0;
-	selector->selected_index = 0;
-
-	/* Get the first output's dimensions */
-	struct cg_output *output;
-	int screen_width = 0;
-	int screen_height = 0;
-	wl_list_for_each(output, &selector->server->outputs, link) {
-		struct wlr_output *wlr_output = output->wlr_output;
-		screen_width = wlr_output->width;
-		screen_height = wlr_output->height;
-
-		/* Resize background to match output */
-		wlr_scene_rect_set_size(selector->background, screen_width, screen_height);
 
-		break; /* Use first output for now */
-	}
+	/* Pick up added, changed and removed profiles */
+	selector_refresh_profiles(selector);
 
-	/* Create and position content buffer BEFORE enabling scene tree */
-	if (!selector->content_buffer && screen_width > 0 && screen_height > 0) {
-		int box_width = 600;
-		int box_height = 400;
-		int box_x = (screen_width - box_width) / 2;
-		int box_y = (screen_height - box_height) / 2;
+	/* Cover the focused output with the background */
+	struct wlr_box box;
+	if (output_focused_box(selector->server, &box)) {
+		wlr_scene_rect_set_size(selector->background, box.width, box.height);
+		wlr_scene_node_set_position(&selector->background->node, box.x, box.y);
 
-		selector->content_buffer = wlr_scene_buffer_create(selector->scene_tree, NULL);
-		wlr_scene_node_set_position(&selector->content_buffer->node, box_x, box_y);
+		/* Create and position content buffer BEFORE enabling scene tree */
+		if (!selector->content_buffer && box.width > 0 && box.height > 0) {
+			selector->content_buffer = wlr_scene_buffer_create(selector->scene_tree, NULL);
+			wlr_scene_node_set_position(&selector->content_buffer->node,
+						    box.x + (box.width - OVERLAY_BOX_WIDTH) / 2,
+						    box.y + (box.height - OVERLAY_BOX_HEIGHT) / 2);
+		}
 	}
 
 	/* Record when selector was shown (for input grace period) */
@@ -503,10 +453,20 @@ profile_selector_hide(struct cg_profile_selector *selector)
 
 	wlr_scene_node_set_enabled(&selector->scene_tree->node, false);
 	selector->is_visible = false;
+	memory_policy_schedule_trim(selector->server->memory);
 
 	wlr_log(WLR_DEBUG, "Profile selector hidden");
 }
 
+size_t
+profile_selector_release(struct cg_profile_selector *selector)
+{
+	if (!selector || selector->is_visible) {
+		return 0;
+	}
+	return overlay_release(&selector->overlay, selector->content_buffer);
+}
+
 void
 profile_selector_reposition(struct cg_profile_selector *selector)
 {
@@ -514,32 +474,13 @@ profile_selector_reposition(struct cg_profile_selector *selector)
 		return;
 	}
 
-	/* Get the first output's dimensions */
-	struct cg_output *output;
-	wl_list_for_each(output, &selector->server->outputs, link) {
-		struct wlr_output *wlr_output = output->wlr_output;
-		int screen_width = wlr_output->width;
-		int screen_height = wlr_output->height;
-
-		/* Resize background to match output */
-		wlr_scene_rect_set_size(selector->background, screen_width, screen_height);
-
-		/* Calculate centered position */
-		int box_width = 600;
-		int box_height = 400;
-		int box_x = (screen_width - box_width) / 2;
-		int box_y = (screen_height - box_height) / 2;
-
-		/* Update content buffer position */
-		if (selector->content_buffer) {
-			wlr_scene_node_set_position(&selector->content_buffer->node, box_x, box_y);
-		}
-
-		/* Mark for re-render */
-		selector->dirty = true;
-		selector_update_render(selector);
-
-		break; /* Use first output */
+	/* Cover the focused output with the background; the box is
+	 * positioned, at the output's scale, on the next render */
+	struct wlr_box box;
+	if (output_focused_box(selector->server, &box)) {
+		wlr_scene_rect_set_size(selector->background, box.width, box.height);
+		wlr_scene_node_set_position(&selector->background->node, box.x, box.y);
+		selector_schedule_render(selector);
 	}
 }
 
@@ -573,25 +514,26 @@ profile_selector_handle_key(struct cg_profile_selector *selector, xkb_keysym_t s
 
 	case XKB_KEY_Return:
 		/* Select the chosen profile */
-		if (selector->result_count > 0 &&
-		    selector->selected_index < selector->result_count) {
-			struct cg_profile_entry *entry =
-				selector->results[selector->selected_index];
+		if (selector->view.total > 0) {
+			struct cg_profile_info *info = selector->results[selector->view.selected].info;
 
-			wlr_log(WLR_INFO, "Selected profile: %s", entry->name);
+			wlr_log(WLR_INFO, "Selected profile: %s", info->name);
 
 			/* Hide selector first */
 			profile_selector_hide(selector);
 
 			/* Check if "(no profile)" was selected */
-			if (strcmp(entry->name, "(no profile)") == 0) {
+			if (info == &selector->no_profile) {
 				wlr_log(WLR_INFO, "Starting without a profile");
 				/* Just hide selector, don't spawn anything */
 			} else {
-				/* Spawn the selected profile */
-				if (!spawn_profile_tabs(selector->server, entry->name)) {
-					wlr_log(WLR_ERROR, "Failed to spawn profile: %s", entry->name);
+				/* Spawning records the launch, which may refresh
+				 * the index under info */
+				char *name = strdup(info->name);
+				if (name && !spawn_profile_tabs(selector->server, name)) {
+					wlr_log(WLR_ERROR, "Failed to spawn profile: %s", name);
 				}
+				free(name);
 			}
 		}
 		break;
@@ -609,33 +551,13 @@ profile_selector_handle_key(struct cg_profile_selector *selector, xkb_keysym_t s
 		break;
 
 	case XKB_KEY_Up:
-		/* Navigate up in results */
-		if (selector->result_count > 0) {
-			if (selector->selected_index > 0) {
-				selector->selected_index--;
-			} else {
-				/* Wrap to bottom */
-				selector->selected_index = selector->result_count - 1;
-			}
-			wlr_log(WLR_DEBUG, "Selected: %zu/%zu",
-			        selector->selected_index, selector->result_count);
-			selector->dirty = true;
-			selector_update_render(selector);
-		}
+		/* Navigate up in results, wrapping to the bottom */
+		selector_move_selection(selector, -1);
 		break;
 
 	case XKB_KEY_Down:
-		/* Navigate down in results */
-		if (selector->result_count > 0) {
-			selector->selected_index++;
-			if (selector->selected_index >= selector->result_count) {
-				selector->selected_index = 0;  /* Wrap to top */
-			}
-			wlr_log(WLR_DEBUG, "Selected: %zu/%zu",
-			        selector->selected_index, selector->result_count);
-			selector->dirty = true;
-			selector_update_render(selector);
-		}
+		/* Navigate down in results, wrapping to the top */
+		selector_move_selection(selector, 1);
 		break;
 
 	default:
@@ -655,3 +577,26 @@ profile_selector_handle_key(struct cg_profile_selector *selector, xkb_keysym_t s
 
 	return handled;
 }
+
+void
+profile_selector_record_launch(struct cg_profile_selector *selector, const char *profile_name)
+{
+	if (!selector) {
+		return;
+	}
+
+	/* A profile launched before the selector was ever shown may not be
+	 * indexed yet; one from the current directory never is */
+	if (!profile_index_find(selector->index, profile_name)) {
+		selector_refresh_profiles(selector);
+		if (selector->is_visible) {
+			selector_update_results(selector);
+		}
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	if (profile_index_record_launch(selector->index, profile_name, now.tv_sec) && selector->index_path) {
+		profile_index_save(selector->index, selector->index_path);
+	}
+}
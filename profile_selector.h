@@ -14,22 +14,28 @@
 #include <wlr/util/box.h>
 #include <xkbcommon/xkbcommon.h>
 
+#include "overlay.h"
+#include "profile_index.h"
+#include "result_view.h"
+
 #define PROFILE_SELECTOR_MAX_QUERY 256
-#define PROFILE_SELECTOR_MAX_PROFILES 256
 
 struct cg_server;
+struct cg_font;
 
-/* Represents a discoverable profile */
-struct cg_profile_entry {
-	char *name;           /* Profile name (filename without .toml) */
-	char *display_name;   /* Display name (could be enhanced later) */
+/* A profile matching the query, with its launch frequency rank */
+struct cg_profile_result {
+	struct cg_profile_info *info;
+	uint64_t score;
 };
 
 struct cg_profile_selector {
 	struct cg_server *server;
 	struct wlr_scene_tree *scene_tree;
 	struct wlr_scene_rect *background;
+	struct cg_font *font;
 	struct wlr_scene_buffer *content_buffer;  /* Rendered selector UI */
+	struct cg_overlay overlay;                /* Retained pixels and damage */
 	bool is_visible;
 	bool dirty;  /* UI needs re-rendering */
 
@@ -40,14 +46,18 @@ struct cg_profile_selector {
 	char query[PROFILE_SELECTOR_MAX_QUERY];
 	size_t query_len;
 
-	/* All discoverable profiles */
-	struct cg_profile_entry *profiles[PROFILE_SELECTOR_MAX_PROFILES];
-	size_t profile_count;
+	/* All discoverable profiles, refreshed whenever the selector is shown */
+	struct cg_profile_index *index;
+	char *index_path;
+	char *profiles_dir;
+
+	/* The "(no profile)" option, listed first when the query is empty */
+	struct cg_profile_info no_profile;
 
-	/* Filtered results */
-	struct cg_profile_entry *results[PROFILE_SELECTOR_MAX_PROFILES];
-	size_t result_count;
-	size_t selected_index;
+	/* Filtered results, best ranked first */
+	struct cg_profile_result *results;
+	size_t result_capacity;
+	struct cg_result_view view;
 };
 
 struct cg_profile_selector *profile_selector_create(struct cg_server *server);
@@ -56,9 +66,18 @@ void profile_selector_show(struct cg_profile_selector *selector);
 void profile_selector_hide(struct cg_profile_selector *selector);
 void profile_selector_reposition(struct cg_profile_selector *selector);
 
+/* Drop the pixels of a hidden selector; returns the bytes freed */
+size_t profile_selector_release(struct cg_profile_selector *selector);
+
+/* Repaint pending changes; called once per output frame */
+void profile_selector_flush(struct cg_profile_selector *selector);
+
 /* Keyboard input handling */
 /* Returns true if key was handled, false otherwise */
 /* When user selects a profile, selector sets server->profile_name and hides itself */
 bool profile_selector_handle_key(struct cg_profile_selector *selector, xkb_keysym_t sym, uint32_t keycode);
 
+/* Count a launch of a profile towards its rank in the selector */
+void profile_selector_record_launch(struct cg_profile_selector *selector, const char *profile_name);
+
 #endif
@@ -6,247 +6,309 @@
  * See the LICENSE file accompanying this file.
  */
 
+#define _POSIX_C_SOURCE 200809L
+/* For flock() */
+#define _DEFAULT_SOURCE
+
 #include "registry.h"
 
-#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <wlr/util/log.h>
-#include <tomlc17.h>
 
 #include "server.h"
 
+/*
+ * The registry directory holds a lock file per running instance and per
+ * profile in use, each locked with flock() by its instance for as long as
+ * it runs. The kernel drops the locks of an instance that crashes, so
+ * lock files are never stale, and are never removed either: removing a
+ * lock file while another instance opens it would let two instances lock
+ * different files of the same name.
+ *
+ * Alongside them, the index lists the running instances, one per line as
+ * "name\tpid\tprofile", for waymuxctl to list them without opening every
+ * file. It is rewritten under its own lock, dropping the lines of
+ * instances whose lock is no longer held.
+ */
 #define REGISTRY_DIR "/waymux/registry"
+#define REGISTRY_INSTANCES_DIR "instances"
+#define REGISTRY_PROFILES_DIR "profiles"
+#define REGISTRY_INDEX "index"
 
-/* Get the registry directory path */
-static char *
-get_registry_dir_path(void)
+/* Locks held by this instance, -1 when not held */
+static int instance_lock_fd = -1;
+static int profile_lock_fd = -1;
+
+/* Build a path in the registry directory; subdir and name may be NULL */
+static bool
+registry_path(char *dest, size_t dest_size, const char *subdir, const char *name)
 {
 	const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
 	if (!runtime_dir) {
 		wlr_log(WLR_ERROR, "XDG_RUNTIME_DIR not set");
-		return NULL;
+		return false;
 	}
 
-	size_t len = strlen(runtime_dir) + sizeof(REGISTRY_DIR);
-	char *path = malloc(len);
-	if (!path) {
-		wlr_log_errno(WLR_ERROR, "Failed to allocate registry dir path");
-		return NULL;
+	int len;
+	if (subdir && name) {
+		len = snprintf(dest, dest_size, "%s%s/%s/%s.lock", runtime_dir, REGISTRY_DIR, subdir, name);
+	} else if (subdir) {
+		len = snprintf(dest, dest_size, "%s%s/%s", runtime_dir, REGISTRY_DIR, subdir);
+	} else {
+		len = snprintf(dest, dest_size, "%s%s", runtime_dir, REGISTRY_DIR);
+	}
+	if (len < 0 || (size_t)len >= dest_size) {
+		wlr_log(WLR_ERROR, "Registry path too long");
+		return false;
 	}
+	return true;
+}
+
+/* Ensure the registry directory and its lock directories exist */
+static bool
+ensure_registry_dir(void)
+{
+	const char *subdirs[] = {NULL, REGISTRY_INSTANCES_DIR, REGISTRY_PROFILES_DIR};
+	for (size_t i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); i++) {
+		char path[PATH_MAX];
+		if (!registry_path(path, sizeof(path), subdirs[i], NULL)) {
+			return false;
+		}
 
-	snprintf(path, len, "%s%s", runtime_dir, REGISTRY_DIR);
-	return path;
+		/* The registry itself is under the runtime directory's waymux
+		 * directory, which may not exist yet either */
+		if (!subdirs[i]) {
+			char *slash = strrchr(path, '/');
+			*slash = '\0';
+			if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+				wlr_log_errno(WLR_ERROR, "Failed to create directory: %s", path);
+				return false;
+			}
+			*slash = '/';
+		}
+
+		/* Create directory if it doesn't exist */
+		if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+			wlr_log_errno(WLR_ERROR, "Failed to create registry directory: %s", path);
+			return false;
+		}
+	}
+	return true;
 }
 
-/* Get the registry file path for an instance */
-static char *
-get_registry_file_path(const char *instance_name)
+/* Take the lock of a lock file without waiting. Returns its fd, -1 if
+ * another instance holds it or on error, with errno set. */
+static int
+take_lock(const char *subdir, const char *name)
 {
-	char *registry_dir = get_registry_dir_path();
-	if (!registry_dir) {
-		return NULL;
+	char path[PATH_MAX];
+	if (!registry_path(path, sizeof(path), subdir, name)) {
+		errno = ENAMETOOLONG;
+		return -1;
 	}
 
-	size_t len = strlen(registry_dir) + strlen(instance_name) + 7; /* "/" + ".toml" + null */
-	char *path = malloc(len);
-	if (!path) {
-		wlr_log_errno(WLR_ERROR, "Failed to allocate registry file path");
-		free(registry_dir);
-		return NULL;
+	/* Close-on-exec, so that tabs' applications don't hold the lock */
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to open registry lock file: %s", path);
+		return -1;
 	}
 
-	snprintf(path, len, "%s/%s.toml", registry_dir, instance_name);
-	free(registry_dir);
-	return path;
+	if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+		int saved_errno = errno;
+		close(fd);
+		errno = saved_errno;
+		return -1;
+	}
+	return fd;
 }
 
-/* Ensure the registry directory exists */
+/* Whether an instance with the given name holds its lock */
 static bool
-ensure_registry_dir(void)
+instance_is_running(const char *name)
 {
-	char *registry_dir = get_registry_dir_path();
-	if (!registry_dir) {
+	char path[PATH_MAX];
+	if (!registry_path(path, sizeof(path), REGISTRY_INSTANCES_DIR, name)) {
 		return false;
 	}
 
-	/* Create directory if it doesn't exist */
-	if (mkdir(registry_dir, 0755) != 0) {
-		if (errno != EEXIST) {
-			wlr_log_errno(WLR_ERROR, "Failed to create registry directory: %s", registry_dir);
-			free(registry_dir);
-			return false;
-		}
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
 	}
 
-	free(registry_dir);
-	return true;
+	bool running = flock(fd, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+	close(fd);
+	return running;
 }
 
-bool
-registry_register_instance(struct cg_server *server)
+/* Rewrite the index with the lines of the other running instances, and
+ * this instance's line if pid is positive */
+static bool
+index_update(const char *name, pid_t pid, const char *profile)
 {
-	if (!server || !server->instance_name) {
-		wlr_log(WLR_ERROR, "Invalid server or instance name");
+	char path[PATH_MAX];
+	if (!registry_path(path, sizeof(path), REGISTRY_INDEX, NULL)) {
 		return false;
 	}
 
-	/* Ensure registry directory exists */
-	if (!ensure_registry_dir()) {
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to open registry index: %s", path);
 		return false;
 	}
-
-	/* Check if this instance is already registered (shouldn't happen) */
-	char *registry_file = get_registry_file_path(server->instance_name);
-	if (!registry_file) {
+	if (flock(fd, LOCK_EX) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to lock registry index: %s", path);
+		close(fd);
 		return false;
 	}
 
-	/* Check if file already exists */
-	struct stat st;
-	if (stat(registry_file, &st) == 0) {
-		wlr_log(WLR_ERROR, "Instance '%s' is already registered", server->instance_name);
-		free(registry_file);
+	FILE *in = fdopen(dup(fd), "r");
+	char *out = NULL;
+	size_t out_len = 0;
+	FILE *stream = open_memstream(&out, &out_len);
+	if (!in || !stream) {
+		wlr_log_errno(WLR_ERROR, "Failed to update registry index");
+		if (in) {
+			fclose(in);
+		}
+		if (stream) {
+			fclose(stream);
+		}
+		free(out);
+		close(fd);
 		return false;
 	}
 
-	/* Create the registry file */
-	FILE *f = fopen(registry_file, "w");
-	if (!f) {
-		wlr_log_errno(WLR_ERROR, "Failed to create registry file: %s", registry_file);
-		free(registry_file);
-		return false;
+	char *line = NULL;
+	size_t line_size = 0;
+	ssize_t line_len;
+	while ((line_len = getline(&line, &line_size, in)) > 0) {
+		size_t name_len = strcspn(line, "\t\n");
+		if (line[name_len] != '\t') {
+			continue;
+		}
+		line[name_len] = '\0';
+		bool keep = strcmp(line, name) != 0 && instance_is_running(line);
+		line[name_len] = '\t';
+		if (keep) {
+			fwrite(line, 1, line_len, stream);
+		}
 	}
+	free(line);
+	fclose(in);
 
-	/* Write instance metadata */
-	fprintf(f, "name = \"%s\"\n", server->instance_name);
-	fprintf(f, "pid = %d\n", getpid());
-
-	if (server->profile_name) {
-		fprintf(f, "profile = \"%s\"\n", server->profile_name);
+	if (pid > 0) {
+		fprintf(stream, "%s\t%d\t%s\n", name, (int)pid, profile ? profile : "");
 	}
+	fclose(stream);
 
-	fclose(f);
-	wlr_log(WLR_INFO, "Registered instance '%s' in registry", server->instance_name);
-
-	free(registry_file);
-	return true;
+	bool ok = ftruncate(fd, 0) == 0 && pwrite(fd, out, out_len, 0) == (ssize_t)out_len;
+	if (!ok) {
+		wlr_log_errno(WLR_ERROR, "Failed to write registry index: %s", path);
+	}
+	free(out);
+	close(fd);
+	return ok;
 }
 
 bool
-registry_unregister_instance(struct cg_server *server)
+registry_register_instance(struct cg_server *server)
 {
 	if (!server || !server->instance_name) {
 		wlr_log(WLR_ERROR, "Invalid server or instance name");
 		return false;
 	}
 
-	char *registry_file = get_registry_file_path(server->instance_name);
-	if (!registry_file) {
+	/* Instance names end up in paths and index lines */
+	if (strpbrk(server->instance_name, "/\t\n")) {
+		wlr_log(WLR_ERROR, "Instance name '%s' can't be registered", server->instance_name);
 		return false;
 	}
 
-	/* Remove the registry file */
-	if (unlink(registry_file) != 0) {
-		if (errno == ENOENT) {
-			wlr_log(WLR_DEBUG, "Registry file for instance '%s' does not exist (already unregistered?)",
-				server->instance_name);
-		} else {
-			wlr_log_errno(WLR_ERROR, "Failed to remove registry file: %s", registry_file);
-			free(registry_file);
+	/* Ensure registry directory exists */
+	if (!ensure_registry_dir()) {
+		return false;
+	}
+
+	if (instance_lock_fd < 0) {
+		instance_lock_fd = take_lock(REGISTRY_INSTANCES_DIR, server->instance_name);
+		if (instance_lock_fd < 0) {
+			if (errno == EWOULDBLOCK) {
+				wlr_log(WLR_ERROR, "Instance '%s' is already registered", server->instance_name);
+			}
 			return false;
 		}
-	} else {
-		wlr_log(WLR_INFO, "Unregistered instance '%s' from registry", server->instance_name);
 	}
 
-	free(registry_file);
+	if (!index_update(server->instance_name, getpid(), server->profile_name)) {
+		return false;
+	}
+
+	wlr_log(WLR_INFO, "Registered instance '%s' in registry", server->instance_name);
 	return true;
 }
 
 bool
-registry_is_profile_locked(const char *profile_name)
+registry_unregister_instance(struct cg_server *server)
 {
-	if (!profile_name) {
-		return false; /* No profile means no lock */
-	}
-
-	char *registry_dir = get_registry_dir_path();
-	if (!registry_dir) {
+	if (!server || !server->instance_name) {
+		wlr_log(WLR_ERROR, "Invalid server or instance name");
 		return false;
 	}
 
-	/* Scan registry directory for instances using this profile */
-	DIR *dir = opendir(registry_dir);
-	if (!dir) {
-		if (errno == ENOENT) {
-			/* No registry directory means no locks */
-			free(registry_dir);
-			return false;
-		}
-		wlr_log_errno(WLR_ERROR, "Failed to open registry directory: %s", registry_dir);
-		free(registry_dir);
-		return false;
+	if (profile_lock_fd >= 0) {
+		close(profile_lock_fd);
+		profile_lock_fd = -1;
 	}
 
-	free(registry_dir);
-
-	struct dirent *entry;
-	bool locked = false;
-
-	while ((entry = readdir(dir)) != NULL) {
-		/* Skip . and .. */
-		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-			continue;
-		}
-
-		/* Check if it's a .toml file */
-		size_t len = strlen(entry->d_name);
-		if (len < 6 || strcmp(entry->d_name + len - 5, ".toml") != 0) {
-			continue;
-		}
-
-		/* Build full path */
-		char *registry_dir = get_registry_dir_path();
-		if (!registry_dir) {
-			continue;
-		}
+	if (instance_lock_fd < 0) {
+		wlr_log(WLR_DEBUG, "Instance '%s' is not registered", server->instance_name);
+		return true;
+	}
 
-		char *file_path = malloc(strlen(registry_dir) + strlen(entry->d_name) + 2);
-		if (!file_path) {
-			free(registry_dir);
-			continue;
-		}
+	/* Drop the index line while the lock is still held, so that no
+	 * other instance of the same name can have added its own yet */
+	bool ok = index_update(server->instance_name, 0, NULL);
+	close(instance_lock_fd);
+	instance_lock_fd = -1;
 
-		sprintf(file_path, "%s/%s", registry_dir, entry->d_name);
-		free(registry_dir);
+	if (ok) {
+		wlr_log(WLR_INFO, "Unregistered instance '%s' from registry", server->instance_name);
+	}
+	return ok;
+}
 
-		/* Parse the TOML file using tomlc17 */
-		toml_result_t result = toml_parse_file_ex(file_path);
-		free(file_path);
+bool
+registry_lock_profile(const char *profile_name)
+{
+	if (!profile_name) {
+		return true; /* No profile means no lock */
+	}
 
-		if (!result.ok) {
-			continue;
-		}
+	if (strchr(profile_name, '/')) {
+		wlr_log(WLR_ERROR, "Profile name '%s' can't be locked", profile_name);
+		return false;
+	}
 
-		/* Check if this instance has the profile we're looking for */
-		toml_datum_t profile = toml_get(result.toptab, "profile");
-		if (profile.type == TOML_STRING && profile.u.s) {
-			if (strcmp(profile.u.s, profile_name) == 0) {
-				/* Found an instance using this profile */
-				toml_free(result);
-				locked = true;
-				break;
-			}
-		}
+	if (profile_lock_fd >= 0) {
+		close(profile_lock_fd);
+		profile_lock_fd = -1;
+	}
 
-		toml_free(result);
+	if (!ensure_registry_dir()) {
+		/* Without a registry, profiles can't be shared; don't refuse */
+		return true;
 	}
 
-	closedir(dir);
-	return locked;
+	profile_lock_fd = take_lock(REGISTRY_PROFILES_DIR, profile_name);
+	return profile_lock_fd >= 0 || errno != EWOULDBLOCK;
 }
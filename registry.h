@@ -16,22 +16,24 @@ struct cg_server;
 
 /**
  * Register an instance in the registry
- * Creates a registry file for the instance with its metadata
- * Returns true on success, false on failure
+ * Takes the instance's lock and adds it to the index of running instances
+ * Returns true on success, false on failure, including when another
+ * instance of the same name is running
  */
 bool registry_register_instance(struct cg_server *server);
 
 /**
  * Unregister an instance from the registry
- * Removes the instance's registry file
+ * Removes the instance from the index and releases its locks, including
+ * that of its profile
  * Returns true on success, false on failure
  */
 bool registry_unregister_instance(struct cg_server *server);
 
 /**
- * Check if a profile is already in use by another instance
- * Returns true if the profile is locked (in use), false otherwise
+ * Lock a profile for this instance, until it is unregistered or exits
+ * Returns false if another running instance has the profile locked
  */
-bool registry_is_profile_locked(const char *profile_name);
+bool registry_lock_profile(const char *profile_name);
 
 #endif
@@ -0,0 +1,417 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "resources.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+#define CGROUP_FS "/sys/fs/cgroup"
+
+/* Samples closer together than this keep the previous CPU usage, which
+ * would be too noisy */
+#define MIN_SAMPLE_INTERVAL_NS 500000000ULL
+
+static bool
+read_file(const char *path, char *buf, size_t size)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	ssize_t len = read(fd, buf, size - 1);
+	close(fd);
+	if (len < 0) {
+		return false;
+	}
+	buf[len] = '\0';
+	return true;
+}
+
+static bool
+write_file(const char *dir, const char *name, const char *value)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	size_t len = strlen(value);
+	bool ok = write(fd, value, len) == (ssize_t)len;
+	close(fd);
+	return ok;
+}
+
+/* Whether a space-separated list, such as cgroup.controllers, has word */
+static bool
+has_word(const char *list, const char *word)
+{
+	size_t len = strlen(word);
+	for (const char *p = strstr(list, word); p; p = strstr(p + 1, word)) {
+		if ((p == list || p[-1] == ' ') && (p[len] == '\0' || p[len] == ' ' || p[len] == '\n')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* The cgroup v2 path of a process, e.g. "/user.slice/waymux.service" */
+static bool
+cgroup_of(pid_t pid, char *dest, size_t size)
+{
+	char path[64], buf[4096];
+	snprintf(path, sizeof(path), "/proc/%d/cgroup", (int)pid);
+	if (!read_file(path, buf, sizeof(buf))) {
+		return false;
+	}
+
+	for (char *line = buf; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+		if (strncmp(line, "0::", 3) == 0) {
+			size_t len = strcspn(line + 3, "\n");
+			snprintf(dest, size, "%.*s", (int)len, line + 3);
+			return true;
+		}
+	}
+	return false;
+}
+
+struct cg_resources *
+resources_create(void)
+{
+	struct cg_resources *resources = calloc(1, sizeof(*resources));
+	if (!resources) {
+		wlr_log(WLR_ERROR, "Failed to allocate resources");
+		return NULL;
+	}
+
+	char path[PATH_MAX];
+	if (access(CGROUP_FS "/cgroup.controllers", F_OK) != 0 || !cgroup_of(getpid(), path, sizeof(path))) {
+		wlr_log(WLR_INFO, "No cgroup v2 hierarchy, tabs share WayMux's cgroup");
+		return resources;
+	}
+
+	char root[PATH_MAX];
+	snprintf(root, sizeof(root), "%s%s", CGROUP_FS, strcmp(path, "/") == 0 ? "" : path);
+	char procs[PATH_MAX];
+	snprintf(procs, sizeof(procs), "%s/cgroup.procs", root);
+	if (access(root, W_OK) != 0 || access(procs, W_OK) != 0) {
+		wlr_log(WLR_INFO, "Cgroup %s is not delegated to WayMux, tabs share it", path);
+		return resources;
+	}
+
+	/* Processes may only live in leaves once controllers are enabled for
+	 * the children, so WayMux moves into one of its own */
+	char leaf[PATH_MAX];
+	snprintf(leaf, sizeof(leaf), "%s/compositor", root);
+	if (mkdir(leaf, 0755) != 0 && errno != EEXIST) {
+		wlr_log_errno(WLR_ERROR, "Failed to create cgroup %s", leaf);
+		return resources;
+	}
+	if (!write_file(leaf, "cgroup.procs", "0")) {
+		wlr_log_errno(WLR_ERROR, "Failed to move WayMux into cgroup %s", leaf);
+		rmdir(leaf);
+		return resources;
+	}
+
+	resources->root = strdup(root);
+	if (!resources->root) {
+		return resources;
+	}
+
+	/* Limits need the controllers; without them, the clients' cgroups
+	 * are still accounted for CPU time */
+	char controllers[256];
+	snprintf(path, sizeof(path), "%s/cgroup.controllers", root);
+	if (read_file(path, controllers, sizeof(controllers))) {
+		resources->memory =
+			has_word(controllers, "memory") && write_file(root, "cgroup.subtree_control", "+memory");
+		resources->cpu = has_word(controllers, "cpu") && write_file(root, "cgroup.subtree_control", "+cpu");
+	}
+
+	wlr_log(WLR_INFO, "Tabs get cgroups of their own under %s (memory limits: %s, CPU limits: %s)", root,
+		resources->memory ? "yes" : "no", resources->cpu ? "yes" : "no");
+	return resources;
+}
+
+/* Remove the clients' cgroups whose processes have all exited */
+static void
+remove_empty_cgroups(struct cg_resources *resources)
+{
+	DIR *dir = opendir(resources->root);
+	if (!dir) {
+		return;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "app-", 4) == 0) {
+			char path[PATH_MAX];
+			snprintf(path, sizeof(path), "%s/%s", resources->root, entry->d_name);
+			/* Fails with EBUSY while populated */
+			rmdir(path);
+		}
+	}
+	closedir(dir);
+}
+
+void
+resources_destroy(struct cg_resources *resources)
+{
+	if (!resources) {
+		return;
+	}
+
+	if (resources->root) {
+		remove_empty_cgroups(resources);
+	}
+	free(resources->root);
+	free(resources);
+}
+
+/* Create the cgroup of a client, returning false if it can't be */
+static bool
+create_client_cgroup(struct cg_resources *resources, const struct cg_resource_limits *limits, char *dest,
+		     size_t size)
+{
+	/* Leftovers of an earlier instance with clients still running keep
+	 * their names */
+	for (int attempt = 0; attempt < 16; attempt++) {
+		snprintf(dest, size, "%s/app-%" PRIu32, resources->root, ++resources->next_id);
+		if (mkdir(dest, 0755) == 0) {
+			break;
+		}
+		if (errno != EEXIST || attempt == 15) {
+			wlr_log_errno(WLR_ERROR, "Failed to create cgroup %s", dest);
+			return false;
+		}
+	}
+
+	if (!limits) {
+		return true;
+	}
+
+	char value[64];
+	if (limits->memory_max > 0) {
+		snprintf(value, sizeof(value), "%" PRIu64, limits->memory_max);
+		if (!resources->memory || !write_file(dest, "memory.max", value)) {
+			wlr_log(WLR_ERROR, "Can't limit the memory of %s without the memory controller", dest);
+		}
+	}
+	if (limits->cpu_max > 0) {
+		snprintf(value, sizeof(value), "%d 100000", limits->cpu_max * 1000);
+		if (!resources->cpu || !write_file(dest, "cpu.max", value)) {
+			wlr_log(WLR_ERROR, "Can't limit the CPU usage of %s without the cpu controller", dest);
+		}
+	}
+	return true;
+}
+
+pid_t
+resources_spawn(struct cg_resources *resources, const struct cg_resource_limits *limits, char *const argv[],
+		const struct cg_spawn_env *env, const char *cwd, uint64_t *token)
+{
+	char cgroup[PATH_MAX];
+	if (!resources) {
+		if (token) {
+			*token = 0;
+		}
+		return spawn_command(argv, env, cwd);
+	}
+	if (!resources->root) {
+		return spawn_helper_spawn(resources->helper, argv, env, cwd, NULL, token);
+	}
+
+	remove_empty_cgroups(resources);
+	if (!create_client_cgroup(resources, limits, cgroup, sizeof(cgroup))) {
+		return spawn_helper_spawn(resources->helper, argv, env, cwd, NULL, token);
+	}
+
+	pid_t pid = spawn_helper_spawn(resources->helper, argv, env, cwd, cgroup, token);
+	if (pid < 0) {
+		rmdir(cgroup);
+	}
+	return pid;
+}
+
+bool
+resources_read_cgroup(const char *dir, uint64_t *memory, uint64_t *cpu_usec)
+{
+	char path[PATH_MAX], buf[1024];
+	snprintf(path, sizeof(path), "%s/cpu.stat", dir);
+	if (!read_file(path, buf, sizeof(buf))) {
+		return false;
+	}
+	const char *usage = strstr(buf, "usage_usec ");
+	if (!usage) {
+		return false;
+	}
+	*cpu_usec = strtoull(usage + 11, NULL, 10);
+
+	snprintf(path, sizeof(path), "%s/memory.current", dir);
+	if (read_file(path, buf, sizeof(buf))) {
+		*memory = strtoull(buf, NULL, 10);
+	}
+	return true;
+}
+
+bool
+resources_read_process(pid_t pid, uint64_t *memory, uint64_t *cpu_usec, uint64_t *start_ns)
+{
+	char path[64], buf[1024];
+	snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+	if (!read_file(path, buf, sizeof(buf))) {
+		return false;
+	}
+	unsigned long long size, resident;
+	if (sscanf(buf, "%llu %llu", &size, &resident) != 2) {
+		return false;
+	}
+	*memory = resident * (uint64_t)sysconf(_SC_PAGESIZE);
+
+	/* The command in parentheses may contain anything, so the fields
+	 * are counted from the last ')' on, starting with the state (3) */
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+	if (!read_file(path, buf, sizeof(buf))) {
+		return false;
+	}
+	char *fields = strrchr(buf, ')');
+	if (!fields) {
+		return false;
+	}
+
+	unsigned long long utime = 0, stime = 0, starttime = 0;
+	char *saveptr = NULL;
+	int field = 3;
+	for (char *token = strtok_r(fields + 1, " ", &saveptr); token && field <= 22;
+	     token = strtok_r(NULL, " ", &saveptr), field++) {
+		if (field == 14) {
+			utime = strtoull(token, NULL, 10);
+		} else if (field == 15) {
+			stime = strtoull(token, NULL, 10);
+		} else if (field == 22) {
+			starttime = strtoull(token, NULL, 10);
+		}
+	}
+	if (field <= 22) {
+		return false;
+	}
+
+	uint64_t ticks = (uint64_t)sysconf(_SC_CLK_TCK);
+	*cpu_usec = (utime + stime) * 1000000ULL / ticks;
+	*start_ns = starttime * 1000000000ULL / ticks;
+	return true;
+}
+
+/* Whether a process has a DRM device open, i.e. renders on the GPU */
+static bool
+has_drm_device(pid_t pid)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+	DIR *dir = opendir(path);
+	if (!dir) {
+		return false;
+	}
+
+	bool found = false;
+	struct dirent *entry;
+	while (!found && (entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.') {
+			continue;
+		}
+		char fd_path[128], target[64];
+		snprintf(fd_path, sizeof(fd_path), "%s/%s", path, entry->d_name);
+		ssize_t len = readlink(fd_path, target, sizeof(target) - 1);
+		if (len > 0) {
+			target[len] = '\0';
+			found = strncmp(target, "/dev/dri/", 9) == 0;
+		}
+	}
+	closedir(dir);
+	return found;
+}
+
+/* The cgroup directory of a client, if it's in one of its own */
+static bool
+client_cgroup(struct cg_resources *resources, pid_t pid, char *dest, size_t size)
+{
+	char path[PATH_MAX];
+	if (!resources || !resources->root || !cgroup_of(pid, path, sizeof(path))) {
+		return false;
+	}
+
+	snprintf(dest, size, "%s%s", CGROUP_FS, path);
+	size_t root_len = strlen(resources->root);
+	return strncmp(dest, resources->root, root_len) == 0 && strncmp(dest + root_len, "/app-", 5) == 0;
+}
+
+void
+resources_sample(struct cg_resources *resources, pid_t pid, struct cg_tab_usage *usage)
+{
+	if (pid <= 0) {
+		memset(usage, 0, sizeof(*usage));
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_BOOTTIME, &now);
+	uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+	bool same = usage->pid == pid && usage->sampled_ns > 0;
+	if (same && now_ns - usage->sampled_ns < MIN_SAMPLE_INTERVAL_NS) {
+		return;
+	}
+
+	uint64_t memory, cpu_usec, start_ns;
+	if (!resources_read_process(pid, &memory, &cpu_usec, &start_ns)) {
+		memset(usage, 0, sizeof(*usage));
+		return;
+	}
+
+	char cgroup[PATH_MAX];
+	usage->own_cgroup = client_cgroup(resources, pid, cgroup, sizeof(cgroup)) &&
+		resources_read_cgroup(cgroup, &memory, &cpu_usec);
+
+	uint64_t since_usec = same ? usage->cpu_usec : 0;
+	uint64_t since_ns = same ? usage->sampled_ns : start_ns;
+	if (now_ns > since_ns && cpu_usec >= since_usec) {
+		usage->cpu = (double)(cpu_usec - since_usec) * 1000.0 * 100.0 / (double)(now_ns - since_ns);
+	} else {
+		usage->cpu = 0;
+	}
+
+	usage->pid = pid;
+	usage->memory = memory;
+	usage->gpu = has_drm_device(pid);
+	usage->cpu_usec = cpu_usec;
+	usage->sampled_ns = now_ns;
+}
+
+void
+resources_format_memory(uint64_t bytes, char *dest, size_t size)
+{
+	if (bytes >= 1024ULL * 1024 * 1024) {
+		snprintf(dest, size, "%.1f GB", (double)bytes / (1024.0 * 1024 * 1024));
+	} else if (bytes >= 1024ULL * 1024) {
+		snprintf(dest, size, "%.0f MB", (double)bytes / (1024.0 * 1024));
+	} else {
+		snprintf(dest, size, "%.0f KB", (double)bytes / 1024.0);
+	}
+}
@@ -0,0 +1,101 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_RESOURCES_H
+#define CG_RESOURCES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "spawn_helper.h"
+#include "spawner.h"
+
+/* Limits for the cgroup of each client of a profile; 0 is unlimited */
+struct cg_resource_limits {
+	uint64_t memory_max;  /* Bytes */
+	int cpu_max;          /* Percent of one CPU */
+};
+
+/*
+ * Places every spawned client in a cgroup of its own, so that what it
+ * and its children use can be told apart from the other tabs' and
+ * limited. This needs WayMux's own cgroup to be delegated to it, as
+ * systemd does for units with Delegate=yes: WayMux then moves itself into
+ * a "compositor" child cgroup, since only leaves may hold processes, and
+ * the clients go in "app-N" siblings. Otherwise, clients stay in WayMux's
+ * cgroup and only the usage of their main processes is known.
+ */
+struct cg_resources {
+	char *root;   /* WayMux's cgroup directory, NULL if not delegated */
+	bool memory;  /* Controllers enabled for the clients' cgroups */
+	bool cpu;
+	uint32_t next_id;
+	struct cg_spawn_helper *helper;  /* Starts the clients, if set */
+};
+
+/* What a tab's client uses, as of the last resources_sample() */
+struct cg_tab_usage {
+	pid_t pid;        /* 0 without a client */
+	bool own_cgroup;  /* Accounted by its cgroup, including its children */
+	uint64_t memory;  /* Bytes: the cgroup's memory.current, or the RSS */
+	double cpu;       /* Percent of one CPU since the previous sample */
+	bool gpu;         /* Has a DRM device open */
+
+	/* For the next sample's CPU usage */
+	uint64_t cpu_usec;
+	uint64_t sampled_ns;
+};
+
+/**
+ * Find out whether clients can get cgroups of their own, moving WayMux
+ * into its leaf cgroup if so. Returns NULL only on allocation failure.
+ */
+struct cg_resources *resources_create(void);
+
+/**
+ * Remove the clients' cgroups that are empty. NULL-safe.
+ */
+void resources_destroy(struct cg_resources *resources);
+
+/**
+ * Like spawn_command(), from the spawn helper if there is one, in a new
+ * cgroup with the given limits (which may be NULL) if clients can get
+ * their own. If token is not NULL, it is set to the token of the spawn
+ * helper's exit report for the process, or 0 if there won't be one.
+ */
+pid_t resources_spawn(struct cg_resources *resources, const struct cg_resource_limits *limits, char *const argv[],
+		      const struct cg_spawn_env *env, const char *cwd, uint64_t *token);
+
+/**
+ * Update a usage sample for the given client. CPU usage is averaged since
+ * the previous sample of the same client if it was at least half a second
+ * earlier, or since the client started.
+ */
+void resources_sample(struct cg_resources *resources, pid_t pid, struct cg_tab_usage *usage);
+
+/**
+ * Read memory.current and the usage_usec of cpu.stat from a cgroup
+ * directory. memory is left alone without the memory controller.
+ * Returns false if cpu.stat can't be read.
+ */
+bool resources_read_cgroup(const char *dir, uint64_t *memory, uint64_t *cpu_usec);
+
+/**
+ * Read a process's resident memory and CPU time (user and system), and
+ * when it started (in nanoseconds of CLOCK_BOOTTIME). Returns false if
+ * there is no such process.
+ */
+bool resources_read_process(pid_t pid, uint64_t *memory, uint64_t *cpu_usec, uint64_t *start_ns);
+
+/**
+ * Format a number of bytes for display, e.g. "1.5 GB"
+ */
+void resources_format_memory(uint64_t bytes, char *dest, size_t size);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "result_view.h"
+
+/* Scroll the least amount needed to show the selection */
+static bool
+scroll_to_selection(struct cg_result_view *view)
+{
+	size_t first = view->first;
+
+	if (view->selected < view->first) {
+		view->first = view->selected;
+	} else if (view->rows > 0 && view->selected >= view->first + view->rows) {
+		view->first = view->selected - view->rows + 1;
+	}
+
+	/* Don't leave empty rows at the bottom if results fit above */
+	if (view->total <= view->rows) {
+		view->first = 0;
+	} else if (view->first > view->total - view->rows) {
+		view->first = view->total - view->rows;
+	}
+
+	return view->first != first;
+}
+
+void
+result_view_reset(struct cg_result_view *view, size_t total, size_t rows)
+{
+	view->total = total;
+	view->rows = rows;
+	view->first = 0;
+	view->selected = 0;
+}
+
+bool
+result_view_set_total(struct cg_result_view *view, size_t total)
+{
+	view->total = total;
+	if (view->selected >= total) {
+		view->selected = total > 0 ? total - 1 : 0;
+	}
+	return scroll_to_selection(view);
+}
+
+bool
+result_view_move(struct cg_result_view *view, long delta, bool wrap)
+{
+	if (view->total == 0) {
+		return false;
+	}
+
+	long total = (long)view->total;
+	long selected = (long)view->selected + delta;
+	if (wrap) {
+		selected = ((selected % total) + total) % total;
+	} else if (selected < 0) {
+		selected = 0;
+	} else if (selected >= total) {
+		selected = total - 1;
+	}
+
+	view->selected = (size_t)selected;
+	return scroll_to_selection(view);
+}
+
+size_t
+result_view_visible(const struct cg_result_view *view)
+{
+	if (view->first >= view->total) {
+		return 0;
+	}
+	size_t remaining = view->total - view->first;
+	return remaining < view->rows ? remaining : view->rows;
+}
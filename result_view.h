@@ -0,0 +1,49 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_RESULT_VIEW_H
+#define CG_RESULT_VIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A scrolling window over a ranked result list. Only the rows from first
+ * to first + rows are ever fetched and drawn, so the cost of a list does
+ * not depend on how many results it has.
+ */
+struct cg_result_view {
+	size_t total;     /* Number of results */
+	size_t rows;      /* Number of rows that fit on screen */
+	size_t first;     /* Index of the first visible result */
+	size_t selected;  /* Index of the selected result */
+};
+
+/**
+ * Start a new result list with the selection and scroll at the top.
+ */
+void result_view_reset(struct cg_result_view *view, size_t total, size_t rows);
+
+/**
+ * Change the number of results, keeping the selection if it is still in
+ * range. Returns true if the visible window moved.
+ */
+bool result_view_set_total(struct cg_result_view *view, size_t total);
+
+/**
+ * Move the selection by delta rows, wrapping around the ends if wrap is
+ * set (otherwise clamping). Returns true if the visible window scrolled.
+ */
+bool result_view_move(struct cg_result_view *view, long delta, bool wrap);
+
+/**
+ * Number of rows currently visible (less than rows at the end of a list).
+ */
+size_t result_view_visible(const struct cg_result_view *view);
+
+#endif
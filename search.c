@@ -0,0 +1,106 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "search.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+char *
+search_lowercase(const char *str)
+{
+	char *lower = strdup(str);
+	if (!lower) {
+		return NULL;
+	}
+	for (size_t i = 0; lower[i]; i++) {
+		lower[i] = tolower((unsigned char)lower[i]);
+	}
+	return lower;
+}
+
+/* Map a character to one of 64 mask bits: letters and digits get their own
+ * bit, everything else shares the rest. */
+static uint64_t
+char_bit(unsigned char c)
+{
+	if (c >= 'a' && c <= 'z') {
+		return 1ULL << (c - 'a');
+	}
+	if (c >= '0' && c <= '9') {
+		return 1ULL << (26 + c - '0');
+	}
+	return 1ULL << (36 + c % 28);
+}
+
+uint64_t
+search_mask(const char *str)
+{
+	uint64_t mask = 0;
+	for (const unsigned char *p = (const unsigned char *)str; p && *p; p++) {
+		mask |= char_bit(*p);
+	}
+	return mask;
+}
+
+/* Contiguous runs, matches at word starts and a match at the very start of
+ * the text all score higher; gaps cost a little. */
+int
+search_score(const char *text, const char *query)
+{
+	int score = 0;
+	int run = 0;
+	const char *prev = NULL;
+	const char *t = text;
+
+	for (const char *q = query; *q; q++) {
+		while (*t && *t != *q) {
+			t++;
+		}
+		if (!*t) {
+			return -1;
+		}
+
+		int points = 1;
+		if (t == text) {
+			points += 8;
+		} else if (!isalnum((unsigned char)t[-1])) {
+			points += 6;
+		}
+
+		if (prev && t == prev + 1) {
+			run++;
+			points += 4 * run;
+		} else {
+			run = 0;
+			if (prev) {
+				int gap = (int)(t - prev - 1);
+				points -= gap < 5 ? gap : 5;
+			}
+		}
+
+		score += points;
+		prev = t;
+		t++;
+	}
+
+	/* An exact substring beats any scattered match */
+	const char *sub = strstr(text, query);
+	if (sub == text) {
+		score += 50;
+	} else if (sub && !isalnum((unsigned char)sub[-1])) {
+		score += 30;
+	} else if (sub) {
+		score += 15;
+	}
+
+	return score;
+}
@@ -0,0 +1,39 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_SEARCH_H
+#define CG_SEARCH_H
+
+#include <stdint.h>
+
+/*
+ * The fuzzy matching shared by the launcher and the background dialog.
+ * Text and queries are compared lowercased; callers lowercase what they
+ * search once, and keep it with the mask of its characters to reject most
+ * non-matches without scoring them.
+ */
+
+/**
+ * Lowercase a string into a new allocation (ASCII only). Returns NULL on
+ * allocation failure.
+ */
+char *search_lowercase(const char *str);
+
+/**
+ * The characters present in str, as a mask. A query can only match text
+ * whose mask contains the query's.
+ */
+uint64_t search_mask(const char *str);
+
+/**
+ * Score how well query matches text as an in-order subsequence, or -1 if
+ * it doesn't. Both must be lowercased.
+ */
+int search_score(const char *text, const char *query);
+
+#endif
@@ -23,6 +23,7 @@
 #include <wlr/types/wlr_data_device.h>
 #include <wlr/types/wlr_idle_notify_v1.h>
 #include <wlr/types/wlr_keyboard_group.h>
+#include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_primary_selection.h>
 #include <wlr/types/wlr_relative_pointer_v1.h>
 #include <wlr/types/wlr_scene.h>
@@ -36,15 +37,18 @@
 #include <wlr/xwayland.h>
 #endif
 
+#include "action.h"
 #include "keybinding.h"
 #include "launcher.h"
 #include "background_dialog.h"
+#include "tab_switcher.h"
 #include "profile_selector.h"
 #include "output.h"
 #include "seat.h"
 #include "server.h"
 #include "tab.h"
 #include "tab_bar.h"
+#include "trace.h"
 #include "view.h"
 #include "waymux_config.h"
 #if WAYMUX_HAS_XWAYLAND
@@ -67,8 +71,37 @@ static void drag_icon_update_position(struct cg_drag_icon *drag_icon);
 static struct cg_view *
 desktop_view_at(struct cg_server *server, double lx, double ly, struct wlr_surface **surface, double *sx, double *sy)
 {
-	struct wlr_scene_node *node = wlr_scene_node_at(&server->scene->tree.node, lx, ly, sx, sy);
-	if (node == NULL || node->type != WLR_SCENE_NODE_BUFFER) {
+	struct wlr_scene_node *node = NULL;
+	struct cg_tab *active_tab = output_tab_at(server, lx, ly);
+	struct cg_view *active = active_tab ? active_tab->view : NULL;
+	if (!active || !active->scene_tree || !output_only_tabs_shown(server)) {
+		node = wlr_scene_node_at(&server->scene->tree.node, lx, ly, sx, sy);
+	} else {
+		/* Nothing is over the active tab and the tab bar takes its own
+		 * input, so only the active tab's subtree can be hit. The
+		 * surface that has the pointer is tried first: while its view
+		 * has no popups or subsurfaces, it's the only one there. */
+		struct wlr_surface *focused = server->seat->seat->pointer_state.focused_surface;
+		int vx, vy;
+		if (focused && focused == active->wlr_surface && active->scene_tree->node.enabled &&
+		    wl_list_length(&active->scene_tree->children) == 1 &&
+		    wlr_scene_node_coords(&active->scene_tree->node, &vx, &vy) &&
+		    wlr_surface_point_accepts_input(focused, lx - vx, ly - vy)) {
+			*surface = focused;
+			*sx = lx - vx;
+			*sy = ly - vy;
+			return active;
+		}
+
+		node = wlr_scene_node_at(&active_tab->scene_tree->node, lx, ly, sx, sy);
+	}
+
+	if (node == NULL) {
+		/* A view handed to the parent compositor is hidden from the scene */
+		*surface = output_passthrough_surface_at(server, lx, ly, sx, sy);
+		return *surface ? view_from_wlr_surface(*surface) : NULL;
+	}
+	if (node->type != WLR_SCENE_NODE_BUFFER) {
 		return NULL;
 	}
 
@@ -95,21 +128,68 @@ desktop_view_at(struct cg_server *server, double lx, double ly, struct wlr_surfa
 	return node->data;
 }
 
+/* The tab bar under the given layout coordinates: the server's, or that of
+ * the separate output there */
+static struct cg_tab_bar *
+tab_bar_at(struct cg_server *server, double lx, double ly)
+{
+	if (server->tab_bar) {
+		return server->tab_bar;
+	}
+	struct wlr_output *wlr_output = wlr_output_layout_output_at(server->output_layout, lx, ly);
+	struct cg_output *output = wlr_output ? wlr_output->data : NULL;
+	return output ? output->tab_bar : NULL;
+}
+
+/* Pass pointer motion to every tab bar, so that each drops its highlight
+ * once the pointer leaves it; returns true if one takes the pointer */
+static bool
+tab_bars_handle_motion(struct cg_server *server, double lx, double ly)
+{
+	if (server->tab_bar) {
+		return tab_bar_handle_motion(server->tab_bar, lx, ly);
+	}
+
+	bool handled = false;
+	struct cg_output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (output->tab_bar && tab_bar_handle_motion(output->tab_bar, lx, ly)) {
+			handled = true;
+		}
+	}
+	return handled;
+}
+
+/* Drop a tab dragged on any tab bar, wherever the button is released */
+static void
+tab_bars_handle_release(struct cg_server *server, uint32_t button)
+{
+	if (server->tab_bar) {
+		tab_bar_handle_release(server->tab_bar, button);
+	}
+	struct cg_output *output;
+	wl_list_for_each (output, &server->outputs, link) {
+		if (output->tab_bar) {
+			tab_bar_handle_release(output->tab_bar, button);
+		}
+	}
+}
+
 static void
 press_cursor_button(struct cg_seat *seat, struct wlr_input_device *device, uint32_t time, uint32_t button,
 		    uint32_t state, double lx, double ly)
 {
 	struct cg_server *server = seat->server;
 
-	if (state == WLR_BUTTON_PRESSED) {
-		/* Check if click is on tab bar first (tab bar is at top: y=0 to y=height) */
-		if (server->tab_bar && server->tab_bar->scene_tree->node.enabled) {
-			/* Tab bar is at the top of the layout */
-			if (ly >= 0 && ly < server->tab_bar->height) {
-				if (tab_bar_handle_click(server->tab_bar, lx, ly, button)) {
-					return;
-				}
-			}
+	if (state == WLR_BUTTON_RELEASED) {
+		/* Drop a tab dragged on the tab bar */
+		tab_bars_handle_release(server, button);
+	} else if (state == WLR_BUTTON_PRESSED) {
+		/* Check if click is on tab bar first (tab bar is at top of the
+		 * layout, or of its output) */
+		struct cg_tab_bar *tab_bar = tab_bar_at(server, lx, ly);
+		if (tab_bar && tab_bar_handle_click(tab_bar, lx, ly, button)) {
+			return;
 		}
 
 		double sx, sy;
@@ -124,6 +204,11 @@ press_cursor_button(struct cg_seat *seat, struct wlr_input_device *device, uint3
 		   it has no open dialogs. */
 		if (view && !view_is_transient_for(current, view)) {
 			seat_set_focus(seat, view);
+
+			/* A tab shown on another output takes the focus */
+			if (view->tab && view->tab != server->active_tab) {
+				tab_activate(view->tab);
+			}
 		}
 	}
 }
@@ -272,6 +357,9 @@ handle_modifier_event(struct wlr_keyboard *keyboard, struct cg_seat *seat)
 	wlr_seat_set_keyboard(seat->seat, keyboard);
 	wlr_seat_keyboard_notify_modifiers(seat->seat, &keyboard->modifiers);
 
+	/* Releasing the switcher's modifiers activates its selection */
+	tab_switcher_handle_modifiers(seat->server->tab_switcher, wlr_keyboard_get_modifiers(keyboard));
+
 	wlr_idle_notifier_v1_notify_activity(seat->server->idle, seat->seat);
 }
 
@@ -300,100 +388,15 @@ handle_keybinding(struct cg_server *server, xkb_keysym_t sym)
 static bool
 handle_tab_keybinding(struct cg_server *server, xkb_keysym_t sym, uint32_t modifiers)
 {
-	struct waymux_config *config = server->config;
-
-	/* Check show_background_dialog keybinding */
-	if (config->show_background_dialog &&
-	    keybinding_match(config->show_background_dialog, modifiers, sym)) {
-		background_dialog_toggle(server->background_dialog);
-		return true;
-	}
-
-	/* Check toggle_background keybinding */
-	if (config->toggle_background &&
-	    keybinding_match(config->toggle_background, modifiers, sym)) {
-		if (server->active_tab) {
-			struct cg_tab *current = server->active_tab;
-			bool new_background = !current->is_background;
-			tab_set_background(current, new_background);
-
-			/* If tab became background, switch to next non-background tab */
-			if (new_background) {
-				struct cg_tab *next_tab = tab_next(current);
-				if (next_tab && next_tab != current) {
-					tab_activate(next_tab);
-				}
-			} else {
-				/* Tab became foreground, activate it */
-				tab_activate(current);
-			}
-			return true;
-		}
-	}
-
-	/* Check prev_tab keybinding */
-	if (config->prev_tab && keybinding_match(config->prev_tab, modifiers, sym)) {
-		if (server->active_tab) {
-			struct cg_tab *prev_tab = tab_prev(server->active_tab);
-			if (prev_tab) {
-				tab_activate(prev_tab);
-				return true;
-			}
-		}
-	}
-
-	/* Check next_tab keybinding */
-	if (config->next_tab && keybinding_match(config->next_tab, modifiers, sym)) {
-		if (server->active_tab) {
-			struct cg_tab *next_tab = tab_next(server->active_tab);
-			if (next_tab) {
-				tab_activate(next_tab);
-				return true;
-			}
-		}
-	}
-
-	/* Check close_tab keybinding */
-	if (config->close_tab && keybinding_match(config->close_tab, modifiers, sym)) {
-		if (server->active_tab) {
-			struct cg_tab *current = server->active_tab;
-			struct cg_tab *next_tab = tab_next(current);
-
-			/* Destroy current tab */
-			tab_destroy(current);
-
-			/* Activate next tab if exists */
-			if (next_tab && next_tab != current) {
-				tab_activate(next_tab);
-			} else if (tab_count(server) > 0) {
-				/* If next_tab was the same as current (only one tab),
-				 * get the first available tab */
-				struct cg_tab *first_tab =
-					wl_container_of(server->tabs.next, first_tab, link);
-				if (first_tab) {
-					tab_activate(first_tab);
-				}
-			}
-			/* If no tabs remain, the application launcher should be shown
-			 * (to be implemented in Phase 3) */
-
-			return true;
-		}
-	}
-
-	/* Check open_launcher keybinding */
-	if (config->open_launcher &&
-	    keybinding_match(config->open_launcher, modifiers, sym)) {
-		launcher_toggle(server->launcher);
-		return true;
-	}
-
-	return false;
+	const struct action *action = keybinding_table_lookup(&server->config->bindings, modifiers, sym);
+	return action && action_run(server, action);
 }
 
 static void
 handle_key_event(struct wlr_keyboard *keyboard, struct cg_seat *seat, void *data)
 {
+	TRACE_SCOPE("handle_key_event");
+
 	struct wlr_keyboard_key_event *event = data;
 
 	/* Translate from libinput keycode to an xkbcommon keycode. */
@@ -406,8 +409,13 @@ handle_key_event(struct wlr_keyboard *keyboard, struct cg_seat *seat, void *data
 	uint32_t modifiers = wlr_keyboard_get_modifiers(keyboard);
 
 	if (event->state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+		/* While the tab switcher is held open, Escape and Return go to it */
+		for (int i = 0; i < nsyms && !handled; i++) {
+			handled = tab_switcher_handle_key(seat->server->tab_switcher, syms[i]);
+		}
+
 		/* If profile selector is visible, forward keys to it first */
-		if (seat->server->profile_selector && seat->server->profile_selector->is_visible) {
+		if (!handled && seat->server->profile_selector && seat->server->profile_selector->is_visible) {
 			for (int i = 0; i < nsyms; i++) {
 				if (profile_selector_handle_key(seat->server->profile_selector, syms[i], event->keycode)) {
 					handled = true;
@@ -756,6 +764,13 @@ handle_cursor_axis(struct wl_listener *listener, void *data)
 	struct cg_seat *seat = wl_container_of(listener, seat, cursor_axis);
 	struct wlr_pointer_axis_event *event = data;
 
+	/* Scrolling over the tab bar scrolls its tabs */
+	struct cg_tab_bar *tab_bar = tab_bar_at(seat->server, seat->cursor->x, seat->cursor->y);
+	if (tab_bar && tab_bar_handle_scroll(tab_bar, seat->cursor->x, seat->cursor->y, event->delta)) {
+		wlr_idle_notifier_v1_notify_activity(seat->server->idle, seat->seat);
+		return;
+	}
+
 	wlr_seat_pointer_notify_axis(seat->seat, event->time_msec, event->orientation, event->delta,
 				     event->delta_discrete, event->source, event->relative_direction);
 	wlr_idle_notifier_v1_notify_activity(seat->server->idle, seat->seat);
@@ -777,22 +792,21 @@ static void
 process_cursor_motion(struct cg_seat *seat, uint32_t time_msec, double dx, double dy, double dx_unaccel,
 		      double dy_unaccel)
 {
+	TRACE_SCOPE("process_cursor_motion");
+
 	double sx, sy;
 	struct wlr_seat *wlr_seat = seat->seat;
 	struct wlr_surface *surface = NULL;
 
-	/* Check if cursor is over the tab bar */
+	/* Check if cursor is over the tab bar, or dragging one of its tabs */
 	struct cg_server *server = seat->server;
-	if (server->tab_bar && server->tab_bar->scene_tree->node.enabled) {
-		/* Tab bar is at the top (y=0 to y=height) */
-		if (seat->cursor->y >= 0 && seat->cursor->y < server->tab_bar->height) {
-			/* Clear focus from any surface when over tab bar */
-			wlr_seat_pointer_clear_focus(wlr_seat);
-			/* Set pointer cursor */
-			wlr_cursor_set_xcursor(seat->cursor, seat->xcursor_manager, "pointer");
-			wlr_idle_notifier_v1_notify_activity(server->idle, wlr_seat);
-			return;
-		}
+	if (tab_bars_handle_motion(server, seat->cursor->x, seat->cursor->y)) {
+		/* Clear focus from any surface when over tab bar */
+		wlr_seat_pointer_clear_focus(wlr_seat);
+		/* Set pointer cursor */
+		wlr_cursor_set_xcursor(seat->cursor, seat->xcursor_manager, "pointer");
+		wlr_idle_notifier_v1_notify_activity(server->idle, wlr_seat);
+		return;
 	}
 
 	struct cg_view *view = desktop_view_at(seat->server, seat->cursor->x, seat->cursor->y, &surface, &sx, &sy);
@@ -1127,12 +1141,14 @@ seat_set_focus(struct cg_seat *seat, struct cg_view *view)
 	}
 
 	view_activate(view, true);
-	char *title = view_get_title(view);
+	const char *title = view_get_title(view);
 	struct cg_output *output;
 	wl_list_for_each (output, &server->outputs, link) {
-		output_set_window_title(output, title);
+		/* Separate outputs show the title of their own tab */
+		if (!view->tab || !view->tab->output || view->tab->output == output) {
+			output_set_window_title(output, title);
+		}
 	}
-	free(title);
 
 	struct wlr_keyboard *keyboard = wlr_seat_get_keyboard(wlr_seat);
 	if (keyboard) {
@@ -4,6 +4,8 @@
 #include "config.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/config.h>
 #include <wlr/types/wlr_drm_lease_v1.h>
@@ -24,11 +26,24 @@ struct cg_desktop_entry_manager;
 struct cg_tab_bar;
 struct cg_background_dialog;
 struct cg_profile_selector;
+struct cg_tab_switcher;
+struct cg_stats_hud;
 struct waymux_config;
+struct cg_visibility;
+struct cg_config_watch;
+struct cg_xwayland;
+struct cg_resources;
+struct cg_spawn_helper;
+struct cg_memory_policy;
+
+/* Number of buckets of the tab ID table */
+#define TAB_ID_BUCKETS 64
 
 enum cg_multi_output_mode {
 	WAYMUX_MULTI_OUTPUT_MODE_EXTEND,
 	WAYMUX_MULTI_OUTPUT_MODE_LAST,
+	/* Each output shows tabs of its own, under a tab bar of its own */
+	WAYMUX_MULTI_OUTPUT_MODE_SEPARATE,
 };
 
 struct cg_server {
@@ -52,28 +67,77 @@ struct cg_server {
 	struct wlr_scene_output_layout *scene_output_layout;
 
 	struct wlr_scene *scene;
+	/* Parent of the tabs' scene trees, below the tab bar and overlays */
+	struct wlr_scene_tree *tabs_tree;
 
 	/* Tab management */
 	struct wl_list tabs; // cg_tab::link
+	struct wl_list tab_ids[TAB_ID_BUCKETS]; // cg_tab::id_link, by id % TAB_ID_BUCKETS
+	int tab_count;
+	uint32_t last_tab_id;
+	/* The tab with the focus; with separate outputs, the focused
+	 * output's active tab, the others showing their own */
 	struct cg_tab *active_tab;
-	int pending_background_tabs; /* Number of profile tabs that should start as background */
+	struct wl_list tabs_mru; // cg_tab::mru_link, most recently active first
+	struct timespec tab_switch_started; // Traced on the next frame, zero if none
+
+	/* The tabs list as arrays, of all tabs and of the foreground ones,
+	 * for jumping to a tab by position. Rebuilt on first use after tabs
+	 * are added, removed, moved or sent to and from the background. */
+	struct cg_tab **tab_order;
+	struct cg_tab **foreground_tabs;
+	int foreground_tab_count;
+	int tab_order_capacity;
+	bool tab_order_dirty;
+	struct wl_list profile_launches; // cg_profile_launch::link
+	struct wl_list profile_lazy_tabs; // cg_profile_lazy_tab::link
+	struct wl_listener spawn_exit; // Profile tabs that failed to start
 
 	/* Application launcher */
 	struct cg_launcher *launcher;
 	struct cg_desktop_entry_manager *desktop_entries;
 
+	/* Suspends and stops hidden tabs' clients */
+	struct cg_visibility *visibility;
+
+	/* Puts clients in cgroups of their own and samples their usage */
+	struct cg_resources *resources;
+
+	/* Process that starts the clients, forked at startup */
+	struct cg_spawn_helper *spawn_helper;
+
+	/* Gives back memory held for hidden overlays */
+	struct cg_memory_policy *memory;
+
 	/* Background tabs dialog */
 	struct cg_background_dialog *background_dialog;
 
 	/* Profile selector */
 	struct cg_profile_selector *profile_selector;
 
-	/* Tab bar UI */
+	/* Alt-Tab style tab switcher */
+	struct cg_tab_switcher *tab_switcher;
+
+	/* Performance counters overlay, NULL without stats */
+	struct cg_stats_hud *stats_hud;
+
+	/* Tab bar UI; NULL with separate outputs, which have their own */
 	struct cg_tab_bar *tab_bar;
 
 	/* Control server */
 	struct cg_control_server *control;
 
+	/* Tab events, emitted with the cg_tab as data while it is still in
+	 * the tabs list */
+	struct {
+		struct wl_signal tab_map;
+		struct wl_signal tab_unmap;
+		struct wl_signal tab_activate;
+		struct wl_signal tab_title;
+		struct wl_signal tab_background;
+		struct wl_signal tab_move;
+	} events;
+
 	/* Includes disabled outputs; depending on the output_mode
 	 * some outputs may be disabled. */
 	struct wl_list outputs; // cg_output::link
@@ -87,6 +151,7 @@ struct cg_server {
 	struct wl_listener new_virtual_keyboard;
 	struct wl_listener new_virtual_pointer;
 #if WAYMUX_HAS_XWAYLAND
+	struct cg_xwayland *xwayland;
 	struct wl_listener new_xwayland_surface;
 #endif
 	struct wlr_output_manager_v1 *output_manager_v1;
@@ -111,6 +176,7 @@ struct cg_server {
 	enum wlr_log_importance log_level;
 	struct waymux_config *config; /* Keybindings configuration */
 	char *config_path; /* Custom config file path from -c flag */
+	struct cg_config_watch *config_watch; /* Reloads the config on change */
 	char *instance_name; /* Instance name for multi-instance support */
 	char *profile_name; /* Profile name (if loaded from profile) */
 };
@@ -0,0 +1,443 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "session.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/util/log.h>
+
+#include "profile.h"
+#include "profile_launch.h"
+#include "server.h"
+#include "tab.h"
+#include "view.h"
+
+/* Read a whole file from /proc, whose size isn't known beforehand */
+static char *
+read_proc_file(const char *path, size_t *len_out)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	size_t size = 4096, len = 0;
+	char *buf = malloc(size);
+	while (buf) {
+		ssize_t n = read(fd, buf + len, size - len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		len += n;
+		if (len == size) {
+			char *grown = realloc(buf, size * 2);
+			if (!grown) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = grown;
+			size *= 2;
+		}
+	}
+	close(fd);
+
+	*len_out = len;
+	return buf;
+}
+
+bool
+session_read_process(pid_t pid, struct cg_session_tab *tab)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/cmdline", (int)pid);
+	size_t len;
+	char *cmdline = read_proc_file(path, &len);
+	if (!cmdline || len == 0) {
+		free(cmdline);
+		return false;
+	}
+
+	/* Arguments are NUL-terminated, the last one possibly not */
+	size_t argc = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (cmdline[i] == '\0' || i == len - 1) {
+			argc++;
+		}
+	}
+	tab->argv = calloc(argc + 1, sizeof(char *));
+	if (!tab->argv) {
+		free(cmdline);
+		return false;
+	}
+	size_t start = 0;
+	for (size_t i = 0, arg = 0; i < len && arg < argc; i++) {
+		if (cmdline[i] == '\0' || i == len - 1) {
+			size_t end = cmdline[i] == '\0' ? i : i + 1;
+			tab->argv[arg] = strndup(cmdline + start, end - start);
+			if (!tab->argv[arg++]) {
+				free(cmdline);
+				session_tab_finish(tab);
+				return false;
+			}
+			start = i + 1;
+		}
+	}
+	free(cmdline);
+
+	char cwd[PATH_MAX];
+	snprintf(path, sizeof(path), "/proc/%d/cwd", (int)pid);
+	ssize_t cwd_len = readlink(path, cwd, sizeof(cwd) - 1);
+	if (cwd_len > 0) {
+		cwd[cwd_len] = '\0';
+		tab->working_dir = strdup(cwd);
+	}
+	return true;
+}
+
+void
+session_tab_finish(struct cg_session_tab *tab)
+{
+	if (tab->argv) {
+		for (char **arg = tab->argv; *arg; arg++) {
+			free(*arg);
+		}
+		free(tab->argv);
+	}
+	free(tab->working_dir);
+	free(tab->title);
+	memset(tab, 0, sizeof(*tab));
+}
+
+/* The length of the UTF-8 sequence at p, or 0 if it isn't a valid one */
+static size_t
+utf8_sequence_len(const unsigned char *p)
+{
+	if (p[0] < 0x80) {
+		return 1;
+	}
+
+	size_t len;
+	unsigned char min = 0x80, max = 0xbf;
+	if (p[0] >= 0xc2 && p[0] <= 0xdf) {
+		len = 2;
+	} else if (p[0] >= 0xe0 && p[0] <= 0xef) {
+		len = 3;
+		/* No overlong forms, nor UTF-16 surrogates */
+		if (p[0] == 0xe0) {
+			min = 0xa0;
+		} else if (p[0] == 0xed) {
+			max = 0x9f;
+		}
+	} else if (p[0] >= 0xf0 && p[0] <= 0xf4) {
+		len = 4;
+		/* No overlong forms, nor code points past U+10FFFF */
+		if (p[0] == 0xf0) {
+			min = 0x90;
+		} else if (p[0] == 0xf4) {
+			max = 0x8f;
+		}
+	} else {
+		return 0;
+	}
+
+	if (p[1] < min || p[1] > max) {
+		return 0;
+	}
+	for (size_t i = 2; i < len; i++) {
+		if (p[i] < 0x80 || p[i] > 0xbf) {
+			return 0;
+		}
+	}
+	return len;
+}
+
+static bool
+utf8_valid(const char *s)
+{
+	for (const unsigned char *p = (const unsigned char *)s; *p;) {
+		size_t len = utf8_sequence_len(p);
+		if (len == 0) {
+			return false;
+		}
+		p += len;
+	}
+	return true;
+}
+
+/* Write s as a TOML basic string. Invalid UTF-8, which would make the
+ * whole file fail to load, is replaced with U+FFFD. */
+static void
+write_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+		switch (*p) {
+		case '"':
+			fputs("\\\"", f);
+			break;
+		case '\\':
+			fputs("\\\\", f);
+			break;
+		case '\n':
+			fputs("\\n", f);
+			break;
+		case '\t':
+			fputs("\\t", f);
+			break;
+		case '\r':
+			fputs("\\r", f);
+			break;
+		default:
+			if (*p < 0x20 || *p == 0x7f) {
+				fprintf(f, "\\u%04x", *p);
+			} else if (*p >= 0x80) {
+				size_t len = utf8_sequence_len(p);
+				if (len == 0) {
+					fputs("\\ufffd", f);
+				} else {
+					fwrite(p, 1, len, f);
+					p += len - 1;
+				}
+			} else {
+				fputc(*p, f);
+			}
+		}
+	}
+	fputc('"', f);
+}
+
+bool
+session_write(FILE *f, const struct cg_session_tab *tabs, size_t count)
+{
+	fputs("# Saved by waymuxctl save-session\n", f);
+	for (size_t i = 0; i < count; i++) {
+		const struct cg_session_tab *tab = &tabs[i];
+		fputs("\n[[tabs]]\ncommand = ", f);
+		write_string(f, tab->argv[0]);
+		fputc('\n', f);
+
+		if (tab->argv[1]) {
+			fputs("args = [", f);
+			for (char **arg = tab->argv + 1; *arg; arg++) {
+				if (arg > tab->argv + 1) {
+					fputs(", ", f);
+				}
+				write_string(f, *arg);
+			}
+			fputs("]\n", f);
+		}
+		if (tab->working_dir) {
+			fputs("working_dir = ", f);
+			write_string(f, tab->working_dir);
+			fputc('\n', f);
+		}
+		if (tab->title) {
+			fputs("title = ", f);
+			write_string(f, tab->title);
+			fputc('\n', f);
+		}
+		/* Lazy tabs are background tabs unless told otherwise */
+		fprintf(f, "background = %s\n", tab->background ? "true" : "false");
+		if (tab->lazy) {
+			fputs("lazy = true\n", f);
+		}
+	}
+	return !ferror(f);
+}
+
+char *
+session_path(const char *name)
+{
+	if (!name || name[0] == '\0') {
+		name = "session";
+	}
+	if (strchr(name, '/')) {
+		return strdup(name);
+	}
+
+	char *dir = profile_dir();
+	if (!dir) {
+		return NULL;
+	}
+	size_t len = strlen(dir) + strlen(name) + 7;
+	char *path = malloc(len);
+	if (path) {
+		snprintf(path, len, "%s/%s.toml", dir, name);
+	}
+	free(dir);
+	return path;
+}
+
+/* The lazy tab a placeholder stands for, if it is one */
+static struct cg_profile_lazy_tab *
+find_lazy_tab(struct cg_server *server, struct cg_tab *tab)
+{
+	struct cg_profile_lazy_tab *lazy;
+	wl_list_for_each(lazy, &server->profile_lazy_tabs, link) {
+		if (lazy->tab == tab) {
+			return lazy;
+		}
+	}
+	return NULL;
+}
+
+static bool
+pid_seen(const pid_t *pids, size_t count, pid_t pid)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (pids[i] == pid) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Fill in a session tab from a tab; returns false to leave it out */
+static bool
+session_tab_from(struct cg_server *server, struct cg_tab *tab, pid_t *pids, size_t *pid_count,
+		 struct cg_session_tab *out)
+{
+	const char *title;
+	if (tab->view) {
+		pid_t pid = view_get_pid(tab->view);
+		if (pid <= 0 || pid == getpid() || pid_seen(pids, *pid_count, pid)) {
+			return false;
+		}
+		pids[(*pid_count)++] = pid;
+		if (!session_read_process(pid, out)) {
+			wlr_log(WLR_ERROR, "Can't read the command line of tab %u's client %d", tab->id, (int)pid);
+			return false;
+		}
+		title = view_get_title(tab->view);
+	} else {
+		/* A placeholder whose client hasn't mapped yet */
+		struct cg_profile_lazy_tab *lazy = find_lazy_tab(server, tab);
+		if (!lazy) {
+			return false;
+		}
+		size_t argc = 0;
+		while (lazy->argv[argc]) {
+			argc++;
+		}
+		out->argv = calloc(argc + 1, sizeof(char *));
+		for (size_t i = 0; out->argv && i < argc; i++) {
+			out->argv[i] = strdup(lazy->argv[i]);
+			if (!out->argv[i]) {
+				session_tab_finish(out);
+				return false;
+			}
+		}
+		out->working_dir = lazy->working_dir ? strdup(lazy->working_dir) : NULL;
+		if (!out->argv || (lazy->working_dir && !out->working_dir)) {
+			session_tab_finish(out);
+			return false;
+		}
+		title = tab->title;
+	}
+
+	/* The command couldn't be saved as it is, and would be started with
+	 * different arguments */
+	bool valid = !out->working_dir || utf8_valid(out->working_dir);
+	for (char **arg = out->argv; valid && *arg; arg++) {
+		valid = utf8_valid(*arg);
+	}
+	if (!valid) {
+		wlr_log(WLR_ERROR, "Leaving out tab %u, its command line or working directory isn't valid UTF-8",
+			tab->id);
+		session_tab_finish(out);
+		return false;
+	}
+
+	out->title = title ? strdup(title) : NULL;
+	out->background = tab->is_background;
+	out->lazy = tab != server->active_tab;
+	return true;
+}
+
+int
+session_save(struct cg_server *server, const char *path)
+{
+	size_t capacity = wl_list_length(&server->tabs);
+	struct cg_session_tab *tabs = calloc(capacity > 0 ? capacity : 1, sizeof(*tabs));
+	pid_t *pids = calloc(capacity > 0 ? capacity : 1, sizeof(*pids));
+	if (!tabs || !pids) {
+		wlr_log(WLR_ERROR, "Failed to allocate session");
+		free(tabs);
+		free(pids);
+		return -1;
+	}
+
+	size_t count = 0, pid_count = 0;
+	bool has_eager = false;
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (session_tab_from(server, tab, pids, &pid_count, &tabs[count])) {
+			has_eager |= !tabs[count].lazy;
+			count++;
+		}
+	}
+	free(pids);
+
+	/* Something must start with the session, even if the active tab
+	 * was left out */
+	for (size_t i = 0; !has_eager && i < count; i++) {
+		if (!tabs[i].background) {
+			tabs[i].lazy = false;
+			has_eager = true;
+		}
+	}
+
+	char tmp_path[PATH_MAX];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid());
+	char *slash = strrchr(tmp_path, '/');
+	if (slash && slash != tmp_path) {
+		/* Create the profiles directory, and its parents */
+		*slash = '\0';
+		for (char *p = tmp_path + 1; *p; p++) {
+			if (*p == '/') {
+				*p = '\0';
+				mkdir(tmp_path, 0755);
+				*p = '/';
+			}
+		}
+		mkdir(tmp_path, 0755);
+		*slash = '/';
+	}
+
+	FILE *f = fopen(tmp_path, "w");
+	bool ok = f && session_write(f, tabs, count);
+	if (f && fclose(f) != 0) {
+		ok = false;
+	}
+	for (size_t i = 0; i < count; i++) {
+		session_tab_finish(&tabs[i]);
+	}
+	free(tabs);
+
+	if (!ok || rename(tmp_path, path) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to save the session to %s", path);
+		unlink(tmp_path);
+		return -1;
+	}
+
+	wlr_log(WLR_INFO, "Saved %zu tabs to %s", count, path);
+	return (int)count;
+}
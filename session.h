@@ -0,0 +1,65 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_SESSION_H
+#define CG_SESSION_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+struct cg_server;
+
+/*
+ * Saves the open tabs as a profile (see waymux-profile(5)), so that a
+ * later WayMux can restore them by loading it. Each tab's command line and
+ * working directory are those of its client, read from /proc. Only the
+ * active tab is started eagerly on restore; the others are lazy, and
+ * start once shown. Clients with several tabs are saved once, for their
+ * first tab, as they usually restore their other windows themselves.
+ */
+
+/* One tab of a saved session */
+struct cg_session_tab {
+	char **argv;        /* NULL-terminated */
+	char *working_dir;  /* NULL if unknown */
+	char *title;        /* NULL if unknown */
+	bool background;
+	bool lazy;
+};
+
+/**
+ * Read the command line and working directory of a process into tab.
+ * Returns false if the process is gone or its command line unreadable.
+ */
+bool session_read_process(pid_t pid, struct cg_session_tab *tab);
+
+/**
+ * Free what a session tab holds.
+ */
+void session_tab_finish(struct cg_session_tab *tab);
+
+/**
+ * Write tabs as a profile. Returns false on a write error.
+ */
+bool session_write(FILE *f, const struct cg_session_tab *tabs, size_t count);
+
+/**
+ * The file to save a session named name to: name itself if it contains a
+ * slash, otherwise name.toml in the profiles directory. name defaults to
+ * "session". Returns an allocated path, or NULL.
+ */
+char *session_path(const char *name);
+
+/**
+ * Save the server's tabs to path, replacing it atomically. Returns the
+ * number of tabs saved, or -1 on error.
+ */
+int session_save(struct cg_server *server, const char *path);
+
+#endif
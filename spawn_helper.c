@@ -0,0 +1,421 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "spawn_helper.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+/* A helper that doesn't answer within this long is taken to be stuck */
+#define REPLY_TIMEOUT_MS 5000
+
+/* Followed by the NUL-terminated argv, environment, working directory
+ * and cgroup, the latter two only if present */
+struct helper_request {
+	uint64_t token;
+	uint32_t argc;
+	uint32_t envc;
+	uint8_t has_cwd;
+	uint8_t has_cgroup;
+};
+
+struct helper_reply {
+	uint64_t token;
+	int32_t pid;    /* -1 if the command couldn't be started */
+	int32_t error;  /* errno then */
+};
+
+/* The helper's side */
+
+struct helper_child {
+	pid_t pid;
+	uint64_t token;
+};
+
+struct helper_state {
+	int request_fd;
+	int exit_fd;
+	struct helper_child *children;
+	size_t count;
+	size_t capacity;
+};
+
+static void
+helper_add_child(struct helper_state *state, pid_t pid, uint64_t token)
+{
+	if (state->count == state->capacity) {
+		size_t capacity = state->capacity ? state->capacity * 2 : 16;
+		struct helper_child *children = realloc(state->children, capacity * sizeof(*children));
+		if (!children) {
+			/* Still reaped, reported without its token */
+			return;
+		}
+		state->children = children;
+		state->capacity = capacity;
+	}
+	state->children[state->count++] = (struct helper_child){.pid = pid, .token = token};
+}
+
+static void
+helper_reap(struct helper_state *state)
+{
+	int status;
+	pid_t pid;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		struct cg_spawn_exit report = {.pid = pid, .status = status};
+		for (size_t i = 0; i < state->count; i++) {
+			if (state->children[i].pid == pid) {
+				report.token = state->children[i].token;
+				state->children[i] = state->children[--state->count];
+				break;
+			}
+		}
+		send(state->exit_fd, &report, sizeof(report), MSG_NOSIGNAL);
+	}
+}
+
+/* The next string of a request, or NULL if it runs past the end */
+static char *
+next_string(char **pos, char *end)
+{
+	char *str = *pos;
+	char *nul = memchr(str, '\0', end - str);
+	if (!nul) {
+		return NULL;
+	}
+	*pos = nul + 1;
+	return str;
+}
+
+static bool
+helper_spawn(struct helper_state *state, char *buf, size_t len, struct helper_reply *reply)
+{
+	struct helper_request request;
+	if (len < sizeof(request)) {
+		return false;
+	}
+	memcpy(&request, buf, sizeof(request));
+	reply->token = request.token;
+	reply->pid = -1;
+	reply->error = EINVAL;
+
+	char **argv = calloc(request.argc + 1, sizeof(*argv));
+	char **vars = calloc(request.envc + 1, sizeof(*vars));
+	char *pos = buf + sizeof(request), *end = buf + len;
+	bool valid = argv && vars && request.argc > 0;
+	for (uint32_t i = 0; valid && i < request.argc; i++) {
+		valid = (argv[i] = next_string(&pos, end)) != NULL;
+	}
+	for (uint32_t i = 0; valid && i < request.envc; i++) {
+		valid = (vars[i] = next_string(&pos, end)) != NULL;
+	}
+	const char *cwd = NULL, *cgroup = NULL;
+	if (valid && request.has_cwd) {
+		valid = (cwd = next_string(&pos, end)) != NULL;
+	}
+	if (valid && request.has_cgroup) {
+		valid = (cgroup = next_string(&pos, end)) != NULL;
+	}
+
+	if (valid) {
+		struct cg_spawn_env env = {.vars = vars, .count = request.envc, .capacity = request.envc + 1};
+		pid_t pid = cgroup ? spawn_command_in_cgroup(argv, &env, cwd, cgroup) : spawn_command(argv, &env, cwd);
+		reply->pid = pid;
+		reply->error = pid < 0 ? errno : 0;
+		if (pid > 0) {
+			helper_add_child(state, pid, request.token);
+		}
+	}
+
+	free(argv);
+	free(vars);
+	return true;
+}
+
+/* Answer a request. Returns false once the compositor is gone. */
+static bool
+helper_handle_request(struct helper_state *state)
+{
+	ssize_t len = recv(state->request_fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+	if (len <= 0) {
+		return len < 0 && errno == EINTR;
+	}
+
+	char *buf = malloc(len);
+	if (!buf) {
+		/* Dropped; the compositor times out */
+		recv(state->request_fd, NULL, 0, 0);
+		return true;
+	}
+	len = recv(state->request_fd, buf, len, 0);
+
+	struct helper_reply reply;
+	if (len > 0 && helper_spawn(state, buf, len, &reply)) {
+		send(state->request_fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+	}
+	free(buf);
+	return len > 0;
+}
+
+static void
+helper_run(int request_fd, int exit_fd)
+{
+	/* Interrupting the compositor's terminal is the compositor's to
+	 * handle; it closes the socket once it exits */
+	signal(SIGINT, SIG_IGN);
+	signal(SIGPIPE, SIG_IGN);
+
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+	if (signal_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Spawn helper can't watch its children");
+		_exit(1);
+	}
+
+	struct helper_state state = {.request_fd = request_fd, .exit_fd = exit_fd};
+	struct pollfd fds[2] = {
+		{.fd = request_fd, .events = POLLIN},
+		{.fd = signal_fd, .events = POLLIN},
+	};
+	for (;;) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (fds[1].revents & POLLIN) {
+			struct signalfd_siginfo info;
+			while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+			}
+			helper_reap(&state);
+		}
+		if (fds[0].revents && !helper_handle_request(&state)) {
+			break;
+		}
+	}
+	_exit(0);
+}
+
+/* The compositor's side */
+
+struct cg_spawn_helper *
+spawn_helper_create(void)
+{
+	int request_fds[2], exit_fds[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, request_fds) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to create the spawn helper's socket");
+		return NULL;
+	}
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, exit_fds) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to create the spawn helper's socket");
+		close(request_fds[0]);
+		close(request_fds[1]);
+		return NULL;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(request_fds[0]);
+		close(exit_fds[0]);
+		/* Never more privileged than the clients it starts */
+		if (setgid(getgid()) != 0 || setuid(getuid()) != 0) {
+			_exit(1);
+		}
+		helper_run(request_fds[1], exit_fds[1]);
+	}
+	close(request_fds[1]);
+	close(exit_fds[1]);
+
+	struct cg_spawn_helper *helper = pid > 0 ? calloc(1, sizeof(*helper)) : NULL;
+	if (!helper) {
+		wlr_log(WLR_ERROR, "Failed to start the spawn helper");
+		close(request_fds[0]);
+		close(exit_fds[0]);
+		if (pid > 0) {
+			waitpid(pid, NULL, 0);
+		}
+		return NULL;
+	}
+
+	helper->pid = pid;
+	helper->request_fd = request_fds[0];
+	helper->exit_fd = exit_fds[0];
+	int flags = fcntl(helper->exit_fd, F_GETFL);
+	fcntl(helper->exit_fd, F_SETFL, flags | O_NONBLOCK);
+	wl_signal_init(&helper->events.exit);
+
+	wlr_log(WLR_DEBUG, "Spawn helper started with pid %d", (int)pid);
+	return helper;
+}
+
+/* Start commands from the compositor from now on */
+static void
+helper_lost(struct cg_spawn_helper *helper)
+{
+	if (helper->request_fd >= 0) {
+		wlr_log(WLR_ERROR, "Spawn helper is gone, starting clients directly");
+		close(helper->request_fd);
+		helper->request_fd = -1;
+	}
+}
+
+static int
+handle_exit_report(int fd, uint32_t mask, void *data)
+{
+	struct cg_spawn_helper *helper = data;
+
+	struct cg_spawn_exit report;
+	ssize_t len;
+	while ((len = recv(fd, &report, sizeof(report), 0)) == sizeof(report)) {
+		wlr_log(WLR_DEBUG, "Client %d exited with status %d", (int)report.pid, report.status);
+		wl_signal_emit_mutable(&helper->events.exit, &report);
+	}
+
+	if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR)) {
+		wl_event_source_remove(helper->exit_source);
+		helper->exit_source = NULL;
+		helper_lost(helper);
+	}
+	return 0;
+}
+
+bool
+spawn_helper_attach(struct cg_spawn_helper *helper, struct wl_event_loop *event_loop)
+{
+	helper->exit_source =
+		wl_event_loop_add_fd(event_loop, helper->exit_fd, WL_EVENT_READABLE, handle_exit_report, helper);
+	return helper->exit_source != NULL;
+}
+
+void
+spawn_helper_destroy(struct cg_spawn_helper *helper)
+{
+	if (!helper) {
+		return;
+	}
+
+	if (helper->exit_source) {
+		wl_event_source_remove(helper->exit_source);
+	}
+	if (helper->request_fd >= 0) {
+		close(helper->request_fd);
+	}
+	close(helper->exit_fd);
+	/* It exits as soon as it sees the socket closed */
+	waitpid(helper->pid, NULL, 0);
+	free(helper);
+}
+
+static bool
+read_reply(struct cg_spawn_helper *helper, uint64_t token, struct helper_reply *reply)
+{
+	struct pollfd pfd = {.fd = helper->request_fd, .events = POLLIN};
+	for (;;) {
+		int ready = poll(&pfd, 1, REPLY_TIMEOUT_MS);
+		if (ready < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ready <= 0) {
+			return false;
+		}
+		ssize_t len = recv(helper->request_fd, reply, sizeof(*reply), 0);
+		if (len < 0 && errno == EINTR) {
+			continue;
+		}
+		return len == sizeof(*reply) && reply->token == token;
+	}
+}
+
+pid_t
+spawn_helper_spawn(struct cg_spawn_helper *helper, char *const argv[], const struct cg_spawn_env *env,
+		   const char *cwd, const char *cgroup, uint64_t *token)
+{
+	if (token) {
+		*token = 0;
+	}
+	if (!helper || helper->request_fd < 0) {
+		goto direct;
+	}
+
+	struct helper_request request = {
+		.token = ++helper->next_token,
+		.envc = env->count,
+		.has_cwd = cwd != NULL,
+		.has_cgroup = cgroup != NULL,
+	};
+	size_t len = sizeof(request);
+	for (; argv[request.argc]; request.argc++) {
+		len += strlen(argv[request.argc]) + 1;
+	}
+	for (size_t i = 0; i < env->count; i++) {
+		len += strlen(env->vars[i]) + 1;
+	}
+	len += (cwd ? strlen(cwd) + 1 : 0) + (cgroup ? strlen(cgroup) + 1 : 0);
+
+	char *buf = malloc(len);
+	if (!buf) {
+		goto direct;
+	}
+	memcpy(buf, &request, sizeof(request));
+	char *pos = buf + sizeof(request);
+	for (uint32_t i = 0; i < request.argc; i++) {
+		pos = stpcpy(pos, argv[i]) + 1;
+	}
+	for (size_t i = 0; i < env->count; i++) {
+		pos = stpcpy(pos, env->vars[i]) + 1;
+	}
+	if (cwd) {
+		pos = stpcpy(pos, cwd) + 1;
+	}
+	if (cgroup) {
+		stpcpy(pos, cgroup);
+	}
+
+	ssize_t sent = send(helper->request_fd, buf, len, MSG_NOSIGNAL);
+	free(buf);
+	if (sent != (ssize_t)len) {
+		/* Larger than a socket buffer */
+		if (errno != EMSGSIZE) {
+			helper_lost(helper);
+		}
+		goto direct;
+	}
+
+	struct helper_reply reply;
+	if (!read_reply(helper, request.token, &reply)) {
+		/* The command may or may not have started; it isn't retried */
+		helper_lost(helper);
+		return -1;
+	}
+	if (reply.pid < 0) {
+		errno = reply.error;
+		return -1;
+	}
+	if (token) {
+		*token = request.token;
+	}
+	return reply.pid;
+
+direct:
+	return cgroup ? spawn_command_in_cgroup(argv, env, cwd, cgroup) : spawn_command(argv, env, cwd);
+}
@@ -0,0 +1,76 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_SPAWN_HELPER_H
+#define CG_SPAWN_HELPER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <wayland-server-core.h>
+
+#include "spawner.h"
+
+/*
+ * A small process forked from WayMux at startup, before it opens any GPU
+ * device or grows, which starts the clients on its behalf. Spawning from
+ * it costs the same however large the compositor gets, and no client can
+ * inherit the compositor's DRM file descriptors. The helper is the
+ * clients' parent: it reaps them, and reports their exit statuses.
+ *
+ * Requests go over a socketpair and are answered in order, so spawning
+ * stays synchronous; each carries a token that the reply and the client's
+ * exit report repeat, by which profile launches tell which of their tabs
+ * failed. Exit reports come on a socketpair of their own, read from the
+ * event loop. Should the helper go away, commands are started
+ * from the compositor directly.
+ */
+
+/* A client of the helper exited */
+struct cg_spawn_exit {
+	uint64_t token;
+	pid_t pid;
+	int status;  /* As from waitpid() */
+};
+
+struct cg_spawn_helper {
+	pid_t pid;
+	int request_fd;  /* -1 once the helper is gone */
+	int exit_fd;
+	uint64_t next_token;
+	struct wl_event_source *exit_source;
+
+	struct {
+		struct wl_signal exit;  /* struct cg_spawn_exit */
+	} events;
+};
+
+/**
+ * Fork the helper. Call early, before opening anything the clients
+ * shouldn't inherit. Returns NULL if it couldn't be started.
+ */
+struct cg_spawn_helper *spawn_helper_create(void);
+
+/**
+ * Start emitting events.exit from the event loop.
+ */
+bool spawn_helper_attach(struct cg_spawn_helper *helper, struct wl_event_loop *event_loop);
+
+/**
+ * Stop the helper. Clients keep running. NULL-safe.
+ */
+void spawn_helper_destroy(struct cg_spawn_helper *helper);
+
+/**
+ * Like spawn_command_in_cgroup(), from the helper; cgroup may be NULL. If
+ * token is not NULL, it is set to the token the exit report will carry.
+ */
+pid_t spawn_helper_spawn(struct cg_spawn_helper *helper, char *const argv[], const struct cg_spawn_env *env,
+			 const char *cwd, const char *cgroup, uint64_t *token);
+
+#endif
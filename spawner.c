@@ -0,0 +1,309 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+/* For posix_spawn_file_actions_addchdir_np() and
+ * posix_spawnattr_setcgroup_np() */
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+#include "spawner.h"
+
+extern char **environ;
+
+/* Find a variable, returning its index or -1 */
+static long
+env_find(const struct cg_spawn_env *env, const char *key, size_t key_len)
+{
+	for (size_t i = 0; i < env->count; i++) {
+		if (strncmp(env->vars[i], key, key_len) == 0 && env->vars[i][key_len] == '=') {
+			return (long)i;
+		}
+	}
+	return -1;
+}
+
+static bool
+env_append(struct cg_spawn_env *env, char *var)
+{
+	/* Keep room for the NULL terminator */
+	if (env->count + 1 >= env->capacity) {
+		size_t capacity = env->capacity ? env->capacity * 2 : 64;
+		char **vars = realloc(env->vars, capacity * sizeof(*vars));
+		if (!vars) {
+			return false;
+		}
+		env->vars = vars;
+		env->capacity = capacity;
+	}
+	env->vars[env->count++] = var;
+	env->vars[env->count] = NULL;
+	return true;
+}
+
+bool
+spawn_env_init(struct cg_spawn_env *env)
+{
+	memset(env, 0, sizeof(*env));
+
+	for (char **var = environ; var && *var; var++) {
+		char *copy = strdup(*var);
+		if (!copy || !env_append(env, copy)) {
+			free(copy);
+			spawn_env_finish(env);
+			return false;
+		}
+	}
+
+	/* An empty environment still needs its terminator */
+	if (!env->vars) {
+		env->vars = calloc(1, sizeof(*env->vars));
+		env->capacity = 1;
+	}
+	return env->vars != NULL;
+}
+
+bool
+spawn_env_set(struct cg_spawn_env *env, const char *key, const char *value)
+{
+	size_t key_len = strlen(key);
+	size_t len = key_len + strlen(value) + 2;
+	char *var = malloc(len);
+	if (!var) {
+		return false;
+	}
+	memcpy(var, key, key_len);
+	var[key_len] = '=';
+	strcpy(var + key_len + 1, value);
+
+	long index = env_find(env, key, key_len);
+	if (index >= 0) {
+		free(env->vars[index]);
+		env->vars[index] = var;
+		return true;
+	}
+	if (!env_append(env, var)) {
+		free(var);
+		return false;
+	}
+	return true;
+}
+
+void
+spawn_env_unset(struct cg_spawn_env *env, const char *key)
+{
+	long index = env_find(env, key, strlen(key));
+	if (index < 0) {
+		return;
+	}
+
+	free(env->vars[index]);
+	memmove(&env->vars[index], &env->vars[index + 1], (env->count - index) * sizeof(*env->vars));
+	env->count--;
+}
+
+const char *
+spawn_env_get(const struct cg_spawn_env *env, const char *key)
+{
+	size_t key_len = strlen(key);
+	long index = env_find(env, key, key_len);
+	return index >= 0 ? env->vars[index] + key_len + 1 : NULL;
+}
+
+void
+spawn_env_finish(struct cg_spawn_env *env)
+{
+	for (size_t i = 0; i < env->count; i++) {
+		free(env->vars[i]);
+	}
+	free(env->vars);
+	memset(env, 0, sizeof(*env));
+}
+
+/* Spawn attributes shared by every command of a batch */
+struct spawn_context {
+	posix_spawnattr_t attr;
+	posix_spawn_file_actions_t actions;
+	/* Without posix_spawn_file_actions_addchdir_np(), the working
+	 * directory is changed by a shell that then execs the command */
+	const char *shell_cwd;
+	/* Without POSIX_SPAWN_SETCGROUP, children are moved into their
+	 * cgroup right after starting, so that only the very first thing
+	 * they do (before exec) is accounted to ours */
+	const char *move_cgroup;
+	int cgroup_fd;
+};
+
+static bool
+spawn_context_init(struct spawn_context *ctx, const char *cwd, const char *cgroup)
+{
+	if (posix_spawnattr_init(&ctx->attr) != 0) {
+		return false;
+	}
+	if (posix_spawn_file_actions_init(&ctx->actions) != 0) {
+		posix_spawnattr_destroy(&ctx->attr);
+		return false;
+	}
+
+	/* The compositor blocks the signals it handles through the event
+	 * loop; clients start with none blocked and default handlers */
+	sigset_t mask, defaults;
+	sigemptyset(&mask);
+	sigfillset(&defaults);
+	posix_spawnattr_setsigmask(&ctx->attr, &mask);
+	posix_spawnattr_setsigdefault(&ctx->attr, &defaults);
+	short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+
+	ctx->move_cgroup = NULL;
+	ctx->cgroup_fd = -1;
+	if (cgroup) {
+#if WAYMUX_HAS_SPAWN_CGROUP
+		ctx->cgroup_fd = open(cgroup, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (ctx->cgroup_fd >= 0 && posix_spawnattr_setcgroup_np(&ctx->attr, ctx->cgroup_fd) == 0) {
+			flags |= POSIX_SPAWN_SETCGROUP;
+		} else {
+			ctx->move_cgroup = cgroup;
+		}
+#else
+		ctx->move_cgroup = cgroup;
+#endif
+	}
+	posix_spawnattr_setflags(&ctx->attr, flags);
+
+	ctx->shell_cwd = NULL;
+	if (cwd) {
+#if WAYMUX_HAS_SPAWN_CHDIR
+		posix_spawn_file_actions_addchdir_np(&ctx->actions, cwd);
+#else
+		ctx->shell_cwd = cwd;
+#endif
+	}
+	return true;
+}
+
+static void
+spawn_context_finish(struct spawn_context *ctx)
+{
+	posix_spawn_file_actions_destroy(&ctx->actions);
+	posix_spawnattr_destroy(&ctx->attr);
+	if (ctx->cgroup_fd >= 0) {
+		close(ctx->cgroup_fd);
+	}
+}
+
+static void
+move_to_cgroup(pid_t pid, const char *cgroup)
+{
+	char path[4096], value[32];
+	snprintf(path, sizeof(path), "%s/cgroup.procs", cgroup);
+	int len = snprintf(value, sizeof(value), "%d", (int)pid);
+	int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0 || write(fd, value, len) != len) {
+		wlr_log_errno(WLR_ERROR, "Failed to move pid %d to cgroup %s", (int)pid, cgroup);
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+static pid_t
+spawn_with_context(struct spawn_context *ctx, char *const argv[], const struct cg_spawn_env *env)
+{
+	pid_t pid;
+	int err;
+
+	if (ctx->shell_cwd) {
+		size_t argc = 0;
+		while (argv[argc]) {
+			argc++;
+		}
+		char **shell_argv = calloc(argc + 5, sizeof(*shell_argv));
+		if (!shell_argv) {
+			return -1;
+		}
+		shell_argv[0] = "/bin/sh";
+		shell_argv[1] = "-c";
+		shell_argv[2] = "cd -- \"$0\" && exec \"$@\"";
+		shell_argv[3] = (char *)ctx->shell_cwd;
+		memcpy(&shell_argv[4], argv, argc * sizeof(*argv));
+		err = posix_spawn(&pid, "/bin/sh", &ctx->actions, &ctx->attr, shell_argv, env->vars);
+		free(shell_argv);
+	} else {
+		err = posix_spawnp(&pid, argv[0], &ctx->actions, &ctx->attr, argv, env->vars);
+	}
+
+	if (err != 0) {
+		errno = err;
+		wlr_log_errno(WLR_ERROR, "Failed to spawn %s", argv[0]);
+		return -1;
+	}
+	if (ctx->move_cgroup) {
+		move_to_cgroup(pid, ctx->move_cgroup);
+	}
+	return pid;
+}
+
+pid_t
+spawn_command(char *const argv[], const struct cg_spawn_env *env, const char *cwd)
+{
+	struct cg_spawn_request request = {.argv = argv};
+	spawn_batch(&request, 1, env, cwd);
+	return request.pid;
+}
+
+pid_t
+spawn_command_in_cgroup(char *const argv[], const struct cg_spawn_env *env, const char *cwd, const char *cgroup)
+{
+	struct cg_spawn_request request = {.argv = argv};
+	spawn_batch_in_cgroup(&request, 1, env, cwd, cgroup);
+	return request.pid;
+}
+
+size_t
+spawn_batch(struct cg_spawn_request *requests, size_t count, const struct cg_spawn_env *env,
+	    const char *cwd)
+{
+	return spawn_batch_in_cgroup(requests, count, env, cwd, NULL);
+}
+
+size_t
+spawn_batch_in_cgroup(struct cg_spawn_request *requests, size_t count, const struct cg_spawn_env *env,
+		      const char *cwd, const char *cgroup)
+{
+	struct spawn_context ctx;
+	if (!spawn_context_init(&ctx, cwd, cgroup)) {
+		wlr_log(WLR_ERROR, "Failed to set up spawn attributes");
+		for (size_t i = 0; i < count; i++) {
+			requests[i].pid = -1;
+		}
+		return 0;
+	}
+
+	size_t started = 0;
+	for (size_t i = 0; i < count; i++) {
+		requests[i].pid = spawn_with_context(&ctx, requests[i].argv, env);
+		if (requests[i].pid > 0) {
+			wlr_log(WLR_DEBUG, "Spawned %s with pid %d", requests[i].argv[0], requests[i].pid);
+			started++;
+		}
+	}
+
+	spawn_context_finish(&ctx);
+	return started;
+}
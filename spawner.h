@@ -0,0 +1,86 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_SPAWNER_H
+#define CG_SPAWNER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Clients are started with posix_spawn() rather than fork(), so the
+ * compositor's address space (with its GPU mappings) is never copied,
+ * and with an environment prepared once in the parent instead of being
+ * edited in every child.
+ */
+
+/* A NULL-terminated environment in the form execve() takes */
+struct cg_spawn_env {
+	char **vars;
+	size_t count;
+	size_t capacity;
+};
+
+/* One command of a batch; pid is filled in, -1 if it failed to start */
+struct cg_spawn_request {
+	char *const *argv;
+	pid_t pid;
+};
+
+/**
+ * Initialize an environment as a copy of the compositor's own.
+ * Returns false on allocation failure.
+ */
+bool spawn_env_init(struct cg_spawn_env *env);
+
+/**
+ * Set (or replace) a variable. Returns false on allocation failure.
+ */
+bool spawn_env_set(struct cg_spawn_env *env, const char *key, const char *value);
+
+/**
+ * Remove a variable, if present.
+ */
+void spawn_env_unset(struct cg_spawn_env *env, const char *key);
+
+/**
+ * Get the value of a variable, or NULL.
+ */
+const char *spawn_env_get(const struct cg_spawn_env *env, const char *key);
+
+void spawn_env_finish(struct cg_spawn_env *env);
+
+/**
+ * Start argv[0] (searched in PATH) with the given environment, in working
+ * directory cwd if not NULL. The child's signal mask and dispositions are
+ * reset. Returns the pid, or -1 if the command couldn't be started.
+ */
+pid_t spawn_command(char *const argv[], const struct cg_spawn_env *env, const char *cwd);
+
+/**
+ * Start a batch of commands sharing one environment and working
+ * directory. Returns the number of commands that started.
+ */
+size_t spawn_batch(struct cg_spawn_request *requests, size_t count, const struct cg_spawn_env *env,
+		   const char *cwd);
+
+/**
+ * Like spawn_command(), starting the child in the cgroup (v2) directory
+ * cgroup, which the compositor must be allowed to move processes into.
+ */
+pid_t spawn_command_in_cgroup(char *const argv[], const struct cg_spawn_env *env, const char *cwd,
+			      const char *cgroup);
+
+/**
+ * Like spawn_batch(), with every command in the same cgroup.
+ */
+size_t spawn_batch_in_cgroup(struct cg_spawn_request *requests, size_t count, const struct cg_spawn_env *env,
+			     const char *cwd, const char *cgroup);
+
+#endif
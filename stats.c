@@ -0,0 +1,175 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "pixel_buffer.h"
+#include "stats.h"
+
+#define NS_PER_SEC 1000000000ULL
+
+/* Counters are process-wide, so that code without a server at hand (e.g.
+ * the pixel buffer pool) can be instrumented too */
+static struct cg_stats stats;
+
+static const char *timer_names[STATS_TIMER_COUNT] = {
+	[STATS_FRAME] = "frame",
+	[STATS_SCENE_COMMIT] = "scene_commit",
+	[STATS_TAB_BAR_RENDER] = "tab_bar_render",
+	[STATS_LAUNCHER_RENDER] = "launcher_render",
+};
+
+/* Lines after the timers */
+enum {
+	LINE_TAB_BAR_BUTTONS = STATS_TIMER_COUNT,
+	LINE_PIXEL_BUFFERS,
+	LINE_CONTROL_COMMANDS,
+	LINE_MEMORY,
+	LINE_FIRST_FRAMES,
+};
+
+uint64_t
+stats_now(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * NS_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+void
+stats_record(enum stats_timer timer, uint64_t start_ns)
+{
+	struct stats_timing *timing = &stats.timings[timer];
+	uint64_t ns = stats_now() - start_ns;
+
+	timing->count++;
+	timing->last_ns = ns;
+	timing->total_ns += ns;
+	if (ns > timing->max_ns) {
+		timing->max_ns = ns;
+	}
+}
+
+void
+stats_count(enum stats_counter counter, uint64_t amount)
+{
+	stats.counters[counter] += amount;
+}
+
+void
+stats_control_command(void)
+{
+	uint64_t now = stats_now();
+	stats.counters[STATS_CONTROL_COMMANDS]++;
+
+	uint64_t elapsed = now - stats.control_window_start_ns;
+	if (elapsed >= NS_PER_SEC) {
+		/* A window that ended long ago says nothing about the last
+		 * second; it only counts if it ended within the last one */
+		stats.control_per_second = elapsed < 2 * NS_PER_SEC ?
+			(double)stats.control_window_count * NS_PER_SEC / (double)elapsed : 0.0;
+		stats.control_window_start_ns = now;
+		stats.control_window_count = 0;
+	}
+	stats.control_window_count++;
+}
+
+void
+stats_tab_first_frame(uint32_t tab_id, uint64_t mapped_ns)
+{
+	stats.first_frames[stats.first_frame_next] = (struct stats_first_frame){
+		.tab_id = tab_id,
+		.ns = stats_now() - mapped_ns,
+	};
+	stats.first_frame_next = (stats.first_frame_next + 1) % STATS_FIRST_FRAMES;
+	if (stats.first_frame_count < STATS_FIRST_FRAMES) {
+		stats.first_frame_count++;
+	}
+}
+
+const char *
+stats_timer_name(enum stats_timer timer)
+{
+	return timer_names[timer];
+}
+
+const struct cg_stats *
+stats_get(void)
+{
+	return &stats;
+}
+
+void
+stats_reset(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+size_t
+stats_line_count(void)
+{
+	return LINE_FIRST_FRAMES + stats.first_frame_count;
+}
+
+static double
+ms(uint64_t ns)
+{
+	return (double)ns / 1e6;
+}
+
+void
+stats_format_line(size_t line, char *buf, size_t size)
+{
+	if (line < STATS_TIMER_COUNT) {
+		const struct stats_timing *timing = &stats.timings[line];
+		uint64_t avg = timing->count ? timing->total_ns / timing->count : 0;
+		snprintf(buf, size, "%s: %llu x, last %.2f ms, avg %.2f ms, max %.2f ms", timer_names[line],
+			 (unsigned long long)timing->count, ms(timing->last_ns), ms(avg), ms(timing->max_ns));
+		return;
+	}
+
+	switch (line) {
+	case LINE_TAB_BAR_BUTTONS:
+		snprintf(buf, size, "tab_bar_buttons: %llu rendered",
+			 (unsigned long long)stats.counters[STATS_TAB_BAR_BUTTONS]);
+		return;
+	case LINE_PIXEL_BUFFERS: {
+		struct pixel_buffer_pool_stats pool;
+		pixel_buffer_pool_get_stats(&pool);
+		snprintf(buf, size, "pixel_buffers: %llu allocated, %llu reused, %zu bytes pooled",
+			 (unsigned long long)pool.misses, (unsigned long long)pool.hits, pool.pooled_bytes);
+		return;
+	}
+	case LINE_CONTROL_COMMANDS:
+		snprintf(buf, size, "control_commands: %llu, %.1f/s",
+			 (unsigned long long)stats.counters[STATS_CONTROL_COMMANDS], stats.control_per_second);
+		return;
+	case LINE_MEMORY:
+		snprintf(buf, size, "memory: %llu trims, %llu under pressure, %llu bytes reclaimed",
+			 (unsigned long long)stats.counters[STATS_MEMORY_TRIMS],
+			 (unsigned long long)stats.counters[STATS_MEMORY_PRESSURE],
+			 (unsigned long long)stats.counters[STATS_MEMORY_RECLAIMED]);
+		return;
+	}
+
+	/* First frames, most recent first */
+	size_t age = line - LINE_FIRST_FRAMES;
+	if (age >= stats.first_frame_count) {
+		if (size > 0) {
+			buf[0] = '\0';
+		}
+		return;
+	}
+	size_t index = (stats.first_frame_next + STATS_FIRST_FRAMES - 1 - age) % STATS_FIRST_FRAMES;
+	snprintf(buf, size, "first_frame: tab %u, %.2f ms", stats.first_frames[index].tab_id,
+		 ms(stats.first_frames[index].ns));
+}
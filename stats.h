@@ -0,0 +1,138 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_STATS_H
+#define CG_STATS_H
+
+#include "config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Performance counters, shown by the stats HUD and the control socket's
+ * stats command. They are only built with -Dstats (on by default in debug
+ * builds); otherwise every function below is an empty inline and
+ * stats_now() returns 0, so instrumented code costs nothing.
+ */
+
+/* Timed sections */
+enum stats_timer {
+	STATS_FRAME,          /* handle_output_frame() */
+	STATS_SCENE_COMMIT,   /* wlr_scene_output_commit() */
+	STATS_TAB_BAR_RENDER, /* tab_bar_flush() when it has work */
+	STATS_LAUNCHER_RENDER,
+	STATS_TIMER_COUNT,
+};
+
+/* Plain counters */
+enum stats_counter {
+	STATS_TAB_BAR_BUTTONS, /* Tab bar buttons re-rendered */
+	STATS_CONTROL_COMMANDS,
+	STATS_MEMORY_TRIMS,     /* Idle or pressure trims, see memory_policy.c */
+	STATS_MEMORY_PRESSURE,  /* Trims caused by memory pressure */
+	STATS_MEMORY_RECLAIMED, /* Bytes freed by trims */
+	STATS_COUNTER_COUNT,
+};
+
+/* Tabs whose time to first frame is kept */
+#define STATS_FIRST_FRAMES 8
+
+struct stats_timing {
+	uint64_t count;
+	uint64_t last_ns;
+	uint64_t max_ns;
+	uint64_t total_ns;
+};
+
+struct stats_first_frame {
+	uint32_t tab_id;
+	uint64_t ns;
+};
+
+struct cg_stats {
+	struct stats_timing timings[STATS_TIMER_COUNT];
+	uint64_t counters[STATS_COUNTER_COUNT];
+
+	/* Control commands per second, over the last whole second */
+	uint64_t control_window_start_ns;
+	uint64_t control_window_count;
+	double control_per_second;
+
+	/* Most recent first frames, a ring of first_frame_count entries
+	 * with the next one written at first_frame_next */
+	struct stats_first_frame first_frames[STATS_FIRST_FRAMES];
+	size_t first_frame_count;
+	size_t first_frame_next;
+};
+
+#if WAYMUX_HAS_STATS
+
+/* Monotonic time in nanoseconds */
+uint64_t stats_now(void);
+
+/* Record a timed section that started at start_ns */
+void stats_record(enum stats_timer timer, uint64_t start_ns);
+
+void stats_count(enum stats_counter counter, uint64_t amount);
+
+/* Count a control command, updating the commands per second */
+void stats_control_command(void);
+
+/* Record how long a tab took from mapping to its first frame */
+void stats_tab_first_frame(uint32_t tab_id, uint64_t mapped_ns);
+
+/* Name of a timer in the reports, e.g. "scene_commit" */
+const char *stats_timer_name(enum stats_timer timer);
+
+const struct cg_stats *stats_get(void);
+void stats_reset(void);
+
+/* Number of lines of the text report */
+size_t stats_line_count(void);
+
+/* Write a line of the text report, e.g. "frame: 120 x, last 0.41 ms, ..." */
+void stats_format_line(size_t line, char *buf, size_t size);
+
+#else
+
+static inline uint64_t
+stats_now(void)
+{
+	return 0;
+}
+
+static inline void
+stats_record(enum stats_timer timer, uint64_t start_ns)
+{
+	(void)timer;
+	(void)start_ns;
+}
+
+static inline void
+stats_count(enum stats_counter counter, uint64_t amount)
+{
+	(void)counter;
+	(void)amount;
+}
+
+static inline void
+stats_control_command(void)
+{
+}
+
+static inline void
+stats_tab_first_frame(uint32_t tab_id, uint64_t mapped_ns)
+{
+	(void)tab_id;
+	(void)mapped_ns;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <cairo/cairo.h>
+#include <stdlib.h>
+#include <wlr/util/log.h>
+
+#include "font.h"
+#include "output.h"
+#include "server.h"
+#include "stats.h"
+#include "stats_hud.h"
+
+#define HUD_WIDTH 460
+#define HUD_PADDING 10
+#define HUD_LINE_HEIGHT 18
+#define HUD_FONT_SIZE 12
+#define HUD_REFRESH_MS 1000
+
+static const float hud_bg[4] = {0.0f, 0.0f, 0.0f, 0.75f};
+static const float hud_text[4] = {0.6f, 1.0f, 0.6f, 1.0f};
+
+static int
+hud_height(void)
+{
+	return 2 * HUD_PADDING + (int)stats_line_count() * HUD_LINE_HEIGHT;
+}
+
+static void
+render(struct cg_stats_hud *hud)
+{
+	int height = hud_height();
+
+	/* Every line changes, and the report can grow */
+	overlay_damage_whole(&hud->overlay);
+	cairo_t *cr = overlay_begin_paint(&hud->overlay, HUD_WIDTH, height);
+	if (!cr) {
+		return;
+	}
+
+	cairo_set_source_rgba(cr, hud_bg[0], hud_bg[1], hud_bg[2], hud_bg[3]);
+	cairo_rectangle(cr, 0, 0, HUD_WIDTH, height);
+	cairo_fill(cr);
+
+	font_apply(hud->font, cr);
+	cairo_set_source_rgba(cr, hud_text[0], hud_text[1], hud_text[2], hud_text[3]);
+
+	size_t lines = stats_line_count();
+	for (size_t i = 0; i < lines; i++) {
+		char line[128];
+		stats_format_line(i, line, sizeof(line));
+		cairo_move_to(cr, HUD_PADDING, HUD_PADDING + (int)(i + 1) * HUD_LINE_HEIGHT - 4);
+		cairo_show_text(cr, line);
+	}
+
+	overlay_end_paint(&hud->overlay, cr, hud->content_buffer);
+}
+
+void
+stats_hud_flush(struct cg_stats_hud *hud)
+{
+	if (!hud || !hud->is_visible || !hud->dirty) {
+		return;
+	}
+
+	/* In the top right corner of the focused output */
+	struct wlr_box box;
+	struct cg_output *output = output_focused_box(hud->server, &box);
+	if (output) {
+		overlay_set_scale(&hud->overlay, output->wlr_output->scale);
+		render(hud);
+		wlr_scene_node_set_position(&hud->content_buffer->node, box.x + box.width - HUD_WIDTH - HUD_PADDING,
+					    box.y + HUD_PADDING);
+	}
+
+	wlr_scene_node_raise_to_top(&hud->scene_tree->node);
+	hud->dirty = false;
+}
+
+static void
+schedule_refresh(struct cg_stats_hud *hud)
+{
+	hud->dirty = true;
+	output_schedule_frames(hud->server);
+}
+
+static int
+handle_refresh_timer(void *data)
+{
+	struct cg_stats_hud *hud = data;
+	if (hud->is_visible) {
+		schedule_refresh(hud);
+		wl_event_source_timer_update(hud->refresh_timer, HUD_REFRESH_MS);
+	}
+	return 0;
+}
+
+void
+stats_hud_toggle(struct cg_stats_hud *hud)
+{
+	if (!hud) {
+		return;
+	}
+
+	hud->is_visible = !hud->is_visible;
+	wlr_scene_node_set_enabled(&hud->scene_tree->node, hud->is_visible);
+	wl_event_source_timer_update(hud->refresh_timer, hud->is_visible ? HUD_REFRESH_MS : 0);
+	if (hud->is_visible) {
+		schedule_refresh(hud);
+	}
+}
+
+struct cg_stats_hud *
+stats_hud_create(struct cg_server *server)
+{
+	struct cg_stats_hud *hud = calloc(1, sizeof(*hud));
+	if (!hud) {
+		wlr_log(WLR_ERROR, "Failed to allocate stats HUD");
+		return NULL;
+	}
+
+	hud->server = server;
+	overlay_init(&hud->overlay);
+
+	hud->font = font_create("monospace", HUD_FONT_SIZE);
+	if (!hud->font) {
+		goto error;
+	}
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(server->wl_display);
+	hud->refresh_timer = wl_event_loop_add_timer(loop, handle_refresh_timer, hud);
+	if (!hud->refresh_timer) {
+		wlr_log(WLR_ERROR, "Failed to create stats HUD timer");
+		goto error;
+	}
+
+	hud->scene_tree = wlr_scene_tree_create(&server->scene->tree);
+	if (!hud->scene_tree) {
+		wlr_log(WLR_ERROR, "Failed to create stats HUD scene tree");
+		goto error;
+	}
+
+	hud->content_buffer = wlr_scene_buffer_create(hud->scene_tree, NULL);
+	if (!hud->content_buffer) {
+		wlr_log(WLR_ERROR, "Failed to create stats HUD content buffer");
+		wlr_scene_node_destroy(&hud->scene_tree->node);
+		goto error;
+	}
+
+	wlr_scene_node_set_enabled(&hud->scene_tree->node, false);
+	return hud;
+
+error:
+	if (hud->refresh_timer) {
+		wl_event_source_remove(hud->refresh_timer);
+	}
+	font_destroy(hud->font);
+	overlay_finish(&hud->overlay);
+	free(hud);
+	return NULL;
+}
+
+void
+stats_hud_destroy(struct cg_stats_hud *hud)
+{
+	if (!hud) {
+		return;
+	}
+
+	/* The scene tree is destroyed along with the scene */
+	wl_event_source_remove(hud->refresh_timer);
+	overlay_finish(&hud->overlay);
+	font_destroy(hud->font);
+	free(hud);
+}
@@ -0,0 +1,43 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_STATS_HUD_H
+#define CG_STATS_HUD_H
+
+#include <stdbool.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_scene.h>
+
+#include "overlay.h"
+
+struct cg_server;
+struct cg_font;
+
+/* Only built with -Dstats. The HUD is refreshed once a second while it is
+ * shown, rather than every frame, so that it doesn't keep the outputs
+ * busy or skew the frame times it reports. */
+struct cg_stats_hud {
+	struct cg_server *server;
+	struct wlr_scene_tree *scene_tree;
+	struct cg_font *font;
+	struct wlr_scene_buffer *content_buffer;
+	struct cg_overlay overlay;
+	struct wl_event_source *refresh_timer;
+	bool is_visible;
+	bool dirty;
+};
+
+struct cg_stats_hud *stats_hud_create(struct cg_server *server);
+void stats_hud_destroy(struct cg_stats_hud *hud);
+
+void stats_hud_toggle(struct cg_stats_hud *hud);
+
+/* Repaint a pending refresh; called once per output frame */
+void stats_hud_flush(struct cg_stats_hud *hud);
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "string_arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct cg_string_arena_chunk {
+	struct cg_string_arena_chunk *next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+void
+string_arena_init(struct cg_string_arena *arena)
+{
+	memset(arena, 0, sizeof(*arena));
+}
+
+void
+string_arena_finish(struct cg_string_arena *arena)
+{
+	struct cg_string_arena_chunk *chunk = arena->chunks;
+	while (chunk) {
+		struct cg_string_arena_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	free(arena->interned);
+	memset(arena, 0, sizeof(*arena));
+}
+
+char *
+string_arena_alloc(struct cg_string_arena *arena, size_t size)
+{
+	struct cg_string_arena_chunk *chunk = arena->chunks;
+	if (!chunk || chunk->size - chunk->used < size) {
+		size_t chunk_size = size > STRING_ARENA_CHUNK_SIZE ? size : STRING_ARENA_CHUNK_SIZE;
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		if (!chunk) {
+			return NULL;
+		}
+		chunk->size = chunk_size;
+		chunk->used = 0;
+
+		/* An oversized chunk goes behind the current one, so that the
+		 * rest of the current one is still used */
+		if (arena->chunks && size > STRING_ARENA_CHUNK_SIZE) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else {
+			chunk->next = arena->chunks;
+			arena->chunks = chunk;
+		}
+	}
+
+	char *ptr = chunk->data + chunk->used;
+	chunk->used += size;
+	arena->size += size;
+	return ptr;
+}
+
+void *
+string_arena_alloc_aligned(struct cg_string_arena *arena, size_t size, size_t align)
+{
+	char *ptr = string_arena_alloc(arena, size + align - 1);
+	if (!ptr) {
+		return NULL;
+	}
+	return ptr + (-(uintptr_t)ptr & (align - 1));
+}
+
+const char *
+string_arena_strndup(struct cg_string_arena *arena, const char *str, size_t len)
+{
+	char *copy = string_arena_alloc(arena, len + 1);
+	if (!copy) {
+		return NULL;
+	}
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+const char *
+string_arena_strdup(struct cg_string_arena *arena, const char *str)
+{
+	return str ? string_arena_strndup(arena, str, strlen(str)) : NULL;
+}
+
+/* FNV-1a */
+static uint32_t
+hash_string(const char *str, size_t len)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool
+intern_grow(struct cg_string_arena *arena)
+{
+	size_t capacity = arena->interned_capacity ? arena->interned_capacity * 2 : 64;
+	const char **table = calloc(capacity, sizeof(*table));
+	if (!table) {
+		return false;
+	}
+
+	for (size_t i = 0; i < arena->interned_capacity; i++) {
+		const char *str = arena->interned[i];
+		if (!str) {
+			continue;
+		}
+		size_t slot = hash_string(str, strlen(str)) & (capacity - 1);
+		while (table[slot]) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		table[slot] = str;
+	}
+
+	free(arena->interned);
+	arena->interned = table;
+	arena->interned_capacity = capacity;
+	return true;
+}
+
+const char *
+string_arena_intern(struct cg_string_arena *arena, const char *str, size_t len)
+{
+	/* Kept at most half full */
+	if ((arena->interned_count + 1) * 2 > arena->interned_capacity && !intern_grow(arena)) {
+		return string_arena_strndup(arena, str, len);
+	}
+
+	size_t mask = arena->interned_capacity - 1;
+	size_t slot = hash_string(str, len) & mask;
+	while (arena->interned[slot]) {
+		const char *existing = arena->interned[slot];
+		if (strncmp(existing, str, len) == 0 && existing[len] == '\0') {
+			return existing;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	const char *copy = string_arena_strndup(arena, str, len);
+	if (copy) {
+		arena->interned[slot] = copy;
+		arena->interned_count++;
+	}
+	return copy;
+}
+
+void
+string_arena_adopt(struct cg_string_arena *dest, struct cg_string_arena *src)
+{
+	if (!src->chunks) {
+		string_arena_finish(src);
+		return;
+	}
+
+	/* src's chunks go behind dest's current one, which keeps filling */
+	struct cg_string_arena_chunk *last = src->chunks;
+	while (last->next) {
+		last = last->next;
+	}
+	if (dest->chunks) {
+		last->next = dest->chunks->next;
+		dest->chunks->next = src->chunks;
+	} else {
+		dest->chunks = src->chunks;
+	}
+	dest->size += src->size;
+
+	src->chunks = NULL;
+	string_arena_finish(src);
+}
@@ -0,0 +1,77 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_STRING_ARENA_H
+#define CG_STRING_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Size of a regular chunk; larger allocations get a chunk of their own */
+#define STRING_ARENA_CHUNK_SIZE (64 * 1024)
+
+struct cg_string_arena_chunk;
+
+/*
+ * Strings allocated back to back in large chunks and freed all at once,
+ * for data that is built once and then only read, such as the desktop
+ * entries. Strings passed to string_arena_intern() are stored once, and
+ * equal ones share that copy. Nothing in an arena moves, so arenas can be
+ * filled on one thread and handed to another with string_arena_adopt().
+ */
+struct cg_string_arena {
+	struct cg_string_arena_chunk *chunks;  /* Most recent first */
+	size_t size;  /* Bytes handed out */
+
+	/* Interned strings, open addressing */
+	const char **interned;
+	size_t interned_count;
+	size_t interned_capacity;
+};
+
+void string_arena_init(struct cg_string_arena *arena);
+
+/**
+ * Free every string of the arena.
+ */
+void string_arena_finish(struct cg_string_arena *arena);
+
+/**
+ * Allocate size bytes, unaligned. Returns NULL on allocation failure.
+ */
+char *string_arena_alloc(struct cg_string_arena *arena, size_t size);
+
+/**
+ * Allocate size bytes aligned to align, a power of two, for data that
+ * holds pointers along with its strings.
+ */
+void *string_arena_alloc_aligned(struct cg_string_arena *arena, size_t size, size_t align);
+
+/**
+ * Copy a string into the arena. NULL is copied as NULL.
+ */
+const char *string_arena_strdup(struct cg_string_arena *arena, const char *str);
+
+/**
+ * Copy the first len bytes of str into the arena, NUL-terminated.
+ */
+const char *string_arena_strndup(struct cg_string_arena *arena, const char *str, size_t len);
+
+/**
+ * Like string_arena_strndup(), returning the copy already in the arena if
+ * an equal string was interned before.
+ */
+const char *string_arena_intern(struct cg_string_arena *arena, const char *str, size_t len);
+
+/**
+ * Move every string of src to dest, leaving src empty. Pointers to the
+ * strings stay valid; interning in dest doesn't find them.
+ */
+void string_arena_adopt(struct cg_string_arena *dest, struct cg_string_arena *src);
+
+#endif
@@ -10,15 +10,289 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <stdlib.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/util/log.h>
 
+#include "output.h"
 #include "server.h"
 #include "tab.h"
 #include "tab_bar.h"
 #include "view.h"
 
+void
+tab_list_init(struct cg_server *server)
+{
+	wl_list_init(&server->tabs);
+	wl_list_init(&server->tabs_mru);
+	for (int i = 0; i < TAB_ID_BUCKETS; i++) {
+		wl_list_init(&server->tab_ids[i]);
+	}
+	server->tab_count = 0;
+	server->last_tab_id = 0;
+	server->tab_order = NULL;
+	server->foreground_tabs = NULL;
+	server->foreground_tab_count = 0;
+	server->tab_order_capacity = 0;
+	server->tab_order_dirty = true;
+}
+
+void
+tab_list_finish(struct cg_server *server)
+{
+	free(server->tab_order);
+	free(server->foreground_tabs);
+	server->tab_order = NULL;
+	server->foreground_tabs = NULL;
+	server->tab_order_capacity = 0;
+	server->tab_order_dirty = true;
+}
+
+void
+tab_add(struct cg_tab *tab)
+{
+	struct cg_server *server = tab->server;
+
+	tab->id = ++server->last_tab_id;
+	wl_list_insert(server->tabs.prev, &tab->link);
+	wl_list_insert(server->tabs_mru.prev, &tab->mru_link);
+	wl_list_insert(&server->tab_ids[tab->id % TAB_ID_BUCKETS], &tab->id_link);
+	server->tab_count++;
+	server->tab_order_dirty = true;
+}
+
+void
+tab_remove(struct cg_tab *tab)
+{
+	struct cg_server *server = tab->server;
+
+	wl_list_remove(&tab->link);
+	wl_list_remove(&tab->mru_link);
+	wl_list_remove(&tab->id_link);
+	if (tab->output && tab->output->active_tab == tab) {
+		tab->output->active_tab = NULL;
+	}
+	tab_bar_tab_removed(server, tab);
+	server->tab_count--;
+	server->tab_order_dirty = true;
+}
+
+bool
+tab_order_update(struct cg_server *server)
+{
+	if (!server->tab_order_dirty) {
+		return true;
+	}
+
+	if (server->tab_count > server->tab_order_capacity) {
+		int capacity = server->tab_order_capacity > 0 ? server->tab_order_capacity : 16;
+		while (capacity < server->tab_count) {
+			capacity *= 2;
+		}
+		struct cg_tab **order = realloc(server->tab_order, capacity * sizeof(*order));
+		if (!order) {
+			wlr_log(WLR_ERROR, "Failed to allocate tab order");
+			return false;
+		}
+		server->tab_order = order;
+		struct cg_tab **foreground = realloc(server->foreground_tabs, capacity * sizeof(*foreground));
+		if (!foreground) {
+			wlr_log(WLR_ERROR, "Failed to allocate tab order");
+			return false;
+		}
+		server->foreground_tabs = foreground;
+		server->tab_order_capacity = capacity;
+	}
+
+	int index = 0;
+	int foreground_index = 0;
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs, link) {
+		tab->index = index;
+		server->tab_order[index++] = tab;
+		if (tab->is_background) {
+			tab->foreground_index = -1;
+		} else {
+			tab->foreground_index = foreground_index;
+			server->foreground_tabs[foreground_index++] = tab;
+		}
+	}
+	server->foreground_tab_count = foreground_index;
+	server->tab_order_dirty = false;
+	return true;
+}
+
+struct cg_tab *
+tab_at(struct cg_server *server, int index)
+{
+	if (index < 0 || index >= server->tab_count || !tab_order_update(server)) {
+		return NULL;
+	}
+	return server->tab_order[index];
+}
+
+struct cg_tab *
+tab_foreground_at(struct cg_server *server, int index)
+{
+	if (index < 0 || !tab_order_update(server) || index >= server->foreground_tab_count) {
+		return NULL;
+	}
+	return server->foreground_tabs[index];
+}
+
+struct cg_tab *
+tab_output_foreground_at(struct cg_server *server, struct cg_output *output, int index)
+{
+	if (!output) {
+		return tab_foreground_at(server, index);
+	}
+	if (index < 0 || !tab_order_update(server)) {
+		return NULL;
+	}
+
+	for (int i = 0; i < server->foreground_tab_count; i++) {
+		struct cg_tab *tab = server->foreground_tabs[i];
+		if (tab->output == output && index-- == 0) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+struct cg_tab *
+tab_output_last(struct cg_server *server, struct cg_output *output)
+{
+	struct cg_tab *tab;
+	wl_list_for_each_reverse(tab, &server->tabs, link) {
+		if (!output || tab->output == output) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+/* The most recently active foreground tab on an output, other than its
+ * shown one */
+static struct cg_tab *
+output_last_used(struct cg_server *server, struct cg_output *output, struct cg_tab *shown)
+{
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs_mru, mru_link) {
+		if (tab != shown && !tab->is_background && tab->output == output) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+struct cg_tab *
+tab_last_used(struct cg_server *server)
+{
+	/* With separate outputs, only the focused output's tabs */
+	struct cg_tab *active = server->active_tab;
+	if (active && active->output) {
+		return output_last_used(server, active->output, active);
+	}
+
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs_mru, mru_link) {
+		if (tab != active && !tab->is_background) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+int
+tab_index(struct cg_tab *tab)
+{
+	if (!tab_order_update(tab->server)) {
+		return -1;
+	}
+	return tab->index;
+}
+
+void
+tab_move_before(struct cg_tab *tab, struct cg_tab *before)
+{
+	struct cg_server *server = tab->server;
+	if (tab == before) {
+		return;
+	}
+
+	wl_list_remove(&tab->link);
+	wl_list_insert(before ? before->link.prev : server->tabs.prev, &tab->link);
+	server->tab_order_dirty = true;
+
+	struct cg_tab_bar *tab_bar = tab_get_tab_bar(tab);
+	if (tab_bar) {
+		tab_bar_schedule_update(tab_bar);
+	}
+}
+
+/* The tab offset places from a tab among those of its output, counting
+ * only foreground tabs for a foreground tab, as tab_move() does */
+static struct cg_tab *
+output_neighbour(struct cg_tab *tab, int offset)
+{
+	struct cg_server *server = tab->server;
+	struct wl_list *link = &tab->link;
+	while (offset != 0) {
+		link = offset > 0 ? link->next : link->prev;
+		if (link == &server->tabs) {
+			return NULL;
+		}
+		struct cg_tab *other = wl_container_of(link, other, link);
+		if (other->output == tab->output && (tab->is_background || !other->is_background)) {
+			offset += offset > 0 ? -1 : 1;
+		}
+	}
+	struct cg_tab *neighbour = wl_container_of(link, neighbour, link);
+	return neighbour;
+}
+
+bool
+tab_move(struct cg_tab *tab, int offset)
+{
+	struct cg_server *server = tab->server;
+	if (offset == 0 || !tab_order_update(server)) {
+		return false;
+	}
+
+	struct cg_tab *target;
+	if (tab->output) {
+		target = output_neighbour(tab, offset);
+	} else {
+		target = tab->is_background ? tab_at(server, tab->index + offset)
+					    : tab_foreground_at(server, tab->foreground_index + offset);
+	}
+	if (!target) {
+		return false;
+	}
+
+	/* Moving right goes after the target */
+	struct cg_tab *before = target;
+	if (offset > 0) {
+		before = target->link.next != &server->tabs ? wl_container_of(target->link.next, before, link) : NULL;
+	}
+	tab_move_before(tab, before);
+	wl_signal_emit_mutable(&server->events.tab_move, tab);
+	return true;
+}
+
+struct cg_tab *
+tab_from_id(struct cg_server *server, uint32_t id)
+{
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tab_ids[id % TAB_ID_BUCKETS], id_link) {
+		if (tab->id == id) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
 struct cg_tab *
 tab_create(struct cg_server *server, struct cg_view *view)
 {
@@ -32,9 +306,14 @@ tab_create(struct cg_server *server, struct cg_view *view)
 	tab->view = view;
 	tab->is_visible = false;
 
+	/* With separate outputs, new tabs open on the focused one */
+	if (server->output_mode == WAYMUX_MULTI_OUTPUT_MODE_SEPARATE) {
+		tab->output = output_focused(server);
+	}
+
 	/* Create a scene tree for this tab to control visibility */
 	/* Note: server->scene is a wlr_scene, which has a built-in tree */
-	tab->scene_tree = wlr_scene_tree_create(&server->scene->tree);
+	tab->scene_tree = wlr_scene_tree_create(server->tabs_tree);
 	if (!tab->scene_tree) {
 		wlr_log(WLR_ERROR, "Failed to create tab scene tree");
 		free(tab);
@@ -45,14 +324,15 @@ tab_create(struct cg_server *server, struct cg_view *view)
 	wlr_scene_node_set_enabled(&tab->scene_tree->node, false);
 
 	/* Add to server's tab list (append to end) */
-	wl_list_insert(server->tabs.prev, &tab->link);
+	tab_add(tab);
 
 	/* Update tab bar to show new tab */
-	if (server->tab_bar) {
-		tab_bar_update(server->tab_bar);
+	struct cg_tab_bar *tab_bar = tab_get_tab_bar(tab);
+	if (tab_bar) {
+		tab_bar_schedule_update(tab_bar);
 	}
 
-	wlr_log(WLR_DEBUG, "Created tab for view %p", (void *)view);
+	wlr_log(WLR_DEBUG, "Created tab %u for view %p", tab->id, (void *)view);
 	return tab;
 }
 
@@ -64,10 +344,12 @@ tab_destroy(struct cg_tab *tab)
 	}
 
 	struct cg_server *server = tab->server;
+	wl_signal_emit_mutable(&server->events.tab_unmap, tab);
 
-	/* Update tab bar before removing tab */
-	if (server->tab_bar) {
-		tab_bar_update(server->tab_bar);
+	/* Schedule a tab bar update for the removal */
+	struct cg_tab_bar *tab_bar = tab_get_tab_bar(tab);
+	if (tab_bar) {
+		tab_bar_schedule_update(tab_bar);
 	}
 
 	/* If this is the active tab, clear it */
@@ -76,7 +358,7 @@ tab_destroy(struct cg_tab *tab)
 	}
 
 	/* Remove from list before closing view */
-	wl_list_remove(&tab->link);
+	tab_remove(tab);
 
 	/* Close the view and clear its reference to this tab.
 	 * The tab will be freed later by view_unmap. */
@@ -96,51 +378,185 @@ tab_destroy(struct cg_tab *tab)
 	}
 
 	wlr_log(WLR_DEBUG, "Destroyed tab");
+	free(tab->title);
 	free(tab);
 }
 
-void
-tab_activate(struct cg_tab *tab)
+/* Hide a tab that is no longer shown on its output */
+static void
+tab_hide(struct cg_tab *tab)
 {
-	if (!tab) {
-		return;
+	tab->is_visible = false;
+	if (tab->scene_tree) {
+		wlr_scene_node_set_enabled(&tab->scene_tree->node, false);
 	}
+	if (tab->view) {
+		view_activate(tab->view, false);
+	}
+}
 
+/* Show a tab in place of the one shown on its output, and give it the
+ * focus if focus is set or there are no separate outputs */
+static void
+tab_present(struct cg_tab *tab, bool focus)
+{
 	struct cg_server *server = tab->server;
+	focus = focus || !tab->output;
+	struct cg_tab **shown = tab->output ? &tab->output->active_tab : &server->active_tab;
+	struct cg_tab *old_tab = *shown;
+	struct cg_tab *old_focus = server->active_tab;
+	if (focus && old_focus != tab) {
+		clock_gettime(CLOCK_MONOTONIC, &server->tab_switch_started);
+	}
 
 	/* Deactivate previously active tab */
-	if (server->active_tab && server->active_tab != tab) {
-		struct cg_tab *old_tab = server->active_tab;
-		old_tab->is_visible = false;
-		if (old_tab->scene_tree) {
-			wlr_scene_node_set_enabled(&old_tab->scene_tree->node, false);
-		}
-		if (old_tab->view) {
-			view_activate(old_tab->view, false);
-		}
+	if (old_tab && old_tab != tab) {
+		tab_hide(old_tab);
+	}
+
+	/* The focused tab of another output stays shown there */
+	if (focus && old_focus && old_focus != tab && old_focus != old_tab && old_focus->view) {
+		view_activate(old_focus->view, false);
 	}
 
 	/* Activate new tab */
 	tab->is_visible = true;
-	server->active_tab = tab;
+	*shown = tab;
+	if (focus) {
+		server->active_tab = tab;
+		wl_list_remove(&tab->mru_link);
+		wl_list_insert(&server->tabs_mru, &tab->mru_link);
+	}
 
+	/* Only one tab's tree is enabled at a time on each output, so their
+	 * stacking order doesn't matter and the tree isn't raised */
 	if (tab->scene_tree) {
 		wlr_scene_node_set_enabled(&tab->scene_tree->node, true);
-		/* Raise active tab to top of scene graph so it appears above other tabs */
-		wlr_scene_node_raise_to_top(&tab->scene_tree->node);
 	}
 
+	/* Hidden views get layout changes when shown; if their size is
+	 * unchanged, this only moves the scene node */
 	if (tab->view) {
-		view_activate(tab->view, true);
+		view_activate(tab->view, focus);
 		view_position(tab->view);
 	}
 
-	/* Update tab bar to reflect new active tab */
-	if (server->tab_bar) {
-		tab_bar_update(server->tab_bar);
+	/* Re-render only the two buttons whose active state changed */
+	struct cg_tab_bar *tab_bar = tab_get_tab_bar(tab);
+	if (tab_bar && old_tab != tab) {
+		tab_bar_active_changed(tab_bar, old_tab, tab);
 	}
 
-	wlr_log(WLR_DEBUG, "Activated tab %p", (void *)tab);
+	wl_signal_emit_mutable(&server->events.tab_activate, tab);
+
+	wlr_log(WLR_DEBUG, "%s tab %p", focus ? "Activated" : "Showed", (void *)tab);
+}
+
+void
+tab_activate(struct cg_tab *tab)
+{
+	if (!tab) {
+		return;
+	}
+	tab_present(tab, true);
+}
+
+void
+tab_show(struct cg_tab *tab)
+{
+	if (!tab) {
+		return;
+	}
+	tab_present(tab, false);
+}
+
+bool
+tab_is_shown(struct cg_tab *tab)
+{
+	return tab == tab->server->active_tab || (tab->output && tab->output->active_tab == tab);
+}
+
+struct cg_tab_bar *
+tab_get_tab_bar(struct cg_tab *tab)
+{
+	return tab->output ? tab->output->tab_bar : tab->server->tab_bar;
+}
+
+/* Move a tab to an output, or to none, scheduling updates of the tab bars
+ * it leaves and joins */
+static void
+tab_place(struct cg_tab *tab, struct cg_output *output)
+{
+	struct cg_tab_bar *old_bar = tab_get_tab_bar(tab);
+	if (old_bar) {
+		tab_bar_schedule_update(old_bar);
+	}
+	tab->output = output;
+	struct cg_tab_bar *new_bar = tab_get_tab_bar(tab);
+	if (new_bar && new_bar != old_bar) {
+		tab_bar_schedule_update(new_bar);
+	}
+}
+
+void
+tab_set_output(struct cg_tab *tab, struct cg_output *output)
+{
+	struct cg_output *old = tab->output;
+	if (old == output) {
+		return;
+	}
+
+	struct cg_server *server = tab->server;
+	bool focused = server->active_tab == tab;
+	bool shown = old && old->active_tab == tab;
+	if (shown) {
+		old->active_tab = NULL;
+		if (!focused) {
+			tab_hide(tab);
+		}
+	}
+
+	tab_place(tab, output);
+	if (focused) {
+		tab_present(tab, true);
+	} else if (output && !output->active_tab && !tab->is_background) {
+		tab_present(tab, false);
+	}
+
+	if (shown) {
+		struct cg_tab *next = output_last_used(server, old, NULL);
+		if (next) {
+			tab_present(next, false);
+		}
+	}
+	wl_signal_emit_mutable(&server->events.tab_move, tab);
+}
+
+void
+tab_move_output_tabs(struct cg_server *server, struct cg_output *from, struct cg_output *to)
+{
+	struct cg_tab *shown = from->active_tab;
+	from->active_tab = NULL;
+	if (shown && shown != server->active_tab) {
+		tab_hide(shown);
+	}
+
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (tab->output == from) {
+			tab_place(tab, to);
+		}
+	}
+
+	/* The focus stays with its tab, now on the other output */
+	if (shown && shown == server->active_tab && to) {
+		tab_present(shown, true);
+	} else if (to && !to->active_tab) {
+		struct cg_tab *next = output_last_used(server, to, NULL);
+		if (next) {
+			tab_present(next, false);
+		}
+	}
 }
 
 void
@@ -156,12 +572,15 @@ tab_set_background(struct cg_tab *tab, bool background)
 	}
 
 	tab->is_background = background;
+	tab->server->tab_order_dirty = true;
 
 	/* Update tab bar to reflect the change */
 	struct cg_server *server = tab->server;
-	if (server->tab_bar) {
-		tab_bar_update(server->tab_bar);
+	struct cg_tab_bar *tab_bar = tab_get_tab_bar(tab);
+	if (tab_bar) {
+		tab_bar_schedule_update(tab_bar);
 	}
+	wl_signal_emit_mutable(&server->events.tab_background, tab);
 
 	wlr_log(WLR_DEBUG, "Tab %p is now %sground", (void *)tab,
 		background ? "back" : "fore");
@@ -186,8 +605,8 @@ tab_next(struct cg_tab *current)
 		next = wl_container_of(server->tabs.next, next, link);
 	}
 
-	/* Skip background tabs */
-	while (next && next->is_background && next != start) {
+	/* Skip background tabs, and those of other outputs */
+	while (next && (next->is_background || next->output != start->output) && next != start) {
 		if (next->link.next != &server->tabs) {
 			next = wl_container_of(next->link.next, next, link);
 		} else {
@@ -197,7 +616,7 @@ tab_next(struct cg_tab *current)
 	}
 
 	/* If we couldn't find a non-background tab (wrapped around to background only), return current */
-	if (next && next->is_background) {
+	if (next && (next->is_background || next->output != start->output)) {
 		return current;
 	}
 
@@ -223,8 +642,8 @@ tab_prev(struct cg_tab *current)
 		prev = wl_container_of(server->tabs.prev, prev, link);
 	}
 
-	/* Skip background tabs */
-	while (prev && prev->is_background && prev != start) {
+	/* Skip background tabs, and those of other outputs */
+	while (prev && (prev->is_background || prev->output != start->output) && prev != start) {
 		if (prev->link.prev != &server->tabs) {
 			prev = wl_container_of(prev->link.prev, prev, link);
 		} else {
@@ -234,7 +653,7 @@ tab_prev(struct cg_tab *current)
 	}
 
 	/* If we wrapped around to the start, return start if it's not background */
-	if (prev && prev->is_background) {
+	if (prev && (prev->is_background || prev->output != start->output)) {
 		return current;
 	}
 
@@ -244,11 +663,6 @@ tab_prev(struct cg_tab *current)
 int
 tab_count(struct cg_server *server)
 {
-	int count = 0;
-	struct cg_tab *tab;
-	wl_list_for_each(tab, &server->tabs, link) {
-		count++;
-	}
-	return count;
+	return server->tab_count;
 }
 
@@ -4,9 +4,12 @@
 #include "config.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_scene.h>
 
+#include "resources.h"
 #include "view.h"
 
 struct cg_tab {
@@ -14,14 +17,102 @@ struct cg_tab {
 	struct cg_view *view;
 	struct wl_list link; // server::tabs
 
+	/* The output the tab is shown on with separate outputs, which keep
+	 * their own tabs within the server's tab list; NULL otherwise, or
+	 * until there is an output */
+	struct cg_output *output;
+
+	/* Unique for the whole session and never reused, unlike the tab's
+	 * position, which shifts as tabs close */
+	uint32_t id;
+	struct wl_list id_link; // server::tab_ids
+
 	/* Tab state */
 	bool is_visible;
 	bool is_background;  /* If true, tab is hidden from tab bar */
 
+	/* When the view was mapped, until the stats record the tab's first
+	 * frame; always 0 without stats */
+	uint64_t map_time_ns;
+
+	/* The profile launch the tab was started by, if any, and its place in
+	 * the profile */
+	uint32_t profile_launch;
+	int profile_position;
+
+	/* Visibility policy state, see visibility.h */
+	bool suspended;
+	bool stopped;
+	struct timespec parked_since; /* When the tab was last hidden in the background, or zero */
+
+	/* What the tab's client used when last asked, see resources.h */
+	struct cg_tab_usage usage;
+
+	struct wl_list mru_link; // cg_server::tabs_mru
+
+	/* Positions in the server's tab order arrays; foreground_index is -1
+	 * for background tabs. Only current after tab_order_update(). */
+	int index;
+	int foreground_index;
+
+	/* Shown instead of the view's title while the tab has no view, as
+	 * lazy profile tabs don't until started; owned by the tab */
+	char *title;
+
 	/* Scene node for controlling visibility */
 	struct wlr_scene_tree *scene_tree;
 };
 
+/* Initialize the server's tab list and ID table */
+void tab_list_init(struct cg_server *server);
+
+/* Give a tab the next ID and append it to its server's tab list */
+void tab_add(struct cg_tab *tab);
+
+/* Remove a tab from its server's tab list, and from the tab bars' hover
+ * and scroll state */
+void tab_remove(struct cg_tab *tab);
+
+/* Free the server's tab order arrays */
+void tab_list_finish(struct cg_server *server);
+
+/* Bring the tab order arrays and the tabs' indices up to date.
+ * Returns false if they couldn't be allocated. */
+bool tab_order_update(struct cg_server *server);
+
+/* The tab at position index of the tab list, or NULL */
+struct cg_tab *tab_at(struct cg_server *server, int index);
+
+/* The tab at position index of the foreground tabs, as shown in the tab
+ * bar, or NULL */
+struct cg_tab *tab_foreground_at(struct cg_server *server, int index);
+
+/* The same among the foreground tabs of an output, as shown in its own tab
+ * bar; among all foreground tabs if output is NULL */
+struct cg_tab *tab_output_foreground_at(struct cg_server *server, struct cg_output *output, int index);
+
+/* The last tab of the tab list on an output, or of all if output is NULL */
+struct cg_tab *tab_output_last(struct cg_server *server, struct cg_output *output);
+
+/* The most recently active foreground tab other than the active one, or
+ * NULL. Tabs that were never active come last, in tab list order. */
+struct cg_tab *tab_last_used(struct cg_server *server);
+
+/* A tab's position in the tab list, or -1 */
+int tab_index(struct cg_tab *tab);
+
+/* Move a tab before another in the tab list, or to its end if before is
+ * NULL, without a tab_move event; for tabs being placed as they map */
+void tab_move_before(struct cg_tab *tab, struct cg_tab *before);
+
+/* Move a tab offset places left (negative) or right among the foreground
+ * tabs, or among all tabs if it is a background tab. Returns false if
+ * there is no room to move it that far. */
+bool tab_move(struct cg_tab *tab, int offset);
+
+/* Find a tab by ID, or NULL if no such tab is open */
+struct cg_tab *tab_from_id(struct cg_server *server, uint32_t id);
+
 /* Create a new tab from a view */
 struct cg_tab *tab_create(struct cg_server *server, struct cg_view *view);
 
@@ -31,6 +122,26 @@ void tab_destroy(struct cg_tab *tab);
 /* Set tab as active and visible */
 void tab_activate(struct cg_tab *tab);
 
+/* Show a tab on its output in place of the tab shown there, leaving the
+ * focus on another output's tab if it has it. The same as tab_activate()
+ * without separate outputs. */
+void tab_show(struct cg_tab *tab);
+
+/* Whether a tab is shown: the active tab, or another output's */
+bool tab_is_shown(struct cg_tab *tab);
+
+/* The tab bar a tab's button is on, NULL if there is none */
+struct cg_tab_bar *tab_get_tab_bar(struct cg_tab *tab);
+
+/* Move a tab to another output. It takes the focus along if it has it, and
+ * is shown there if nothing is; the output it leaves shows its most
+ * recently active tab instead. */
+void tab_set_output(struct cg_tab *tab, struct cg_output *output);
+
+/* Move every tab of an output that goes away to another, NULL if there is
+ * none; only the tab with the focus is shown there in place of its own */
+void tab_move_output_tabs(struct cg_server *server, struct cg_output *from, struct cg_output *to);
+
 /* Set tab as background (hidden from tab bar) or foreground (visible in tab bar) */
 void tab_set_background(struct cg_tab *tab, bool background);
 
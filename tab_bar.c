@@ -1,11 +1,15 @@
 #include "tab_bar.h"
 
+#include "font.h"
 #include "output.h"
 #include "pixel_buffer.h"
 #include "server.h"
+#include "stats.h"
 #include "tab.h"
+#include "trace.h"
 #include "view.h"
 #include "launcher.h"
+#include "waymux_config.h"
 
 #include <linux/input-event-codes.h>
 #include <stdlib.h>
@@ -32,6 +36,8 @@ tab_bar_color_active[] = {0.26f, 0.28f, 0.32f, 1.0f};  /* Lighter gray for activ
 static float
 tab_bar_color_inactive[] = {0.18f, 0.19f, 0.21f, 1.0f};  /* Darker gray for inactive */
 static float
+tab_bar_color_hover[] = {0.22f, 0.23f, 0.26f, 1.0f};  /* Inactive under the pointer */
+static float
 tab_bar_color_border[] = {0.0f, 0.0f, 0.0f, 1.0f};  /* Black borders */
 static float
 tab_bar_color_text_inactive[] = {0.7f, 0.7f, 0.7f, 1.0f};  /* Gray text for inactive */
@@ -43,9 +49,24 @@ tab_bar_color_new_tab_bg[] = {0.15f, 0.16f, 0.18f, 1.0f};  /* New tab button */
 #define TAB_TEXT_PADDING_SIDES 16
 #define TAB_TEXT_TOP_OFFSET 10
 #define TAB_FONT_SIZE 11
-#define TAB_ELLIPSIS "..."
 #define TAB_CLOSE_BUTTON_SIZE 16
 #define TAB_CLOSE_BUTTON_PADDING 4
+/* The scene renderer draws text in the active color, and dims it for
+ * inactive tabs to roughly the inactive color */
+#define TAB_TEXT_INACTIVE_OPACITY 0.7f
+/* Pixels scrolled per unit of pointer axis motion */
+#define TAB_SCROLL_SPEED 3
+/* Pixels the pointer moves with a tab pressed before it is dragged */
+#define TAB_DRAG_THRESHOLD 4
+
+static float *
+button_color(bool is_active, bool is_hovered)
+{
+	if (is_active) {
+		return tab_bar_color_active;
+	}
+	return is_hovered ? tab_bar_color_hover : tab_bar_color_inactive;
+}
 
 /* Draw a rounded rectangle path */
 static void
@@ -71,104 +92,141 @@ draw_rounded_rect(cairo_t *cr, double x, double y, double width, double height,
 	cairo_close_path(cr);
 }
 
-/* Calculate text width with proper font metrics */
-static double
-get_text_width(cairo_t *cr, const char *text)
+/* Calculate tab width based on text content */
+static int
+calculate_tab_width(struct cg_font *font, const char *text)
 {
-	cairo_text_extents_t extents;
-	cairo_text_extents(cr, text, &extents);
-	return extents.width;
+	double text_width = font_text_width(font, text);
+	int width = (int)ceil(text_width + TAB_TEXT_PADDING_SIDES * 2);
+
+	if (width < TAB_BUTTON_MIN_WIDTH) {
+		return TAB_BUTTON_MIN_WIDTH;
+	}
+	if (width > TAB_BUTTON_MAX_WIDTH) {
+		return TAB_BUTTON_MAX_WIDTH;
+	}
+	return width;
 }
 
-/* Truncate text to fit width with ellipsis */
+/* Draw a tab's text, truncated to leave room for the close button */
 static void
-truncate_text_to_width(char *dest, size_t dest_size, cairo_t *cr,
-		       const char *text, double max_width)
+draw_tab_text(cairo_t *cr, struct cg_font *font, const char *text, int width, const float color[4],
+	      bool show_close)
 {
-	if (get_text_width(cr, text) <= max_width) {
-		snprintf(dest, dest_size, "%s", text);
+	if (!text || strlen(text) == 0) {
 		return;
 	}
 
-	/* Binary search for best truncation point */
-	size_t len = strlen(text);
-	size_t left = 0;
-	size_t right = len;
-	size_t best = 0;
+	font_apply(font, cr);
+	cairo_set_source_rgba(cr, color[0], color[1], color[2], color[3]);
 
-	char buf[512];
-	const char *ellipsis = TAB_ELLIPSIS;
+	/* Truncate text to fit available space */
+	char truncated[512];
+	double available_width = width - TAB_TEXT_PADDING_SIDES * 2;
+	if (show_close) {
+		available_width -= TAB_CLOSE_BUTTON_SIZE + TAB_CLOSE_BUTTON_PADDING;
+	}
+	font_truncate_to_width(font, text, available_width, truncated, sizeof(truncated));
 
-	while (left < right) {
-		size_t mid = (left + right + 1) / 2;
-		snprintf(buf, sizeof(buf), "%.*s%s", (int)mid, text, ellipsis);
+	/* Position text */
+	cairo_text_extents_t extents;
+	font_text_extents(font, truncated, &extents);
 
-		if (get_text_width(cr, buf) <= max_width) {
-			best = mid;
-			left = mid;
-		} else {
-			right = mid - 1;
-		}
-	}
+	double x = TAB_TEXT_PADDING_SIDES - extents.x_bearing;
+	double y = TAB_TEXT_TOP_OFFSET - extents.y_bearing;
 
-	if (best > 0) {
-		snprintf(dest, dest_size, "%.*s%s", (int)best, text, ellipsis);
-	} else {
-		/* Even with ellipsis only, it's too long - truncate ellipsis itself */
-		snprintf(dest, dest_size, "..");
-	}
+	cairo_move_to(cr, x, y);
+	cairo_show_text(cr, truncated);
 }
 
-/* Calculate tab width based on text content */
-static int
-calculate_tab_width(cairo_t *cr, const char *text)
+/* Draw the close button (X) with its top left corner at x, y */
+static void
+draw_close_button(cairo_t *cr, double close_x, double close_y)
 {
-	double text_width = get_text_width(cr, text);
-	int width = (int)ceil(text_width + TAB_TEXT_PADDING_SIDES * 2);
+	/* Draw subtle background for close button on hover area */
+	cairo_set_source_rgba(cr, 1, 1, 1, 0.1);
+	draw_rounded_rect(cr, close_x, close_y, TAB_CLOSE_BUTTON_SIZE,
+			 TAB_CLOSE_BUTTON_SIZE, 3, false);
+	cairo_fill(cr);
 
-	if (width < TAB_BUTTON_MIN_WIDTH) {
-		return TAB_BUTTON_MIN_WIDTH;
-	}
-	if (width > TAB_BUTTON_MAX_WIDTH) {
-		return TAB_BUTTON_MAX_WIDTH;
-	}
-	return width;
+	/* Draw X */
+	cairo_set_source_rgba(cr, 0.8, 0.8, 0.8, 1.0);
+	cairo_set_line_width(cr, 1.5);
+
+	double center_x = close_x + TAB_CLOSE_BUTTON_SIZE / 2.0;
+	double center_y = close_y + TAB_CLOSE_BUTTON_SIZE / 2.0;
+	double offset = TAB_CLOSE_BUTTON_SIZE / 4.0;
+
+	cairo_move_to(cr, center_x - offset, center_y - offset);
+	cairo_line_to(cr, center_x + offset, center_y + offset);
+	cairo_move_to(cr, center_x + offset, center_y - offset);
+	cairo_line_to(cr, center_x - offset, center_y + offset);
+	cairo_stroke(cr);
 }
 
-/* Create a wlr_buffer with rendered browser-style tab */
-static struct wlr_buffer *
-create_tab_buffer(const char *text, int width, int height, bool is_active,
-		  bool show_close)
+/* Start drawing, in logical pixels, into a cleared pooled buffer of the
+ * given logical size at scale; returns NULL on failure */
+static cairo_t *
+begin_buffer(int width, int height, float scale, struct pixel_buffer **buffer_out)
 {
 	/* Allocate buffer data */
-	size_t stride = width * 4;
-	size_t size = height * stride;
-	uint32_t *data = calloc(1, size);
-	if (!data) {
+	int buffer_width = (int)ceil(width * scale);
+	int buffer_height = (int)ceil(height * scale);
+	size_t stride = buffer_width * 4;
+	struct pixel_buffer *buffer = pixel_buffer_acquire(buffer_width, buffer_height);
+	if (!buffer) {
 		return NULL;
 	}
 
 	/* Create cairo surface */
 	cairo_surface_t *surface = cairo_image_surface_create_for_data(
-		(unsigned char *)data, CAIRO_FORMAT_ARGB32, width, height, stride);
+		(unsigned char *)buffer->data, CAIRO_FORMAT_ARGB32, buffer_width, buffer_height, stride);
 	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
-		free(data);
+		wlr_buffer_drop(&buffer->base);
 		return NULL;
 	}
+	cairo_surface_set_device_scale(surface, scale, scale);
 
 	cairo_t *cr = cairo_create(surface);
-	if (!cr) {
-		cairo_surface_destroy(surface);
-		free(data);
+	cairo_surface_destroy(surface); /* cr holds a reference */
+	if (cairo_status(cr) != CAIRO_STATUS_SUCCESS) {
+		cairo_destroy(cr);
+		wlr_buffer_drop(&buffer->base);
 		return NULL;
 	}
 
-	/* Clear background */
-	cairo_set_source_rgba(cr, 0, 0, 0, 0);
+	/* Clear background; pooled buffers still hold their old pixels */
+	cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
 	cairo_paint(cr);
+	cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+	*buffer_out = buffer;
+	return cr;
+}
+
+static struct wlr_buffer *
+end_buffer(cairo_t *cr, struct pixel_buffer *buffer)
+{
+	cairo_surface_t *surface = cairo_get_target(cr);
+	cairo_surface_flush(surface);
+	cairo_surface_finish(surface);
+	cairo_destroy(cr);
+	return &buffer->base;
+}
+
+/* Create a wlr_buffer with rendered browser-style tab */
+static struct wlr_buffer *
+create_tab_buffer(struct cg_font *font, const char *text, int width, int height, float scale,
+		  bool is_active, bool is_hovered, bool show_close)
+{
+	struct pixel_buffer *buffer;
+	cairo_t *cr = begin_buffer(width, height, scale, &buffer);
+	if (!cr) {
+		return NULL;
+	}
 
 	/* Draw tab background with rounded top corners */
-	float *bg_color = is_active ? tab_bar_color_active : tab_bar_color_inactive;
+	float *bg_color = button_color(is_active, is_hovered);
 	cairo_set_source_rgba(cr, bg_color[0], bg_color[1], bg_color[2], bg_color[3]);
 
 	/* Inset by 1px on each side for border */
@@ -184,113 +242,57 @@ create_tab_buffer(const char *text, int width, int height, bool is_active,
 	draw_rounded_rect(cr, 0.5, 0.5, width - 1, height - 0.5, TAB_CORNER_RADIUS, true);
 	cairo_stroke(cr);
 
-	/* Draw text */
-	if (text && strlen(text) > 0) {
-		cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL,
-				      CAIRO_FONT_WEIGHT_NORMAL);
-		cairo_set_font_size(cr, TAB_FONT_SIZE);
-
-		float *text_color = is_active ? tab_bar_color_text_active :
-					tab_bar_color_text_inactive;
-		cairo_set_source_rgba(cr, text_color[0], text_color[1],
-				    text_color[2], text_color[3]);
-
-		/* Truncate text to fit available space */
-		char truncated[256];
-		double available_width = width - TAB_TEXT_PADDING_SIDES * 2;
-		if (show_close) {
-			available_width -= TAB_CLOSE_BUTTON_SIZE + TAB_CLOSE_BUTTON_PADDING;
-		}
-		truncate_text_to_width(truncated, sizeof(truncated), cr, text, available_width);
-
-		/* Position text */
-		cairo_text_extents_t extents;
-		cairo_text_extents(cr, truncated, &extents);
-
-		double x = TAB_TEXT_PADDING_SIDES - extents.x_bearing;
-		double y = TAB_TEXT_TOP_OFFSET - extents.y_bearing;
-
-		cairo_move_to(cr, x, y);
-		cairo_show_text(cr, truncated);
-	}
+	draw_tab_text(cr, font, text, width,
+		      is_active ? tab_bar_color_text_active : tab_bar_color_text_inactive, show_close);
 
-	/* Draw close button (X) */
 	if (show_close) {
-		double close_x = width - TAB_CLOSE_BUTTON_SIZE - TAB_CLOSE_BUTTON_PADDING;
-		double close_y = (height - TAB_CLOSE_BUTTON_SIZE) / 2.0;
-
-		/* Draw subtle background for close button on hover area */
-		cairo_set_source_rgba(cr, 1, 1, 1, 0.1);
-		draw_rounded_rect(cr, close_x, close_y, TAB_CLOSE_BUTTON_SIZE,
-				 TAB_CLOSE_BUTTON_SIZE, 3, false);
-		cairo_fill(cr);
-
-		/* Draw X */
-		cairo_set_source_rgba(cr, 0.8, 0.8, 0.8, 1.0);
-		cairo_set_line_width(cr, 1.5);
-
-		double center_x = close_x + TAB_CLOSE_BUTTON_SIZE / 2.0;
-		double center_y = close_y + TAB_CLOSE_BUTTON_SIZE / 2.0;
-		double offset = TAB_CLOSE_BUTTON_SIZE / 4.0;
-
-		cairo_move_to(cr, center_x - offset, center_y - offset);
-		cairo_line_to(cr, center_x + offset, center_y + offset);
-		cairo_move_to(cr, center_x + offset, center_y - offset);
-		cairo_line_to(cr, center_x - offset, center_y + offset);
-		cairo_stroke(cr);
+		draw_close_button(cr, width - TAB_CLOSE_BUTTON_SIZE - TAB_CLOSE_BUTTON_PADDING,
+				  (height - TAB_CLOSE_BUTTON_SIZE) / 2.0);
 	}
 
-	cairo_destroy(cr);
-	cairo_surface_finish(surface);
-	cairo_surface_destroy(surface);
+	return end_buffer(cr, buffer);
+}
 
-	/* Create wlr_buffer wrapper */
-	struct pixel_buffer *buffer = calloc(1, sizeof(*buffer));
-	if (!buffer) {
-		free(data);
+/* Create a wlr_buffer with only a tab's text, in the active text color on
+ * a transparent background, for the scene renderer */
+static struct wlr_buffer *
+create_tab_text_buffer(struct cg_font *font, const char *text, int width, int height, float scale)
+{
+	struct pixel_buffer *buffer;
+	cairo_t *cr = begin_buffer(width, height, scale, &buffer);
+	if (!cr) {
 		return NULL;
 	}
 
-	wlr_buffer_init(&buffer->base, &pixel_buffer_impl, width, height);
-	buffer->data = data;
-	buffer->width = width;
-	buffer->height = height;
-	buffer->size = size;
-
-	return &buffer->base;
+	draw_tab_text(cr, font, text, width, tab_bar_color_text_active, true);
+	return end_buffer(cr, buffer);
 }
 
-/* Create a wlr_buffer with new tab button (+) */
+/* Create a wlr_buffer with only the close button, shared by every button
+ * of the scene renderer */
 static struct wlr_buffer *
-create_new_tab_buffer(int width, int height)
+create_close_button_buffer(float scale)
 {
-	/* Allocate buffer data */
-	size_t stride = width * 4;
-	size_t size = height * stride;
-	uint32_t *data = calloc(1, size);
-	if (!data) {
+	struct pixel_buffer *buffer;
+	cairo_t *cr = begin_buffer(TAB_CLOSE_BUTTON_SIZE, TAB_CLOSE_BUTTON_SIZE, scale, &buffer);
+	if (!cr) {
 		return NULL;
 	}
 
-	/* Create cairo surface */
-	cairo_surface_t *surface = cairo_image_surface_create_for_data(
-		(unsigned char *)data, CAIRO_FORMAT_ARGB32, width, height, stride);
-	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
-		free(data);
-		return NULL;
-	}
+	draw_close_button(cr, 0, 0);
+	return end_buffer(cr, buffer);
+}
 
-	cairo_t *cr = cairo_create(surface);
+/* Create a wlr_buffer with new tab button (+) */
+static struct wlr_buffer *
+create_new_tab_buffer(int width, int height, float scale)
+{
+	struct pixel_buffer *buffer;
+	cairo_t *cr = begin_buffer(width, height, scale, &buffer);
 	if (!cr) {
-		cairo_surface_destroy(surface);
-		free(data);
 		return NULL;
 	}
 
-	/* Clear background */
-	cairo_set_source_rgba(cr, 0, 0, 0, 0);
-	cairo_paint(cr);
-
 	/* Draw rounded background */
 	cairo_set_source_rgba(cr, tab_bar_color_new_tab_bg[0],
 			     tab_bar_color_new_tab_bg[1],
@@ -322,28 +324,60 @@ create_new_tab_buffer(int width, int height)
 	cairo_line_to(cr, center_x, center_y + icon_size / 2);
 	cairo_stroke(cr);
 
-	cairo_destroy(cr);
-	cairo_surface_finish(surface);
-	cairo_surface_destroy(surface);
+	return end_buffer(cr, buffer);
+}
 
-	/* Create wlr_buffer wrapper */
-	struct pixel_buffer *buffer = calloc(1, sizeof(*buffer));
-	if (!buffer) {
-		free(data);
-		return NULL;
+/* The node positioning a button, NULL if it has not been rendered yet */
+static struct wlr_scene_node *
+button_node(struct cg_tab_bar_button *button)
+{
+	if (button->tree) {
+		return &button->tree->node;
+	}
+	return button->text_buffer ? &button->text_buffer->node : NULL;
+}
+
+static void
+place_button(struct cg_tab_bar_button *button, int x)
+{
+	struct wlr_scene_node *node = button_node(button);
+	if (node) {
+		wlr_scene_node_set_position(node, x, 0);
 	}
+}
 
-	wlr_buffer_init(&buffer->base, &pixel_buffer_impl, width, height);
-	buffer->data = data;
-	buffer->width = width;
-	buffer->height = height;
-	buffer->size = size;
+static void
+tab_bar_button_finish(struct cg_tab_bar_button *button)
+{
+	struct wlr_scene_node *node = button_node(button);
+	if (node) {
+		/* Destroys the scene renderer's rects and buffers with it */
+		wlr_scene_node_destroy(node);
+	}
+	free(button->text);
+	memset(button, 0, sizeof(*button));
+}
 
-	return &buffer->base;
+/* Drop what a button rendered, keeping its tab and extent so that clicks
+ * still hit it until the next update renders it again */
+static void
+button_drop_render(struct cg_tab_bar_button *button)
+{
+	struct wlr_scene_node *node = button_node(button);
+	if (node) {
+		wlr_scene_node_destroy(node);
+	}
+	free(button->text);
+	button->text = NULL;
+	button->tree = NULL;
+	button->border = NULL;
+	button->background = NULL;
+	button->close_buffer = NULL;
+	button->text_buffer = NULL;
 }
 
 struct cg_tab_bar *
-tab_bar_create(struct cg_server *server)
+tab_bar_create(struct cg_server *server, struct cg_output *output)
 {
 	struct cg_tab_bar *tab_bar = calloc(1, sizeof(struct cg_tab_bar));
 	if (!tab_bar) {
@@ -352,12 +386,23 @@ tab_bar_create(struct cg_server *server)
 	}
 
 	tab_bar->server = server;
+	tab_bar->output = output;
 	tab_bar->height = TAB_BAR_HEIGHT;
+	tab_bar->scale = output_ui_scale(server, output);
+	tab_bar->scene_renderer = server->config &&
+		server->config->tab_bar_renderer == WAYMUX_TAB_BAR_RENDERER_SCENE;
+
+	tab_bar->font = font_create("sans-serif", TAB_FONT_SIZE);
+	if (!tab_bar->font) {
+		free(tab_bar);
+		return NULL;
+	}
 
 	/* Create scene tree for tab bar */
 	tab_bar->scene_tree = wlr_scene_tree_create(&server->scene->tree);
 	if (!tab_bar->scene_tree) {
 		wlr_log(WLR_ERROR, "Failed to create tab bar scene tree");
+		font_destroy(tab_bar->font);
 		free(tab_bar);
 		return NULL;
 	}
@@ -368,28 +413,70 @@ tab_bar_create(struct cg_server *server)
 	if (!tab_bar->background) {
 		wlr_log(WLR_ERROR, "Failed to create tab bar background");
 		wlr_scene_node_destroy(&tab_bar->scene_tree->node);
+		font_destroy(tab_bar->font);
 		free(tab_bar);
 		return NULL;
 	}
 
+	/* Buttons go above the background and below the new tab button */
+	tab_bar->buttons_tree = wlr_scene_tree_create(tab_bar->scene_tree);
+	if (!tab_bar->buttons_tree) {
+		wlr_log(WLR_ERROR, "Failed to create tab bar buttons tree");
+		wlr_scene_node_destroy(&tab_bar->scene_tree->node);
+		font_destroy(tab_bar->font);
+		free(tab_bar);
+		return NULL;
+	}
+	tab_bar->drag_index = -1;
+
+	if (tab_bar->scene_renderer) {
+		tab_bar->close_icon = create_close_button_buffer(tab_bar->scale);
+		if (!tab_bar->close_icon) {
+			wlr_log(WLR_ERROR, "Failed to render the close button, using the cairo tab bar renderer");
+			tab_bar->scene_renderer = false;
+		}
+	}
+
 	/* Create new tab button (background + text will be in buffer) */
 	tab_bar->new_tab_button.background = NULL;
 	tab_bar->new_tab_button.text_buffer = NULL;
 
-	/* Initialize tab buttons */
-	for (int i = 0; i < TAB_BAR_MAX_TABS; i++) {
-		tab_bar->tabs[i].background = NULL;
-		tab_bar->tabs[i].text_buffer = NULL;
-		tab_bar->tabs[i].width = TAB_BUTTON_MIN_WIDTH;
-	}
+	/* Tab buttons are allocated by tab_bar_update() */
+	tab_bar->tabs = NULL;
+	tab_bar->tab_count = 0;
 
 	/* Initially hide tab bar until we have tabs */
 	wlr_scene_node_set_enabled(&tab_bar->scene_tree->node, false);
 
-	wlr_log(WLR_DEBUG, "Created tab bar");
+	wlr_log(WLR_DEBUG, "Created tab bar%s%s", output ? " for output " : "", output ? output->wlr_output->name : "");
 	return tab_bar;
 }
 
+void
+tab_bar_set_renderer(struct cg_tab_bar *tab_bar, bool scene)
+{
+	if (tab_bar->scene_renderer == scene) {
+		return;
+	}
+
+	if (scene && !tab_bar->close_icon) {
+		tab_bar->close_icon = create_close_button_buffer(tab_bar->scale);
+		if (!tab_bar->close_icon) {
+			wlr_log(WLR_ERROR, "Failed to render the close button, keeping the cairo tab bar renderer");
+			return;
+		}
+	}
+
+	/* The renderers build buttons differently, so none can be reused */
+	for (int i = 0; i < tab_bar->tab_count; i++) {
+		button_drop_render(&tab_bar->tabs[i]);
+	}
+	tab_bar->scene_renderer = scene;
+	tab_bar_schedule_update(tab_bar);
+
+	wlr_log(WLR_DEBUG, "Switched to the %s tab bar renderer", scene ? "scene" : "cairo");
+}
+
 void
 tab_bar_destroy(struct cg_tab_bar *tab_bar)
 {
@@ -398,12 +485,11 @@ tab_bar_destroy(struct cg_tab_bar *tab_bar)
 	}
 
 	/* Clean up old tab buttons */
-	for (int i = 0; i < TAB_BAR_MAX_TABS; i++) {
-		if (tab_bar->tabs[i].text_buffer) {
-			wlr_scene_node_destroy(&tab_bar->tabs[i].text_buffer->node);
-			tab_bar->tabs[i].text_buffer = NULL;
-		}
+	for (int i = 0; i < tab_bar->tab_count; i++) {
+		tab_bar_button_finish(&tab_bar->tabs[i]);
 	}
+	free(tab_bar->tabs);
+	tab_bar->tabs = NULL;
 
 	if (tab_bar->new_tab_button.text_buffer) {
 		wlr_scene_node_destroy(&tab_bar->new_tab_button.text_buffer->node);
@@ -415,26 +501,92 @@ tab_bar_destroy(struct cg_tab_bar *tab_bar)
 		wlr_scene_node_destroy(&tab_bar->scene_tree->node);
 	}
 
+	if (tab_bar->close_icon) {
+		wlr_buffer_drop(tab_bar->close_icon);
+	}
+
+	font_destroy(tab_bar->font);
 	free(tab_bar);
 	wlr_log(WLR_DEBUG, "Destroyed tab bar");
 }
 
+/* Width left for the tab buttons, next to the new tab button */
+static int
+visible_width(struct cg_tab_bar *tab_bar)
+{
+	return tab_bar->width - TAB_NEW_TAB_BUTTON_WIDTH - TAB_BAR_PADDING;
+}
+
+/* Scrolling moves only the tree holding the buttons */
+static void
+tab_bar_set_scroll(struct cg_tab_bar *tab_bar, int scroll_x)
+{
+	int max_scroll = tab_bar->content_width - visible_width(tab_bar);
+	if (scroll_x > max_scroll) {
+		scroll_x = max_scroll;
+	}
+	if (scroll_x < 0) {
+		scroll_x = 0;
+	}
+	tab_bar->scroll_x = scroll_x;
+	wlr_scene_node_set_position(&tab_bar->buttons_tree->node, -scroll_x, 0);
+}
+
+/* The tab shown as active: the one shown on the bar's output */
+static struct cg_tab *
+tab_bar_active_tab(struct cg_tab_bar *tab_bar)
+{
+	return tab_bar->output ? tab_bar->output->active_tab : tab_bar->server->active_tab;
+}
+
+/* Scroll the active tab's button into view once after it was activated,
+ * but not while a button is pressed, which activated it */
+static void
+scroll_to_active(struct cg_tab_bar *tab_bar)
+{
+	struct cg_tab *active = tab_bar_active_tab(tab_bar);
+	if (active == tab_bar->scrolled_to || tab_bar->drag_index >= 0) {
+		return;
+	}
+	tab_bar->scrolled_to = active;
+
+	for (int i = 0; i < tab_bar->tab_count; i++) {
+		struct cg_tab_bar_button *button = &tab_bar->tabs[i];
+		if (button->tab != active) {
+			continue;
+		}
+
+		int scroll_x = tab_bar->scroll_x;
+		if (button->x < scroll_x) {
+			scroll_x = button->x;
+		} else if (button->x + button->width > scroll_x + visible_width(tab_bar)) {
+			scroll_x = button->x + button->width - visible_width(tab_bar);
+		}
+		tab_bar_set_scroll(tab_bar, scroll_x);
+		return;
+	}
+}
+
 static void
 tab_bar_update_layout(struct cg_tab_bar *tab_bar)
 {
 	struct cg_server *server = tab_bar->server;
 	struct wlr_box layout_box;
 
-	/* Get the overall output layout dimensions */
-	wlr_output_layout_get_box(server->output_layout, NULL, &layout_box);
+	/* Get the dimensions of the bar's output, or of the overall
+	 * output layout */
+	wlr_output_layout_get_box(server->output_layout, tab_bar->output ? tab_bar->output->wlr_output : NULL,
+				  &layout_box);
 
 	/* Update dimensions */
 	tab_bar->width = layout_box.width;
 	wlr_scene_rect_set_size(tab_bar->background,
 		tab_bar->width, tab_bar->height);
 
-	/* Position tab bar at top of layout */
-	wlr_scene_node_set_position(&tab_bar->scene_tree->node, 0, 0);
+	/* Position tab bar at top of layout, or of its output */
+	tab_bar->x = tab_bar->output ? layout_box.x : 0;
+	tab_bar->y = tab_bar->output ? layout_box.y : 0;
+	wlr_scene_node_set_position(&tab_bar->scene_tree->node, tab_bar->x, tab_bar->y);
 
 	wlr_log(WLR_DEBUG, "Tab bar layout: width=%d, height=%d, y=0 (top), layout_height=%d",
 		tab_bar->width, tab_bar->height, layout_box.height);
@@ -442,13 +594,13 @@ tab_bar_update_layout(struct cg_tab_bar *tab_bar)
 	/* Position tabs */
 	int x = TAB_BAR_PADDING;
 	for (int i = 0; i < tab_bar->tab_count; i++) {
-		if (tab_bar->tabs[i].text_buffer) {
-			wlr_scene_node_set_position(&tab_bar->tabs[i].text_buffer->node,
-						    x, 0);
-		}
+		tab_bar->tabs[i].x = x;
+		place_button(&tab_bar->tabs[i], x);
 
 		x += tab_bar->tabs[i].width + TAB_BUTTON_GAP;
 	}
+	tab_bar->content_width = x - TAB_BUTTON_GAP + TAB_BAR_PADDING;
+	tab_bar_set_scroll(tab_bar, tab_bar->scroll_x);
 
 	/* Position new tab button on the right */
 	int new_tab_x = tab_bar->width - TAB_NEW_TAB_BUTTON_WIDTH - TAB_BAR_PADDING;
@@ -458,179 +610,486 @@ tab_bar_update_layout(struct cg_tab_bar *tab_bar)
 	}
 }
 
+/* Whether a tab gets a button: foreground tabs with a view, or a title
+ * to show instead, as placeholders have, and on the bar's output if it
+ * has one; tabs being destroyed have neither */
+static bool
+tab_has_button(struct cg_tab_bar *tab_bar, struct cg_tab *tab)
+{
+	return (tab->view || tab->title) && !tab->is_background && (!tab_bar->output || tab->output == tab_bar->output);
+}
+
+/* Build the text shown on a tab's button: app_id followed by title */
+static void
+tab_display_text(struct cg_tab *tab, int index, char *dest, size_t dest_size)
+{
+	const char *view_title = tab->view ? view_get_title(tab->view) : tab->title;
+	const char *view_app_id = tab->view ? view_get_app_id(tab->view) : NULL;
+
+	if (view_app_id && view_title) {
+		snprintf(dest, dest_size, "%s: %s", view_app_id, view_title);
+	} else if (view_title) {
+		snprintf(dest, dest_size, "%s", view_title);
+	} else if (view_app_id) {
+		snprintf(dest, dest_size, "%s", view_app_id);
+	} else {
+		snprintf(dest, dest_size, "Tab %d", index + 1);
+	}
+}
+
+/* Find the previous button of a tab, trying the same slot first */
+static struct cg_tab_bar_button *
+find_old_button(struct cg_tab_bar_button *old, int old_count, struct cg_tab *tab, int hint)
+{
+	if (hint < old_count && old[hint].tab == tab && button_node(&old[hint])) {
+		return &old[hint];
+	}
+	for (int i = 0; i < old_count; i++) {
+		if (old[i].tab == tab && button_node(&old[i])) {
+			return &old[i];
+		}
+	}
+	return NULL;
+}
+
+/* Scene renderer: the shape is rects, resized or recolored in place, and
+ * only a new text or width renders a buffer. Returns true if it did. */
+static bool
+render_button_scene(struct cg_tab_bar *tab_bar, struct cg_tab_bar_button *button, const char *text, int width,
+		    bool is_active, bool is_hovered)
+{
+	if (!button->tree) {
+		button->tree = wlr_scene_tree_create(tab_bar->buttons_tree);
+		if (!button->tree) {
+			return false;
+		}
+		button->border = wlr_scene_rect_create(button->tree, width, TAB_BAR_HEIGHT, tab_bar_color_border);
+		button->background = wlr_scene_rect_create(button->tree, width - 2, TAB_BAR_HEIGHT - 1,
+							   button_color(is_active, is_hovered));
+		button->close_buffer = wlr_scene_buffer_create(button->tree, tab_bar->close_icon);
+		if (!button->border || !button->background || !button->close_buffer) {
+			wlr_scene_node_destroy(&button->tree->node);
+			button->tree = NULL;
+			return false;
+		}
+		wlr_scene_node_set_position(&button->background->node, 1, 1);
+		wlr_scene_buffer_set_dest_size(button->close_buffer, TAB_CLOSE_BUTTON_SIZE, TAB_CLOSE_BUTTON_SIZE);
+		button->is_active = is_active;
+		button->is_hovered = is_hovered;
+		button->width = 0;
+		button->scale = tab_bar->scale;
+	}
+
+	/* The close icon was rendered again at the new scale */
+	bool rescaled = button->scale != tab_bar->scale;
+	if (rescaled) {
+		wlr_scene_buffer_set_buffer(button->close_buffer, tab_bar->close_icon);
+	}
+
+	if (button->width != width) {
+		wlr_scene_rect_set_size(button->border, width, TAB_BAR_HEIGHT);
+		wlr_scene_rect_set_size(button->background, width - 2, TAB_BAR_HEIGHT - 1);
+		wlr_scene_node_set_position(&button->close_buffer->node,
+					    width - TAB_CLOSE_BUTTON_SIZE - TAB_CLOSE_BUTTON_PADDING,
+					    (TAB_BAR_HEIGHT - TAB_CLOSE_BUTTON_SIZE) / 2);
+	}
+
+	if (button->is_active != is_active || button->is_hovered != is_hovered) {
+		wlr_scene_rect_set_color(button->background, button_color(is_active, is_hovered));
+		button->is_active = is_active;
+		button->is_hovered = is_hovered;
+	}
+
+	bool rendered = false;
+	if (!button->text_buffer || rescaled || button->width != width || !button->text ||
+	    strcmp(button->text, text) != 0) {
+		struct wlr_buffer *buffer =
+			create_tab_text_buffer(tab_bar->font, text, width, TAB_BAR_HEIGHT, tab_bar->scale);
+		if (!buffer) {
+			return false;
+		}
+
+		if (button->text_buffer) {
+			wlr_scene_buffer_set_buffer(button->text_buffer, buffer);
+		} else {
+			button->text_buffer = wlr_scene_buffer_create(button->tree, buffer);
+		}
+		wlr_buffer_drop(buffer); /* scene_buffer holds reference */
+		if (button->text_buffer) {
+			wlr_scene_buffer_set_dest_size(button->text_buffer, width, TAB_BAR_HEIGHT);
+		}
+		stats_count(STATS_TAB_BAR_BUTTONS, 1);
+
+		free(button->text);
+		button->text = strdup(text);
+		button->width = width;
+		button->scale = tab_bar->scale;
+		rendered = true;
+	}
+
+	if (button->text_buffer) {
+		wlr_scene_buffer_set_opacity(button->text_buffer, is_active ? 1.0f : TAB_TEXT_INACTIVE_OPACITY);
+	}
+	return rendered;
+}
+
+/* Re-render a button if its cache key changed; returns true if it did */
+static bool
+render_button(struct cg_tab_bar *tab_bar, struct cg_tab_bar_button *button, const char *text, int width,
+	      bool is_active, bool is_hovered)
+{
+	if (tab_bar->scene_renderer) {
+		return render_button_scene(tab_bar, button, text, width, is_active, is_hovered);
+	}
+
+	bool stale = !button->text_buffer || button->scale != tab_bar->scale || button->width != width ||
+		button->is_active != is_active || button->is_hovered != is_hovered || !button->text ||
+		strcmp(button->text, text) != 0;
+	if (!stale) {
+		return false;
+	}
+
+	struct wlr_buffer *buffer = create_tab_buffer(tab_bar->font,
+		text, width, TAB_BAR_HEIGHT, tab_bar->scale, is_active, is_hovered,
+		true);  /* Show close button */
+	if (!buffer) {
+		return false;
+	}
+
+	if (button->text_buffer) {
+		wlr_scene_buffer_set_buffer(button->text_buffer, buffer);
+	} else {
+		button->text_buffer =
+			wlr_scene_buffer_create(tab_bar->buttons_tree, buffer);
+	}
+	wlr_buffer_drop(buffer); /* scene_buffer holds reference */
+	if (button->text_buffer) {
+		wlr_scene_buffer_set_dest_size(button->text_buffer, width, TAB_BAR_HEIGHT);
+	}
+	stats_count(STATS_TAB_BAR_BUTTONS, 1);
+
+	free(button->text);
+	button->text = strdup(text);
+	button->scale = tab_bar->scale;
+	button->is_active = is_active;
+	button->is_hovered = is_hovered;
+	button->width = width;
+	return true;
+}
+
+/* Rasterize at a new scale: the buttons see it on their next render, and
+ * the shared close icon and the new tab button are rendered again */
+static void
+tab_bar_set_scale(struct cg_tab_bar *tab_bar, float scale)
+{
+	if (tab_bar->scale == scale) {
+		return;
+	}
+	tab_bar->scale = scale;
+
+	if (tab_bar->close_icon) {
+		struct wlr_buffer *close_icon = create_close_button_buffer(scale);
+		if (close_icon) {
+			wlr_buffer_drop(tab_bar->close_icon);
+			tab_bar->close_icon = close_icon;
+		}
+	}
+	if (tab_bar->new_tab_button.text_buffer) {
+		wlr_scene_node_destroy(&tab_bar->new_tab_button.text_buffer->node);
+		tab_bar->new_tab_button.text_buffer = NULL;
+	}
+	wlr_log(WLR_DEBUG, "Tab bar rendered at scale %.2f", scale);
+}
+
 void
 tab_bar_update(struct cg_tab_bar *tab_bar)
 {
+	TRACE_SCOPE("tab_bar_update");
+
 	struct cg_server *server = tab_bar->server;
+	tab_bar->dirty = false;
+	tab_bar->titles_changed = false;
 
-	/* Clean up old tab buttons */
-	for (int i = 0; i < TAB_BAR_MAX_TABS; i++) {
-		if (tab_bar->tabs[i].text_buffer) {
-			wlr_scene_node_destroy(&tab_bar->tabs[i].text_buffer->node);
-			tab_bar->tabs[i].text_buffer = NULL;
-		}
-		if (tab_bar->tabs[i].background) {
-			wlr_scene_node_destroy(&tab_bar->tabs[i].background->node);
-			tab_bar->tabs[i].background = NULL;
+	/* The buttons are rebuilt in the tabs' order, so a drag ends here */
+	tab_bar->drag_index = -1;
+	tab_bar->dragging = false;
+
+	tab_bar_set_scale(tab_bar, output_ui_scale(server, tab_bar->output));
+
+	struct cg_tab *tab;
+	int visible_count = 0;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (tab_has_button(tab_bar, tab)) {
+			visible_count++;
 		}
 	}
 
-	tab_bar->tab_count = 0;
+	struct cg_tab_bar_button *buttons = calloc(visible_count > 0 ? visible_count : 1, sizeof(*buttons));
+	if (!buttons) {
+		wlr_log(WLR_ERROR, "Failed to allocate tab bar buttons");
+		return;
+	}
 
-	/* Create a temporary cairo context for text measurement */
-	cairo_surface_t *dummy_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
-	cairo_t *cr = cairo_create(dummy_surface);
-	cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL,
-			      CAIRO_FONT_WEIGHT_NORMAL);
-	cairo_set_font_size(cr, TAB_FONT_SIZE);
+	/* Move the current buttons aside; buttons whose tab is still shown
+	 * are carried over, and only re-rendered if their key changed. */
+	struct cg_tab_bar_button *old = tab_bar->tabs;
+	int old_count = tab_bar->tab_count;
+	tab_bar->tabs = buttons;
+	tab_bar->tab_count = 0;
 
-	/* Create new tab buttons */
-	struct cg_tab *tab;
 	int index = 0;
+	int rendered = 0;
+	struct cg_tab *active = tab_bar_active_tab(tab_bar);
 
 	wl_list_for_each(tab, &server->tabs, link) {
-		if (index >= TAB_BAR_MAX_TABS) {
-			wlr_log(WLR_ERROR, "Too many tabs for tab bar");
-			break;
-		}
-
-		/* Skip tabs without views (being destroyed) or background tabs */
-		if (!tab->view || tab->is_background) {
+		if (!tab_has_button(tab_bar, tab)) {
 			continue;
 		}
 
-		/* Determine if this is the active tab */
-		bool is_active = (tab == server->active_tab);
+		bool is_active = (tab == active);
 
-		/* Get tab title and app_id for display */
-		char *view_title = NULL;
-		char *view_app_id = NULL;
-		if (tab->view) {
-			view_title = view_get_title(tab->view);
-			view_app_id = view_get_app_id(tab->view);
+		char display_text[512];
+		tab_display_text(tab, index, display_text, sizeof(display_text));
+		int tab_width = calculate_tab_width(tab_bar->font, display_text);
+
+		struct cg_tab_bar_button *button = &tab_bar->tabs[index];
+		struct cg_tab_bar_button *prev = find_old_button(old, old_count, tab, index);
+		if (prev) {
+			*button = *prev;
+			memset(prev, 0, sizeof(*prev));
 		}
 
-		/* Create display text: app_id followed by title */
-		char display_text[512];
-		if (view_app_id && view_title) {
-			snprintf(display_text, sizeof(display_text), "%s: %s",
-				 view_app_id, view_title);
-		} else if (view_title) {
-			snprintf(display_text, sizeof(display_text), "%s", view_title);
-		} else if (view_app_id) {
-			snprintf(display_text, sizeof(display_text), "%s", view_app_id);
-		} else {
-			snprintf(display_text, sizeof(display_text), "Tab %d", index + 1);
+		bool is_hovered = tab == tab_bar->hovered && !is_active;
+		if (render_button(tab_bar, button, display_text, tab_width, is_active, is_hovered)) {
+			rendered++;
 		}
 
-		/* Calculate tab width based on text content */
-		int tab_width = calculate_tab_width(cr, display_text);
-		tab_bar->tabs[index].width = tab_width;
+		button->tab = tab;
+		button->width = tab_width;
+		button->title_changed = false;
 
-		/* Create buffer with rendered tab */
-		struct wlr_buffer *buffer = create_tab_buffer(
-			display_text, tab_width, TAB_BAR_HEIGHT, is_active,
-			true);  /* Show close button */
+		index++;
+		tab_bar->tab_count++;
+	}
 
-		if (buffer) {
-			tab_bar->tabs[index].text_buffer =
-				wlr_scene_buffer_create(tab_bar->scene_tree, buffer);
-			wlr_buffer_drop(buffer); /* scene_buffer holds reference */
+	/* Drop buttons of tabs that are gone or moved to the background */
+	for (int i = 0; i < old_count; i++) {
+		tab_bar_button_finish(&old[i]);
+	}
+	free(old);
+
+	/* The new tab button never changes, so it is only rendered once
+	 * per scale */
+	if (!tab_bar->new_tab_button.text_buffer) {
+		struct wlr_buffer *new_tab_buffer = create_new_tab_buffer(
+			TAB_NEW_TAB_BUTTON_WIDTH, TAB_BAR_HEIGHT, tab_bar->scale);
+
+		if (new_tab_buffer) {
+			tab_bar->new_tab_button.text_buffer =
+				wlr_scene_buffer_create(tab_bar->scene_tree, new_tab_buffer);
+			wlr_buffer_drop(new_tab_buffer);
+		}
+		if (tab_bar->new_tab_button.text_buffer) {
+			wlr_scene_buffer_set_dest_size(tab_bar->new_tab_button.text_buffer, TAB_NEW_TAB_BUTTON_WIDTH,
+						       TAB_BAR_HEIGHT);
 		}
+	}
+	if (tab_bar->new_tab_button.text_buffer) {
+		wlr_scene_node_raise_to_top(&tab_bar->new_tab_button.text_buffer->node);
+	}
 
-		free(view_title);
-		free(view_app_id);
+	wlr_log(WLR_DEBUG, "Tab bar update: re-rendered %d of %d buttons",
+		rendered, tab_bar->tab_count);
 
-		index++;
-		tab_bar->tab_count++;
+	/* Show tab bar if we have tabs. It is above the tabs' scene trees
+	 * already, since it was created after server->tabs_tree. */
+	bool was_shown = tab_bar->scene_tree->node.enabled;
+	bool shown = tab_bar->tab_count > 0;
+	wlr_scene_node_set_enabled(&tab_bar->scene_tree->node, shown);
+	if (shown) {
+		tab_bar_update_layout(tab_bar);
 	}
 
-	cairo_destroy(cr);
-	cairo_surface_destroy(dummy_surface);
+	/* Views only need to make or give back room for the tab bar when it
+	 * is shown or hidden; layout changes reposition them separately */
+	if (shown != was_shown) {
+		view_position_all(server);
+	}
+}
 
-	/* Create text buffer for new tab button */
-	struct wlr_buffer *new_tab_buffer = create_new_tab_buffer(
-		TAB_NEW_TAB_BUTTON_WIDTH, TAB_BAR_HEIGHT);
+void
+tab_bar_schedule_update(struct cg_tab_bar *tab_bar)
+{
+	tab_bar->dirty = true;
+	output_schedule_frames(tab_bar->server);
+}
 
-	if (new_tab_buffer) {
-		tab_bar->new_tab_button.text_buffer =
-			wlr_scene_buffer_create(tab_bar->scene_tree, new_tab_buffer);
-		wlr_buffer_drop(new_tab_buffer);
+void
+tab_bar_schedule_update_all(struct cg_server *server)
+{
+	if (server->tab_bar) {
+		tab_bar_schedule_update(server->tab_bar);
 	}
+	struct cg_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->tab_bar) {
+			tab_bar_schedule_update(output->tab_bar);
+		}
+	}
+}
 
-	/* Show tab bar if we have tabs */
-	if (tab_bar->tab_count > 0) {
-		wlr_scene_node_set_enabled(&tab_bar->scene_tree->node, true);
-		tab_bar_update_layout(tab_bar);
+/* Mark a tab's button for re-rendering; returns false if it has none */
+static bool
+mark_button(struct cg_tab_bar *tab_bar, struct cg_tab *tab)
+{
+	for (int i = 0; i < tab_bar->tab_count; i++) {
+		if (tab_bar->tabs[i].tab == tab) {
+			tab_bar->tabs[i].title_changed = true;
+			tab_bar->titles_changed = true;
+			output_schedule_frames(tab_bar->server);
+			return true;
+		}
+	}
+	return false;
+}
 
-		/* Raise tab bar to top so it appears above views */
-		wlr_scene_node_raise_to_top(&tab_bar->scene_tree->node);
+void
+tab_bar_tab_changed(struct cg_tab_bar *tab_bar, struct cg_tab *tab)
+{
+	mark_button(tab_bar, tab);
+}
 
-		/* Reposition all views to account for tab bar space */
-		view_position_all(server);
+void
+tab_bar_active_changed(struct cg_tab_bar *tab_bar, struct cg_tab *old_tab, struct cg_tab *new_tab)
+{
+	if (old_tab) {
+		mark_button(tab_bar, old_tab);
+	}
+
+	/* A tab that should be shown but has no button yet needs a rebuild */
+	if (!mark_button(tab_bar, new_tab) && tab_has_button(tab_bar, new_tab)) {
+		tab_bar_schedule_update(tab_bar);
+	}
+}
+
+static void
+tab_bar_forget(struct cg_tab_bar *tab_bar, struct cg_tab *tab)
+{
+	if (tab_bar->hovered == tab) {
+		tab_bar->hovered = NULL;
+	}
+	if (tab_bar->scrolled_to == tab) {
+		tab_bar->scrolled_to = NULL;
+	}
+}
+
+void
+tab_bar_tab_removed(struct cg_server *server, struct cg_tab *tab)
+{
+	/* The tab may have moved between outputs, so check every bar */
+	if (server->tab_bar) {
+		tab_bar_forget(server->tab_bar, tab);
+	}
+	struct cg_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->tab_bar) {
+			tab_bar_forget(output->tab_bar, tab);
+		}
+	}
+}
+
+/* Re-render only the buttons whose title or active state changed. Any tab that was freed
+ * since the last full update also scheduled one, so when no full update
+ * is pending, every button's tab is still alive. */
+static void
+tab_bar_update_titles(struct cg_tab_bar *tab_bar)
+{
+	tab_bar->titles_changed = false;
+
+	for (int i = 0; i < tab_bar->tab_count; i++) {
+		struct cg_tab_bar_button *button = &tab_bar->tabs[i];
+		if (!button->title_changed) {
+			continue;
+		}
+		button->title_changed = false;
+
+		char display_text[512];
+		tab_display_text(button->tab, i, display_text, sizeof(display_text));
+
+		/* A wider or narrower button moves its neighbours */
+		if (calculate_tab_width(tab_bar->font, display_text) != button->width) {
+			tab_bar_update(tab_bar);
+			return;
+		}
+
+		bool is_active = button->tab == tab_bar_active_tab(tab_bar);
+		render_button(tab_bar, button, display_text, button->width, is_active,
+			      button->tab == tab_bar->hovered && !is_active);
+	}
+}
+
+void
+tab_bar_flush(struct cg_tab_bar *tab_bar)
+{
+	if (!tab_bar) {
+		return;
+	}
+
+	if (!tab_bar->dirty && !tab_bar->titles_changed) {
+		return;
+	}
+
+	uint64_t start = stats_now();
+	if (tab_bar->dirty) {
+		tab_bar_update(tab_bar);
 	} else {
-		wlr_scene_node_set_enabled(&tab_bar->scene_tree->node, false);
+		tab_bar_update_titles(tab_bar);
+	}
+	scroll_to_active(tab_bar);
+	stats_record(STATS_TAB_BAR_RENDER, start);
+}
+
+/* Find the button under x by binary search of the buttons' extents, which
+ * are only recomputed when the layout changes; -1 if there is none */
+static int
+button_at(struct cg_tab_bar *tab_bar, double x)
+{
+	int lo = 0;
+	int hi = tab_bar->tab_count - 1;
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+		struct cg_tab_bar_button *button = &tab_bar->tabs[mid];
+		if (x < button->x) {
+			hi = mid - 1;
+		} else if (x >= button->x + button->width) {
+			lo = mid + 1;
+		} else {
+			return mid;
+		}
 	}
+	return -1;
 }
 
 bool
 tab_bar_handle_click(struct cg_tab_bar *tab_bar, double x, double y,
 	uint32_t button)
 {
+	/* Hit-test against the current tabs, not last frame's */
+	tab_bar_flush(tab_bar);
+	x -= tab_bar->x;
+	y -= tab_bar->y;
+
 	if (!tab_bar->scene_tree->node.enabled) {
 		return false;
 	}
 
-	/* Check if click is within tab bar vertical bounds */
-	if (y < 0 || y >= tab_bar->height) {
+	/* Check if click is within tab bar bounds */
+	if (y < 0 || y >= tab_bar->height || x < 0 || x >= tab_bar->width) {
 		return false;
 	}
 
-	/* Check if click is on a tab button */
-	int tab_x = TAB_BAR_PADDING;
-	for (int i = 0; i < tab_bar->tab_count; i++) {
-		int tab_width = tab_bar->tabs[i].width;
-		if (x >= tab_x && x < tab_x + tab_width) {
-			struct cg_tab *tab = NULL;
-			int index = 0;
-			struct cg_tab *t;
-
-			/* Find the clicked tab */
-			wl_list_for_each(t, &tab_bar->server->tabs, link) {
-				if (!t->view) continue;  /* Skip tabs being destroyed */
-				if (index == i) {
-					tab = t;
-					break;
-				}
-				index++;
-			}
-
-			if (tab) {
-				/* Check if click is on close button */
-				int close_x = tab_x + tab_width - TAB_CLOSE_BUTTON_SIZE -
-					     TAB_CLOSE_BUTTON_PADDING;
-				bool on_close_button = (x >= close_x && x < tab_x + tab_width);
-
-				if (on_close_button && button == BTN_LEFT) {
-					/* Click on close button */
-					tab_destroy(tab);
-					return true;
-				} else if (button == BTN_LEFT) {
-					/* Left click on tab: activate */
-					tab_activate(tab);
-					return true;
-				} else if (button == BTN_MIDDLE) {
-					/* Middle click: close tab */
-					tab_destroy(tab);
-					return true;
-				}
-			}
-			return false;
-		}
-		tab_x += tab_width + TAB_BUTTON_GAP;
-	}
-
-	/* Check if click is on new tab button */
+	/* Check if click is on new tab button, which is over any tab scrolled
+	 * under it */
 	int new_tab_x = tab_bar->width - TAB_NEW_TAB_BUTTON_WIDTH - TAB_BAR_PADDING;
 	if (x >= new_tab_x && x < new_tab_x + TAB_NEW_TAB_BUTTON_WIDTH) {
 		if (button == BTN_LEFT) {
@@ -640,5 +1099,180 @@ tab_bar_handle_click(struct cg_tab_bar *tab_bar, double x, double y,
 		}
 	}
 
+	/* Check if click is on a tab button. The flush above leaves no full
+	 * update pending, so every button's tab is alive. */
+	int i = button_at(tab_bar, x + tab_bar->scroll_x);
+	if (i >= 0) {
+		struct cg_tab *tab = tab_bar->tabs[i].tab;
+		int tab_x = tab_bar->tabs[i].x - tab_bar->scroll_x;
+		int tab_width = tab_bar->tabs[i].width;
+
+		/* Check if click is on close button */
+		int close_x = tab_x + tab_width - TAB_CLOSE_BUTTON_SIZE - TAB_CLOSE_BUTTON_PADDING;
+		bool on_close_button = (x >= close_x && x < tab_x + tab_width);
+
+		if (on_close_button && button == BTN_LEFT) {
+			/* Click on close button */
+			tab_destroy(tab);
+			return true;
+		} else if (button == BTN_LEFT) {
+			/* Left click on tab: activate, and drag it if the pointer
+			 * moves before the button is released */
+			tab_activate(tab);
+			tab_bar->drag_index = i;
+			tab_bar->drag_start_index = i;
+			tab_bar->drag_grab_x = x - tab_x;
+			tab_bar->drag_start_x = x;
+			tab_bar->dragging = false;
+			return true;
+		} else if (button == BTN_MIDDLE) {
+			/* Middle click: close tab */
+			tab_destroy(tab);
+			return true;
+		}
+		return false;
+	}
+
 	return false;
 }
+
+/* Move the dragged button's slot past any neighbour whose middle its
+ * floating position crossed; only the neighbours' nodes move */
+static void
+drag_swap_neighbours(struct cg_tab_bar *tab_bar, int left)
+{
+	struct cg_tab_bar_button *buttons = tab_bar->tabs;
+	int i = tab_bar->drag_index;
+
+	while (i > 0 && left < buttons[i - 1].x + buttons[i - 1].width / 2) {
+		struct cg_tab_bar_button dragged = buttons[i];
+		buttons[i] = buttons[i - 1];
+		dragged.x = buttons[i].x;
+		buttons[i].x += dragged.width + TAB_BUTTON_GAP;
+		place_button(&buttons[i], buttons[i].x);
+		buttons[--i] = dragged;
+	}
+
+	int right = left + buttons[i].width;
+	while (i < tab_bar->tab_count - 1 && right > buttons[i + 1].x + buttons[i + 1].width / 2) {
+		struct cg_tab_bar_button dragged = buttons[i];
+		buttons[i] = buttons[i + 1];
+		buttons[i].x = dragged.x;
+		dragged.x += buttons[i].width + TAB_BUTTON_GAP;
+		place_button(&buttons[i], buttons[i].x);
+		buttons[++i] = dragged;
+	}
+
+	tab_bar->drag_index = i;
+}
+
+bool
+tab_bar_handle_motion(struct cg_tab_bar *tab_bar, double x, double y)
+{
+	if (!tab_bar->scene_tree->node.enabled) {
+		return false;
+	}
+	x -= tab_bar->x;
+	y -= tab_bar->y;
+
+	if (tab_bar->drag_index >= 0 && !tab_bar->dirty) {
+		struct cg_tab_bar_button *dragged = &tab_bar->tabs[tab_bar->drag_index];
+		if (!tab_bar->dragging && fabs(x - tab_bar->drag_start_x) >= TAB_DRAG_THRESHOLD) {
+			tab_bar->dragging = true;
+			struct wlr_scene_node *node = button_node(dragged);
+			if (node) {
+				wlr_scene_node_raise_to_top(node);
+			}
+		}
+		if (tab_bar->dragging) {
+			/* The button follows the pointer, within the other buttons */
+			int left = (int)(x + tab_bar->scroll_x - tab_bar->drag_grab_x);
+			int max_left = tab_bar->content_width - TAB_BAR_PADDING - dragged->width;
+			if (left > max_left) {
+				left = max_left;
+			}
+			if (left < TAB_BAR_PADDING) {
+				left = TAB_BAR_PADDING;
+			}
+			drag_swap_neighbours(tab_bar, left);
+			place_button(&tab_bar->tabs[tab_bar->drag_index], left);
+			return true;
+		}
+	}
+
+	bool over = y >= 0 && y < tab_bar->height && x >= 0 && x < tab_bar->width;
+	struct cg_tab *hovered = NULL;
+	if (over && x < visible_width(tab_bar)) {
+		int i = button_at(tab_bar, x + tab_bar->scroll_x);
+		hovered = i >= 0 ? tab_bar->tabs[i].tab : NULL;
+	}
+
+	/* Only the buttons that gain and lose the highlight are re-rendered */
+	if (hovered != tab_bar->hovered) {
+		if (tab_bar->hovered) {
+			mark_button(tab_bar, tab_bar->hovered);
+		}
+		if (hovered) {
+			mark_button(tab_bar, hovered);
+		}
+		tab_bar->hovered = hovered;
+	}
+
+	return over || tab_bar->drag_index >= 0;
+}
+
+bool
+tab_bar_handle_release(struct cg_tab_bar *tab_bar, uint32_t button)
+{
+	if (button != BTN_LEFT || tab_bar->drag_index < 0) {
+		return false;
+	}
+
+	/* A rebuild since the press ends the drag */
+	tab_bar_flush(tab_bar);
+	if (tab_bar->drag_index < 0) {
+		return true;
+	}
+
+	int index = tab_bar->drag_index;
+	bool dragging = tab_bar->dragging;
+	tab_bar->drag_index = -1;
+	tab_bar->dragging = false;
+	if (!dragging) {
+		scroll_to_active(tab_bar);
+		return false;
+	}
+
+	struct cg_tab_bar_button *dropped = &tab_bar->tabs[index];
+	place_button(dropped, dropped->x);
+	if (tab_bar->new_tab_button.text_buffer) {
+		wlr_scene_node_raise_to_top(&tab_bar->new_tab_button.text_buffer->node);
+	}
+
+	if (index != tab_bar->drag_start_index) {
+		/* The buttons are in the new order already, so the update that
+		 * moving the tab schedules would change nothing */
+		bool dirty = tab_bar->dirty;
+		struct cg_tab *before = index + 1 < tab_bar->tab_count ? tab_bar->tabs[index + 1].tab : NULL;
+		tab_move_before(dropped->tab, before);
+		tab_bar->dirty = dirty;
+		wl_signal_emit_mutable(&tab_bar->server->events.tab_move, dropped->tab);
+	}
+
+	tab_bar->scrolled_to = NULL;
+	scroll_to_active(tab_bar);
+	return true;
+}
+
+bool
+tab_bar_handle_scroll(struct cg_tab_bar *tab_bar, double x, double y, double delta)
+{
+	x -= tab_bar->x;
+	y -= tab_bar->y;
+	if (!tab_bar->scene_tree->node.enabled || y < 0 || y >= tab_bar->height || x < 0 || x >= tab_bar->width) {
+		return false;
+	}
+
+	tab_bar_set_scroll(tab_bar, tab_bar->scroll_x + (int)(delta * TAB_SCROLL_SPEED));
+	return true;
+}
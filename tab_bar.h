@@ -5,9 +5,8 @@
 #include <wlr/types/wlr_scene.h>
 
 struct cg_server;
-
-/* Maximum number of tabs to display in tab bar */
-#define TAB_BAR_MAX_TABS 256
+struct cg_output;
+struct cg_font;
 
 /* Tab bar dimensions */
 #define TAB_BAR_HEIGHT 36
@@ -18,38 +17,139 @@ struct cg_server;
 #define TAB_NEW_TAB_BUTTON_WIDTH 36
 #define TAB_CORNER_RADIUS 6
 
+struct cg_tab;
+
 struct cg_tab_bar_button {
 	struct wlr_scene_rect *background;
 	struct wlr_scene_buffer *text_buffer;
+	int x;      /* Left edge, ascending across buttons, for hit-testing */
 	int width;  /* Variable width for browser-style tabs */
+
+	/* Scene renderer: the button is a tree of rects for its shape, the
+	 * text_buffer with only its text, and the shared close button, so
+	 * that activating it only recolors the background rect. NULL with
+	 * the cairo renderer, where text_buffer holds the whole button. */
+	struct wlr_scene_tree *tree;
+	struct wlr_scene_rect *border;
+	struct wlr_scene_buffer *close_buffer;
+
+	/* Render cache key: the buffer is only re-rendered when one of
+	 * these changes. The tab pointer is only compared, never
+	 * dereferenced, since the tab may already have been freed. */
+	struct cg_tab *tab;
+	char *text;
+	float scale;
+	bool is_active;
+	bool is_hovered;
+
+	bool title_changed;  /* Re-render on the next flush */
 };
 
 struct cg_tab_bar {
 	struct cg_server *server;
+	/* With separate outputs, the output whose tabs the bar shows, at its
+	 * top; NULL for one bar over the whole layout */
+	struct cg_output *output;
 	struct wlr_scene_tree *scene_tree;
 	struct wlr_scene_rect *background;
+	struct cg_font *font;
 
-	/* Tab buttons */
-	struct cg_tab_bar_button tabs[TAB_BAR_MAX_TABS];
+	/* The scale buttons are rasterized at: that of the bar's output, or
+	 * the highest of the outputs' for one bar over the whole layout.
+	 * Buttons are laid out in logical pixels either way. */
+	float scale;
+
+	/* Build the buttons from scene rects rather than cairo buffers; the
+	 * close button is then rendered once, into close_icon */
+	bool scene_renderer;
+	struct wlr_buffer *close_icon;
+
+	/* Tab buttons, one per visible tab, under buttons_tree, which is
+	 * moved to scroll them */
+	struct wlr_scene_tree *buttons_tree;
+	struct cg_tab_bar_button *tabs;
 	int tab_count;
 
+	/* Horizontal scrolling, once the buttons are wider than the bar. The
+	 * tabs are only compared, never dereferenced, and are cleared by
+	 * tab_bar_tab_removed() before they are freed. */
+	int scroll_x;
+	int content_width;
+	struct cg_tab *scrolled_to;  /* Active tab last scrolled into view */
+	struct cg_tab *hovered;      /* Tab of the button under the pointer */
+
+	/* Drag to reorder: the button pressed, where in it, and whether the
+	 * pointer has moved far enough since to drag it; drag_index is -1
+	 * when no button is pressed */
+	int drag_index;
+	int drag_start_index;
+	double drag_grab_x;
+	double drag_start_x;
+	bool dragging;
+
 	/* New Tab button */
 	struct cg_tab_bar_button new_tab_button;
 
-	/* Layout */
+	/* Layout: the bar's top left corner in layout coordinates, which
+	 * the input handlers take */
+	int x;
+	int y;
 	int width;
 	int height;
+
+	bool dirty;           /* Tabs changed since the last update */
+	bool titles_changed;  /* Some buttons have title_changed set */
 };
 
-/* Create and destroy tab bar */
-struct cg_tab_bar *tab_bar_create(struct cg_server *server);
+/* Create and destroy tab bar, of an output's tabs or of all if output is
+ * NULL */
+struct cg_tab_bar *tab_bar_create(struct cg_server *server, struct cg_output *output);
 void tab_bar_destroy(struct cg_tab_bar *tab_bar);
 
-/* Update tab bar when tabs change */
+/* Switch between the scene (true) and cairo renderers, e.g. after a
+ * configuration reload. Every button is re-rendered on the next frame. */
+void tab_bar_set_renderer(struct cg_tab_bar *tab_bar, bool scene);
+
+/* Rebuild the tab bar now */
 void tab_bar_update(struct cg_tab_bar *tab_bar);
 
+/* Mark the tab bar for a rebuild on the next output frame, so that a
+ * burst of tab changes costs one update */
+void tab_bar_schedule_update(struct cg_tab_bar *tab_bar);
+
+/* Re-render a single tab's button on the next output frame, after its
+ * title or app_id changed */
+void tab_bar_tab_changed(struct cg_tab_bar *tab_bar, struct cg_tab *tab);
+
+/* Re-render only the buttons of the previously and newly active tabs on
+ * the next output frame. old_tab may be NULL. */
+void tab_bar_active_changed(struct cg_tab_bar *tab_bar, struct cg_tab *old_tab, struct cg_tab *new_tab);
+
+/* Forget a tab that is removed, in every tab bar of the server, so that
+ * a new tab allocated in its place isn't taken for it */
+void tab_bar_tab_removed(struct cg_server *server, struct cg_tab *tab);
+
+/* Run a scheduled rebuild, if any. NULL-safe. */
+void tab_bar_flush(struct cg_tab_bar *tab_bar);
+
+/* Schedule a rebuild of every tab bar, the server's or the outputs' */
+void tab_bar_schedule_update_all(struct cg_server *server);
+
 /* Handle mouse clicks on tab bar */
 bool tab_bar_handle_click(struct cg_tab_bar *tab_bar, double x, double y,
 	uint32_t button);
 
+/* Handle the release of a mouse button, dropping a dragged tab. Returns
+ * true if a tab was being dragged. */
+bool tab_bar_handle_release(struct cg_tab_bar *tab_bar, uint32_t button);
+
+/* Handle pointer motion: highlight the button under the pointer and move a
+ * dragged tab. Returns true if the pointer is over the tab bar or dragging
+ * a tab, so that no client should have pointer focus. */
+bool tab_bar_handle_motion(struct cg_tab_bar *tab_bar, double x, double y);
+
+/* Scroll the tab buttons by delta, if the pointer is over the tab bar;
+ * returns true if it is */
+bool tab_bar_handle_scroll(struct cg_tab_bar *tab_bar, double x, double y, double delta);
+
 #endif
@@ -0,0 +1,368 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <cairo/cairo.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/util/log.h>
+
+#include "font.h"
+#include "output.h"
+#include "seat.h"
+#include "server.h"
+#include "tab.h"
+#include "tab_switcher.h"
+#include "view.h"
+
+#define SWITCHER_PADDING 10
+#define SWITCHER_MODIFIERS (WLR_MODIFIER_SHIFT | WLR_MODIFIER_CTRL | WLR_MODIFIER_ALT | WLR_MODIFIER_LOGO)
+
+static const float switcher_box_bg[4] = {0.12f, 0.12f, 0.12f, 0.95f};
+static const float switcher_selected_bg[4] = {0.22f, 0.33f, 0.44f, 1.0f};
+static const float switcher_text[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+static int
+box_height(struct cg_tab_switcher *switcher)
+{
+	return 2 * SWITCHER_PADDING + (int)switcher->view.rows * OVERLAY_ITEM_HEIGHT;
+}
+
+static void
+damage_row(struct cg_tab_switcher *switcher, size_t index)
+{
+	if (index < switcher->view.first || index >= switcher->view.first + switcher->view.rows) {
+		return;
+	}
+	overlay_damage_box(&switcher->overlay, 0, SWITCHER_PADDING + (int)(index - switcher->view.first) * OVERLAY_ITEM_HEIGHT,
+			   OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT);
+}
+
+static void
+schedule_render(struct cg_tab_switcher *switcher)
+{
+	switcher->dirty = true;
+	output_schedule_frames(switcher->server);
+}
+
+static void
+render(struct cg_tab_switcher *switcher)
+{
+	struct cg_overlay *overlay = &switcher->overlay;
+	int height = box_height(switcher);
+	cairo_t *cr = overlay_begin_paint(overlay, OVERLAY_BOX_WIDTH, height);
+	if (!cr) {
+		return;
+	}
+
+	cairo_set_source_rgba(cr, switcher_box_bg[0], switcher_box_bg[1], switcher_box_bg[2], switcher_box_bg[3]);
+	cairo_rectangle(cr, 0, 0, OVERLAY_BOX_WIDTH, height);
+	cairo_fill(cr);
+
+	font_apply(switcher->font, cr);
+
+	size_t visible = result_view_visible(&switcher->view);
+	for (size_t row = 0; row < visible; row++) {
+		size_t index = switcher->view.first + row;
+		int item_y = SWITCHER_PADDING + (int)row * OVERLAY_ITEM_HEIGHT;
+		if (!overlay_needs_paint(overlay, 0, item_y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT)) {
+			continue;
+		}
+
+		if (index == switcher->view.selected) {
+			cairo_set_source_rgba(cr, switcher_selected_bg[0], switcher_selected_bg[1],
+					      switcher_selected_bg[2], switcher_selected_bg[3]);
+			cairo_rectangle(cr, SWITCHER_PADDING, item_y, OVERLAY_BOX_WIDTH - 2 * SWITCHER_PADDING,
+					OVERLAY_ITEM_HEIGHT - 5);
+			cairo_fill(cr);
+		}
+
+		struct cg_tab *tab = switcher->tabs[index];
+		const char *title = tab->view ? view_get_title(tab->view) : tab->title;
+		char title_display[256];
+		font_truncate_to_width(switcher->font, title ? title : "<Untitled>", OVERLAY_BOX_WIDTH - 40,
+				       title_display, sizeof(title_display));
+		cairo_set_source_rgb(cr, switcher_text[0], switcher_text[1], switcher_text[2]);
+		cairo_move_to(cr, 20, item_y + 25);
+		cairo_show_text(cr, title_display);
+	}
+
+	overlay_end_paint(overlay, cr, switcher->content_buffer);
+}
+
+void
+tab_switcher_flush(struct cg_tab_switcher *switcher)
+{
+	if (!switcher || !switcher->is_visible || !switcher->dirty) {
+		return;
+	}
+
+	int x, y;
+	struct cg_output *output = output_center_box(switcher->server, OVERLAY_BOX_WIDTH, box_height(switcher), &x, &y);
+	if (output) {
+		overlay_set_scale(&switcher->overlay, output->wlr_output->scale);
+		render(switcher);
+		wlr_scene_node_set_position(&switcher->content_buffer->node, x, y);
+	}
+
+	switcher->dirty = false;
+}
+
+/* Show the selected tab over the active one, without activating it */
+static void
+preview_selection(struct cg_tab_switcher *switcher)
+{
+	struct cg_tab *active = switcher->server->active_tab;
+	struct cg_tab *tab = switcher->tabs[switcher->view.selected];
+
+	if (switcher->previewed && switcher->previewed != tab && switcher->previewed->scene_tree) {
+		wlr_scene_node_set_enabled(&switcher->previewed->scene_tree->node, false);
+	}
+	switcher->previewed = NULL;
+
+	if (tab != active && tab->scene_tree) {
+		wlr_scene_node_set_enabled(&tab->scene_tree->node, true);
+		/* Just above the active tab, leaving the tab bar over both */
+		if (active && active->scene_tree) {
+			wlr_scene_node_place_above(&tab->scene_tree->node, &active->scene_tree->node);
+		} else {
+			wlr_scene_node_raise_to_top(&tab->scene_tree->node);
+		}
+		switcher->previewed = tab;
+	}
+	wlr_scene_node_raise_to_top(&switcher->scene_tree->node);
+}
+
+static void
+hide(struct cg_tab_switcher *switcher)
+{
+	wlr_scene_node_set_enabled(&switcher->scene_tree->node, false);
+	switcher->is_visible = false;
+	switcher->previewed = NULL;
+	wl_list_remove(&switcher->tab_unmap.link);
+	wl_list_init(&switcher->tab_unmap.link);
+}
+
+static void
+handle_tab_unmap(struct wl_listener *listener, void *data)
+{
+	struct cg_tab_switcher *switcher = wl_container_of(listener, switcher, tab_unmap);
+	struct cg_tab *tab = data;
+
+	size_t count = 0;
+	for (size_t i = 0; i < switcher->view.total; i++) {
+		if (switcher->tabs[i] != tab) {
+			switcher->tabs[count++] = switcher->tabs[i];
+		}
+	}
+	if (count == switcher->view.total) {
+		return;
+	}
+	if (switcher->previewed == tab) {
+		switcher->previewed = NULL;
+	}
+
+	if (count == 0) {
+		hide(switcher);
+		return;
+	}
+	result_view_set_total(&switcher->view, count);
+	preview_selection(switcher);
+	overlay_damage_whole(&switcher->overlay);
+	schedule_render(switcher);
+}
+
+/* List the foreground tabs by most recent use; returns false if there
+ * are fewer than two */
+static bool
+show(struct cg_tab_switcher *switcher)
+{
+	struct cg_server *server = switcher->server;
+	size_t count = 0;
+
+	/* The active tab comes first even if it is a background tab */
+	if (server->active_tab) {
+		switcher->tabs[count++] = server->active_tab;
+	}
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs_mru, mru_link) {
+		if (count >= TAB_SWITCHER_MAX_TABS) {
+			break;
+		}
+		if (tab != server->active_tab && !tab->is_background) {
+			switcher->tabs[count++] = tab;
+		}
+	}
+	if (count < 2) {
+		return false;
+	}
+
+	result_view_reset(&switcher->view, count, count < TAB_SWITCHER_ROWS ? count : TAB_SWITCHER_ROWS);
+	switcher->previewed = NULL;
+	wl_signal_add(&server->events.tab_unmap, &switcher->tab_unmap);
+
+	wlr_scene_node_set_enabled(&switcher->scene_tree->node, true);
+	switcher->is_visible = true;
+	overlay_damage_whole(&switcher->overlay);
+	schedule_render(switcher);
+	return true;
+}
+
+static uint32_t
+held_modifiers(struct cg_server *server)
+{
+	struct wlr_keyboard *keyboard = server->seat ? wlr_seat_get_keyboard(server->seat->seat) : NULL;
+	return keyboard ? wlr_keyboard_get_modifiers(keyboard) & SWITCHER_MODIFIERS : 0;
+}
+
+bool
+tab_switcher_step(struct cg_tab_switcher *switcher, int delta)
+{
+	if (!switcher) {
+		return false;
+	}
+
+	if (!switcher->is_visible) {
+		if (!show(switcher)) {
+			return false;
+		}
+		switcher->modifiers = held_modifiers(switcher->server);
+	}
+
+	size_t old = switcher->view.selected;
+	if (result_view_move(&switcher->view, delta, true)) {
+		overlay_damage_whole(&switcher->overlay);
+	} else {
+		damage_row(switcher, old);
+		damage_row(switcher, switcher->view.selected);
+	}
+
+	/* Nothing will be released to commit on */
+	if (switcher->modifiers == 0) {
+		tab_switcher_commit(switcher);
+		return true;
+	}
+
+	preview_selection(switcher);
+	schedule_render(switcher);
+	return true;
+}
+
+void
+tab_switcher_commit(struct cg_tab_switcher *switcher)
+{
+	if (!switcher || !switcher->is_visible) {
+		return;
+	}
+
+	struct cg_tab *tab = switcher->tabs[switcher->view.selected];
+	hide(switcher);
+	if (tab != switcher->server->active_tab) {
+		tab_activate(tab);
+	}
+}
+
+void
+tab_switcher_cancel(struct cg_tab_switcher *switcher)
+{
+	if (!switcher || !switcher->is_visible) {
+		return;
+	}
+
+	if (switcher->previewed && switcher->previewed->scene_tree) {
+		wlr_scene_node_set_enabled(&switcher->previewed->scene_tree->node, false);
+	}
+	hide(switcher);
+}
+
+bool
+tab_switcher_handle_key(struct cg_tab_switcher *switcher, xkb_keysym_t sym)
+{
+	if (!switcher || !switcher->is_visible) {
+		return false;
+	}
+
+	switch (sym) {
+	case XKB_KEY_Escape:
+		tab_switcher_cancel(switcher);
+		return true;
+	case XKB_KEY_Return:
+		tab_switcher_commit(switcher);
+		return true;
+	default:
+		return false;
+	}
+}
+
+void
+tab_switcher_handle_modifiers(struct cg_tab_switcher *switcher, uint32_t modifiers)
+{
+	if (switcher && switcher->is_visible && (modifiers & switcher->modifiers) == 0) {
+		tab_switcher_commit(switcher);
+	}
+}
+
+struct cg_tab_switcher *
+tab_switcher_create(struct cg_server *server)
+{
+	struct cg_tab_switcher *switcher = calloc(1, sizeof(*switcher));
+	if (!switcher) {
+		wlr_log(WLR_ERROR, "Failed to allocate tab switcher");
+		return NULL;
+	}
+
+	switcher->server = server;
+	overlay_init(&switcher->overlay);
+	switcher->tab_unmap.notify = handle_tab_unmap;
+	wl_list_init(&switcher->tab_unmap.link);
+
+	switcher->font = font_create("sans-serif", 14);
+	if (!switcher->font) {
+		overlay_finish(&switcher->overlay);
+		free(switcher);
+		return NULL;
+	}
+
+	switcher->scene_tree = wlr_scene_tree_create(&server->scene->tree);
+	if (!switcher->scene_tree) {
+		wlr_log(WLR_ERROR, "Failed to create tab switcher scene tree");
+		goto error;
+	}
+
+	switcher->content_buffer = wlr_scene_buffer_create(switcher->scene_tree, NULL);
+	if (!switcher->content_buffer) {
+		wlr_log(WLR_ERROR, "Failed to create tab switcher content buffer");
+		wlr_scene_node_destroy(&switcher->scene_tree->node);
+		goto error;
+	}
+
+	wlr_scene_node_set_enabled(&switcher->scene_tree->node, false);
+	return switcher;
+
+error:
+	font_destroy(switcher->font);
+	overlay_finish(&switcher->overlay);
+	free(switcher);
+	return NULL;
+}
+
+void
+tab_switcher_destroy(struct cg_tab_switcher *switcher)
+{
+	if (!switcher) {
+		return;
+	}
+
+	/* The scene tree is destroyed along with the scene */
+	wl_list_remove(&switcher->tab_unmap.link);
+	overlay_finish(&switcher->overlay);
+	font_destroy(switcher->font);
+	free(switcher);
+}
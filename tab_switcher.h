@@ -0,0 +1,79 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_TAB_SWITCHER_H
+#define CG_TAB_SWITCHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_scene.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include "overlay.h"
+#include "result_view.h"
+
+/* Tabs listed by the switcher, most recently active first */
+#define TAB_SWITCHER_MAX_TABS 256
+#define TAB_SWITCHER_ROWS 9
+
+struct cg_server;
+struct cg_font;
+struct cg_tab;
+
+/*
+ * Alt-Tab style switcher. The first press of a switch_tab binding lists
+ * the foreground tabs by most recent use and selects the previous one;
+ * further presses while its modifiers are held move the selection. The
+ * selected tab is previewed by showing its scene node, without activating
+ * it, and is only activated once the modifiers are released.
+ */
+struct cg_tab_switcher {
+	struct cg_server *server;
+	struct wlr_scene_tree *scene_tree;
+	struct cg_font *font;
+	struct wlr_scene_buffer *content_buffer;
+	struct cg_overlay overlay;
+	bool is_visible;
+	bool dirty;
+
+	struct cg_tab *tabs[TAB_SWITCHER_MAX_TABS];
+	struct cg_result_view view;
+	struct cg_tab *previewed; /* Shown over the active tab, if another */
+	uint32_t modifiers;       /* Held when shown; releasing them all commits */
+
+	struct wl_listener tab_unmap;
+};
+
+struct cg_tab_switcher *tab_switcher_create(struct cg_server *server);
+void tab_switcher_destroy(struct cg_tab_switcher *switcher);
+
+/**
+ * Show the switcher, or move its selection by delta when it is shown. If
+ * no modifiers are held, e.g. when run from the control socket, the
+ * selection is activated at once. Returns false if there is no other tab
+ * to switch to.
+ */
+bool tab_switcher_step(struct cg_tab_switcher *switcher, int delta);
+
+/* Activate the selected tab and hide the switcher */
+void tab_switcher_commit(struct cg_tab_switcher *switcher);
+
+/* Hide the switcher, leaving the active tab as it was */
+void tab_switcher_cancel(struct cg_tab_switcher *switcher);
+
+/* Repaint pending changes; called once per output frame */
+void tab_switcher_flush(struct cg_tab_switcher *switcher);
+
+/* Keyboard input handling: Escape cancels and Return commits */
+bool tab_switcher_handle_key(struct cg_tab_switcher *switcher, xkb_keysym_t sym);
+
+/* Commit once the modifiers held when the switcher was shown are released */
+void tab_switcher_handle_modifiers(struct cg_tab_switcher *switcher, uint32_t modifiers);
+
+#endif
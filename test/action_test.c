@@ -0,0 +1,238 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-server-core.h>
+
+#include "action.h"
+#include "server.h"
+#include "tab.h"
+
+#define TEST_TABS 5
+
+/* Counted by action_test_stubs.c */
+extern int launcher_toggles;
+extern int background_dialog_toggles;
+extern int tab_switcher_steps;
+
+static struct cg_server server;
+static struct cg_tab tabs[TEST_TABS];
+
+static void
+setup(void)
+{
+	memset(&server, 0, sizeof(server));
+	tab_list_init(&server);
+	wl_signal_init(&server.events.tab_map);
+	wl_signal_init(&server.events.tab_unmap);
+	wl_signal_init(&server.events.tab_activate);
+	wl_signal_init(&server.events.tab_title);
+	wl_signal_init(&server.events.tab_background);
+	wl_signal_init(&server.events.tab_move);
+
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < TEST_TABS; i++) {
+		tabs[i].server = &server;
+		tab_add(&tabs[i]);
+	}
+	tab_activate(&tabs[0]);
+}
+
+static void
+teardown(void)
+{
+	tab_list_finish(&server);
+}
+
+static bool
+run(const char *name)
+{
+	struct action action;
+	ck_assert_msg(action_parse(name, &action), "Failed to parse %s", name);
+	return action_run(&server, &action);
+}
+
+START_TEST(test_parse)
+{
+	struct action action;
+	ck_assert(action_parse("next_tab", &action));
+	ck_assert_int_eq(action.type, ACTION_NEXT_TAB);
+	ck_assert(action_parse("show_background_dialog", &action));
+	ck_assert_int_eq(action.type, ACTION_SHOW_BACKGROUND_DIALOG);
+	ck_assert(action_parse("last_used_tab", &action));
+	ck_assert_int_eq(action.type, ACTION_LAST_USED_TAB);
+
+	ck_assert(action_parse("move_tab_left", &action));
+	ck_assert_int_eq(action.type, ACTION_MOVE_TAB);
+	ck_assert_int_eq(action.arg, -1);
+	ck_assert(action_parse("move_tab_right", &action));
+	ck_assert_int_eq(action.arg, 1);
+	ck_assert(action_parse("switch_tab_back", &action));
+	ck_assert_int_eq(action.type, ACTION_SWITCH_TAB);
+	ck_assert_int_eq(action.arg, -1);
+
+	ck_assert(action_parse("focus_tab_1", &action));
+	ck_assert_int_eq(action.type, ACTION_FOCUS_TAB);
+	ck_assert_int_eq(action.arg, 1);
+	ck_assert(action_parse("focus_tab_14", &action));
+	ck_assert_int_eq(action.arg, 14);
+}
+END_TEST
+
+START_TEST(test_parse_invalid)
+{
+	struct action action;
+	ck_assert(!action_parse(NULL, &action));
+	ck_assert(!action_parse("", &action));
+	ck_assert(!action_parse("next_tab ", &action));
+	ck_assert(!action_parse("focus_tab", &action));
+	ck_assert(!action_parse("focus_tab_", &action));
+	ck_assert(!action_parse("focus_tab_0", &action));
+	ck_assert(!action_parse("focus_tab_01", &action));
+	ck_assert(!action_parse("focus_tab_-1", &action));
+	ck_assert(!action_parse("focus_tab_2x", &action));
+	ck_assert(!action_parse("focus_tab_1000", &action));
+	ck_assert(!action_parse("move_tab_up", &action));
+}
+END_TEST
+
+START_TEST(test_format)
+{
+	const char *names[] = {"next_tab", "close_tab", "last_used_tab", "move_tab_left", "move_tab_right",
+			       "switch_tab", "switch_tab_back", "toggle_stats_hud", "focus_tab_7"};
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		struct action action;
+		char buf[32];
+		ck_assert(action_parse(names[i], &action));
+		action_format(&action, buf, sizeof(buf));
+		ck_assert_str_eq(buf, names[i]);
+	}
+}
+END_TEST
+
+/* Test: tab numbers count the tabs shown in the tab bar, from 1 */
+START_TEST(test_run_focus_tab)
+{
+	tab_set_background(&tabs[1], true);
+
+	ck_assert(run("focus_tab_2"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[2]);
+	ck_assert(run("focus_tab_4"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[4]);
+	ck_assert(!run("focus_tab_5"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[4]);
+}
+END_TEST
+
+START_TEST(test_run_last_used_tab)
+{
+	ck_assert(run("focus_tab_4"));
+	ck_assert(run("last_used_tab"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[0]);
+	ck_assert(run("last_used_tab"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[3]);
+
+	/* Background tabs aren't brought back; tabs never active are next */
+	tab_set_background(&tabs[0], true);
+	ck_assert(run("last_used_tab"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[1]);
+
+	for (int i = 0; i < TEST_TABS; i++) {
+		tab_set_background(&tabs[i], i != 1);
+	}
+	ck_assert(!run("last_used_tab"));
+}
+END_TEST
+
+START_TEST(test_run_move_tab)
+{
+	ck_assert(!run("move_tab_left"));
+	ck_assert(run("move_tab_right"));
+	ck_assert_ptr_eq(tab_at(&server, 1), &tabs[0]);
+	ck_assert_ptr_eq(server.active_tab, &tabs[0]);
+
+	/* Moving follows the new position */
+	ck_assert(run("focus_tab_2"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[0]);
+}
+END_TEST
+
+START_TEST(test_run_next_prev)
+{
+	tab_set_background(&tabs[1], true);
+	ck_assert(run("next_tab"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[2]);
+	ck_assert(run("prev_tab"));
+	ck_assert(run("prev_tab"));
+	ck_assert_ptr_eq(server.active_tab, &tabs[4]);
+
+	server.active_tab = NULL;
+	ck_assert(!run("next_tab"));
+	ck_assert(!run("move_tab_right"));
+	ck_assert(!run("toggle_background"));
+}
+END_TEST
+
+START_TEST(test_run_overlays)
+{
+	launcher_toggles = 0;
+	background_dialog_toggles = 0;
+	tab_switcher_steps = 0;
+	ck_assert(run("open_launcher"));
+	ck_assert(run("show_background_dialog"));
+	ck_assert(run("switch_tab"));
+	ck_assert(run("switch_tab"));
+	ck_assert(run("switch_tab_back"));
+	ck_assert_int_eq(launcher_toggles, 1);
+	ck_assert_int_eq(background_dialog_toggles, 1);
+	ck_assert_int_eq(tab_switcher_steps, 1);
+
+	ck_assert(!action_run(&server, &(struct action){ACTION_NONE, 0}));
+}
+END_TEST
+
+Suite *
+action_suite(void)
+{
+	Suite *s = suite_create("action");
+
+	TCase *tc_parse = tcase_create("parse");
+	tcase_add_test(tc_parse, test_parse);
+	tcase_add_test(tc_parse, test_parse_invalid);
+	tcase_add_test(tc_parse, test_format);
+	suite_add_tcase(s, tc_parse);
+
+	TCase *tc_run = tcase_create("run");
+	tcase_add_checked_fixture(tc_run, setup, teardown);
+	tcase_add_test(tc_run, test_run_focus_tab);
+	tcase_add_test(tc_run, test_run_last_used_tab);
+	tcase_add_test(tc_run, test_run_move_tab);
+	tcase_add_test(tc_run, test_run_next_prev);
+	tcase_add_test(tc_run, test_run_overlays);
+	suite_add_tcase(s, tc_run);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = action_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
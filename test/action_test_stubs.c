@@ -0,0 +1,49 @@
+/*
+ * Stubs for action testing
+ *
+ * These stubs allow actions to be tested without the full WayMux server
+ * implementation; tab actions run against the real tab.c.
+ */
+
+#include "config.h"
+
+#include "background_dialog.h"
+#include "launcher.h"
+#include "tab_switcher.h"
+#if WAYMUX_HAS_STATS
+#include "stats_hud.h"
+#endif
+
+int launcher_toggles;
+int background_dialog_toggles;
+int tab_switcher_steps;
+
+void
+launcher_toggle(struct cg_launcher *launcher)
+{
+	(void)launcher;
+	launcher_toggles++;
+}
+
+void
+background_dialog_toggle(struct cg_background_dialog *dialog)
+{
+	(void)dialog;
+	background_dialog_toggles++;
+}
+
+bool
+tab_switcher_step(struct cg_tab_switcher *switcher, int delta)
+{
+	(void)switcher;
+	tab_switcher_steps += delta;
+	return true;
+}
+
+#if WAYMUX_HAS_STATS
+void
+stats_hud_toggle(struct cg_stats_hud *hud)
+{
+	(void)hud;
+}
+#endif
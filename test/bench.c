@@ -0,0 +1,243 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+#include "bench.h"
+
+/* How long each benchmark runs for, unless WAYMUX_BENCH_TIME_MS says otherwise */
+#define BENCH_DEFAULT_TIME_MS 200
+
+struct bench_result {
+	char *name;
+	uint64_t iterations;
+	double mean_ns;
+	double min_ns; /* Per operation, in the fastest batch */
+};
+
+static struct bench_result *results;
+static size_t result_count;
+static size_t result_capacity;
+
+static const char *filter;
+static uint64_t min_time_ns = BENCH_DEFAULT_TIME_MS * 1000000ULL;
+
+static uint64_t paused_ns;
+static uint64_t pause_start_ns;
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void
+bench_pause(void)
+{
+	pause_start_ns = now_ns();
+}
+
+void
+bench_resume(void)
+{
+	paused_ns += now_ns() - pause_start_ns;
+}
+
+static void
+add_result(const char *name, uint64_t iterations, uint64_t total_ns, double min_ns)
+{
+	if (result_count == result_capacity) {
+		result_capacity = result_capacity ? result_capacity * 2 : 32;
+		results = realloc(results, result_capacity * sizeof(*results));
+		if (!results) {
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+	results[result_count++] = (struct bench_result){
+		.name = strdup(name),
+		.iterations = iterations,
+		.mean_ns = (double)total_ns / (double)iterations,
+		.min_ns = min_ns,
+	};
+	fprintf(stderr, "%-48s %10.1f ns/op (min %.1f, %lu iterations)\n", name,
+		(double)total_ns / (double)iterations, min_ns, (unsigned long)iterations);
+}
+
+void
+bench_run(const char *name, bench_fn fn, void *data)
+{
+	if (filter && !strstr(name, filter)) {
+		return;
+	}
+
+	/* One call to warm caches, then batches that double in size until
+	 * they take a tenth of the run, so that timer overhead is noise */
+	fn(data);
+
+	uint64_t iterations = 0;
+	uint64_t total_ns = 0;
+	double min_ns = 0;
+	uint64_t batch = 1;
+	while (total_ns < min_time_ns) {
+		paused_ns = 0;
+		uint64_t start = now_ns();
+		for (uint64_t i = 0; i < batch; i++) {
+			fn(data);
+		}
+		uint64_t elapsed = now_ns() - start - paused_ns;
+
+		double per_op = (double)elapsed / (double)batch;
+		if (iterations == 0 || per_op < min_ns) {
+			min_ns = per_op;
+		}
+		iterations += batch;
+		total_ns += elapsed;
+		if (elapsed < min_time_ns / 10) {
+			batch *= 2;
+		}
+	}
+
+	add_result(name, iterations, total_ns, min_ns);
+}
+
+char *
+bench_make_dir(void)
+{
+	char *dir = strdup("/tmp/waymux_bench_XXXXXX");
+	if (!dir || !mkdtemp(dir)) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+	return dir;
+}
+
+static void
+remove_tree(const char *path)
+{
+	struct stat st;
+	if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+		DIR *dir = opendir(path);
+		struct dirent *ent;
+		while (dir && (ent = readdir(dir))) {
+			if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+				continue;
+			}
+			char child[4096];
+			snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
+			remove_tree(child);
+		}
+		if (dir) {
+			closedir(dir);
+		}
+		rmdir(path);
+	} else {
+		unlink(path);
+	}
+}
+
+void
+bench_remove_dir(char *dir)
+{
+	remove_tree(dir);
+	free(dir);
+}
+
+void
+bench_write_file(const char *path, const char *contents)
+{
+	FILE *file = fopen(path, "w");
+	if (!file || fputs(contents, file) < 0 || fclose(file) != 0) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+write_report(FILE *out)
+{
+	fprintf(out, "{\n  \"min_time_ms\": %lu,\n  \"benchmarks\": [\n", (unsigned long)(min_time_ns / 1000000));
+	for (size_t i = 0; i < result_count; i++) {
+		/* Benchmark names are plain ASCII, so need no escaping */
+		fprintf(out, "    {\"name\": \"%s\", \"iterations\": %lu, \"mean_ns\": %.1f, \"min_ns\": %.1f}%s\n",
+			results[i].name, (unsigned long)results[i].iterations, results[i].mean_ns, results[i].min_ns,
+			i + 1 < result_count ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-o FILE] [FILTER]\n"
+			"Run the benchmarks whose names contain FILTER and write the results\n"
+			"as JSON to FILE, or to standard output.\n",
+		name);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *output = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "ho:")) != -1) {
+		switch (opt) {
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind < argc) {
+		filter = argv[optind];
+	}
+
+	const char *time_ms = getenv("WAYMUX_BENCH_TIME_MS");
+	if (time_ms && atoi(time_ms) > 0) {
+		min_time_ns = (uint64_t)atoi(time_ms) * 1000000ULL;
+	}
+
+	/* The code under test logs at debug level on every call */
+	wlr_log_init(WLR_ERROR, NULL);
+
+	control_bench();
+	desktop_entry_bench();
+	keybinding_bench();
+	profile_bench();
+	tab_bar_bench();
+
+	FILE *out = output ? fopen(output, "w") : stdout;
+	if (!out) {
+		perror(output);
+		return EXIT_FAILURE;
+	}
+	write_report(out);
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	for (size_t i = 0; i < result_count; i++) {
+		free(results[i].name);
+	}
+	free(results);
+	return EXIT_SUCCESS;
+}
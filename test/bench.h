@@ -0,0 +1,46 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_BENCH_H
+#define CG_BENCH_H
+
+#include <stdbool.h>
+
+/*
+ * A minimal microbenchmark harness. Each benchmark is a function that
+ * performs one operation; bench_run() calls it in growing batches until
+ * enough time has passed, and the results are written as one JSON
+ * document when all benchmarks are done, so runs can be compared between
+ * releases.
+ */
+
+typedef void (*bench_fn)(void *data);
+
+/* Time fn and add it to the report under name. A benchmark may call
+ * bench_pause() and bench_resume() around per-operation setup. */
+void bench_run(const char *name, bench_fn fn, void *data);
+
+void bench_pause(void);
+void bench_resume(void);
+
+/* Create a temporary directory for a benchmark's files, fatal on error.
+ * Removed with everything in it by bench_remove_dir(). */
+char *bench_make_dir(void);
+void bench_remove_dir(char *dir);
+
+/* Write a file, fatal on error */
+void bench_write_file(const char *path, const char *contents);
+
+/* Benchmark suites, one per module */
+void control_bench(void);
+void desktop_entry_bench(void);
+void keybinding_bench(void);
+void profile_bench(void);
+void tab_bar_bench(void);
+
+#endif
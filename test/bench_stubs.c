@@ -0,0 +1,43 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+/*
+ * Stubs for the benchmarks, on top of control_test_stubs.c
+ *
+ * The tab bar is benchmarked on a real scene graph, but without outputs
+ * or real views.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "output.h"
+#include "server.h"
+#include "view.h"
+
+/* Stub for output_schedule_frames called by tab_bar_schedule_update */
+void
+output_schedule_frames(struct cg_server *server)
+{
+	(void)server;
+}
+
+/* Stub for view_position_all called when the tab bar is shown or hidden */
+void
+view_position_all(struct cg_server *server)
+{
+	(void)server;
+}
+
+/* Stub for output_ui_scale: the bench has no outputs */
+float
+output_ui_scale(struct cg_server *server, struct cg_output *output)
+{
+	(void)server;
+	(void)output;
+	return 1;
+}
@@ -0,0 +1,150 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+
+#include "bench.h"
+#include "control.h"
+#include "server.h"
+#include "tab.h"
+#include "view.h"
+
+#define MAX_TABS 256
+
+struct control_bench {
+	struct cg_server server;
+	struct cg_control_server *control;
+	int client_fd;
+
+	struct cg_tab tabs[MAX_TABS];
+	struct cg_view views[MAX_TABS];
+	char titles[MAX_TABS][32];
+
+	const char *command;
+	size_t command_len;
+	char response[65536];
+};
+
+static void
+set_tab_count(struct control_bench *bench, int count)
+{
+	wl_list_init(&bench->server.tabs);
+	for (int i = 0; i < count; i++) {
+		struct cg_tab *tab = &bench->tabs[i];
+		struct cg_view *view = &bench->views[i];
+		memset(tab, 0, sizeof(*tab));
+		memset(view, 0, sizeof(*view));
+		snprintf(bench->titles[i], sizeof(bench->titles[i]), "~/src/project%d: vim", i);
+		view->title = bench->titles[i];
+		view->app_id = "foot";
+		tab->id = i + 1;
+		tab->view = view;
+		tab->server = &bench->server;
+		wl_list_insert(bench->server.tabs.prev, &tab->link);
+	}
+	bench->server.active_tab = count > 0 ? &bench->tabs[0] : NULL;
+}
+
+/* Send one command on the session and run the event loop until its
+ * response, which ends with an empty line, is back */
+static void
+bench_round_trip(void *data)
+{
+	struct control_bench *bench = data;
+	struct wl_event_loop *loop = wl_display_get_event_loop(bench->server.wl_display);
+
+	if (send(bench->client_fd, bench->command, bench->command_len, 0) != (ssize_t)bench->command_len) {
+		perror("send");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t got = 0;
+	while (got < 2 || bench->response[got - 1] != '\n' || bench->response[got - 2] != '\n') {
+		wl_event_loop_dispatch(loop, 100);
+		ssize_t n = recv(bench->client_fd, bench->response + got, sizeof(bench->response) - got,
+				 MSG_DONTWAIT);
+		if (n > 0) {
+			got += n;
+		}
+		if (got == sizeof(bench->response)) {
+			fprintf(stderr, "Control response too large\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+void
+control_bench(void)
+{
+	static struct control_bench bench;
+	struct cg_server *server = &bench.server;
+	wl_list_init(&server->views);
+	wl_list_init(&server->outputs);
+	wl_list_init(&server->tabs);
+	wl_signal_init(&server->events.tab_map);
+	wl_signal_init(&server->events.tab_unmap);
+	wl_signal_init(&server->events.tab_activate);
+	wl_signal_init(&server->events.tab_title);
+	wl_signal_init(&server->events.tab_background);
+	wl_signal_init(&server->events.tab_move);
+	server->wl_display = wl_display_create();
+
+	bench.control = control_server_create(server);
+	if (!bench.control) {
+		fprintf(stderr, "Failed to create the control server\n");
+		exit(EXIT_FAILURE);
+	}
+
+	bench.client_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	strncpy(addr.sun_path, bench.control->socket_path, sizeof(addr.sun_path) - 1);
+	if (connect(bench.client_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		perror("connect");
+		exit(EXIT_FAILURE);
+	}
+
+	/* A session, so that one connection serves every round trip */
+	bench.command = "session\n";
+	bench.command_len = strlen(bench.command);
+	bench_round_trip(&bench);
+
+	static const struct {
+		const char *command;
+		int tabs;
+	} runs[] = {
+		{"list-tabs\n", 0},
+		{"list-tabs\n", 10},
+		{"list-tabs\n", 100},
+		{"list-tabs\n", 256},
+		{"--json list-tabs\n", 100},
+		{"focus-tab 1\n", 100},
+	};
+	for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+		set_tab_count(&bench, runs[i].tabs);
+		bench.command = runs[i].command;
+		bench.command_len = strlen(runs[i].command);
+
+		char name[64];
+		snprintf(name, sizeof(name), "control_round_trip/%.*s/%d", (int)bench.command_len - 1,
+			 bench.command, runs[i].tabs);
+		bench_run(name, bench_round_trip, &bench);
+	}
+
+	close(bench.client_fd);
+	control_server_destroy(bench.control);
+	wl_list_init(&server->tabs);
+	wl_display_destroy(server->wl_display);
+}
@@ -21,6 +21,9 @@
 
 #include "server.h"
 #include "control.h"
+#include "output.h"
+#include "tab.h"
+#include "view.h"
 
 /* Minimal server setup for testing */
 static struct cg_server *
@@ -36,6 +39,12 @@ create_test_server(void)
 	wl_list_init(&server->outputs);
 	wl_list_init(&server->tabs);
 	server->active_tab = NULL;
+	wl_signal_init(&server->events.tab_map);
+	wl_signal_init(&server->events.tab_unmap);
+	wl_signal_init(&server->events.tab_activate);
+	wl_signal_init(&server->events.tab_title);
+	wl_signal_init(&server->events.tab_background);
+	wl_signal_init(&server->events.tab_move);
 
 	/* Create minimal Wayland display for event loop */
 	server->wl_display = wl_display_create();
@@ -208,6 +217,466 @@ START_TEST(test_control_multiple_clients)
 }
 END_TEST
 
+/* Connect a client to the control socket */
+static int
+connect_client(struct cg_control_server *control)
+{
+	int client_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	ck_assert_int_gt(client_fd, 0);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, control->socket_path, sizeof(addr.sun_path) - 1);
+	ck_assert_int_eq(connect(client_fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+
+	return client_fd;
+}
+
+/* Run the server's event loop until len bytes of response have arrived */
+static void
+read_response(struct cg_server *server, int fd, char *buffer, size_t len)
+{
+	struct wl_event_loop *loop = wl_display_get_event_loop(server->wl_display);
+	size_t got = 0;
+
+	for (int i = 0; i < 100 && got < len; i++) {
+		wl_event_loop_dispatch(loop, 10);
+		ssize_t n = recv(fd, buffer + got, len - got, MSG_DONTWAIT);
+		if (n > 0) {
+			got += n;
+		}
+	}
+	buffer[got] = '\0';
+}
+
+/* Test: a session answers pipelined commands on one connection */
+START_TEST(test_control_session)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	int client_fd = connect_client(control);
+	const char *commands = "session\n@1 list-tabs\n@2 bogus\nlist-tabs\n";
+	ck_assert_int_eq(send(client_fd, commands, strlen(commands), 0), (ssize_t)strlen(commands));
+
+	const char *expected = "OK session\n\n@1 OK 0\n\n@2 ERROR Unknown command\n\nOK 0\n\n";
+	char buffer[256];
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+
+	/* The connection is still usable */
+	ck_assert_int_eq(send(client_fd, "@x list-tabs\n", 13, 0), 13);
+	read_response(server, client_fd, buffer, strlen("@x OK 0\n\n"));
+	ck_assert_str_eq(buffer, "@x OK 0\n\n");
+
+	close(client_fd);
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: without a session, the response is followed by EOF */
+START_TEST(test_control_single_command)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	int client_fd = connect_client(control);
+	ck_assert_int_eq(send(client_fd, "list-tabs\n", 10, 0), 10);
+
+	char buffer[64];
+	read_response(server, client_fd, buffer, strlen("OK 0\n"));
+	ck_assert_str_eq(buffer, "OK 0\n");
+	ck_assert_int_eq(recv(client_fd, buffer, sizeof(buffer), 0), 0);
+
+	close(client_fd);
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: subscribers receive tab events until they disconnect */
+START_TEST(test_control_subscribe)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	int client_fd = connect_client(control);
+	ck_assert_int_eq(send(client_fd, "subscribe\n", 10, 0), 10);
+
+	char buffer[256];
+	read_response(server, client_fd, buffer, strlen("OK subscribed\n"));
+	ck_assert_str_eq(buffer, "OK subscribed\n");
+
+	struct cg_tab tab1, tab2;
+	memset(&tab1, 0, sizeof(tab1));
+	memset(&tab2, 0, sizeof(tab2));
+	tab1.id = 1;
+	tab2.id = 2;
+	tab1.server = server;
+	tab2.server = server;
+	wl_list_insert(server->tabs.prev, &tab1.link);
+	wl_list_insert(server->tabs.prev, &tab2.link);
+
+	wl_signal_emit_mutable(&server->events.tab_map, &tab2);
+	tab2.is_background = true;
+	wl_signal_emit_mutable(&server->events.tab_background, &tab2);
+	wl_signal_emit_mutable(&server->events.tab_activate, &tab1);
+
+	const char *expected = "EVENT map 1: id:2 [(unknown)] (unnamed)\n"
+			       "EVENT background 1: id:2 [(unknown)] [H] (unnamed)\n"
+			       "EVENT activate 0: id:1 [(unknown)] (unnamed)\n";
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+
+	/* The server notices the hangup and stops sending */
+	close(client_fd);
+	wl_event_loop_dispatch(wl_display_get_event_loop(server->wl_display), 10);
+	wl_signal_emit_mutable(&server->events.tab_unmap, &tab2);
+
+	wl_list_remove(&tab1.link);
+	wl_list_remove(&tab2.link);
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: a subscriber that stops reading is told once that it missed
+ * events, and gets events again after it caught up */
+START_TEST(test_control_subscribe_overflow)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+	struct wl_event_loop *loop = wl_display_get_event_loop(server->wl_display);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	int client_fd = connect_client(control);
+	ck_assert_int_eq(send(client_fd, "subscribe\n", 10, 0), 10);
+
+	char reply[32];
+	read_response(server, client_fd, reply, strlen("OK subscribed\n"));
+	ck_assert_str_eq(reply, "OK subscribed\n");
+
+	enum { EVENT_COUNT = 3000, TITLE_LEN = 1000 };
+	char *title = malloc(TITLE_LEN + 1);
+	memset(title, 'x', TITLE_LEN);
+	title[TITLE_LEN] = '\0';
+	struct cg_view view;
+	struct cg_tab tab;
+	memset(&view, 0, sizeof(view));
+	memset(&tab, 0, sizeof(tab));
+	view.title = title;
+	tab.id = 1;
+	tab.view = &view;
+	tab.server = server;
+	wl_list_insert(server->tabs.prev, &tab.link);
+
+	/* Far more than the server queues, while the client reads nothing */
+	for (int i = 0; i < EVENT_COUNT; i++) {
+		wl_signal_emit_mutable(&server->events.tab_title, &tab);
+	}
+
+	/* Read until the server has nothing left to send */
+	const char *overflow = "EVENT overflow\n";
+	size_t size = (size_t)EVENT_COUNT * (TITLE_LEN + 64);
+	char *buffer = malloc(size + 1);
+	size_t got = 0;
+	int idle = 0;
+	for (int i = 0; i < 2000 && idle < 5; i++) {
+		wl_event_loop_dispatch(loop, 10);
+		ssize_t n = recv(client_fd, buffer + got, size - got, MSG_DONTWAIT);
+		if (n > 0) {
+			got += n;
+			idle = 0;
+		} else {
+			idle++;
+		}
+	}
+	buffer[got] = '\0';
+
+	/* Only part of the events arrived, then the overflow and nothing else */
+	ck_assert_uint_gt(got, strlen(overflow));
+	ck_assert_uint_lt(got, (size_t)EVENT_COUNT * TITLE_LEN);
+	ck_assert_str_eq(buffer + got - strlen(overflow), overflow);
+	ck_assert_ptr_eq(strstr(buffer, overflow), buffer + got - strlen(overflow));
+	ck_assert_int_eq(strncmp(buffer, "EVENT title 0: id:1 [(unknown)] xxx", 35), 0);
+
+	/* Caught up, so events flow again */
+	wl_signal_emit_mutable(&server->events.tab_title, &tab);
+	size_t expected_len = strlen("EVENT title 0: id:1 [(unknown)] \n") + TITLE_LEN;
+	read_response(server, client_fd, buffer, expected_len);
+	ck_assert_uint_eq(strlen(buffer), expected_len);
+	ck_assert_int_eq(strncmp(buffer, "EVENT title 0: id:1 [(unknown)] xxx", 35), 0);
+
+	close(client_fd);
+	wl_list_remove(&tab.link);
+	control_server_destroy(control);
+	free(buffer);
+	free(title);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: tabs can be addressed by their stable ID */
+START_TEST(test_control_tab_ids)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	struct cg_tab tab;
+	memset(&tab, 0, sizeof(tab));
+	tab.id = 7;
+	wl_list_insert(server->tabs.prev, &tab.link);
+
+	int client_fd = connect_client(control);
+	const char *commands = "session\nbackground id:7\nbackground id:8\nbackground id:x\nbackground 1\n";
+	ck_assert_int_eq(send(client_fd, commands, strlen(commands), 0), (ssize_t)strlen(commands));
+
+	const char *expected = "OK session\n\nOK\n\nERROR No tab with that ID\n\n"
+			       "ERROR Invalid tab ID\n\nERROR Tab index out of range\n\n";
+	char buffer[256];
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+
+	close(client_fd);
+	wl_list_remove(&tab.link);
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: --json responses, with the request ID as a member */
+START_TEST(test_control_json)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	struct cg_view view;
+	memset(&view, 0, sizeof(view));
+	view.title = "say \"hi\"\t\\";
+	struct cg_tab tab1, tab2;
+	memset(&tab1, 0, sizeof(tab1));
+	memset(&tab2, 0, sizeof(tab2));
+	tab1.id = 1;
+	tab2.id = 2;
+	tab2.view = &view;
+	tab2.is_background = true;
+	wl_list_insert(server->tabs.prev, &tab1.link);
+	wl_list_insert(server->tabs.prev, &tab2.link);
+	server->active_tab = &tab1;
+
+	int client_fd = connect_client(control);
+	const char *commands = "session\n@1 --json list-tabs\n--json focus-tab x\n";
+	ck_assert_int_eq(send(client_fd, commands, strlen(commands), 0), (ssize_t)strlen(commands));
+
+	const char *expected =
+		"OK session\n\n"
+		"{\"id\":\"1\",\"ok\":true,\"tabs\":["
+		"{\"index\":0,\"id\":1,\"app_id\":null,\"title\":null,\"background\":false,\"active\":true,\"output\":null,"
+		"\"pid\":null,\"memory\":null,\"cpu\":null,\"gpu\":false,\"cgroup\":false},"
+		"{\"index\":1,\"id\":2,\"app_id\":null,\"title\":\"say \\\"hi\\\"\\u0009\\\\\",\"background\":true,"
+		"\"active\":false,\"output\":null,\"pid\":null,\"memory\":null,\"cpu\":null,\"gpu\":false,\"cgroup\":false}]}\n\n"
+		"{\"ok\":false,\"error\":\"Invalid tab index\"}\n\n";
+	char buffer[512];
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+
+	close(client_fd);
+	wl_list_remove(&tab1.link);
+	wl_list_remove(&tab2.link);
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: outputs are listed, and tabs sent between them when separate */
+START_TEST(test_control_outputs)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	struct wlr_output wlr_output;
+	memset(&wlr_output, 0, sizeof(wlr_output));
+	wlr_output.name = "HDMI-A-1";
+	struct cg_output output;
+	memset(&output, 0, sizeof(output));
+	output.wlr_output = &wlr_output;
+	wl_list_insert(&server->outputs, &output.link);
+
+	struct cg_tab tab;
+	memset(&tab, 0, sizeof(tab));
+	tab.id = 3;
+	wl_list_insert(server->tabs.prev, &tab.link);
+
+	int client_fd = connect_client(control);
+	const char *commands = "session\nfocus-output HDMI-A-1\nlist-outputs\n";
+	ck_assert_int_eq(send(client_fd, commands, strlen(commands), 0), (ssize_t)strlen(commands));
+
+	const char *expected = "OK session\n\nERROR Outputs aren't separate\n\nOK 1\n0: HDMI-A-1 0x0+0+0\n\n";
+	char buffer[256];
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+
+	server->output_mode = WAYMUX_MULTI_OUTPUT_MODE_SEPARATE;
+	commands = "focus-output HDMI-A-1\nsend-to-output id:3 DP-1\nsend-to-output id:3 HDMI-A-1\n"
+		   "--json list-outputs\n";
+	ck_assert_int_eq(send(client_fd, commands, strlen(commands), 0), (ssize_t)strlen(commands));
+
+	expected = "ERROR No tab on that output\n\nERROR No such output\n\nOK\n\n"
+		   "{\"ok\":true,\"outputs\":[{\"index\":0,\"name\":\"HDMI-A-1\",\"x\":0,\"y\":0,"
+		   "\"width\":0,\"height\":0,\"focused\":false,\"active_tab\":null,\"tabs\":1}]}\n\n";
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+	ck_assert_ptr_eq(tab.output, &output);
+
+	close(client_fd);
+	wl_list_remove(&tab.link);
+	wl_list_remove(&output.link);
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: a response larger than the socket buffer arrives intact */
+START_TEST(test_control_large_response)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	enum { TAB_COUNT = 2000, TITLE_LEN = 1000 };
+	char *title = malloc(TITLE_LEN + 1);
+	memset(title, 'x', TITLE_LEN);
+	title[TITLE_LEN] = '\0';
+	struct cg_view *views = calloc(TAB_COUNT, sizeof(*views));
+	struct cg_tab *tabs = calloc(TAB_COUNT, sizeof(*tabs));
+	for (int i = 0; i < TAB_COUNT; i++) {
+		views[i].title = title;
+		tabs[i].view = &views[i];
+		wl_list_insert(server->tabs.prev, &tabs[i].link);
+	}
+
+	int client_fd = connect_client(control);
+	ck_assert_int_eq(send(client_fd, "list-tabs\n", 10, 0), 10);
+
+	size_t expected_len = snprintf(NULL, 0, "OK %d\n", TAB_COUNT);
+	for (int i = 0; i < TAB_COUNT; i++) {
+		expected_len += snprintf(NULL, 0, "%d: id:0 [(unknown)] %s\n", i, title);
+	}
+	char *buffer = malloc(expected_len + 1);
+	read_response(server, client_fd, buffer, expected_len);
+	ck_assert_uint_eq(strlen(buffer), expected_len);
+	ck_assert_int_eq(strncmp(buffer, "OK 2000\n0: id:0 [(unknown)] xxx", 31), 0);
+
+	char last[16];
+	snprintf(last, sizeof(last), "\n%d: id:0 [", TAB_COUNT - 1);
+	ck_assert_ptr_nonnull(strstr(buffer, last));
+
+	/* EOF only follows once everything was written */
+	ck_assert_int_eq(recv(client_fd, buffer, expected_len, 0), 0);
+
+	close(client_fd);
+	free(buffer);
+	control_server_destroy(control);
+	free(tabs);
+	free(views);
+	free(title);
+	destroy_test_server(server);
+}
+END_TEST
+
+/* Test: actions run through the action registry */
+START_TEST(test_control_action)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	struct cg_tab tabs[3];
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < 3; i++) {
+		tabs[i].id = i + 1;
+		tabs[i].server = server;
+		wl_list_insert(server->tabs.prev, &tabs[i].link);
+	}
+	tabs[0].is_background = true;
+
+	int client_fd = connect_client(control);
+	const char *commands = "session\naction focus_tab_2\naction focus_tab_3\naction last_used_tab\n"
+			       "action focus_tab_0\naction sleep\n";
+	ck_assert_int_eq(send(client_fd, commands, strlen(commands), 0), (ssize_t)strlen(commands));
+
+	/* Tab numbers count foreground tabs only, and there is no last used
+	 * tab without a real tab_activate() */
+	const char *expected = "OK session\n\nOK\n\nERROR Nothing to do\n\nERROR Nothing to do\n\n"
+			       "ERROR Unknown action\n\nERROR Unknown action\n\n";
+	char buffer[256];
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+	ck_assert_ptr_eq(server->active_tab, &tabs[2]);
+
+	close(client_fd);
+	for (int i = 0; i < 3; i++) {
+		wl_list_remove(&tabs[i].link);
+	}
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
+START_TEST(test_control_stats)
+{
+	struct cg_server *server = create_test_server();
+	ck_assert_ptr_nonnull(server);
+
+	struct cg_control_server *control = control_server_create(server);
+	ck_assert_ptr_nonnull(control);
+
+	int client_fd = connect_client(control);
+	const char *commands = "session\nstats hud\nstats bogus\n--json stats\n";
+	ck_assert_int_eq(send(client_fd, commands, strlen(commands), 0), (ssize_t)strlen(commands));
+
+#if WAYMUX_HAS_STATS
+	const char *expected = "OK session\n\nOK\n\nERROR Unknown stats command\n\n{\"ok\":true,\"stats\":{\"frame\":";
+#else
+	const char *expected = "OK session\n\nERROR Not built with stats\n\nERROR Not built with stats\n\n"
+			       "{\"ok\":false,\"error\":\"Not built with stats\"}\n";
+#endif
+	char buffer[256];
+	read_response(server, client_fd, buffer, strlen(expected));
+	ck_assert_str_eq(buffer, expected);
+
+	close(client_fd);
+	control_server_destroy(control);
+	destroy_test_server(server);
+}
+END_TEST
+
 Suite *
 control_suite(void)
 {
@@ -224,6 +693,16 @@ control_suite(void)
 	TCase *tc_network = tcase_create("Network");
 	tcase_add_test(tc_network, test_control_client_connect);
 	tcase_add_test(tc_network, test_control_multiple_clients);
+	tcase_add_test(tc_network, test_control_single_command);
+	tcase_add_test(tc_network, test_control_session);
+	tcase_add_test(tc_network, test_control_subscribe);
+	tcase_add_test(tc_network, test_control_subscribe_overflow);
+	tcase_add_test(tc_network, test_control_tab_ids);
+	tcase_add_test(tc_network, test_control_json);
+	tcase_add_test(tc_network, test_control_outputs);
+	tcase_add_test(tc_network, test_control_large_response);
+	tcase_add_test(tc_network, test_control_action);
+	tcase_add_test(tc_network, test_control_stats);
 	suite_add_tcase(s, tc_network);
 
 	return s;
@@ -5,21 +5,117 @@
  * WayMux server implementation.
  */
 
+#include "config.h"
+
+#include <string.h>
+
+#include "background_dialog.h"
+#include "config_reload.h"
+#include "launcher.h"
+#include "output.h"
+#include "session.h"
 #include "tab.h"
+#include "tab_switcher.h"
 #include "view.h"
+#if WAYMUX_HAS_STATS
+#include "stats_hud.h"
+#endif
 
 /* Tab stubs */
 int
 tab_count(struct cg_server *server)
+{
+	return wl_list_length(&server->tabs);
+}
+
+struct cg_tab *
+tab_from_id(struct cg_server *server, uint32_t id)
+{
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (tab->id == id) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+struct cg_tab *
+tab_at(struct cg_server *server, int index)
+{
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (index-- == 0) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+struct cg_tab *
+tab_foreground_at(struct cg_server *server, int index)
+{
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (!tab->is_background && index-- == 0) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+struct cg_tab *
+tab_output_foreground_at(struct cg_server *server, struct cg_output *output, int index)
+{
+	(void)output;
+	return tab_foreground_at(server, index);
+}
+
+int
+tab_index(struct cg_tab *tab)
+{
+	int index = 0;
+	struct cg_tab *t;
+	wl_list_for_each(t, &tab->server->tabs, link) {
+		if (t == tab) {
+			return index;
+		}
+		index++;
+	}
+	return -1;
+}
+
+struct cg_tab *
+tab_next(struct cg_tab *current)
+{
+	return current;
+}
+
+struct cg_tab *
+tab_prev(struct cg_tab *current)
+{
+	return current;
+}
+
+struct cg_tab *
+tab_last_used(struct cg_server *server)
 {
 	(void)server;
-	return 0;
+	return NULL;
+}
+
+bool
+tab_move(struct cg_tab *tab, int offset)
+{
+	(void)tab;
+	(void)offset;
+	return false;
 }
 
 void
 tab_activate(struct cg_tab *tab)
 {
-	(void)tab;
+	tab->server->active_tab = tab;
 }
 
 void
@@ -35,22 +131,112 @@ tab_destroy(struct cg_tab *tab)
 	(void)tab;
 }
 
+void
+tab_set_output(struct cg_tab *tab, struct cg_output *output)
+{
+	tab->output = output;
+}
+
+/* Output stubs */
+struct cg_output *
+output_focused(struct cg_server *server)
+{
+	(void)server;
+	return NULL;
+}
+
+struct cg_output *
+output_from_name(struct cg_server *server, const char *name)
+{
+	struct cg_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (strcmp(output->wlr_output->name, name) == 0) {
+			return output;
+		}
+	}
+	return NULL;
+}
+
+void
+wlr_output_layout_get_box(struct wlr_output_layout *layout, struct wlr_output *reference, struct wlr_box *dest_box)
+{
+	(void)layout;
+	(void)reference;
+	*dest_box = (struct wlr_box){0};
+}
+
 /* View stubs */
-char *
+const char *
 view_get_title(struct cg_view *view)
 {
-	(void)view;
-	return NULL;
+	return view->title;
 }
 
-char *
+const char *
 view_get_app_id(struct cg_view *view)
 {
+	return view->app_id;
+}
+
+pid_t
+view_get_pid(struct cg_view *view)
+{
+	/* Test views have no client */
 	(void)view;
-	return NULL;
+	return 0;
 }
 
 /* Launcher stub - this should be in launcher.c, but we need to stub it here for testing */
 void launcher_show(struct cg_launcher *launcher) {
 	(void)launcher;
 }
+
+void
+launcher_toggle(struct cg_launcher *launcher)
+{
+	(void)launcher;
+}
+
+bool
+config_reload(struct cg_server *server)
+{
+	(void)server;
+	return true;
+}
+
+char *
+session_path(const char *name)
+{
+	(void)name;
+	return NULL;
+}
+
+int
+session_save(struct cg_server *server, const char *path)
+{
+	(void)server;
+	(void)path;
+	return -1;
+}
+
+void
+background_dialog_toggle(struct cg_background_dialog *dialog)
+{
+	(void)dialog;
+}
+
+bool
+tab_switcher_step(struct cg_tab_switcher *switcher, int delta)
+{
+	(void)switcher;
+	(void)delta;
+	return false;
+}
+
+#if WAYMUX_HAS_STATS
+void
+stats_hud_toggle(struct cg_stats_hud *hud)
+{
+	(void)hud;
+}
+#endif
@@ -0,0 +1,254 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "desktop_cache.h"
+#include "desktop_entry.h"
+
+static char tmp_dir[64];
+static char apps_dir[128];
+static char cache_path[128];
+
+static void
+write_file(const char *name, const char *contents)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", apps_dir, name);
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+static void
+setup(void)
+{
+	snprintf(tmp_dir, sizeof(tmp_dir), "/tmp/waymux-cache-test-XXXXXX");
+	ck_assert_ptr_nonnull(mkdtemp(tmp_dir));
+	snprintf(apps_dir, sizeof(apps_dir), "%s/applications", tmp_dir);
+	ck_assert_int_eq(mkdir(apps_dir, 0700), 0);
+	snprintf(cache_path, sizeof(cache_path), "%s/cache/waymux/desktop-entries.cache", tmp_dir);
+
+	write_file("firefox.desktop", "[Desktop Entry]\nName=Firefox\nExec=firefox %u\n"
+				      "GenericName=Web Browser\nKeywords=Internet;WWW;\n");
+	write_file("foot.desktop", "[Desktop Entry]\nName=Foot\nExec=foot\nNoDisplay=true\n");
+	write_file("broken.desktop", "[Desktop Entry]\nComment=No name or exec\n");
+}
+
+static void
+teardown(void)
+{
+	char cmd[128];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", tmp_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+static struct cg_desktop_entry_manager *
+load(void)
+{
+	const char *dirs[] = {apps_dir, NULL};
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	ck_assert_ptr_nonnull(manager);
+	ck_assert_int_eq(desktop_entry_manager_load_dirs(manager, dirs, cache_path), 2);
+	return manager;
+}
+
+static struct cg_desktop_entry *
+find_entry(struct cg_desktop_entry_manager *manager, const char *name)
+{
+	for (size_t i = 0; i < manager->entries.count; i++) {
+		if (strcmp(manager->entries.entries[i].name, name) == 0) {
+			return &manager->entries.entries[i];
+		}
+	}
+	return NULL;
+}
+
+/* Test: a cold load parses every file and writes the cache */
+START_TEST(test_cache_cold_load)
+{
+	struct cg_desktop_entry_manager *manager = load();
+	ck_assert_uint_eq(manager->files_parsed, 3);
+	ck_assert_uint_eq(manager->files_from_cache, 0);
+	ck_assert_int_eq(access(cache_path, R_OK), 0);
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: a warm load reads nothing but the cache, and gets the same entries */
+START_TEST(test_cache_warm_load)
+{
+	desktop_entry_manager_destroy(load());
+
+	struct cg_desktop_entry_manager *manager = load();
+	ck_assert_uint_eq(manager->files_parsed, 0);
+	ck_assert_uint_eq(manager->files_from_cache, 3);
+
+	struct cg_desktop_entry *firefox = find_entry(manager, "Firefox");
+	ck_assert_ptr_nonnull(firefox);
+	ck_assert_str_eq(firefox->exec, "firefox %u");
+	ck_assert_str_eq(firefox->generic_name, "Web Browser");
+	ck_assert_str_eq(firefox->keywords, "Internet;WWW;");
+	ck_assert_ptr_null(firefox->icon);
+	ck_assert(!firefox->nodisplay);
+	ck_assert_str_eq(firefox->dir, apps_dir);
+	ck_assert_str_eq(firefox->file_name, "firefox.desktop");
+
+	struct cg_desktop_entry *foot = find_entry(manager, "Foot");
+	ck_assert_ptr_nonnull(foot);
+	ck_assert(foot->nodisplay);
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: only changed and new files are re-parsed */
+START_TEST(test_cache_changed_files)
+{
+	desktop_entry_manager_destroy(load());
+
+	write_file("firefox.desktop", "[Desktop Entry]\nName=Firefox ESR\nExec=firefox-esr\n");
+	write_file("gimp.desktop", "[Desktop Entry]\nName=GIMP\nExec=gimp\n");
+
+	const char *dirs[] = {apps_dir, NULL};
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	ck_assert_int_eq(desktop_entry_manager_load_dirs(manager, dirs, cache_path), 3);
+	ck_assert_uint_eq(manager->files_parsed, 2);
+	ck_assert_uint_eq(manager->files_from_cache, 2);
+	ck_assert_ptr_nonnull(find_entry(manager, "Firefox ESR"));
+	ck_assert_ptr_nonnull(find_entry(manager, "GIMP"));
+	desktop_entry_manager_destroy(manager);
+
+	/* And the rewritten cache covers them all */
+	manager = desktop_entry_manager_create();
+	ck_assert_int_eq(desktop_entry_manager_load_dirs(manager, dirs, cache_path), 3);
+	ck_assert_uint_eq(manager->files_parsed, 0);
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: a corrupt cache file is ignored */
+START_TEST(test_cache_corrupt)
+{
+	desktop_entry_manager_destroy(load());
+
+	FILE *f = fopen(cache_path, "r+");
+	ck_assert_ptr_nonnull(f);
+	fputs("garbage", f);
+	fclose(f);
+	ck_assert_ptr_null(desktop_cache_open(cache_path));
+
+	struct cg_desktop_entry_manager *manager = load();
+	ck_assert_uint_eq(manager->files_parsed, 3);
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+static int changed_count;
+
+static void
+handle_changed(struct wl_listener *listener, void *data)
+{
+	changed_count++;
+}
+
+/* Test: background loading hands entries to the event loop */
+START_TEST(test_load_async)
+{
+	char cache_home[128];
+	snprintf(cache_home, sizeof(cache_home), "%s/cache", tmp_dir);
+	setenv("XDG_DATA_HOME", tmp_dir, 1);
+	setenv("XDG_CACHE_HOME", cache_home, 1);
+
+	struct wl_event_loop *loop = wl_event_loop_create();
+	ck_assert_ptr_nonnull(loop);
+
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	struct wl_listener changed = {.notify = handle_changed};
+	wl_signal_add(&manager->events.changed, &changed);
+	changed_count = 0;
+
+	ck_assert_int_eq(desktop_entry_manager_load_async(manager, loop), 0);
+	ck_assert(manager->loading);
+
+	for (int i = 0; i < 1000 && manager->loading; i++) {
+		wl_event_loop_dispatch(loop, 10);
+	}
+
+	ck_assert(!manager->loading);
+	ck_assert_int_gt(changed_count, 0);
+	ck_assert_ptr_nonnull(find_entry(manager, "Firefox"));
+	ck_assert_int_eq(access(cache_path, R_OK), 0);
+
+	struct cg_desktop_entry *results[10];
+	ck_assert_uint_ge(desktop_entry_manager_search(manager, "web browser", results, 10), 1);
+
+	wl_list_remove(&changed.link);
+	desktop_entry_manager_destroy(manager);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+/* Test: destroying the manager mid-load stops the worker */
+START_TEST(test_load_async_cancel)
+{
+	setenv("XDG_DATA_HOME", tmp_dir, 1);
+	setenv("XDG_CACHE_HOME", tmp_dir, 1);
+
+	struct wl_event_loop *loop = wl_event_loop_create();
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	ck_assert_int_eq(desktop_entry_manager_load_async(manager, loop), 0);
+
+	/* Should not crash or leak */
+	desktop_entry_manager_destroy(manager);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+Suite *
+desktop_cache_suite(void)
+{
+	Suite *s = suite_create("desktop_cache");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_cache_cold_load);
+	tcase_add_test(tc_core, test_cache_warm_load);
+	tcase_add_test(tc_core, test_cache_changed_files);
+	tcase_add_test(tc_core, test_cache_corrupt);
+	suite_add_tcase(s, tc_core);
+
+	TCase *tc_async = tcase_create("Async");
+	tcase_add_checked_fixture(tc_async, setup, teardown);
+	tcase_add_test(tc_async, test_load_async);
+	tcase_add_test(tc_async, test_load_async_cancel);
+	suite_add_tcase(s, tc_async);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = desktop_cache_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
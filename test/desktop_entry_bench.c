@@ -0,0 +1,141 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "bench.h"
+#include "desktop_entry.h"
+
+/* Synthetic entries; about what a desktop with Flatpak, Steam and Wine
+ * shortcuts ends up with */
+#define ENTRY_COUNT 5000
+
+static const char *const name_words[] = {
+	"Audio", "Browser", "Calculator", "Disk", "Editor", "Files", "Game", "Mail", "Monitor",
+	"Music", "Notes", "Office", "Paint", "Photo", "Player", "Reader", "Settings", "Terminal",
+	"Text", "Video", "Viewer", "Web",
+};
+#define NAME_WORD_COUNT (sizeof(name_words) / sizeof(name_words[0]))
+
+struct search_bench {
+	struct cg_desktop_entry_manager *manager;
+	const char *query;
+};
+
+struct parse_bench {
+	struct cg_desktop_entry_manager *manager;
+	const char *path;
+};
+
+static void
+write_entry(const char *apps_dir, int i)
+{
+	const char *first = name_words[i % NAME_WORD_COUNT];
+	const char *second = name_words[(i / NAME_WORD_COUNT) % NAME_WORD_COUNT];
+
+	char path[256];
+	char contents[512];
+	snprintf(path, sizeof(path), "%s/app%04d.desktop", apps_dir, i);
+	snprintf(contents, sizeof(contents),
+		 "[Desktop Entry]\n"
+		 "Type=Application\n"
+		 "Name=%s %s %d\n"
+		 "GenericName=%s\n"
+		 "Comment=Synthetic entry %d\n"
+		 "Keywords=%s;%s;bench;\n"
+		 "Exec=/usr/bin/app%04d %%U\n"
+		 "Icon=app%04d\n"
+		 "Categories=Utility;%s;\n"
+		 "%s",
+		 first, second, i, second, i, first, second, i, i, first,
+		 i % 50 == 0 ? "NoDisplay=true\n" : "");
+	bench_write_file(path, contents);
+}
+
+/* A search from scratch, not narrowing the previous query's matches */
+static void
+bench_search(void *data)
+{
+	struct search_bench *bench = data;
+	struct cg_desktop_entry *results[32];
+	desktop_entry_manager_search(bench->manager, "", results, 32);
+	desktop_entry_manager_search(bench->manager, bench->query, results, 32);
+}
+
+/* Typing the query a character at a time, as in the launcher */
+static void
+bench_search_typing(void *data)
+{
+	struct search_bench *bench = data;
+	struct cg_desktop_entry *results[32];
+	char prefix[64];
+	size_t len = strlen(bench->query);
+	for (size_t i = 0; i <= len && i < sizeof(prefix); i++) {
+		memcpy(prefix, bench->query, i);
+		prefix[i] = '\0';
+		desktop_entry_manager_search(bench->manager, prefix, results, 32);
+	}
+}
+
+static void
+bench_parse(void *data)
+{
+	struct parse_bench *bench = data;
+	desktop_entry_manager_update_file(bench->manager, bench->path);
+}
+
+void
+desktop_entry_bench(void)
+{
+	char *dir = bench_make_dir();
+	char apps_dir[256];
+	snprintf(apps_dir, sizeof(apps_dir), "%s/applications", dir);
+	mkdir(apps_dir, 0755);
+	for (int i = 0; i < ENTRY_COUNT; i++) {
+		write_entry(apps_dir, i);
+	}
+
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	const char *dirs[] = {apps_dir, NULL};
+	desktop_entry_manager_load_dirs(manager, dirs, NULL);
+	desktop_entry_manager_build_index(manager);
+
+	static const struct {
+		const char *name;
+		const char *query;
+	} queries[] = {
+		{"desktop_entry_search/5000/empty", ""},
+		{"desktop_entry_search/5000/short", "te"},
+		{"desktop_entry_search/5000/word", "terminal"},
+		{"desktop_entry_search/5000/fuzzy", "tmnl"},
+		{"desktop_entry_search/5000/miss", "zqxj"},
+	};
+	for (size_t i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+		struct search_bench bench = {manager, queries[i].query};
+		bench_run(queries[i].name, bench_search, &bench);
+	}
+
+	struct search_bench typing = {manager, "terminal"};
+	bench_run("desktop_entry_search/5000/typing", bench_search_typing, &typing);
+
+	desktop_entry_manager_destroy(manager);
+
+	/* Parsing alone, re-reading one file into an otherwise empty manager */
+	char path[512];
+	snprintf(path, sizeof(path), "%s/app0001.desktop", apps_dir);
+	struct parse_bench parse = {desktop_entry_manager_create(), path};
+	bench_run("parse_desktop_file", bench_parse, &parse);
+	desktop_entry_manager_destroy(parse.manager);
+
+	bench_remove_dir(dir);
+}
@@ -12,9 +12,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "desktop_entry.h"
 
+/* Helper: add an entry with just a name and command */
+static void
+add_app(struct cg_desktop_entry_manager *manager, const char *name, const char *exec, bool nodisplay)
+{
+	struct cg_desktop_entry_fields fields = {
+		.name = name,
+		.exec = exec,
+		.nodisplay = nodisplay,
+	};
+	ck_assert_ptr_nonnull(desktop_entry_manager_add(manager, &fields));
+}
+
 /* Test: desktop_entry_manager_create and destroy */
 START_TEST(test_manager_create_destroy)
 {
@@ -22,9 +36,8 @@ START_TEST(test_manager_create_destroy)
 
 	ck_assert_ptr_nonnull(manager);
 
-	/* Entries list should be initialized (next and prev point to itself) */
-	ck_assert_ptr_eq(manager->entries.next, &manager->entries);
-	ck_assert_ptr_eq(manager->entries.prev, &manager->entries);
+	/* No entries yet */
+	ck_assert_uint_eq(manager->entries.count, 0);
 
 	desktop_entry_manager_destroy(manager);
 }
@@ -36,23 +49,8 @@ START_TEST(test_manager_search_empty)
 	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
 
 	/* Create test entries manually */
-	struct cg_desktop_entry *entry1 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry1->name = strdup("Application One");
-	entry1->exec = strdup("/usr/bin/app1");
-	entry1->icon = NULL;
-	entry1->categories = NULL;
-	entry1->desktop_file = NULL;
-	entry1->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry1->link);
-
-	struct cg_desktop_entry *entry2 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry2->name = strdup("Application Two");
-	entry2->exec = strdup("/usr/bin/app2");
-	entry2->icon = NULL;
-	entry2->categories = NULL;
-	entry2->desktop_file = NULL;
-	entry2->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry2->link);
+	add_app(manager, "Application One", "/usr/bin/app1", false);
+	add_app(manager, "Application Two", "/usr/bin/app2", false);
 
 	/* Search with empty query should return all non-NoDisplay entries */
 	struct cg_desktop_entry *results[10];
@@ -71,17 +69,8 @@ START_TEST(test_manager_search_query)
 	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
 
 	/* Create test entries */
-	struct cg_desktop_entry *entry1 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry1->name = strdup("Firefox");
-	entry1->exec = strdup("/usr/bin/firefox");
-	entry1->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry1->link);
-
-	struct cg_desktop_entry *entry2 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry2->name = strdup("Chrome");
-	entry2->exec = strdup("/usr/bin/chrome");
-	entry2->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry2->link);
+	add_app(manager, "Firefox", "/usr/bin/firefox", false);
+	add_app(manager, "Chrome", "/usr/bin/chrome", false);
 
 	/* Search for "fire" should match Firefox */
 	struct cg_desktop_entry *results[10];
@@ -101,17 +90,8 @@ START_TEST(test_manager_search_nodisplay)
 	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
 
 	/* Create test entries - one visible, one hidden */
-	struct cg_desktop_entry *entry1 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry1->name = strdup("Visible App");
-	entry1->exec = strdup("/usr/bin/visible");
-	entry1->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry1->link);
-
-	struct cg_desktop_entry *entry2 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry2->name = strdup("Hidden App");
-	entry2->exec = strdup("/usr/bin/hidden");
-	entry2->nodisplay = true;
-	wl_list_insert(&manager->entries, &entry2->link);
+	add_app(manager, "Visible App", "/usr/bin/visible", false);
+	add_app(manager, "Hidden App", "/usr/bin/hidden", true);
 
 	/* Empty query should only return visible entries */
 	struct cg_desktop_entry *results[10];
@@ -131,11 +111,7 @@ START_TEST(test_manager_search_null)
 	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
 
 	/* Create test entry */
-	struct cg_desktop_entry *entry1 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry1->name = strdup("Test App");
-	entry1->exec = strdup("/usr/bin/test");
-	entry1->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry1->link);
+	add_app(manager, "Test App", "/usr/bin/test", false);
 
 	/* NULL query should return all entries */
 	struct cg_desktop_entry *results[10];
@@ -148,11 +124,52 @@ START_TEST(test_manager_search_null)
 }
 END_TEST
 
-/* Test: desktop_entry_destroy with NULL */
-START_TEST(test_desktop_entry_destroy_null)
+/* Test: added entries copy their strings, sharing directories and categories */
+START_TEST(test_manager_add_strings)
 {
-	/* Should not crash */
-	desktop_entry_destroy(NULL);
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+
+	char name[] = "Firefox";
+	struct cg_desktop_entry_fields fields = {
+		.name = name,
+		.exec = "firefox %u",
+		.generic_name = "Web Browser",
+		.categories = "Network;WebBrowser;",
+		.desktop_file = "/usr/share/applications/firefox.desktop",
+	};
+	struct cg_desktop_entry *entry = desktop_entry_manager_add(manager, &fields);
+	ck_assert_ptr_nonnull(entry);
+	name[0] = 'X';
+	ck_assert_str_eq(entry->name, "Firefox");
+	ck_assert_str_eq(entry->search_name, "firefox");
+	ck_assert_str_eq(entry->search_extra, "web browser;");
+	ck_assert_ptr_null(entry->icon);
+	ck_assert_str_eq(entry->dir, "/usr/share/applications");
+	ck_assert_str_eq(entry->file_name, "firefox.desktop");
+
+	/* Ready to exec */
+	ck_assert_str_eq(entry->argv[0], "firefox");
+	ck_assert_str_eq(entry->argv[1], "--new-instance");
+	ck_assert_ptr_null(entry->argv[2]);
+
+	char path[256];
+	ck_assert(desktop_entry_path(entry, path, sizeof(path)));
+	ck_assert_str_eq(path, "/usr/share/applications/firefox.desktop");
+
+	fields.name = "Chromium";
+	fields.desktop_file = "/usr/share/applications/chromium.desktop";
+	ck_assert_ptr_nonnull(desktop_entry_manager_add(manager, &fields));
+	ck_assert_uint_eq(manager->entries.count, 2);
+	ck_assert_ptr_eq(manager->entries.entries[0].dir, manager->entries.entries[1].dir);
+	ck_assert_ptr_eq(manager->entries.entries[0].categories, manager->entries.entries[1].categories);
+
+	/* Name and a valid Exec are required */
+	fields.exec = "chromium 'unterminated";
+	ck_assert_ptr_null(desktop_entry_manager_add(manager, &fields));
+	fields.exec = NULL;
+	ck_assert_ptr_null(desktop_entry_manager_add(manager, &fields));
+
+	desktop_entry_manager_destroy(manager);
 }
 END_TEST
 
@@ -182,17 +199,8 @@ START_TEST(test_manager_search_case_insensitive)
 	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
 
 	/* Create test entries with mixed case */
-	struct cg_desktop_entry *entry1 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry1->name = strdup("FIREFOX");
-	entry1->exec = strdup("/usr/bin/firefox");
-	entry1->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry1->link);
-
-	struct cg_desktop_entry *entry2 = calloc(1, sizeof(struct cg_desktop_entry));
-	entry2->name = strdup("Chrome");
-	entry2->exec = strdup("/usr/bin/chrome");
-	entry2->nodisplay = false;
-	wl_list_insert(&manager->entries, &entry2->link);
+	add_app(manager, "FIREFOX", "/usr/bin/firefox", false);
+	add_app(manager, "Chrome", "/usr/bin/chrome", false);
 
 	/* Lowercase search should match uppercase entry */
 	struct cg_desktop_entry *results[10];
@@ -206,6 +214,379 @@ START_TEST(test_manager_search_case_insensitive)
 }
 END_TEST
 
+/* Helper: add a visible entry with optional generic name and keywords */
+static struct cg_desktop_entry *
+add_entry(struct cg_desktop_entry_manager *manager, const char *name, const char *generic_name,
+	  const char *keywords)
+{
+	struct cg_desktop_entry_fields fields = {
+		.name = name,
+		.exec = "/usr/bin/true",
+		.generic_name = generic_name,
+		.keywords = keywords,
+	};
+	struct cg_desktop_entry *entry = desktop_entry_manager_add(manager, &fields);
+	ck_assert_ptr_nonnull(entry);
+	return entry;
+}
+
+/* Test: empty query returns entries sorted by name */
+START_TEST(test_manager_search_sorted)
+{
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	add_entry(manager, "Zathura", NULL, NULL);
+	add_entry(manager, "alacritty", NULL, NULL);
+	add_entry(manager, "Firefox", NULL, NULL);
+
+	struct cg_desktop_entry *results[10];
+	size_t count = desktop_entry_manager_search(manager, "", results, 10);
+
+	ck_assert_uint_eq(count, 3);
+	ck_assert_str_eq(results[0]->name, "alacritty");
+	ck_assert_str_eq(results[1]->name, "Firefox");
+	ck_assert_str_eq(results[2]->name, "Zathura");
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: fuzzy matches are ranked, prefix matches first */
+START_TEST(test_manager_search_ranked)
+{
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	add_entry(manager, "LibreOffice Calc", NULL, NULL);
+	add_entry(manager, "Calculator", NULL, NULL);
+	add_entry(manager, "Chrome", NULL, NULL);
+
+	struct cg_desktop_entry *results[10];
+	size_t count = desktop_entry_manager_search(manager, "calc", results, 10);
+
+	ck_assert_uint_eq(count, 2);
+	ck_assert_str_eq(results[0]->name, "Calculator");
+	ck_assert_str_eq(results[1]->name, "LibreOffice Calc");
+
+	/* Scattered characters still match */
+	count = desktop_entry_manager_search(manager, "lbc", results, 10);
+	ck_assert_uint_eq(count, 1);
+	ck_assert_str_eq(results[0]->name, "LibreOffice Calc");
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: GenericName and Keywords are searched too */
+START_TEST(test_manager_search_keywords)
+{
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	add_entry(manager, "Firefox", "Web Browser", "Internet;WWW;");
+	add_entry(manager, "foot", "Terminal", "shell;prompt;command;");
+
+	struct cg_desktop_entry *results[10];
+	size_t count = desktop_entry_manager_search(manager, "browser", results, 10);
+	ck_assert_uint_eq(count, 1);
+	ck_assert_str_eq(results[0]->name, "Firefox");
+
+	count = desktop_entry_manager_search(manager, "shell", results, 10);
+	ck_assert_uint_eq(count, 1);
+	ck_assert_str_eq(results[0]->name, "foot");
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: narrowing from a previous query gives the same results as a fresh search */
+START_TEST(test_manager_search_incremental)
+{
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	add_entry(manager, "Firefox", NULL, NULL);
+	add_entry(manager, "Files", NULL, NULL);
+	add_entry(manager, "Chromium", NULL, NULL);
+	add_entry(manager, "GIMP", "Image Editor", NULL);
+
+	struct cg_desktop_entry *results[10];
+	size_t count = desktop_entry_manager_search(manager, "f", results, 10);
+	ck_assert_uint_eq(count, 2);
+
+	count = desktop_entry_manager_search(manager, "fi", results, 10);
+	ck_assert_uint_eq(count, 2);
+	ck_assert_str_eq(manager->last_query, "fi");
+	ck_assert_uint_eq(manager->match_count, 2);
+
+	count = desktop_entry_manager_search(manager, "fir", results, 10);
+	ck_assert_uint_eq(count, 1);
+	ck_assert_str_eq(results[0]->name, "Firefox");
+
+	/* Backspacing to an unrelated query rescans the full index */
+	count = desktop_entry_manager_search(manager, "im", results, 10);
+	ck_assert_uint_eq(count, 2);
+	ck_assert_str_eq(results[0]->name, "GIMP");
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: entries added after a search show up once the index is invalidated */
+START_TEST(test_manager_search_invalidate)
+{
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	add_entry(manager, "Firefox", NULL, NULL);
+
+	struct cg_desktop_entry *results[10];
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "", results, 10), 1);
+
+	add_entry(manager, "Foot", NULL, NULL);
+	desktop_entry_manager_invalidate_index(manager);
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "f", results, 10), 2);
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+static char apps_dir[64];
+
+static void
+write_desktop_file(const char *name, const char *contents)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", apps_dir, name);
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+static void
+apps_dir_setup(void)
+{
+	snprintf(apps_dir, sizeof(apps_dir), "/tmp/waymux-apps-test-XXXXXX");
+	ck_assert_ptr_nonnull(mkdtemp(apps_dir));
+	write_desktop_file("firefox.desktop", "[Desktop Entry]\nName=Firefox\nExec=firefox\n");
+}
+
+static void
+apps_dir_teardown(void)
+{
+	char cmd[128];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", apps_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+static struct cg_desktop_entry_manager *
+load_apps_dir(void)
+{
+	const char *dirs[] = {apps_dir, NULL};
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	ck_assert_int_eq(desktop_entry_manager_load_dirs(manager, dirs, NULL), 1);
+	return manager;
+}
+
+/* Test: updating and removing single files keeps the index current */
+START_TEST(test_manager_update_file)
+{
+	struct cg_desktop_entry_manager *manager = load_apps_dir();
+	struct cg_desktop_entry *results[10];
+	char path[256];
+
+	/* Warm up the incremental search state */
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "f", results, 10), 1);
+
+	write_desktop_file("foot.desktop", "[Desktop Entry]\nName=Foot\nExec=foot\n");
+	snprintf(path, sizeof(path), "%s/foot.desktop", apps_dir);
+	ck_assert(desktop_entry_manager_update_file(manager, path));
+	ck_assert(manager->index_valid);
+	ck_assert_uint_eq(manager->index_count, 2);
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "foot", results, 10), 1);
+	ck_assert_str_eq(results[0]->name, "Foot");
+
+	/* Replacing a file replaces its entry */
+	write_desktop_file("foot.desktop", "[Desktop Entry]\nName=Foot Server\nExec=foot --server\n");
+	ck_assert(desktop_entry_manager_update_file(manager, path));
+	ck_assert_uint_eq(manager->index_count, 2);
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "", results, 10), 2);
+	ck_assert_str_eq(results[0]->name, "Firefox");
+	ck_assert_str_eq(results[1]->name, "Foot Server");
+	ck_assert_str_eq(results[1]->argv[1], "--server");
+
+	ck_assert(desktop_entry_manager_remove_file(manager, path));
+	ck_assert(!desktop_entry_manager_remove_file(manager, path));
+	ck_assert_uint_eq(manager->index_count, 1);
+	ck_assert_uint_eq(manager->entries.count, 1);
+	ck_assert_str_eq(manager->entries.entries[0].name, "Firefox");
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: strings of replaced entries are reclaimed */
+START_TEST(test_manager_compact)
+{
+	struct cg_desktop_entry_manager *manager = load_apps_dir();
+	struct cg_desktop_entry *results[10];
+	char path[256];
+	snprintf(path, sizeof(path), "%s/foot.desktop", apps_dir);
+
+	char contents[512];
+	for (int i = 0; i < 2000; i++) {
+		snprintf(contents, sizeof(contents),
+			 "[Desktop Entry]\nName=Foot %d\nExec=foot\nCategories=System;TerminalEmulator;\n"
+			 "Keywords=shell;prompt;command;commandline;cmd;terminal;console;emulator;\n",
+			 i);
+		write_desktop_file("foot.desktop", contents);
+		ck_assert(desktop_entry_manager_update_file(manager, path));
+	}
+
+	/* Compacted on the way, keeping the index valid */
+	ck_assert_uint_lt(manager->entries.strings.size, 2 * STRING_ARENA_CHUNK_SIZE);
+	ck_assert_uint_eq(manager->entries.count, 2);
+	ck_assert(manager->index_valid);
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "", results, 10), 2);
+	ck_assert_str_eq(results[0]->name, "Firefox");
+	ck_assert_str_eq(results[1]->name, "Foot 1999");
+	ck_assert_str_eq(results[1]->categories, "System;TerminalEmulator;");
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+static int changed_count;
+
+static void
+handle_changed(struct wl_listener *listener, void *data)
+{
+	changed_count++;
+}
+
+static void
+dispatch_until_changed(struct wl_event_loop *loop)
+{
+	int start = changed_count;
+	for (int i = 0; i < 100 && changed_count == start; i++) {
+		wl_event_loop_dispatch(loop, 10);
+	}
+	ck_assert_int_gt(changed_count, start);
+}
+
+/* Test: inotify picks up installed and removed applications */
+START_TEST(test_manager_watch)
+{
+	struct cg_desktop_entry_manager *manager = load_apps_dir();
+	struct wl_event_loop *loop = wl_event_loop_create();
+	const char *dirs[] = {apps_dir, "/nonexistent/applications", NULL};
+	ck_assert_int_eq(desktop_entry_manager_watch_dirs(manager, dirs, loop), 0);
+
+	struct wl_listener changed = {.notify = handle_changed};
+	wl_signal_add(&manager->events.changed, &changed);
+	changed_count = 0;
+
+	write_desktop_file("gimp.desktop", "[Desktop Entry]\nName=GIMP\nExec=gimp\n");
+	dispatch_until_changed(loop);
+
+	struct cg_desktop_entry *results[10];
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "gimp", results, 10), 1);
+
+	char path[256];
+	snprintf(path, sizeof(path), "%s/gimp.desktop", apps_dir);
+	ck_assert_int_eq(unlink(path), 0);
+	dispatch_until_changed(loop);
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "gimp", results, 10), 0);
+
+	wl_list_remove(&changed.link);
+	desktop_entry_manager_destroy(manager);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+/* Test: applications directories created after the watch are picked up,
+ * also after being removed again */
+START_TEST(test_manager_watch_missing_dir)
+{
+	struct cg_desktop_entry_manager *manager = load_apps_dir();
+	struct wl_event_loop *loop = wl_event_loop_create();
+	char parent[96], dir[128], path[256];
+	snprintf(parent, sizeof(parent), "%s/share", apps_dir);
+	snprintf(dir, sizeof(dir), "%s/applications", parent);
+	const char *dirs[] = {apps_dir, dir, NULL};
+	ck_assert_int_eq(desktop_entry_manager_watch_dirs(manager, dirs, loop), 0);
+
+	struct wl_listener changed = {.notify = handle_changed};
+	wl_signal_add(&manager->events.changed, &changed);
+	changed_count = 0;
+
+	ck_assert_int_eq(mkdir(parent, 0755), 0);
+	wl_event_loop_dispatch(loop, 10);
+	ck_assert_int_eq(mkdir(dir, 0755), 0);
+	snprintf(path, sizeof(path), "%s/gimp.desktop", dir);
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs("[Desktop Entry]\nName=GIMP\nExec=gimp\n", f);
+	fclose(f);
+	dispatch_until_changed(loop);
+
+	struct cg_desktop_entry *results[10];
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "gimp", results, 10), 1);
+
+	/* Removing the directory drops its entries, and it is waited for again */
+	ck_assert_int_eq(unlink(path), 0);
+	ck_assert_int_eq(rmdir(dir), 0);
+	dispatch_until_changed(loop);
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "gimp", results, 10), 0);
+
+	ck_assert_int_eq(mkdir(dir, 0755), 0);
+	snprintf(path, sizeof(path), "%s/foot.desktop", dir);
+	f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs("[Desktop Entry]\nName=Foot\nExec=foot\n", f);
+	fclose(f);
+	dispatch_until_changed(loop);
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "foot", results, 10), 1);
+
+	wl_list_remove(&changed.link);
+	desktop_entry_manager_destroy(manager);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+/* Test: a rescan catches up with changes whose events were lost */
+START_TEST(test_manager_rescan)
+{
+	struct cg_desktop_entry_manager *manager = load_apps_dir();
+	ck_assert(!desktop_entry_manager_rescan(manager));
+
+	struct wl_event_loop *loop = wl_event_loop_create();
+	const char *dirs[] = {apps_dir, NULL};
+	ck_assert_int_eq(desktop_entry_manager_watch_dirs(manager, dirs, loop), 0);
+
+	struct wl_listener changed = {.notify = handle_changed};
+	wl_signal_add(&manager->events.changed, &changed);
+	changed_count = 0;
+
+	/* Nothing is dispatched, as if the kernel dropped the events: an
+	 * entry without a file, a file without an entry, and a new file */
+	char path[256];
+	write_desktop_file("foot.desktop", "[Desktop Entry]\nName=Foot\nExec=foot\n");
+	snprintf(path, sizeof(path), "%s/foot.desktop", apps_dir);
+	ck_assert(desktop_entry_manager_update_file(manager, path));
+	ck_assert_int_eq(unlink(path), 0);
+	snprintf(path, sizeof(path), "%s/firefox.desktop", apps_dir);
+	ck_assert(desktop_entry_manager_remove_file(manager, path));
+	write_desktop_file("gimp.desktop", "[Desktop Entry]\nName=GIMP\nExec=gimp\n");
+
+	ck_assert(desktop_entry_manager_rescan(manager));
+	ck_assert_int_eq(changed_count, 1);
+	ck_assert(manager->index_valid);
+
+	struct cg_desktop_entry *results[10];
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "", results, 10), 2);
+	ck_assert_str_eq(results[0]->name, "Firefox");
+	ck_assert_str_eq(results[1]->name, "GIMP");
+	ck_assert_uint_eq(desktop_entry_manager_search(manager, "foot", results, 10), 0);
+
+	wl_list_remove(&changed.link);
+	desktop_entry_manager_destroy(manager);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
 /* Main test runner */
 int
 main(void)
@@ -218,7 +599,7 @@ main(void)
 
 	/* Core tests */
 	tcase_add_test(tc_core, test_manager_create_destroy);
-	tcase_add_test(tc_core, test_desktop_entry_destroy_null);
+	tcase_add_test(tc_core, test_manager_add_strings);
 	tcase_add_test(tc_core, test_manager_destroy_null);
 	tcase_add_test(tc_core, test_manager_search_null_manager);
 
@@ -228,9 +609,24 @@ main(void)
 	tcase_add_test(tc_search, test_manager_search_nodisplay);
 	tcase_add_test(tc_search, test_manager_search_null);
 	tcase_add_test(tc_search, test_manager_search_case_insensitive);
+	tcase_add_test(tc_search, test_manager_search_sorted);
+	tcase_add_test(tc_search, test_manager_search_ranked);
+	tcase_add_test(tc_search, test_manager_search_keywords);
+	tcase_add_test(tc_search, test_manager_search_incremental);
+	tcase_add_test(tc_search, test_manager_search_invalidate);
+
+	/* File update tests */
+	TCase *tc_update = tcase_create("Update");
+	tcase_add_checked_fixture(tc_update, apps_dir_setup, apps_dir_teardown);
+	tcase_add_test(tc_update, test_manager_update_file);
+	tcase_add_test(tc_update, test_manager_compact);
+	tcase_add_test(tc_update, test_manager_watch);
+	tcase_add_test(tc_update, test_manager_watch_missing_dir);
+	tcase_add_test(tc_update, test_manager_rescan);
 
 	suite_add_tcase(s, tc_core);
 	suite_add_tcase(s, tc_search);
+	suite_add_tcase(s, tc_update);
 
 	SRunner *sr = srunner_create(s);
 	srunner_run_all(sr, CK_NORMAL);
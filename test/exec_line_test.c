@@ -0,0 +1,160 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exec_line.h"
+
+static const struct cg_exec_line_fields fields = {
+	.name = "Text Editor",
+	.icon = "accessories-text-editor",
+	.desktop_file = "/usr/share/applications/editor.desktop",
+};
+
+/* Assert argv holds exactly the NULL-terminated expected arguments */
+static void
+assert_argv(char **argv, const char *const *expected)
+{
+	ck_assert_ptr_nonnull(argv);
+	size_t i = 0;
+	for (; expected[i]; i++) {
+		ck_assert_ptr_nonnull(argv[i]);
+		ck_assert_str_eq(argv[i], expected[i]);
+	}
+	ck_assert_ptr_null(argv[i]);
+	free(argv);
+}
+
+/* Test: whitespace separates arguments, however much of it */
+START_TEST(test_split)
+{
+	assert_argv(exec_line_argv("foot", NULL), (const char *[]){"foot", NULL});
+	assert_argv(exec_line_argv("  foot   -e\thtop ", NULL),
+		    (const char *[]){"foot", "-e", "htop", NULL});
+
+	ck_assert_ptr_null(exec_line_argv("", NULL));
+	ck_assert_ptr_null(exec_line_argv("   ", NULL));
+	ck_assert_ptr_null(exec_line_argv(NULL, NULL));
+}
+END_TEST
+
+/* Test: quotes and backslashes */
+START_TEST(test_quoting)
+{
+	assert_argv(exec_line_argv("foot -e 'htop -d 5'", NULL),
+		    (const char *[]){"foot", "-e", "htop -d 5", NULL});
+	assert_argv(exec_line_argv("sh -c \"echo \\\"hi\\\" \\$HOME\"", NULL),
+		    (const char *[]){"sh", "-c", "echo \"hi\" $HOME", NULL});
+	assert_argv(exec_line_argv("a\\ b 'it'\\''s' pre\"fix\"ed", NULL),
+		    (const char *[]){"a b", "it's", "prefixed", NULL});
+
+	/* Inside double quotes, other backslashes are kept */
+	assert_argv(exec_line_argv("printf \"a\\nb\"", NULL), (const char *[]){"printf", "a\\nb", NULL});
+
+	/* Quoted empty arguments are arguments */
+	assert_argv(exec_line_argv("cmd '' \"\"", NULL), (const char *[]){"cmd", "", "", NULL});
+
+	ck_assert_ptr_null(exec_line_argv("foot -e 'htop", NULL));
+	ck_assert_ptr_null(exec_line_argv("foot \"", NULL));
+}
+END_TEST
+
+/* Test: desktop entry field codes */
+START_TEST(test_field_codes)
+{
+	assert_argv(exec_line_argv("gedit %U", &fields), (const char *[]){"gedit", NULL});
+	assert_argv(exec_line_argv("gedit %f --new-window %F %u", &fields),
+		    (const char *[]){"gedit", "--new-window", NULL});
+	assert_argv(exec_line_argv("gedit %i --class=%c", &fields),
+		    (const char *[]){"gedit", "--icon", "accessories-text-editor", "--class=Text Editor",
+				     NULL});
+	assert_argv(exec_line_argv("gedit --from %k 100%%", &fields),
+		    (const char *[]){"gedit", "--from", "/usr/share/applications/editor.desktop", "100%",
+				     NULL});
+
+	/* No icon, no --icon */
+	struct cg_exec_line_fields no_icon = {.name = "Editor"};
+	assert_argv(exec_line_argv("gedit %i %k", &no_icon), (const char *[]){"gedit", NULL});
+
+	/* Without fields, % is literal */
+	assert_argv(exec_line_argv("date +%d%%", NULL), (const char *[]){"date", "+%d%%", NULL});
+
+	/* Only field codes is no command */
+	ck_assert_ptr_null(exec_line_argv("%U", &fields));
+}
+END_TEST
+
+/* Test: Firefox is started as a new instance */
+START_TEST(test_firefox)
+{
+	assert_argv(exec_line_argv("firefox %u", &fields),
+		    (const char *[]){"firefox", "--new-instance", NULL});
+	assert_argv(exec_line_argv("/usr/lib/firefox/firefox-bin https://example.com", NULL),
+		    (const char *[]){"/usr/lib/firefox/firefox-bin", "--new-instance", "https://example.com",
+				     NULL});
+	assert_argv(exec_line_argv("firefox -P work --new-instance", NULL),
+		    (const char *[]){"firefox", "-P", "work", "--new-instance", NULL});
+	assert_argv(exec_line_argv("firefoxy", NULL), (const char *[]){"firefoxy", NULL});
+}
+END_TEST
+
+/* Test: sizing, then parsing into a caller's buffer */
+START_TEST(test_parse_buffer)
+{
+	const char *line = "foot -e htop";
+	size_t size = exec_line_parse(line, NULL, NULL, 0);
+	ck_assert_uint_gt(size, 4 * sizeof(char *) + strlen(line) + 1);
+
+	char **buf = malloc(size);
+	buf[0] = NULL;
+	ck_assert_uint_eq(exec_line_parse(line, NULL, buf, size - 1), size);
+	ck_assert_ptr_null(buf[0]);
+
+	ck_assert_uint_eq(exec_line_parse(line, NULL, buf, size), size);
+	ck_assert_str_eq(buf[0], "foot");
+	ck_assert_str_eq(buf[2], "htop");
+	ck_assert_ptr_null(buf[3]);
+	free(buf);
+
+	ck_assert_uint_eq(exec_line_parse("'", NULL, NULL, 0), 0);
+}
+END_TEST
+
+Suite *
+exec_line_suite(void)
+{
+	Suite *s = suite_create("exec_line");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_split);
+	tcase_add_test(tc_core, test_quoting);
+	tcase_add_test(tc_core, test_field_codes);
+	tcase_add_test(tc_core, test_firefox);
+	tcase_add_test(tc_core, test_parse_buffer);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = exec_line_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,142 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+
+/* Test: font_create and destroy */
+START_TEST(test_font_create_destroy)
+{
+	struct cg_font *font = font_create("sans-serif", 14);
+	ck_assert_ptr_nonnull(font);
+	ck_assert_ptr_nonnull(font->scaled_font);
+	ck_assert(font->height > 0);
+
+	font_destroy(font);
+
+	/* Should not crash */
+	font_destroy(NULL);
+}
+END_TEST
+
+/* Test: cached widths match the first measurement */
+START_TEST(test_font_width_cached)
+{
+	struct cg_font *font = font_create("sans-serif", 14);
+	ck_assert_ptr_nonnull(font);
+
+	double first = font_text_width(font, "firefox: Mozilla Firefox");
+	ck_assert(first > 0);
+	ck_assert_uint_eq(font->entry_count, 1);
+
+	double second = font_text_width(font, "firefox: Mozilla Firefox");
+	ck_assert(first == second);
+	ck_assert_uint_eq(font->entry_count, 1);
+
+	/* Longer strings are wider */
+	ck_assert(font_text_width(font, "firefox: Mozilla Firefox - Private") > first);
+	ck_assert_uint_eq(font->entry_count, 2);
+
+	font_destroy(font);
+}
+END_TEST
+
+/* Test: text that fits is copied unchanged */
+START_TEST(test_font_truncate_fits)
+{
+	struct cg_font *font = font_create("sans-serif", 14);
+	ck_assert_ptr_nonnull(font);
+
+	char dest[64];
+	font_truncate_to_width(font, "foot", 1000, dest, sizeof(dest));
+	ck_assert_str_eq(dest, "foot");
+
+	font_destroy(font);
+}
+END_TEST
+
+/* Test: truncated text ends with an ellipsis and fits */
+START_TEST(test_font_truncate_ellipsis)
+{
+	struct cg_font *font = font_create("sans-serif", 14);
+	ck_assert_ptr_nonnull(font);
+
+	const char *text = "A very long window title that certainly cannot fit in the tab";
+	double max_width = font_text_width(font, text) / 2;
+
+	char dest[128];
+	font_truncate_to_width(font, text, max_width, dest, sizeof(dest));
+
+	size_t len = strlen(dest);
+	ck_assert_uint_gt(len, strlen(FONT_ELLIPSIS));
+	ck_assert_str_eq(dest + len - strlen(FONT_ELLIPSIS), FONT_ELLIPSIS);
+	ck_assert(font_text_width(font, dest) <= max_width);
+	ck_assert_int_eq(strncmp(dest, text, len - strlen(FONT_ELLIPSIS)), 0);
+
+	font_destroy(font);
+}
+END_TEST
+
+/* Test: truncation never splits a multi-byte character */
+START_TEST(test_font_truncate_utf8)
+{
+	struct cg_font *font = font_create("sans-serif", 14);
+	ck_assert_ptr_nonnull(font);
+
+	const char *text = "\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9"
+			   "\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9";
+	double max_width = font_text_width(font, text) / 2;
+
+	char dest[128];
+	font_truncate_to_width(font, text, max_width, dest, sizeof(dest));
+
+	/* Every character before the ellipsis is two bytes long */
+	size_t prefix = strlen(dest) - strlen(FONT_ELLIPSIS);
+	ck_assert_uint_eq(prefix % 2, 0);
+
+	font_destroy(font);
+}
+END_TEST
+
+Suite *
+font_suite(void)
+{
+	Suite *s = suite_create("font");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_font_create_destroy);
+	tcase_add_test(tc_core, test_font_width_cached);
+	suite_add_tcase(s, tc_core);
+
+	TCase *tc_truncate = tcase_create("Truncate");
+	tcase_add_test(tc_truncate, test_font_truncate_fits);
+	tcase_add_test(tc_truncate, test_font_truncate_ellipsis);
+	tcase_add_test(tc_truncate, test_font_truncate_utf8);
+	suite_add_tcase(s, tc_truncate);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = font_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
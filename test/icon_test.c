@@ -0,0 +1,302 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "icon.h"
+
+static char tmp_dir[64];
+static char pixmaps_dir[128];
+static const char *dirs[3];
+
+/* Write a PNG of width x height pixels to path */
+static void
+write_png(const char *path, int width, int height)
+{
+	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	cairo_t *cr = cairo_create(surface);
+	cairo_set_source_rgb(cr, 1, 0, 0);
+	cairo_paint(cr);
+	cairo_destroy(cr);
+	ck_assert_int_eq(cairo_surface_write_to_png(surface, path), CAIRO_STATUS_SUCCESS);
+	cairo_surface_destroy(surface);
+}
+
+/* Install an icon into the hicolor theme at size pixels */
+static void
+install_icon(const char *name, int size)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/hicolor", tmp_dir);
+	mkdir(path, 0700);
+	snprintf(path, sizeof(path), "%s/hicolor/%dx%d", tmp_dir, size, size);
+	mkdir(path, 0700);
+	snprintf(path, sizeof(path), "%s/hicolor/%dx%d/apps", tmp_dir, size, size);
+	mkdir(path, 0700);
+	snprintf(path, sizeof(path), "%s/hicolor/%dx%d/apps/%s.png", tmp_dir, size, size, name);
+	write_png(path, size, size);
+}
+
+static void
+setup(void)
+{
+	snprintf(tmp_dir, sizeof(tmp_dir), "/tmp/waymux-icon-test-XXXXXX");
+	ck_assert_ptr_nonnull(mkdtemp(tmp_dir));
+	snprintf(pixmaps_dir, sizeof(pixmaps_dir), "%s/pixmaps", tmp_dir);
+	ck_assert_int_eq(mkdir(pixmaps_dir, 0700), 0);
+
+	dirs[0] = tmp_dir;
+	dirs[1] = pixmaps_dir;
+	dirs[2] = NULL;
+}
+
+static void
+teardown(void)
+{
+	char cmd[128];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", tmp_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Dispatch the event loop until the icon is decoded, or give up */
+static cairo_surface_t *
+wait_for_icon(struct wl_event_loop *loop, struct cg_icon_cache *cache, const char *name, int size)
+{
+	for (int i = 0; i < 100; i++) {
+		cairo_surface_t *surface = icon_cache_get(cache, name, size);
+		if (surface) {
+			return surface;
+		}
+		wl_event_loop_dispatch(loop, 50);
+	}
+	return NULL;
+}
+
+/* Test: the closest larger theme size is preferred */
+START_TEST(test_find_path_size)
+{
+	install_icon("foot", 16);
+	install_icon("foot", 48);
+	install_icon("foot", 256);
+
+	char expected[256];
+	char *path = icon_find_path(dirs, "foot", 24);
+	snprintf(expected, sizeof(expected), "%s/hicolor/48x48/apps/foot.png", tmp_dir);
+	ck_assert_str_eq(path, expected);
+	free(path);
+
+	/* Larger than any installed: the largest */
+	path = icon_find_path(dirs, "foot", 512);
+	snprintf(expected, sizeof(expected), "%s/hicolor/256x256/apps/foot.png", tmp_dir);
+	ck_assert_str_eq(path, expected);
+	free(path);
+
+	/* A file name is taken as the icon name */
+	path = icon_find_path(dirs, "foot.png", 16);
+	snprintf(expected, sizeof(expected), "%s/hicolor/16x16/apps/foot.png", tmp_dir);
+	ck_assert_str_eq(path, expected);
+	free(path);
+}
+END_TEST
+
+/* Test: unthemed icons and absolute paths */
+START_TEST(test_find_path_pixmaps)
+{
+	char expected[256];
+	snprintf(expected, sizeof(expected), "%s/xterm.png", pixmaps_dir);
+	write_png(expected, 32, 32);
+
+	char *path = icon_find_path(dirs, "xterm", 24);
+	ck_assert_str_eq(path, expected);
+	free(path);
+
+	path = icon_find_path(dirs, expected, 24);
+	ck_assert_str_eq(path, expected);
+	free(path);
+
+	ck_assert_ptr_null(icon_find_path(dirs, "missing", 24));
+	ck_assert_ptr_null(icon_find_path(dirs, "", 24));
+}
+END_TEST
+
+/* Test: a lookup queues the icon and it is ready later */
+START_TEST(test_cache_async)
+{
+	install_icon("foot", 48);
+
+	struct wl_event_loop *loop = wl_event_loop_create();
+	struct cg_icon_cache *cache = icon_cache_create_dirs(loop, dirs, ICON_CACHE_MAX_BYTES);
+	ck_assert_ptr_nonnull(cache);
+
+	ck_assert_ptr_null(icon_cache_get(cache, "foot", 24));
+
+	cairo_surface_t *surface = wait_for_icon(loop, cache, "foot", 24);
+	ck_assert_ptr_nonnull(surface);
+	ck_assert_int_eq(cairo_image_surface_get_width(surface), 24);
+	ck_assert_int_eq(cairo_image_surface_get_height(surface), 24);
+	ck_assert_uint_eq(cache->bytes, (size_t)cairo_image_surface_get_stride(surface) * 24 + ICON_ENTRY_BYTES);
+
+	/* The same name at another size is another icon */
+	ck_assert_ptr_null(icon_cache_get(cache, "foot", 48));
+	ck_assert_ptr_nonnull(wait_for_icon(loop, cache, "foot", 48));
+	ck_assert_int_eq(wl_list_length(&cache->icons), 2);
+
+	icon_cache_destroy(cache);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+/* Test: icons that can't be found are remembered as missing */
+START_TEST(test_cache_missing)
+{
+	struct wl_event_loop *loop = wl_event_loop_create();
+	struct cg_icon_cache *cache = icon_cache_create_dirs(loop, dirs, ICON_CACHE_MAX_BYTES);
+	ck_assert_ptr_nonnull(cache);
+
+	ck_assert_ptr_null(icon_cache_get(cache, "missing", 24));
+	struct cg_icon *icon = wl_container_of(cache->icons.next, icon, link);
+	for (int i = 0; i < 100 && icon->state == CG_ICON_PENDING; i++) {
+		wl_event_loop_dispatch(loop, 50);
+	}
+	ck_assert_int_eq(icon->state, CG_ICON_MISSING);
+
+	/* Not queued again */
+	ck_assert_ptr_null(icon_cache_get(cache, "missing", 24));
+	ck_assert_int_eq(wl_list_length(&cache->icons), 1);
+	ck_assert_int_eq(icon->state, CG_ICON_MISSING);
+
+	icon_cache_destroy(cache);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+/* Test: missing icons count against the budget too */
+START_TEST(test_cache_evict_missing)
+{
+	/* Room for four entries without pixels */
+	struct wl_event_loop *loop = wl_event_loop_create();
+	struct cg_icon_cache *cache = icon_cache_create_dirs(loop, dirs, 4 * ICON_ENTRY_BYTES);
+	ck_assert_ptr_nonnull(cache);
+
+	char name[32];
+	for (int i = 0; i < 16; i++) {
+		snprintf(name, sizeof(name), "missing-%d", i);
+		ck_assert_ptr_null(icon_cache_get(cache, name, 24));
+	}
+	/* The last one is decoded last */
+	struct cg_icon *icon = wl_container_of(cache->icons.next, icon, link);
+	for (int i = 0; i < 100 && icon->state == CG_ICON_PENDING; i++) {
+		wl_event_loop_dispatch(loop, 50);
+	}
+	ck_assert_int_eq(icon->state, CG_ICON_MISSING);
+
+	ck_assert_uint_le(cache->bytes, cache->max_bytes);
+	ck_assert_int_le(wl_list_length(&cache->icons), 4);
+
+	icon_cache_destroy(cache);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+/* Test: the least recently used icons are dropped beyond the budget */
+START_TEST(test_cache_evict)
+{
+	install_icon("a", 32);
+	install_icon("b", 32);
+	install_icon("c", 32);
+
+	/* Room for two 32px icons */
+	struct wl_event_loop *loop = wl_event_loop_create();
+	struct cg_icon_cache *cache = icon_cache_create_dirs(loop, dirs, 2 * (32 * 32 * 4 + ICON_ENTRY_BYTES));
+	ck_assert_ptr_nonnull(cache);
+
+	ck_assert_ptr_nonnull(wait_for_icon(loop, cache, "a", 32));
+	ck_assert_ptr_nonnull(wait_for_icon(loop, cache, "b", 32));
+	/* a is used again, so b is the least recently used */
+	ck_assert_ptr_nonnull(icon_cache_get(cache, "a", 32));
+	ck_assert_ptr_nonnull(wait_for_icon(loop, cache, "c", 32));
+
+	ck_assert_uint_le(cache->bytes, cache->max_bytes);
+	ck_assert_int_eq(wl_list_length(&cache->icons), 2);
+	ck_assert_ptr_nonnull(icon_cache_get(cache, "a", 32));
+	ck_assert_ptr_nonnull(icon_cache_get(cache, "c", 32));
+	ck_assert_ptr_null(icon_cache_get(cache, "b", 32));
+
+	icon_cache_destroy(cache);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+/* Test: trimming drops the decoded icons, which are decoded again */
+START_TEST(test_cache_trim)
+{
+	install_icon("foot", 32);
+
+	struct wl_event_loop *loop = wl_event_loop_create();
+	struct cg_icon_cache *cache = icon_cache_create_dirs(loop, dirs, ICON_CACHE_MAX_BYTES);
+	ck_assert_ptr_nonnull(cache);
+
+	ck_assert_ptr_nonnull(wait_for_icon(loop, cache, "foot", 32));
+	size_t bytes = cache->bytes;
+	ck_assert_uint_gt(bytes, 0);
+
+	ck_assert_uint_eq(icon_cache_trim(cache), bytes);
+	ck_assert_uint_eq(cache->bytes, 0);
+	ck_assert(wl_list_empty(&cache->icons));
+
+	ck_assert_ptr_null(icon_cache_get(cache, "foot", 32));
+	ck_assert_ptr_nonnull(wait_for_icon(loop, cache, "foot", 32));
+
+	icon_cache_destroy(cache);
+	wl_event_loop_destroy(loop);
+}
+END_TEST
+
+Suite *
+icon_suite(void)
+{
+	Suite *s = suite_create("icon");
+
+	TCase *tc_find = tcase_create("Find");
+	tcase_add_checked_fixture(tc_find, setup, teardown);
+	tcase_add_test(tc_find, test_find_path_size);
+	tcase_add_test(tc_find, test_find_path_pixmaps);
+	suite_add_tcase(s, tc_find);
+
+	TCase *tc_cache = tcase_create("Cache");
+	tcase_add_checked_fixture(tc_cache, setup, teardown);
+	tcase_add_test(tc_cache, test_cache_async);
+	tcase_add_test(tc_cache, test_cache_missing);
+	tcase_add_test(tc_cache, test_cache_evict);
+	tcase_add_test(tc_cache, test_cache_evict_missing);
+	tcase_add_test(tc_cache, test_cache_trim);
+	suite_add_tcase(s, tc_cache);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = icon_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include "action.h"
+#include "bench.h"
+#include "keybinding.h"
+
+/* The defaults, plus Super+1..9 and a few more, as a typical config has */
+static const char *const binding_names[] = {
+	"Super+K", "Super+J", "Super+D", "Super+N", "Super+B", "Super+Shift+B", "Alt+Tab",
+	"Alt+Shift+Tab", "Super+Shift+Left", "Super+Shift+Right", "Super+1", "Super+2",
+	"Super+3", "Super+4", "Super+5", "Super+6", "Super+7", "Super+8", "Super+9",
+};
+#define BINDING_COUNT (sizeof(binding_names) / sizeof(binding_names[0]))
+
+struct keybinding_bench {
+	struct keybinding bindings[BINDING_COUNT];
+	struct keybinding_table table;
+	uint32_t modifiers;
+	uint32_t keysym;
+};
+
+/* Keeps the compiler from dropping the calls */
+static volatile const void *sink;
+
+/* The linear scan over every binding that the table replaced */
+static void
+bench_match(void *data)
+{
+	struct keybinding_bench *bench = data;
+	for (size_t i = 0; i < BINDING_COUNT; i++) {
+		if (keybinding_match(&bench->bindings[i], bench->modifiers, bench->keysym)) {
+			sink = &bench->bindings[i];
+			return;
+		}
+	}
+	sink = NULL;
+}
+
+static void
+bench_lookup(void *data)
+{
+	struct keybinding_bench *bench = data;
+	sink = keybinding_table_lookup(&bench->table, bench->modifiers, bench->keysym);
+}
+
+void
+keybinding_bench(void)
+{
+	static struct keybinding_bench bench;
+	keybinding_table_init(&bench.table);
+	for (size_t i = 0; i < BINDING_COUNT; i++) {
+		if (!keybinding_parse(binding_names[i], &bench.bindings[i])) {
+			fprintf(stderr, "Failed to parse %s\n", binding_names[i]);
+			continue;
+		}
+		struct action action = {ACTION_FOCUS_TAB, (int)i + 1};
+		keybinding_table_add(&bench.table, &bench.bindings[i], &action);
+	}
+
+	static const struct {
+		const char *name;
+		uint32_t modifiers;
+		uint32_t keysym;
+	} keys[] = {
+		/* Bound last, so the linear scan's worst case */
+		{"hit", WLR_MODIFIER_LOGO, XKB_KEY_9},
+		{"miss", WLR_MODIFIER_LOGO, XKB_KEY_z},
+		/* Plain typing, the most common key press by far */
+		{"typing", 0, XKB_KEY_a},
+	};
+	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+		bench.modifiers = keys[i].modifiers;
+		bench.keysym = keys[i].keysym;
+
+		char name[64];
+		snprintf(name, sizeof(name), "keybinding_match/%zu/%s", BINDING_COUNT, keys[i].name);
+		bench_run(name, bench_match, &bench);
+		snprintf(name, sizeof(name), "keybinding_table_lookup/%zu/%s", BINDING_COUNT, keys[i].name);
+		bench_run(name, bench_lookup, &bench);
+	}
+}
@@ -136,6 +136,91 @@ START_TEST(test_parse_function_keys)
 }
 END_TEST
 
+/* The type of action bound to a key, or ACTION_NONE */
+static enum action_type
+lookup(const struct keybinding_table *table, uint32_t modifiers, uint32_t keysym)
+{
+	const struct action *action = keybinding_table_lookup(table, modifiers, keysym);
+	return action ? action->type : ACTION_NONE;
+}
+
+START_TEST(test_table_lookup)
+{
+	struct keybinding_table table;
+	keybinding_table_init(&table);
+
+	struct keybinding next = {WLR_MODIFIER_LOGO, XKB_KEY_k};
+	struct keybinding dialog = {WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT, XKB_KEY_b};
+	struct keybinding launcher = {0, XKB_KEY_F1};
+	ck_assert(keybinding_table_add(&table, &next, &(struct action){ACTION_NEXT_TAB, 0}));
+	ck_assert(keybinding_table_add(&table, &dialog, &(struct action){ACTION_SHOW_BACKGROUND_DIALOG, 0}));
+	ck_assert(keybinding_table_add(&table, &launcher, &(struct action){ACTION_OPEN_LAUNCHER, 0}));
+
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_LOGO, XKB_KEY_k), ACTION_NEXT_TAB);
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT, XKB_KEY_b), ACTION_SHOW_BACKGROUND_DIALOG);
+	ck_assert_int_eq(lookup(&table, 0, XKB_KEY_F1), ACTION_OPEN_LAUNCHER);
+
+	/* Modifiers must match exactly */
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_LOGO, XKB_KEY_b), ACTION_NONE);
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT, XKB_KEY_k), ACTION_NONE);
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_CTRL, XKB_KEY_k), ACTION_NONE);
+	ck_assert_int_eq(lookup(&table, 0, XKB_KEY_k), ACTION_NONE);
+}
+END_TEST
+
+START_TEST(test_table_action_arg)
+{
+	struct keybinding_table table;
+	keybinding_table_init(&table);
+
+	struct keybinding binding = {WLR_MODIFIER_LOGO, XKB_KEY_a};
+	ck_assert(keybinding_table_add(&table, &binding, &(struct action){ACTION_FOCUS_TAB, 12}));
+
+	const struct action *action = keybinding_table_lookup(&table, WLR_MODIFIER_LOGO, XKB_KEY_a);
+	ck_assert_ptr_nonnull(action);
+	ck_assert_int_eq(action->type, ACTION_FOCUS_TAB);
+	ck_assert_int_eq(action->arg, 12);
+	ck_assert_ptr_null(keybinding_table_lookup(&table, WLR_MODIFIER_LOGO, XKB_KEY_b));
+}
+END_TEST
+
+START_TEST(test_table_duplicates)
+{
+	struct keybinding_table table;
+	keybinding_table_init(&table);
+
+	struct keybinding binding = {WLR_MODIFIER_CTRL, XKB_KEY_q};
+	ck_assert(keybinding_table_add(&table, &binding, &(struct action){ACTION_CLOSE_TAB, 0}));
+	ck_assert(!keybinding_table_add(&table, &binding, &(struct action){ACTION_NEXT_TAB, 0}));
+	ck_assert(!keybinding_table_add(&table, NULL, &(struct action){ACTION_NEXT_TAB, 0}));
+
+	/* The first binding wins */
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_CTRL, XKB_KEY_q), ACTION_CLOSE_TAB);
+	ck_assert_int_eq(table.count, 1);
+}
+END_TEST
+
+START_TEST(test_table_full)
+{
+	struct keybinding_table table;
+	keybinding_table_init(&table);
+
+	/* Fill the table, with colliding keys */
+	int added = 0;
+	for (uint32_t key = 0; key < KEYBINDING_TABLE_SIZE * 2; key++) {
+		struct keybinding binding = {WLR_MODIFIER_ALT, 0x1000 + key};
+		if (keybinding_table_add(&table, &binding, &(struct action){ACTION_PREV_TAB, 0})) {
+			added++;
+		}
+	}
+	ck_assert_int_eq(added, KEYBINDING_TABLE_SIZE - 1);
+
+	/* Lookups of unbound keys still end */
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_ALT, 0x1), ACTION_NONE);
+	ck_assert_int_eq(lookup(&table, WLR_MODIFIER_ALT, 0x1000 + 5), ACTION_PREV_TAB);
+}
+END_TEST
+
 Suite *
 keybinding_suite(void)
 {
@@ -153,6 +238,13 @@ keybinding_suite(void)
 	tcase_add_test(tcase_match, test_match);
 	suite_add_tcase(suite, tcase_match);
 
+	TCase *tcase_table = tcase_create("table");
+	tcase_add_test(tcase_table, test_table_lookup);
+	tcase_add_test(tcase_table, test_table_action_arg);
+	tcase_add_test(tcase_table, test_table_duplicates);
+	tcase_add_test(tcase_table, test_table_full);
+	suite_add_tcase(suite, tcase_table);
+
 	return suite;
 }
 
@@ -0,0 +1,864 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+/*
+ * End-to-end latency benchmark
+ *
+ * Runs WayMux on the headless backend and measures, as a user would see
+ * them:
+ *  - waymuxctl new-tab to the new tab's first frame
+ *  - a key press (Super+K, next tab) to the next tab being on screen
+ *  - WayMux starting a profile to all of its tabs having drawn a frame
+ *
+ * The tabs are this same binary run with --client: a minimal xdg-shell
+ * client that reports on a FIFO when WayMux mapped it, and when a frame of
+ * its surface was shown, that is when the compositor sent the frame
+ * callback of the commit. Key
+ * presses come from a virtual keyboard. Times are CLOCK_MONOTONIC, shared
+ * by all processes, and reported as percentiles in JSON.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/input-event-codes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include "virtual-keyboard-unstable-v1-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#define DEFAULT_SAMPLES 20
+#define PROFILE_TABS 5
+#define EVENT_TIMEOUT_MS 10000
+#define INSTANCE_NAME "latency"
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* Test client */
+
+struct client {
+	struct wl_display *display;
+	struct wl_compositor *compositor;
+	struct wl_shm *shm;
+	struct xdg_wm_base *wm_base;
+
+	struct wl_surface *surface;
+	struct xdg_surface *xdg_surface;
+	struct xdg_toplevel *toplevel;
+
+	int width, height;
+	bool pending_activated;
+	bool activated;
+	bool mapped; /* A buffer was committed */
+	bool shown;  /* The first frame was shown */
+	bool hidden; /* Deactivated since it was last shown */
+
+	int report_fd;
+};
+
+static void
+client_report(struct client *client, const char *kind)
+{
+	char line[64];
+	int len = snprintf(line, sizeof(line), "%s %llu\n", kind, (unsigned long long)now_ns());
+	/* Shorter than PIPE_BUF, so written whole even with many clients */
+	if (write(client->report_fd, line, len) != len) {
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+buffer_release(void *data, struct wl_buffer *buffer)
+{
+	wl_buffer_destroy(buffer);
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+	.release = buffer_release,
+};
+
+static struct wl_buffer *
+client_create_buffer(struct client *client)
+{
+	int stride = client->width * 4;
+	size_t size = (size_t)stride * client->height;
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/waymux-latency-XXXXXX", getenv("XDG_RUNTIME_DIR"));
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return NULL;
+	}
+	unlink(path);
+	if (ftruncate(fd, size) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	uint32_t *pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (pixels == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+	for (size_t i = 0; i < size / 4; i++) {
+		pixels[i] = 0xff336699;
+	}
+	munmap(pixels, size);
+
+	struct wl_shm_pool *pool = wl_shm_create_pool(client->shm, fd, size);
+	struct wl_buffer *buffer =
+		wl_shm_pool_create_buffer(pool, 0, client->width, client->height, stride, WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	wl_buffer_add_listener(buffer, &buffer_listener, NULL);
+	return buffer;
+}
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct client *client = data;
+	wl_callback_destroy(callback);
+
+	if (!client->shown) {
+		client->shown = true;
+		client_report(client, "first_frame");
+	} else {
+		client_report(client, "visible");
+	}
+}
+
+static const struct wl_callback_listener frame_listener = {
+	.done = frame_done,
+};
+
+/* The compositor handled the first commit with a buffer, which is when it
+ * maps the view; background tabs never get a frame callback */
+static void
+sync_done(void *data, struct wl_callback *callback, uint32_t serial)
+{
+	struct client *client = data;
+	wl_callback_destroy(callback);
+	client_report(client, "mapped");
+}
+
+static const struct wl_callback_listener sync_listener = {
+	.done = sync_done,
+};
+
+/* Draw a frame, reported once it is on screen */
+static void
+client_draw(struct client *client)
+{
+	struct wl_buffer *buffer = client_create_buffer(client);
+	if (!buffer) {
+		exit(EXIT_FAILURE);
+	}
+	wl_surface_attach(client->surface, buffer, 0, 0);
+	wl_surface_damage(client->surface, 0, 0, INT32_MAX, INT32_MAX);
+	struct wl_callback *callback = wl_surface_frame(client->surface);
+	wl_callback_add_listener(callback, &frame_listener, client);
+	wl_surface_commit(client->surface);
+
+	if (!client->mapped) {
+		client->mapped = true;
+		callback = wl_display_sync(client->display);
+		wl_callback_add_listener(callback, &sync_listener, client);
+	}
+}
+
+static void
+toplevel_configure(void *data, struct xdg_toplevel *toplevel, int32_t width, int32_t height,
+		   struct wl_array *states)
+{
+	struct client *client = data;
+	if (width > 0 && height > 0) {
+		client->width = width;
+		client->height = height;
+	}
+
+	client->pending_activated = false;
+	uint32_t *state;
+	wl_array_for_each(state, states) {
+		if (*state == XDG_TOPLEVEL_STATE_ACTIVATED) {
+			client->pending_activated = true;
+		}
+	}
+}
+
+static void
+toplevel_close(void *data, struct xdg_toplevel *toplevel)
+{
+	exit(EXIT_SUCCESS);
+}
+
+static const struct xdg_toplevel_listener toplevel_listener = {
+	.configure = toplevel_configure,
+	.close = toplevel_close,
+};
+
+static void
+xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+	struct client *client = data;
+	xdg_surface_ack_configure(xdg_surface, serial);
+
+	bool activating = client->pending_activated && !client->activated;
+	client->activated = client->pending_activated;
+
+	if (!client->mapped) {
+		/* The first configure; a new tab is activated when mapped */
+		client_draw(client);
+	} else if (!client->activated) {
+		client->hidden = true;
+	} else if (activating && client->hidden) {
+		/* Redraw, as clients do when focused, to see when it's shown */
+		client->hidden = false;
+		client_draw(client);
+	}
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+	.configure = xdg_surface_configure,
+};
+
+static void
+wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+	xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+	.ping = wm_base_ping,
+};
+
+static void
+client_registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface,
+		       uint32_t version)
+{
+	struct client *client = data;
+	if (strcmp(interface, wl_compositor_interface.name) == 0) {
+		client->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+	} else if (strcmp(interface, wl_shm_interface.name) == 0) {
+		client->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+		client->wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+		xdg_wm_base_add_listener(client->wm_base, &wm_base_listener, NULL);
+	}
+}
+
+static void
+registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener client_registry_listener = {
+	.global = client_registry_global,
+	.global_remove = registry_global_remove,
+};
+
+static int
+run_client(const char *fifo)
+{
+	struct client client = {.width = 64, .height = 64};
+	client.report_fd = open(fifo, O_WRONLY | O_APPEND);
+	if (client.report_fd < 0) {
+		perror(fifo);
+		return EXIT_FAILURE;
+	}
+
+	client.display = wl_display_connect(NULL);
+	if (!client.display) {
+		fprintf(stderr, "Failed to connect to the compositor\n");
+		return EXIT_FAILURE;
+	}
+	struct wl_registry *registry = wl_display_get_registry(client.display);
+	wl_registry_add_listener(registry, &client_registry_listener, &client);
+	wl_display_roundtrip(client.display);
+	if (!client.compositor || !client.shm || !client.wm_base) {
+		fprintf(stderr, "The compositor lacks wl_compositor, wl_shm or xdg_wm_base\n");
+		return EXIT_FAILURE;
+	}
+
+	client.surface = wl_compositor_create_surface(client.compositor);
+	client.xdg_surface = xdg_wm_base_get_xdg_surface(client.wm_base, client.surface);
+	xdg_surface_add_listener(client.xdg_surface, &xdg_surface_listener, &client);
+	client.toplevel = xdg_surface_get_toplevel(client.xdg_surface);
+	xdg_toplevel_add_listener(client.toplevel, &toplevel_listener, &client);
+	xdg_toplevel_set_app_id(client.toplevel, "waymux-latency");
+	xdg_toplevel_set_title(client.toplevel, "Latency");
+	wl_surface_commit(client.surface);
+
+	/* Until the compositor goes away */
+	while (wl_display_dispatch(client.display) != -1) {
+	}
+	return EXIT_SUCCESS;
+}
+
+/* Benchmark driver */
+
+struct driver {
+	char *dir;
+	char fifo[PATH_MAX];
+	char log[PATH_MAX];
+	char self[PATH_MAX];
+	const char *waymux;
+	pid_t pid;
+	int events_fd;
+
+	/* Partial line read from the FIFO */
+	char line[128];
+	size_t line_len;
+
+	/* Virtual keyboard */
+	struct wl_display *display;
+	struct wl_seat *seat;
+	struct zwp_virtual_keyboard_manager_v1 *keyboard_manager;
+	struct zwp_virtual_keyboard_v1 *keyboard;
+	uint32_t logo_mask;
+};
+
+struct result {
+	const char *name;
+	uint64_t *samples;
+	int count;
+};
+
+static void
+fail(struct driver *driver, const char *message)
+{
+	fprintf(stderr, "%s\n", message);
+
+	/* Show what WayMux had to say about it */
+	FILE *log = fopen(driver->log, "r");
+	if (log) {
+		char buf[4096];
+		size_t n;
+		fprintf(stderr, "--- WayMux log:\n");
+		while ((n = fread(buf, 1, sizeof(buf), log)) > 0) {
+			fwrite(buf, 1, n, stderr);
+		}
+		fclose(log);
+	}
+	if (driver->pid > 0) {
+		kill(driver->pid, SIGTERM);
+	}
+	exit(EXIT_FAILURE);
+}
+
+static void
+start_waymux(struct driver *driver, const char *profile)
+{
+	driver->pid = fork();
+	if (driver->pid < 0) {
+		fail(driver, "Failed to fork");
+	}
+	if (driver->pid == 0) {
+		int fd = open(driver->log, O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (fd >= 0) {
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+		setenv("WLR_BACKENDS", "headless", 1);
+		setenv("WLR_RENDERER", "pixman", 1);
+		setenv("WLR_HEADLESS_OUTPUTS", "1", 1);
+		unsetenv("WAYLAND_DISPLAY");
+		unsetenv("DISPLAY");
+
+		char *argv[] = {(char *)driver->waymux, "-i", INSTANCE_NAME, (char *)profile, NULL};
+		execv(driver->waymux, argv);
+		_exit(127);
+	}
+}
+
+static void
+control_path(struct driver *driver, char *path, size_t size)
+{
+	snprintf(path, size, "%s/waymux/%s.sock", driver->dir, INSTANCE_NAME);
+}
+
+static void
+wait_for_control_socket(struct driver *driver)
+{
+	char path[PATH_MAX];
+	control_path(driver, path, sizeof(path));
+
+	struct stat st;
+	for (int i = 0; i < EVENT_TIMEOUT_MS / 10; i++) {
+		if (stat(path, &st) == 0) {
+			return;
+		}
+		if (waitpid(driver->pid, NULL, WNOHANG) == driver->pid) {
+			driver->pid = 0;
+			fail(driver, "WayMux exited during startup");
+		}
+		nanosleep(&(struct timespec){.tv_nsec = 10000000}, NULL);
+	}
+	fail(driver, "Timed out waiting for the control socket");
+}
+
+static void
+stop_waymux(struct driver *driver)
+{
+	kill(driver->pid, SIGTERM);
+	waitpid(driver->pid, NULL, 0);
+	driver->pid = 0;
+}
+
+/* Run a control command, as waymuxctl does */
+static void
+control_command(struct driver *driver, const char *command)
+{
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	control_path(driver, addr.sun_path, sizeof(addr.sun_path));
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		fail(driver, "Failed to connect to the control socket");
+	}
+	size_t len = strlen(command);
+	if (write(fd, command, len) != (ssize_t)len || write(fd, "\n", 1) != 1) {
+		fail(driver, "Failed to send a control command");
+	}
+
+	char response[256];
+	size_t got = 0;
+	ssize_t n;
+	while (got < sizeof(response) - 1 && (n = read(fd, response + got, sizeof(response) - 1 - got)) > 0) {
+		got += n;
+	}
+	response[got] = '\0';
+	close(fd);
+
+	if (strncmp(response, "OK", 2) != 0) {
+		fprintf(stderr, "%s: %s", command, response);
+		fail(driver, "Control command failed");
+	}
+}
+
+/* Wait up to timeout_ms for a report of the given kind from a client and
+ * return its time, or 0 on timeout. Reports of other kinds are dropped. */
+static uint64_t
+wait_event(struct driver *driver, const char *kind, int timeout_ms)
+{
+	uint64_t deadline = now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+	for (;;) {
+		char *newline = memchr(driver->line, '\n', driver->line_len);
+		while (newline) {
+			*newline = '\0';
+			char event[32];
+			unsigned long long ns;
+			bool match = sscanf(driver->line, "%31s %llu", event, &ns) == 2 && strcmp(event, kind) == 0;
+
+			size_t used = newline + 1 - driver->line;
+			memmove(driver->line, newline + 1, driver->line_len - used);
+			driver->line_len -= used;
+			if (match) {
+				return ns;
+			}
+			newline = memchr(driver->line, '\n', driver->line_len);
+		}
+
+		uint64_t now = now_ns();
+		if (now >= deadline) {
+			return 0;
+		}
+		struct pollfd pfd = {.fd = driver->events_fd, .events = POLLIN};
+		if (poll(&pfd, 1, (int)((deadline - now) / 1000000) + 1) <= 0) {
+			continue;
+		}
+		ssize_t n = read(driver->events_fd, driver->line + driver->line_len,
+				 sizeof(driver->line) - driver->line_len);
+		if (n > 0) {
+			driver->line_len += n;
+		} else if (driver->line_len == sizeof(driver->line)) {
+			driver->line_len = 0; /* Garbage */
+		}
+	}
+}
+
+/* Drop any reports still coming in, waiting a little for stragglers */
+static void
+drain_events(struct driver *driver)
+{
+	wait_event(driver, "", 50);
+	driver->line_len = 0;
+}
+
+static void
+keyboard_registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface,
+			 uint32_t version)
+{
+	struct driver *driver = data;
+	if (strcmp(interface, wl_seat_interface.name) == 0 && !driver->seat) {
+		driver->seat = wl_registry_bind(registry, name, &wl_seat_interface, 1);
+	} else if (strcmp(interface, zwp_virtual_keyboard_manager_v1_interface.name) == 0) {
+		driver->keyboard_manager =
+			wl_registry_bind(registry, name, &zwp_virtual_keyboard_manager_v1_interface, 1);
+	}
+}
+
+static const struct wl_registry_listener keyboard_registry_listener = {
+	.global = keyboard_registry_global,
+	.global_remove = registry_global_remove,
+};
+
+/* The name of the WayMux Wayland socket in the runtime directory */
+static bool
+find_wayland_socket(struct driver *driver, char *name, size_t size)
+{
+	DIR *dir = opendir(driver->dir);
+	if (!dir) {
+		return false;
+	}
+	bool found = false;
+	struct dirent *ent;
+	while (!found && (ent = readdir(dir))) {
+		const char *lock = strstr(ent->d_name, ".lock");
+		if (strncmp(ent->d_name, "wayland-", 8) == 0 && !lock) {
+			snprintf(name, size, "%s", ent->d_name);
+			found = true;
+		}
+	}
+	closedir(dir);
+	return found;
+}
+
+static void
+connect_keyboard(struct driver *driver)
+{
+	char socket_name[64];
+	if (!find_wayland_socket(driver, socket_name, sizeof(socket_name))) {
+		fail(driver, "No Wayland socket in the runtime directory");
+	}
+	driver->display = wl_display_connect(socket_name);
+	if (!driver->display) {
+		fail(driver, "Failed to connect to WayMux");
+	}
+	struct wl_registry *registry = wl_display_get_registry(driver->display);
+	wl_registry_add_listener(registry, &keyboard_registry_listener, driver);
+	wl_display_roundtrip(driver->display);
+	if (!driver->seat || !driver->keyboard_manager) {
+		fail(driver, "WayMux lacks wl_seat or zwp_virtual_keyboard_manager_v1");
+	}
+	driver->keyboard = zwp_virtual_keyboard_manager_v1_create_virtual_keyboard(driver->keyboard_manager,
+										   driver->seat);
+
+	/* The default keymap, as WayMux uses for its own keyboards */
+	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+	struct xkb_keymap *keymap = context ? xkb_keymap_new_from_names(context, NULL, XKB_KEYMAP_COMPILE_NO_FLAGS)
+					    : NULL;
+	char *keymap_string = keymap ? xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1) : NULL;
+	if (!keymap_string) {
+		fail(driver, "Failed to compile a keymap");
+	}
+	driver->logo_mask = 1u << xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_LOGO);
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/keymap-XXXXXX", driver->dir);
+	int fd = mkstemp(path);
+	size_t size = strlen(keymap_string) + 1;
+	if (fd < 0 || write(fd, keymap_string, size) != (ssize_t)size) {
+		fail(driver, "Failed to write the keymap");
+	}
+	unlink(path);
+	zwp_virtual_keyboard_v1_keymap(driver->keyboard, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, fd, size);
+	wl_display_roundtrip(driver->display);
+	close(fd);
+
+	free(keymap_string);
+	xkb_keymap_unref(keymap);
+	xkb_context_unref(context);
+}
+
+static void
+disconnect_keyboard(struct driver *driver)
+{
+	zwp_virtual_keyboard_v1_destroy(driver->keyboard);
+	zwp_virtual_keyboard_manager_v1_destroy(driver->keyboard_manager);
+	wl_seat_destroy(driver->seat);
+	wl_display_disconnect(driver->display);
+	driver->keyboard = NULL;
+	driver->keyboard_manager = NULL;
+	driver->seat = NULL;
+	driver->display = NULL;
+}
+
+/* Press and release Super+key */
+static void
+press_super(struct driver *driver, uint32_t key)
+{
+	uint32_t time = (uint32_t)(now_ns() / 1000000);
+	zwp_virtual_keyboard_v1_modifiers(driver->keyboard, driver->logo_mask, 0, 0, 0);
+	zwp_virtual_keyboard_v1_key(driver->keyboard, time, key, WL_KEYBOARD_KEY_STATE_PRESSED);
+	zwp_virtual_keyboard_v1_key(driver->keyboard, time, key, WL_KEYBOARD_KEY_STATE_RELEASED);
+	zwp_virtual_keyboard_v1_modifiers(driver->keyboard, 0, 0, 0, 0);
+	wl_display_flush(driver->display);
+}
+
+static void
+measure_new_tab(struct driver *driver, struct result *result)
+{
+	char command[PATH_MAX * 2 + 32];
+	snprintf(command, sizeof(command), "new-tab -- %s --client %s", driver->self, driver->fifo);
+
+	for (int i = 0; i < result->count; i++) {
+		uint64_t start = now_ns();
+		control_command(driver, command);
+		uint64_t shown = wait_event(driver, "first_frame", EVENT_TIMEOUT_MS);
+		if (!shown) {
+			fail(driver, "Timed out waiting for a new tab's first frame");
+		}
+		result->samples[i] = shown - start;
+	}
+}
+
+static void
+measure_key_press(struct driver *driver, struct result *result)
+{
+	connect_keyboard(driver);
+	for (int i = 0; i < result->count; i++) {
+		drain_events(driver);
+		uint64_t start = now_ns();
+		press_super(driver, KEY_K);
+		uint64_t shown = wait_event(driver, "visible", EVENT_TIMEOUT_MS);
+		if (!shown) {
+			fail(driver, "Timed out waiting for the next tab to be shown");
+		}
+		result->samples[i] = shown - start;
+	}
+	disconnect_keyboard(driver);
+}
+
+static void
+write_profile(struct driver *driver)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/config", driver->dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/config/waymux", driver->dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/config/waymux/profiles.d", driver->dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/config/waymux/profiles.d/%s.toml", driver->dir, INSTANCE_NAME);
+
+	FILE *file = fopen(path, "w");
+	if (!file) {
+		fail(driver, "Failed to write the profile");
+	}
+	for (int i = 0; i < PROFILE_TABS; i++) {
+		fprintf(file, "[[tabs]]\ncommand = \"%s\"\nargs = [\"--client\", \"%s\"]\n\n", driver->self,
+			driver->fifo);
+	}
+	fclose(file);
+}
+
+static void
+measure_profile_start(struct driver *driver, struct result *result)
+{
+	write_profile(driver);
+	for (int i = 0; i < result->count; i++) {
+		drain_events(driver);
+		uint64_t start = now_ns();
+		start_waymux(driver, INSTANCE_NAME);
+		uint64_t mapped = 0;
+		for (int tab = 0; tab < PROFILE_TABS; tab++) {
+			mapped = wait_event(driver, "mapped", EVENT_TIMEOUT_MS);
+			if (!mapped) {
+				fail(driver, "Timed out waiting for the profile's tabs");
+			}
+		}
+		result->samples[i] = mapped - start;
+		stop_waymux(driver);
+	}
+}
+
+static int
+compare_samples(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+/* Nearest-rank percentile of sorted samples, in microseconds */
+static double
+percentile(const struct result *result, int p)
+{
+	int rank = (p * result->count + 99) / 100;
+	return (double)result->samples[rank > 0 ? rank - 1 : 0] / 1000.0;
+}
+
+static void
+write_report(FILE *out, struct result *results, int count)
+{
+	fprintf(out, "{\n  \"benchmarks\": [\n");
+	for (int i = 0; i < count; i++) {
+		struct result *result = &results[i];
+		qsort(result->samples, result->count, sizeof(*result->samples), compare_samples);
+		fprintf(out,
+			"    {\"name\": \"%s\", \"samples\": %d, \"min_us\": %.1f, \"p50_us\": %.1f, "
+			"\"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}%s\n",
+			result->name, result->count, percentile(result, 0), percentile(result, 50),
+			percentile(result, 90), percentile(result, 99), percentile(result, 100),
+			i + 1 < count ? "," : "");
+		fprintf(stderr, "%-24s p50 %9.1f us, p90 %9.1f us, p99 %9.1f us\n", result->name,
+			percentile(result, 50), percentile(result, 90), percentile(result, 99));
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-n SAMPLES] [-o FILE] WAYMUX\n"
+			"Measure the latencies of the WayMux binary WAYMUX on the headless backend\n"
+			"and write them as JSON to FILE, or to standard output.\n",
+		name);
+}
+
+static void
+remove_dir(const char *path)
+{
+	DIR *dir = opendir(path);
+	if (!dir) {
+		return;
+	}
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+			continue;
+		}
+		char child[PATH_MAX];
+		snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
+		struct stat st;
+		if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode)) {
+			remove_dir(child);
+		} else {
+			unlink(child);
+		}
+	}
+	closedir(dir);
+	rmdir(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc == 3 && strcmp(argv[1], "--client") == 0) {
+		return run_client(argv[2]);
+	}
+
+	int samples = DEFAULT_SAMPLES;
+	const char *output = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "hn:o:")) != -1) {
+		switch (opt) {
+		case 'n':
+			samples = atoi(optarg);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || samples <= 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	struct driver driver = {.waymux = argv[optind]};
+	if (!realpath(argv[0], driver.self)) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* A runtime and config directory of our own, so that neither a
+	 * running WayMux nor the user's configuration get in the way */
+	char dir[] = "/tmp/waymux-latency-XXXXXX";
+	driver.dir = mkdtemp(dir);
+	if (!driver.dir) {
+		perror("mkdtemp");
+		return EXIT_FAILURE;
+	}
+	chmod(driver.dir, 0700);
+	setenv("XDG_RUNTIME_DIR", driver.dir, 1);
+	char config_home[PATH_MAX];
+	snprintf(config_home, sizeof(config_home), "%s/config", driver.dir);
+	setenv("XDG_CONFIG_HOME", config_home, 1);
+	snprintf(driver.log, sizeof(driver.log), "%s/waymux.log", driver.dir);
+
+	/* Opened for writing too, so it never sees EOF between clients */
+	snprintf(driver.fifo, sizeof(driver.fifo), "%s/events", driver.dir);
+	if (mkfifo(driver.fifo, 0600) != 0 || (driver.events_fd = open(driver.fifo, O_RDWR | O_NONBLOCK)) < 0) {
+		perror(driver.fifo);
+		return EXIT_FAILURE;
+	}
+
+	/* Profile starts restart WayMux each time, so take fewer */
+	int profile_samples = samples < 5 ? samples : 5;
+	struct result results[] = {
+		{"new_tab_first_frame", calloc(samples, sizeof(uint64_t)), samples},
+		{"key_press_tab_shown", calloc(samples, sizeof(uint64_t)), samples},
+		{"profile_start_mapped", calloc(profile_samples, sizeof(uint64_t)), profile_samples},
+	};
+
+	start_waymux(&driver, NULL);
+	wait_for_control_socket(&driver);
+	measure_new_tab(&driver, &results[0]);
+	measure_key_press(&driver, &results[1]);
+	stop_waymux(&driver);
+
+	measure_profile_start(&driver, &results[2]);
+
+	FILE *out = output ? fopen(output, "w") : stdout;
+	if (!out) {
+		perror(output);
+		return EXIT_FAILURE;
+	}
+	int count = sizeof(results) / sizeof(results[0]);
+	write_report(out, results, count);
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	for (int i = 0; i < count; i++) {
+		free(results[i].samples);
+	}
+	close(driver.events_fd);
+	remove_dir(driver.dir);
+	return EXIT_SUCCESS;
+}
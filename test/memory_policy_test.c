@@ -0,0 +1,131 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "background_dialog.h"
+#include "launcher.h"
+#include "memory_policy.h"
+#include "profile_selector.h"
+#include "server.h"
+
+static struct cg_server server;
+static struct wl_event_loop *loop;
+
+/* Overlay stubs: count releases, and free nothing */
+static int launcher_releases;
+static int dialog_releases;
+static int selector_releases;
+
+size_t
+launcher_release(struct cg_launcher *launcher)
+{
+	launcher_releases++;
+	return 0;
+}
+
+size_t
+background_dialog_release(struct cg_background_dialog *dialog)
+{
+	dialog_releases++;
+	return 0;
+}
+
+size_t
+profile_selector_release(struct cg_profile_selector *selector)
+{
+	selector_releases++;
+	return 0;
+}
+
+static void
+setup(void)
+{
+	memset(&server, 0, sizeof(server));
+	loop = wl_event_loop_create();
+	launcher_releases = dialog_releases = selector_releases = 0;
+}
+
+static void
+teardown(void)
+{
+	wl_event_loop_destroy(loop);
+}
+
+/* Test: a trim releases every overlay, and is counted */
+START_TEST(test_trim)
+{
+	struct cg_memory_policy *policy = memory_policy_create(&server, loop);
+	ck_assert_ptr_nonnull(policy);
+
+	memory_policy_trim(policy, false);
+	ck_assert_int_eq(launcher_releases, 1);
+	ck_assert_int_eq(dialog_releases, 1);
+	ck_assert_int_eq(selector_releases, 1);
+	ck_assert_uint_eq(policy->trims, 1);
+	ck_assert_uint_eq(policy->pressure_trims, 0);
+
+	memory_policy_trim(policy, true);
+	ck_assert_uint_eq(policy->trims, 2);
+	ck_assert_uint_eq(policy->pressure_trims, 1);
+
+	memory_policy_destroy(policy);
+}
+END_TEST
+
+/* Test: scheduled trims wait for the overlays to stay hidden a while */
+START_TEST(test_schedule)
+{
+	struct cg_memory_policy *policy = memory_policy_create(&server, loop);
+	ck_assert_ptr_nonnull(policy);
+
+	memory_policy_schedule_trim(policy);
+	memory_policy_schedule_trim(policy);
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert_uint_eq(policy->trims, 0);
+	ck_assert_int_eq(launcher_releases, 0);
+
+	/* Without a policy, nothing is scheduled */
+	memory_policy_schedule_trim(NULL);
+
+	memory_policy_destroy(policy);
+	memory_policy_destroy(NULL);
+}
+END_TEST
+
+Suite *
+memory_policy_suite(void)
+{
+	Suite *s = suite_create("memory_policy");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_trim);
+	tcase_add_test(tc_core, test_schedule);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = memory_policy_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
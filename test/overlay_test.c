@@ -0,0 +1,119 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "overlay.h"
+
+/* Test: a fresh overlay has no damage */
+START_TEST(test_overlay_init_clean)
+{
+	struct cg_overlay overlay;
+	overlay_init(&overlay);
+
+	ck_assert(!overlay_needs_paint(&overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_BOX_HEIGHT));
+
+	overlay_finish(&overlay);
+}
+END_TEST
+
+/* Test: row damage only covers that row */
+START_TEST(test_overlay_damage_row)
+{
+	struct cg_overlay overlay;
+	overlay_init(&overlay);
+
+	overlay_damage_row(&overlay, 2);
+
+	int row_y = OVERLAY_RESULTS_Y + 2 * OVERLAY_ITEM_HEIGHT;
+	ck_assert(overlay_needs_paint(&overlay, 0, row_y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT));
+	ck_assert(!overlay_needs_paint(&overlay, 0, row_y - OVERLAY_ITEM_HEIGHT, OVERLAY_BOX_WIDTH,
+				       OVERLAY_ITEM_HEIGHT));
+	ck_assert(!overlay_needs_paint(&overlay, 0, row_y + OVERLAY_ITEM_HEIGHT, OVERLAY_BOX_WIDTH,
+				       OVERLAY_ITEM_HEIGHT));
+	ck_assert(!overlay_needs_paint(&overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT));
+
+	/* Rows past the visible list are ignored */
+	overlay_damage_row(&overlay, OVERLAY_MAX_ITEMS);
+	ck_assert(!overlay_needs_paint(&overlay, 0, OVERLAY_RESULTS_Y + OVERLAY_MAX_ITEMS * OVERLAY_ITEM_HEIGHT,
+				       OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT));
+
+	overlay_finish(&overlay);
+}
+END_TEST
+
+/* Test: query and results damage are disjoint */
+START_TEST(test_overlay_damage_query_results)
+{
+	struct cg_overlay overlay;
+	overlay_init(&overlay);
+
+	overlay_damage_query(&overlay);
+	ck_assert(overlay_needs_paint(&overlay, 0, 0, OVERLAY_BOX_WIDTH, OVERLAY_SEARCH_HEIGHT));
+	ck_assert(!overlay_needs_paint(&overlay, 0, OVERLAY_RESULTS_Y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT));
+
+	overlay_damage_results(&overlay);
+	ck_assert(overlay_needs_paint(&overlay, 0, OVERLAY_RESULTS_Y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT));
+
+	overlay_finish(&overlay);
+}
+END_TEST
+
+/* Test: damage stays in logical coordinates whatever the scale */
+START_TEST(test_overlay_damage_scaled)
+{
+	struct cg_overlay overlay;
+	overlay_init(&overlay);
+	ck_assert(overlay.scale == 1);
+
+	overlay_set_scale(&overlay, 2);
+	ck_assert(overlay.scale == 2);
+	overlay_damage_row(&overlay, 1);
+	int row_y = OVERLAY_RESULTS_Y + OVERLAY_ITEM_HEIGHT;
+	ck_assert(overlay_needs_paint(&overlay, 0, row_y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT));
+	ck_assert(!overlay_needs_paint(&overlay, 0, 2 * row_y, OVERLAY_BOX_WIDTH, OVERLAY_ITEM_HEIGHT));
+
+	/* Outputs without a scale get 1 */
+	overlay_set_scale(&overlay, 0);
+	ck_assert(overlay.scale == 1);
+
+	overlay_finish(&overlay);
+}
+END_TEST
+
+Suite *
+overlay_suite(void)
+{
+	Suite *s = suite_create("overlay");
+
+	TCase *tc_core = tcase_create("Damage");
+	tcase_add_test(tc_core, test_overlay_init_clean);
+	tcase_add_test(tc_core, test_overlay_damage_row);
+	tcase_add_test(tc_core, test_overlay_damage_query_results);
+	tcase_add_test(tc_core, test_overlay_damage_scaled);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = overlay_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+#include <wlr/interfaces/wlr_buffer.h>
+
+#include "pixel_buffer.h"
+
+static void
+teardown(void)
+{
+	pixel_buffer_pool_finish();
+}
+
+/* Test: a released buffer is reused for the same size */
+START_TEST(test_pool_reuse)
+{
+	struct pixel_buffer_pool_stats before, after;
+	pixel_buffer_pool_get_stats(&before);
+
+	struct pixel_buffer *first = pixel_buffer_acquire(600, 400);
+	ck_assert_ptr_nonnull(first);
+	ck_assert_int_eq(first->width, 600);
+	ck_assert_int_eq(first->height, 400);
+	ck_assert_uint_ge(first->capacity, first->size);
+	wlr_buffer_drop(&first->base);
+
+	struct pixel_buffer *second = pixel_buffer_acquire(600, 400);
+	ck_assert_ptr_eq(second, first);
+	wlr_buffer_drop(&second->base);
+
+	pixel_buffer_pool_get_stats(&after);
+	ck_assert_uint_eq(after.misses - before.misses, 1);
+	ck_assert_uint_eq(after.hits - before.hits, 1);
+	ck_assert_uint_eq(after.pooled_bytes, first->capacity);
+}
+END_TEST
+
+/* Test: buffers of different sizes in the same bucket share storage */
+START_TEST(test_pool_bucket)
+{
+	struct pixel_buffer *first = pixel_buffer_acquire(130, 36);
+	ck_assert_ptr_nonnull(first);
+	wlr_buffer_drop(&first->base);
+
+	struct pixel_buffer *second = pixel_buffer_acquire(140, 36);
+	ck_assert_ptr_eq(second, first);
+	ck_assert_int_eq(second->width, 140);
+	ck_assert_int_eq(second->base.width, 140);
+	wlr_buffer_drop(&second->base);
+}
+END_TEST
+
+/* Test: a buffer still held elsewhere is not reused */
+START_TEST(test_pool_locked)
+{
+	struct pixel_buffer *first = pixel_buffer_acquire(64, 64);
+	ck_assert_ptr_nonnull(first);
+	wlr_buffer_lock(&first->base);
+	wlr_buffer_drop(&first->base);
+
+	struct pixel_buffer *second = pixel_buffer_acquire(64, 64);
+	ck_assert_ptr_ne(second, first);
+
+	wlr_buffer_unlock(&first->base);
+	wlr_buffer_drop(&second->base);
+}
+END_TEST
+
+/* Test: trimming frees the pooled buffers, and pooling goes on */
+START_TEST(test_pool_trim)
+{
+	struct pixel_buffer *buffer = pixel_buffer_acquire(600, 400);
+	ck_assert_ptr_nonnull(buffer);
+	wlr_buffer_drop(&buffer->base);
+
+	struct pixel_buffer_pool_stats stats;
+	pixel_buffer_pool_get_stats(&stats);
+	ck_assert_uint_gt(stats.pooled_bytes, 0);
+
+	pixel_buffer_pool_trim();
+	pixel_buffer_pool_get_stats(&stats);
+	ck_assert_uint_eq(stats.pooled_bytes, 0);
+
+	buffer = pixel_buffer_acquire(600, 400);
+	ck_assert_ptr_nonnull(buffer);
+	wlr_buffer_drop(&buffer->base);
+	pixel_buffer_pool_get_stats(&stats);
+	ck_assert_uint_eq(stats.pooled_bytes, buffer->capacity);
+}
+END_TEST
+
+/* Test: invalid sizes are rejected */
+START_TEST(test_pool_invalid)
+{
+	ck_assert_ptr_null(pixel_buffer_acquire(0, 10));
+	ck_assert_ptr_null(pixel_buffer_acquire(10, -1));
+}
+END_TEST
+
+Suite *
+pixel_buffer_suite(void)
+{
+	Suite *s = suite_create("pixel_buffer");
+
+	TCase *tc_pool = tcase_create("Pool");
+	tcase_add_checked_fixture(tc_pool, NULL, teardown);
+	tcase_add_test(tc_pool, test_pool_reuse);
+	tcase_add_test(tc_pool, test_pool_bucket);
+	tcase_add_test(tc_pool, test_pool_locked);
+	tcase_add_test(tc_pool, test_pool_trim);
+	tcase_add_test(tc_pool, test_pool_invalid);
+	suite_add_tcase(s, tc_pool);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = pixel_buffer_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,150 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "bench.h"
+#include "profile.h"
+#include "profile_index.h"
+
+/* Not expected in the current directory, which profile_load() tries first */
+#define BENCH_PROFILE_NAME "waymux-bench-profile"
+
+/* Profiles listed by the profile selector */
+#define BENCH_INDEX_PROFILES 300
+
+/* Write a profile with tab_count tabs, each with arguments */
+static void
+write_profile(const char *path, int tab_count)
+{
+	size_t size = 512 + (size_t)tab_count * 160;
+	char *contents = malloc(size);
+	if (!contents) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+
+	int len = snprintf(contents, size,
+			   "working_dir = \"~/src\"\n"
+			   "proxy_command = [\"ssh\", \"-t\", \"devbox\"]\n"
+			   "\n"
+			   "[env]\n"
+			   "EDITOR = \"vim\"\n"
+			   "PAGER = \"less\"\n"
+			   "LANG = \"en_US.UTF-8\"\n");
+	for (int i = 0; i < tab_count; i++) {
+		len += snprintf(contents + len, size - len,
+				"\n[[tabs]]\n"
+				"command = \"foot\"\n"
+				"title = \"Tab %d\"\n"
+				"args = [\"--app-id\", \"tab%d\", \"-e\", \"htop\"]\n"
+				"%s",
+				i, i, i % 4 == 0 ? "background = true\n" : "");
+	}
+
+	bench_write_file(path, contents);
+	free(contents);
+}
+
+static void
+bench_load(void *data)
+{
+	(void)data;
+	struct profile *profile = profile_load(BENCH_PROFILE_NAME);
+	if (!profile) {
+		fprintf(stderr, "Failed to load the benchmark profile\n");
+		exit(EXIT_FAILURE);
+	}
+	profile_free(profile);
+}
+
+struct index_bench {
+	const char *profiles_dir;
+	const char *index_path;
+	struct cg_profile_index *index;
+};
+
+/* Open the selector with nothing changed since it was last shown */
+static void
+bench_index_refresh(void *data)
+{
+	struct index_bench *bench = data;
+	profile_index_refresh(bench->index, bench->profiles_dir);
+}
+
+/* Start up with an index written by an earlier run */
+static void
+bench_index_load(void *data)
+{
+	struct index_bench *bench = data;
+	struct cg_profile_index *index = profile_index_load(bench->index_path);
+	profile_index_refresh(index, bench->profiles_dir);
+	profile_index_destroy(index);
+}
+
+void
+profile_bench(void)
+{
+	char *dir = bench_make_dir();
+	char path[512];
+	snprintf(path, sizeof(path), "%s/waymux", dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/waymux/profiles.d", dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/waymux/profiles.d/%s.toml", dir, BENCH_PROFILE_NAME);
+
+	char *old_config_home = getenv("XDG_CONFIG_HOME");
+	old_config_home = old_config_home ? strdup(old_config_home) : NULL;
+	setenv("XDG_CONFIG_HOME", dir, 1);
+
+	static const int tab_counts[] = {1, 10, 100};
+	for (size_t i = 0; i < sizeof(tab_counts) / sizeof(tab_counts[0]); i++) {
+		write_profile(path, tab_counts[i]);
+
+		char name[64];
+		snprintf(name, sizeof(name), "profile_load/%d", tab_counts[i]);
+		bench_run(name, bench_load, NULL);
+	}
+
+	char profiles_dir[512];
+	snprintf(profiles_dir, sizeof(profiles_dir), "%s/waymux/profiles.d", dir);
+	for (int i = 0; i < BENCH_INDEX_PROFILES; i++) {
+		snprintf(path, sizeof(path), "%s/index-%03d.toml", profiles_dir, i);
+		write_profile(path, 5);
+	}
+
+	char index_path[512];
+	snprintf(index_path, sizeof(index_path), "%s/profiles.index", dir);
+	struct index_bench bench = {
+		.profiles_dir = profiles_dir,
+		.index_path = index_path,
+		.index = profile_index_load(NULL),
+	};
+	profile_index_refresh(bench.index, profiles_dir);
+	profile_index_save(bench.index, index_path);
+
+	char name[64];
+	snprintf(name, sizeof(name), "profile_index_refresh/%d", BENCH_INDEX_PROFILES);
+	bench_run(name, bench_index_refresh, &bench);
+	snprintf(name, sizeof(name), "profile_index_load/%d", BENCH_INDEX_PROFILES);
+	bench_run(name, bench_index_load, &bench);
+	profile_index_destroy(bench.index);
+
+	if (old_config_home) {
+		setenv("XDG_CONFIG_HOME", old_config_home, 1);
+		free(old_config_home);
+	} else {
+		unsetenv("XDG_CONFIG_HOME");
+	}
+	bench_remove_dir(dir);
+}
@@ -0,0 +1,230 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "profile.h"
+#include "profile_index.h"
+
+#define DAY (24 * 60 * 60)
+
+static char tmp_dir[64];
+static char profiles_dir[128];
+static char index_path[128];
+
+static void
+write_profile(const char *name, const char *contents)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s.toml", profiles_dir, name);
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+static void
+setup(void)
+{
+	snprintf(tmp_dir, sizeof(tmp_dir), "/tmp/waymux-profile-index-test-XXXXXX");
+	ck_assert_ptr_nonnull(mkdtemp(tmp_dir));
+	snprintf(profiles_dir, sizeof(profiles_dir), "%s/profiles.d", tmp_dir);
+	ck_assert_int_eq(mkdir(profiles_dir, 0700), 0);
+	snprintf(index_path, sizeof(index_path), "%s/state/waymux/profiles.index", tmp_dir);
+
+	write_profile("dev", "[[tabs]]\ncommand = \"foot\"\n\n[[tabs]]\ncommand = \"firefox\"\n");
+	write_profile("mail", "[[tabs]]\ncommand = \"thunderbird\"\n");
+	write_profile("broken", "[[tabs]\ncommand = \n");
+}
+
+static void
+teardown(void)
+{
+	char cmd[128];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", tmp_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+START_TEST(test_refresh_reads_metadata)
+{
+	struct cg_profile_index *index = profile_index_load(index_path);
+	ck_assert_ptr_nonnull(index);
+	ck_assert_uint_eq(index->count, 0);
+
+	ck_assert_uint_eq(profile_index_refresh(index, profiles_dir), 3);
+	ck_assert_uint_eq(index->parsed, 3);
+
+	/* Sorted by name */
+	ck_assert_str_eq(index->profiles[0].name, "broken");
+	ck_assert_str_eq(index->profiles[1].name, "dev");
+	ck_assert_str_eq(index->profiles[2].name, "mail");
+
+	ck_assert_int_eq(profile_index_find(index, "dev")->tab_count, 2);
+	ck_assert_int_eq(profile_index_find(index, "mail")->tab_count, 1);
+	ck_assert_int_eq(profile_index_find(index, "broken")->tab_count, -1);
+	ck_assert_ptr_null(profile_index_find(index, "missing"));
+
+	ck_assert_uint_ne(profile_index_find(index, "dev")->hash, profile_index_find(index, "mail")->hash);
+
+	profile_index_destroy(index);
+}
+END_TEST
+
+START_TEST(test_refresh_is_incremental)
+{
+	struct cg_profile_index *index = profile_index_load(index_path);
+	profile_index_refresh(index, profiles_dir);
+	ck_assert_int_eq(profile_index_save(index, index_path), 0);
+	ck_assert(!index->dirty);
+	profile_index_destroy(index);
+
+	/* A later start only looks at the files */
+	index = profile_index_load(index_path);
+	ck_assert_uint_eq(index->count, 3);
+	ck_assert_uint_eq(profile_index_refresh(index, profiles_dir), 3);
+	ck_assert_uint_eq(index->parsed, 0);
+	ck_assert(!index->dirty);
+	ck_assert_int_eq(profile_index_find(index, "dev")->tab_count, 2);
+
+	/* Only new and modified profiles are parsed, removed ones dropped */
+	write_profile("mail", "[[tabs]]\ncommand = \"thunderbird\"\n\n[[tabs]]\ncommand = \"foot\"\n");
+	write_profile("music", "[[tabs]]\ncommand = \"mpv\"\n");
+	char path[256];
+	snprintf(path, sizeof(path), "%s/broken.toml", profiles_dir);
+	ck_assert_int_eq(unlink(path), 0);
+
+	ck_assert_uint_eq(profile_index_refresh(index, profiles_dir), 3);
+	ck_assert_uint_eq(index->parsed, 2);
+	ck_assert(index->dirty);
+	ck_assert_ptr_null(profile_index_find(index, "broken"));
+	ck_assert_int_eq(profile_index_find(index, "mail")->tab_count, 2);
+	ck_assert_int_eq(profile_index_find(index, "music")->tab_count, 1);
+	ck_assert_str_eq(index->profiles[1].name, "mail");
+	ck_assert_str_eq(index->profiles[2].name, "music");
+
+	profile_index_destroy(index);
+}
+END_TEST
+
+START_TEST(test_hash_ignores_formatting)
+{
+	struct cg_profile_index *index = profile_index_load(index_path);
+	profile_index_refresh(index, profiles_dir);
+	uint64_t hash = profile_index_find(index, "dev")->hash;
+
+	/* Same profile, written differently */
+	write_profile("dev", "# Development\n[[tabs]]\ncommand   = 'foot'\n[[tabs]]\ncommand = \"firefox\"\n");
+	profile_index_refresh(index, profiles_dir);
+	ck_assert_uint_eq(index->parsed, 1);
+	ck_assert_uint_eq(profile_index_find(index, "dev")->hash, hash);
+
+	write_profile("dev", "[[tabs]]\ncommand = \"foot\"\nbackground = true\n\n[[tabs]]\ncommand = \"firefox\"\n");
+	profile_index_refresh(index, profiles_dir);
+	ck_assert_uint_ne(profile_index_find(index, "dev")->hash, hash);
+
+	profile_index_destroy(index);
+}
+END_TEST
+
+START_TEST(test_launches_persist)
+{
+	struct cg_profile_index *index = profile_index_load(index_path);
+	profile_index_refresh(index, profiles_dir);
+	ck_assert(profile_index_record_launch(index, "dev", 1000));
+	ck_assert(profile_index_record_launch(index, "dev", 2000));
+	ck_assert(!profile_index_record_launch(index, "missing", 2000));
+	ck_assert(index->dirty);
+	ck_assert_int_eq(profile_index_save(index, index_path), 0);
+	profile_index_destroy(index);
+
+	index = profile_index_load(index_path);
+	profile_index_refresh(index, profiles_dir);
+	struct cg_profile_info *dev = profile_index_find(index, "dev");
+	ck_assert_uint_eq(dev->launch_count, 2);
+	ck_assert_int_eq(dev->last_used, 2000);
+	ck_assert_uint_eq(profile_index_find(index, "mail")->launch_count, 0);
+	profile_index_destroy(index);
+}
+END_TEST
+
+START_TEST(test_score)
+{
+	int64_t now = 100 * DAY;
+	struct cg_profile_info never = {.name = "never"};
+	struct cg_profile_info today = {.name = "today", .launch_count = 3, .last_used = now - 60};
+	struct cg_profile_info old = {.name = "old", .launch_count = 30, .last_used = now - 60 * DAY};
+	struct cg_profile_info week = {.name = "week", .launch_count = 3, .last_used = now - 3 * DAY};
+
+	ck_assert_uint_eq(profile_index_score(&never, now), 0);
+	ck_assert_uint_gt(profile_index_score(&today, now), profile_index_score(&week, now));
+	ck_assert_uint_gt(profile_index_score(&old, now), profile_index_score(&today, now));
+	ck_assert_uint_gt(profile_index_score(&week, now), profile_index_score(&never, now));
+}
+END_TEST
+
+START_TEST(test_corrupt_index)
+{
+	char dir[256];
+	snprintf(dir, sizeof(dir), "%s/state", tmp_dir);
+	ck_assert_int_eq(mkdir(dir, 0700), 0);
+	snprintf(dir, sizeof(dir), "%s/state/waymux", tmp_dir);
+	ck_assert_int_eq(mkdir(dir, 0700), 0);
+
+	FILE *f = fopen(index_path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs("WMXPROF 1\ndev\tnot enough fields\n", f);
+	fclose(f);
+
+	struct cg_profile_index *index = profile_index_load(index_path);
+	ck_assert_ptr_nonnull(index);
+	ck_assert_uint_eq(index->count, 0);
+	ck_assert_uint_eq(profile_index_refresh(index, profiles_dir), 3);
+	ck_assert_uint_eq(index->parsed, 3);
+	profile_index_destroy(index);
+}
+END_TEST
+
+static Suite *
+profile_index_suite(void)
+{
+	Suite *s = suite_create("profile_index");
+
+	TCase *tc_core = tcase_create("core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_refresh_reads_metadata);
+	tcase_add_test(tc_core, test_refresh_is_incremental);
+	tcase_add_test(tc_core, test_hash_ignores_formatting);
+	tcase_add_test(tc_core, test_launches_persist);
+	tcase_add_test(tc_core, test_score);
+	tcase_add_test(tc_core, test_corrupt_index);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = profile_index_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,435 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "profile.h"
+#include "profile_launch.h"
+#include "server.h"
+#include "spawn_helper.h"
+#include "tab.h"
+
+#define TEST_TABS 3
+
+static struct cg_server server;
+static struct profile profile;
+static struct profile_tab tabs[TEST_TABS];
+static char *sleep_args[] = {"30", NULL};
+static pid_t pids[TEST_TABS];
+
+static void
+setup(void)
+{
+	memset(&server, 0, sizeof(server));
+	server.wl_display = wl_display_create();
+	wl_list_init(&server.tabs);
+	wl_list_init(&server.profile_launches);
+	wl_list_init(&server.profile_lazy_tabs);
+	wl_signal_init(&server.events.tab_unmap);
+	wl_signal_init(&server.events.tab_activate);
+	wl_signal_init(&server.events.tab_background);
+
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < TEST_TABS; i++) {
+		tabs[i].command = "sleep";
+		tabs[i].args = sleep_args;
+		tabs[i].argc = 1;
+	}
+	profile = (struct profile){.name = "test", .tabs = tabs, .tab_count = TEST_TABS};
+}
+
+static void
+teardown(void)
+{
+	for (int i = 0; i < TEST_TABS; i++) {
+		if (pids[i] > 0) {
+			kill(pids[i], SIGKILL);
+			waitpid(pids[i], NULL, 0);
+		}
+		pids[i] = 0;
+	}
+	profile_launch_destroy_all(&server);
+
+	struct cg_tab *tab, *tmp;
+	wl_list_for_each_safe(tab, tmp, &server.tabs, link) {
+		wl_list_remove(&tab->link);
+		free(tab->title);
+		free(tab);
+	}
+	wl_display_destroy(server.wl_display);
+}
+
+/* Remember the process of each tab still pending */
+static void
+launch_pids(struct cg_profile_launch *launch)
+{
+	struct cg_profile_launch_tab *pending;
+	wl_list_for_each(pending, &launch->pending, link) {
+		pids[pending->position] = pending->pid;
+	}
+}
+
+/* Start the profile and remember the process of each tab */
+static void
+start(void)
+{
+	ck_assert(profile_launch_start(&server, &profile));
+	ck_assert_int_eq(wl_list_length(&server.profile_launches), 1);
+
+	struct cg_profile_launch *launch = wl_container_of(server.profile_launches.next, launch, link);
+	ck_assert_int_eq(launch->tab_count, TEST_TABS);
+
+	launch_pids(launch);
+}
+
+/* A tab mapping at the end of the tab list, as tab_create() leaves it */
+static struct cg_tab *
+map_tab(void)
+{
+	struct cg_tab *tab = calloc(1, sizeof(*tab));
+	ck_assert_ptr_nonnull(tab);
+	tab->server = &server;
+	wl_list_insert(server.tabs.prev, &tab->link);
+	return tab;
+}
+
+static int
+position_at(int index)
+{
+	int i = 0;
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server.tabs, link) {
+		if (i++ == index) {
+			return tab->profile_position;
+		}
+	}
+	return -1;
+}
+
+/* Test: children carry distinct tokens and are matched through them */
+START_TEST(test_launch_claim_token)
+{
+	start();
+
+	bool background, activate;
+	struct cg_tab *tab = map_tab();
+	ck_assert(profile_launch_claim(tab, pids[1], &background, &activate));
+	ck_assert_int_eq(tab->profile_position, 1);
+	ck_assert_uint_ne(tab->profile_launch, 0);
+
+	/* A process that wasn't launched isn't claimed */
+	struct cg_tab *other = map_tab();
+	ck_assert(!profile_launch_claim(other, getpid(), &background, &activate));
+	ck_assert_uint_eq(other->profile_launch, 0);
+}
+END_TEST
+
+/* Test: tabs mapping in reverse end up in declared order */
+START_TEST(test_launch_order)
+{
+	tabs[0].background = true;
+	start();
+
+	/* A tab of someone else's, mapped in between */
+	map_tab();
+
+	bool background, activate;
+	for (int i = TEST_TABS - 1; i >= 0; i--) {
+		struct cg_tab *tab = map_tab();
+		ck_assert(profile_launch_claim(tab, pids[i], &background, &activate));
+		tab->is_background = background;
+		ck_assert_int_eq(background, i == 0);
+	}
+
+	ck_assert_int_eq(position_at(0), 0);
+	ck_assert_int_eq(position_at(1), 0);
+	ck_assert_int_eq(position_at(2), 1);
+	ck_assert_int_eq(position_at(3), 2);
+
+	/* Claiming the last tab completes the launch */
+	ck_assert(wl_list_empty(&server.profile_launches));
+}
+END_TEST
+
+/* Test: the first declared foreground tab is activated, whatever the map order */
+START_TEST(test_launch_activation)
+{
+	tabs[0].background = true;
+	start();
+
+	bool background, activate;
+	struct cg_tab *tab = map_tab();
+	ck_assert(profile_launch_claim(tab, pids[2], &background, &activate));
+	ck_assert(activate);
+
+	tab = map_tab();
+	ck_assert(profile_launch_claim(tab, pids[1], &background, &activate));
+	ck_assert(activate);
+
+	tab = map_tab();
+	ck_assert(profile_launch_claim(tab, pids[0], &background, &activate));
+	ck_assert(background);
+	ck_assert(!activate);
+}
+END_TEST
+
+/* The placeholder of a lazy tab, which has no view */
+static struct cg_tab *
+placeholder_at(int position)
+{
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server.tabs, link) {
+		if (!tab->view && tab->profile_position == position) {
+			return tab;
+		}
+	}
+	return NULL;
+}
+
+static pid_t
+lazy_pid(struct cg_tab *tab)
+{
+	struct cg_profile_lazy_tab *lazy;
+	wl_list_for_each(lazy, &server.profile_lazy_tabs, link) {
+		if (lazy->tab == tab) {
+			return lazy->pid;
+		}
+	}
+	return -1;
+}
+
+/* Test: lazy tabs are placeholders until brought to the foreground */
+START_TEST(test_launch_lazy)
+{
+	tabs[1].lazy = true;
+	tabs[1].background = true;
+	tabs[1].title = "Lazy";
+	ck_assert(profile_launch_start(&server, &profile));
+
+	struct cg_profile_launch *launch = wl_container_of(server.profile_launches.next, launch, link);
+	ck_assert_int_eq(launch->tab_count, TEST_TABS - 1);
+
+	struct cg_tab *placeholder = placeholder_at(1);
+	ck_assert_ptr_nonnull(placeholder);
+	ck_assert(placeholder->is_background);
+	ck_assert_str_eq(placeholder->title, "Lazy");
+	ck_assert_int_eq(lazy_pid(placeholder), 0);
+
+	/* Nothing is started until it's shown */
+	tab_set_background(placeholder, false);
+	pids[1] = lazy_pid(placeholder);
+	ck_assert_int_gt(pids[1], 0);
+
+	/* Activating it as well doesn't start it again */
+	tab_activate(placeholder);
+	ck_assert_int_eq(lazy_pid(placeholder), pids[1]);
+
+	/* Its view takes the placeholder over; other clients don't */
+	ck_assert_ptr_null(profile_launch_claim_placeholder(&server, getpid()));
+	ck_assert_ptr_eq(profile_launch_claim_placeholder(&server, pids[1]), placeholder);
+	ck_assert_ptr_null(placeholder->title);
+	ck_assert(wl_list_empty(&server.profile_lazy_tabs));
+
+	/* Tabs mapping later still go before it or after it */
+	launch_pids(launch);
+	bool background, activate;
+	struct cg_tab *tab = map_tab();
+	ck_assert(profile_launch_claim(tab, pids[0], &background, &activate));
+	ck_assert_ptr_eq(tab->link.next, &placeholder->link);
+}
+END_TEST
+
+/* Test: foreground lazy tabs are placeholders in the tab bar, started
+ * when activated, and don't keep the profile's other tabs from being */
+START_TEST(test_launch_lazy_foreground)
+{
+	tabs[0].lazy = true;
+	tabs[0].working_dir = "/tmp";
+	ck_assert(profile_launch_start(&server, &profile));
+
+	struct cg_tab *placeholder = placeholder_at(0);
+	ck_assert_ptr_nonnull(placeholder);
+	ck_assert(!placeholder->is_background);
+	struct cg_profile_lazy_tab *lazy = wl_container_of(server.profile_lazy_tabs.next, lazy, link);
+	ck_assert_str_eq(lazy->working_dir, "/tmp");
+	ck_assert_int_eq(lazy_pid(placeholder), 0);
+
+	struct cg_profile_launch *launch = wl_container_of(server.profile_launches.next, launch, link);
+	launch_pids(launch);
+	bool background, activate;
+	struct cg_tab *tab = map_tab();
+	ck_assert(profile_launch_claim(tab, pids[1], &background, &activate));
+	ck_assert(!background);
+	ck_assert(activate);
+
+	tab_activate(placeholder);
+	pids[0] = lazy_pid(placeholder);
+	ck_assert_int_gt(pids[0], 0);
+}
+END_TEST
+
+/* Test: closing a placeholder forgets its lazy tab */
+START_TEST(test_launch_lazy_closed)
+{
+	for (int i = 0; i < TEST_TABS; i++) {
+		tabs[i].lazy = true;
+		tabs[i].background = true;
+	}
+	ck_assert(profile_launch_start(&server, &profile));
+	ck_assert(wl_list_empty(&server.profile_launches));
+	ck_assert_int_eq(wl_list_length(&server.profile_lazy_tabs), TEST_TABS);
+
+	tab_destroy(placeholder_at(0));
+	ck_assert_int_eq(wl_list_length(&server.profile_lazy_tabs), TEST_TABS - 1);
+}
+END_TEST
+
+/* What a tab_unmap listener added after the placeholders saw, as the
+ * control server's is on the first subscribe */
+static char unmapped_title[64];
+
+static void
+handle_subscriber_unmap(struct wl_listener *listener, void *data)
+{
+	struct cg_tab *tab = data;
+	snprintf(unmapped_title, sizeof(unmapped_title), "%s", tab->title ? tab->title : "(null)");
+}
+
+/* Test: a placeholder's title outlives its lazy tab until it is unmapped */
+START_TEST(test_launch_lazy_closed_subscribed)
+{
+	for (int i = 0; i < TEST_TABS; i++) {
+		tabs[i].lazy = true;
+		tabs[i].background = true;
+	}
+	tabs[0].title = "Lazy";
+	ck_assert(profile_launch_start(&server, &profile));
+
+	struct wl_listener subscriber = {.notify = handle_subscriber_unmap};
+	wl_signal_add(&server.events.tab_unmap, &subscriber);
+	unmapped_title[0] = '\0';
+
+	tab_destroy(placeholder_at(0));
+	ck_assert_str_eq(unmapped_title, "Lazy");
+	ck_assert_int_eq(wl_list_length(&server.profile_lazy_tabs), TEST_TABS - 1);
+	wl_list_remove(&subscriber.link);
+}
+END_TEST
+
+/* Test: tabs whose process fails before mapping aren't waited for, while
+ * those that exit successfully may still map through a child */
+START_TEST(test_launch_exit_report)
+{
+	struct cg_spawn_helper helper = {0};
+	wl_signal_init(&helper.events.exit);
+	server.spawn_helper = &helper;
+	profile_launch_watch_exits(&server);
+
+	tabs[2].lazy = true;
+	tabs[2].background = true;
+	ck_assert(profile_launch_start(&server, &profile));
+	struct cg_profile_launch *launch = wl_container_of(server.profile_launches.next, launch, link);
+	ck_assert_int_eq(launch->tab_count, TEST_TABS - 1);
+	launch_pids(launch);
+	struct cg_profile_launch_tab *pending;
+	uint64_t token = 0;
+	wl_list_for_each(pending, &launch->pending, link) {
+		pending->spawn_token = ++token;
+	}
+
+	/* The first tab's proxy exited successfully */
+	struct cg_spawn_exit report = {.token = 1, .status = 0};
+	wl_signal_emit_mutable(&helper.events.exit, &report);
+	ck_assert_int_eq(wl_list_length(&launch->pending), 2);
+
+	/* The second tab's command failed */
+	report = (struct cg_spawn_exit){.token = 2, .status = 127 << 8};
+	wl_signal_emit_mutable(&helper.events.exit, &report);
+	ck_assert_int_eq(wl_list_length(&launch->pending), 1);
+
+	/* Reports for other processes are ignored */
+	report = (struct cg_spawn_exit){.token = 0, .status = 1 << 8};
+	wl_signal_emit_mutable(&helper.events.exit, &report);
+	ck_assert_int_eq(wl_list_length(&launch->pending), 1);
+
+	/* A lazy tab that failed starts again when next shown */
+	struct cg_tab *placeholder = placeholder_at(2);
+	tab_activate(placeholder);
+	pids[2] = lazy_pid(placeholder);
+	ck_assert_int_gt(pids[2], 0);
+	struct cg_profile_lazy_tab *lazy = wl_container_of(server.profile_lazy_tabs.next, lazy, link);
+	lazy->spawn_token = 10;
+	report = (struct cg_spawn_exit){.token = 10, .status = SIGSEGV};
+	wl_signal_emit_mutable(&helper.events.exit, &report);
+	ck_assert_int_eq(lazy_pid(placeholder), 0);
+	tab_activate(placeholder);
+	ck_assert_int_gt(lazy_pid(placeholder), 0);
+	kill(pids[2], SIGKILL);
+	waitpid(pids[2], NULL, 0);
+	pids[2] = lazy_pid(placeholder);
+
+	/* The listener goes before the helper does */
+	profile_launch_destroy_all(&server);
+	ck_assert(wl_list_empty(&helper.events.exit.listener_list));
+	server.spawn_helper = NULL;
+}
+END_TEST
+
+/* Test: tabs whose command can't be started aren't waited for */
+START_TEST(test_launch_failed_spawn)
+{
+	tabs[1].command = "/nonexistent/waymux-test-command";
+	ck_assert(profile_launch_start(&server, &profile));
+
+	struct cg_profile_launch *launch = wl_container_of(server.profile_launches.next, launch, link);
+	ck_assert_int_eq(launch->tab_count, TEST_TABS - 1);
+	launch_pids(launch);
+}
+END_TEST
+
+Suite *
+profile_launch_suite(void)
+{
+	Suite *s = suite_create("profile_launch");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_launch_claim_token);
+	tcase_add_test(tc_core, test_launch_order);
+	tcase_add_test(tc_core, test_launch_activation);
+	tcase_add_test(tc_core, test_launch_failed_spawn);
+	tcase_add_test(tc_core, test_launch_exit_report);
+	tcase_add_test(tc_core, test_launch_lazy);
+	tcase_add_test(tc_core, test_launch_lazy_foreground);
+	tcase_add_test(tc_core, test_launch_lazy_closed);
+	tcase_add_test(tc_core, test_launch_lazy_closed_subscribed);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = profile_launch_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,59 @@
+/*
+ * Stubs for profile launch testing
+ *
+ * These stubs allow profile launches to be tested without the full
+ * WayMux server implementation.
+ */
+
+#include <stdlib.h>
+
+#include "server.h"
+#include "tab.h"
+
+/* Tab stubs */
+struct cg_tab *
+tab_create(struct cg_server *server, struct cg_view *view)
+{
+	struct cg_tab *tab = calloc(1, sizeof(*tab));
+	if (!tab) {
+		return NULL;
+	}
+	tab->server = server;
+	tab->view = view;
+	tab->id = ++server->last_tab_id;
+	wl_list_insert(server->tabs.prev, &tab->link);
+	return tab;
+}
+
+void
+tab_destroy(struct cg_tab *tab)
+{
+	wl_signal_emit_mutable(&tab->server->events.tab_unmap, tab);
+	wl_list_remove(&tab->link);
+	free(tab->title);
+	free(tab);
+}
+
+void
+tab_activate(struct cg_tab *tab)
+{
+	tab->server->active_tab = tab;
+	wl_signal_emit_mutable(&tab->server->events.tab_activate, tab);
+}
+
+void
+tab_set_background(struct cg_tab *tab, bool background)
+{
+	if (tab->is_background == background) {
+		return;
+	}
+	tab->is_background = background;
+	wl_signal_emit_mutable(&tab->server->events.tab_background, tab);
+}
+
+void
+tab_move_before(struct cg_tab *tab, struct cg_tab *before)
+{
+	wl_list_remove(&tab->link);
+	wl_list_insert(before ? before->link.prev : tab->server->tabs.prev, &tab->link);
+}
@@ -45,6 +45,11 @@ setup(void)
 
 	fprintf(f, "working_dir = \"/home/user/projects\"\n");
 	fprintf(f, "proxy_command = [\"uv\", \"run\"]\n");
+	fprintf(f, "xwayland = \"disabled\"\n");
+	fprintf(f, "\n");
+	fprintf(f, "[limits]\n");
+	fprintf(f, "memory = \"2G\"\n");
+	fprintf(f, "cpu = 150\n");
 	fprintf(f, "\n");
 	fprintf(f, "[env]\n");
 	fprintf(f, "EDITOR = \"nvim\"\n");
@@ -101,6 +106,11 @@ setup_background(void)
 	fprintf(f, "command = \"firefox\"\n");
 	fprintf(f, "title = \"Another Foreground Tab\"\n");
 	fprintf(f, "background = false\n");
+	fprintf(f, "\n");
+	fprintf(f, "[[tabs]]\n");
+	fprintf(f, "command = \"htop\"\n");
+	fprintf(f, "title = \"Lazy Tab\"\n");
+	fprintf(f, "lazy = true\n");
 
 	fclose(f);
 }
@@ -134,6 +144,10 @@ START_TEST(test_profile_load_valid)
 
 	ck_assert_str_eq(profile->name, test_profile_name);
 	ck_assert_str_eq(profile->working_dir, "/home/user/projects");
+	ck_assert(profile->has_xwayland_mode);
+	ck_assert_int_eq(profile->xwayland_mode, WAYMUX_XWAYLAND_DISABLED);
+	ck_assert_uint_eq(profile->limits.memory_max, 2ULL * 1024 * 1024 * 1024);
+	ck_assert_int_eq(profile->limits.cpu_max, 150);
 	ck_assert_int_eq(profile->proxy_argc, 2);
 	ck_assert_str_eq(profile->proxy_command[0], "uv");
 	ck_assert_str_eq(profile->proxy_command[1], "run");
@@ -191,7 +205,10 @@ START_TEST(test_profile_background_tabs)
 	struct profile *profile = profile_load(test_profile_name);
 	ck_assert_ptr_nonnull(profile);
 
-	ck_assert_int_eq(profile->tab_count, 3);
+	ck_assert_int_eq(profile->tab_count, 4);
+	ck_assert(!profile->has_xwayland_mode);
+	ck_assert_uint_eq(profile->limits.memory_max, 0);
+	ck_assert_int_eq(profile->limits.cpu_max, 0);
 
 	/* First tab - no background field (defaults to false) */
 	ck_assert_str_eq(profile->tabs[0].command, "kitty");
@@ -207,6 +224,12 @@ START_TEST(test_profile_background_tabs)
 	ck_assert_str_eq(profile->tabs[2].command, "firefox");
 	ck_assert_str_eq(profile->tabs[2].title, "Another Foreground Tab");
 	ck_assert_int_eq(profile->tabs[2].background, false);
+	ck_assert_int_eq(profile->tabs[2].lazy, false);
+
+	/* Fourth tab - lazy = true, which implies background */
+	ck_assert_str_eq(profile->tabs[3].command, "htop");
+	ck_assert_int_eq(profile->tabs[3].lazy, true);
+	ck_assert_int_eq(profile->tabs[3].background, true);
 
 	profile_free(profile);
 }
@@ -0,0 +1,228 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "registry.h"
+#include "server.h"
+
+static char runtime_dir[] = "/tmp/waymux_registry_test_XXXXXX";
+
+static void
+setup(void)
+{
+	ck_assert_ptr_nonnull(mkdtemp(runtime_dir));
+	setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+}
+
+static void
+teardown(void)
+{
+	char command[PATH_MAX];
+	snprintf(command, sizeof(command), "rm -rf '%s'", runtime_dir);
+	ck_assert_int_eq(system(command), 0);
+	strcpy(runtime_dir + strlen(runtime_dir) - 6, "XXXXXX");
+}
+
+/* Run fn in a child process, as another instance would, and return its
+ * exit status. Children start before this process takes any lock, so they
+ * don't inherit its lock file descriptors. */
+static int
+in_child(int (*fn)(void))
+{
+	pid_t pid = fork();
+	ck_assert_int_ne(pid, -1);
+	if (pid == 0) {
+		_exit(fn());
+	}
+
+	int status;
+	ck_assert_int_eq(waitpid(pid, &status, 0), pid);
+	ck_assert(WIFEXITED(status));
+	return WEXITSTATUS(status);
+}
+
+/* Run fn in a child process that keeps running, holding whatever fn
+ * locked, until release_child() */
+static pid_t
+hold_in_child(int (*fn)(void), int *release_fd)
+{
+	int ready[2], release[2];
+	ck_assert_int_eq(pipe(ready), 0);
+	ck_assert_int_eq(pipe(release), 0);
+
+	pid_t pid = fork();
+	ck_assert_int_ne(pid, -1);
+	if (pid == 0) {
+		close(ready[0]);
+		close(release[1]);
+		char status = fn();
+		if (write(ready[1], &status, 1) != 1) {
+			_exit(1);
+		}
+		/* Wait for the parent to close its end */
+		while (read(release[0], &status, 1) > 0) {
+		}
+		_exit(0);
+	}
+
+	close(ready[1]);
+	close(release[0]);
+	char status = 1;
+	ck_assert_int_eq(read(ready[0], &status, 1), 1);
+	close(ready[0]);
+	ck_assert_int_eq(status, 0);
+
+	*release_fd = release[1];
+	return pid;
+}
+
+static void
+release_child(pid_t pid, int release_fd)
+{
+	close(release_fd);
+	int status;
+	ck_assert_int_eq(waitpid(pid, &status, 0), pid);
+}
+
+static int
+child_lock_profile(void)
+{
+	return registry_lock_profile("dev") ? 0 : 1;
+}
+
+static int
+child_register_default(void)
+{
+	struct cg_server server = {.instance_name = "default", .profile_name = "dev"};
+	return registry_register_instance(&server) ? 0 : 1;
+}
+
+/* Locks the profile and exits without unregistering, as if it crashed */
+static int
+child_crash_with_profile(void)
+{
+	struct cg_server server = {.instance_name = "crashed", .profile_name = "dev"};
+	if (!registry_lock_profile("dev") || !registry_register_instance(&server)) {
+		return 1;
+	}
+	return 0;
+}
+
+/* Read the index into buf */
+static void
+read_index(char *buf, size_t size)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/waymux/registry/index", runtime_dir);
+	FILE *f = fopen(path, "r");
+	ck_assert_ptr_nonnull(f);
+	size_t len = fread(buf, 1, size - 1, f);
+	buf[len] = '\0';
+	fclose(f);
+}
+
+START_TEST(test_profile_lock)
+{
+	int release_fd;
+	pid_t pid = hold_in_child(child_lock_profile, &release_fd);
+
+	/* The profile is taken, but others and no profile at all aren't */
+	ck_assert(!registry_lock_profile("dev"));
+	ck_assert(registry_lock_profile("work"));
+	ck_assert(registry_lock_profile(NULL));
+
+	/* Until the other instance exits */
+	release_child(pid, release_fd);
+	ck_assert(registry_lock_profile("dev"));
+}
+END_TEST
+
+START_TEST(test_crashed_instance_releases_locks)
+{
+	ck_assert_int_eq(in_child(child_crash_with_profile), 0);
+
+	/* The crashed instance's line is still in the index */
+	char index[256];
+	read_index(index, sizeof(index));
+	ck_assert_ptr_nonnull(strstr(index, "crashed\t"));
+
+	/* But its locks were released, and the next update drops it */
+	ck_assert(registry_lock_profile("dev"));
+	struct cg_server server = {.instance_name = "default", .profile_name = "dev"};
+	ck_assert(registry_register_instance(&server));
+
+	read_index(index, sizeof(index));
+	char line[64];
+	snprintf(line, sizeof(line), "default\t%d\tdev\n", (int)getpid());
+	ck_assert_str_eq(index, line);
+
+	ck_assert(registry_unregister_instance(&server));
+	read_index(index, sizeof(index));
+	ck_assert_str_eq(index, "");
+}
+END_TEST
+
+START_TEST(test_instance_name_is_unique)
+{
+	int release_fd;
+	pid_t pid = hold_in_child(child_register_default, &release_fd);
+
+	struct cg_server server = {.instance_name = "default"};
+	ck_assert(!registry_register_instance(&server));
+
+	release_child(pid, release_fd);
+	ck_assert(registry_register_instance(&server));
+	ck_assert(registry_unregister_instance(&server));
+}
+END_TEST
+
+START_TEST(test_invalid_instance_name)
+{
+	struct cg_server server = {.instance_name = "../default"};
+	ck_assert(!registry_register_instance(&server));
+}
+END_TEST
+
+static Suite *
+registry_suite(void)
+{
+	Suite *s = suite_create("registry");
+
+	TCase *tc_locks = tcase_create("locks");
+	tcase_add_checked_fixture(tc_locks, setup, teardown);
+	tcase_add_test(tc_locks, test_profile_lock);
+	tcase_add_test(tc_locks, test_crashed_instance_releases_locks);
+	tcase_add_test(tc_locks, test_instance_name_is_unique);
+	tcase_add_test(tc_locks, test_invalid_instance_name);
+	suite_add_tcase(s, tc_locks);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = registry_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,196 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "resources.h"
+
+static char tmp_dir[] = "/tmp/waymux_resources_test_XXXXXX";
+
+static void
+setup(void)
+{
+	ck_assert_ptr_nonnull(mkdtemp(tmp_dir));
+}
+
+static void
+teardown(void)
+{
+	char command[PATH_MAX];
+	snprintf(command, sizeof(command), "rm -rf '%s'", tmp_dir);
+	ck_assert_int_eq(system(command), 0);
+	strcpy(tmp_dir + strlen(tmp_dir) - 6, "XXXXXX");
+}
+
+static void
+write_file(const char *name, const char *contents)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", tmp_dir, name);
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+START_TEST(test_read_cgroup)
+{
+	uint64_t memory = 1, cpu_usec = 0;
+	ck_assert(!resources_read_cgroup(tmp_dir, &memory, &cpu_usec));
+
+	/* Without the memory controller, there is no memory.current */
+	write_file("cpu.stat", "usage_usec 1500\nuser_usec 1000\nsystem_usec 500\n");
+	ck_assert(resources_read_cgroup(tmp_dir, &memory, &cpu_usec));
+	ck_assert_uint_eq(cpu_usec, 1500);
+	ck_assert_uint_eq(memory, 1);
+
+	write_file("memory.current", "4096\n");
+	ck_assert(resources_read_cgroup(tmp_dir, &memory, &cpu_usec));
+	ck_assert_uint_eq(memory, 4096);
+}
+END_TEST
+
+START_TEST(test_read_process)
+{
+	uint64_t memory = 0, cpu_usec = 0, start_ns = 0;
+	ck_assert(resources_read_process(getpid(), &memory, &cpu_usec, &start_ns));
+	ck_assert_uint_gt(memory, 0);
+	ck_assert_uint_gt(start_ns, 0);
+
+	ck_assert(!resources_read_process(INT_MAX, &memory, &cpu_usec, &start_ns));
+}
+END_TEST
+
+START_TEST(test_sample)
+{
+	/* Not delegated: only the process itself is accounted */
+	struct cg_resources resources = {0};
+	struct cg_tab_usage usage = {0};
+	resources_sample(&resources, getpid(), &usage);
+	ck_assert_int_eq(usage.pid, getpid());
+	ck_assert(!usage.own_cgroup);
+	ck_assert_uint_gt(usage.memory, 0);
+	ck_assert(usage.cpu >= 0);
+
+	/* Too soon for a new CPU sample */
+	uint64_t sampled_ns = usage.sampled_ns;
+	resources_sample(&resources, getpid(), &usage);
+	ck_assert_uint_eq(usage.sampled_ns, sampled_ns);
+
+	resources_sample(&resources, 0, &usage);
+	ck_assert_int_eq(usage.pid, 0);
+	ck_assert_uint_eq(usage.memory, 0);
+}
+END_TEST
+
+START_TEST(test_format_memory)
+{
+	char text[32];
+	resources_format_memory(512 * 1024, text, sizeof(text));
+	ck_assert_str_eq(text, "512 KB");
+	resources_format_memory(300ULL * 1024 * 1024, text, sizeof(text));
+	ck_assert_str_eq(text, "300 MB");
+	resources_format_memory(3ULL * 1024 * 1024 * 1024 / 2, text, sizeof(text));
+	ck_assert_str_eq(text, "1.5 GB");
+}
+END_TEST
+
+static void
+spawn_true(struct cg_resources *resources)
+{
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+	char *argv[] = {"true", NULL};
+	pid_t pid = resources_spawn(resources, NULL, argv, &env, NULL, NULL);
+	spawn_env_finish(&env);
+	ck_assert_int_gt(pid, 0);
+
+	int status;
+	ck_assert_int_eq(waitpid(pid, &status, 0), pid);
+	ck_assert(WIFEXITED(status));
+	ck_assert_int_eq(WEXITSTATUS(status), 0);
+}
+
+START_TEST(test_spawn_not_delegated)
+{
+	struct cg_resources resources = {0};
+	spawn_true(&resources);
+	spawn_true(NULL);
+}
+END_TEST
+
+START_TEST(test_spawn_cgroup_dirs)
+{
+	/* A plain directory stands in for the delegated cgroup: the client
+	 * can't actually be moved into it, but still starts */
+	struct cg_resources *resources = calloc(1, sizeof(*resources));
+	ck_assert_ptr_nonnull(resources);
+	resources->root = strdup(tmp_dir);
+	ck_assert_ptr_nonnull(resources->root);
+
+	spawn_true(resources);
+	char path[PATH_MAX];
+	struct stat st;
+	snprintf(path, sizeof(path), "%s/app-1", tmp_dir);
+	ck_assert_int_eq(stat(path, &st), 0);
+
+	/* Empty cgroups are removed on the next spawn and when done */
+	spawn_true(resources);
+	ck_assert_int_ne(stat(path, &st), 0);
+	snprintf(path, sizeof(path), "%s/app-2", tmp_dir);
+	ck_assert_int_eq(stat(path, &st), 0);
+
+	resources_destroy(resources);
+	ck_assert_int_ne(stat(path, &st), 0);
+}
+END_TEST
+
+static Suite *
+resources_suite(void)
+{
+	Suite *s = suite_create("resources");
+
+	TCase *tc_usage = tcase_create("usage");
+	tcase_add_checked_fixture(tc_usage, setup, teardown);
+	tcase_add_test(tc_usage, test_read_cgroup);
+	tcase_add_test(tc_usage, test_read_process);
+	tcase_add_test(tc_usage, test_sample);
+	tcase_add_test(tc_usage, test_format_memory);
+	suite_add_tcase(s, tc_usage);
+
+	TCase *tc_spawn = tcase_create("spawn");
+	tcase_add_checked_fixture(tc_spawn, setup, teardown);
+	tcase_add_test(tc_spawn, test_spawn_not_delegated);
+	tcase_add_test(tc_spawn, test_spawn_cgroup_dirs);
+	suite_add_tcase(s, tc_spawn);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = resources_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,122 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "result_view.h"
+
+/* Test: a short list never scrolls */
+START_TEST(test_result_view_short)
+{
+	struct cg_result_view view;
+	result_view_reset(&view, 3, 8);
+
+	ck_assert_uint_eq(result_view_visible(&view), 3);
+	ck_assert(!result_view_move(&view, 1, true));
+	ck_assert(!result_view_move(&view, 1, true));
+	ck_assert_uint_eq(view.selected, 2);
+
+	/* Wraps to the top */
+	ck_assert(!result_view_move(&view, 1, true));
+	ck_assert_uint_eq(view.selected, 0);
+	ck_assert_uint_eq(view.first, 0);
+}
+END_TEST
+
+/* Test: moving past the window scrolls by one row */
+START_TEST(test_result_view_scroll)
+{
+	struct cg_result_view view;
+	result_view_reset(&view, 2000, 8);
+	ck_assert_uint_eq(result_view_visible(&view), 8);
+
+	for (int i = 0; i < 7; i++) {
+		ck_assert(!result_view_move(&view, 1, true));
+	}
+	ck_assert(result_view_move(&view, 1, true));
+	ck_assert_uint_eq(view.selected, 8);
+	ck_assert_uint_eq(view.first, 1);
+
+	/* Wrapping up from the top jumps to the last page */
+	result_view_reset(&view, 2000, 8);
+	ck_assert(result_view_move(&view, -1, true));
+	ck_assert_uint_eq(view.selected, 1999);
+	ck_assert_uint_eq(view.first, 1992);
+	ck_assert_uint_eq(result_view_visible(&view), 8);
+}
+END_TEST
+
+/* Test: paging clamps at the ends */
+START_TEST(test_result_view_page)
+{
+	struct cg_result_view view;
+	result_view_reset(&view, 20, 8);
+
+	ck_assert(result_view_move(&view, 8, false));
+	ck_assert_uint_eq(view.selected, 8);
+	ck_assert_uint_eq(view.first, 1);
+
+	result_view_move(&view, 100, false);
+	ck_assert_uint_eq(view.selected, 19);
+	ck_assert_uint_eq(view.first, 12);
+
+	result_view_move(&view, -100, false);
+	ck_assert_uint_eq(view.selected, 0);
+	ck_assert_uint_eq(view.first, 0);
+}
+END_TEST
+
+/* Test: shrinking the list keeps the selection in range */
+START_TEST(test_result_view_set_total)
+{
+	struct cg_result_view view;
+	result_view_reset(&view, 20, 8);
+	result_view_move(&view, 15, false);
+
+	ck_assert(result_view_set_total(&view, 10));
+	ck_assert_uint_eq(view.selected, 9);
+	ck_assert_uint_eq(view.first, 2);
+
+	result_view_set_total(&view, 0);
+	ck_assert_uint_eq(view.selected, 0);
+	ck_assert_uint_eq(result_view_visible(&view), 0);
+	ck_assert(!result_view_move(&view, 1, true));
+}
+END_TEST
+
+Suite *
+result_view_suite(void)
+{
+	Suite *s = suite_create("result_view");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_result_view_short);
+	tcase_add_test(tc_core, test_result_view_scroll);
+	tcase_add_test(tc_core, test_result_view_page);
+	tcase_add_test(tc_core, test_result_view_set_total);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = result_view_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,419 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+/*
+ * Scaling tests: the tab bar, control server, launcher search and profile
+ * index at sizes well past what they were first written for, with time
+ * and memory budgets. They use the same stubs as the benchmarks.
+ *
+ * The budgets are generous, to hold on a loaded CI machine with a debug
+ * build; they catch an operation going from linear to quadratic, not a
+ * few percent. Set WAYMUX_SCALING_SLACK to a factor to multiply the time
+ * budgets by, e.g. under valgrind.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <check.h>
+#include <ftw.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_scene.h>
+
+#include "control.h"
+#include "desktop_entry.h"
+#include "profile_index.h"
+#include "server.h"
+#include "tab.h"
+#include "tab_bar.h"
+#include "view.h"
+#include "waymux_config.h"
+
+#define TAB_COUNT 500
+#define ENTRY_COUNT 10000
+#define PROFILE_COUNT 1000
+
+/* Rows the launcher fetches per keystroke */
+#define LAUNCHER_ROWS 8
+
+#define MIB (1024 * 1024)
+
+static struct cg_server server;
+static struct cg_tab tabs[TAB_COUNT];
+static struct cg_view views[TAB_COUNT];
+static char titles[TAB_COUNT][48];
+static char *dir;
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Resident memory of the test process */
+static size_t
+resident_bytes(void)
+{
+	FILE *f = fopen("/proc/self/statm", "r");
+	ck_assert_ptr_nonnull(f);
+	unsigned long size, resident;
+	ck_assert_int_eq(fscanf(f, "%lu %lu", &size, &resident), 2);
+	fclose(f);
+	return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/* Fail if the mean of count operations took longer than budget_us each */
+static void
+assert_time_budget(const char *what, uint64_t elapsed_ns, int count, double budget_us)
+{
+	const char *slack = getenv("WAYMUX_SCALING_SLACK");
+	if (slack && atof(slack) > 0) {
+		budget_us *= atof(slack);
+	}
+	double mean_us = elapsed_ns / 1000.0 / count;
+	printf("%s: %.1f us (budget %.0f us)\n", what, mean_us, budget_us);
+	ck_assert_msg(mean_us <= budget_us, "%s took %.1f us, over its budget of %.0f us", what, mean_us,
+		      budget_us);
+}
+
+static void
+assert_memory_budget(const char *what, size_t before, size_t budget)
+{
+	size_t after = resident_bytes();
+	size_t used = after > before ? after - before : 0;
+	printf("%s: %zu KiB (budget %zu KiB)\n", what, used / 1024, budget / 1024);
+	ck_assert_msg(used <= budget, "%s used %zu KiB, over its budget of %zu KiB", what, used / 1024,
+		      budget / 1024);
+}
+
+static void
+write_file(const char *path, const char *contents)
+{
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	ck_assert_int_ge(fputs(contents, f), 0);
+	ck_assert_int_eq(fclose(f), 0);
+}
+
+static int
+remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+	return remove(path);
+}
+
+static void
+setup(void)
+{
+	memset(&server, 0, sizeof(server));
+	wl_list_init(&server.views);
+	wl_list_init(&server.outputs);
+	wl_list_init(&server.tabs);
+	wl_signal_init(&server.events.tab_map);
+	wl_signal_init(&server.events.tab_unmap);
+	wl_signal_init(&server.events.tab_activate);
+	wl_signal_init(&server.events.tab_title);
+	wl_signal_init(&server.events.tab_background);
+	wl_signal_init(&server.events.tab_move);
+	server.wl_display = wl_display_create();
+
+	for (int i = 0; i < TAB_COUNT; i++) {
+		memset(&tabs[i], 0, sizeof(tabs[i]));
+		memset(&views[i], 0, sizeof(views[i]));
+		snprintf(titles[i], sizeof(titles[i]), "~/src/project%d: vim", i);
+		views[i].title = titles[i];
+		views[i].app_id = "foot";
+		views[i].tab = &tabs[i];
+		tabs[i].id = i + 1;
+		tabs[i].view = &views[i];
+		tabs[i].server = &server;
+		wl_list_insert(server.tabs.prev, &tabs[i].link);
+	}
+	server.active_tab = &tabs[0];
+
+	char template[] = "/tmp/waymux-scaling-XXXXXX";
+	ck_assert_ptr_nonnull(mkdtemp(template));
+	dir = strdup(template);
+}
+
+static void
+teardown(void)
+{
+	wl_list_init(&server.tabs);
+	wl_display_destroy(server.wl_display);
+	nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	free(dir);
+}
+
+/* Test: switching between tabs far apart in a bar of 500 */
+START_TEST(test_tab_switch)
+{
+	static struct waymux_config config;
+	server.config = &config;
+	server.output_layout = wlr_output_layout_create(server.wl_display);
+	server.scene = wlr_scene_create();
+
+	size_t before = resident_bytes();
+	struct cg_tab_bar *tab_bar = tab_bar_create(&server, NULL);
+	ck_assert_ptr_nonnull(tab_bar);
+	tab_bar->width = 1920;
+	tab_bar_update(tab_bar);
+	ck_assert_int_eq(tab_bar->tab_count, TAB_COUNT);
+
+	const int switches = 200;
+	uint64_t start = now_ns();
+	for (int i = 0; i < switches; i++) {
+		struct cg_tab *old_tab = server.active_tab;
+		struct cg_tab *new_tab = old_tab == &tabs[0] ? &tabs[TAB_COUNT - 1] : &tabs[0];
+		server.active_tab = new_tab;
+		tab_bar_active_changed(tab_bar, old_tab, new_tab);
+		tab_bar_flush(tab_bar);
+	}
+	assert_time_budget("tab switch/500", now_ns() - start, switches, 2000);
+	assert_memory_budget("tab bar/500", before, 64 * MIB);
+
+	tab_bar_destroy(tab_bar);
+	wlr_scene_node_destroy(&server.scene->tree.node);
+	wlr_output_layout_destroy(server.output_layout);
+	server.config = NULL;
+}
+END_TEST
+
+/* Send a command on a control session and read its whole response, which
+ * ends with an empty line */
+static size_t
+round_trip(int fd, const char *command, char *response, size_t size)
+{
+	struct wl_event_loop *loop = wl_display_get_event_loop(server.wl_display);
+	ck_assert_int_eq(send(fd, command, strlen(command), 0), (ssize_t)strlen(command));
+
+	size_t got = 0;
+	while (got < 2 || response[got - 1] != '\n' || response[got - 2] != '\n') {
+		wl_event_loop_dispatch(loop, 100);
+		ssize_t n = recv(fd, response + got, size - 1 - got, MSG_DONTWAIT);
+		if (n > 0) {
+			got += n;
+		}
+		ck_assert_uint_lt(got, size - 1);
+	}
+	response[got] = '\0';
+	return got;
+}
+
+static int
+count_occurrences(const char *haystack, const char *needle)
+{
+	int count = 0;
+	for (const char *p = strstr(haystack, needle); p; p = strstr(p + 1, needle)) {
+		count++;
+	}
+	return count;
+}
+
+/* Test: listing 500 tabs over the control socket, in full */
+START_TEST(test_list_tabs)
+{
+	struct cg_control_server *control = control_server_create(&server);
+	ck_assert_ptr_nonnull(control);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	strncpy(addr.sun_path, control->socket_path, sizeof(addr.sun_path) - 1);
+	ck_assert_int_eq(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+
+	static char response[256 * 1024];
+	round_trip(fd, "session\n", response, sizeof(response));
+
+	/* Every tab is listed, however long the response */
+	round_trip(fd, "list-tabs\n", response, sizeof(response));
+	ck_assert_int_eq(count_occurrences(response, " id:"), TAB_COUNT);
+	ck_assert_ptr_nonnull(strstr(response, "id:500 "));
+	round_trip(fd, "--json list-tabs\n", response, sizeof(response));
+	ck_assert_int_eq(count_occurrences(response, "\"id\":"), TAB_COUNT);
+
+	const int runs = 50;
+	uint64_t start = now_ns();
+	for (int i = 0; i < runs; i++) {
+		round_trip(fd, "list-tabs\n", response, sizeof(response));
+	}
+	assert_time_budget("list-tabs/500", now_ns() - start, runs, 20000);
+
+	start = now_ns();
+	for (int i = 0; i < runs; i++) {
+		round_trip(fd, "--json list-tabs\n", response, sizeof(response));
+	}
+	assert_time_budget("list-tabs --json/500", now_ns() - start, runs, 30000);
+
+	close(fd);
+	control_server_destroy(control);
+}
+END_TEST
+
+static const char *const name_words[] = {
+	"Audio", "Browser", "Calculator", "Disk", "Editor", "Files", "Game", "Mail", "Monitor",
+	"Music", "Notes", "Office", "Paint", "Photo", "Player", "Reader", "Settings", "Terminal",
+	"Text", "Video", "Viewer", "Web",
+};
+#define NAME_WORD_COUNT (sizeof(name_words) / sizeof(name_words[0]))
+
+static void
+write_desktop_entry(const char *apps_dir, int i)
+{
+	const char *first = name_words[i % NAME_WORD_COUNT];
+	const char *second = name_words[(i / NAME_WORD_COUNT) % NAME_WORD_COUNT];
+
+	char path[512], contents[512];
+	snprintf(path, sizeof(path), "%s/app%05d.desktop", apps_dir, i);
+	snprintf(contents, sizeof(contents),
+		 "[Desktop Entry]\n"
+		 "Type=Application\n"
+		 "Name=%s %s %d\n"
+		 "GenericName=%s\n"
+		 "Keywords=%s;%s;scaling;\n"
+		 "Exec=/usr/bin/app%05d %%U\n"
+		 "Icon=app%05d\n",
+		 first, second, i, second, first, second, i, i);
+	write_file(path, contents);
+}
+
+/* Test: loading 10k desktop entries, and searching them as the launcher
+ * does, a keystroke at a time */
+START_TEST(test_launcher_search)
+{
+	char apps_dir[512];
+	snprintf(apps_dir, sizeof(apps_dir), "%s/applications", dir);
+	ck_assert_int_eq(mkdir(apps_dir, 0755), 0);
+	for (int i = 0; i < ENTRY_COUNT; i++) {
+		write_desktop_entry(apps_dir, i);
+	}
+
+	size_t before = resident_bytes();
+	uint64_t start = now_ns();
+	struct cg_desktop_entry_manager *manager = desktop_entry_manager_create();
+	const char *dirs[] = {apps_dir, NULL};
+	ck_assert_int_eq(desktop_entry_manager_load_dirs(manager, dirs, NULL), ENTRY_COUNT);
+	desktop_entry_manager_build_index(manager);
+	assert_time_budget("desktop entries load/10000", now_ns() - start, 1, 2000000);
+	assert_memory_budget("desktop entries/10000", before, 32 * MIB);
+
+	const char *query = "terminal";
+	size_t len = strlen(query);
+	struct cg_desktop_entry *rows[LAUNCHER_ROWS];
+	char prefix[16];
+	const int runs = 20;
+	start = now_ns();
+	for (int run = 0; run < runs; run++) {
+		for (size_t i = 0; i <= len; i++) {
+			memcpy(prefix, query, i);
+			prefix[i] = '\0';
+			size_t matches = desktop_entry_manager_query(manager, prefix);
+			ck_assert_uint_gt(matches, 0);
+			desktop_entry_manager_get_results(manager, 0, rows, LAUNCHER_ROWS);
+		}
+	}
+	assert_time_budget("launcher keystroke/10000", now_ns() - start, runs * (int)(len + 1), 10000);
+	ck_assert_ptr_nonnull(strstr(rows[0]->name, "Terminal"));
+
+	desktop_entry_manager_destroy(manager);
+}
+END_TEST
+
+/* Test: opening the profile selector over 1k profiles, first with none
+ * parsed yet, then with none changed */
+START_TEST(test_selector_open)
+{
+	char profiles_dir[512], path[600];
+	snprintf(profiles_dir, sizeof(profiles_dir), "%s/profiles.d", dir);
+	ck_assert_int_eq(mkdir(profiles_dir, 0755), 0);
+	for (int i = 0; i < PROFILE_COUNT; i++) {
+		snprintf(path, sizeof(path), "%s/profile-%04d.toml", profiles_dir, i);
+		write_file(path, "working_dir = \"~/src\"\n"
+				 "\n"
+				 "[[tabs]]\n"
+				 "command = \"foot\"\n"
+				 "args = [\"-e\", \"htop\"]\n"
+				 "\n"
+				 "[[tabs]]\n"
+				 "command = \"firefox\"\n");
+	}
+
+	size_t before = resident_bytes();
+	struct cg_profile_index *index = profile_index_load(NULL);
+	ck_assert_ptr_nonnull(index);
+	uint64_t start = now_ns();
+	profile_index_refresh(index, profiles_dir);
+	assert_time_budget("selector first open/1000", now_ns() - start, 1, 1000000);
+	ck_assert_uint_eq(index->count, PROFILE_COUNT);
+	ck_assert_uint_eq(index->parsed, PROFILE_COUNT);
+	assert_memory_budget("profile index/1000", before, 8 * MIB);
+
+	/* Some have been launched, so that ranking has scores to compare */
+	for (int i = 0; i < PROFILE_COUNT; i += 10) {
+		char name[32];
+		snprintf(name, sizeof(name), "profile-%04d", i);
+		ck_assert(profile_index_record_launch(index, name, time(NULL)));
+	}
+
+	/* What the selector does on every open: pick up changes, and rank */
+	const int runs = 50;
+	uint64_t score = 0;
+	start = now_ns();
+	for (int run = 0; run < runs; run++) {
+		profile_index_refresh(index, profiles_dir);
+		for (size_t i = 0; i < index->count; i++) {
+			score += profile_index_score(&index->profiles[i], time(NULL));
+		}
+	}
+	assert_time_budget("selector open/1000", now_ns() - start, runs, 20000);
+	ck_assert_uint_eq(index->parsed, 0);
+	ck_assert_uint_gt(score, 0);
+
+	profile_index_destroy(index);
+}
+END_TEST
+
+Suite *
+scaling_suite(void)
+{
+	Suite *s = suite_create("scaling");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_set_timeout(tc_core, 120);
+	tcase_add_test(tc_core, test_tab_switch);
+	tcase_add_test(tc_core, test_list_tabs);
+	tcase_add_test(tc_core, test_launcher_search);
+	tcase_add_test(tc_core, test_selector_open);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = scaling_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
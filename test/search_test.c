@@ -0,0 +1,75 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "search.h"
+
+START_TEST(test_lowercase)
+{
+	char *lower = search_lowercase("Firefox — Mozilla");
+	ck_assert_str_eq(lower, "firefox — mozilla");
+	free(lower);
+}
+END_TEST
+
+START_TEST(test_mask)
+{
+	ck_assert_uint_eq(search_mask(""), 0);
+	ck_assert_uint_eq(search_mask(NULL), 0);
+
+	uint64_t text = search_mask("foot ~/src");
+	ck_assert_uint_eq(text & search_mask("src"), search_mask("src"));
+	ck_assert_uint_ne(text & search_mask("vim"), search_mask("vim"));
+}
+END_TEST
+
+/* Test: in-order subsequences match, prefixes and word starts score higher */
+START_TEST(test_score)
+{
+	ck_assert_int_lt(search_score("firefox", "fox!"), 0);
+	ck_assert_int_lt(search_score("firefox", "xof"), 0);
+	ck_assert_int_ge(search_score("firefox", "ffx"), 0);
+	ck_assert_int_ge(search_score("firefox", ""), 0);
+
+	ck_assert_int_gt(search_score("vim main.c", "vim"), search_score("nvim main.c", "vim"));
+	ck_assert_int_gt(search_score("foot;make test", "make"), search_score("foot;remake", "make"));
+	ck_assert_int_gt(search_score("thunderbird", "thun"), search_score("thunderbird", "tndb"));
+}
+END_TEST
+
+static Suite *
+search_suite(void)
+{
+	Suite *s = suite_create("search");
+
+	TCase *tc_core = tcase_create("core");
+	tcase_add_test(tc_core, test_lowercase);
+	tcase_add_test(tc_core, test_mask);
+	tcase_add_test(tc_core, test_score);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = search_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,310 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "profile.h"
+#include "profile_launch.h"
+#include "server.h"
+#include "session.h"
+#include "spawner.h"
+#include "tab.h"
+#include "view.h"
+
+struct test_view {
+	struct cg_view view;
+	pid_t pid;
+};
+
+static char tmp_dir[] = "/tmp/waymux_session_test_XXXXXX";
+static pid_t child;
+
+static pid_t
+test_get_pid(struct cg_view *view)
+{
+	return ((struct test_view *)view)->pid;
+}
+
+static const struct cg_view_impl test_view_impl = {
+	.get_pid = test_get_pid,
+};
+
+static void
+setup(void)
+{
+	ck_assert_ptr_nonnull(mkdtemp(tmp_dir));
+
+	/* A client to save, running in the temporary directory */
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+	char *argv[] = {"sleep", "30", NULL};
+	child = spawn_command(argv, &env, tmp_dir);
+	spawn_env_finish(&env);
+	ck_assert_int_gt(child, 0);
+
+	/* The new command line only shows once exec() is done */
+	for (int i = 0; i < 100; i++) {
+		struct cg_session_tab tab = {0};
+		if (session_read_process(child, &tab) && strcmp(tab.argv[0], "sleep") == 0) {
+			session_tab_finish(&tab);
+			break;
+		}
+		session_tab_finish(&tab);
+		nanosleep(&(struct timespec){.tv_nsec = 10000000}, NULL);
+	}
+}
+
+static void
+teardown(void)
+{
+	kill(child, SIGKILL);
+	waitpid(child, NULL, 0);
+
+	char command[PATH_MAX];
+	snprintf(command, sizeof(command), "rm -rf '%s'", tmp_dir);
+	ck_assert_int_eq(system(command), 0);
+	strcpy(tmp_dir + strlen(tmp_dir) - 6, "XXXXXX");
+}
+
+START_TEST(test_read_process)
+{
+	struct cg_session_tab tab = {0};
+	ck_assert(session_read_process(child, &tab));
+	ck_assert_str_eq(tab.argv[0], "sleep");
+	ck_assert_str_eq(tab.argv[1], "30");
+	ck_assert_ptr_null(tab.argv[2]);
+
+	struct stat expected, actual;
+	ck_assert_int_eq(stat(tmp_dir, &expected), 0);
+	ck_assert_int_eq(stat(tab.working_dir, &actual), 0);
+	ck_assert_int_eq(expected.st_ino, actual.st_ino);
+	session_tab_finish(&tab);
+
+	ck_assert(!session_read_process(INT_MAX, &tab));
+}
+END_TEST
+
+/* Test: what is written loads back as the same tabs */
+START_TEST(test_write_load)
+{
+	char *argv0[] = {"foot", "-e", "say \"hi\"\t\\", NULL};
+	char *argv1[] = {"thunderbird", NULL};
+	char *argv2[] = {"htop", NULL};
+	struct cg_session_tab tabs[] = {
+		{.argv = argv0, .working_dir = "/home/user/src", .title = "vim \"x\""},
+		{.argv = argv1, .title = "Mail", .background = true, .lazy = true},
+		{.argv = argv2, .lazy = true},
+	};
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/session.toml", tmp_dir);
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	ck_assert(session_write(f, tabs, 3));
+	fclose(f);
+
+	struct profile *profile = profile_load_file(path, "session");
+	ck_assert_ptr_nonnull(profile);
+	ck_assert_int_eq(profile->tab_count, 3);
+
+	ck_assert_str_eq(profile->tabs[0].command, "foot");
+	ck_assert_int_eq(profile->tabs[0].argc, 2);
+	ck_assert_str_eq(profile->tabs[0].args[1], "say \"hi\"\t\\");
+	ck_assert_str_eq(profile->tabs[0].working_dir, "/home/user/src");
+	ck_assert_str_eq(profile->tabs[0].title, "vim \"x\"");
+	ck_assert(!profile->tabs[0].background);
+	ck_assert(!profile->tabs[0].lazy);
+
+	ck_assert_str_eq(profile->tabs[1].command, "thunderbird");
+	ck_assert_int_eq(profile->tabs[1].argc, 0);
+	ck_assert_ptr_null(profile->tabs[1].working_dir);
+	ck_assert(profile->tabs[1].background);
+	ck_assert(profile->tabs[1].lazy);
+
+	/* A foreground tab stays one, as a placeholder in the tab bar */
+	ck_assert(!profile->tabs[2].background);
+	ck_assert(profile->tabs[2].lazy);
+	profile_free(profile);
+}
+END_TEST
+
+/* Test: a server's tabs are saved in order, each client once */
+START_TEST(test_save)
+{
+	struct cg_server server = {0};
+	wl_list_init(&server.tabs);
+	wl_list_init(&server.profile_lazy_tabs);
+
+	struct test_view views[3] = {
+		{.view = {.impl = &test_view_impl, .title = "Sleeping"}, .pid = child},
+		{.view = {.impl = &test_view_impl}, .pid = child},
+		{.view = {.impl = &test_view_impl}, .pid = 0},
+	};
+	struct cg_tab tabs[4] = {0};
+	for (int i = 0; i < 4; i++) {
+		tabs[i].server = &server;
+		tabs[i].view = i < 3 ? &views[i].view : NULL;
+		wl_list_insert(server.tabs.prev, &tabs[i].link);
+	}
+
+	/* A placeholder, whose lazy tab wasn't started */
+	char *lazy_argv[] = {"thunderbird", NULL};
+	struct cg_profile_lazy_tab lazy = {.tab = &tabs[3], .argv = lazy_argv};
+	wl_list_insert(&server.profile_lazy_tabs, &lazy.link);
+	tabs[3].title = "Mail";
+	tabs[3].is_background = true;
+	server.active_tab = &tabs[1];
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/profiles.d/saved.toml", tmp_dir);
+	ck_assert_int_eq(session_save(&server, path), 2);
+
+	struct profile *profile = profile_load_file(path, "saved");
+	ck_assert_ptr_nonnull(profile);
+	ck_assert_int_eq(profile->tab_count, 2);
+	ck_assert_str_eq(profile->tabs[0].command, "sleep");
+	ck_assert_str_eq(profile->tabs[0].title, "Sleeping");
+	ck_assert_ptr_nonnull(profile->tabs[0].working_dir);
+
+	/* The active tab's client was saved for another tab, which starts
+	 * with the session instead */
+	ck_assert(!profile->tabs[0].lazy);
+	ck_assert_str_eq(profile->tabs[1].command, "thunderbird");
+	ck_assert_str_eq(profile->tabs[1].title, "Mail");
+	ck_assert(profile->tabs[1].background);
+	ck_assert(profile->tabs[1].lazy);
+	profile_free(profile);
+}
+END_TEST
+
+/* Test: invalid UTF-8 costs only the tab it is in, and the saved session
+ * still loads */
+START_TEST(test_save_invalid_utf8)
+{
+	/* A client whose command line has an argument that isn't UTF-8 */
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+	char *argv[] = {"sh", "-c", "sleep 30; :", "caf\xe9", NULL};
+	pid_t invalid = spawn_command(argv, &env, tmp_dir);
+	spawn_env_finish(&env);
+	ck_assert_int_gt(invalid, 0);
+	for (int i = 0; i < 100; i++) {
+		struct cg_session_tab tab = {0};
+		bool ready = session_read_process(invalid, &tab) && strcmp(tab.argv[0], "sh") == 0;
+		session_tab_finish(&tab);
+		if (ready) {
+			break;
+		}
+		nanosleep(&(struct timespec){.tv_nsec = 10000000}, NULL);
+	}
+
+	struct cg_server server = {0};
+	wl_list_init(&server.tabs);
+	wl_list_init(&server.profile_lazy_tabs);
+	struct test_view views[2] = {
+		{.view = {.impl = &test_view_impl, .title = "Bad"}, .pid = invalid},
+		{.view = {.impl = &test_view_impl, .title = "Sleeping \xff"}, .pid = child},
+	};
+	struct cg_tab tabs[2] = {0};
+	for (int i = 0; i < 2; i++) {
+		tabs[i].server = &server;
+		tabs[i].view = &views[i].view;
+		wl_list_insert(server.tabs.prev, &tabs[i].link);
+	}
+	server.active_tab = &tabs[1];
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/invalid.toml", tmp_dir);
+	ck_assert_int_eq(session_save(&server, path), 1);
+	kill(invalid, SIGKILL);
+	waitpid(invalid, NULL, 0);
+
+	/* Titles are only shown, so they keep a replacement character */
+	struct profile *profile = profile_load_file(path, "invalid");
+	ck_assert_ptr_nonnull(profile);
+	ck_assert_int_eq(profile->tab_count, 1);
+	ck_assert_str_eq(profile->tabs[0].command, "sleep");
+	ck_assert_str_eq(profile->tabs[0].title, "Sleeping \xef\xbf\xbd");
+	profile_free(profile);
+
+	/* Written directly, every invalid sequence is replaced, while valid
+	 * ones of each length are kept */
+	char *written_argv[] = {"echo", "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", "\xc0\xaf\xed\xa0\x80\xe2\x82", NULL};
+	struct cg_session_tab written = {.argv = written_argv};
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	ck_assert(session_write(f, &written, 1));
+	fclose(f);
+
+	profile = profile_load_file(path, "invalid");
+	ck_assert_ptr_nonnull(profile);
+	ck_assert_int_eq(profile->tab_count, 1);
+	ck_assert_str_eq(profile->tabs[0].args[0], "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+	ck_assert_ptr_null(strstr(profile->tabs[0].args[1], "\xc0"));
+	ck_assert_ptr_nonnull(strstr(profile->tabs[0].args[1], "\xef\xbf\xbd"));
+	profile_free(profile);
+}
+END_TEST
+
+START_TEST(test_session_path)
+{
+	setenv("XDG_CONFIG_HOME", "/config", 1);
+
+	char *path = session_path(NULL);
+	ck_assert_str_eq(path, "/config/waymux/profiles.d/session.toml");
+	free(path);
+	path = session_path("work");
+	ck_assert_str_eq(path, "/config/waymux/profiles.d/work.toml");
+	free(path);
+	path = session_path("/tmp/work.toml");
+	ck_assert_str_eq(path, "/tmp/work.toml");
+	free(path);
+}
+END_TEST
+
+static Suite *
+session_suite(void)
+{
+	Suite *s = suite_create("session");
+
+	TCase *tc_core = tcase_create("core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_read_process);
+	tcase_add_test(tc_core, test_write_load);
+	tcase_add_test(tc_core, test_save);
+	tcase_add_test(tc_core, test_save_invalid_utf8);
+	tcase_add_test(tc_core, test_session_path);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = session_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
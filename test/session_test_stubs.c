@@ -0,0 +1,21 @@
+/*
+ * Stubs for session testing
+ *
+ * These stubs allow sessions to be saved without the full WayMux server
+ * implementation.
+ */
+
+#include "view.h"
+
+/* View stubs */
+pid_t
+view_get_pid(struct cg_view *view)
+{
+	return view->impl->get_pid ? view->impl->get_pid(view) : 0;
+}
+
+const char *
+view_get_title(struct cg_view *view)
+{
+	return view->title;
+}
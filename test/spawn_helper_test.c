@@ -0,0 +1,188 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spawn_helper.h"
+
+static struct wl_event_loop *loop;
+static struct cg_spawn_helper *helper;
+
+/* Exit reports seen so far */
+static struct cg_spawn_exit exits[8];
+static int exit_count;
+static struct wl_listener exit_listener;
+
+static void
+handle_exit(struct wl_listener *listener, void *data)
+{
+	if (exit_count < 8) {
+		exits[exit_count++] = *(struct cg_spawn_exit *)data;
+	}
+}
+
+static void
+setup(void)
+{
+	exit_count = 0;
+	helper = spawn_helper_create();
+	ck_assert_ptr_nonnull(helper);
+	loop = wl_event_loop_create();
+	ck_assert(spawn_helper_attach(helper, loop));
+	exit_listener.notify = handle_exit;
+	wl_signal_add(&helper->events.exit, &exit_listener);
+}
+
+static void
+teardown(void)
+{
+	wl_list_remove(&exit_listener.link);
+	spawn_helper_destroy(helper);
+	wl_event_loop_destroy(loop);
+}
+
+/* Dispatch the event loop until count clients exited, or give up */
+static void
+wait_for_exits(int count)
+{
+	for (int i = 0; i < 100 && exit_count < count; i++) {
+		wl_event_loop_dispatch(loop, 50);
+	}
+	ck_assert_int_eq(exit_count, count);
+}
+
+static pid_t
+spawn(char *const argv[], const char *cwd, uint64_t *token)
+{
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+	pid_t pid = spawn_helper_spawn(helper, argv, &env, cwd, NULL, token);
+	spawn_env_finish(&env);
+	return pid;
+}
+
+/* Test: clients are the helper's, and their exits are reported */
+START_TEST(test_spawn_exit)
+{
+	uint64_t token_a, token_b;
+	pid_t a = spawn((char *[]){"sh", "-c", "exit 3", NULL}, NULL, &token_a);
+	pid_t b = spawn((char *[]){"true", NULL}, NULL, &token_b);
+	ck_assert_int_gt(a, 0);
+	ck_assert_int_gt(b, 0);
+	ck_assert_uint_ne(token_a, 0);
+	ck_assert_uint_ne(token_a, token_b);
+
+	/* Not the compositor's children */
+	ck_assert_int_eq(waitpid(a, NULL, WNOHANG), -1);
+
+	wait_for_exits(2);
+	for (int i = 0; i < 2; i++) {
+		if (exits[i].pid == a) {
+			ck_assert_uint_eq(exits[i].token, token_a);
+			ck_assert(WIFEXITED(exits[i].status));
+			ck_assert_int_eq(WEXITSTATUS(exits[i].status), 3);
+		} else {
+			ck_assert_int_eq(exits[i].pid, b);
+			ck_assert_uint_eq(exits[i].token, token_b);
+			ck_assert_int_eq(WEXITSTATUS(exits[i].status), 0);
+		}
+	}
+}
+END_TEST
+
+/* Test: the environment and working directory are passed on */
+START_TEST(test_spawn_env_cwd)
+{
+	char dir[] = "/tmp/waymux-spawn-helper-XXXXXX";
+	ck_assert_ptr_nonnull(mkdtemp(dir));
+
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+	ck_assert(spawn_env_set(&env, "WAYMUX_TEST_VALUE", "it works"));
+	char *argv[] = {"sh", "-c", "echo \"$WAYMUX_TEST_VALUE\" > out", NULL};
+	ck_assert_int_gt(spawn_helper_spawn(helper, argv, &env, dir, NULL, NULL), 0);
+	spawn_env_finish(&env);
+	wait_for_exits(1);
+
+	char path[128], line[64] = {0};
+	snprintf(path, sizeof(path), "%s/out", dir);
+	FILE *f = fopen(path, "r");
+	ck_assert_ptr_nonnull(f);
+	ck_assert_ptr_nonnull(fgets(line, sizeof(line), f));
+	fclose(f);
+	ck_assert_str_eq(line, "it works\n");
+
+	unlink(path);
+	rmdir(dir);
+}
+END_TEST
+
+/* Test: commands that can't be started fail, and the helper carries on */
+START_TEST(test_spawn_missing)
+{
+	ck_assert_int_eq(spawn((char *[]){"/nonexistent/waymux-test", NULL}, NULL, NULL), -1);
+	ck_assert_int_gt(helper->request_fd, 0);
+	ck_assert_int_gt(spawn((char *[]){"true", NULL}, NULL, NULL), 0);
+	wait_for_exits(1);
+}
+END_TEST
+
+/* Test: without the helper, commands are started directly */
+START_TEST(test_spawn_helper_gone)
+{
+	kill(helper->pid, SIGKILL);
+	for (int i = 0; i < 100 && helper->request_fd >= 0; i++) {
+		wl_event_loop_dispatch(loop, 50);
+	}
+	ck_assert_int_eq(helper->request_fd, -1);
+
+	pid_t pid = spawn((char *[]){"true", NULL}, NULL, NULL);
+	ck_assert_int_gt(pid, 0);
+	int status;
+	ck_assert_int_eq(waitpid(pid, &status, 0), pid);
+	ck_assert_int_eq(WEXITSTATUS(status), 0);
+}
+END_TEST
+
+Suite *
+spawn_helper_suite(void)
+{
+	Suite *s = suite_create("spawn_helper");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_spawn_exit);
+	tcase_add_test(tc_core, test_spawn_env_cwd);
+	tcase_add_test(tc_core, test_spawn_missing);
+	tcase_add_test(tc_core, test_spawn_helper_gone);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = spawn_helper_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
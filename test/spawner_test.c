@@ -0,0 +1,193 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spawner.h"
+
+static char tmp_dir[64];
+
+static void
+setup(void)
+{
+	snprintf(tmp_dir, sizeof(tmp_dir), "/tmp/waymux-spawner-test-XXXXXX");
+	ck_assert_ptr_nonnull(mkdtemp(tmp_dir));
+}
+
+static void
+teardown(void)
+{
+	char cmd[128];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", tmp_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Wait for a child and return its exit status */
+static int
+wait_exit(pid_t pid)
+{
+	int status;
+	ck_assert_int_eq(waitpid(pid, &status, 0), pid);
+	ck_assert(WIFEXITED(status));
+	return WEXITSTATUS(status);
+}
+
+static void
+read_file(const char *name, char *dest, size_t size)
+{
+	char path[128];
+	snprintf(path, sizeof(path), "%s/%s", tmp_dir, name);
+	FILE *f = fopen(path, "r");
+	ck_assert_ptr_nonnull(f);
+	size_t n = fread(dest, 1, size - 1, f);
+	dest[n] = '\0';
+	fclose(f);
+}
+
+/* Test: variables are set, replaced and removed */
+START_TEST(test_spawn_env)
+{
+	setenv("WAYMUX_SPAWNER_TEST", "parent", 1);
+
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+	ck_assert_str_eq(spawn_env_get(&env, "WAYMUX_SPAWNER_TEST"), "parent");
+	size_t count = env.count;
+
+	ck_assert(spawn_env_set(&env, "WAYMUX_SPAWNER_TEST", "child"));
+	ck_assert_str_eq(spawn_env_get(&env, "WAYMUX_SPAWNER_TEST"), "child");
+	ck_assert_uint_eq(env.count, count);
+
+	/* A prefix of another variable's name is a different variable */
+	ck_assert_ptr_null(spawn_env_get(&env, "WAYMUX_SPAWNER"));
+	ck_assert(spawn_env_set(&env, "WAYMUX_SPAWNER", "1"));
+	ck_assert_uint_eq(env.count, count + 1);
+
+	spawn_env_unset(&env, "WAYMUX_SPAWNER_TEST");
+	ck_assert_ptr_null(spawn_env_get(&env, "WAYMUX_SPAWNER_TEST"));
+	ck_assert_str_eq(spawn_env_get(&env, "WAYMUX_SPAWNER"), "1");
+	ck_assert_ptr_null(env.vars[env.count]);
+
+	/* The compositor's own environment is untouched */
+	ck_assert_str_eq(getenv("WAYMUX_SPAWNER_TEST"), "parent");
+
+	spawn_env_finish(&env);
+	unsetenv("WAYMUX_SPAWNER_TEST");
+}
+END_TEST
+
+/* Test: a command runs with the given environment and directory */
+START_TEST(test_spawn_command)
+{
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+	ck_assert(spawn_env_set(&env, "GREETING", "hello"));
+
+	char *argv[] = {"sh", "-c", "echo \"$GREETING\" > out; pwd >> out", NULL};
+	pid_t pid = spawn_command(argv, &env, tmp_dir);
+	ck_assert_int_gt(pid, 0);
+	ck_assert_int_eq(wait_exit(pid), 0);
+
+	char expected[128], contents[128];
+	snprintf(expected, sizeof(expected), "hello\n%s\n", tmp_dir);
+	read_file("out", contents, sizeof(contents));
+	ck_assert_str_eq(contents, expected);
+
+	spawn_env_finish(&env);
+}
+END_TEST
+
+/* Test: a missing program is reported, not left to the child */
+START_TEST(test_spawn_missing)
+{
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+
+	char *argv[] = {"waymux-no-such-program", NULL};
+	pid_t pid = spawn_command(argv, &env, NULL);
+	if (pid > 0) {
+		/* Only libcs that can't report exec errors get here */
+		ck_assert_int_ne(wait_exit(pid), 0);
+	}
+
+	spawn_env_finish(&env);
+}
+END_TEST
+
+/* Test: every command of a batch starts, in order */
+START_TEST(test_spawn_batch)
+{
+	struct cg_spawn_env env;
+	ck_assert(spawn_env_init(&env));
+
+	char *first[] = {"sh", "-c", "echo one > one", NULL};
+	char *missing[] = {"waymux-no-such-program", NULL};
+	char *second[] = {"sh", "-c", "echo two > two", NULL};
+	struct cg_spawn_request requests[] = {
+		{.argv = first},
+		{.argv = missing},
+		{.argv = second},
+	};
+
+	size_t started = spawn_batch(requests, 3, &env, tmp_dir);
+	ck_assert_uint_ge(started, 2);
+	for (size_t i = 0; i < 3; i++) {
+		if (requests[i].pid > 0) {
+			wait_exit(requests[i].pid);
+		}
+	}
+
+	char contents[16];
+	read_file("one", contents, sizeof(contents));
+	ck_assert_str_eq(contents, "one\n");
+	read_file("two", contents, sizeof(contents));
+	ck_assert_str_eq(contents, "two\n");
+
+	spawn_env_finish(&env);
+}
+END_TEST
+
+Suite *
+spawner_suite(void)
+{
+	Suite *s = suite_create("spawner");
+
+	TCase *tc_env = tcase_create("Environment");
+	tcase_add_test(tc_env, test_spawn_env);
+	suite_add_tcase(s, tc_env);
+
+	TCase *tc_spawn = tcase_create("Spawn");
+	tcase_add_checked_fixture(tc_spawn, setup, teardown);
+	tcase_add_test(tc_spawn, test_spawn_command);
+	tcase_add_test(tc_spawn, test_spawn_missing);
+	tcase_add_test(tc_spawn, test_spawn_batch);
+	suite_add_tcase(s, tc_spawn);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = spawner_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
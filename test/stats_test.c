@@ -0,0 +1,128 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+static void
+setup(void)
+{
+	stats_reset();
+}
+
+/* Test: timings keep the count, last, total and maximum */
+START_TEST(test_stats_record)
+{
+	uint64_t now = stats_now();
+	stats_record(STATS_FRAME, now - 3000000);
+	stats_record(STATS_FRAME, now - 1000000);
+
+	const struct stats_timing *timing = &stats_get()->timings[STATS_FRAME];
+	ck_assert_uint_eq(timing->count, 2);
+	ck_assert_uint_ge(timing->last_ns, 1000000);
+	ck_assert_uint_lt(timing->last_ns, timing->max_ns);
+	ck_assert_uint_ge(timing->max_ns, 3000000);
+	ck_assert_uint_ge(timing->total_ns, timing->max_ns + timing->last_ns);
+	ck_assert_uint_eq(stats_get()->timings[STATS_SCENE_COMMIT].count, 0);
+}
+END_TEST
+
+START_TEST(test_stats_counters)
+{
+	stats_count(STATS_TAB_BAR_BUTTONS, 2);
+	stats_count(STATS_TAB_BAR_BUTTONS, 1);
+	stats_control_command();
+	stats_control_command();
+
+	ck_assert_uint_eq(stats_get()->counters[STATS_TAB_BAR_BUTTONS], 3);
+	ck_assert_uint_eq(stats_get()->counters[STATS_CONTROL_COMMANDS], 2);
+}
+END_TEST
+
+/* Test: only the most recent first frames are kept, newest first */
+START_TEST(test_stats_first_frames)
+{
+	ck_assert_uint_eq(stats_line_count(), STATS_TIMER_COUNT + 4);
+
+	uint64_t now = stats_now();
+	for (uint32_t id = 1; id <= STATS_FIRST_FRAMES + 2; id++) {
+		stats_tab_first_frame(id, now);
+	}
+	ck_assert_uint_eq(stats_get()->first_frame_count, STATS_FIRST_FRAMES);
+	ck_assert_uint_eq(stats_line_count(), STATS_TIMER_COUNT + 4 + STATS_FIRST_FRAMES);
+
+	char line[128];
+	size_t first = stats_line_count() - STATS_FIRST_FRAMES;
+	stats_format_line(first, line, sizeof(line));
+	ck_assert_msg(strncmp(line, "first_frame: tab 10,", 20) == 0, "got '%s'", line);
+	stats_format_line(stats_line_count() - 1, line, sizeof(line));
+	ck_assert_msg(strncmp(line, "first_frame: tab 3,", 19) == 0, "got '%s'", line);
+}
+END_TEST
+
+START_TEST(test_stats_format)
+{
+	uint64_t now = stats_now();
+	stats_record(STATS_SCENE_COMMIT, now);
+
+	char line[128];
+	stats_format_line(STATS_SCENE_COMMIT, line, sizeof(line));
+	ck_assert_msg(strncmp(line, "scene_commit: 1 x, last ", 24) == 0, "got '%s'", line);
+	stats_format_line(STATS_TIMER_COUNT, line, sizeof(line));
+	ck_assert_str_eq(line, "tab_bar_buttons: 0 rendered");
+	stats_format_line(STATS_TIMER_COUNT + 1, line, sizeof(line));
+	ck_assert_msg(strncmp(line, "pixel_buffers: ", 15) == 0, "got '%s'", line);
+	stats_format_line(STATS_TIMER_COUNT + 2, line, sizeof(line));
+	ck_assert_str_eq(line, "control_commands: 0, 0.0/s");
+	stats_count(STATS_MEMORY_TRIMS, 2);
+	stats_count(STATS_MEMORY_RECLAIMED, 4096);
+	stats_format_line(STATS_TIMER_COUNT + 3, line, sizeof(line));
+	ck_assert_str_eq(line, "memory: 2 trims, 0 under pressure, 4096 bytes reclaimed");
+
+	/* Short buffers are truncated */
+	char small[8];
+	stats_format_line(STATS_FRAME, small, sizeof(small));
+	ck_assert_str_eq(small, "frame: ");
+	ck_assert_str_eq(stats_timer_name(STATS_LAUNCHER_RENDER), "launcher_render");
+}
+END_TEST
+
+Suite *
+stats_suite(void)
+{
+	Suite *s = suite_create("stats");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, setup, NULL);
+	tcase_add_test(tc_core, test_stats_record);
+	tcase_add_test(tc_core, test_stats_counters);
+	tcase_add_test(tc_core, test_stats_first_frames);
+	tcase_add_test(tc_core, test_stats_format);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = stats_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
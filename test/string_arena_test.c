@@ -0,0 +1,163 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "string_arena.h"
+
+/* Test: copies are independent of the originals, and NULL stays NULL */
+START_TEST(test_arena_strdup)
+{
+	struct cg_string_arena arena;
+	string_arena_init(&arena);
+
+	char original[] = "firefox";
+	const char *copy = string_arena_strdup(&arena, original);
+	original[0] = 'X';
+	ck_assert_str_eq(copy, "firefox");
+	ck_assert_ptr_null(string_arena_strdup(&arena, NULL));
+	ck_assert_str_eq(string_arena_strndup(&arena, "foot --server", 4), "foot");
+	ck_assert_uint_eq(arena.size, strlen("firefox") + 1 + strlen("foot") + 1);
+
+	string_arena_finish(&arena);
+}
+END_TEST
+
+/* Test: allocations larger than a chunk, and many small ones */
+START_TEST(test_arena_chunks)
+{
+	struct cg_string_arena arena;
+	string_arena_init(&arena);
+
+	const char *first = string_arena_strdup(&arena, "first");
+	char *large = string_arena_alloc(&arena, STRING_ARENA_CHUNK_SIZE * 2);
+	ck_assert_ptr_nonnull(large);
+	memset(large, 'x', STRING_ARENA_CHUNK_SIZE * 2);
+
+	/* Strings already handed out don't move */
+	const char *strings[10000];
+	char buf[32];
+	for (int i = 0; i < 10000; i++) {
+		snprintf(buf, sizeof(buf), "string %d", i);
+		strings[i] = string_arena_strdup(&arena, buf);
+	}
+	ck_assert_str_eq(first, "first");
+	for (int i = 0; i < 10000; i++) {
+		snprintf(buf, sizeof(buf), "string %d", i);
+		ck_assert_str_eq(strings[i], buf);
+	}
+
+	string_arena_finish(&arena);
+}
+END_TEST
+
+/* Test: aligned allocations between unaligned strings */
+START_TEST(test_arena_aligned)
+{
+	struct cg_string_arena arena;
+	string_arena_init(&arena);
+
+	for (int i = 0; i < 100; i++) {
+		string_arena_strdup(&arena, "odd");
+		char **pointers = string_arena_alloc_aligned(&arena, 3 * sizeof(char *), sizeof(char *));
+		ck_assert_ptr_nonnull(pointers);
+		ck_assert_uint_eq((uintptr_t)pointers % sizeof(char *), 0);
+		pointers[2] = NULL;
+	}
+
+	string_arena_finish(&arena);
+}
+END_TEST
+
+/* Test: equal interned strings share their copy */
+START_TEST(test_arena_intern)
+{
+	struct cg_string_arena arena;
+	string_arena_init(&arena);
+
+	const char *a = string_arena_intern(&arena, "/usr/share/applications/firefox.desktop", 23);
+	const char *b = string_arena_intern(&arena, "/usr/share/applications", 23);
+	const char *c = string_arena_intern(&arena, "/usr/share/applications/x", 25);
+	ck_assert_str_eq(a, "/usr/share/applications");
+	ck_assert_ptr_eq(a, b);
+	ck_assert_ptr_ne(a, c);
+
+	/* Survives the table growing */
+	char buf[32];
+	for (int i = 0; i < 1000; i++) {
+		snprintf(buf, sizeof(buf), "Category%d;", i);
+		string_arena_intern(&arena, buf, strlen(buf));
+	}
+	ck_assert_ptr_eq(string_arena_intern(&arena, "/usr/share/applications", 23), a);
+	ck_assert_uint_eq(arena.interned_count, 1002);
+
+	string_arena_finish(&arena);
+}
+END_TEST
+
+/* Test: adopted strings stay where they are */
+START_TEST(test_arena_adopt)
+{
+	struct cg_string_arena dest, src;
+	string_arena_init(&dest);
+	string_arena_init(&src);
+
+	const char *kept = string_arena_strdup(&dest, "kept");
+	const char *moved = string_arena_strdup(&src, "moved");
+	size_t size = dest.size + src.size;
+
+	string_arena_adopt(&dest, &src);
+	ck_assert_uint_eq(dest.size, size);
+	ck_assert_uint_eq(src.size, 0);
+	ck_assert_ptr_null(src.chunks);
+	ck_assert_str_eq(kept, "kept");
+	ck_assert_str_eq(moved, "moved");
+
+	/* dest keeps filling its own chunk */
+	ck_assert_str_eq(string_arena_strdup(&dest, "more"), "more");
+
+	string_arena_finish(&src);
+	string_arena_finish(&dest);
+}
+END_TEST
+
+Suite *
+string_arena_suite(void)
+{
+	Suite *s = suite_create("string_arena");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_arena_strdup);
+	tcase_add_test(tc_core, test_arena_chunks);
+	tcase_add_test(tc_core, test_arena_aligned);
+	tcase_add_test(tc_core, test_arena_intern);
+	tcase_add_test(tc_core, test_arena_adopt);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = string_arena_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
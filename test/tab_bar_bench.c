@@ -0,0 +1,197 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_scene.h>
+
+#include "bench.h"
+#include "server.h"
+#include "tab.h"
+#include "tab_bar.h"
+#include "view.h"
+#include "waymux_config.h"
+
+#define MAX_TABS 256
+
+/* Tabs on a real scene graph, rendered with the real fonts; only the
+ * views are fake */
+struct tab_bar_bench {
+	struct cg_server server;
+	struct cg_tab_bar *tab_bar;
+	int tab_count;
+
+	struct cg_tab tabs[MAX_TABS];
+	struct cg_view views[MAX_TABS];
+
+	/* Each view's title alternates between two, to force re-rendering */
+	char titles[MAX_TABS][2][48];
+	int generation;
+};
+
+static void
+retitle(struct tab_bar_bench *bench, int i)
+{
+	bench->views[i].title = bench->titles[i][bench->generation & 1];
+}
+
+/* Nothing changed: every button is taken from the render cache */
+static void
+bench_update_cached(void *data)
+{
+	struct tab_bar_bench *bench = data;
+	tab_bar_update(bench->tab_bar);
+}
+
+/* One title changed, so one create_tab_buffer() per update */
+static void
+bench_update_one_title(void *data)
+{
+	struct tab_bar_bench *bench = data;
+	bench->generation++;
+	retitle(bench, bench->tab_count / 2);
+	tab_bar_update(bench->tab_bar);
+}
+
+/* Every title changed, so a create_tab_buffer() for every tab */
+static void
+bench_update_all_titles(void *data)
+{
+	struct tab_bar_bench *bench = data;
+	bench->generation++;
+	for (int i = 0; i < bench->tab_count; i++) {
+		retitle(bench, i);
+	}
+	tab_bar_update(bench->tab_bar);
+}
+
+/* Switching between the first two tabs re-renders only their buttons */
+static void
+bench_active_changed(void *data)
+{
+	struct tab_bar_bench *bench = data;
+	struct cg_tab *old_tab = bench->server.active_tab;
+	struct cg_tab *new_tab = old_tab == &bench->tabs[0] ? &bench->tabs[1] : &bench->tabs[0];
+	bench->server.active_tab = new_tab;
+	tab_bar_active_changed(bench->tab_bar, old_tab, new_tab);
+	tab_bar_flush(bench->tab_bar);
+}
+
+/* Moving the pointer between the first two buttons moves the highlight */
+static void
+bench_hover(void *data)
+{
+	struct tab_bar_bench *bench = data;
+	struct cg_tab_bar_button *button = &bench->tab_bar->tabs[++bench->generation & 1];
+	tab_bar_handle_motion(bench->tab_bar, button->x + button->width / 2.0, TAB_BAR_HEIGHT / 2.0);
+	tab_bar_flush(bench->tab_bar);
+}
+
+/* Scrolling back and forth only moves the buttons' tree */
+static void
+bench_scroll(void *data)
+{
+	struct tab_bar_bench *bench = data;
+	double delta = ++bench->generation & 1 ? 10 : -10;
+	tab_bar_handle_scroll(bench->tab_bar, 0, TAB_BAR_HEIGHT / 2.0, delta);
+}
+
+static void
+set_tab_count(struct tab_bar_bench *bench, int count)
+{
+	wl_list_init(&bench->server.tabs);
+	for (int i = 0; i < count; i++) {
+		struct cg_tab *tab = &bench->tabs[i];
+		struct cg_view *view = &bench->views[i];
+		memset(tab, 0, sizeof(*tab));
+		memset(view, 0, sizeof(*view));
+		snprintf(bench->titles[i][0], sizeof(bench->titles[i][0]), "~/src/project%d: vim", i);
+		snprintf(bench->titles[i][1], sizeof(bench->titles[i][1]), "~/src/project%d: make", i);
+		view->app_id = "foot";
+		view->tab = tab;
+		tab->server = &bench->server;
+		tab->view = view;
+		tab->id = i + 1;
+		wl_list_insert(bench->server.tabs.prev, &tab->link);
+		retitle(bench, i);
+	}
+	bench->tab_count = count;
+	bench->server.active_tab = &bench->tabs[0];
+}
+
+void
+tab_bar_bench(void)
+{
+	static struct tab_bar_bench bench;
+	struct cg_server *server = &bench.server;
+	wl_list_init(&server->tabs);
+	wl_list_init(&server->outputs);
+	server->wl_display = wl_display_create();
+	server->output_layout = wlr_output_layout_create(server->wl_display);
+	server->scene = wlr_scene_create();
+
+	/* The cairo renderer's results keep their names; the scene
+	 * renderer's have a /scene suffix */
+	static struct waymux_config config;
+	static const struct {
+		enum waymux_tab_bar_renderer renderer;
+		const char *suffix;
+	} renderers[] = {
+		{WAYMUX_TAB_BAR_RENDERER_CAIRO, ""},
+		{WAYMUX_TAB_BAR_RENDERER_SCENE, "/scene"},
+	};
+	server->config = &config;
+
+	static const int tab_counts[] = {10, 100, 256};
+	for (size_t r = 0; r < sizeof(renderers) / sizeof(renderers[0]); r++) {
+		config.tab_bar_renderer = renderers[r].renderer;
+		const char *suffix = renderers[r].suffix;
+
+		for (size_t i = 0; i < sizeof(tab_counts) / sizeof(tab_counts[0]); i++) {
+			int count = tab_counts[i];
+			set_tab_count(&bench, count);
+			bench.tab_bar = tab_bar_create(server, NULL);
+			if (!bench.tab_bar) {
+				fprintf(stderr, "Failed to create the tab bar\n");
+				exit(EXIT_FAILURE);
+			}
+			tab_bar_update(bench.tab_bar);
+
+			char name[64];
+			snprintf(name, sizeof(name), "tab_bar_update/%d/cached%s", count, suffix);
+			bench_run(name, bench_update_cached, &bench);
+			snprintf(name, sizeof(name), "tab_bar_update/%d/one_title%s", count, suffix);
+			bench_run(name, bench_update_one_title, &bench);
+			snprintf(name, sizeof(name), "tab_bar_active_changed/%d%s", count, suffix);
+			bench_run(name, bench_active_changed, &bench);
+
+			/* There are no outputs, so give the bar a width to hover
+			 * and scroll in */
+			bench.tab_bar->width = 1920;
+			snprintf(name, sizeof(name), "tab_bar_hover/%d%s", count, suffix);
+			bench_run(name, bench_hover, &bench);
+			snprintf(name, sizeof(name), "tab_bar_scroll/%d%s", count, suffix);
+			bench_run(name, bench_scroll, &bench);
+			snprintf(name, sizeof(name), "create_tab_buffer/%d%s", count, suffix);
+			bench_run(name, bench_update_all_titles, &bench);
+
+			tab_bar_destroy(bench.tab_bar);
+		}
+	}
+	server->config = NULL;
+
+	wl_list_init(&server->tabs);
+	wlr_scene_node_destroy(&server->scene->tree.node);
+	wlr_output_layout_destroy(server->output_layout);
+	wl_display_destroy(server->wl_display);
+}
@@ -13,15 +13,22 @@
 #include <string.h>
 #include <wayland-server-core.h>
 
+#include "output.h"
 #include "tab.h"
 
-/* Minimal mock of cg_server for testing */
-struct mock_server {
-	char padding[184];  /* Pad to match cg_server layout where tabs is at offset 184 */
-	struct wl_list tabs;
-	struct cg_tab *active_tab;
-	struct cg_tab_bar *tab_bar;  /* For tab_set_background tests */
-};
+/* Just enough of a cg_server for the tab functions */
+static void
+init_server(struct cg_server *server)
+{
+	memset(server, 0, sizeof(*server));
+	tab_list_init(server);
+	wl_signal_init(&server->events.tab_map);
+	wl_signal_init(&server->events.tab_unmap);
+	wl_signal_init(&server->events.tab_activate);
+	wl_signal_init(&server->events.tab_title);
+	wl_signal_init(&server->events.tab_background);
+	wl_signal_init(&server->events.tab_move);
+}
 
 /* Minimal mock of cg_view for testing */
 struct mock_view {
@@ -33,11 +40,12 @@ struct mock_view {
 /* Test: tab_count with no tabs */
 START_TEST(test_tab_count_empty)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
-	int count = tab_count((struct cg_server *)&server);
+	int count = tab_count(&server);
 	ck_assert_int_eq(count, 0);
 }
 END_TEST
@@ -45,11 +53,12 @@ END_TEST
 /* Test: tab_count with multiple tabs */
 START_TEST(test_tab_count_multiple)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
-	ck_assert_int_eq(tab_count((struct cg_server *)&server), 0);
+	ck_assert_int_eq(tab_count(&server), 0);
 
 	/* Add tabs */
 	struct cg_tab tab1, tab2, tab3;
@@ -57,25 +66,60 @@ START_TEST(test_tab_count_multiple)
 	memset(&tab2, 0, sizeof(tab2));
 	memset(&tab3, 0, sizeof(tab3));
 
-	tab1.server = (struct cg_server *)&server;
-	tab2.server = (struct cg_server *)&server;
-	tab3.server = (struct cg_server *)&server;
+	tab1.server = &server;
+	tab2.server = &server;
+	tab3.server = &server;
 
-	wl_list_insert(&server.tabs, &tab1.link);
-	ck_assert_int_eq(tab_count((struct cg_server *)&server), 1);
+	tab_add(&tab1);
+	ck_assert_int_eq(tab_count(&server), 1);
 
-	wl_list_insert(&tab1.link, &tab2.link);
-	ck_assert_int_eq(tab_count((struct cg_server *)&server), 2);
+	tab_add(&tab2);
+	ck_assert_int_eq(tab_count(&server), 2);
 
-	wl_list_insert(&tab2.link, &tab3.link);
-	ck_assert_int_eq(tab_count((struct cg_server *)&server), 3);
+	tab_add(&tab3);
+	ck_assert_int_eq(tab_count(&server), 3);
+
+	tab_remove(&tab2);
+	ck_assert_int_eq(tab_count(&server), 2);
+}
+END_TEST
+
+/* Test: IDs are never reused and resolve to their tab */
+START_TEST(test_tab_ids)
+{
+	struct cg_server server;
+	init_server(&server);
+
+	struct cg_tab tabs[TAB_ID_BUCKETS + 2];
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < TAB_ID_BUCKETS + 2; i++) {
+		tabs[i].server = &server;
+		tab_add(&tabs[i]);
+		ck_assert_uint_eq(tabs[i].id, i + 1);
+	}
+
+	/* IDs sharing a bucket are told apart */
+	ck_assert_ptr_eq(tab_from_id(&server, 1), &tabs[0]);
+	ck_assert_ptr_eq(tab_from_id(&server, TAB_ID_BUCKETS + 1), &tabs[TAB_ID_BUCKETS]);
+	ck_assert_ptr_null(tab_from_id(&server, 0));
+	ck_assert_ptr_null(tab_from_id(&server, TAB_ID_BUCKETS + 3));
+
+	tab_remove(&tabs[0]);
+	ck_assert_ptr_null(tab_from_id(&server, 1));
+	ck_assert_ptr_eq(tab_from_id(&server, TAB_ID_BUCKETS + 1), &tabs[TAB_ID_BUCKETS]);
+
+	/* A new tab gets a new ID, not the freed one */
+	tab_add(&tabs[0]);
+	ck_assert_uint_eq(tabs[0].id, TAB_ID_BUCKETS + 3);
+	ck_assert_ptr_eq(tab_from_id(&server, TAB_ID_BUCKETS + 3), &tabs[0]);
 }
 END_TEST
 
 /* Test: tab_next with wraparound */
 START_TEST(test_tab_next_wraparound)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
@@ -85,9 +129,9 @@ START_TEST(test_tab_next_wraparound)
 	memset(&tab2, 0, sizeof(tab2));
 	memset(&tab3, 0, sizeof(tab3));
 
-	tab1.server = (struct cg_server *)&server;
-	tab2.server = (struct cg_server *)&server;
-	tab3.server = (struct cg_server *)&server;
+	tab1.server = &server;
+	tab2.server = &server;
+	tab3.server = &server;
 
 	/* Add to list in order: tab1, tab2, tab3 */
 	wl_list_insert(&server.tabs, &tab1.link);
@@ -111,7 +155,8 @@ END_TEST
 /* Test: tab_prev with wraparound */
 START_TEST(test_tab_prev_wraparound)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
@@ -121,9 +166,9 @@ START_TEST(test_tab_prev_wraparound)
 	memset(&tab2, 0, sizeof(tab2));
 	memset(&tab3, 0, sizeof(tab3));
 
-	tab1.server = (struct cg_server *)&server;
-	tab2.server = (struct cg_server *)&server;
-	tab3.server = (struct cg_server *)&server;
+	tab1.server = &server;
+	tab2.server = &server;
+	tab3.server = &server;
 
 	/* Add to list in order: tab1, tab2, tab3 */
 	wl_list_insert(&server.tabs, &tab1.link);
@@ -161,13 +206,14 @@ END_TEST
 /* Test: single tab wraps to itself */
 START_TEST(test_tab_single_wraparound)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
 	struct cg_tab tab1;
 	memset(&tab1, 0, sizeof(tab1));
-	tab1.server = (struct cg_server *)&server;
+	tab1.server = &server;
 
 	wl_list_insert(&server.tabs, &tab1.link);
 
@@ -189,30 +235,54 @@ START_TEST(test_tab_set_background_null)
 }
 END_TEST
 
+static int event_count;
+
+static void
+count_event(struct wl_listener *listener, void *data)
+{
+	event_count++;
+}
+
 /* Test: tab_set_background sets the is_background flag */
 START_TEST(test_tab_set_background)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 	server.tab_bar = NULL;  /* No tab bar in tests */
 
 	struct cg_tab tab;
 	memset(&tab, 0, sizeof(tab));
-	tab.server = (struct cg_server *)&server;
+	tab.server = &server;
 	tab.is_background = false;
 
+	struct wl_listener background = {.notify = count_event};
+	wl_signal_add(&server.events.tab_background, &background);
+	event_count = 0;
+
 	/* Set to background */
 	tab_set_background(&tab, true);
-	/* Note: Due to struct layout mismatch in mock, we can't verify the value.
-	 * This test mainly ensures the function doesn't crash. */
+	ck_assert(tab.is_background);
+	ck_assert_int_eq(event_count, 1);
+
+	/* No change, no event */
+	tab_set_background(&tab, true);
+	ck_assert_int_eq(event_count, 1);
+
+	tab_set_background(&tab, false);
+	ck_assert(!tab.is_background);
+	ck_assert_int_eq(event_count, 2);
+
+	wl_list_remove(&background.link);
 }
 END_TEST
 
 /* Test: tab_next skips background tabs */
 START_TEST(test_tab_next_skip_background)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
@@ -223,10 +293,10 @@ START_TEST(test_tab_next_skip_background)
 	memset(&tab3, 0, sizeof(tab3));
 	memset(&tab4, 0, sizeof(tab4));
 
-	tab1.server = (struct cg_server *)&server;
-	tab2.server = (struct cg_server *)&server;
-	tab3.server = (struct cg_server *)&server;
-	tab4.server = (struct cg_server *)&server;
+	tab1.server = &server;
+	tab2.server = &server;
+	tab3.server = &server;
+	tab4.server = &server;
 
 	tab1.is_background = false;
 	tab2.is_background = true;
@@ -252,7 +322,8 @@ END_TEST
 /* Test: tab_prev skips background tabs */
 START_TEST(test_tab_prev_skip_background)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
@@ -263,10 +334,10 @@ START_TEST(test_tab_prev_skip_background)
 	memset(&tab3, 0, sizeof(tab3));
 	memset(&tab4, 0, sizeof(tab4));
 
-	tab1.server = (struct cg_server *)&server;
-	tab2.server = (struct cg_server *)&server;
-	tab3.server = (struct cg_server *)&server;
-	tab4.server = (struct cg_server *)&server;
+	tab1.server = &server;
+	tab2.server = &server;
+	tab3.server = &server;
+	tab4.server = &server;
 
 	tab1.is_background = false;
 	tab2.is_background = true;
@@ -292,7 +363,8 @@ END_TEST
 /* Test: tab_next with only background tabs returns current tab */
 START_TEST(test_tab_next_all_background)
 {
-	struct mock_server server;
+	struct cg_server server;
+	init_server(&server);
 	wl_list_init(&server.tabs);
 	server.active_tab = NULL;
 
@@ -302,9 +374,9 @@ START_TEST(test_tab_next_all_background)
 	memset(&tab2, 0, sizeof(tab2));
 	memset(&tab3, 0, sizeof(tab3));
 
-	tab1.server = (struct cg_server *)&server;
-	tab2.server = (struct cg_server *)&server;
-	tab3.server = (struct cg_server *)&server;
+	tab1.server = &server;
+	tab2.server = &server;
+	tab3.server = &server;
 
 	tab1.is_background = true;
 	tab2.is_background = true;
@@ -321,6 +393,217 @@ START_TEST(test_tab_next_all_background)
 END_TEST
 
 /* Main test runner */
+/* Test: tabs are found by position, among all tabs or the foreground ones */
+START_TEST(test_tab_order)
+{
+	struct cg_server server;
+	init_server(&server);
+
+	struct cg_tab tabs[40];
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < 40; i++) {
+		tabs[i].server = &server;
+		tab_add(&tabs[i]);
+	}
+	tab_set_background(&tabs[1], true);
+
+	ck_assert_ptr_eq(tab_at(&server, 0), &tabs[0]);
+	ck_assert_ptr_eq(tab_at(&server, 39), &tabs[39]);
+	ck_assert_ptr_null(tab_at(&server, 40));
+	ck_assert_ptr_null(tab_at(&server, -1));
+	ck_assert_ptr_eq(tab_foreground_at(&server, 1), &tabs[2]);
+	ck_assert_ptr_eq(tab_foreground_at(&server, 38), &tabs[39]);
+	ck_assert_ptr_null(tab_foreground_at(&server, 39));
+	ck_assert_int_eq(tab_index(&tabs[13]), 13);
+	ck_assert_int_eq(tabs[1].foreground_index, -1);
+
+	/* Changes are picked up */
+	tab_remove(&tabs[0]);
+	tab_set_background(&tabs[1], false);
+	ck_assert_ptr_eq(tab_at(&server, 0), &tabs[1]);
+	ck_assert_ptr_eq(tab_foreground_at(&server, 0), &tabs[1]);
+	ck_assert_int_eq(tab_index(&tabs[13]), 12);
+
+	tab_list_finish(&server);
+}
+END_TEST
+
+/* Test: tabs move among the foreground tabs, skipping background ones */
+START_TEST(test_tab_move)
+{
+	struct cg_server server;
+	init_server(&server);
+
+	struct cg_tab tabs[4];
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < 4; i++) {
+		tabs[i].server = &server;
+		tab_add(&tabs[i]);
+	}
+	tab_set_background(&tabs[2], true);
+
+	struct wl_listener move = {.notify = count_event};
+	wl_signal_add(&server.events.tab_move, &move);
+	event_count = 0;
+
+	/* 0 1 [2] 3: moving 3 left goes before 1 */
+	ck_assert(tab_move(&tabs[3], -1));
+	ck_assert_ptr_eq(tab_at(&server, 1), &tabs[3]);
+	ck_assert_ptr_eq(tab_at(&server, 2), &tabs[1]);
+	ck_assert_ptr_eq(tab_at(&server, 3), &tabs[2]);
+	ck_assert_int_eq(event_count, 1);
+
+	/* 0 3 1 [2]: moving 0 two places right goes after 1 */
+	ck_assert(tab_move(&tabs[0], 2));
+	ck_assert_ptr_eq(tab_at(&server, 2), &tabs[0]);
+	ck_assert_ptr_eq(tab_at(&server, 3), &tabs[2]);
+
+	/* 3 1 0 [2]: no room */
+	ck_assert(!tab_move(&tabs[3], -1));
+	ck_assert(!tab_move(&tabs[0], 1));
+	ck_assert_int_eq(event_count, 2);
+
+	/* Background tabs move among all tabs */
+	ck_assert(tab_move(&tabs[2], -1));
+	ck_assert_ptr_eq(tab_at(&server, 2), &tabs[2]);
+
+	wl_list_remove(&move.link);
+	tab_list_finish(&server);
+}
+END_TEST
+
+/* Test: tabs are kept in most recently active order */
+START_TEST(test_tab_mru)
+{
+	struct cg_server server;
+	init_server(&server);
+
+	struct cg_tab tabs[4];
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < 4; i++) {
+		tabs[i].server = &server;
+		tab_add(&tabs[i]);
+	}
+
+	/* Tabs never active follow, in tab list order */
+	tab_activate(&tabs[0]);
+	ck_assert_ptr_eq(tab_last_used(&server), &tabs[1]);
+
+	tab_activate(&tabs[2]);
+	ck_assert_ptr_eq(tab_last_used(&server), &tabs[0]);
+	tab_activate(&tabs[2]);
+	ck_assert_ptr_eq(tab_last_used(&server), &tabs[0]);
+	tab_activate(&tabs[0]);
+	ck_assert_ptr_eq(tab_last_used(&server), &tabs[2]);
+
+	/* Background and closed tabs are skipped */
+	tab_set_background(&tabs[2], true);
+	ck_assert_ptr_eq(tab_last_used(&server), &tabs[1]);
+	tab_remove(&tabs[1]);
+	ck_assert_ptr_eq(tab_last_used(&server), &tabs[3]);
+
+	struct cg_tab *tab;
+	int count = 0;
+	wl_list_for_each(tab, &server.tabs_mru, mru_link) {
+		count++;
+	}
+	ck_assert_int_eq(count, 3);
+}
+END_TEST
+
+/* Test: switching to another tab starts the latency trace */
+START_TEST(test_tab_switch_trace)
+{
+	struct cg_server server;
+	init_server(&server);
+
+	struct cg_tab tabs[2];
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < 2; i++) {
+		tabs[i].server = &server;
+		tab_add(&tabs[i]);
+	}
+
+	tab_activate(&tabs[0]);
+	server.tab_switch_started = (struct timespec){0};
+	tab_activate(&tabs[0]);
+	ck_assert(server.tab_switch_started.tv_sec == 0 && server.tab_switch_started.tv_nsec == 0);
+
+	tab_activate(&tabs[1]);
+	ck_assert(server.tab_switch_started.tv_sec != 0 || server.tab_switch_started.tv_nsec != 0);
+	ck_assert_ptr_eq(server.active_tab, &tabs[1]);
+}
+END_TEST
+
+/* Test: separate outputs each show a tab of their own */
+START_TEST(test_tab_outputs)
+{
+	struct cg_server server;
+	init_server(&server);
+	server.output_mode = WAYMUX_MULTI_OUTPUT_MODE_SEPARATE;
+
+	struct cg_output outputs[2];
+	memset(outputs, 0, sizeof(outputs));
+	wl_list_init(&server.outputs);
+	for (int i = 0; i < 2; i++) {
+		outputs[i].server = &server;
+		wl_list_insert(server.outputs.prev, &outputs[i].link);
+	}
+
+	/* 0 and 2 on the first output, 1 and 3 on the second */
+	struct cg_tab tabs[4];
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < 4; i++) {
+		tabs[i].server = &server;
+		tabs[i].output = &outputs[i % 2];
+		tab_add(&tabs[i]);
+	}
+
+	tab_activate(&tabs[1]);
+	tab_activate(&tabs[0]);
+	ck_assert_ptr_eq(server.active_tab, &tabs[0]);
+	ck_assert_ptr_eq(outputs[0].active_tab, &tabs[0]);
+	ck_assert_ptr_eq(outputs[1].active_tab, &tabs[1]);
+	ck_assert(tab_is_shown(&tabs[1]));
+	ck_assert(!tab_is_shown(&tabs[2]));
+
+	/* Navigation stays on the focused output */
+	ck_assert_ptr_eq(tab_next(&tabs[0]), &tabs[2]);
+	ck_assert_ptr_eq(tab_prev(&tabs[0]), &tabs[2]);
+	ck_assert_ptr_eq(tab_output_foreground_at(&server, &outputs[1], 1), &tabs[3]);
+	ck_assert_ptr_null(tab_output_foreground_at(&server, &outputs[1], 2));
+	ck_assert_ptr_eq(tab_last_used(&server), &tabs[2]);
+
+	/* Showing a tab leaves the focus where it is */
+	tab_show(&tabs[3]);
+	ck_assert_ptr_eq(server.active_tab, &tabs[0]);
+	ck_assert_ptr_eq(outputs[1].active_tab, &tabs[3]);
+	ck_assert(!tabs[1].is_visible);
+
+	/* The focused tab takes the focus along to another output, whose
+	 * shown tab is replaced; the output it left shows its last used */
+	tab_activate(&tabs[2]);
+	tab_set_output(&tabs[2], &outputs[1]);
+	ck_assert_ptr_eq(server.active_tab, &tabs[2]);
+	ck_assert_ptr_eq(outputs[1].active_tab, &tabs[2]);
+	ck_assert_ptr_eq(outputs[0].active_tab, &tabs[0]);
+	ck_assert(!tabs[3].is_visible);
+
+	/* An output going away gives its tabs to another */
+	tab_move_output_tabs(&server, &outputs[1], &outputs[0]);
+	for (int i = 0; i < 4; i++) {
+		ck_assert_ptr_eq(tabs[i].output, &outputs[0]);
+	}
+	ck_assert_ptr_eq(outputs[0].active_tab, &tabs[2]);
+	ck_assert_ptr_eq(server.active_tab, &tabs[2]);
+	ck_assert(!tabs[0].is_visible);
+
+	tab_remove(&tabs[2]);
+	ck_assert_ptr_null(outputs[0].active_tab);
+	tab_list_finish(&server);
+}
+END_TEST
+
 int
 main(void)
 {
@@ -330,12 +613,15 @@ main(void)
 	TCase *tc_core = tcase_create("Core");
 	TCase *tc_navigation = tcase_create("Navigation");
 	TCase *tc_background = tcase_create("Background");
+	TCase *tc_order = tcase_create("Order");
 
 	/* Core tests */
 	tcase_add_test(tc_core, test_tab_count_empty);
 	tcase_add_test(tc_core, test_tab_count_multiple);
+	tcase_add_test(tc_core, test_tab_ids);
 	tcase_add_test(tc_core, test_tab_set_background_null);
 	tcase_add_test(tc_core, test_tab_set_background);
+	tcase_add_test(tc_core, test_tab_switch_trace);
 
 	/* Navigation tests */
 	tcase_add_test(tc_navigation, test_tab_next_wraparound);
@@ -348,9 +634,16 @@ main(void)
 	tcase_add_test(tc_background, test_tab_prev_skip_background);
 	tcase_add_test(tc_background, test_tab_next_all_background);
 
+	/* Tab order tests */
+	tcase_add_test(tc_order, test_tab_order);
+	tcase_add_test(tc_order, test_tab_move);
+	tcase_add_test(tc_order, test_tab_mru);
+	tcase_add_test(tc_order, test_tab_outputs);
+
 	suite_add_tcase(s, tc_core);
 	suite_add_tcase(s, tc_navigation);
 	suite_add_tcase(s, tc_background);
+	suite_add_tcase(s, tc_order);
 
 	SRunner *sr = srunner_create(s);
 	srunner_run_all(sr, CK_NORMAL);
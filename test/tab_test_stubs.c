@@ -22,7 +22,9 @@
 #include <wlr/util/log.h>
 #include <wlr/types/wlr_scene.h>
 
+#include "output.h"
 #include "server.h"
+#include "tab.h"
 #include "tab_bar.h"
 #include "view.h"
 
@@ -43,14 +45,32 @@ view_position(struct cg_view *view)
 	/* Stub - requires output and scene graph */
 }
 
-/* Stub for tab_bar_update called by tab_set_background and tab_create */
+/* Stub for tab_bar_schedule_update called by tab_set_background and tab_create */
 void
-tab_bar_update(struct cg_tab_bar *tab_bar)
+tab_bar_schedule_update(struct cg_tab_bar *tab_bar)
 {
 	(void)tab_bar;
 	/* Stub - requires rendering system */
 }
 
+/* Stub for tab_bar_tab_removed called by tab_remove */
+void
+tab_bar_tab_removed(struct cg_server *server, struct cg_tab *tab)
+{
+	(void)server;
+	(void)tab;
+	/* Stub - requires rendering system */
+}
+
+/* Stub for tab_bar_active_changed called by tab_activate */
+void
+tab_bar_active_changed(struct cg_tab_bar *tab_bar, struct cg_tab *old_tab, struct cg_tab *new_tab)
+{
+	(void)tab_bar;
+	(void)old_tab;
+	(void)new_tab;
+}
+
 /* Stub for wlr_scene_tree_create called by tab_create */
 struct wlr_scene_tree *
 wlr_scene_tree_create(struct wlr_scene_tree *parent)
@@ -78,3 +98,13 @@ wlr_scene_node_destroy(struct wlr_scene_node *node)
 		free(node);
 	}
 }
+
+/* Stub for output_focused called by tab_create */
+struct cg_output *
+output_focused(struct cg_server *server)
+{
+	if (server->active_tab) {
+		return server->active_tab->output;
+	}
+	return NULL;
+}
@@ -0,0 +1,165 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+static char trace_path[64];
+
+static void
+setup(void)
+{
+	snprintf(trace_path, sizeof(trace_path), "/tmp/waymux_trace_test_XXXXXX");
+	int fd = mkstemp(trace_path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+}
+
+static void
+teardown(void)
+{
+	unlink(trace_path);
+}
+
+/* Read the whole trace file into a new allocation */
+static char *
+read_trace(void)
+{
+	FILE *file = fopen(trace_path, "r");
+	ck_assert_ptr_nonnull(file);
+	char *data = calloc(1, 65536);
+	size_t len = fread(data, 1, 65535, file);
+	data[len] = '\0';
+	fclose(file);
+	return data;
+}
+
+static int
+count(const char *haystack, const char *needle)
+{
+	int n = 0;
+	for (const char *p = strstr(haystack, needle); p; p = strstr(p + 1, needle)) {
+		n++;
+	}
+	return n;
+}
+
+static void
+traced(int depth)
+{
+	TRACE_SCOPE("traced");
+	if (depth > 0) {
+		traced(depth - 1);
+		return;
+	}
+}
+
+static void *
+traced_thread(void *data)
+{
+	(void)data;
+	TRACE_SCOPE("thread");
+	return NULL;
+}
+
+/* Test: spans end when their scope is left, including by return */
+START_TEST(test_trace_spans)
+{
+	ck_assert(trace_init(trace_path));
+	traced(2);
+	{
+		TRACE_SCOPE("block");
+	}
+	trace_finish();
+
+	/* Not recorded once finished */
+	traced(0);
+
+	char *data = read_trace();
+	ck_assert_msg(strncmp(data, "[\n", 2) == 0, "got '%s'", data);
+	ck_assert_int_eq(count(data, "\"name\":\"traced\",\"ph\":\"X\""), 3);
+	ck_assert_int_eq(count(data, "\"name\":\"block\""), 1);
+	ck_assert_int_eq(count(data, "\"ph\":\"M\""), 1);
+
+	/* Valid JSON: the array is closed without a trailing comma */
+	size_t len = strlen(data);
+	ck_assert_str_eq(data + len - 5, "}}\n]\n");
+	free(data);
+}
+END_TEST
+
+/* Test: spans from other threads get their own thread ID */
+START_TEST(test_trace_threads)
+{
+	ck_assert(trace_init(trace_path));
+	traced(0);
+	pthread_t thread;
+	ck_assert_int_eq(pthread_create(&thread, NULL, traced_thread, NULL), 0);
+	pthread_join(thread, NULL);
+	trace_finish();
+
+	char *data = read_trace();
+	const char *main_span = strstr(data, "\"name\":\"traced\"");
+	const char *thread_span = strstr(data, "\"name\":\"thread\"");
+	ck_assert_ptr_nonnull(main_span);
+	ck_assert_ptr_nonnull(thread_span);
+	int main_tid = 0, thread_tid = 0;
+	ck_assert_int_eq(sscanf(strstr(main_span, "\"tid\":"), "\"tid\":%d", &main_tid), 1);
+	ck_assert_int_eq(sscanf(strstr(thread_span, "\"tid\":"), "\"tid\":%d", &thread_tid), 1);
+	ck_assert_int_ne(main_tid, thread_tid);
+	free(data);
+}
+END_TEST
+
+/* Test: without a path, nothing is traced */
+START_TEST(test_trace_disabled)
+{
+	ck_assert(trace_init(NULL));
+	ck_assert(trace_init(""));
+	traced(0);
+	trace_finish();
+	ck_assert(!trace_init("/nonexistent/dir/trace.json"));
+}
+END_TEST
+
+Suite *
+trace_suite(void)
+{
+	Suite *s = suite_create("trace");
+
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_trace_spans);
+	tcase_add_test(tc_core, test_trace_threads);
+	tcase_add_test(tc_core, test_trace_disabled);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = trace_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
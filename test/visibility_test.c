@@ -0,0 +1,329 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "tab.h"
+#include "view.h"
+#include "visibility.h"
+
+#define TEST_TABS 3
+
+struct test_view {
+	struct cg_view view;
+	pid_t pid;
+	bool suspended;
+	int suspend_changes;
+};
+
+static struct cg_server server;
+static struct test_view views[TEST_TABS];
+static struct cg_tab tabs[TEST_TABS];
+static struct wl_event_loop *loop;
+static pid_t children[TEST_TABS];
+
+static pid_t
+test_get_pid(struct cg_view *view)
+{
+	return ((struct test_view *)view)->pid;
+}
+
+static void
+test_set_suspended(struct cg_view *view, bool suspended)
+{
+	struct test_view *test_view = (struct test_view *)view;
+	test_view->suspended = suspended;
+	test_view->suspend_changes++;
+}
+
+static const struct cg_view_impl test_view_impl = {
+	.get_pid = test_get_pid,
+	.set_suspended = test_set_suspended,
+};
+
+static void
+setup(void)
+{
+	memset(&server, 0, sizeof(server));
+	server.wl_display = wl_display_create();
+	loop = wl_display_get_event_loop(server.wl_display);
+	wl_list_init(&server.tabs);
+	wl_signal_init(&server.events.tab_map);
+	wl_signal_init(&server.events.tab_unmap);
+	wl_signal_init(&server.events.tab_activate);
+	wl_signal_init(&server.events.tab_background);
+
+	memset(views, 0, sizeof(views));
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < TEST_TABS; i++) {
+		views[i].view.impl = &test_view_impl;
+		views[i].pid = -1;
+		tabs[i].server = &server;
+		tabs[i].view = &views[i].view;
+		tabs[i].id = i + 1;
+		wl_list_insert(server.tabs.prev, &tabs[i].link);
+	}
+}
+
+static void
+teardown(void)
+{
+	for (int i = 0; i < TEST_TABS; i++) {
+		if (children[i] > 0) {
+			kill(children[i], SIGKILL);
+			waitpid(children[i], NULL, 0);
+		}
+		children[i] = 0;
+	}
+	wl_display_destroy(server.wl_display);
+}
+
+/* Give a tab a real client process, to be stopped and continued */
+static pid_t
+give_process(int index)
+{
+	pid_t pid = fork();
+	ck_assert_int_ge(pid, 0);
+	if (pid == 0) {
+		pause();
+		_exit(0);
+	}
+	children[index] = pid;
+	views[index].pid = pid;
+	return pid;
+}
+
+static void
+activate(int index)
+{
+	server.active_tab = &tabs[index];
+	wl_signal_emit_mutable(&server.events.tab_activate, &tabs[index]);
+}
+
+static void
+set_background(int index, bool background)
+{
+	tabs[index].is_background = background;
+	wl_signal_emit_mutable(&server.events.tab_background, &tabs[index]);
+}
+
+/* Whether a child has been stopped (true) or continued (false) since last asked */
+static bool
+wait_state(pid_t pid, bool stopped)
+{
+	for (int i = 0; i < 200; i++) {
+		int status;
+		pid_t ret = waitpid(pid, &status, WNOHANG | (stopped ? WUNTRACED : WCONTINUED));
+		if (ret == pid) {
+			return stopped ? WIFSTOPPED(status) : WIFCONTINUED(status);
+		}
+		usleep(5000);
+	}
+	return false;
+}
+
+/* Test: only the active tab isn't suspended, and states are only sent on change */
+START_TEST(test_suspend_hidden)
+{
+	struct cg_visibility *visibility = visibility_create(&server, true, 0);
+	ck_assert_ptr_nonnull(visibility);
+
+	activate(0);
+	activate(1);
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert(views[0].suspended);
+	ck_assert(!views[1].suspended);
+	ck_assert(views[2].suspended);
+
+	/* Both events were handled by one update */
+	ck_assert_int_eq(views[0].suspend_changes, 1);
+	ck_assert_int_eq(views[1].suspend_changes, 0);
+
+	activate(2);
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert(!views[2].suspended);
+	ck_assert(views[1].suspended);
+	ck_assert_int_eq(views[0].suspend_changes, 1);
+
+	visibility_destroy(visibility);
+}
+END_TEST
+
+/* Test: suspending can be turned off */
+START_TEST(test_suspend_disabled)
+{
+	struct cg_visibility *visibility = visibility_create(&server, false, 0);
+	activate(0);
+	wl_event_loop_dispatch(loop, 0);
+	for (int i = 0; i < TEST_TABS; i++) {
+		ck_assert_int_eq(views[i].suspend_changes, 0);
+	}
+	visibility_destroy(visibility);
+}
+END_TEST
+
+/* Test: background tabs' clients are stopped after the timeout, and
+ * continued when brought back */
+START_TEST(test_stop_background)
+{
+	pid_t pid = give_process(1);
+	struct cg_visibility *visibility = visibility_create(&server, true, 1);
+
+	activate(0);
+	set_background(1, true);
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert(!tabs[1].stopped);
+
+	for (int i = 0; i < 30 && !tabs[1].stopped; i++) {
+		wl_event_loop_dispatch(loop, 100);
+	}
+	ck_assert(tabs[1].stopped);
+	ck_assert(wait_state(pid, true));
+
+	set_background(1, false);
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert(!tabs[1].stopped);
+	ck_assert(wait_state(pid, false));
+
+	visibility_destroy(visibility);
+}
+END_TEST
+
+/* Test: a client with a tab that isn't in the background is not stopped */
+START_TEST(test_stop_shared_client)
+{
+	pid_t pid = give_process(1);
+	views[2].pid = pid;
+	struct cg_visibility *visibility = visibility_create(&server, true, 1);
+
+	activate(0);
+	set_background(1, true);
+	for (int i = 0; i < 15; i++) {
+		wl_event_loop_dispatch(loop, 100);
+	}
+	ck_assert(!tabs[1].stopped);
+	ck_assert(!tabs[2].stopped);
+
+	/* Once its other tab goes too, it is */
+	set_background(2, true);
+	for (int i = 0; i < 30 && !tabs[2].stopped; i++) {
+		wl_event_loop_dispatch(loop, 100);
+	}
+	ck_assert(tabs[1].stopped);
+	ck_assert(tabs[2].stopped);
+	ck_assert(wait_state(pid, true));
+
+	visibility_destroy(visibility);
+}
+END_TEST
+
+/* Test: closing a stopped tab, and destroying the policy, continue clients */
+START_TEST(test_stop_continue)
+{
+	pid_t closed = give_process(1);
+	pid_t kept = give_process(2);
+	struct cg_visibility *visibility = visibility_create(&server, true, 1);
+
+	activate(0);
+	set_background(1, true);
+	set_background(2, true);
+	for (int i = 0; i < 30 && !(tabs[1].stopped && tabs[2].stopped); i++) {
+		wl_event_loop_dispatch(loop, 100);
+	}
+	ck_assert(wait_state(closed, true));
+	ck_assert(wait_state(kept, true));
+
+	wl_list_remove(&tabs[1].link);
+	wl_signal_emit_mutable(&server.events.tab_unmap, &tabs[1]);
+	ck_assert(wait_state(closed, false));
+
+	visibility_destroy(visibility);
+	ck_assert(wait_state(kept, false));
+}
+END_TEST
+
+/* Test: the policy can be changed while tabs are suspended and stopped */
+START_TEST(test_reconfigure)
+{
+	pid_t pid = give_process(1);
+	struct cg_visibility *visibility = visibility_create(&server, true, 0);
+
+	activate(0);
+	set_background(1, true);
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert(views[1].suspended);
+	ck_assert(!tabs[1].stopped);
+
+	/* Turning suspending off resumes hidden tabs */
+	ck_assert(visibility_configure(visibility, false, 0));
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert(!views[1].suspended);
+	ck_assert(!views[2].suspended);
+
+	/* Stopping can be turned on after the fact */
+	ck_assert(visibility_configure(visibility, true, 1));
+	for (int i = 0; i < 30 && !tabs[1].stopped; i++) {
+		wl_event_loop_dispatch(loop, 100);
+	}
+	ck_assert(views[1].suspended);
+	ck_assert(tabs[1].stopped);
+	ck_assert(wait_state(pid, true));
+
+	/* And off again, continuing the client */
+	ck_assert(visibility_configure(visibility, true, 0));
+	wl_event_loop_dispatch(loop, 0);
+	ck_assert(!tabs[1].stopped);
+	ck_assert(wait_state(pid, false));
+
+	visibility_destroy(visibility);
+}
+END_TEST
+
+Suite *
+visibility_suite(void)
+{
+	Suite *s = suite_create("visibility");
+
+	TCase *tc_suspend = tcase_create("Suspend");
+	tcase_add_checked_fixture(tc_suspend, setup, teardown);
+	tcase_add_test(tc_suspend, test_suspend_hidden);
+	tcase_add_test(tc_suspend, test_suspend_disabled);
+	suite_add_tcase(s, tc_suspend);
+
+	TCase *tc_stop = tcase_create("Stop");
+	tcase_add_checked_fixture(tc_stop, setup, teardown);
+	tcase_add_test(tc_stop, test_stop_background);
+	tcase_add_test(tc_stop, test_stop_shared_client);
+	tcase_add_test(tc_stop, test_stop_continue);
+	tcase_add_test(tc_stop, test_reconfigure);
+	suite_add_tcase(s, tc_stop);
+
+	return s;
+}
+
+int
+main(void)
+{
+	int number_failed;
+	Suite *s = visibility_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
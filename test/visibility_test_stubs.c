@@ -0,0 +1,32 @@
+/*
+ * Stubs for visibility policy testing
+ *
+ * These stubs allow the visibility policy to be tested without the full
+ * WayMux server implementation.
+ */
+
+#include "server.h"
+#include "tab.h"
+#include "view.h"
+
+/* Tab stubs: without separate outputs, only the active tab is shown */
+bool
+tab_is_shown(struct cg_tab *tab)
+{
+	return tab == tab->server->active_tab;
+}
+
+/* View stubs */
+pid_t
+view_get_pid(struct cg_view *view)
+{
+	return view->impl->get_pid ? view->impl->get_pid(view) : 0;
+}
+
+void
+view_set_suspended(struct cg_view *view, bool suspended)
+{
+	if (view->impl->set_suspended) {
+		view->impl->set_suspended(view, suspended);
+	}
+}
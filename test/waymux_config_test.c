@@ -76,6 +76,13 @@ START_TEST(test_load_defaults_no_file)
 	ck_assert_uint_eq(config->show_background_dialog->modifiers, WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT);
 	ck_assert_uint_eq(config->show_background_dialog->keysym, XKB_KEY_b);
 
+	/* And they are compiled for dispatch */
+	ck_assert_int_eq(keybinding_table_lookup(&config->bindings, WLR_MODIFIER_LOGO, XKB_KEY_k)->type,
+			 ACTION_NEXT_TAB);
+	ck_assert_int_eq(keybinding_table_lookup(&config->bindings, WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT, XKB_KEY_b)->type,
+			 ACTION_SHOW_BACKGROUND_DIALOG);
+	ck_assert_ptr_null(keybinding_table_lookup(&config->bindings, 0, XKB_KEY_k));
+
 	waymux_config_free(config);
 }
 END_TEST
@@ -185,6 +192,61 @@ START_TEST(test_load_invalid_keybinding_returns_null)
 }
 END_TEST
 
+START_TEST(test_load_action_bindings)
+{
+	const char *config_content =
+		"[keybindings]\n"
+		"focus_tab_12 = \"Super+A\"\n"
+		"move_tab_left = \"Super+Shift+J\"\n"
+		"next_tab = \"Alt+K\"\n";
+
+	char *path = create_temp_config(config_content);
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+
+	struct waymux_config *config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_ptr_nonnull(config);
+
+	const struct action *action = keybinding_table_lookup(&config->bindings, WLR_MODIFIER_LOGO, XKB_KEY_a);
+	ck_assert_ptr_nonnull(action);
+	ck_assert_int_eq(action->type, ACTION_FOCUS_TAB);
+	ck_assert_int_eq(action->arg, 12);
+
+	action = keybinding_table_lookup(&config->bindings, WLR_MODIFIER_LOGO | WLR_MODIFIER_SHIFT, XKB_KEY_j);
+	ck_assert_ptr_nonnull(action);
+	ck_assert_int_eq(action->type, ACTION_MOVE_TAB);
+	ck_assert_int_eq(action->arg, -1);
+
+	/* Actions with defaults are still parsed as before */
+	ck_assert_int_eq(config->action_binding_count, 2);
+	ck_assert_int_eq(keybinding_table_lookup(&config->bindings, WLR_MODIFIER_ALT, XKB_KEY_k)->type, ACTION_NEXT_TAB);
+
+	waymux_config_free(config);
+}
+END_TEST
+
+START_TEST(test_load_unknown_action_returns_null)
+{
+	const char *configs[] = {
+		"[keybindings]\nfocus_tab_0 = \"Super+A\"\n",
+		"[keybindings]\nfly = \"Super+A\"\n",
+		"[keybindings]\nlast_used_tab = \"Super+InvalidKeyXYZ\"\n",
+		"[keybindings]\nlast_used_tab = 1\n",
+	};
+
+	for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+		char *path = create_temp_config(configs[i]);
+		ck_assert_msg(path != NULL, "Failed to create temp config file");
+
+		struct waymux_config *config = waymux_config_load(path);
+		unlink(path);
+		free(path);
+		ck_assert_msg(config == NULL, "Should return NULL for config %zu", i);
+	}
+}
+END_TEST
+
 START_TEST(test_load_empty_keybindings_section)
 {
 	const char *config_content =
@@ -273,6 +335,235 @@ START_TEST(test_get_default_keybindings)
 }
 END_TEST
 
+START_TEST(test_load_hidden_tabs)
+{
+	/* Defaults: suspend hidden tabs, never stop them */
+	struct waymux_config *config = waymux_config_load("/nonexistent/path/config.toml");
+	ck_assert(config->suspend_hidden_tabs);
+	ck_assert_int_eq(config->stop_background_tabs_after, 0);
+	waymux_config_free(config);
+
+	char *path = create_temp_config("[hidden_tabs]\n"
+					"suspend = false\n"
+					"stop_after = 300\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+
+	ck_assert_msg(config != NULL, "Failed to load config");
+	ck_assert(!config->suspend_hidden_tabs);
+	ck_assert_int_eq(config->stop_background_tabs_after, 300);
+	waymux_config_free(config);
+}
+END_TEST
+
+START_TEST(test_load_invalid_hidden_tabs_returns_null)
+{
+	char *path = create_temp_config("[hidden_tabs]\n"
+					"stop_after = -5\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	struct waymux_config *config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config == NULL, "Should return NULL for a negative stop_after");
+
+	path = create_temp_config("[hidden_tabs]\n"
+				  "suspend = \"yes\"\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config == NULL, "Should return NULL for a non-boolean suspend");
+}
+END_TEST
+
+START_TEST(test_load_output)
+{
+	/* Default: composite every frame */
+	struct waymux_config *config = waymux_config_load("/nonexistent/path/config.toml");
+	ck_assert(!config->output_passthrough);
+	waymux_config_free(config);
+
+	char *path = create_temp_config("[output]\n"
+					"passthrough = true\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+
+	ck_assert_msg(config != NULL, "Failed to load config");
+	ck_assert(config->output_passthrough);
+	waymux_config_free(config);
+
+	path = create_temp_config("[output]\n"
+				  "passthrough = 1\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config == NULL, "Should return NULL for a non-boolean passthrough");
+}
+END_TEST
+
+START_TEST(test_load_output_render_time)
+{
+	/* Default: render as soon as a frame is shown */
+	struct waymux_config *config = waymux_config_load("/nonexistent/path/config.toml");
+	ck_assert_int_eq(config->max_render_time, 0);
+	ck_assert_int_eq(config->active_tab_render_time, 0);
+	waymux_config_free(config);
+
+	char *path = create_temp_config("[output]\n"
+					"max_render_time = 4\n"
+					"active_tab_render_time = 6\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+
+	ck_assert_msg(config != NULL, "Failed to load config");
+	ck_assert_int_eq(config->max_render_time, 4);
+	ck_assert_int_eq(config->active_tab_render_time, 6);
+
+	/* A change is an output change */
+	struct waymux_config *defaults = waymux_config_load("/nonexistent/path/config.toml");
+	ck_assert_uint_eq(waymux_config_diff(defaults, config), WAYMUX_CONFIG_CHANGED_OUTPUT);
+	waymux_config_free(defaults);
+	waymux_config_free(config);
+
+	path = create_temp_config("[output]\n"
+				  "max_render_time = 500\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config == NULL, "Should return NULL for a render time over 100 ms");
+
+	path = create_temp_config("[output]\n"
+				  "active_tab_render_time = -1\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config == NULL, "Should return NULL for a negative render time");
+}
+END_TEST
+
+START_TEST(test_load_tab_bar)
+{
+	/* Default: the cairo renderer */
+	struct waymux_config *config = waymux_config_load("/nonexistent/path/config.toml");
+	ck_assert_int_eq(config->tab_bar_renderer, WAYMUX_TAB_BAR_RENDERER_CAIRO);
+	waymux_config_free(config);
+
+	char *path = create_temp_config("[tab_bar]\n"
+					"renderer = \"scene\"\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+
+	ck_assert_msg(config != NULL, "Failed to load config");
+	ck_assert_int_eq(config->tab_bar_renderer, WAYMUX_TAB_BAR_RENDERER_SCENE);
+	waymux_config_free(config);
+
+	path = create_temp_config("[tab_bar]\n"
+				  "renderer = \"gpu\"\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config == NULL, "Should return NULL for an unknown renderer");
+}
+END_TEST
+
+START_TEST(test_load_xwayland)
+{
+	/* Default: started by the first X client, kept running */
+	struct waymux_config *config = waymux_config_load("/nonexistent/path/config.toml");
+	ck_assert_int_eq(config->xwayland_mode, WAYMUX_XWAYLAND_LAZY);
+	waymux_config_free(config);
+
+	char *path = create_temp_config("[xwayland]\n"
+					"mode = \"on_demand\"\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config != NULL, "Failed to load config");
+	ck_assert_int_eq(config->xwayland_mode, WAYMUX_XWAYLAND_ON_DEMAND);
+	waymux_config_free(config);
+
+	path = create_temp_config("[xwayland]\n"
+				  "mode = \"disabled\"\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config != NULL, "Failed to load config");
+	ck_assert_int_eq(config->xwayland_mode, WAYMUX_XWAYLAND_DISABLED);
+	waymux_config_free(config);
+
+	path = create_temp_config("[xwayland]\n"
+				  "mode = false\n");
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config == NULL, "Should return NULL for an invalid mode");
+}
+END_TEST
+
+/* Load a config from the given contents */
+static struct waymux_config *
+load_config(const char *contents)
+{
+	char *path = create_temp_config(contents);
+	ck_assert_msg(path != NULL, "Failed to create temp config file");
+	struct waymux_config *config = waymux_config_load(path);
+	unlink(path);
+	free(path);
+	ck_assert_msg(config != NULL, "Failed to load config");
+	return config;
+}
+
+START_TEST(test_diff)
+{
+	struct waymux_config *defaults = waymux_config_load("/nonexistent/path/config.toml");
+
+	/* The same settings, however they're written */
+	struct waymux_config *config = load_config("[keybindings]\n"
+						   "next_tab = \"Super+K\"\n"
+						   "[hidden_tabs]\n"
+						   "suspend = true\n");
+	ck_assert_uint_eq(waymux_config_diff(defaults, config), 0);
+	waymux_config_free(config);
+
+	config = load_config("[keybindings]\n"
+			     "focus_tab_1 = \"Super+A\"\n");
+	ck_assert_uint_eq(waymux_config_diff(defaults, config), WAYMUX_CONFIG_CHANGED_KEYBINDINGS);
+	waymux_config_free(config);
+
+	config = load_config("[hidden_tabs]\n"
+			     "stop_after = 60\n"
+			     "[tab_bar]\n"
+			     "renderer = \"scene\"\n");
+	ck_assert_uint_eq(waymux_config_diff(defaults, config),
+			  WAYMUX_CONFIG_CHANGED_HIDDEN_TABS | WAYMUX_CONFIG_CHANGED_TAB_BAR);
+	ck_assert_uint_eq(waymux_config_diff(config, defaults),
+			  WAYMUX_CONFIG_CHANGED_HIDDEN_TABS | WAYMUX_CONFIG_CHANGED_TAB_BAR);
+	waymux_config_free(config);
+
+	config = load_config("[output]\n"
+			     "passthrough = true\n");
+	ck_assert_uint_eq(waymux_config_diff(defaults, config), WAYMUX_CONFIG_CHANGED_OUTPUT);
+	waymux_config_free(config);
+
+	waymux_config_free(defaults);
+}
+END_TEST
+
 Suite *
 waymux_config_suite(void)
 {
@@ -283,10 +574,22 @@ waymux_config_suite(void)
 	tcase_add_test(tcase_load, test_load_valid_config);
 	tcase_add_test(tcase_load, test_load_partial_config_uses_defaults);
 	tcase_add_test(tcase_load, test_load_invalid_keybinding_returns_null);
+	tcase_add_test(tcase_load, test_load_action_bindings);
+	tcase_add_test(tcase_load, test_load_unknown_action_returns_null);
 	tcase_add_test(tcase_load, test_load_empty_keybindings_section);
 	tcase_add_test(tcase_load, test_load_no_keybindings_section);
+	tcase_add_test(tcase_load, test_load_hidden_tabs);
+	tcase_add_test(tcase_load, test_load_invalid_hidden_tabs_returns_null);
+	tcase_add_test(tcase_load, test_load_output);
+	tcase_add_test(tcase_load, test_load_output_render_time);
+	tcase_add_test(tcase_load, test_load_tab_bar);
+	tcase_add_test(tcase_load, test_load_xwayland);
 	suite_add_tcase(suite, tcase_load);
 
+	TCase *tcase_diff = tcase_create("diff");
+	tcase_add_test(tcase_diff, test_diff);
+	suite_add_tcase(suite, tcase_diff);
+
 	TCase *tcase_defaults = tcase_create("defaults");
 	tcase_add_test(tcase_defaults, test_get_default_keybindings);
 	suite_add_tcase(suite, tcase_defaults);
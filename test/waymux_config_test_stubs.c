@@ -0,0 +1,108 @@
+/*
+ * Stubs for configuration testing
+ *
+ * These stubs allow the configuration to be tested without the full
+ * WayMux server implementation, which the actions it binds would run.
+ */
+
+#include "config.h"
+
+#include "background_dialog.h"
+#include "launcher.h"
+#include "tab.h"
+#include "tab_switcher.h"
+#if WAYMUX_HAS_STATS
+#include "stats_hud.h"
+#endif
+
+/* Tab stubs */
+struct cg_tab *
+tab_at(struct cg_server *server, int index)
+{
+	(void)server;
+	(void)index;
+	return NULL;
+}
+
+struct cg_tab *
+tab_foreground_at(struct cg_server *server, int index)
+{
+	(void)server;
+	(void)index;
+	return NULL;
+}
+
+struct cg_tab *
+tab_next(struct cg_tab *current)
+{
+	return current;
+}
+
+struct cg_tab *
+tab_prev(struct cg_tab *current)
+{
+	return current;
+}
+
+struct cg_tab *
+tab_last_used(struct cg_server *server)
+{
+	(void)server;
+	return NULL;
+}
+
+bool
+tab_move(struct cg_tab *tab, int offset)
+{
+	(void)tab;
+	(void)offset;
+	return false;
+}
+
+void
+tab_activate(struct cg_tab *tab)
+{
+	(void)tab;
+}
+
+void
+tab_set_background(struct cg_tab *tab, bool background)
+{
+	(void)tab;
+	(void)background;
+}
+
+void
+tab_destroy(struct cg_tab *tab)
+{
+	(void)tab;
+}
+
+/* Overlay stubs */
+void
+launcher_toggle(struct cg_launcher *launcher)
+{
+	(void)launcher;
+}
+
+void
+background_dialog_toggle(struct cg_background_dialog *dialog)
+{
+	(void)dialog;
+}
+
+bool
+tab_switcher_step(struct cg_tab_switcher *switcher, int delta)
+{
+	(void)switcher;
+	(void)delta;
+	return false;
+}
+
+#if WAYMUX_HAS_STATS
+void
+stats_hud_toggle(struct cg_stats_hud *hud)
+{
+	(void)hud;
+}
+#endif
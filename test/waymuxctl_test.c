@@ -2,16 +2,23 @@
  * Unit tests for waymuxctl client
  */
 
+/* For flock() */
+#define _DEFAULT_SOURCE
+
 #include <check.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <signal.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 /* Mock server socket for testing */
@@ -129,6 +136,264 @@ START_TEST(test_socket_path_format)
 }
 END_TEST
 
+/*
+ * Fan-out tests run the waymuxctl binary, given by the WAYMUXCTL
+ * environment variable, against a registry of mock instances: "one" and
+ * "two" answer, "slow" accepts connections but never answers, and "stale"
+ * is in the index but not running.
+ */
+static char runtime_dir[256];
+static pid_t mock_pid = -1;
+static int lock_fds[3] = {-1, -1, -1};
+
+static const char *const mock_names[] = {"one", "two", "slow"};
+
+static int
+listen_at(const char *name)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/waymux/%s.sock", runtime_dir, name);
+	ck_assert_int_lt(len, (int)sizeof(addr.sun_path));
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	ck_assert_int_ne(fd, -1);
+	ck_assert_int_eq(bind(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	ck_assert_int_eq(listen(fd, 5), 0);
+	return fd;
+}
+
+/* Answer one command per connection, with the instance's name in it */
+static void
+serve(int one_fd, int two_fd)
+{
+	for (;;) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(one_fd, &fds);
+		FD_SET(two_fd, &fds);
+		if (select((one_fd > two_fd ? one_fd : two_fd) + 1, &fds, NULL, NULL, NULL) < 0) {
+			_exit(1);
+		}
+		int listen_fd = FD_ISSET(one_fd, &fds) ? one_fd : two_fd;
+		const char *name = listen_fd == one_fd ? "one" : "two";
+
+		int client_fd = accept(listen_fd, NULL, NULL);
+		if (client_fd < 0) {
+			continue;
+		}
+		char command[256];
+		size_t len = 0;
+		ssize_t n;
+		while (len < sizeof(command) - 1 &&
+		       (n = recv(client_fd, command + len, sizeof(command) - 1 - len, 0)) > 0) {
+			len += n;
+			if (command[len - 1] == '\n') {
+				break;
+			}
+		}
+		command[len] = '\0';
+
+		char reply[512];
+		if (strncmp(command, "--json ", 7) == 0) {
+			snprintf(reply, sizeof(reply), "{\"ok\":true,\"tabs\":[{\"app_id\":\"%s\"}]}\n", name);
+		} else if (strcmp(command, "focus-tab 9\n") == 0 && listen_fd == two_fd) {
+			snprintf(reply, sizeof(reply), "ERROR Invalid tab index\n");
+		} else if (strncmp(command, "focus-tab", 9) == 0) {
+			snprintf(reply, sizeof(reply), "OK\n");
+		} else {
+			snprintf(reply, sizeof(reply), "OK 2\n0: id:1 [foot] %s\n1: id:2 [emacs] %s\n", name, name);
+		}
+		send(client_fd, reply, strlen(reply), MSG_NOSIGNAL);
+		close(client_fd);
+	}
+}
+
+static void
+write_file(const char *path, const char *contents)
+{
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+static void
+setup_registry(void)
+{
+	const char *base = getenv("TMPDIR");
+	snprintf(runtime_dir, sizeof(runtime_dir), "%s/waymuxctl_test_XXXXXX", base ? base : "/tmp");
+	ck_assert_ptr_nonnull(mkdtemp(runtime_dir));
+	setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+	unsetenv("WAYMUX_INSTANCE");
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/waymux", runtime_dir);
+	ck_assert_int_eq(mkdir(path, 0700), 0);
+	snprintf(path, sizeof(path), "%s/waymux/registry", runtime_dir);
+	ck_assert_int_eq(mkdir(path, 0700), 0);
+	snprintf(path, sizeof(path), "%s/waymux/registry/instances", runtime_dir);
+	ck_assert_int_eq(mkdir(path, 0700), 0);
+
+	snprintf(path, sizeof(path), "%s/waymux/registry/index", runtime_dir);
+	write_file(path, "one\t100\t\nstale\t101\t\ntwo\t102\twork\nslow\t103\t\n");
+
+	/* Running instances hold their lock */
+	for (int i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), "%s/waymux/registry/instances/%s.lock", runtime_dir, mock_names[i]);
+		lock_fds[i] = open(path, O_RDWR | O_CREAT, 0600);
+		ck_assert_int_ne(lock_fds[i], -1);
+		ck_assert_int_eq(flock(lock_fds[i], LOCK_EX | LOCK_NB), 0);
+	}
+	snprintf(path, sizeof(path), "%s/waymux/registry/instances/stale.lock", runtime_dir);
+	write_file(path, "");
+
+	int one_fd = listen_at("one");
+	int two_fd = listen_at("two");
+	/* Never accepted, so connections wait in its backlog */
+	listen_at("slow");
+
+	mock_pid = fork();
+	ck_assert_int_ne(mock_pid, -1);
+	if (mock_pid == 0) {
+		serve(one_fd, two_fd);
+	}
+	close(one_fd);
+	close(two_fd);
+}
+
+static void
+teardown_registry(void)
+{
+	if (mock_pid > 0) {
+		kill(mock_pid, SIGKILL);
+		waitpid(mock_pid, NULL, 0);
+	}
+	for (int i = 0; i < 3; i++) {
+		if (lock_fds[i] >= 0) {
+			close(lock_fds[i]);
+		}
+	}
+
+	char command[PATH_MAX + 16];
+	snprintf(command, sizeof(command), "rm -rf '%s'", runtime_dir);
+	ck_assert_int_eq(system(command), 0);
+}
+
+/* Run waymuxctl with the given arguments, capturing its standard output;
+ * returns its exit status, or -1 if WAYMUXCTL isn't set */
+static int
+run_waymuxctl(const char *args, char *output, size_t size)
+{
+	const char *waymuxctl = getenv("WAYMUXCTL");
+	if (!waymuxctl) {
+		return -1;
+	}
+
+	char command[PATH_MAX + 256];
+	snprintf(command, sizeof(command), "'%s' %s", waymuxctl, args);
+	FILE *f = popen(command, "r");
+	ck_assert_ptr_nonnull(f);
+	size_t len = fread(output, 1, size - 1, f);
+	output[len] = '\0';
+
+	int status = pclose(f);
+	ck_assert(WIFEXITED(status));
+	return WEXITSTATUS(status);
+}
+
+static double
+now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Test: every running instance answers, tagged, in registry order; the
+ * slow one times out without holding up the others for long */
+START_TEST(test_all_list_tabs)
+{
+	char output[4096];
+	double start = now_seconds();
+	int status = run_waymuxctl("--all --timeout 300 list-tabs", output, sizeof(output));
+	if (status < 0) {
+		return;
+	}
+	double elapsed = now_seconds() - start;
+
+	/* The slow instance failed */
+	ck_assert_int_eq(status, 1);
+	ck_assert_str_eq(output, "one: 0: id:1 [foot] one\n"
+				 "one: 1: id:2 [emacs] one\n"
+				 "two: 0: id:1 [foot] two\n"
+				 "two: 1: id:2 [emacs] two\n");
+	/* Instances are asked at once, not one after the other */
+	ck_assert(elapsed < 2.0);
+}
+END_TEST
+
+/* Test: JSON responses gain an instance member, and failures are objects
+ * too */
+START_TEST(test_all_json)
+{
+	char output[4096];
+	int status = run_waymuxctl("--all --json -t 300 list-tabs", output, sizeof(output));
+	if (status < 0) {
+		return;
+	}
+
+	ck_assert_int_eq(status, 1);
+	ck_assert_str_eq(output, "{\"instance\":\"one\",\"ok\":true,\"tabs\":[{\"app_id\":\"one\"}]}\n"
+				 "{\"instance\":\"two\",\"ok\":true,\"tabs\":[{\"app_id\":\"two\"}]}\n"
+				 "{\"instance\":\"slow\",\"ok\":false,\"error\":\"Timed out\"}\n");
+}
+END_TEST
+
+/* Test: an error from one instance fails the command, but the others
+ * still run it */
+START_TEST(test_all_error)
+{
+	char output[4096];
+	int status = run_waymuxctl("--all -t 300 focus-tab 9", output, sizeof(output));
+	if (status < 0) {
+		return;
+	}
+
+	ck_assert_int_eq(status, 1);
+	ck_assert_str_eq(output, "");
+}
+END_TEST
+
+/* Test: commands that don't end with one response aren't fanned out */
+START_TEST(test_all_rejected)
+{
+	char output[4096];
+	if (run_waymuxctl("--all subscribe 2>/dev/null", output, sizeof(output)) < 0) {
+		return;
+	}
+	ck_assert_int_eq(run_waymuxctl("--all batch </dev/null 2>/dev/null", output, sizeof(output)), 1);
+	ck_assert_int_eq(run_waymuxctl("--all instances 2>/dev/null", output, sizeof(output)), 1);
+	ck_assert_int_eq(run_waymuxctl("--all -i one list-tabs 2>/dev/null", output, sizeof(output)), 1);
+	ck_assert_int_eq(run_waymuxctl("--all -t 0 list-tabs 2>/dev/null", output, sizeof(output)), 1);
+}
+END_TEST
+
+/* Test: instances lists the running instances only */
+START_TEST(test_instances)
+{
+	char output[4096];
+	if (run_waymuxctl("instances", output, sizeof(output)) < 0) {
+		return;
+	}
+	ck_assert_str_eq(output, "Running instances:\n"
+				 "  one [pid: 100]\n"
+				 "  two (profile: work) [pid: 102]\n"
+				 "  slow [pid: 103]\n");
+}
+END_TEST
+
 Suite *
 waymuxctl_suite(void)
 {
@@ -140,6 +405,15 @@ waymuxctl_suite(void)
 	tcase_add_test(tc_core, test_socket_path_format);
 	suite_add_tcase(s, tc_core);
 
+	TCase *tc_all = tcase_create("All");
+	tcase_add_checked_fixture(tc_all, setup_registry, teardown_registry);
+	tcase_add_test(tc_all, test_all_list_tabs);
+	tcase_add_test(tc_all, test_all_json);
+	tcase_add_test(tc_all, test_all_error);
+	tcase_add_test(tc_all, test_all_rejected);
+	tcase_add_test(tc_all, test_instances);
+	suite_add_tcase(s, tc_all);
+
 	return s;
 }
 
@@ -0,0 +1,162 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "thumbnail.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wlr/render/allocator.h>
+#include <wlr/render/pass.h>
+#include <wlr/render/swapchain.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+
+#include "output.h"
+#include "server.h"
+#include "trace.h"
+#include "view.h"
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+handle_commit(struct wl_listener *listener, void *data)
+{
+	struct cg_thumbnail *thumbnail = wl_container_of(listener, thumbnail, commit);
+	thumbnail->stale = true;
+}
+
+static struct cg_thumbnail *
+thumbnail_create(struct cg_view *view)
+{
+	struct cg_thumbnail *thumbnail = calloc(1, sizeof(*thumbnail));
+	if (!thumbnail) {
+		wlr_log(WLR_ERROR, "Failed to allocate thumbnail");
+		return NULL;
+	}
+
+	thumbnail->view = view;
+	thumbnail->stale = true;
+	thumbnail->commit.notify = handle_commit;
+	wl_signal_add(&view->wlr_surface->events.commit, &thumbnail->commit);
+	return thumbnail;
+}
+
+/* The format outputs render in, which the renderer can render to */
+static const struct wlr_drm_format *
+render_format(struct cg_server *server)
+{
+	struct cg_output *output = output_focused(server);
+	if (!output || !output->wlr_output->swapchain) {
+		return NULL;
+	}
+	return &output->wlr_output->swapchain->format;
+}
+
+/* Downscale the view's texture into a new buffer of width x height pixels */
+static struct wlr_buffer *
+capture(struct cg_server *server, struct wlr_texture *texture, int width, int height)
+{
+	TRACE_SCOPE("thumbnail_capture");
+
+	const struct wlr_drm_format *format = render_format(server);
+	if (!format) {
+		return NULL;
+	}
+	struct wlr_buffer *buffer = wlr_allocator_create_buffer(server->allocator, width, height, format);
+	if (!buffer) {
+		wlr_log(WLR_ERROR, "Failed to allocate a %dx%d thumbnail", width, height);
+		return NULL;
+	}
+
+	struct wlr_render_pass *pass = wlr_renderer_begin_buffer_pass(server->renderer, buffer, NULL);
+	if (!pass) {
+		wlr_buffer_drop(buffer);
+		return NULL;
+	}
+	wlr_render_pass_add_texture(pass, &(struct wlr_render_texture_options){
+		.texture = texture,
+		.dst_box = {.width = width, .height = height},
+		.filter_mode = WLR_SCALE_FILTER_BILINEAR,
+		.blend_mode = WLR_RENDER_BLEND_MODE_NONE,
+	});
+	if (!wlr_render_pass_submit(pass)) {
+		wlr_buffer_drop(buffer);
+		return NULL;
+	}
+	return buffer;
+}
+
+struct wlr_buffer *
+thumbnail_get(struct cg_view *view, int max_width, int max_height, float scale, int *width, int *height)
+{
+	if (!view->wlr_surface) {
+		return NULL;
+	}
+	if (!view->thumbnail) {
+		view->thumbnail = thumbnail_create(view);
+		if (!view->thumbnail) {
+			return NULL;
+		}
+	}
+	struct cg_thumbnail *thumbnail = view->thumbnail;
+
+	uint64_t now = now_ns();
+	bool due = !thumbnail->buffer || now - thumbnail->captured_ns >= THUMBNAIL_INTERVAL_MS * 1000000ULL;
+	if ((thumbnail->stale || thumbnail->scale != scale) && due) {
+		struct wlr_texture *texture = wlr_surface_get_texture(view->wlr_surface);
+		if (texture && texture->width > 0 && texture->height > 0) {
+			/* Fit the view in the box, keeping its aspect ratio;
+			 * thumbnails are never scaled up */
+			double fit = fmin((double)max_width / texture->width, (double)max_height / texture->height);
+			fit = fmin(fit, 1.0 / scale);
+			int w = (int)fmax(1, round(texture->width * fit));
+			int h = (int)fmax(1, round(texture->height * fit));
+
+			struct wlr_buffer *buffer =
+				capture(view->server, texture, (int)ceil(w * scale), (int)ceil(h * scale));
+			if (buffer) {
+				wlr_buffer_drop(thumbnail->buffer);
+				thumbnail->buffer = buffer;
+				thumbnail->width = w;
+				thumbnail->height = h;
+				thumbnail->scale = scale;
+			}
+		}
+		/* Failures aren't retried until the next commit either */
+		thumbnail->stale = false;
+		thumbnail->captured_ns = now;
+	}
+
+	*width = thumbnail->width;
+	*height = thumbnail->height;
+	return thumbnail->buffer;
+}
+
+void
+thumbnail_destroy(struct cg_thumbnail *thumbnail)
+{
+	if (!thumbnail) {
+		return;
+	}
+
+	wl_list_remove(&thumbnail->commit.link);
+	wlr_buffer_drop(thumbnail->buffer);
+	free(thumbnail);
+}
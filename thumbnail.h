@@ -0,0 +1,52 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_THUMBNAIL_H
+#define CG_THUMBNAIL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+struct cg_view;
+struct wlr_buffer;
+
+/* Thumbnails are recaptured at most this often, however often the view
+ * commits */
+#define THUMBNAIL_INTERVAL_MS 1000
+
+/*
+ * A small copy of a view's last committed buffer, for the background
+ * dialog. It is downscaled by the renderer once per capture, and kept
+ * until the view commits again, so showing it costs no more than any other
+ * small buffer. Owned by the view, and destroyed when it unmaps.
+ */
+struct cg_thumbnail {
+	struct cg_view *view;
+	struct wlr_buffer *buffer;  /* NULL until captured */
+	int width, height;          /* Logical size */
+	float scale;                /* Buffer pixels per logical pixel */
+	uint64_t captured_ns;
+	bool stale;                 /* The view committed since the capture */
+
+	struct wl_listener commit;
+};
+
+/**
+ * The view's thumbnail, fitting max_width x max_height logical pixels at
+ * the given scale, recapturing it first if the view committed since and
+ * no capture was made in the last THUMBNAIL_INTERVAL_MS. Sets its logical
+ * size. The buffer belongs to the thumbnail; returns NULL if there is
+ * nothing to show.
+ */
+struct wlr_buffer *thumbnail_get(struct cg_view *view, int max_width, int max_height, float scale, int *width,
+				 int *height);
+
+void thumbnail_destroy(struct cg_thumbnail *thumbnail);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+
+#include "trace.h"
+
+/* Large enough that the compositor thread rarely waits on a write */
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+/* Spans come from the compositor thread and the desktop entry loader */
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool trace_enabled;
+static FILE *trace_file;
+static int trace_pid;
+
+static atomic_int next_tid = 1;
+static _Thread_local int thread_tid;
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+bool
+trace_init(const char *path)
+{
+	if (!path || path[0] == '\0') {
+		return true;
+	}
+
+	FILE *file = fopen(path, "w");
+	if (!file) {
+		wlr_log_errno(WLR_ERROR, "Failed to open trace file %s", path);
+		return false;
+	}
+	setvbuf(file, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+	pthread_mutex_lock(&trace_lock);
+	trace_file = file;
+	trace_pid = (int)getpid();
+	fputs("[\n", trace_file);
+	pthread_mutex_unlock(&trace_lock);
+
+	atomic_store(&trace_enabled, true);
+	wlr_log(WLR_INFO, "Writing trace to %s", path);
+	return true;
+}
+
+void
+trace_finish(void)
+{
+	if (!atomic_exchange(&trace_enabled, false)) {
+		return;
+	}
+
+	pthread_mutex_lock(&trace_lock);
+	/* The last event has no trailing comma, so the file is valid JSON */
+	fprintf(trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"waymux\"}}\n]\n",
+		trace_pid);
+	fclose(trace_file);
+	trace_file = NULL;
+	pthread_mutex_unlock(&trace_lock);
+}
+
+struct trace_span
+trace_span_begin(const char *name)
+{
+	if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed)) {
+		return (struct trace_span){0};
+	}
+	return (struct trace_span){.name = name, .start_ns = now_ns()};
+}
+
+void
+trace_span_end(struct trace_span *span)
+{
+	if (!span->name) {
+		return;
+	}
+
+	uint64_t end = now_ns();
+	if (thread_tid == 0) {
+		thread_tid = atomic_fetch_add(&next_tid, 1);
+	}
+
+	pthread_mutex_lock(&trace_lock);
+	if (trace_file) {
+		fprintf(trace_file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d},\n",
+			span->name, (double)span->start_ns / 1000.0, (double)(end - span->start_ns) / 1000.0,
+			trace_pid, thread_tid);
+	}
+	pthread_mutex_unlock(&trace_lock);
+}
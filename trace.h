@@ -0,0 +1,59 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_TRACE_H
+#define CG_TRACE_H
+
+#include "config.h"
+
+/*
+ * Scoped trace spans, written as Chrome trace event JSON, which Perfetto
+ * (ui.perfetto.dev) opens directly and Tracy imports with
+ * tracy-import-chrome. Only built with -Dtracing=enabled, and only
+ * recorded when WAYMUX_TRACE names the file to write. Without -Dtracing,
+ * TRACE_SCOPE() compiles to nothing.
+ *
+ * TRACE_SCOPE(name) starts a span that ends when the enclosing block is
+ * left, however it is left. name must be a string literal or otherwise
+ * outlive the trace.
+ */
+
+#if WAYMUX_HAS_TRACING
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct trace_span {
+	const char *name; /* NULL when not tracing */
+	uint64_t start_ns;
+};
+
+/* Start writing spans to path. Returns false if it can't be opened. */
+bool trace_init(const char *path);
+
+/* Finish the trace file; spans after this are not recorded */
+void trace_finish(void);
+
+struct trace_span trace_span_begin(const char *name);
+void trace_span_end(struct trace_span *span);
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)                                                                                            \
+	__attribute__((cleanup(trace_span_end))) struct trace_span TRACE_CONCAT(trace_span_, __LINE__) =           \
+		trace_span_begin(name)
+
+#else
+
+#define TRACE_SCOPE(name)                                                                                            \
+	do {                                                                                                         \
+	} while (0)
+
+#endif
+
+#endif
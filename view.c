@@ -10,7 +10,9 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <assert.h>
+#include <ctype.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wayland-server-core.h>
@@ -19,36 +21,127 @@
 #include <wlr/types/wlr_scene.h>
 
 #include "output.h"
+#include "profile_launch.h"
+#include "search.h"
 #include "seat.h"
 #include "server.h"
+#include "stats.h"
 #include "tab.h"
 #include "tab_bar.h"
+#include "thumbnail.h"
+#include "trace.h"
 #include "view.h"
 #if WAYMUX_HAS_XWAYLAND
 #include "xwayland.h"
 #endif
 
-char *
-view_get_title(struct cg_view *view)
+pid_t
+view_get_pid(struct cg_view *view)
 {
-	const char *title = view->impl->get_title(view);
-	if (!title) {
-		return NULL;
+	return view->impl->get_pid ? view->impl->get_pid(view) : 0;
+}
+
+void
+view_set_suspended(struct cg_view *view, bool suspended)
+{
+	if (view->impl->set_suspended) {
+		view->impl->set_suspended(view, suspended);
 	}
-	return strdup(title);
 }
 
-char *
+const char *
+view_get_title(struct cg_view *view)
+{
+	return view->title;
+}
+
+const char *
 view_get_app_id(struct cg_view *view)
 {
-	if (!view->impl->get_app_id) {
-		return NULL;
+	return view->app_id;
+}
+
+/* Replace a cached string; returns true if the value changed */
+static bool
+update_cached_string(char **cached, const char *value)
+{
+	if (*cached == value || (*cached && value && strcmp(*cached, value) == 0)) {
+		return false;
+	}
+
+	free(*cached);
+	*cached = value ? strdup(value) : NULL;
+	return true;
+}
+
+/* Searched as one string, with a separator that no query character
+ * matches across */
+static void
+update_search_text(struct cg_view *view)
+{
+	const char *app_id = view->app_id ? view->app_id : "";
+	const char *title = view->title ? view->title : "";
+	size_t len = strlen(app_id) + strlen(title) + 2;
+
+	free(view->search_text);
+	view->search_text = malloc(len);
+	if (!view->search_text) {
+		view->search_mask = 0;
+		return;
 	}
-	const char *app_id = view->impl->get_app_id(view);
-	if (!app_id) {
-		return NULL;
+	snprintf(view->search_text, len, "%s;%s", app_id, title);
+	for (char *p = view->search_text; *p; p++) {
+		*p = tolower((unsigned char)*p);
+	}
+	view->search_mask = search_mask(view->search_text);
+}
+
+/* Called when the client sets its title or app_id. Clients like terminals
+ * and browsers do this many times per second, so the tab bar only
+ * re-renders the one button, once per frame. */
+void
+view_update_title(struct cg_view *view)
+{
+	const char *title = view->impl->get_title(view);
+	const char *app_id = view->impl->get_app_id ? view->impl->get_app_id(view) : NULL;
+
+	bool title_changed = update_cached_string(&view->title, title);
+	bool app_id_changed = update_cached_string(&view->app_id, app_id);
+	if (!title_changed && !app_id_changed) {
+		return;
+	}
+	update_search_text(view);
+
+	if (view->foreign_toplevel_handle) {
+		if (title_changed && view->title) {
+			wlr_foreign_toplevel_handle_v1_set_title(view->foreign_toplevel_handle, view->title);
+		}
+		if (app_id_changed && view->app_id) {
+			wlr_foreign_toplevel_handle_v1_set_app_id(view->foreign_toplevel_handle, view->app_id);
+		}
+	}
+
+	/* Nested outputs show the focused view's title; separate ones that of
+	 * the tab they show */
+	if (title_changed && view->wlr_surface && view->tab && view->tab->output) {
+		if (tab_is_shown(view->tab)) {
+			output_set_window_title(view->tab->output, view->title);
+		}
+	} else if (title_changed && view->wlr_surface && seat_get_focus(view->server->seat) == view) {
+		struct cg_output *output;
+		wl_list_for_each (output, &view->server->outputs, link) {
+			output_set_window_title(output, view->title);
+		}
+	}
+
+	struct cg_tab_bar *tab_bar = view->tab ? tab_get_tab_bar(view->tab) : NULL;
+	if (tab_bar) {
+		tab_bar_tab_changed(tab_bar, view->tab);
+	}
+	/* The initial title is announced by view_map() */
+	if (view->tab && view->foreign_toplevel_handle) {
+		wl_signal_emit_mutable(&view->server->events.tab_title, view->tab);
 	}
-	return strdup(app_id);
 }
 
 bool
@@ -89,16 +182,29 @@ view_maximize(struct cg_view *view, struct wlr_box *layout_box)
 	int height = layout_box->height;
 
 	/* Reserve space for tab bar if it exists */
-	if (view->server->tab_bar && view->server->tab_bar->scene_tree->node.enabled) {
+	struct cg_tab_bar *tab_bar = view->tab ? tab_get_tab_bar(view->tab) : view->server->tab_bar;
+	if (tab_bar && tab_bar->scene_tree->node.enabled) {
 		/* Tab bar is at the top, so offset view y and reduce height */
-		view->ly += view->server->tab_bar->height;
-		height -= view->server->tab_bar->height;
+		view->ly += tab_bar->height;
+		height -= tab_bar->height;
 	}
 
 	if (view->scene_tree) {
 		wlr_scene_node_set_position(&view->scene_tree->node, view->lx, view->ly);
 	}
 
+	struct wlr_box box = {.x = view->lx, .y = view->ly, .width = width, .height = height};
+	if (wlr_box_equal(&box, &view->configured_box)) {
+		return;
+	}
+
+	/* A tab that isn't shown gets the new size when it is activated,
+	 * rather than reflowing for every layout change while hidden */
+	if (view->tab && !tab_is_shown(view->tab)) {
+		return;
+	}
+
+	view->configured_box = box;
 	view->impl->maximize(view, width, height);
 }
 
@@ -108,8 +214,8 @@ view_center(struct cg_view *view, struct wlr_box *layout_box)
 	int width, height;
 	view->impl->get_geometry(view, &width, &height);
 
-	view->lx = (layout_box->width - width) / 2;
-	view->ly = (layout_box->height - height) / 2;
+	view->lx = layout_box->x + (layout_box->width - width) / 2;
+	view->ly = layout_box->y + (layout_box->height - height) / 2;
 
 	if (view->scene_tree) {
 		wlr_scene_node_set_position(&view->scene_tree->node, view->lx, view->ly);
@@ -119,8 +225,15 @@ view_center(struct cg_view *view, struct wlr_box *layout_box)
 void
 view_position(struct cg_view *view)
 {
-	struct wlr_box layout_box;
-	wlr_output_layout_get_box(view->server->output_layout, NULL, &layout_box);
+	/* A view fills its tab's output, or else the whole layout */
+	struct wlr_box layout_box = {0};
+	struct cg_output *output = view->tab ? view->tab->output : NULL;
+	if (output) {
+		wlr_output_layout_get_box(view->server->output_layout, output->wlr_output, &layout_box);
+	}
+	if (wlr_box_empty(&layout_box)) {
+		wlr_output_layout_get_box(view->server->output_layout, NULL, &layout_box);
+	}
 
 	if (view_is_primary(view) || view_extends_output_layout(view, &layout_box)) {
 		view_maximize(view, &layout_box);
@@ -149,21 +262,28 @@ view_unmap(struct cg_view *view)
 	view->foreign_toplevel_handle = NULL;
 
 	wlr_scene_node_destroy(&view->scene_tree->node);
+	thumbnail_destroy(view->thumbnail);
+	view->thumbnail = NULL;
 
 	view->wlr_surface->data = NULL;
 	view->wlr_surface = NULL;
+	view->configured_box = (struct wlr_box){0};
 
 	/* Clean up the associated tab using the direct pointer */
 	struct cg_tab *tab = view->tab;
 	if (tab) {
-		/* Check if this was the active tab */
+		/* Check if this was the active tab, or another output's */
 		bool was_active = (view->server->active_tab == tab);
+		bool was_shown = tab_is_shown(tab);
+		struct cg_output *output = tab->output;
+		struct cg_tab_bar *tab_bar = tab_get_tab_bar(tab);
 		bool already_removed = (tab->view == NULL); /* Tab was already destroyed via tab_destroy */
 
 		/* Destroy the tab (without closing the view again) */
 		if (!already_removed) {
+			wl_signal_emit_mutable(&view->server->events.tab_unmap, tab);
 			/* Tab is still in the list, remove it */
-			wl_list_remove(&tab->link);
+			tab_remove(tab);
 		}
 		if (was_active) {
 			view->server->active_tab = NULL;
@@ -171,23 +291,23 @@ view_unmap(struct cg_view *view)
 		if (tab->scene_tree) {
 			wlr_scene_node_destroy(&tab->scene_tree->node);
 		}
+		free(tab->title);
 		free(tab);
 
-		/* If we closed the active tab, activate the previous one (or next) */
-		if (was_active) {
-			struct cg_tab *next_tab = NULL;
-			/* Try to get the previous tab */
-			if (!wl_list_empty(&view->server->tabs)) {
-				next_tab = wl_container_of(view->server->tabs.prev, next_tab, link);
-			}
-			if (next_tab) {
+		/* If we closed the active tab, activate the previous one (or
+		 * next); another output's shown tab is replaced on it */
+		if (was_shown) {
+			struct cg_tab *next_tab = tab_output_last(view->server, output);
+			if (next_tab && was_active) {
 				tab_activate(next_tab);
+			} else if (next_tab) {
+				tab_show(next_tab);
 			}
 		}
 
 		/* Update tab bar to reflect the change */
-		if (view->server->tab_bar) {
-			tab_bar_update(view->server->tab_bar);
+		if (tab_bar) {
+			tab_bar_schedule_update(tab_bar);
 		}
 	}
 
@@ -214,25 +334,38 @@ handle_surface_request_close(struct wl_listener *listener, void *data)
 void
 view_map(struct cg_view *view, struct wlr_surface *surface)
 {
-	/* Create a tab for this view */
-	wlr_log(WLR_DEBUG, "view_map: Creating tab for view %p", (void *)view);
-	struct cg_tab *tab = tab_create(view->server, view);
-	if (!tab) {
-		wlr_log(WLR_ERROR, "Failed to create tab for view");
-		goto fail;
-	}
+	TRACE_SCOPE("view_map");
 
-	wlr_log(WLR_DEBUG, "view_map: Tab %p created for view %p", (void *)tab, (void *)view);
-
-	/* Check if this tab should be a background tab (from profile) */
+	pid_t pid = view_get_pid(view);
 	bool should_be_background = false;
-	if (view->server->pending_background_tabs > 0) {
-		should_be_background = true;
-		view->server->pending_background_tabs--;
-		wlr_log(WLR_DEBUG, "Marking tab as background (pending: %d)",
-			view->server->pending_background_tabs);
+	bool should_activate = true;
+
+	/* A lazy profile tab's view takes over its placeholder tab, keeping
+	 * its place and state */
+	struct cg_tab *tab = profile_launch_claim_placeholder(view->server, pid);
+	if (tab) {
+		wlr_log(WLR_DEBUG, "view_map: View %p takes placeholder tab %u", (void *)view, tab->id);
+		tab->view = view;
+		should_activate = view->server->active_tab == tab || !view->server->active_tab;
+	} else {
+		/* Create a tab for this view */
+		wlr_log(WLR_DEBUG, "view_map: Creating tab for view %p", (void *)view);
+		tab = tab_create(view->server, view);
+		if (!tab) {
+			wlr_log(WLR_ERROR, "Failed to create tab for view");
+			goto fail;
+		}
+
+		/* Profile tabs take their declared place and state, whatever
+		 * order their clients map in */
+		if (profile_launch_claim(tab, pid, &should_be_background, &should_activate) &&
+		    !view->server->active_tab) {
+			should_activate = true;
+		}
 	}
 
+	wlr_log(WLR_DEBUG, "view_map: Tab %p created for view %p", (void *)tab, (void *)view);
+
 	/* Create view's scene tree as a child of tab's scene tree */
 	view->scene_tree = wlr_scene_subsurface_tree_create(tab->scene_tree, surface);
 	if (!view->scene_tree)
@@ -242,6 +375,7 @@ view_map(struct cg_view *view, struct wlr_surface *surface)
 	view->wlr_surface = surface;
 	surface->data = view;
 	view->tab = tab;
+	tab->map_time_ns = stats_now();
 
 #if WAYMUX_HAS_XWAYLAND
 	/* We shouldn't position override-redirect windows. They set
@@ -254,20 +388,34 @@ view_map(struct cg_view *view, struct wlr_surface *surface)
 
 	wl_list_insert(&view->server->views, &view->link);
 
+	view_update_title(view);
+
 	view->foreign_toplevel_handle = wlr_foreign_toplevel_handle_v1_create(view->server->foreign_toplevel_manager);
 	if (!view->foreign_toplevel_handle)
 		goto fail;
 
+	if (view->title)
+		wlr_foreign_toplevel_handle_v1_set_title(view->foreign_toplevel_handle, view->title);
+	if (view->app_id)
+		wlr_foreign_toplevel_handle_v1_set_app_id(view->foreign_toplevel_handle, view->app_id);
+
 	view->request_activate.notify = handle_surface_request_activate;
 	wl_signal_add(&view->foreign_toplevel_handle->events.request_activate, &view->request_activate);
 	view->request_close.notify = handle_surface_request_close;
 	wl_signal_add(&view->foreign_toplevel_handle->events.request_close, &view->request_close);
 
+	wl_signal_emit_mutable(&view->server->events.tab_map, tab);
+
 	/* Set tab as background if needed (before activation) */
 	if (should_be_background) {
 		tab_set_background(tab, true);
 	}
 
+	if (!should_activate) {
+		wlr_log(WLR_DEBUG, "view_map: Tab %p mapped without activation", (void *)tab);
+		return;
+	}
+
 	wlr_log(WLR_DEBUG, "view_map: Activating tab %p for view %p", (void *)tab, (void *)view);
 
 	/* Activate the new tab */
@@ -291,6 +439,9 @@ view_destroy(struct cg_view *view)
 		view_unmap(view);
 	}
 
+	free(view->title);
+	free(view->app_id);
+	free(view->search_text);
 	view->impl->destroy(view);
 
 	/* If there is a previous view in the list, focus that. */
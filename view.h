@@ -4,6 +4,8 @@
 #include "config.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_compositor.h>
 #include <wlr/types/wlr_xdg_shell.h>
@@ -30,12 +32,27 @@ struct cg_view {
 	/* The view has a position in layout coordinates. */
 	int lx, ly;
 
+	/* The box the view was last maximized to, to skip configures that
+	 * wouldn't change anything; empty until the first one */
+	struct wlr_box configured_box;
+
 	enum cg_view_type type;
 	const struct cg_view_impl *impl;
 
 	/* Direct pointer to the associated tab (owned by the tab) */
 	struct cg_tab *tab;
 
+	/* Last known title and app_id, refreshed by view_update_title() */
+	char *title;
+	char *app_id;
+
+	/* Both lowercased, for the background dialog's search (see search.h) */
+	char *search_text;
+	uint64_t search_mask;
+
+	/* A small copy of the contents, captured on demand (see thumbnail.h) */
+	struct cg_thumbnail *thumbnail;
+
 	struct wlr_foreign_toplevel_handle_v1 *foreign_toplevel_handle;
 	struct wl_listener request_activate;
 	struct wl_listener request_close;
@@ -44,6 +61,8 @@ struct cg_view {
 struct cg_view_impl {
 	char *(*get_title)(struct cg_view *view);
 	char *(*get_app_id)(struct cg_view *view);
+	pid_t (*get_pid)(struct cg_view *view);
+	void (*set_suspended)(struct cg_view *view, bool suspended);
 	void (*get_geometry)(struct cg_view *view, int *width_out, int *height_out);
 	bool (*is_primary)(struct cg_view *view);
 	bool (*is_transient_for)(struct cg_view *child, struct cg_view *parent);
@@ -53,8 +72,17 @@ struct cg_view_impl {
 	void (*destroy)(struct cg_view *view);
 };
 
-char *view_get_title(struct cg_view *view);
-char *view_get_app_id(struct cg_view *view);
+/* The process ID of the view's client, or 0 if unknown */
+pid_t view_get_pid(struct cg_view *view);
+
+/* Tell the client whether it can't be seen; not all kinds of views support it */
+void view_set_suspended(struct cg_view *view, bool suspended);
+
+/* The returned strings are owned by the view and replaced on the next
+ * title change */
+const char *view_get_title(struct cg_view *view);
+const char *view_get_app_id(struct cg_view *view);
+void view_update_title(struct cg_view *view);
 bool view_is_primary(struct cg_view *view);
 bool view_is_transient_for(struct cg_view *child, struct cg_view *parent);
 void view_activate(struct cg_view *view, bool activate);
@@ -0,0 +1,306 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/util/log.h>
+
+#include "server.h"
+#include "tab.h"
+#include "view.h"
+#include "visibility.h"
+
+static long
+ms_between(const struct timespec *from, const struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
+
+/* A tab that is hidden from the tab bar as well as not shown */
+static bool
+tab_is_parked(struct cg_tab *tab)
+{
+	return tab->view && tab->is_background && !tab_is_shown(tab);
+}
+
+/* Whether a tab's client may be stopped as far as this tab is concerned.
+ * Otherwise, *remaining_ms is set to when it may be, if it is parked. */
+static bool
+tab_may_stop(struct cg_visibility *visibility, struct cg_tab *tab, const struct timespec *now, long *remaining_ms)
+{
+	*remaining_ms = -1;
+	if (visibility->stop_after_ms == 0 || !tab_is_parked(tab)) {
+		return false;
+	}
+
+	long parked_ms = ms_between(&tab->parked_since, now);
+	if (parked_ms >= visibility->stop_after_ms) {
+		return true;
+	}
+	*remaining_ms = visibility->stop_after_ms - parked_ms;
+	return false;
+}
+
+/* Whether a client can be stopped: it must not be us, and all of its tabs
+ * must allow it */
+static bool
+client_may_stop(struct cg_visibility *visibility, pid_t pid, const struct timespec *now)
+{
+	if (pid <= 0 || pid == getpid()) {
+		return false;
+	}
+
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &visibility->server->tabs, link) {
+		long remaining_ms;
+		if (tab->view && view_get_pid(tab->view) == pid && !tab_may_stop(visibility, tab, now, &remaining_ms)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void
+tab_set_stopped(struct cg_tab *tab, pid_t pid, bool stopped)
+{
+	if (tab->stopped == stopped) {
+		return;
+	}
+	tab->stopped = stopped;
+
+	if (kill(pid, stopped ? SIGSTOP : SIGCONT) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to %s client %d of tab %u", stopped ? "stop" : "continue", (int)pid,
+			      tab->id);
+		return;
+	}
+	wlr_log(WLR_DEBUG, "%s client %d of tab %u", stopped ? "Stopped" : "Continued", (int)pid, tab->id);
+}
+
+static void
+visibility_update(struct cg_visibility *visibility)
+{
+	struct cg_server *server = visibility->server;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (!tab->view) {
+			continue;
+		}
+
+		bool hidden = !tab_is_shown(tab);
+		if (visibility->suspend_hidden && tab->suspended != hidden) {
+			tab->suspended = hidden;
+			view_set_suspended(tab->view, hidden);
+		}
+
+		if (!tab_is_parked(tab)) {
+			tab->parked_since = (struct timespec){0};
+		} else if (tab->parked_since.tv_sec == 0 && tab->parked_since.tv_nsec == 0) {
+			tab->parked_since = now;
+		}
+	}
+
+	long next_ms = -1;
+	wl_list_for_each(tab, &server->tabs, link) {
+		if (!tab->view) {
+			continue;
+		}
+
+		long remaining_ms;
+		tab_may_stop(visibility, tab, &now, &remaining_ms);
+		if (remaining_ms >= 0 && (next_ms < 0 || remaining_ms < next_ms)) {
+			next_ms = remaining_ms;
+		}
+
+		pid_t pid = view_get_pid(tab->view);
+		tab_set_stopped(tab, pid, client_may_stop(visibility, pid, &now));
+	}
+
+	/* Come back when the next parked tab is due */
+	if (visibility->stop_timer) {
+		wl_event_source_timer_update(visibility->stop_timer, next_ms < 0 ? 0 : (int)next_ms + 1);
+	}
+}
+
+static void
+handle_idle(void *data)
+{
+	struct cg_visibility *visibility = data;
+	visibility->idle = NULL;
+	visibility_update(visibility);
+}
+
+static int
+handle_stop_timer(void *data)
+{
+	visibility_update(data);
+	return 0;
+}
+
+static void
+visibility_schedule_update(struct cg_visibility *visibility)
+{
+	if (visibility->idle) {
+		return;
+	}
+	struct wl_event_loop *loop = wl_display_get_event_loop(visibility->server->wl_display);
+	visibility->idle = wl_event_loop_add_idle(loop, handle_idle, visibility);
+}
+
+static void
+handle_tab_map(struct wl_listener *listener, void *data)
+{
+	struct cg_visibility *visibility = wl_container_of(listener, visibility, tab_map);
+	visibility_schedule_update(visibility);
+}
+
+static void
+handle_tab_activate(struct wl_listener *listener, void *data)
+{
+	struct cg_visibility *visibility = wl_container_of(listener, visibility, tab_activate);
+	visibility_schedule_update(visibility);
+}
+
+static void
+handle_tab_background(struct wl_listener *listener, void *data)
+{
+	struct cg_visibility *visibility = wl_container_of(listener, visibility, tab_background);
+	visibility_schedule_update(visibility);
+}
+
+static void
+handle_tab_unmap(struct wl_listener *listener, void *data)
+{
+	struct cg_visibility *visibility = wl_container_of(listener, visibility, tab_unmap);
+	struct cg_tab *tab = data;
+
+	/* A stopped client couldn't handle its tab closing; its other tabs
+	 * are stopped again on the next update if they still qualify */
+	if (tab->stopped && tab->view) {
+		pid_t pid = view_get_pid(tab->view);
+		struct cg_tab *other;
+		wl_list_for_each(other, &visibility->server->tabs, link) {
+			if (other != tab && other->stopped && other->view && view_get_pid(other->view) == pid) {
+				other->stopped = false;
+			}
+		}
+		tab_set_stopped(tab, pid, false);
+	}
+	visibility_schedule_update(visibility);
+}
+
+/* The timer is only needed once background tabs are to be stopped */
+static bool
+ensure_stop_timer(struct cg_visibility *visibility)
+{
+	if (visibility->stop_after_ms == 0 || visibility->stop_timer) {
+		return true;
+	}
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(visibility->server->wl_display);
+	visibility->stop_timer = wl_event_loop_add_timer(loop, handle_stop_timer, visibility);
+	if (!visibility->stop_timer) {
+		wlr_log(WLR_ERROR, "Failed to create timer for stopping background tabs");
+		return false;
+	}
+	return true;
+}
+
+struct cg_visibility *
+visibility_create(struct cg_server *server, bool suspend_hidden, int stop_after_sec)
+{
+	struct cg_visibility *visibility = calloc(1, sizeof(*visibility));
+	if (!visibility) {
+		wlr_log(WLR_ERROR, "Failed to allocate visibility policy");
+		return NULL;
+	}
+	visibility->server = server;
+	visibility->suspend_hidden = suspend_hidden;
+	visibility->stop_after_ms = stop_after_sec * 1000;
+
+	if (!ensure_stop_timer(visibility)) {
+		free(visibility);
+		return NULL;
+	}
+
+	visibility->tab_map.notify = handle_tab_map;
+	wl_signal_add(&server->events.tab_map, &visibility->tab_map);
+	visibility->tab_unmap.notify = handle_tab_unmap;
+	wl_signal_add(&server->events.tab_unmap, &visibility->tab_unmap);
+	visibility->tab_activate.notify = handle_tab_activate;
+	wl_signal_add(&server->events.tab_activate, &visibility->tab_activate);
+	visibility->tab_background.notify = handle_tab_background;
+	wl_signal_add(&server->events.tab_background, &visibility->tab_background);
+
+	wlr_log(WLR_DEBUG, "Visibility policy: %ssuspending hidden tabs, stopping background tabs after %d s",
+		suspend_hidden ? "" : "not ", stop_after_sec);
+	return visibility;
+}
+
+bool
+visibility_configure(struct cg_visibility *visibility, bool suspend_hidden, int stop_after_sec)
+{
+	/* Tabs are no longer suspended once suspending is turned off; the
+	 * next update suspends them again if it's turned back on */
+	if (visibility->suspend_hidden && !suspend_hidden) {
+		struct cg_tab *tab;
+		wl_list_for_each(tab, &visibility->server->tabs, link) {
+			if (tab->suspended && tab->view) {
+				tab->suspended = false;
+				view_set_suspended(tab->view, false);
+			}
+		}
+	}
+
+	visibility->suspend_hidden = suspend_hidden;
+	visibility->stop_after_ms = stop_after_sec * 1000;
+	bool ok = ensure_stop_timer(visibility);
+	if (!ok) {
+		visibility->stop_after_ms = 0;
+	}
+
+	/* Stops clients that now qualify, and continues the others */
+	visibility_schedule_update(visibility);
+
+	wlr_log(WLR_DEBUG, "Visibility policy: %ssuspending hidden tabs, stopping background tabs after %d s",
+		suspend_hidden ? "" : "not ", visibility->stop_after_ms / 1000);
+	return ok;
+}
+
+void
+visibility_destroy(struct cg_visibility *visibility)
+{
+	if (!visibility) {
+		return;
+	}
+
+	struct cg_tab *tab;
+	wl_list_for_each(tab, &visibility->server->tabs, link) {
+		if (tab->stopped && tab->view) {
+			tab_set_stopped(tab, view_get_pid(tab->view), false);
+		}
+	}
+
+	wl_list_remove(&visibility->tab_map.link);
+	wl_list_remove(&visibility->tab_unmap.link);
+	wl_list_remove(&visibility->tab_activate.link);
+	wl_list_remove(&visibility->tab_background.link);
+	if (visibility->idle) {
+		wl_event_source_remove(visibility->idle);
+	}
+	if (visibility->stop_timer) {
+		wl_event_source_remove(visibility->stop_timer);
+	}
+	free(visibility);
+}
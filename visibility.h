@@ -0,0 +1,61 @@
+/*
+ * WayMux: A Wayland multiplexer.
+ *
+ * Copyright (C) 2025 Ido Perlmuter
+ *
+ * See the LICENSE file accompanying this file.
+ */
+
+#ifndef CG_VISIBILITY_H
+#define CG_VISIBILITY_H
+
+#include <stdbool.h>
+#include <wayland-server-core.h>
+
+struct cg_server;
+
+/*
+ * Tells clients when their tabs can't be seen. Every tab but the active
+ * one is marked suspended, which clients take as a hint to stop
+ * rendering. Optionally, the clients of background tabs are also stopped
+ * with SIGSTOP once they have been in the background for a while, and
+ * continued with SIGCONT when one of their tabs comes back or closes. A
+ * client with several tabs is only stopped when all of them qualify.
+ *
+ * The policy is applied from an idle callback, so that the several tab
+ * events of one change (e.g. a tab being mapped, then activated) are
+ * handled together.
+ */
+struct cg_visibility {
+	struct cg_server *server;
+	bool suspend_hidden;
+	int stop_after_ms; /* 0 never stops clients */
+
+	struct wl_event_source *idle;
+	struct wl_event_source *stop_timer;
+
+	struct wl_listener tab_map;
+	struct wl_listener tab_unmap;
+	struct wl_listener tab_activate;
+	struct wl_listener tab_background;
+};
+
+/**
+ * Start applying the visibility policy to the server's tabs.
+ * stop_after_sec is 0 to never stop background clients.
+ */
+struct cg_visibility *visibility_create(struct cg_server *server, bool suspend_hidden, int stop_after_sec);
+
+/**
+ * Change the policy, e.g. on a configuration reload. Clients are stopped
+ * or continued according to the new policy on the next update. Returns
+ * false if background clients can't be stopped after all.
+ */
+bool visibility_configure(struct cg_visibility *visibility, bool suspend_hidden, int stop_after_sec);
+
+/**
+ * Stop applying the policy, continuing every client it stopped. NULL-safe.
+ */
+void visibility_destroy(struct cg_visibility *visibility);
+
+#endif
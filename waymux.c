@@ -42,33 +42,40 @@
 #include <wlr/types/wlr_viewporter.h>
 #include <wlr/types/wlr_virtual_keyboard_v1.h>
 #include <wlr/types/wlr_virtual_pointer_v1.h>
-#if WAYMUX_HAS_XWAYLAND
-#include <wlr/types/wlr_xcursor_manager.h>
-#endif
 #include <wlr/types/wlr_xdg_decoration_v1.h>
 #include <wlr/types/wlr_xdg_output_v1.h>
 #include <wlr/types/wlr_xdg_shell.h>
 #include <wlr/util/log.h>
-#if WAYMUX_HAS_XWAYLAND
-#include <wlr/xwayland.h>
-#endif
 
+#include "config_reload.h"
 #include "control.h"
 #include "desktop_entry.h"
 #include "idle_inhibit_v1.h"
 #include "keybinding.h"
 #include "launcher.h"
+#include "memory_policy.h"
 #include "output.h"
 #include "background_dialog.h"
+#include "pixel_buffer.h"
 #include "profile_selector.h"
 #include "profile.h"
+#include "profile_launch.h"
 #include "registry.h"
+#include "resources.h"
 #include "seat.h"
 #include "server.h"
+#include "spawn_helper.h"
+#include "tab.h"
 #include "tab_bar.h"
+#include "tab_switcher.h"
+#include "trace.h"
 #include "view.h"
+#include "visibility.h"
 #include "waymux_config.h"
 #include "xdg_shell.h"
+#if WAYMUX_HAS_STATS
+#include "stats_hud.h"
+#endif
 #if WAYMUX_HAS_XWAYLAND
 #include "xwayland.h"
 #endif
@@ -258,6 +265,7 @@ usage(FILE *file, const char *waymux)
 		" -i <name> Set instance name (default: default)\n"
 		" -m extend Extend the display across all connected outputs (default)\n"
 		" -m last Use only the last connected output\n"
+		" -m separate Give each output tabs and a tab bar of its own\n"
 		" -P\t Show profile selector on startup\n"
 		" -s\t Allow VT switching\n"
 		" -v\t Show the version number and exit\n"
@@ -302,6 +310,8 @@ parse_args(struct cg_server *server, int argc, char *argv[])
 				server->output_mode = WAYMUX_MULTI_OUTPUT_MODE_LAST;
 			} else if (strcmp(optarg, "extend") == 0) {
 				server->output_mode = WAYMUX_MULTI_OUTPUT_MODE_EXTEND;
+			} else if (strcmp(optarg, "separate") == 0) {
+				server->output_mode = WAYMUX_MULTI_OUTPUT_MODE_SEPARATE;
 			}
 			break;
 		case 'P':
@@ -322,78 +332,11 @@ parse_args(struct cg_server *server, int argc, char *argv[])
 	return true;
 }
 
-static bool
-spawn_profile_tab(struct cg_server *server, struct profile *profile, struct profile_tab *tab)
-{
-	pid_t pid = fork();
-	if (pid == 0) {
-		/* Child process */
-		sigset_t set;
-		sigemptyset(&set);
-		sigprocmask(SIG_SETMASK, &set, NULL);
-
-		/* Set working directory if specified */
-		if (profile->working_dir && chdir(profile->working_dir) != 0) {
-			wlr_log_errno(WLR_ERROR, "Failed to change to working directory: %s",
-				     profile->working_dir);
-			_exit(1);
-		}
-
-		/* Set environment variables from profile */
-		for (int i = 0; i < profile->env_count; i++) {
-			if (setenv(profile->env_vars[i].key, profile->env_vars[i].value, 1) != 0) {
-				wlr_log_errno(WLR_ERROR, "Failed to set environment variable: %s",
-					     profile->env_vars[i].key);
-			}
-		}
-
-		/* Build command arguments */
-		char **argv;
-		int argc = 0;
-
-		/* Count total arguments: proxy_command args + tab command (1) + tab args + NULL */
-		argv = calloc(profile->proxy_argc + 1 + tab->argc + 1, sizeof(char *));
-		if (!argv) {
-			wlr_log_errno(WLR_ERROR, "Failed to allocate argument array");
-			_exit(1);
-		}
-
-		/* Add proxy command arguments if specified */
-		for (int i = 0; i < profile->proxy_argc; i++) {
-			argv[argc++] = profile->proxy_command[i];
-		}
-
-		/* Add tab command */
-		argv[argc++] = tab->command;
-
-		/* Add tab arguments */
-		for (int i = 0; i < tab->argc; i++) {
-			argv[argc++] = tab->args[i];
-		}
-
-		argv[argc] = NULL;
-
-		wlr_log(WLR_INFO, "Spawning profile tab: %s", tab->command);
-		execvp(argv[0], argv);
-
-		/* execvp() returns only on failure */
-		wlr_log_errno(WLR_ERROR, "Failed to spawn profile tab: %s", tab->command);
-		free(argv);
-		_exit(1);
-	} else if (pid == -1) {
-		wlr_log_errno(WLR_ERROR, "Unable to fork for profile tab");
-		return false;
-	}
-
-	wlr_log(WLR_DEBUG, "Profile tab spawned with pid %d", pid);
-	return true;
-}
-
 bool
 spawn_profile_tabs(struct cg_server *server, const char *profile_name)
 {
 	/* Check if profile is already in use by another instance */
-	if (registry_is_profile_locked(profile_name)) {
+	if (!registry_lock_profile(profile_name)) {
 		wlr_log(WLR_ERROR, "Profile '%s' is already in use by another instance", profile_name);
 		fprintf(stderr, "Error: Profile '%s' is already in use by another WayMux instance\n", profile_name);
 		return false;
@@ -407,18 +350,6 @@ spawn_profile_tabs(struct cg_server *server, const char *profile_name)
 
 	wlr_log(WLR_INFO, "Loaded profile '%s' with %d tabs", profile->name, profile->tab_count);
 
-	/* Count background tabs for matching when views appear */
-	server->pending_background_tabs = 0;
-	for (int i = 0; i < profile->tab_count; i++) {
-		if (profile->tabs[i].background) {
-			server->pending_background_tabs++;
-		}
-	}
-
-	if (server->pending_background_tabs > 0) {
-		wlr_log(WLR_DEBUG, "Profile has %d background tabs", server->pending_background_tabs);
-	}
-
 	if (profile->working_dir) {
 		wlr_log(WLR_DEBUG, "Profile working directory: %s", profile->working_dir);
 	}
@@ -440,13 +371,15 @@ spawn_profile_tabs(struct cg_server *server, const char *profile_name)
 		return false;
 	}
 
-	/* Spawn each tab in the profile */
-	for (int i = 0; i < profile->tab_count; i++) {
-		struct profile_tab *tab = &profile->tabs[i];
-		if (!spawn_profile_tab(server, profile, tab)) {
-			wlr_log(WLR_ERROR, "Failed to spawn tab %d (%s)", i, tab->command);
-			/* Continue trying to spawn other tabs */
-		}
+#if WAYMUX_HAS_XWAYLAND
+	/* Before the tabs are spawned, so that they inherit DISPLAY */
+	xwayland_set_mode(server->xwayland,
+			  profile->has_xwayland_mode ? profile->xwayland_mode : server->config->xwayland_mode);
+#endif
+
+	/* Spawn all tabs at once; they take their places as they map */
+	if (!profile_launch_start(server, profile)) {
+		wlr_log(WLR_ERROR, "Failed to spawn any tab of profile '%s'", profile->name);
 	}
 
 	profile_free(profile);
@@ -457,6 +390,9 @@ spawn_profile_tabs(struct cg_server *server, const char *profile_name)
 		/* Continue anyway - this is not fatal */
 	}
 
+	/* Rank the profile higher in the selector */
+	profile_selector_record_launch(server->profile_selector, profile_name);
+
 	return true;
 }
 
@@ -492,6 +428,11 @@ main(int argc, char *argv[])
 
 	wlr_log_init(server.log_level, NULL);
 
+#if WAYMUX_HAS_TRACING
+	/* A trace that can't be written isn't worth failing to start over */
+	trace_init(getenv("WAYMUX_TRACE"));
+#endif
+
 	/* Load keybinding configuration */
 	server.config = waymux_config_load(server.config_path);
 	if (!server.config) {
@@ -511,6 +452,18 @@ main(int argc, char *argv[])
 		return 1;
 	}
 
+	/* Give the clients WayMux starts cgroups of their own, if it may */
+	server.resources = resources_create();
+	if (!server.resources) {
+		return 1;
+	}
+
+	/* Start the clients from a helper forked now, before the GPU is
+	 * opened and the compositor grows; without it, they are started
+	 * directly */
+	server.spawn_helper = spawn_helper_create();
+	server.resources->helper = server.spawn_helper;
+
 	server.wl_display = wl_display_create();
 	if (!server.wl_display) {
 		wlr_log(WLR_ERROR, "Cannot allocate a Wayland display");
@@ -523,6 +476,9 @@ main(int argc, char *argv[])
 	struct wl_event_loop *event_loop = wl_display_get_event_loop(server.wl_display);
 	struct wl_event_source *sigint_source = wl_event_loop_add_signal(event_loop, SIGINT, handle_signal, &server);
 	struct wl_event_source *sigterm_source = wl_event_loop_add_signal(event_loop, SIGTERM, handle_signal, &server);
+	if (server.spawn_helper && !spawn_helper_attach(server.spawn_helper, event_loop)) {
+		wlr_log(WLR_ERROR, "Unable to watch the spawn helper");
+	}
 
 	server.backend = wlr_backend_autocreate(event_loop, &server.session);
 	if (!server.backend) {
@@ -554,11 +510,20 @@ main(int argc, char *argv[])
 
 	wl_list_init(&server.views);
 	wl_list_init(&server.outputs);
-	wl_list_init(&server.tabs);
+	tab_list_init(&server);
+	wl_signal_init(&server.events.tab_map);
+	wl_signal_init(&server.events.tab_unmap);
+	wl_signal_init(&server.events.tab_activate);
+	wl_signal_init(&server.events.tab_title);
+	wl_signal_init(&server.events.tab_background);
+	wl_signal_init(&server.events.tab_move);
 	server.active_tab = NULL;
-	server.pending_background_tabs = 0;
+	wl_list_init(&server.profile_launches);
+	wl_list_init(&server.profile_lazy_tabs);
+	profile_launch_watch_exits(&server);
 	server.launcher = NULL;
 	server.control = NULL;
+	server.visibility = NULL;
 
 	server.output_layout = wlr_output_layout_create(server.wl_display);
 	if (!server.output_layout) {
@@ -578,6 +543,38 @@ main(int argc, char *argv[])
 
 	server.scene_output_layout = wlr_scene_attach_output_layout(server.scene, server.output_layout);
 
+	/* Created first, so that the tab bar and overlays stay above all tabs */
+	server.tabs_tree = wlr_scene_tree_create(&server.scene->tree);
+	if (!server.tabs_tree) {
+		wlr_log(WLR_ERROR, "Unable to create the tabs scene tree");
+		ret = 1;
+		goto end;
+	}
+
+	/* Create desktop entry manager and load applications in the
+	 * background, so that startup doesn't wait on the filesystem */
+	server.desktop_entries = desktop_entry_manager_create();
+	if (!server.desktop_entries) {
+		wlr_log(WLR_ERROR, "Unable to create desktop entry manager");
+		ret = 1;
+		goto end;
+	}
+
+	if (desktop_entry_manager_load_async(server.desktop_entries, event_loop) != 0) {
+		int entry_count = desktop_entry_manager_load(server.desktop_entries);
+		if (entry_count < 0) {
+			wlr_log(WLR_ERROR, "Failed to load desktop entries");
+			ret = 1;
+			goto end;
+		}
+		wlr_log(WLR_INFO, "Loaded %d desktop entries for launcher", entry_count);
+	}
+
+	/* Pick up applications installed or removed while running */
+	if (desktop_entry_manager_watch(server.desktop_entries, event_loop) != 0) {
+		wlr_log(WLR_INFO, "Application directories are not watched for changes");
+	}
+
 	/* Create application launcher */
 	server.launcher = launcher_create(&server);
 	if (!server.launcher) {
@@ -586,12 +583,14 @@ main(int argc, char *argv[])
 		goto end;
 	}
 
-	/* Create tab bar UI */
-	server.tab_bar = tab_bar_create(&server);
-	if (!server.tab_bar) {
-		wlr_log(WLR_ERROR, "Unable to create tab bar");
-		ret = 1;
-		goto end;
+	/* Create tab bar UI; separate outputs get theirs as they come */
+	if (server.output_mode != WAYMUX_MULTI_OUTPUT_MODE_SEPARATE) {
+		server.tab_bar = tab_bar_create(&server, NULL);
+		if (!server.tab_bar) {
+			wlr_log(WLR_ERROR, "Unable to create tab bar");
+			ret = 1;
+			goto end;
+		}
 	}
 
 	/* Create background tabs dialog */
@@ -602,30 +601,50 @@ main(int argc, char *argv[])
 		goto end;
 	}
 
-	/* Create profile selector */
-	server.profile_selector = profile_selector_create(&server);
-	if (!server.profile_selector) {
-		wlr_log(WLR_ERROR, "Unable to create profile selector");
+	/* Create tab switcher */
+	server.tab_switcher = tab_switcher_create(&server);
+	if (!server.tab_switcher) {
+		wlr_log(WLR_ERROR, "Unable to create tab switcher");
 		ret = 1;
 		goto end;
 	}
 
-	/* Create desktop entry manager and load applications */
-	server.desktop_entries = desktop_entry_manager_create();
-	if (!server.desktop_entries) {
-		wlr_log(WLR_ERROR, "Unable to create desktop entry manager");
+#if WAYMUX_HAS_STATS
+	server.stats_hud = stats_hud_create(&server);
+	if (!server.stats_hud) {
+		wlr_log(WLR_ERROR, "Unable to create the stats HUD");
 		ret = 1;
 		goto end;
 	}
+#endif
 
-	int entry_count = desktop_entry_manager_load(server.desktop_entries);
-	if (entry_count < 0) {
-		wlr_log(WLR_ERROR, "Failed to load desktop entries");
+	/* Tell hidden tabs' clients they can't be seen */
+	server.visibility = visibility_create(&server, server.config->suspend_hidden_tabs,
+					      server.config->stop_background_tabs_after);
+	if (!server.visibility) {
+		wlr_log(WLR_ERROR, "Unable to create the visibility policy");
+		ret = 1;
+		goto end;
+	}
+
+	/* Pick up changes to the configuration file while running */
+	server.config_watch = config_watch_create(&server, event_loop);
+
+	/* Create profile selector */
+	server.profile_selector = profile_selector_create(&server);
+	if (!server.profile_selector) {
+		wlr_log(WLR_ERROR, "Unable to create profile selector");
 		ret = 1;
 		goto end;
 	}
 
-	wlr_log(WLR_INFO, "Loaded %d desktop entries for launcher", entry_count);
+	/* Give back memory while the overlays are hidden, or under pressure */
+	server.memory = memory_policy_create(&server, event_loop);
+	if (!server.memory) {
+		wlr_log(WLR_ERROR, "Unable to create the memory policy");
+		ret = 1;
+		goto end;
+	}
 
 	/* Create control server */
 	server.control = control_server_create(&server);
@@ -819,37 +838,11 @@ main(int argc, char *argv[])
 	}
 
 #if WAYMUX_HAS_XWAYLAND
-	struct wlr_xcursor_manager *xcursor_manager = NULL;
-	struct wlr_xwayland *xwayland = wlr_xwayland_create(server.wl_display, compositor, true);
-	if (!xwayland) {
-		wlr_log(WLR_ERROR, "Cannot create XWayland server");
-	} else {
-		server.new_xwayland_surface.notify = handle_xwayland_surface_new;
-		wl_signal_add(&xwayland->events.new_surface, &server.new_xwayland_surface);
-
-		xcursor_manager = wlr_xcursor_manager_create(DEFAULT_XCURSOR, XCURSOR_SIZE);
-		if (!xcursor_manager) {
-			wlr_log(WLR_ERROR, "Cannot create XWayland XCursor manager");
-			ret = 1;
-			goto end;
-		}
-
-		if (setenv("DISPLAY", xwayland->display_name, true) < 0) {
-			wlr_log_errno(WLR_ERROR,
-				      "Unable to set DISPLAY for XWayland. Clients may not be able to connect");
-		} else {
-			wlr_log(WLR_DEBUG, "XWayland is running on display %s", xwayland->display_name);
-		}
-
-		if (!wlr_xcursor_manager_load(xcursor_manager, 1)) {
-			wlr_log(WLR_ERROR, "Cannot load XWayland XCursor theme");
-		}
-		struct wlr_xcursor *xcursor = wlr_xcursor_manager_get_xcursor(xcursor_manager, DEFAULT_XCURSOR, 1);
-		if (xcursor) {
-			struct wlr_xcursor_image *image = xcursor->images[0];
-			wlr_xwayland_set_cursor(xwayland, image->buffer, image->width * 4, image->width, image->height,
-						image->hotspot_x, image->hotspot_y);
-		}
+	/* Started once the XWayland mode is known, which a profile may set */
+	server.xwayland = xwayland_create(&server, compositor);
+	if (!server.xwayland) {
+		ret = 1;
+		goto end;
 	}
 #endif
 
@@ -881,12 +874,6 @@ main(int argc, char *argv[])
 		wlr_log(WLR_DEBUG, "WayMux " WAYMUX_VERSION " is running on Wayland display %s", socket);
 	}
 
-#if WAYMUX_HAS_XWAYLAND
-	if (xwayland) {
-		wlr_xwayland_set_seat(xwayland, server.seat->seat);
-	}
-#endif
-
 	/* Check if the first argument is a profile name (not starting with '-') */
 	/* Skip profile loading if -P (profile_selector_mode) is enabled */
 	if (!server.profile_selector_mode &&
@@ -903,6 +890,12 @@ main(int argc, char *argv[])
 		optind++; /* Skip profile name */
 	}
 
+#if WAYMUX_HAS_XWAYLAND
+	if (!server.profile_name) {
+		xwayland_set_mode(server.xwayland, server.config->xwayland_mode);
+	}
+#endif
+
 	/* Show profile selector if -P flag was used */
 	if (server.profile_selector_mode) {
 		wlr_log(WLR_INFO, "Profile selector mode enabled, will show on first frame");
@@ -919,12 +912,12 @@ main(int argc, char *argv[])
 	wl_display_run(server.wl_display);
 
 #if WAYMUX_HAS_XWAYLAND
-	if (xwayland) {
-		wl_list_remove(&server.new_xwayland_surface.link);
-	}
-	wlr_xwayland_destroy(xwayland);
-	wlr_xcursor_manager_destroy(xcursor_manager);
+	xwayland_destroy(server.xwayland);
+	server.xwayland = NULL;
 #endif
+	/* Stopped clients must be continued to see their connection close */
+	visibility_destroy(server.visibility);
+	server.visibility = NULL;
 	wl_display_destroy_clients(server.wl_display);
 
 #if WLR_HAS_DRM_BACKEND
@@ -955,9 +948,20 @@ end:
 		wl_event_source_remove(sigchld_source);
 	}
 	seat_destroy(server.seat);
+	config_watch_destroy(server.config_watch);
+	visibility_destroy(server.visibility);
+	memory_policy_destroy(server.memory);
+	resources_destroy(server.resources);
+	profile_launch_destroy_all(&server);
+	spawn_helper_destroy(server.spawn_helper);
 	control_server_destroy(server.control);
-	desktop_entry_manager_destroy(server.desktop_entries);
+	tab_switcher_destroy(server.tab_switcher);
+#if WAYMUX_HAS_STATS
+	stats_hud_destroy(server.stats_hud);
+#endif
+	tab_list_finish(&server);
 	launcher_destroy(server.launcher);
+	desktop_entry_manager_destroy(server.desktop_entries);
 	profile_selector_destroy(server.profile_selector);
 
 	/* Unregister this instance from the registry */
@@ -974,7 +978,11 @@ end:
 	free(server.profile_name);
 	wl_display_destroy(server.wl_display);
 	wlr_scene_node_destroy(&server.scene->tree.node);
+	pixel_buffer_pool_finish();
 	wlr_allocator_destroy(server.allocator);
 	wlr_renderer_destroy(server.renderer);
+#if WAYMUX_HAS_TRACING
+	trace_finish();
+#endif
 	return ret;
 }
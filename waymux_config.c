@@ -21,6 +21,9 @@
 #include <wlr/types/wlr_keyboard.h>
 #include <xkbcommon/xkbcommon.h>
 
+/* Longest render times of [output], in ms: a whole frame at 10 Hz */
+#define OUTPUT_MAX_RENDER_TIME 100
+
 /* Default keybindings as static constants */
 static const struct keybinding default_next_tab = {
 	WLR_MODIFIER_LOGO, XKB_KEY_k
@@ -184,6 +187,83 @@ apply_keybinding_defaults(struct waymux_config *config)
 	}
 }
 
+/* Compile the keybindings for dispatch. Where two actions share a key,
+ * the first one below wins. */
+static void
+compile_keybindings(struct waymux_config *config)
+{
+	const struct {
+		const char *name;
+		const struct keybinding *binding;
+		struct action action;
+	} actions[] = {
+		{"show_background_dialog", config->show_background_dialog, {ACTION_SHOW_BACKGROUND_DIALOG, 0}},
+		{"toggle_background", config->toggle_background, {ACTION_TOGGLE_BACKGROUND, 0}},
+		{"prev_tab", config->prev_tab, {ACTION_PREV_TAB, 0}},
+		{"next_tab", config->next_tab, {ACTION_NEXT_TAB, 0}},
+		{"close_tab", config->close_tab, {ACTION_CLOSE_TAB, 0}},
+		{"open_launcher", config->open_launcher, {ACTION_OPEN_LAUNCHER, 0}},
+	};
+
+	keybinding_table_init(&config->bindings);
+	for (size_t i = 0; i < sizeof(actions) / sizeof(actions[0]); i++) {
+		if (actions[i].binding && !keybinding_table_add(&config->bindings, actions[i].binding, &actions[i].action)) {
+			wlr_log(WLR_ERROR, "Keybinding for %s is already bound to another action", actions[i].name);
+		}
+	}
+
+	for (int i = 0; i < config->action_binding_count; i++) {
+		struct waymux_config_binding *extra = &config->action_bindings[i];
+		if (!keybinding_table_add(&config->bindings, &extra->binding, &extra->action)) {
+			char name[64];
+			action_format(&extra->action, name, sizeof(name));
+			wlr_log(WLR_ERROR, "Keybinding for %s is already bound to another action, or too many keys are bound",
+				name);
+		}
+	}
+}
+
+/* Parse the bindings of [keybindings] actions other than the ones with
+ * defaults. Returns false on an unknown action or invalid keybinding. */
+static bool
+parse_action_bindings(struct waymux_config *config, toml_datum_t *table)
+{
+	config->action_bindings = calloc(table->u.tab.size > 0 ? table->u.tab.size : 1,
+					 sizeof(*config->action_bindings));
+	if (!config->action_bindings) {
+		wlr_log_errno(WLR_ERROR, "Failed to allocate keybindings");
+		return false;
+	}
+
+	for (int i = 0; i < table->u.tab.size; i++) {
+		char *name = strndup(table->u.tab.key[i], table->u.tab.len[i]);
+		if (!name) {
+			wlr_log_errno(WLR_ERROR, "Failed to allocate keybinding name");
+			return false;
+		}
+		if (waymux_config_get_default(name)) {
+			free(name);
+			continue;
+		}
+
+		struct waymux_config_binding *extra = &config->action_bindings[config->action_binding_count];
+		toml_datum_t *value = &table->u.tab.value[i];
+		if (!action_parse(name, &extra->action)) {
+			wlr_log(WLR_ERROR, "Unknown action '%s' in [keybindings]", name);
+			free(name);
+			return false;
+		}
+		if (value->type != TOML_STRING || !keybinding_parse(value->u.s, &extra->binding)) {
+			wlr_log(WLR_ERROR, "Invalid keybinding for %s", name);
+			free(name);
+			return false;
+		}
+		free(name);
+		config->action_binding_count++;
+	}
+	return true;
+}
+
 struct waymux_config *
 waymux_config_load(const char *custom_path)
 {
@@ -198,7 +278,9 @@ waymux_config_load(const char *custom_path)
 			return NULL;
 		}
 		config->config_path = NULL;
+		config->suspend_hidden_tabs = true;
 		apply_keybinding_defaults(config);
+		compile_keybindings(config);
 		return config;
 	}
 
@@ -223,6 +305,7 @@ waymux_config_load(const char *custom_path)
 
 	/* Store the config path for later reference */
 	config->config_path = config_path;
+	config->suspend_hidden_tabs = true;
 
 	toml_datum_t root = result.toptab;
 
@@ -262,12 +345,99 @@ waymux_config_load(const char *custom_path)
 			wlr_log(WLR_ERROR, "Invalid keybinding for show_background_dialog");
 			goto error;
 		}
+
+		if (!parse_action_bindings(config, &keybindings)) {
+			goto error;
+		}
+	}
+
+	/* Parse [hidden_tabs] table (optional) */
+	toml_datum_t hidden_tabs = toml_get(root, "hidden_tabs");
+	if (hidden_tabs.type == TOML_TABLE) {
+		toml_datum_t suspend = toml_get(hidden_tabs, "suspend");
+		if (suspend.type == TOML_BOOLEAN) {
+			config->suspend_hidden_tabs = suspend.u.boolean;
+		} else if (suspend.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "hidden_tabs.suspend must be a boolean");
+			goto error;
+		}
+
+		toml_datum_t stop_after = toml_get(hidden_tabs, "stop_after");
+		if (stop_after.type == TOML_INT64 && stop_after.u.int64 >= 0 && stop_after.u.int64 <= 86400) {
+			config->stop_background_tabs_after = (int)stop_after.u.int64;
+		} else if (stop_after.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "hidden_tabs.stop_after must be a number of seconds, up to 86400");
+			goto error;
+		}
+	}
+
+	/* Parse [output] table (optional) */
+	toml_datum_t output = toml_get(root, "output");
+	if (output.type == TOML_TABLE) {
+		toml_datum_t passthrough = toml_get(output, "passthrough");
+		if (passthrough.type == TOML_BOOLEAN) {
+			config->output_passthrough = passthrough.u.boolean;
+		} else if (passthrough.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "output.passthrough must be a boolean");
+			goto error;
+		}
+
+		toml_datum_t max_render_time = toml_get(output, "max_render_time");
+		if (max_render_time.type == TOML_INT64 && max_render_time.u.int64 >= 0 &&
+		    max_render_time.u.int64 <= OUTPUT_MAX_RENDER_TIME) {
+			config->max_render_time = (int)max_render_time.u.int64;
+		} else if (max_render_time.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "output.max_render_time must be a number of milliseconds, up to %d",
+				OUTPUT_MAX_RENDER_TIME);
+			goto error;
+		}
+
+		toml_datum_t tab_render_time = toml_get(output, "active_tab_render_time");
+		if (tab_render_time.type == TOML_INT64 && tab_render_time.u.int64 >= 0 &&
+		    tab_render_time.u.int64 <= OUTPUT_MAX_RENDER_TIME) {
+			config->active_tab_render_time = (int)tab_render_time.u.int64;
+		} else if (tab_render_time.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "output.active_tab_render_time must be a number of milliseconds, up to %d",
+				OUTPUT_MAX_RENDER_TIME);
+			goto error;
+		}
+	}
+
+	/* Parse [tab_bar] table (optional) */
+	toml_datum_t tab_bar = toml_get(root, "tab_bar");
+	if (tab_bar.type == TOML_TABLE) {
+		toml_datum_t renderer = toml_get(tab_bar, "renderer");
+		if (renderer.type == TOML_STRING && strcmp(renderer.u.s, "cairo") == 0) {
+			config->tab_bar_renderer = WAYMUX_TAB_BAR_RENDERER_CAIRO;
+		} else if (renderer.type == TOML_STRING && strcmp(renderer.u.s, "scene") == 0) {
+			config->tab_bar_renderer = WAYMUX_TAB_BAR_RENDERER_SCENE;
+		} else if (renderer.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "tab_bar.renderer must be \"cairo\" or \"scene\"");
+			goto error;
+		}
+	}
+
+	/* Parse [xwayland] table (optional) */
+	toml_datum_t xwayland = toml_get(root, "xwayland");
+	if (xwayland.type == TOML_TABLE) {
+		toml_datum_t mode = toml_get(xwayland, "mode");
+		if (mode.type == TOML_STRING && strcmp(mode.u.s, "lazy") == 0) {
+			config->xwayland_mode = WAYMUX_XWAYLAND_LAZY;
+		} else if (mode.type == TOML_STRING && strcmp(mode.u.s, "on_demand") == 0) {
+			config->xwayland_mode = WAYMUX_XWAYLAND_ON_DEMAND;
+		} else if (mode.type == TOML_STRING && strcmp(mode.u.s, "disabled") == 0) {
+			config->xwayland_mode = WAYMUX_XWAYLAND_DISABLED;
+		} else if (mode.type != TOML_UNKNOWN) {
+			wlr_log(WLR_ERROR, "xwayland.mode must be \"lazy\", \"on_demand\" or \"disabled\"");
+			goto error;
+		}
 	}
 
 	toml_free(result);
 
 	/* Apply defaults for any keybindings not specified in config */
 	apply_keybinding_defaults(config);
+	compile_keybindings(config);
 
 	wlr_log(WLR_INFO, "Config loaded successfully");
 
@@ -293,5 +463,50 @@ waymux_config_free(struct waymux_config *config)
 	free(config->open_launcher);
 	free(config->toggle_background);
 	free(config->show_background_dialog);
+	free(config->action_bindings);
 	free(config);
 }
+
+static bool
+keybinding_tables_equal(const struct keybinding_table *a, const struct keybinding_table *b)
+{
+	if (a->count != b->count || a->modifiers != b->modifiers || a->has_unmodified != b->has_unmodified) {
+		return false;
+	}
+
+	/* Tables built from the same bindings in the same order are laid
+	 * out the same, so slots can be compared one by one */
+	for (size_t i = 0; i < KEYBINDING_TABLE_SIZE; i++) {
+		const struct keybinding_table_entry *ea = &a->entries[i];
+		const struct keybinding_table_entry *eb = &b->entries[i];
+		if (ea->action.type != eb->action.type || ea->action.arg != eb->action.arg ||
+		    ea->binding.modifiers != eb->binding.modifiers || ea->binding.keysym != eb->binding.keysym) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t
+waymux_config_diff(const struct waymux_config *old_config, const struct waymux_config *new_config)
+{
+	uint32_t changes = 0;
+
+	if (!keybinding_tables_equal(&old_config->bindings, &new_config->bindings)) {
+		changes |= WAYMUX_CONFIG_CHANGED_KEYBINDINGS;
+	}
+	if (old_config->suspend_hidden_tabs != new_config->suspend_hidden_tabs ||
+	    old_config->stop_background_tabs_after != new_config->stop_background_tabs_after) {
+		changes |= WAYMUX_CONFIG_CHANGED_HIDDEN_TABS;
+	}
+	if (old_config->output_passthrough != new_config->output_passthrough ||
+	    old_config->max_render_time != new_config->max_render_time ||
+	    old_config->active_tab_render_time != new_config->active_tab_render_time) {
+		changes |= WAYMUX_CONFIG_CHANGED_OUTPUT;
+	}
+	if (old_config->tab_bar_renderer != new_config->tab_bar_renderer) {
+		changes |= WAYMUX_CONFIG_CHANGED_TAB_BAR;
+	}
+
+	return changes;
+}
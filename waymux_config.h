@@ -11,6 +11,7 @@
 
 #include "keybinding.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 /* WayMux configuration structure */
 struct waymux_config {
@@ -22,6 +23,48 @@ struct waymux_config {
 	struct keybinding *toggle_background;
 	struct keybinding *show_background_dialog;
 
+	/* Bindings of the other actions in [keybindings], e.g. focus_tab_1,
+	 * which have no default */
+	struct waymux_config_binding {
+		struct action action;
+		struct keybinding binding;
+	} *action_bindings;
+	int action_binding_count;
+
+	/* All of the keybindings above, compiled for dispatch */
+	struct keybinding_table bindings;
+
+	/* [hidden_tabs]: tell clients of tabs not shown that they are
+	 * suspended, and stop background tabs' clients after this many
+	 * seconds (0 never stops them) */
+	bool suspend_hidden_tabs;
+	int stop_background_tabs_after;
+
+	/* [output]: on nested outputs, hand the active tab's buffer to the
+	 * parent compositor instead of compositing it */
+	bool output_passthrough;
+
+	/* [output]: milliseconds before the next vblank to render WayMux's
+	 * frames at, and to let the active tab's client draw at before that;
+	 * 0 renders, and lets clients draw, as soon as a frame is shown */
+	int max_render_time;
+	int active_tab_render_time;
+
+	/* [tab_bar]: how the tab bar's buttons are drawn */
+	enum waymux_tab_bar_renderer {
+		WAYMUX_TAB_BAR_RENDERER_CAIRO,
+		WAYMUX_TAB_BAR_RENDERER_SCENE,
+	} tab_bar_renderer;
+
+	/* [xwayland]: when the X server runs. It is always started by the
+	 * first X client to connect; on demand, it also exits some time
+	 * after the last one does. Profiles can override this. */
+	enum waymux_xwayland_mode {
+		WAYMUX_XWAYLAND_LAZY,
+		WAYMUX_XWAYLAND_ON_DEMAND,
+		WAYMUX_XWAYLAND_DISABLED,  /* No X server, and DISPLAY is unset */
+	} xwayland_mode;
+
 	/* Path to config file (for logging) */
 	char *config_path;
 };
@@ -47,6 +90,20 @@ struct waymux_config *waymux_config_load(const char *custom_path);
  */
 void waymux_config_free(struct waymux_config *config);
 
+/* Parts of the configuration that waymux_config_diff() tells apart */
+enum waymux_config_change {
+	WAYMUX_CONFIG_CHANGED_KEYBINDINGS = 1 << 0,
+	WAYMUX_CONFIG_CHANGED_HIDDEN_TABS = 1 << 1,
+	WAYMUX_CONFIG_CHANGED_OUTPUT = 1 << 2,
+	WAYMUX_CONFIG_CHANGED_TAB_BAR = 1 << 3,
+};
+
+/**
+ * Compare two configs, e.g. before and after a reload
+ * @return A mask of waymux_config_change flags, 0 if nothing changed
+ */
+uint32_t waymux_config_diff(const struct waymux_config *old_config, const struct waymux_config *new_config);
+
 /**
  * Get default keybindings for a specific action
  * @param action Action name: "next_tab", "prev_tab", "close_tab", "open_launcher",
@@ -4,31 +4,44 @@
  * Communicates with waymux control server via Unix domain socket
  */
 
-#include <dirent.h>
+/* For flock() */
+#define _DEFAULT_SOURCE
+
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
-#include <tomlc17.h>
 
 #define CONTROL_BUFFER_SIZE 4096
+#define BATCH_WINDOW 32 /* Commands in flight at once in batch mode */
 #define REGISTRY_DIR "/waymux/registry"
+#define FANOUT_TIMEOUT_MS 2000 /* Default wait for each instance with --all */
+#define FANOUT_RETRY_MS 10     /* Between connection attempts to a busy instance */
 
 /* Instance name to connect to (NULL = use default or auto-detect) */
 static const char *target_instance = NULL;
+/* Ask for, and print, JSON responses */
+static bool json_output = false;
+/* Send the command to every running instance */
+static bool all_instances = false;
+static int fanout_timeout_ms = FANOUT_TIMEOUT_MS;
 
-/* Find and connect to waymux control socket
- * Searches XDG_RUNTIME_DIR/waymux directory for .sock files
- * Returns socket fd on success, -1 on failure
+/* Fill in the address of the named instance's control socket
+ * Returns 0 on success, -1 on failure
  */
 static int
-connect_to_waymux(void)
+socket_address(const char *instance_name, struct sockaddr_un *addr)
 {
 	const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
 	if (!runtime_dir) {
@@ -36,14 +49,23 @@ connect_to_waymux(void)
 		return -1;
 	}
 
-	/* Build socket directory path */
-	char socket_dir[PATH_MAX];
-	int len = snprintf(socket_dir, sizeof(socket_dir), "%s/waymux", runtime_dir);
-	if (len < 0 || (size_t)len >= sizeof(socket_dir)) {
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	int len = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/waymux/%s.sock", runtime_dir, instance_name);
+	if (len < 0 || (size_t)len >= sizeof(addr->sun_path)) {
 		fprintf(stderr, "ERROR: Socket path too long\n");
 		return -1;
 	}
+	return 0;
+}
 
+/* Find and connect to waymux control socket
+ * Connects to XDG_RUNTIME_DIR/waymux/NAME.sock
+ * Returns socket fd on success, -1 on failure
+ */
+static int
+connect_to_waymux(void)
+{
 	/* Check for WAYMUX_INSTANCE environment variable first, then --instance flag */
 	const char *instance_name = getenv("WAYMUX_INSTANCE");
 	if (!instance_name && target_instance) {
@@ -53,10 +75,8 @@ connect_to_waymux(void)
 		instance_name = "default";
 	}
 
-	char socket_path[PATH_MAX];
-	len = snprintf(socket_path, sizeof(socket_path), "%s/%s.sock", socket_dir, instance_name);
-	if (len < 0 || (size_t)len >= sizeof(socket_path)) {
-		fprintf(stderr, "ERROR: Socket path too long\n");
+	struct sockaddr_un addr;
+	if (socket_address(instance_name, &addr) < 0) {
 		return -1;
 	}
 
@@ -68,21 +88,6 @@ connect_to_waymux(void)
 	}
 
 	/* Connect to socket */
-	struct sockaddr_un addr;
-	memset(&addr, 0, sizeof(addr));
-	addr.sun_family = AF_UNIX;
-	/* Note: socket_path is already validated to fit in PATH_MAX above.
-	 * The warning about potential truncation is a false positive since
-	 * we check the length before calling snprintf. */
-#if defined(__GNUC__) && __GNUC__ >= 7
-	_Pragma("GCC diagnostic push")
-	_Pragma("GCC diagnostic ignored \"-Wformat-truncation\"")
-#endif
-	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
-#if defined(__GNUC__) && __GNUC__ >= 7
-	_Pragma("GCC diagnostic pop")
-#endif
-
 	if (connect(sock_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
 		perror("ERROR: Failed to connect to waymux socket");
 		close(sock_fd);
@@ -92,6 +97,26 @@ connect_to_waymux(void)
 	return sock_fd;
 }
 
+/* Send all of a string, retrying short writes
+ * Returns 0 on success, -1 on failure
+ */
+static int
+send_all(int sock_fd, const char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t sent = send(sock_fd, data, len, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		data += sent;
+		len -= sent;
+	}
+	return 0;
+}
+
 /* Send command to waymux and read response
  * Returns 0 on success, -1 on failure
  * Response is written to stdout
@@ -105,17 +130,18 @@ send_command(const char *command)
 	}
 
 	/* Send command */
-	size_t cmd_len = strlen(command);
-	char *cmd_with_newline = malloc(cmd_len + 2);
+	const char *prefix = json_output ? "--json " : "";
+	size_t cmd_len = strlen(prefix) + strlen(command) + 1;
+	char *cmd_with_newline = malloc(cmd_len + 1);
 	if (!cmd_with_newline) {
 		fprintf(stderr, "ERROR: Out of memory\n");
 		close(sock_fd);
 		return -1;
 	}
 
-	snprintf(cmd_with_newline, cmd_len + 2, "%s\n", command);
+	snprintf(cmd_with_newline, cmd_len + 1, "%s%s\n", prefix, command);
 
-	ssize_t sent = send(sock_fd, cmd_with_newline, cmd_len + 1, 0);
+	int sent = send_all(sock_fd, cmd_with_newline, cmd_len);
 	free(cmd_with_newline);
 
 	if (sent < 0) {
@@ -127,7 +153,8 @@ send_command(const char *command)
 	/* Read response */
 	char buffer[CONTROL_BUFFER_SIZE];
 	ssize_t n;
-	bool first_line = true;
+	/* JSON responses are printed whole */
+	bool first_line = !json_output;
 
 	while ((n = recv(sock_fd, buffer, CONTROL_BUFFER_SIZE - 1, 0)) > 0) {
 		buffer[n] = '\0';
@@ -143,6 +170,9 @@ send_command(const char *command)
 		} else {
 			fwrite(buffer, 1, n, stdout);
 		}
+
+		/* subscribe streams events for as long as it runs */
+		fflush(stdout);
 	}
 
 	if (n < 0) {
@@ -155,11 +185,244 @@ send_command(const char *command)
 	return 0;
 }
 
-/* List all running instances from the registry
- * Returns 0 on success, -1 on failure
+/* Buffered reader for session responses, each terminated by an empty line */
+struct session_reader {
+	int fd;
+	char *buffer;
+	size_t len;
+	size_t capacity;
+};
+
+/* Read the next response, without its terminator, into a new allocation
+ * Returns NULL on EOF or error
+ */
+static char *
+read_session_response(struct session_reader *reader)
+{
+	size_t searched = 0;
+
+	for (;;) {
+		/* Make room for at least one more read, and the terminator */
+		if (reader->capacity - reader->len < CONTROL_BUFFER_SIZE + 1) {
+			size_t capacity = reader->capacity ? reader->capacity * 2 : 2 * CONTROL_BUFFER_SIZE;
+			char *grown = realloc(reader->buffer, capacity);
+			if (!grown) {
+				fprintf(stderr, "ERROR: Out of memory\n");
+				return NULL;
+			}
+			reader->buffer = grown;
+			reader->capacity = capacity;
+		}
+
+		reader->buffer[reader->len] = '\0';
+		char *end = strstr(reader->buffer + searched, "\n\n");
+		if (end) {
+			size_t response_len = end - reader->buffer + 1;
+			char *response = strndup(reader->buffer, response_len);
+			reader->len -= response_len + 1;
+			memmove(reader->buffer, end + 2, reader->len);
+			return response;
+		}
+
+		/* Don't rescan what was already searched, but a terminator may
+		 * straddle the boundary */
+		searched = reader->len > 0 ? reader->len - 1 : 0;
+
+		ssize_t n = recv(reader->fd, reader->buffer + reader->len, reader->capacity - 1 - reader->len, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			if (n < 0) {
+				perror("ERROR: Failed to read response");
+			}
+			return NULL;
+		}
+		reader->len += n;
+	}
+}
+
+/* Print a response like send_command() does: the status line is dropped,
+ * unless it is an error, which goes to stderr. JSON responses are printed
+ * whole, errors included.
+ * Returns 0 for OK responses, -1 for errors
  */
 static int
-list_instances(void)
+print_session_response(const char *command, char *response)
+{
+	if (json_output) {
+		fputs(response, stdout);
+		/* Quotes inside strings are escaped, so this only matches the
+		 * status member */
+		return strstr(response, "\"ok\":false") ? -1 : 0;
+	}
+
+	/* Drop the "@ID " prefix */
+	char *status = response;
+	if (status[0] == '@') {
+		char *space = strchr(status, ' ');
+		status = space ? space + 1 : status;
+	}
+
+	char *body = strchr(status, '\n');
+	if (body) {
+		*body++ = '\0';
+	}
+
+	if (strncmp(status, "ERROR", 5) == 0) {
+		fprintf(stderr, "%s: %s\n", command, status);
+		return -1;
+	}
+
+	if (body) {
+		fputs(body, stdout);
+	}
+	return 0;
+}
+
+/* Run commands from input, one per line, over a single session connection.
+ * Commands are pipelined: up to BATCH_WINDOW are sent before waiting for
+ * their responses, which arrive in order.
+ * Returns 0 if every command succeeded, -1 otherwise
+ */
+static int
+run_batch(FILE *input)
+{
+	char **commands = NULL;
+	size_t count = 0, capacity = 0;
+	char *line = NULL;
+	size_t line_size = 0;
+	ssize_t line_len;
+
+	while ((line_len = getline(&line, &line_size, input)) >= 0) {
+		if (line_len > 0 && line[line_len - 1] == '\n') {
+			line[--line_len] = '\0';
+		}
+		/* Skip blank lines and comments */
+		if (line_len == 0 || line[0] == '#') {
+			continue;
+		}
+		if ((size_t)line_len >= CONTROL_BUFFER_SIZE - 32) {
+			fprintf(stderr, "ERROR: Command too long: %.40s...\n", line);
+			continue;
+		}
+
+		if (count == capacity) {
+			capacity = capacity ? capacity * 2 : 16;
+			char **grown = realloc(commands, capacity * sizeof(*commands));
+			if (!grown) {
+				fprintf(stderr, "ERROR: Out of memory\n");
+				break;
+			}
+			commands = grown;
+		}
+		commands[count] = strdup(line);
+		if (commands[count]) {
+			count++;
+		}
+	}
+	free(line);
+
+	int status = 0;
+	int sock_fd = -1;
+	struct session_reader *reader = NULL;
+	if (count == 0) {
+		goto out;
+	}
+
+	status = -1;
+	sock_fd = connect_to_waymux();
+	reader = calloc(1, sizeof(*reader));
+	if (sock_fd < 0 || !reader) {
+		goto out;
+	}
+	reader->fd = sock_fd;
+
+	const char *session = "session\n";
+	if (send_all(sock_fd, session, strlen(session)) < 0) {
+		perror("ERROR: Failed to send command");
+		goto out;
+	}
+
+	char *response = read_session_response(reader);
+	if (!response || strcmp(response, "OK session\n") != 0) {
+		fprintf(stderr, "ERROR: Server does not support sessions\n");
+		free(response);
+		goto out;
+	}
+	free(response);
+
+	status = 0;
+	size_t sent = 0;
+	size_t answered = 0;
+	while (answered < count) {
+		/* Keep the window full */
+		while (sent < count && sent - answered < BATCH_WINDOW) {
+			char request[CONTROL_BUFFER_SIZE];
+			int len = snprintf(request, sizeof(request), "@%zu %s%s\n", sent,
+					   json_output ? "--json " : "", commands[sent]);
+			if (send_all(sock_fd, request, len) < 0) {
+				perror("ERROR: Failed to send command");
+				status = -1;
+				goto out;
+			}
+			sent++;
+		}
+
+		response = read_session_response(reader);
+		if (!response) {
+			fprintf(stderr, "ERROR: Connection closed after %zu of %zu commands\n", answered, count);
+			status = -1;
+			goto out;
+		}
+		if (print_session_response(commands[answered], response) < 0) {
+			status = -1;
+		}
+		free(response);
+		answered++;
+	}
+
+out:
+	if (sock_fd >= 0) {
+		close(sock_fd);
+	}
+	if (reader) {
+		free(reader->buffer);
+		free(reader);
+	}
+	for (size_t i = 0; i < count; i++) {
+		free(commands[i]);
+	}
+	free(commands);
+	return status;
+}
+
+/* Whether the instance with the given name holds its registry lock */
+static bool
+instance_is_running(const char *registry_dir, const char *name)
+{
+	char lock_path[PATH_MAX];
+	int len = snprintf(lock_path, sizeof(lock_path), "%s/instances/%s.lock", registry_dir, name);
+	if (len < 0 || (size_t)len >= sizeof(lock_path)) {
+		return false;
+	}
+
+	int fd = open(lock_path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	bool running = flock(fd, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+	close(fd);
+	return running;
+}
+
+/* Call func for each running instance in the registry's index, skipping
+ * those that exited without removing themselves from it
+ * Returns the number of running instances, or -1 on failure
+ */
+static int
+for_each_instance(void (*func)(const char *name, int pid, const char *profile, void *data), void *data)
 {
 	const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
 	if (!runtime_dir) {
@@ -175,89 +438,456 @@ list_instances(void)
 		return -1;
 	}
 
-	/* Open registry directory */
-	DIR *dir = opendir(registry_dir);
-	if (!dir) {
+	char index_path[PATH_MAX];
+	len = snprintf(index_path, sizeof(index_path), "%s/index", registry_dir);
+	if (len < 0 || (size_t)len >= sizeof(index_path)) {
+		fprintf(stderr, "ERROR: Registry path too long\n");
+		return -1;
+	}
+
+	/* Open registry index */
+	int fd = open(index_path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
 		if (errno == ENOENT) {
-			/* No registry directory means no instances */
-			printf("No running instances\n");
+			/* No registry index means no instances */
 			return 0;
 		}
-		perror("ERROR: Failed to open registry directory");
+		perror("ERROR: Failed to open registry index");
 		return -1;
 	}
 
-	struct dirent *entry;
-	int instance_count = 0;
+	/* Instances rewrite the index under an exclusive lock */
+	FILE *index = fdopen(fd, "r");
+	if (!index || flock(fd, LOCK_SH) != 0) {
+		perror("ERROR: Failed to read registry index");
+		if (index) {
+			fclose(index);
+		} else {
+			close(fd);
+		}
+		return -1;
+	}
 
-	printf("Running instances:\n");
+	int instance_count = 0;
+	char *line = NULL;
+	size_t line_size = 0;
 
-	while ((entry = readdir(dir)) != NULL) {
-		/* Skip . and .. */
-		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+	while (getline(&line, &line_size, index) > 0) {
+		/* Lines are "name\tpid\tprofile" */
+		line[strcspn(line, "\n")] = '\0';
+		char *pid_field = strchr(line, '\t');
+		if (!pid_field) {
 			continue;
 		}
+		*pid_field++ = '\0';
+		char *profile = strchr(pid_field, '\t');
+		if (profile) {
+			*profile++ = '\0';
+		}
 
-		/* Check if it's a .toml file */
-		size_t name_len = strlen(entry->d_name);
-		if (name_len < 6 || strcmp(entry->d_name + name_len - 5, ".toml") != 0) {
+		if (!instance_is_running(registry_dir, line)) {
 			continue;
 		}
 
-		/* Build full path */
-		char file_path[PATH_MAX];
-		len = snprintf(file_path, sizeof(file_path), "%s/%s", registry_dir, entry->d_name);
-		if (len < 0 || (size_t)len >= sizeof(file_path)) {
-			continue;
+		func(line, atoi(pid_field), profile, data);
+		instance_count++;
+	}
+
+	free(line);
+	fclose(index);
+	return instance_count;
+}
+
+static void
+print_instance(const char *name, int pid, const char *profile, void *data)
+{
+	int *printed = data;
+	if ((*printed)++ == 0) {
+		printf("Running instances:\n");
+	}
+
+	/* Print instance info */
+	printf("  %s", name);
+	if (profile && *profile) {
+		printf(" (profile: %s)", profile);
+	}
+	if (pid > 0) {
+		printf(" [pid: %d]", pid);
+	}
+	printf("\n");
+}
+
+/* List all running instances
+ * Returns 0 on success, -1 on failure
+ */
+static int
+list_instances(void)
+{
+	int printed = 0;
+	int count = for_each_instance(print_instance, &printed);
+	if (count == 0) {
+		printf("No running instances\n");
+	}
+	return count < 0 ? -1 : 0;
+}
+
+/* One instance asked by send_command_all() */
+struct fanout_target {
+	char *name;
+	struct sockaddr_un addr;
+	int fd;
+	enum {
+		FANOUT_CONNECTING,
+		FANOUT_SENDING,
+		FANOUT_RECEIVING,
+		FANOUT_DONE,
+	} state;
+	size_t sent;
+	char *response;
+	size_t len;
+	size_t capacity;
+	char error[128]; /* Why there is no response, if there isn't */
+};
+
+struct fanout {
+	struct fanout_target *targets;
+	size_t count;
+	size_t capacity;
+};
+
+static void
+add_fanout_target(const char *name, int pid, const char *profile, void *data)
+{
+	struct fanout *fanout = data;
+	if (fanout->count == fanout->capacity) {
+		size_t capacity = fanout->capacity ? fanout->capacity * 2 : 8;
+		struct fanout_target *grown = realloc(fanout->targets, capacity * sizeof(*grown));
+		if (!grown) {
+			fprintf(stderr, "ERROR: Out of memory\n");
+			return;
+		}
+		fanout->targets = grown;
+		fanout->capacity = capacity;
+	}
+
+	struct fanout_target *target = &fanout->targets[fanout->count];
+	memset(target, 0, sizeof(*target));
+	target->fd = -1;
+	target->name = strdup(name);
+	if (target->name) {
+		fanout->count++;
+	}
+}
+
+static void
+fanout_fail(struct fanout_target *target, const char *error)
+{
+	snprintf(target->error, sizeof(target->error), "%s", error);
+	target->state = FANOUT_DONE;
+	if (target->fd >= 0) {
+		close(target->fd);
+		target->fd = -1;
+	}
+}
+
+/* Move the exchange with one instance along as far as it goes without
+ * blocking */
+static void
+fanout_advance(struct fanout_target *target, const char *request, size_t request_len)
+{
+	if (target->state == FANOUT_CONNECTING) {
+		if (connect(target->fd, (struct sockaddr *)&target->addr, sizeof(target->addr)) < 0 &&
+		    errno != EISCONN) {
+			/* A full backlog; try again on the next round */
+			if (errno == EAGAIN || errno == EINPROGRESS || errno == EALREADY || errno == EINTR) {
+				return;
+			}
+			fanout_fail(target, strerror(errno));
+			return;
+		}
+		target->state = FANOUT_SENDING;
+	}
+
+	while (target->state == FANOUT_SENDING) {
+		ssize_t n = send(target->fd, request + target->sent, request_len - target->sent, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN) {
+				fanout_fail(target, strerror(errno));
+			}
+			return;
+		}
+		target->sent += n;
+		if (target->sent == request_len) {
+			target->state = FANOUT_RECEIVING;
+		}
+	}
+
+	while (target->state == FANOUT_RECEIVING) {
+		/* Make room for at least one more read, and the terminator */
+		if (target->capacity - target->len < CONTROL_BUFFER_SIZE + 1) {
+			size_t capacity = target->capacity ? target->capacity * 2 : 2 * CONTROL_BUFFER_SIZE;
+			char *grown = realloc(target->response, capacity);
+			if (!grown) {
+				fanout_fail(target, "Out of memory");
+				return;
+			}
+			target->response = grown;
+			target->capacity = capacity;
+		}
+
+		ssize_t n = recv(target->fd, target->response + target->len, target->capacity - 1 - target->len, 0);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN) {
+				fanout_fail(target, strerror(errno));
+			}
+			return;
+		}
+		if (n == 0) {
+			/* The server closes the connection after its response */
+			target->response[target->len] = '\0';
+			target->state = FANOUT_DONE;
+			close(target->fd);
+			target->fd = -1;
+			return;
+		}
+		target->len += n;
+	}
+}
+
+static int64_t
+now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Print a JSON string literal */
+static void
+print_json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			printf("\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			printf("\\u%04x", *s);
+		} else {
+			putchar(*s);
+		}
+	}
+	putchar('"');
+}
+
+/* Print one instance's response, each line tagged with the instance's
+ * name. In JSON, the response object gains an "instance" member instead.
+ * Returns 0 for OK responses, -1 for errors and missing responses
+ */
+static int
+print_fanout_response(struct fanout_target *target)
+{
+	if (!target->error[0] && (!target->response || target->len == 0)) {
+		snprintf(target->error, sizeof(target->error), "No response");
+	}
+	if (!target->error[0] && json_output && target->response[0] != '{') {
+		snprintf(target->error, sizeof(target->error), "Invalid response");
+	}
+
+	if (json_output) {
+		printf("{\"instance\":");
+		print_json_string(target->name);
+		if (target->error[0]) {
+			printf(",\"ok\":false,\"error\":");
+			print_json_string(target->error);
+			printf("}\n");
+			return -1;
+		}
+		/* Responses are one object per line */
+		printf(",%s", target->response + 1);
+		return strstr(target->response, "\"ok\":false") ? -1 : 0;
+	}
+
+	if (target->error[0]) {
+		fprintf(stderr, "%s: ERROR %s\n", target->name, target->error);
+		return -1;
+	}
+
+	char *body = strchr(target->response, '\n');
+	if (body) {
+		*body++ = '\0';
+	}
+	if (strncmp(target->response, "ERROR", 5) == 0) {
+		fprintf(stderr, "%s: %s\n", target->name, target->response);
+		return -1;
+	}
+
+	while (body && *body) {
+		char *next = strchr(body, '\n');
+		if (next) {
+			*next++ = '\0';
 		}
+		printf("%s: %s\n", target->name, body);
+		body = next;
+	}
+	return 0;
+}
+
+/* Send a command to every running instance at once, and print their
+ * responses in the order of the registry's index once all have answered,
+ * or failed to in time
+ * Returns 0 if every instance succeeded, -1 otherwise
+ */
+static int
+send_command_all(const char *command)
+{
+	struct fanout fanout = {0};
+	int status = -1;
+	struct pollfd *fds = NULL;
+
+	if (for_each_instance(add_fanout_target, &fanout) < 0) {
+		goto out;
+	}
+	if (fanout.count == 0) {
+		fprintf(stderr, "ERROR: No running instances\n");
+		goto out;
+	}
+
+	char request[CONTROL_BUFFER_SIZE];
+	int request_len = snprintf(request, sizeof(request), "%s%s\n", json_output ? "--json " : "", command);
+	if (request_len < 0 || (size_t)request_len >= sizeof(request)) {
+		fprintf(stderr, "ERROR: Command too long\n");
+		goto out;
+	}
 
-		/* Parse the TOML file */
-		toml_result_t result = toml_parse_file_ex(file_path);
-		if (!result.ok) {
-			fprintf(stderr, "Warning: Failed to parse %s\n", file_path);
+	fds = calloc(fanout.count, sizeof(*fds));
+	if (!fds) {
+		fprintf(stderr, "ERROR: Out of memory\n");
+		goto out;
+	}
+
+	for (size_t i = 0; i < fanout.count; i++) {
+		struct fanout_target *target = &fanout.targets[i];
+		if (socket_address(target->name, &target->addr) < 0) {
+			fanout_fail(target, "Invalid socket path");
 			continue;
 		}
+		target->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (target->fd < 0) {
+			fanout_fail(target, strerror(errno));
+		}
+	}
 
-		/* Extract instance name from filename (remove .toml extension) */
-		char instance_name[PATH_MAX];
-		strncpy(instance_name, entry->d_name, name_len - 5);
-		instance_name[name_len - 5] = '\0';
+	/* Every instance gets the whole timeout, since all are asked at once */
+	int64_t deadline = now_ms() + fanout_timeout_ms;
+	for (;;) {
+		size_t pending = 0;
+		bool connecting = false;
+		for (size_t i = 0; i < fanout.count; i++) {
+			struct fanout_target *target = &fanout.targets[i];
+			if (target->state != FANOUT_DONE) {
+				fanout_advance(target, request, request_len);
+			}
 
-		/* Get PID */
-		toml_datum_t pid_datum = toml_get(result.toptab, "pid");
-		int pid = -1;
-		if (pid_datum.type == TOML_INT64) {
-			pid = (int)pid_datum.u.int64;
+			fds[i].fd = -1;
+			fds[i].events = 0;
+			if (target->state == FANOUT_CONNECTING) {
+				connecting = true;
+				pending++;
+			} else if (target->state != FANOUT_DONE) {
+				fds[i].fd = target->fd;
+				fds[i].events = target->state == FANOUT_SENDING ? POLLOUT : POLLIN;
+				pending++;
+			}
+		}
+		if (pending == 0) {
+			break;
 		}
 
-		/* Get profile (optional) */
-		toml_datum_t profile_datum = toml_get(result.toptab, "profile");
-		const char *profile = NULL;
-		if (profile_datum.type == TOML_STRING && profile_datum.u.s) {
-			profile = profile_datum.u.s;
+		int64_t remaining = deadline - now_ms();
+		if (remaining <= 0) {
+			for (size_t i = 0; i < fanout.count; i++) {
+				if (fanout.targets[i].state != FANOUT_DONE) {
+					fanout_fail(&fanout.targets[i], "Timed out");
+				}
+			}
+			break;
 		}
 
-		/* Print instance info */
-		printf("  %s", instance_name);
-		if (profile) {
-			printf(" (profile: %s)", profile);
+		/* Connections can't be polled for until the server accepts them */
+		int timeout = connecting && remaining > FANOUT_RETRY_MS ? FANOUT_RETRY_MS : (int)remaining;
+		if (poll(fds, fanout.count, timeout) < 0 && errno != EINTR) {
+			perror("ERROR: Failed to wait for responses");
+			goto out;
 		}
-		if (pid > 0) {
-			printf(" [pid: %d]", pid);
+	}
+
+	status = 0;
+	for (size_t i = 0; i < fanout.count; i++) {
+		if (print_fanout_response(&fanout.targets[i]) < 0) {
+			status = -1;
 		}
-		printf("\n");
+	}
 
-		toml_free(result);
-		instance_count++;
+out:
+	for (size_t i = 0; i < fanout.count; i++) {
+		if (fanout.targets[i].fd >= 0) {
+			close(fanout.targets[i].fd);
+		}
+		free(fanout.targets[i].name);
+		free(fanout.targets[i].response);
 	}
+	free(fanout.targets);
+	free(fds);
+	return status;
+}
 
-	closedir(dir);
+/* Send a command to the target instance, or to all of them with --all */
+static int
+run_command(const char *command)
+{
+	return all_instances ? send_command_all(command) : send_command(command);
+}
 
-	if (instance_count == 0) {
-		printf("  (none)\n");
+/* Append arg to buf as one argument of a new-tab command line, quoted if
+ * the server would split or unescape it otherwise. Returns the new
+ * offset; the result is truncated if buf is too small. */
+static size_t
+append_quoted(char *buf, size_t size, size_t offset, const char *arg)
+{
+	bool plain = *arg != '\0';
+	for (const char *c = arg; *c; c++) {
+		if (isspace((unsigned char)*c) || strchr("'\"\\", *c)) {
+			plain = false;
+			break;
+		}
 	}
 
-	return 0;
+	if (offset < size - 1) {
+		buf[offset++] = ' ';
+	}
+	if (!plain && offset < size - 1) {
+		buf[offset++] = '\'';
+	}
+	for (const char *c = arg; *c && offset < size - 1; c++) {
+		if (*c == '\'' && !plain) {
+			/* Close the quote, an escaped quote, and reopen */
+			offset += snprintf(buf + offset, size - offset, "'\\''");
+			offset = offset < size ? offset : size - 1;
+		} else {
+			buf[offset++] = *c;
+		}
+	}
+	if (!plain && offset < size - 1) {
+		buf[offset++] = '\'';
+	}
+	buf[offset] = '\0';
+	return offset;
 }
 
 static void
@@ -266,14 +896,29 @@ usage(const char *prog_name)
 	fprintf(stderr, "Usage: %s [OPTIONS] <command> [args]\n", prog_name);
 	fprintf(stderr, "\nOptions:\n");
 	fprintf(stderr, "  -i, --instance <NAME>  Target specific instance (default: 'default')\n");
+	fprintf(stderr, "  -a, --all              Send the command to all running instances\n");
+	fprintf(stderr, "  -t, --timeout <MS>     How long to wait for each instance with --all (default: %d)\n",
+		FANOUT_TIMEOUT_MS);
+	fprintf(stderr, "  -j, --json             Print responses and events as JSON\n");
 	fprintf(stderr, "\nCommands:\n");
 	fprintf(stderr, "  instances              List all running instances\n");
 	fprintf(stderr, "  list-tabs              List all tabs\n");
-	fprintf(stderr, "  focus-tab <NUM>        Switch to tab NUM\n");
-	fprintf(stderr, "  close-tab [--force] <NUM>  Close tab NUM\n");
-	fprintf(stderr, "  background <NUM>       Move tab to background (hide from tab bar)\n");
-	fprintf(stderr, "  foreground <NUM>       Bring background tab to foreground\n");
+	fprintf(stderr, "  focus-tab <TAB>        Switch to tab TAB\n");
+	fprintf(stderr, "  close-tab [--force] <TAB>  Close tab TAB\n");
+	fprintf(stderr, "  list-outputs           List outputs and the tab shown on each\n");
+	fprintf(stderr, "  focus-output <OUTPUT>  Switch to the tab shown on OUTPUT (-m separate)\n");
+	fprintf(stderr, "  send-to-output <TAB> <OUTPUT>  Move tab TAB to OUTPUT (-m separate)\n");
+	fprintf(stderr, "  background <TAB>       Move tab to background (hide from tab bar)\n");
+	fprintf(stderr, "  foreground <TAB>       Bring background tab to foreground\n");
 	fprintf(stderr, "  new-tab -- <CMD>       Create new tab running CMD\n");
+	fprintf(stderr, "  action <ACTION>        Run a keybinding action, e.g. focus_tab_3\n");
+	fprintf(stderr, "  stats [hud]            Print performance counters, or toggle their HUD\n");
+	fprintf(stderr, "  reload-config          Reload the configuration file\n");
+	fprintf(stderr, "  save-session [NAME]    Save the tabs as profile NAME (default: session)\n");
+	fprintf(stderr, "  batch                  Run commands from stdin, one per line, over one connection\n");
+	fprintf(stderr, "  subscribe              Print tab events as they happen\n");
+	fprintf(stderr, "\nTAB is a tab index as shown by list-tabs, or id:ID for a tab's stable ID.\n");
+	fprintf(stderr, "OUTPUT is an output name, or its index as shown by list-outputs.\n");
 	fprintf(stderr, "\n");
 }
 
@@ -296,6 +941,22 @@ main(int argc, char *argv[])
 			}
 			target_instance = argv[arg_idx + 1];
 			arg_idx += 2;
+		} else if (strcmp(argv[arg_idx], "-j") == 0 || strcmp(argv[arg_idx], "--json") == 0) {
+			json_output = true;
+			arg_idx++;
+		} else if (strcmp(argv[arg_idx], "-a") == 0 || strcmp(argv[arg_idx], "--all") == 0) {
+			all_instances = true;
+			arg_idx++;
+		} else if (strcmp(argv[arg_idx], "-t") == 0 || strcmp(argv[arg_idx], "--timeout") == 0) {
+			char *end = NULL;
+			long timeout = arg_idx + 1 < argc ? strtol(argv[arg_idx + 1], &end, 10) : 0;
+			if (!end || *end != '\0' || timeout <= 0 || timeout > INT_MAX) {
+				fprintf(stderr, "ERROR: %s requires a number of milliseconds\n", argv[arg_idx]);
+				usage(argv[0]);
+				return 1;
+			}
+			fanout_timeout_ms = timeout;
+			arg_idx += 2;
 		} else if (strcmp(argv[arg_idx], "--") == 0) {
 			/* Stop option processing */
 			arg_idx++;
@@ -317,15 +978,34 @@ main(int argc, char *argv[])
 
 	const char *command = argv[arg_idx++];
 
+	if (all_instances) {
+		if (target_instance) {
+			fprintf(stderr, "ERROR: --all and --instance can't be combined\n");
+			return 1;
+		}
+		/* These don't end with a single response */
+		if (strcmp(command, "instances") == 0 || strcmp(command, "batch") == 0 ||
+		    strcmp(command, "subscribe") == 0) {
+			fprintf(stderr, "ERROR: %s can't be sent to all instances\n", command);
+			return 1;
+		}
+	}
+
 	/* Build command string for server */
 	char server_cmd[CONTROL_BUFFER_SIZE];
 
 	if (strcmp(command, "instances") == 0) {
 		return list_instances() == 0 ? 0 : 1;
 
+	} else if (strcmp(command, "batch") == 0) {
+		return run_batch(stdin) == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "subscribe") == 0) {
+		return send_command("subscribe") == 0 ? 0 : 1;
+
 	} else if (strcmp(command, "list-tabs") == 0) {
 		snprintf(server_cmd, sizeof(server_cmd), "list-tabs");
-		return send_command(server_cmd) == 0 ? 0 : 1;
+		return run_command(server_cmd) == 0 ? 0 : 1;
 
 	} else if (strcmp(command, "focus-tab") == 0) {
 		if (arg_idx >= argc) {
@@ -334,7 +1014,28 @@ main(int argc, char *argv[])
 			return 1;
 		}
 		snprintf(server_cmd, sizeof(server_cmd), "focus-tab %s", argv[arg_idx]);
-		return send_command(server_cmd) == 0 ? 0 : 1;
+		return run_command(server_cmd) == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "list-outputs") == 0) {
+		return run_command("list-outputs") == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "focus-output") == 0) {
+		if (arg_idx >= argc) {
+			fprintf(stderr, "ERROR: Missing output\n");
+			usage(argv[0]);
+			return 1;
+		}
+		snprintf(server_cmd, sizeof(server_cmd), "focus-output %s", argv[arg_idx]);
+		return run_command(server_cmd) == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "send-to-output") == 0) {
+		if (arg_idx + 1 >= argc) {
+			fprintf(stderr, "ERROR: Missing tab index or output\n");
+			usage(argv[0]);
+			return 1;
+		}
+		snprintf(server_cmd, sizeof(server_cmd), "send-to-output %s %s", argv[arg_idx], argv[arg_idx + 1]);
+		return run_command(server_cmd) == 0 ? 0 : 1;
 
 	} else if (strcmp(command, "close-tab") == 0) {
 		if (arg_idx >= argc) {
@@ -363,7 +1064,7 @@ main(int argc, char *argv[])
 		} else {
 			snprintf(server_cmd, sizeof(server_cmd), "close-tab %s", argv[cmd_arg_idx]);
 		}
-		return send_command(server_cmd) == 0 ? 0 : 1;
+		return run_command(server_cmd) == 0 ? 0 : 1;
 
 	} else if (strcmp(command, "background") == 0) {
 		if (arg_idx >= argc) {
@@ -372,7 +1073,7 @@ main(int argc, char *argv[])
 			return 1;
 		}
 		snprintf(server_cmd, sizeof(server_cmd), "background %s", argv[arg_idx]);
-		return send_command(server_cmd) == 0 ? 0 : 1;
+		return run_command(server_cmd) == 0 ? 0 : 1;
 
 	} else if (strcmp(command, "foreground") == 0) {
 		if (arg_idx >= argc) {
@@ -381,7 +1082,46 @@ main(int argc, char *argv[])
 			return 1;
 		}
 		snprintf(server_cmd, sizeof(server_cmd), "foreground %s", argv[arg_idx]);
-		return send_command(server_cmd) == 0 ? 0 : 1;
+		return run_command(server_cmd) == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "action") == 0) {
+		if (arg_idx >= argc) {
+			fprintf(stderr, "ERROR: Missing action\n");
+			usage(argv[0]);
+			return 1;
+		}
+		snprintf(server_cmd, sizeof(server_cmd), "action %s", argv[arg_idx]);
+		return run_command(server_cmd) == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "stats") == 0) {
+		if (arg_idx < argc) {
+			snprintf(server_cmd, sizeof(server_cmd), "stats %s", argv[arg_idx]);
+		} else {
+			snprintf(server_cmd, sizeof(server_cmd), "stats");
+		}
+		return run_command(server_cmd) == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "reload-config") == 0) {
+		return run_command("reload-config") == 0 ? 0 : 1;
+
+	} else if (strcmp(command, "save-session") == 0) {
+		if (arg_idx >= argc) {
+			return run_command("save-session") == 0 ? 0 : 1;
+		}
+		/* Paths are relative to where waymuxctl runs, not WayMux */
+		const char *name = argv[arg_idx];
+		char cwd[4096];
+		int len;
+		if (strchr(name, '/') && name[0] != '/' && getcwd(cwd, sizeof(cwd))) {
+			len = snprintf(server_cmd, sizeof(server_cmd), "save-session %s/%s", cwd, name);
+		} else {
+			len = snprintf(server_cmd, sizeof(server_cmd), "save-session %s", name);
+		}
+		if (len < 0 || (size_t)len >= sizeof(server_cmd)) {
+			fprintf(stderr, "ERROR: Path too long\n");
+			return 1;
+		}
+		return run_command(server_cmd) == 0 ? 0 : 1;
 
 	} else if (strcmp(command, "new-tab") == 0) {
 		if (arg_idx >= argc || strcmp(argv[arg_idx], "--") != 0) {
@@ -392,11 +1132,11 @@ main(int argc, char *argv[])
 
 		/* Build command string from argv[arg_idx+1+] */
 		size_t offset = snprintf(server_cmd, sizeof(server_cmd), "new-tab --");
-		for (int i = arg_idx + 1; i < argc && offset < sizeof(server_cmd) - 2; i++) {
-			offset += snprintf(server_cmd + offset, sizeof(server_cmd) - offset, " %s", argv[i]);
+		for (int i = arg_idx + 1; i < argc; i++) {
+			offset = append_quoted(server_cmd, sizeof(server_cmd), offset, argv[i]);
 		}
 
-		return send_command(server_cmd) == 0 ? 0 : 1;
+		return run_command(server_cmd) == 0 ? 0 : 1;
 
 	} else {
 		fprintf(stderr, "ERROR: Unknown command '%s'\n", command);
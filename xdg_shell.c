@@ -133,6 +133,23 @@ get_app_id(struct cg_view *view)
 	return xdg_shell_view->xdg_toplevel->app_id;
 }
 
+static pid_t
+get_pid(struct cg_view *view)
+{
+	struct cg_xdg_shell_view *xdg_shell_view = xdg_shell_view_from_view(view);
+	struct wl_client *client = wl_resource_get_client(xdg_shell_view->xdg_toplevel->resource);
+	pid_t pid;
+	wl_client_get_credentials(client, &pid, NULL, NULL);
+	return pid;
+}
+
+static void
+set_suspended(struct cg_view *view, bool suspended)
+{
+	struct cg_xdg_shell_view *xdg_shell_view = xdg_shell_view_from_view(view);
+	wlr_xdg_toplevel_set_suspended(xdg_shell_view->xdg_toplevel, suspended);
+}
+
 static void
 get_geometry(struct cg_view *view, int *width_out, int *height_out)
 {
@@ -250,16 +267,23 @@ handle_xdg_toplevel_map(struct wl_listener *listener, void *data)
 	struct cg_view *view = &xdg_shell_view->view;
 
 	view_map(view, xdg_shell_view->xdg_toplevel->base->surface);
-
-	if (xdg_shell_view->xdg_toplevel->title)
-		wlr_foreign_toplevel_handle_v1_set_title(view->foreign_toplevel_handle,
-							 xdg_shell_view->xdg_toplevel->title);
-	if (xdg_shell_view->xdg_toplevel->app_id)
-		wlr_foreign_toplevel_handle_v1_set_app_id(view->foreign_toplevel_handle,
-							  xdg_shell_view->xdg_toplevel->app_id);
 	/* Activation state will be set by seat_set_focus */
 }
 
+static void
+handle_xdg_toplevel_set_title(struct wl_listener *listener, void *data)
+{
+	struct cg_xdg_shell_view *xdg_shell_view = wl_container_of(listener, xdg_shell_view, set_title);
+	view_update_title(&xdg_shell_view->view);
+}
+
+static void
+handle_xdg_toplevel_set_app_id(struct wl_listener *listener, void *data)
+{
+	struct cg_xdg_shell_view *xdg_shell_view = wl_container_of(listener, xdg_shell_view, set_app_id);
+	view_update_title(&xdg_shell_view->view);
+}
+
 static void
 handle_xdg_toplevel_commit(struct wl_listener *listener, void *data)
 {
@@ -272,7 +296,9 @@ handle_xdg_toplevel_commit(struct wl_listener *listener, void *data)
 	wlr_xdg_toplevel_set_wm_capabilities(xdg_shell_view->xdg_toplevel, XDG_TOPLEVEL_WM_CAPABILITIES_FULLSCREEN);
 
 	/* When an xdg_surface performs an initial commit, the compositor must
-	 * reply with a configure so the client can map the surface. */
+	 * reply with a configure so the client can map the surface, even if
+	 * it is one the view already had. */
+	xdg_shell_view->view.configured_box = (struct wlr_box){0};
 	view_position(&xdg_shell_view->view);
 }
 
@@ -287,6 +313,8 @@ handle_xdg_toplevel_destroy(struct wl_listener *listener, void *data)
 	wl_list_remove(&xdg_shell_view->unmap.link);
 	wl_list_remove(&xdg_shell_view->destroy.link);
 	wl_list_remove(&xdg_shell_view->request_fullscreen.link);
+	wl_list_remove(&xdg_shell_view->set_title.link);
+	wl_list_remove(&xdg_shell_view->set_app_id.link);
 	xdg_shell_view->xdg_toplevel = NULL;
 
 	view_destroy(view);
@@ -295,6 +323,8 @@ handle_xdg_toplevel_destroy(struct wl_listener *listener, void *data)
 static const struct cg_view_impl xdg_shell_view_impl = {
 	.get_title = get_title,
 	.get_app_id = get_app_id,
+	.get_pid = get_pid,
+	.set_suspended = set_suspended,
 	.get_geometry = get_geometry,
 	.is_primary = is_primary,
 	.is_transient_for = is_transient_for,
@@ -333,6 +363,10 @@ handle_new_xdg_toplevel(struct wl_listener *listener, void *data)
 	wl_signal_add(&toplevel->events.destroy, &xdg_shell_view->destroy);
 	xdg_shell_view->request_fullscreen.notify = handle_xdg_toplevel_request_fullscreen;
 	wl_signal_add(&toplevel->events.request_fullscreen, &xdg_shell_view->request_fullscreen);
+	xdg_shell_view->set_title.notify = handle_xdg_toplevel_set_title;
+	wl_signal_add(&toplevel->events.set_title, &xdg_shell_view->set_title);
+	xdg_shell_view->set_app_id.notify = handle_xdg_toplevel_set_app_id;
+	wl_signal_add(&toplevel->events.set_app_id, &xdg_shell_view->set_app_id);
 
 	toplevel->base->data = xdg_shell_view;
 }
@@ -11,13 +11,31 @@
 #include <stdlib.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_foreign_toplevel_management_v1.h>
+#include <wlr/types/wlr_xcursor_manager.h>
 #include <wlr/util/log.h>
 #include <wlr/xwayland.h>
 
+#include "seat.h"
 #include "server.h"
 #include "view.h"
 #include "xwayland.h"
 
+/* How long an X server started on demand keeps running after its last
+ * client exits, so that restarting an X application doesn't restart it */
+#define XWAYLAND_TERMINATE_DELAY 10
+
+struct cg_xwayland {
+	struct cg_server *server;
+	struct wlr_compositor *compositor;
+	enum waymux_xwayland_mode mode;
+	bool configured;  /* Whether a mode was set yet */
+
+	/* NULL while disabled */
+	struct wlr_xwayland_server *xwayland_server;
+	struct wlr_xwayland *xwayland;
+	struct wlr_xcursor_manager *xcursor_manager;
+};
+
 struct cg_xwayland_view *
 xwayland_view_from_view(struct cg_view *view)
 {
@@ -46,6 +64,13 @@ get_app_id(struct cg_view *view)
 	return xwayland_view->xwayland_surface->class;
 }
 
+static pid_t
+get_pid(struct cg_view *view)
+{
+	struct cg_xwayland_view *xwayland_view = xwayland_view_from_view(view);
+	return xwayland_view->xwayland_surface->pid;
+}
+
 static void
 get_geometry(struct cg_view *view, int *width_out, int *height_out)
 {
@@ -160,16 +185,24 @@ handle_xwayland_surface_map(struct wl_listener *listener, void *data)
 
 	view_map(view, xwayland_view->xwayland_surface->surface);
 
-	if (xwayland_view->xwayland_surface->title)
-		wlr_foreign_toplevel_handle_v1_set_title(view->foreign_toplevel_handle,
-							 xwayland_view->xwayland_surface->title);
-	if (xwayland_view->xwayland_surface->class)
-		wlr_foreign_toplevel_handle_v1_set_app_id(view->foreign_toplevel_handle,
-							  xwayland_view->xwayland_surface->class);
 	wlr_foreign_toplevel_handle_v1_set_fullscreen(view->foreign_toplevel_handle,
 						      xwayland_view->xwayland_surface->fullscreen);
 }
 
+static void
+handle_xwayland_surface_set_title(struct wl_listener *listener, void *data)
+{
+	struct cg_xwayland_view *xwayland_view = wl_container_of(listener, xwayland_view, set_title);
+	view_update_title(&xwayland_view->view);
+}
+
+static void
+handle_xwayland_surface_set_class(struct wl_listener *listener, void *data)
+{
+	struct cg_xwayland_view *xwayland_view = wl_container_of(listener, xwayland_view, set_class);
+	view_update_title(&xwayland_view->view);
+}
+
 static void
 handle_xwayland_surface_destroy(struct wl_listener *listener, void *data)
 {
@@ -180,6 +213,8 @@ handle_xwayland_surface_destroy(struct wl_listener *listener, void *data)
 	wl_list_remove(&xwayland_view->dissociate.link);
 	wl_list_remove(&xwayland_view->destroy.link);
 	wl_list_remove(&xwayland_view->request_fullscreen.link);
+	wl_list_remove(&xwayland_view->set_title.link);
+	wl_list_remove(&xwayland_view->set_class.link);
 	xwayland_view->xwayland_surface = NULL;
 
 	view_destroy(view);
@@ -188,6 +223,7 @@ handle_xwayland_surface_destroy(struct wl_listener *listener, void *data)
 static const struct cg_view_impl xwayland_view_impl = {
 	.get_title = get_title,
 	.get_app_id = get_app_id,
+	.get_pid = get_pid,
 	.get_geometry = get_geometry,
 	.is_primary = is_primary,
 	.is_transient_for = is_transient_for,
@@ -244,4 +280,136 @@ handle_xwayland_surface_new(struct wl_listener *listener, void *data)
 	wl_signal_add(&xwayland_surface->events.destroy, &xwayland_view->destroy);
 	xwayland_view->request_fullscreen.notify = handle_xwayland_surface_request_fullscreen;
 	wl_signal_add(&xwayland_surface->events.request_fullscreen, &xwayland_view->request_fullscreen);
+	xwayland_view->set_title.notify = handle_xwayland_surface_set_title;
+	wl_signal_add(&xwayland_surface->events.set_title, &xwayland_view->set_title);
+	xwayland_view->set_class.notify = handle_xwayland_surface_set_class;
+	wl_signal_add(&xwayland_surface->events.set_class, &xwayland_view->set_class);
+}
+
+/* Listen on DISPLAY; the X server itself is only started once a client
+ * connects to it */
+static bool
+xwayland_start(struct cg_xwayland *xwayland, enum waymux_xwayland_mode mode)
+{
+	struct cg_server *server = xwayland->server;
+	struct wlr_xwayland_server_options options = {
+		.lazy = true,
+		.enable_wm = true,
+		.terminate_delay = mode == WAYMUX_XWAYLAND_ON_DEMAND ? XWAYLAND_TERMINATE_DELAY : 0,
+	};
+
+	xwayland->xwayland_server = wlr_xwayland_server_create(server->wl_display, &options);
+	if (!xwayland->xwayland_server) {
+		wlr_log(WLR_ERROR, "Cannot create XWayland server");
+		return false;
+	}
+
+	xwayland->xwayland =
+		wlr_xwayland_create_with_server(server->wl_display, xwayland->compositor, xwayland->xwayland_server);
+	if (!xwayland->xwayland) {
+		wlr_log(WLR_ERROR, "Cannot create XWayland");
+		wlr_xwayland_server_destroy(xwayland->xwayland_server);
+		xwayland->xwayland_server = NULL;
+		return false;
+	}
+	server->new_xwayland_surface.notify = handle_xwayland_surface_new;
+	wl_signal_add(&xwayland->xwayland->events.new_surface, &server->new_xwayland_surface);
+	if (server->seat) {
+		wlr_xwayland_set_seat(xwayland->xwayland, server->seat->seat);
+	}
+
+	xwayland->xcursor_manager = wlr_xcursor_manager_create(DEFAULT_XCURSOR, XCURSOR_SIZE);
+	if (!xwayland->xcursor_manager) {
+		wlr_log(WLR_ERROR, "Cannot create XWayland XCursor manager");
+	} else if (!wlr_xcursor_manager_load(xwayland->xcursor_manager, 1)) {
+		wlr_log(WLR_ERROR, "Cannot load XWayland XCursor theme");
+	} else {
+		struct wlr_xcursor *xcursor =
+			wlr_xcursor_manager_get_xcursor(xwayland->xcursor_manager, DEFAULT_XCURSOR, 1);
+		if (xcursor) {
+			struct wlr_xcursor_image *image = xcursor->images[0];
+			wlr_xwayland_set_cursor(xwayland->xwayland, image->buffer, image->width * 4, image->width,
+						image->height, image->hotspot_x, image->hotspot_y);
+		}
+	}
+
+	if (setenv("DISPLAY", xwayland->xwayland->display_name, true) < 0) {
+		wlr_log_errno(WLR_ERROR, "Unable to set DISPLAY for XWayland. Clients may not be able to connect");
+	} else {
+		wlr_log(WLR_DEBUG, "XWayland is listening on display %s%s", xwayland->xwayland->display_name,
+			mode == WAYMUX_XWAYLAND_ON_DEMAND ? ", until its last client exits" : "");
+	}
+	return true;
+}
+
+static void
+xwayland_stop(struct cg_xwayland *xwayland)
+{
+	if (!xwayland->xwayland) {
+		return;
+	}
+
+	wl_list_remove(&xwayland->server->new_xwayland_surface.link);
+	wlr_xwayland_destroy(xwayland->xwayland);
+	wlr_xwayland_server_destroy(xwayland->xwayland_server);
+	wlr_xcursor_manager_destroy(xwayland->xcursor_manager);
+	xwayland->xwayland = NULL;
+	xwayland->xwayland_server = NULL;
+	xwayland->xcursor_manager = NULL;
+}
+
+struct cg_xwayland *
+xwayland_create(struct cg_server *server, struct wlr_compositor *compositor)
+{
+	struct cg_xwayland *xwayland = calloc(1, sizeof(*xwayland));
+	if (!xwayland) {
+		wlr_log(WLR_ERROR, "Failed to allocate XWayland");
+		return NULL;
+	}
+
+	xwayland->server = server;
+	xwayland->compositor = compositor;
+	return xwayland;
+}
+
+bool
+xwayland_set_mode(struct cg_xwayland *xwayland, enum waymux_xwayland_mode mode)
+{
+	if (xwayland->configured && xwayland->mode == mode) {
+		return true;
+	}
+
+	/* Starting over would take the running X server's clients with it */
+	if (xwayland->xwayland_server && xwayland->xwayland_server->client) {
+		wlr_log(WLR_INFO, "XWayland is in use, keeping it running as it is");
+		return false;
+	}
+
+	xwayland_stop(xwayland);
+	xwayland->mode = mode;
+	xwayland->configured = true;
+	if (mode == WAYMUX_XWAYLAND_DISABLED) {
+		/* Nor should X clients find the X server WayMux runs in */
+		unsetenv("DISPLAY");
+		wlr_log(WLR_DEBUG, "XWayland is disabled");
+		return true;
+	}
+
+	if (!xwayland_start(xwayland, mode)) {
+		xwayland->mode = WAYMUX_XWAYLAND_DISABLED;
+		unsetenv("DISPLAY");
+		return false;
+	}
+	return true;
+}
+
+void
+xwayland_destroy(struct cg_xwayland *xwayland)
+{
+	if (!xwayland) {
+		return;
+	}
+
+	xwayland_stop(xwayland);
+	free(xwayland);
 }
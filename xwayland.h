@@ -5,6 +5,13 @@
 #include <wlr/xwayland.h>
 
 #include "view.h"
+#include "waymux_config.h"
+
+struct cg_server;
+struct wlr_compositor;
+
+/* Runs XWayland according to a waymux_xwayland_mode */
+struct cg_xwayland;
 
 struct cg_xwayland_view {
 	struct cg_view view;
@@ -15,10 +22,24 @@ struct cg_xwayland_view {
 	struct wl_listener unmap;
 	struct wl_listener map;
 	struct wl_listener request_fullscreen;
+	struct wl_listener set_title;
+	struct wl_listener set_class;
 };
 
 struct cg_xwayland_view *xwayland_view_from_view(struct cg_view *view);
 bool xwayland_view_should_manage(struct cg_view *view);
 void handle_xwayland_surface_new(struct wl_listener *listener, void *data);
 
+/* Create XWayland, disabled until xwayland_set_mode() */
+struct cg_xwayland *xwayland_create(struct cg_server *server, struct wlr_compositor *compositor);
+
+/* Start listening on DISPLAY, or stop and unset it, as the mode asks.
+ * Clients started afterwards see the new DISPLAY. Returns false if the
+ * mode couldn't be applied, including while X clients are connected,
+ * since changing it restarts the X server. */
+bool xwayland_set_mode(struct cg_xwayland *xwayland, enum waymux_xwayland_mode mode);
+
+/* Stop XWayland. NULL-safe. */
+void xwayland_destroy(struct cg_xwayland *xwayland);
+
 #endif